@@ -0,0 +1,233 @@
+#include "Adafruit_ST7789.h"
+#include "hal_native.h"
+#include <chrono>
+#include <thread>
+
+SPIClass SPI;
+
+// Bytes a window change costs on the wire: CASET + 4, RASET + 4, RAMWR
+static const uint32_t WINDOW_COMMAND_BYTES = 11;
+// Sleep once this much bus time has piled up (finer sleeps are mostly overhead)
+static const double BUS_SLEEP_NANOS = 50000.0;
+
+Adafruit_ST7789::Adafruit_ST7789(int8_t cs, int8_t dc, int8_t rst) : Adafruit_GFX(240, 320) {
+    (void)cs; (void)dc; (void)rst;
+    setup();
+}
+
+Adafruit_ST7789::Adafruit_ST7789(int8_t cs, int8_t dc, int8_t mosi, int8_t sclk, int8_t rst) : Adafruit_GFX(240, 320) {
+    (void)cs; (void)dc; (void)mosi; (void)sclk; (void)rst;
+    setup();
+}
+
+Adafruit_ST7789::Adafruit_ST7789(SPIClass* spiClass, int8_t cs, int8_t dc, int8_t rst) : Adafruit_GFX(240, 320) {
+    (void)spiClass; (void)cs; (void)dc; (void)rst;
+    setup();
+}
+
+Adafruit_ST7789::~Adafruit_ST7789() {
+    delete[] framebuffer;
+}
+
+void Adafruit_ST7789::setup() {
+    this->framebuffer = nullptr;
+    this->windowX0 = this->windowY0 = this->windowX1 = this->windowY1 = 0;
+    this->cursorX = this->cursorY = 0;
+    this->pixelsWritten = 0;
+    this->windows = 0;
+    this->writeCount = 0;
+    this->busNanosOwed = 0;
+    HalNative::registerPanel(this);
+}
+
+void Adafruit_ST7789::init(uint16_t width, uint16_t height, uint8_t spiMode) {
+    (void)spiMode;
+    std::lock_guard<std::recursive_mutex> guard(bus);
+    WIDTH = width;
+    HEIGHT = height;
+    delete[] framebuffer;
+    framebuffer = new uint16_t[(size_t)WIDTH * HEIGHT];
+    memset(framebuffer, 0, (size_t)WIDTH * HEIGHT * sizeof(uint16_t));
+    setRotation(0);
+}
+
+void Adafruit_ST7789::setRotation(uint8_t m) {
+    Adafruit_GFX::setRotation(m);
+}
+
+void Adafruit_ST7789::chargeBus(uint32_t bytes) {
+    double mhz = HalNative::spiMegahertz();
+    if (mhz <= 0) return;
+    busNanosOwed += bytes * 8 * 1000.0 / mhz;
+    if (busNanosOwed >= BUS_SLEEP_NANOS) {
+        std::this_thread::sleep_for(std::chrono::nanoseconds((int64_t)busNanosOwed));
+        busNanosOwed = 0;
+    }
+}
+
+// Logical (rotated) coordinates to panel memory, as MADCTL does on the chip
+int32_t Adafruit_ST7789::index(int16_t x, int16_t y) const {
+    int16_t t;
+    switch (rotation) {
+        case 1:
+            t = x;
+            x = WIDTH - 1 - y;
+            y = t;
+            break;
+        case 2:
+            x = WIDTH - 1 - x;
+            y = HEIGHT - 1 - y;
+            break;
+        case 3:
+            t = x;
+            x = y;
+            y = HEIGHT - 1 - t;
+            break;
+    }
+    return (int32_t)y * WIDTH + x;
+}
+
+void Adafruit_ST7789::fill(int16_t x, int16_t y, int16_t w, int16_t h, uint16_t color) {
+    if (w < 0) { x += w + 1; w = -w; }
+    if (h < 0) { y += h + 1; h = -h; }
+    int16_t x1 = x + w - 1;
+    int16_t y1 = y + h - 1;
+    if (x < 0) x = 0;
+    if (y < 0) y = 0;
+    if (x1 >= _width) x1 = _width - 1;
+    if (y1 >= _height) y1 = _height - 1;
+    if (framebuffer == nullptr || x > x1 || y > y1) return;
+
+    std::lock_guard<std::recursive_mutex> guard(bus);
+    for (int16_t row = y; row <= y1; row++) {
+        for (int16_t col = x; col <= x1; col++) {
+            framebuffer[index(col, row)] = color;
+        }
+    }
+    uint32_t count = (uint32_t)(x1 - x + 1) * (y1 - y + 1);
+    pixelsWritten += count;
+    windows++;
+    writeCount++;
+    chargeBus(WINDOW_COMMAND_BYTES + count * 2);
+}
+
+void Adafruit_ST7789::startWrite(void) {
+    bus.lock();
+}
+
+void Adafruit_ST7789::endWrite(void) {
+    bus.unlock();
+}
+
+void Adafruit_ST7789::drawPixel(int16_t x, int16_t y, uint16_t color) {
+    fill(x, y, 1, 1, color);
+}
+
+void Adafruit_ST7789::writePixel(int16_t x, int16_t y, uint16_t color) {
+    fill(x, y, 1, 1, color);
+}
+
+void Adafruit_ST7789::writeFillRect(int16_t x, int16_t y, int16_t w, int16_t h, uint16_t color) {
+    fill(x, y, w, h, color);
+}
+
+void Adafruit_ST7789::writeFastHLine(int16_t x, int16_t y, int16_t w, uint16_t color) {
+    fill(x, y, w, 1, color);
+}
+
+void Adafruit_ST7789::writeFastVLine(int16_t x, int16_t y, int16_t h, uint16_t color) {
+    fill(x, y, 1, h, color);
+}
+
+void Adafruit_ST7789::fillRect(int16_t x, int16_t y, int16_t w, int16_t h, uint16_t color) {
+    fill(x, y, w, h, color);
+}
+
+void Adafruit_ST7789::drawFastHLine(int16_t x, int16_t y, int16_t w, uint16_t color) {
+    fill(x, y, w, 1, color);
+}
+
+void Adafruit_ST7789::drawFastVLine(int16_t x, int16_t y, int16_t h, uint16_t color) {
+    fill(x, y, 1, h, color);
+}
+
+void Adafruit_ST7789::setAddrWindow(uint16_t x, uint16_t y, uint16_t w, uint16_t h) {
+    std::lock_guard<std::recursive_mutex> guard(bus);
+    windowX0 = x;
+    windowY0 = y;
+    windowX1 = x + w - 1;
+    windowY1 = y + h - 1;
+    cursorX = windowX0;
+    cursorY = windowY0;
+    windows++;
+    chargeBus(WINDOW_COMMAND_BYTES);
+}
+
+// Next pixel of a setAddrWindow burst
+void Adafruit_ST7789::stream(uint16_t color) {
+    // Pixels outside the panel are dropped by the controller
+    if (cursorX >= 0 && cursorX < _width && cursorY >= 0 && cursorY < _height) {
+        framebuffer[index(cursorX, cursorY)] = color;
+    }
+    if (++cursorX > windowX1) {
+        cursorX = windowX0;
+        if (++cursorY > windowY1) cursorY = windowY0;
+    }
+}
+
+void Adafruit_ST7789::writeColor(uint16_t color, uint32_t len) {
+    std::lock_guard<std::recursive_mutex> guard(bus);
+    if (framebuffer == nullptr) return;
+    for (uint32_t i = 0; i < len; i++) {
+        stream(color);
+    }
+    pixelsWritten += len;
+    writeCount++;
+    chargeBus(len * 2);
+}
+
+void Adafruit_ST7789::writePixels(uint16_t* colors, uint32_t len, bool block, bool bigEndian) {
+    (void)block;
+    std::lock_guard<std::recursive_mutex> guard(bus);
+    if (framebuffer == nullptr) return;
+    for (uint32_t i = 0; i < len; i++) {
+        stream(bigEndian ? (uint16_t)((colors[i] >> 8) | (colors[i] << 8)) : colors[i]);
+    }
+    pixelsWritten += len;
+    writeCount++;
+    chargeBus(len * 2);
+}
+
+void Adafruit_ST7789::pushColor(uint16_t color) {
+    writeColor(color, 1);
+}
+
+// Straight to the panel, like the library's setAddrWindow + writePixels
+void Adafruit_ST7789::drawRGBBitmap(int16_t x, int16_t y, uint16_t* bitmap, int16_t w, int16_t h) {
+    std::lock_guard<std::recursive_mutex> guard(bus);
+    for (int16_t j = 0; j < h; j++) {
+        for (int16_t i = 0; i < w; i++) {
+            fill(x + i, y + j, 1, 1, bitmap[j * w + i]);
+        }
+    }
+}
+
+bool Adafruit_ST7789::writePpm(const char* path) {
+    FILE* f = fopen(path, "wb");
+    if (f == nullptr) return false;
+    std::lock_guard<std::recursive_mutex> guard(bus);
+    fprintf(f, "P6\n%d %d\n255\n", _width, _height);
+    uint8_t* row = new uint8_t[_width * 3];
+    for (int16_t y = 0; y < _height; y++) {
+        for (int16_t x = 0; x < _width; x++) {
+            uint16_t c = framebuffer != nullptr ? framebuffer[index(x, y)] : 0;
+            uint8_t r = (c >> 11) & 0x1F, g = (c >> 5) & 0x3F, b = c & 0x1F;
+            row[x * 3 + 0] = (uint8_t)((r << 3) | (r >> 2));
+            row[x * 3 + 1] = (uint8_t)((g << 2) | (g >> 4));
+            row[x * 3 + 2] = (uint8_t)((b << 3) | (b >> 2));
+        }
+        fwrite(row, 1, _width * 3, f);
+    }
+    delete[] row;
+    return fclose(f) == 0;
+}
@@ -0,0 +1,83 @@
+#ifndef _ADAFRUIT_ST7789H_
+#define _ADAFRUIT_ST7789H_
+
+#include <Adafruit_GFX.h>
+#include <SPI.h>
+#include <atomic>
+#include <mutex>
+
+#define ST77XX_BLACK 0x0000
+#define ST77XX_WHITE 0xFFFF
+#define ST77XX_RED 0xF800
+#define ST77XX_GREEN 0x07E0
+#define ST77XX_BLUE 0x001F
+#define ST77XX_CYAN 0x07FF
+#define ST77XX_MAGENTA 0xF81F
+#define ST77XX_YELLOW 0xFFE0
+#define ST77XX_ORANGE 0xFC00
+
+// The ST7789 as an RGB565 framebuffer in panel (portrait) orientation.
+// Takes the Adafruit_SPITFT calls the library's users make: GFX primitives,
+// setAddrWindow + writePixels bursts, rotation.
+//
+// startWrite()/endWrite() hold the bus like SPI transactions do on the
+// ESP32, so a setAddrWindow burst from another task lands whole, and a
+// frame dump never sees half of one. With --spi-mhz, every command and
+// pixel byte costs the time the bus would take.
+class Adafruit_ST7789 : public Adafruit_GFX {
+public:
+    Adafruit_ST7789(int8_t cs, int8_t dc, int8_t rst);
+    Adafruit_ST7789(int8_t cs, int8_t dc, int8_t mosi, int8_t sclk, int8_t rst);
+    Adafruit_ST7789(SPIClass* spiClass, int8_t cs, int8_t dc, int8_t rst);
+    ~Adafruit_ST7789();
+
+    void init(uint16_t width = 240, uint16_t height = 240, uint8_t spiMode = SPI_MODE0);
+    void setRotation(uint8_t m) override;
+
+    void drawPixel(int16_t x, int16_t y, uint16_t color) override;
+    void startWrite(void) override;
+    void endWrite(void) override;
+    void writePixel(int16_t x, int16_t y, uint16_t color) override;
+    void writeFillRect(int16_t x, int16_t y, int16_t w, int16_t h, uint16_t color) override;
+    void writeFastHLine(int16_t x, int16_t y, int16_t w, uint16_t color) override;
+    void writeFastVLine(int16_t x, int16_t y, int16_t h, uint16_t color) override;
+    void fillRect(int16_t x, int16_t y, int16_t w, int16_t h, uint16_t color) override;
+    void drawFastHLine(int16_t x, int16_t y, int16_t w, uint16_t color) override;
+    void drawFastVLine(int16_t x, int16_t y, int16_t h, uint16_t color) override;
+    void invertDisplay(bool i) override { (void)i; }
+
+    void setAddrWindow(uint16_t x, uint16_t y, uint16_t w, uint16_t h);
+    void writePixels(uint16_t* colors, uint32_t len, bool block = true, bool bigEndian = false);
+    void writeColor(uint16_t color, uint32_t len);
+    void pushColor(uint16_t color);
+    void drawRGBBitmap(int16_t x, int16_t y, uint16_t* bitmap, int16_t w, int16_t h);
+    void enableDisplay(bool enable) { (void)enable; }
+    void enableSleep(bool enable) { (void)enable; }
+    uint16_t color565(uint8_t r, uint8_t g, uint8_t b) {
+        return ((r & 0xF8) << 8) | ((g & 0xFC) << 3) | (b >> 3);
+    }
+
+    // Host only: what the panel shows, as binary PPM in the current orientation
+    bool writePpm(const char* path);
+    uint64_t getPixelsWritten() const { return pixelsWritten; }
+    uint32_t getWindows() const { return windows; }
+    uint32_t getWriteCount() const { return writeCount; }   // Changes whenever anything is drawn
+
+private:
+    uint16_t* framebuffer;
+    std::recursive_mutex bus;
+    int16_t windowX0, windowY0, windowX1, windowY1;
+    int16_t cursorX, cursorY;
+    std::atomic<uint64_t> pixelsWritten;
+    std::atomic<uint32_t> windows;
+    std::atomic<uint32_t> writeCount;
+    double busNanosOwed;
+
+    void setup();
+    int32_t index(int16_t x, int16_t y) const;          // Logical, already clipped
+    void fill(int16_t x, int16_t y, int16_t w, int16_t h, uint16_t color);
+    void stream(uint16_t color);
+    void chargeBus(uint32_t bytes);
+};
+
+#endif
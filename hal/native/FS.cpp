@@ -0,0 +1,301 @@
+#include "FS.h"
+#include "SPIFFS.h"
+#include "hal_native.h"
+#include <atomic>
+#include <dirent.h>
+#include <errno.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace fs {
+
+struct FileImpl {
+    FILE* file;
+    DIR* dir;
+    std::string path;       // As the firmware named it ("/chat_3.log")
+    std::string host;       // Where it lives on the host
+
+    FileImpl() : file(nullptr), dir(nullptr) {}
+    ~FileImpl() { close(); }
+
+    void close() {
+        if (file != nullptr) fclose(file);
+        if (dir != nullptr) closedir(dir);
+        file = nullptr;
+        dir = nullptr;
+    }
+};
+
+// Relaxed counters: the socket task and loop() both use SPIFFS in the app
+static std::atomic<uint32_t> statOpens(0);
+static std::atomic<uint32_t> statReads(0);
+static std::atomic<uint32_t> statWrites(0);
+static std::atomic<uint32_t> statSeeks(0);
+static std::atomic<uint64_t> statBytesRead(0);
+static std::atomic<uint64_t> statBytesWritten(0);
+
+static void countRead(size_t bytes) {
+    statReads.fetch_add(1, std::memory_order_relaxed);
+    statBytesRead.fetch_add(bytes, std::memory_order_relaxed);
+}
+
+static void makeParents(const std::string& host) {
+    for (size_t at = host.find('/', 1); at != std::string::npos; at = host.find('/', at + 1)) {
+        ::mkdir(host.substr(0, at).c_str(), 0755);
+    }
+}
+
+static FileImplPtr openHost(const std::string& path, const std::string& host, const char* mode) {
+    struct stat st;
+    FileImplPtr impl(new FileImpl());
+    impl->path = path;
+    impl->host = host;
+    if (stat(host.c_str(), &st) == 0 && S_ISDIR(st.st_mode)) {
+        impl->dir = opendir(host.c_str());
+        return impl->dir != nullptr ? impl : FileImplPtr();
+    }
+    if (mode[0] != 'r') {
+        makeParents(host);
+    }
+    impl->file = fopen(host.c_str(), mode);
+    statOpens.fetch_add(1, std::memory_order_relaxed);
+    return impl->file != nullptr ? impl : FileImplPtr();
+}
+
+// ----- File -----
+
+size_t File::write(uint8_t c) {
+    return write(&c, 1);
+}
+
+size_t File::write(const uint8_t* buf, size_t size) {
+    if (!impl || impl->file == nullptr) return 0;
+    size_t written = fwrite(buf, 1, size, impl->file);
+    statWrites.fetch_add(1, std::memory_order_relaxed);
+    statBytesWritten.fetch_add(written, std::memory_order_relaxed);
+    return written;
+}
+
+int File::available() {
+    if (!impl || impl->file == nullptr) return 0;
+    return (int)(size() - position());
+}
+
+int File::read() {
+    if (!impl || impl->file == nullptr) return -1;
+    int c = fgetc(impl->file);
+    countRead(c != EOF ? 1 : 0);
+    return c;
+}
+
+int File::peek() {
+    if (!impl || impl->file == nullptr) return -1;
+    int c = fgetc(impl->file);
+    if (c != EOF) ungetc(c, impl->file);
+    return c;
+}
+
+void File::flush() {
+    if (impl && impl->file != nullptr) fflush(impl->file);
+}
+
+size_t File::read(uint8_t* buf, size_t size) {
+    if (!impl || impl->file == nullptr) return 0;
+    size_t n = fread(buf, 1, size, impl->file);
+    countRead(n);
+    return n;
+}
+
+bool File::seek(uint32_t pos, SeekMode mode) {
+    if (!impl || impl->file == nullptr) return false;
+    statSeeks.fetch_add(1, std::memory_order_relaxed);
+    int whence = (mode == SeekCur) ? SEEK_CUR : (mode == SeekEnd) ? SEEK_END : SEEK_SET;
+    return fseek(impl->file, (long)pos, whence) == 0;
+}
+
+size_t File::position() const {
+    if (!impl || impl->file == nullptr) return 0;
+    long pos = ftell(impl->file);
+    return pos < 0 ? 0 : (size_t)pos;
+}
+
+size_t File::size() const {
+    if (!impl || impl->file == nullptr) return 0;
+    fflush(impl->file);
+    struct stat st;
+    return fstat(fileno(impl->file), &st) == 0 ? (size_t)st.st_size : 0;
+}
+
+void File::close() {
+    if (impl) impl->close();
+    impl.reset();
+}
+
+File::operator bool() const {
+    return impl && (impl->file != nullptr || impl->dir != nullptr);
+}
+
+const char* File::path() const {
+    return impl ? impl->path.c_str() : nullptr;
+}
+
+const char* File::name() const {
+    if (!impl) return nullptr;
+    size_t slash = impl->path.rfind('/');
+    return impl->path.c_str() + (slash == std::string::npos ? 0 : slash + 1);
+}
+
+bool File::isDirectory(void) {
+    return impl && impl->dir != nullptr;
+}
+
+File File::openNextFile(const char* mode) {
+    if (!impl || impl->dir == nullptr) return File();
+    struct dirent* entry;
+    while ((entry = readdir(impl->dir)) != nullptr) {
+        std::string name = entry->d_name;
+        if (name == "." || name == "..") continue;
+        std::string base = impl->path == "/" ? "" : impl->path;
+        return File(openHost(base + "/" + name, impl->host + "/" + name, mode));
+    }
+    return File();
+}
+
+void File::rewindDirectory(void) {
+    if (impl && impl->dir != nullptr) rewinddir(impl->dir);
+}
+
+// ----- FS -----
+
+std::string FS::hostPath(const char* path) const {
+    std::string p = path != nullptr ? path : "";
+    if (p.empty() || p[0] != '/') p = "/" + p;
+    return std::string(root()) + p;
+}
+
+File FS::open(const char* path, const char* mode, const bool create) {
+    (void)create;
+    return File(openHost(path, hostPath(path), mode));
+}
+
+bool FS::exists(const char* path) {
+    struct stat st;
+    return stat(hostPath(path).c_str(), &st) == 0;
+}
+
+bool FS::remove(const char* path) {
+    return unlink(hostPath(path).c_str()) == 0;
+}
+
+bool FS::rename(const char* pathFrom, const char* pathTo) {
+    std::string to = hostPath(pathTo);
+    makeParents(to);
+    return ::rename(hostPath(pathFrom).c_str(), to.c_str()) == 0;
+}
+
+bool FS::mkdir(const char* path) {
+    return ::mkdir(hostPath(path).c_str(), 0755) == 0 || errno == EEXIST;
+}
+
+bool FS::rmdir(const char* path) {
+    return ::rmdir(hostPath(path).c_str()) == 0;
+}
+
+}
+
+// ----- Stats -----
+
+namespace HalNative {
+
+FsStats fsStats() {
+    FsStats stats;
+    stats.opens = fs::statOpens.load(std::memory_order_relaxed);
+    stats.reads = fs::statReads.load(std::memory_order_relaxed);
+    stats.writes = fs::statWrites.load(std::memory_order_relaxed);
+    stats.seeks = fs::statSeeks.load(std::memory_order_relaxed);
+    stats.bytesRead = fs::statBytesRead.load(std::memory_order_relaxed);
+    stats.bytesWritten = fs::statBytesWritten.load(std::memory_order_relaxed);
+    return stats;
+}
+
+void resetFsStats() {
+    fs::statOpens.store(0, std::memory_order_relaxed);
+    fs::statReads.store(0, std::memory_order_relaxed);
+    fs::statWrites.store(0, std::memory_order_relaxed);
+    fs::statSeeks.store(0, std::memory_order_relaxed);
+    fs::statBytesRead.store(0, std::memory_order_relaxed);
+    fs::statBytesWritten.store(0, std::memory_order_relaxed);
+}
+
+}
+
+namespace fs {
+
+// ----- SPIFFS -----
+
+// Size of the default 1.5 MB SPIFFS partition, less metadata
+static const size_t SPIFFS_TOTAL_BYTES = 1378241;
+
+SPIFFSFS::SPIFFSFS() : FS(HalNative::spiffsRoot) {}
+
+bool SPIFFSFS::begin(bool formatOnFail, const char* basePath, uint8_t maxOpenFiles, const char* partitionLabel) {
+    (void)formatOnFail;
+    (void)basePath;
+    (void)maxOpenFiles;
+    (void)partitionLabel;
+    struct stat st;
+    return stat(HalNative::spiffsRoot(), &st) == 0 && S_ISDIR(st.st_mode);
+}
+
+static void removeTree(const std::string& dirPath, bool removeSelf) {
+    DIR* dir = opendir(dirPath.c_str());
+    if (dir == nullptr) return;
+    struct dirent* entry;
+    while ((entry = readdir(dir)) != nullptr) {
+        std::string name = entry->d_name;
+        if (name == "." || name == "..") continue;
+        std::string child = dirPath + "/" + name;
+        struct stat st;
+        if (stat(child.c_str(), &st) == 0 && S_ISDIR(st.st_mode)) {
+            removeTree(child, true);
+        } else {
+            unlink(child.c_str());
+        }
+    }
+    closedir(dir);
+    if (removeSelf) ::rmdir(dirPath.c_str());
+}
+
+static size_t treeBytes(const std::string& dirPath) {
+    DIR* dir = opendir(dirPath.c_str());
+    if (dir == nullptr) return 0;
+    size_t total = 0;
+    struct dirent* entry;
+    while ((entry = readdir(dir)) != nullptr) {
+        std::string name = entry->d_name;
+        if (name == "." || name == "..") continue;
+        std::string child = dirPath + "/" + name;
+        struct stat st;
+        if (stat(child.c_str(), &st) != 0) continue;
+        total += S_ISDIR(st.st_mode) ? treeBytes(child) : (size_t)st.st_size;
+    }
+    closedir(dir);
+    return total;
+}
+
+bool SPIFFSFS::format() {
+    removeTree(HalNative::spiffsRoot(), false);
+    return true;
+}
+
+size_t SPIFFSFS::totalBytes() {
+    return SPIFFS_TOTAL_BYTES;
+}
+
+size_t SPIFFSFS::usedBytes() {
+    return treeBytes(HalNative::spiffsRoot());
+}
+
+}
+
+fs::SPIFFSFS SPIFFS;
@@ -0,0 +1,294 @@
+#include "HTTPClient.h"
+
+HTTPClient::HTTPClient() {
+    this->client = nullptr;
+    this->ownedClient = nullptr;
+    this->port = 80;
+    this->reuse = true;
+    this->canReuse = false;
+    this->tcpTimeout = HTTPCLIENT_DEFAULT_TCP_TIMEOUT;
+    this->connectTimeout = 5000;
+}
+
+HTTPClient::~HTTPClient() {
+    if (client != nullptr) client->stop();
+    delete ownedClient;
+}
+
+bool HTTPClient::begin(WiFiClient& client, const String& url) {
+    if (this->client != nullptr && this->client != &client) {
+        this->client->stop();
+    }
+    this->client = &client;
+    headers.clear();
+    body = "";
+
+    String rest = url;
+    if (rest.startsWith("http://")) {
+        rest = rest.substring(7);
+    } else if (rest.indexOf("://") >= 0) {
+        return false;   // https and friends need TLS
+    }
+    int slash = rest.indexOf('/');
+    String authority = slash >= 0 ? rest.substring(0, slash) : rest;
+    uri = slash >= 0 ? rest.substring(slash) : String("/");
+    int colon = authority.indexOf(':');
+    if (colon >= 0) {
+        host = authority.substring(0, colon);
+        port = (uint16_t)authority.substring(colon + 1).toInt();
+    } else {
+        host = authority;
+        port = 80;
+    }
+    return host.length() > 0;
+}
+
+bool HTTPClient::begin(const String& url) {
+    if (ownedClient == nullptr) ownedClient = new WiFiClient();
+    return begin(*ownedClient, url);
+}
+
+void HTTPClient::end(void) {
+    if (client == nullptr) return;
+    if (!reuse || !canReuse) {
+        client->stop();
+    }
+    headers.clear();
+}
+
+bool HTTPClient::connected(void) {
+    return client != nullptr && client->connected();
+}
+
+void HTTPClient::addHeader(const String& name, const String& value) {
+    // Host / Content-Length / Connection are generated per request
+    if (name.equalsIgnoreCase("Connection") || name.equalsIgnoreCase("Content-Length") || name.equalsIgnoreCase("Host")) {
+        return;
+    }
+    Header header = {name, value};
+    headers.push_back(header);
+}
+
+int HTTPClient::GET() {
+    return sendRequest("GET");
+}
+
+int HTTPClient::POST(uint8_t* payload, size_t size) {
+    return sendRequest("POST", payload, size);
+}
+
+int HTTPClient::POST(const String& payload) {
+    return sendRequest("POST", (uint8_t*)payload.c_str(), payload.length());
+}
+
+int HTTPClient::PUT(uint8_t* payload, size_t size) {
+    return sendRequest("PUT", payload, size);
+}
+
+int HTTPClient::PUT(const String& payload) {
+    return sendRequest("PUT", (uint8_t*)payload.c_str(), payload.length());
+}
+
+int HTTPClient::PATCH(uint8_t* payload, size_t size) {
+    return sendRequest("PATCH", payload, size);
+}
+
+int HTTPClient::PATCH(const String& payload) {
+    return sendRequest("PATCH", (uint8_t*)payload.c_str(), payload.length());
+}
+
+int HTTPClient::sendRequest(const char* type, String payload) {
+    return sendRequest(type, (uint8_t*)payload.c_str(), payload.length());
+}
+
+bool HTTPClient::connect() {
+    if (client == nullptr) return false;
+    if (client->connected()) {
+        // Drop anything left over from the previous response
+        while (client->available() > 0) client->read();
+        return true;
+    }
+    return client->connect(host.c_str(), port, connectTimeout) == 1;
+}
+
+int HTTPClient::failed(int code) {
+    if (client != nullptr) client->stop();
+    canReuse = false;
+    return code;
+}
+
+int HTTPClient::sendRequest(const char* type, uint8_t* payload, size_t size) {
+    body = "";
+    canReuse = false;
+    if (!connect()) {
+        return failed(HTTPC_ERROR_CONNECTION_REFUSED);
+    }
+
+    String request = String(type) + " " + uri + " HTTP/1.1\r\n";
+    request += "Host: " + host;
+    if (port != 80) request += ":" + String(port);
+    request += "\r\n";
+    request += "User-Agent: ESP32HTTPClient\r\n";
+    request += reuse ? "Connection: keep-alive\r\n" : "Connection: close\r\n";
+    if (payload != nullptr || size > 0 || strcmp(type, "POST") == 0 || strcmp(type, "PUT") == 0) {
+        request += "Content-Length: " + String((unsigned long)size) + "\r\n";
+    }
+    for (size_t i = 0; i < headers.size(); i++) {
+        request += headers[i].name + ": " + headers[i].value + "\r\n";
+    }
+    request += "\r\n";
+
+    client->setTimeout(tcpTimeout);
+    if (client->write((const uint8_t*)request.c_str(), request.length()) != request.length()) {
+        return failed(HTTPC_ERROR_SEND_HEADER_FAILED);
+    }
+    if (size > 0 && client->write(payload, size) != size) {
+        return failed(HTTPC_ERROR_SEND_PAYLOAD_FAILED);
+    }
+    return readResponse();
+}
+
+// One CRLF-terminated line, without the terminator
+bool HTTPClient::readLine(String& line) {
+    line = "";
+    uint32_t start = millis();
+    while (millis() - start < tcpTimeout) {
+        int c = client->read();
+        if (c < 0) {
+            if (!client->connected()) return false;
+            client->waitReadable(tcpTimeout);
+            continue;
+        }
+        if (c == '\n') {
+            if (line.endsWith("\r")) line.remove(line.length() - 1);
+            return true;
+        }
+        line += (char)c;
+    }
+    return false;
+}
+
+bool HTTPClient::readBytes(String& out, size_t count) {
+    uint8_t buffer[512];
+    uint32_t start = millis();
+    while (count > 0 && millis() - start < tcpTimeout) {
+        int n = client->read(buffer, count < sizeof(buffer) ? count : sizeof(buffer));
+        if (n > 0) {
+            out.concat((const char*)buffer, n);
+            count -= n;
+            start = millis();
+        } else if (n < 0) {
+            return false;
+        } else {
+            client->waitReadable(tcpTimeout);
+        }
+    }
+    return count == 0;
+}
+
+int HTTPClient::readResponse() {
+    String line;
+    int code = 0;
+    long contentLength = -1;
+    bool chunked = false;
+    bool keepAlive = true;
+
+    // Status line and headers; 1xx responses are skipped
+    do {
+        if (!readLine(line)) {
+            return failed(client->connected() ? HTTPC_ERROR_READ_TIMEOUT : HTTPC_ERROR_CONNECTION_LOST);
+        }
+        if (!line.startsWith("HTTP/1.")) {
+            return failed(HTTPC_ERROR_NO_HTTP_SERVER);
+        }
+        code = line.substring(9, 12).toInt();
+        keepAlive = !line.startsWith("HTTP/1.0");
+        while (readLine(line) && line.length() > 0) {
+            int colon = line.indexOf(':');
+            if (colon < 0) continue;
+            String name = line.substring(0, colon);
+            String value = line.substring(colon + 1);
+            value.trim();
+            name.toLowerCase();
+            if (name == "content-length") {
+                contentLength = value.toInt();
+            } else if (name == "transfer-encoding") {
+                value.toLowerCase();
+                chunked = value.indexOf("chunked") >= 0;
+            } else if (name == "connection") {
+                value.toLowerCase();
+                keepAlive = value != "close";
+            }
+        }
+    } while (code >= 100 && code < 200);
+
+    if (code <= 0) {
+        return failed(HTTPC_ERROR_NO_HTTP_SERVER);
+    }
+
+    if (chunked) {
+        while (true) {
+            if (!readLine(line)) return failed(HTTPC_ERROR_READ_TIMEOUT);
+            long chunk = strtol(line.c_str(), nullptr, 16);
+            if (chunk <= 0) {
+                while (readLine(line) && line.length() > 0) {}   // Trailers
+                break;
+            }
+            if (!readBytes(body, (size_t)chunk) || !readLine(line)) {
+                return failed(HTTPC_ERROR_READ_TIMEOUT);
+            }
+        }
+    } else if (contentLength >= 0) {
+        if (!readBytes(body, (size_t)contentLength)) {
+            return failed(HTTPC_ERROR_READ_TIMEOUT);
+        }
+    } else if (code != HTTP_CODE_NO_CONTENT && code != HTTP_CODE_NOT_MODIFIED) {
+        // No length: the body runs until the server closes
+        uint8_t buffer[512];
+        uint32_t start = millis();
+        while (millis() - start < tcpTimeout) {
+            int n = client->read(buffer, sizeof(buffer));
+            if (n > 0) {
+                body.concat((const char*)buffer, n);
+                start = millis();
+            } else if (n < 0) {
+                break;
+            } else {
+                client->waitReadable(tcpTimeout);
+            }
+        }
+        keepAlive = false;
+    }
+
+    canReuse = keepAlive;
+    return code;
+}
+
+String HTTPClient::errorToString(int error) {
+    switch (error) {
+        case HTTPC_ERROR_CONNECTION_REFUSED:
+            return F("connection refused");
+        case HTTPC_ERROR_SEND_HEADER_FAILED:
+            return F("send header failed");
+        case HTTPC_ERROR_SEND_PAYLOAD_FAILED:
+            return F("send payload failed");
+        case HTTPC_ERROR_NOT_CONNECTED:
+            return F("not connected");
+        case HTTPC_ERROR_CONNECTION_LOST:
+            return F("connection lost");
+        case HTTPC_ERROR_NO_STREAM:
+            return F("no stream");
+        case HTTPC_ERROR_NO_HTTP_SERVER:
+            return F("no HTTP server");
+        case HTTPC_ERROR_TOO_LESS_RAM:
+            return F("too less ram");
+        case HTTPC_ERROR_ENCODING:
+            return F("Transfer-Encoding not supported");
+        case HTTPC_ERROR_STREAM_WRITE:
+            return F("Stream write error");
+        case HTTPC_ERROR_READ_TIMEOUT:
+            return F("read Timeout");
+        default:
+            return String();
+    }
+}
@@ -0,0 +1,103 @@
+#ifndef HTTPClient_H_
+#define HTTPClient_H_
+
+#include <Arduino.h>
+#include <WiFiClient.h>
+#include <vector>
+
+#define HTTPCLIENT_DEFAULT_TCP_TIMEOUT (5000)
+
+#define HTTPC_ERROR_CONNECTION_REFUSED  (-1)
+#define HTTPC_ERROR_SEND_HEADER_FAILED  (-2)
+#define HTTPC_ERROR_SEND_PAYLOAD_FAILED (-3)
+#define HTTPC_ERROR_NOT_CONNECTED       (-4)
+#define HTTPC_ERROR_CONNECTION_LOST     (-5)
+#define HTTPC_ERROR_NO_STREAM           (-6)
+#define HTTPC_ERROR_NO_HTTP_SERVER      (-7)
+#define HTTPC_ERROR_TOO_LESS_RAM        (-8)
+#define HTTPC_ERROR_ENCODING            (-9)
+#define HTTPC_ERROR_STREAM_WRITE        (-10)
+#define HTTPC_ERROR_READ_TIMEOUT        (-11)
+
+typedef enum {
+    HTTP_CODE_CONTINUE = 100,
+    HTTP_CODE_OK = 200,
+    HTTP_CODE_CREATED = 201,
+    HTTP_CODE_NO_CONTENT = 204,
+    HTTP_CODE_MOVED_PERMANENTLY = 301,
+    HTTP_CODE_FOUND = 302,
+    HTTP_CODE_NOT_MODIFIED = 304,
+    HTTP_CODE_BAD_REQUEST = 400,
+    HTTP_CODE_UNAUTHORIZED = 401,
+    HTTP_CODE_FORBIDDEN = 403,
+    HTTP_CODE_NOT_FOUND = 404,
+    HTTP_CODE_METHOD_NOT_ALLOWED = 405,
+    HTTP_CODE_CONFLICT = 409,
+    HTTP_CODE_UNPROCESSABLE_ENTITY = 422,
+    HTTP_CODE_TOO_MANY_REQUESTS = 429,
+    HTTP_CODE_INTERNAL_SERVER_ERROR = 500,
+    HTTP_CODE_SERVICE_UNAVAILABLE = 503
+} t_http_codes;
+
+// HTTP/1.1 client with the ESP32 core's API and keep-alive behaviour:
+// with setReuse(true) the socket survives end() unless the server said
+// "Connection: close", and the next begin() on the same client skips the
+// handshake. The body is read in full before the status code is returned,
+// so getString() never blocks. Plain http:// only.
+class HTTPClient {
+public:
+    HTTPClient();
+    ~HTTPClient();
+
+    bool begin(WiFiClient& client, const String& url);
+    bool begin(const String& url);
+    void end(void);
+    bool connected(void);
+
+    void setReuse(bool reuse) { this->reuse = reuse; }
+    void setTimeout(uint16_t timeout) { this->tcpTimeout = timeout; }
+    void setConnectTimeout(int32_t connectTimeout) { this->connectTimeout = connectTimeout; }
+    void addHeader(const String& name, const String& value);
+
+    int GET();
+    int POST(uint8_t* payload, size_t size);
+    int POST(const String& payload);
+    int PUT(uint8_t* payload, size_t size);
+    int PUT(const String& payload);
+    int PATCH(uint8_t* payload, size_t size);
+    int PATCH(const String& payload);
+    int sendRequest(const char* type, String payload);
+    int sendRequest(const char* type, uint8_t* payload = NULL, size_t size = 0);
+
+    int getSize(void) { return (int)body.length(); }
+    String getString(void) { return body; }
+    WiFiClient& getStream(void) { return *client; }
+
+    static String errorToString(int error);
+
+private:
+    struct Header {
+        String name;
+        String value;
+    };
+
+    WiFiClient* client;
+    WiFiClient* ownedClient;    // begin(url) without a client
+    String host;
+    uint16_t port;
+    String uri;
+    std::vector<Header> headers;
+    bool reuse;
+    bool canReuse;              // Server didn't ask to close
+    uint16_t tcpTimeout;
+    int32_t connectTimeout;
+    String body;
+
+    bool connect();
+    int readResponse();
+    bool readLine(String& line);
+    bool readBytes(String& out, size_t count);
+    int failed(int code);
+};
+
+#endif
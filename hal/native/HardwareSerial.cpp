@@ -0,0 +1,41 @@
+#include "HardwareSerial.h"
+#include <stdio.h>
+
+HardwareSerial Serial;
+
+int HardwareSerial::available() {
+    std::lock_guard<std::mutex> guard(inputLock);
+    return (int)input.size();
+}
+
+int HardwareSerial::read() {
+    std::lock_guard<std::mutex> guard(inputLock);
+    if (input.empty()) return -1;
+    int c = (uint8_t)input[0];
+    input.erase(0, 1);
+    return c;
+}
+
+int HardwareSerial::peek() {
+    std::lock_guard<std::mutex> guard(inputLock);
+    return input.empty() ? -1 : (uint8_t)input[0];
+}
+
+size_t HardwareSerial::write(uint8_t c) {
+    return fwrite(&c, 1, 1, stdout);
+}
+
+size_t HardwareSerial::write(const uint8_t* buffer, size_t size) {
+    // One stdio call per print(), so lines from different tasks interleave
+    // at print() granularity like they do on the UART
+    return fwrite(buffer, 1, size, stdout);
+}
+
+void HardwareSerial::flush() {
+    fflush(stdout);
+}
+
+void HardwareSerial::inject(const char* data, size_t length) {
+    std::lock_guard<std::mutex> guard(inputLock);
+    input.append(data, length);
+}
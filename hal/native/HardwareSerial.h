@@ -0,0 +1,36 @@
+#ifndef HARDWARESERIAL_H
+#define HARDWARESERIAL_H
+
+#include <mutex>
+#include <string>
+#include "Stream.h"
+
+// Serial on the host: output goes to stdout, input is what the --script
+// "serial" lines and stdin feed in (see hal_native.h)
+class HardwareSerial : public Stream {
+public:
+    void begin(unsigned long baud) { (void)baud; }
+    void end() {}
+
+    int available() override;
+    int read() override;
+    int peek() override;
+
+    size_t write(uint8_t c) override;
+    size_t write(const uint8_t* buffer, size_t size) override;
+    using Print::write;
+    void flush() override;
+
+    // Queue input as if it had arrived over UART
+    void inject(const char* data, size_t length);
+
+    operator bool() const { return true; }
+
+private:
+    std::mutex inputLock;
+    std::string input;
+};
+
+extern HardwareSerial Serial;
+
+#endif
@@ -0,0 +1,26 @@
+#ifndef IPAddress_h
+#define IPAddress_h
+
+#include <Arduino.h>
+
+class IPAddress : public Printable {
+public:
+    IPAddress() { bytes[0] = bytes[1] = bytes[2] = bytes[3] = 0; }
+    IPAddress(uint8_t a, uint8_t b, uint8_t c, uint8_t d) { bytes[0] = a; bytes[1] = b; bytes[2] = c; bytes[3] = d; }
+
+    uint8_t operator[](int index) const { return bytes[index & 3]; }
+    bool operator==(const IPAddress& other) const { return memcmp(bytes, other.bytes, 4) == 0; }
+    bool operator!=(const IPAddress& other) const { return !(*this == other); }
+
+    String toString() const {
+        char buf[16];
+        snprintf(buf, sizeof(buf), "%u.%u.%u.%u", bytes[0], bytes[1], bytes[2], bytes[3]);
+        return String(buf);
+    }
+    size_t printTo(Print& p) const override { return p.print(toString()); }
+
+private:
+    uint8_t bytes[4];
+};
+
+#endif
@@ -0,0 +1,79 @@
+#include "Print.h"
+#include <math.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <string.h>
+
+size_t Print::strlenSafe(const char* s) {
+    return strlen(s);
+}
+
+size_t Print::write(const uint8_t* buffer, size_t size) {
+    size_t n = 0;
+    while (size--) {
+        if (write(*buffer++) == 0) break;
+        n++;
+    }
+    return n;
+}
+
+size_t Print::printf(const char* format, ...) {
+    char small[128];
+    va_list args;
+    va_start(args, format);
+    int len = vsnprintf(small, sizeof(small), format, args);
+    va_end(args);
+    if (len < 0) return 0;
+    if ((size_t)len < sizeof(small)) return write((const uint8_t*)small, len);
+
+    char* big = new char[len + 1];
+    va_start(args, format);
+    vsnprintf(big, len + 1, format, args);
+    va_end(args);
+    size_t n = write((const uint8_t*)big, len);
+    delete[] big;
+    return n;
+}
+
+size_t Print::printNumber(unsigned long long n, int base) {
+    if (base < 2) base = 10;
+    char buf[66];
+    char* p = &buf[sizeof(buf) - 1];
+    *p = '\0';
+    do {
+        int d = (int)(n % base);
+        *--p = (char)(d < 10 ? '0' + d : 'A' + d - 10);
+        n /= base;
+    } while (n != 0);
+    return write(p);
+}
+
+size_t Print::print(long value, int base) {
+    return print((long long)value, base);
+}
+
+size_t Print::print(unsigned long value, int base) {
+    return printNumber(value, base);
+}
+
+size_t Print::print(long long value, int base) {
+    if (base == 0) return write((uint8_t)value);
+    if (base == 10 && value < 0) {
+        size_t n = write('-');
+        return n + printNumber(0ULL - (unsigned long long)value, 10);
+    }
+    return printNumber((unsigned long long)value, base);
+}
+
+size_t Print::print(unsigned long long value, int base) {
+    if (base == 0) return write((uint8_t)value);
+    return printNumber(value, base);
+}
+
+size_t Print::print(double value, int digits) {
+    if (isnan(value)) return write("nan");
+    if (isinf(value)) return write("inf");
+    char buf[64];
+    snprintf(buf, sizeof(buf), "%.*f", digits < 0 ? 0 : digits, value);
+    return write(buf);
+}
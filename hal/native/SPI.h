@@ -0,0 +1,27 @@
+#ifndef _SPI_H_INCLUDED
+#define _SPI_H_INCLUDED
+
+#include <Arduino.h>
+
+#define SPI_MODE0 0x00
+#define SPI_MODE1 0x01
+#define SPI_MODE2 0x02
+#define SPI_MODE3 0x03
+
+// No bus on the host: the panel is memory (see Adafruit_ST7789.h, --spi-mhz)
+class SPIClass {
+public:
+    void begin(int8_t sck = -1, int8_t miso = -1, int8_t mosi = -1, int8_t ss = -1) {
+        (void)sck; (void)miso; (void)mosi; (void)ss;
+    }
+    void end() {}
+    void setFrequency(uint32_t freq) { frequency = freq; }
+    uint32_t getFrequency() const { return frequency; }
+
+private:
+    uint32_t frequency = 1000000;
+};
+
+extern SPIClass SPI;
+
+#endif
@@ -0,0 +1,25 @@
+#ifndef _SPIFFS_H_
+#define _SPIFFS_H_
+
+#include "FS.h"
+
+namespace fs {
+
+// SPIFFS in the --spiffs directory (see hal_native.h). Flat names with
+// slashes map to subdirectories there.
+class SPIFFSFS : public FS {
+public:
+    SPIFFSFS();
+    bool begin(bool formatOnFail = false, const char* basePath = "/spiffs", uint8_t maxOpenFiles = 10,
+               const char* partitionLabel = NULL);
+    bool format();
+    size_t totalBytes();
+    size_t usedBytes();
+    void end() {}
+};
+
+}
+
+extern fs::SPIFFSFS SPIFFS;
+
+#endif
@@ -0,0 +1,29 @@
+#ifndef STREAM_H
+#define STREAM_H
+
+#include "Print.h"
+
+// Arduino Stream: blocking reads give up after the timeout (1 s default)
+class Stream : public Print {
+public:
+    Stream() : timeoutMs(1000) {}
+
+    virtual int available() = 0;
+    virtual int read() = 0;
+    virtual int peek() = 0;
+
+    void setTimeout(unsigned long timeout) { timeoutMs = timeout; }
+    unsigned long getTimeout() const { return timeoutMs; }
+
+    size_t readBytes(char* buffer, size_t length);
+    size_t readBytes(uint8_t* buffer, size_t length) { return readBytes((char*)buffer, length); }
+    String readString();
+    String readStringUntil(char terminator);
+
+protected:
+    unsigned long timeoutMs;
+
+    int timedRead();
+};
+
+#endif
@@ -0,0 +1,181 @@
+#include "WString.h"
+#include <ctype.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static std::string formatUnsigned(unsigned long long value, unsigned char base) {
+    if (base < 2 || base > 36) base = 10;
+    char digits[66];
+    int pos = sizeof(digits) - 1;
+    digits[pos] = '\0';
+    do {
+        int d = (int)(value % base);
+        digits[--pos] = (char)(d < 10 ? '0' + d : 'a' + d - 10);
+        value /= base;
+    } while (value != 0);
+    return std::string(digits + pos);
+}
+
+// Negative numbers only get a sign in base 10 (two's complement otherwise, like ltoa)
+static std::string formatSigned(long long value, unsigned char base, unsigned long long mask) {
+    if (base == 10 && value < 0) {
+        return "-" + formatUnsigned(0ULL - (unsigned long long)value, 10);
+    }
+    return formatUnsigned((unsigned long long)value & mask, base);
+}
+
+static std::string formatFloat(double value, unsigned int decimalPlaces) {
+    char buf[64];
+    snprintf(buf, sizeof(buf), "%.*f", (int)decimalPlaces, value);
+    return std::string(buf);
+}
+
+String::String(unsigned char value, unsigned char base) : buffer(formatUnsigned(value, base)) {}
+String::String(int value, unsigned char base) : buffer(formatSigned(value, base, 0xFFFFFFFFULL)) {}
+String::String(unsigned int value, unsigned char base) : buffer(formatUnsigned(value, base)) {}
+String::String(long value, unsigned char base) : buffer(formatSigned(value, base, (unsigned long)-1)) {}
+String::String(unsigned long value, unsigned char base) : buffer(formatUnsigned(value, base)) {}
+String::String(long long value, unsigned char base) : buffer(formatSigned(value, base, ~0ULL)) {}
+String::String(unsigned long long value, unsigned char base) : buffer(formatUnsigned(value, base)) {}
+String::String(float value, unsigned int decimalPlaces) : buffer(formatFloat(value, decimalPlaces)) {}
+String::String(double value, unsigned int decimalPlaces) : buffer(formatFloat(value, decimalPlaces)) {}
+
+bool String::equalsIgnoreCase(const String& s) const {
+    if (buffer.size() != s.buffer.size()) return false;
+    for (size_t i = 0; i < buffer.size(); i++) {
+        if (tolower((unsigned char)buffer[i]) != tolower((unsigned char)s.buffer[i])) return false;
+    }
+    return true;
+}
+
+bool String::startsWith(const String& prefix, unsigned int offset) const {
+    if (offset > buffer.size() || prefix.buffer.size() > buffer.size() - offset) return false;
+    return buffer.compare(offset, prefix.buffer.size(), prefix.buffer) == 0;
+}
+
+bool String::endsWith(const String& suffix) const {
+    if (suffix.buffer.size() > buffer.size()) return false;
+    return buffer.compare(buffer.size() - suffix.buffer.size(), suffix.buffer.size(), suffix.buffer) == 0;
+}
+
+char& String::operator[](unsigned int index) {
+    static char dummy;
+    if (index >= buffer.size()) {
+        dummy = 0;
+        return dummy;
+    }
+    return buffer[index];
+}
+
+void String::getBytes(unsigned char* buf, unsigned int bufsize, unsigned int index) const {
+    if (bufsize == 0 || buf == nullptr) return;
+    if (index >= buffer.size()) {
+        buf[0] = 0;
+        return;
+    }
+    unsigned int n = bufsize - 1;
+    if (n > buffer.size() - index) n = buffer.size() - index;
+    memcpy(buf, buffer.data() + index, n);
+    buf[n] = 0;
+}
+
+int String::indexOf(char ch, unsigned int fromIndex) const {
+    if (fromIndex >= buffer.size()) return -1;
+    size_t at = buffer.find(ch, fromIndex);
+    return at == std::string::npos ? -1 : (int)at;
+}
+
+int String::indexOf(const String& str, unsigned int fromIndex) const {
+    if (fromIndex >= buffer.size()) return -1;
+    size_t at = buffer.find(str.buffer, fromIndex);
+    return at == std::string::npos ? -1 : (int)at;
+}
+
+int String::lastIndexOf(char ch, unsigned int fromIndex) const {
+    if (fromIndex >= buffer.size()) return -1;
+    size_t at = buffer.rfind(ch, fromIndex);
+    return at == std::string::npos ? -1 : (int)at;
+}
+
+int String::lastIndexOf(const String& str, unsigned int fromIndex) const {
+    if (str.buffer.empty() || buffer.empty() || str.buffer.size() > buffer.size()) return -1;
+    if (fromIndex >= buffer.size()) fromIndex = buffer.size() - 1;
+    size_t at = buffer.rfind(str.buffer, fromIndex);
+    return at == std::string::npos ? -1 : (int)at;
+}
+
+String String::substring(unsigned int beginIndex, unsigned int endIndex) const {
+    if (beginIndex > endIndex) {
+        unsigned int t = beginIndex;
+        beginIndex = endIndex;
+        endIndex = t;
+    }
+    if (beginIndex >= buffer.size()) return String();
+    if (endIndex > buffer.size()) endIndex = buffer.size();
+    return String(buffer.substr(beginIndex, endIndex - beginIndex));
+}
+
+void String::replace(char find, char replace) {
+    for (size_t i = 0; i < buffer.size(); i++) {
+        if (buffer[i] == find) buffer[i] = replace;
+    }
+}
+
+void String::replace(const String& find, const String& replace) {
+    if (find.buffer.empty()) return;
+    size_t at = 0;
+    while ((at = buffer.find(find.buffer, at)) != std::string::npos) {
+        buffer.replace(at, find.buffer.size(), replace.buffer);
+        at += replace.buffer.size();
+    }
+}
+
+void String::remove(unsigned int index, unsigned int count) {
+    if (index >= buffer.size()) return;
+    if (count > buffer.size() - index) count = buffer.size() - index;
+    buffer.erase(index, count);
+}
+
+void String::toLowerCase() {
+    for (size_t i = 0; i < buffer.size(); i++) buffer[i] = (char)tolower((unsigned char)buffer[i]);
+}
+
+void String::toUpperCase() {
+    for (size_t i = 0; i < buffer.size(); i++) buffer[i] = (char)toupper((unsigned char)buffer[i]);
+}
+
+void String::trim() {
+    size_t begin = 0;
+    while (begin < buffer.size() && isspace((unsigned char)buffer[begin])) begin++;
+    size_t end = buffer.size();
+    while (end > begin && isspace((unsigned char)buffer[end - 1])) end--;
+    buffer = buffer.substr(begin, end - begin);
+}
+
+long String::toInt() const {
+    return atol(buffer.c_str());
+}
+
+float String::toFloat() const {
+    return (float)atof(buffer.c_str());
+}
+
+double String::toDouble() const {
+    return atof(buffer.c_str());
+}
+
+String operator+(const String& lhs, const String& rhs) { String s(lhs); s.concat(rhs); return s; }
+String operator+(const String& lhs, const char* rhs) { String s(lhs); s.concat(rhs); return s; }
+String operator+(const char* lhs, const String& rhs) { String s(lhs); s.concat(rhs); return s; }
+String operator+(const String& lhs, char rhs) { String s(lhs); s.concat(rhs); return s; }
+String operator+(char lhs, const String& rhs) { String s(lhs); s.concat(rhs); return s; }
+String operator+(const String& lhs, unsigned char rhs) { String s(lhs); s.concat(rhs); return s; }
+String operator+(const String& lhs, int rhs) { String s(lhs); s.concat(rhs); return s; }
+String operator+(const String& lhs, unsigned int rhs) { String s(lhs); s.concat(rhs); return s; }
+String operator+(const String& lhs, long rhs) { String s(lhs); s.concat(rhs); return s; }
+String operator+(const String& lhs, unsigned long rhs) { String s(lhs); s.concat(rhs); return s; }
+String operator+(const String& lhs, long long rhs) { String s(lhs); s.concat(rhs); return s; }
+String operator+(const String& lhs, unsigned long long rhs) { String s(lhs); s.concat(rhs); return s; }
+String operator+(const String& lhs, float rhs) { String s(lhs); s.concat(rhs); return s; }
+String operator+(const String& lhs, double rhs) { String s(lhs); s.concat(rhs); return s; }
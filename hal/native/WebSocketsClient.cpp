@@ -0,0 +1,244 @@
+#include "WebSocketsClient.h"
+
+static String base64(const uint8_t* data, size_t length) {
+    static const char alphabet[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+    String out;
+    for (size_t i = 0; i < length; i += 3) {
+        uint32_t n = (uint32_t)data[i] << 16;
+        if (i + 1 < length) n |= (uint32_t)data[i + 1] << 8;
+        if (i + 2 < length) n |= data[i + 2];
+        out += alphabet[(n >> 18) & 0x3F];
+        out += alphabet[(n >> 12) & 0x3F];
+        out += (i + 1 < length) ? alphabet[(n >> 6) & 0x3F] : '=';
+        out += (i + 2 < length) ? alphabet[n & 0x3F] : '=';
+    }
+    return out;
+}
+
+WebSocketsClient::WebSocketsClient() {
+    this->cbEvent = nullptr;
+    this->port = 0;
+    this->reconnectInterval = 500;
+    this->lastAttemptMs = 0;
+    this->attempted = false;
+    this->connected = false;
+    this->messageOpcode = 0;
+}
+
+WebSocketsClient::~WebSocketsClient() {
+    client.stop();
+}
+
+void WebSocketsClient::begin(const char* host, uint16_t port, const char* url, const char* protocol) {
+    this->host = host;
+    this->port = port;
+    this->url = url;
+    this->protocol = protocol != nullptr ? protocol : "";
+    this->attempted = false;
+}
+
+void WebSocketsClient::runCbEvent(WStype_t type, uint8_t* payload, size_t length) {
+    if (cbEvent != nullptr) cbEvent(type, payload, length);
+}
+
+void WebSocketsClient::loop(void) {
+    if (host.length() == 0) return;
+
+    if (!connected) {
+        if (attempted && millis() - lastAttemptMs < reconnectInterval) return;
+        attempted = true;
+        lastAttemptMs = millis();
+        if (!connectAndHandshake()) {
+            dropConnection();
+            return;
+        }
+        connected = true;
+        runCbEvent(WStype_CONNECTED, (uint8_t*)url.c_str(), url.length());
+    }
+
+    uint8_t buffer[1024];
+    int n;
+    while ((n = client.read(buffer, sizeof(buffer))) > 0) {
+        rx.append((const char*)buffer, n);
+    }
+    while (connected && parseFrame()) {}
+    if (connected && n < 0) {
+        // Peer closed without a close frame
+        dropConnection();
+    }
+}
+
+bool WebSocketsClient::connectAndHandshake() {
+    rx.clear();
+    message.clear();
+    if (!client.connect(host.c_str(), port)) {
+        return false;
+    }
+
+    uint8_t nonce[16];
+    for (int i = 0; i < 16; i++) nonce[i] = (uint8_t)random(256);
+    String request = "GET " + url + " HTTP/1.1\r\n";
+    request += "Host: " + host + ":" + String((unsigned int)port) + "\r\n";
+    request += "Connection: Upgrade\r\n";
+    request += "Upgrade: websocket\r\n";
+    request += "Sec-WebSocket-Version: 13\r\n";
+    request += "Sec-WebSocket-Key: " + base64(nonce, sizeof(nonce)) + "\r\n";
+    if (protocol.length() > 0) request += "Sec-WebSocket-Protocol: " + protocol + "\r\n";
+    request += "User-Agent: arduino-WebSocket-Client\r\n\r\n";
+    {
+        std::lock_guard<std::mutex> guard(sendLock);
+        if (client.write((const uint8_t*)request.c_str(), request.length()) != request.length()) {
+            return false;
+        }
+    }
+
+    // Response headers; anything after them is the first frame
+    uint32_t start = millis();
+    size_t end;
+    while ((end = rx.find("\r\n\r\n")) == std::string::npos) {
+        if (millis() - start >= HANDSHAKE_TIMEOUT_MS) return false;
+        uint8_t buffer[512];
+        int n = client.read(buffer, sizeof(buffer));
+        if (n < 0) return false;
+        if (n == 0) {
+            client.waitReadable(HANDSHAKE_TIMEOUT_MS - (millis() - start));
+            continue;
+        }
+        rx.append((const char*)buffer, n);
+    }
+    bool upgraded = rx.compare(0, 12, "HTTP/1.1 101") == 0;
+    rx.erase(0, end + 4);
+    return upgraded;
+}
+
+bool WebSocketsClient::parseFrame() {
+    if (rx.size() < 2) return false;
+    const uint8_t* p = (const uint8_t*)rx.data();
+    bool fin = (p[0] & 0x80) != 0;
+    uint8_t opcode = p[0] & 0x0F;
+    bool masked = (p[1] & 0x80) != 0;
+    uint64_t length = p[1] & 0x7F;
+    size_t header = 2;
+    if (length == 126) {
+        if (rx.size() < 4) return false;
+        length = ((uint64_t)p[2] << 8) | p[3];
+        header = 4;
+    } else if (length == 127) {
+        if (rx.size() < 10) return false;
+        length = 0;
+        for (int i = 0; i < 8; i++) length = (length << 8) | p[2 + i];
+        header = 10;
+    }
+    size_t maskAt = header;
+    if (masked) header += 4;
+    if (rx.size() < header + length) return false;
+
+    std::string payload = rx.substr(header, (size_t)length);
+    if (masked) {
+        for (size_t i = 0; i < payload.size(); i++) payload[i] ^= rx[maskAt + (i & 3)];
+    }
+    rx.erase(0, header + (size_t)length);
+    handleFrame(opcode, fin, payload);
+    return true;
+}
+
+void WebSocketsClient::handleFrame(uint8_t opcode, bool fin, std::string& payload) {
+    switch (opcode) {
+        case OPCODE_PING:
+            sendFrame(OPCODE_PONG, (const uint8_t*)payload.data(), payload.size());
+            runCbEvent(WStype_PING, (uint8_t*)&payload[0], payload.size());
+            return;
+        case OPCODE_PONG:
+            runCbEvent(WStype_PONG, (uint8_t*)&payload[0], payload.size());
+            return;
+        case OPCODE_CLOSE:
+            sendFrame(OPCODE_CLOSE, (const uint8_t*)payload.data(), payload.size() >= 2 ? 2 : 0);
+            dropConnection();
+            return;
+        case OPCODE_TEXT:
+        case OPCODE_BINARY:
+            messageOpcode = opcode;
+            message = payload;
+            break;
+        case OPCODE_CONTINUATION:
+            message += payload;
+            break;
+        default:
+            runCbEvent(WStype_ERROR, nullptr, 0);
+            dropConnection();
+            return;
+    }
+    if (!fin) return;
+
+    size_t length = message.size();
+    message.push_back('\0');   // The library always leaves a terminator after the payload
+    runCbEvent(messageOpcode == OPCODE_TEXT ? WStype_TEXT : WStype_BIN, (uint8_t*)&message[0], length);
+    message.clear();
+}
+
+bool WebSocketsClient::sendFrame(uint8_t opcode, const uint8_t* payload, size_t length) {
+    uint8_t header[14];
+    size_t headerLength = 2;
+    header[0] = 0x80 | opcode;
+    if (length < 126) {
+        header[1] = 0x80 | (uint8_t)length;
+    } else if (length <= 0xFFFF) {
+        header[1] = 0x80 | 126;
+        header[2] = (uint8_t)(length >> 8);
+        header[3] = (uint8_t)length;
+        headerLength = 4;
+    } else {
+        header[1] = 0x80 | 127;
+        for (int i = 0; i < 8; i++) header[2 + i] = (uint8_t)((uint64_t)length >> (56 - 8 * i));
+        headerLength = 10;
+    }
+    uint8_t* mask = header + headerLength;
+    for (int i = 0; i < 4; i++) mask[i] = (uint8_t)random(256);
+    headerLength += 4;
+
+    std::string frame((const char*)header, headerLength);
+    frame.append((const char*)payload, length);
+    for (size_t i = 0; i < length; i++) frame[headerLength + i] ^= mask[i & 3];
+
+    std::lock_guard<std::mutex> guard(sendLock);
+    return client.write((const uint8_t*)frame.data(), frame.size()) == frame.size();
+}
+
+bool WebSocketsClient::sendTXT(uint8_t* payload, size_t length, bool headerToPayload) {
+    (void)headerToPayload;
+    if (!connected) return false;
+    if (length == 0 && payload != nullptr) length = strlen((const char*)payload);
+    return sendFrame(OPCODE_TEXT, payload, length);
+}
+
+bool WebSocketsClient::sendBIN(uint8_t* payload, size_t length, bool headerToPayload) {
+    (void)headerToPayload;
+    if (!connected) return false;
+    return sendFrame(OPCODE_BINARY, payload, length);
+}
+
+bool WebSocketsClient::sendPing(uint8_t* payload, size_t length) {
+    if (!connected) return false;
+    return sendFrame(OPCODE_PING, payload, length);
+}
+
+void WebSocketsClient::dropConnection() {
+    bool wasConnected = connected;
+    connected = false;
+    {
+        std::lock_guard<std::mutex> guard(sendLock);
+        client.stop();
+    }
+    rx.clear();
+    message.clear();
+    if (wasConnected) {
+        runCbEvent(WStype_DISCONNECTED, nullptr, 0);
+    }
+}
+
+void WebSocketsClient::disconnect(void) {
+    if (connected) {
+        sendFrame(OPCODE_CLOSE, nullptr, 0);
+    }
+    dropConnection();
+}
@@ -0,0 +1,90 @@
+#ifndef WEBSOCKETSCLIENT_H_
+#define WEBSOCKETSCLIENT_H_
+
+#include <Arduino.h>
+#include <WiFiClient.h>
+#include <mutex>
+#include <string>
+
+typedef enum {
+    WStype_ERROR,
+    WStype_DISCONNECTED,
+    WStype_CONNECTED,
+    WStype_TEXT,
+    WStype_BIN,
+    WStype_FRAGMENT_TEXT_START,
+    WStype_FRAGMENT_BIN_START,
+    WStype_FRAGMENT,
+    WStype_FRAGMENT_FIN,
+    WStype_PING,
+    WStype_PONG
+} WStype_t;
+
+// RFC 6455 client with the links2004 WebSockets API, as far as the firmware
+// uses it. loop() reconnects every setReconnectInterval() ms while down
+// and delivers whole messages (fragments are reassembled; TEXT payloads
+// are NUL-terminated and writable, as the library's are). Pings are
+// answered inside loop(). sendTXT/sendBIN may be called from any task.
+// The server's Sec-WebSocket-Accept is not checked.
+class WebSocketsClient {
+public:
+    typedef void (*WebSocketClientEvent)(WStype_t type, uint8_t* payload, size_t length);
+
+    WebSocketsClient();
+    ~WebSocketsClient();
+
+    void begin(const char* host, uint16_t port, const char* url = "/", const char* protocol = "arduino");
+    void begin(String host, uint16_t port, String url = "/", String protocol = "arduino") {
+        begin(host.c_str(), port, url.c_str(), protocol.c_str());
+    }
+    void onEvent(WebSocketClientEvent cbEvent) { this->cbEvent = cbEvent; }
+    void setReconnectInterval(unsigned long time) { this->reconnectInterval = time; }
+
+    void loop(void);
+
+    bool sendTXT(uint8_t* payload, size_t length = 0, bool headerToPayload = false);
+    bool sendTXT(const char* payload, size_t length = 0) { return sendTXT((uint8_t*)payload, length); }
+    bool sendTXT(String& payload) { return sendTXT((uint8_t*)payload.c_str(), payload.length()); }
+    bool sendBIN(uint8_t* payload, size_t length, bool headerToPayload = false);
+    bool sendBIN(const uint8_t* payload, size_t length) { return sendBIN((uint8_t*)payload, length); }
+    bool sendPing(uint8_t* payload = NULL, size_t length = 0);
+
+    void disconnect(void);
+    bool isConnected(void) { return connected; }
+
+private:
+    static const uint32_t HANDSHAKE_TIMEOUT_MS = 5000;
+
+    enum {
+        OPCODE_CONTINUATION = 0x0,
+        OPCODE_TEXT = 0x1,
+        OPCODE_BINARY = 0x2,
+        OPCODE_CLOSE = 0x8,
+        OPCODE_PING = 0x9,
+        OPCODE_PONG = 0xA
+    };
+
+    WiFiClient client;
+    std::mutex sendLock;
+    WebSocketClientEvent cbEvent;
+    String host;
+    uint16_t port;
+    String url;
+    String protocol;
+    unsigned long reconnectInterval;
+    unsigned long lastAttemptMs;
+    bool attempted;
+    bool connected;
+    std::string rx;             // Bytes received but not yet parsed
+    std::string message;        // Fragments of the message being reassembled
+    uint8_t messageOpcode;
+
+    bool connectAndHandshake();
+    bool sendFrame(uint8_t opcode, const uint8_t* payload, size_t length);
+    bool parseFrame();          // false = need more bytes
+    void handleFrame(uint8_t opcode, bool fin, std::string& payload);
+    void dropConnection();
+    void runCbEvent(WStype_t type, uint8_t* payload, size_t length);
+};
+
+#endif
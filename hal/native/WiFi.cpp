@@ -0,0 +1,231 @@
+#include "WiFi.h"
+#include "hal_native.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <sys/ioctl.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+WiFiClass WiFi;
+
+// ----- Station -----
+
+wl_status_t WiFiClass::begin(const char* ssid, const char* passphrase) {
+    currentMode = WIFI_STA;
+    connecting = true;
+    beginMs = millis();
+    network = -1;
+    result = WL_NO_SSID_AVAIL;
+    for (int i = 0; i < HalNative::networkCount(); i++) {
+        const HalNative::Network& n = HalNative::network(i);
+        if (n.ssid == ssid) {
+            network = i;
+            bool open = n.password.length() == 0;
+            result = (open || n.password == (passphrase != nullptr ? passphrase : "")) ? WL_CONNECTED : WL_CONNECT_FAILED;
+            break;
+        }
+    }
+    return WL_DISCONNECTED;
+}
+
+wl_status_t WiFiClass::status() {
+    if (connecting) {
+        if (millis() - beginMs < CONNECT_MS) {
+            return WL_DISCONNECTED;
+        }
+        connecting = false;
+    }
+    return result;
+}
+
+bool WiFiClass::disconnect(bool wifioff, bool eraseap) {
+    (void)eraseap;
+    connecting = false;
+    network = -1;
+    result = WL_DISCONNECTED;
+    if (wifioff) currentMode = WIFI_MODE_NULL;
+    return true;
+}
+
+int16_t WiFiClass::scanNetworks(bool async, bool show_hidden) {
+    (void)async;
+    (void)show_hidden;
+    scanCount = (int16_t)HalNative::networkCount();
+    return scanCount;
+}
+
+String WiFiClass::SSID(uint8_t i) {
+    return i < scanCount ? HalNative::network(i).ssid : String();
+}
+
+int32_t WiFiClass::RSSI(uint8_t i) {
+    return i < scanCount ? HalNative::network(i).rssi : 0;
+}
+
+wifi_auth_mode_t WiFiClass::encryptionType(uint8_t i) {
+    if (i >= scanCount) return WIFI_AUTH_OPEN;
+    return HalNative::network(i).password.length() == 0 ? WIFI_AUTH_OPEN : WIFI_AUTH_WPA2_PSK;
+}
+
+String WiFiClass::SSID() {
+    return (status() == WL_CONNECTED && network >= 0) ? HalNative::network(network).ssid : String();
+}
+
+int8_t WiFiClass::RSSI() {
+    return (status() == WL_CONNECTED && network >= 0) ? (int8_t)HalNative::network(network).rssi : 0;
+}
+
+IPAddress WiFiClass::localIP() {
+    return status() == WL_CONNECTED ? IPAddress(127, 0, 0, 1) : IPAddress();
+}
+
+// ----- TCP client -----
+
+struct WiFiSocket {
+    int fd;
+    uint8_t buffer[1436];   // One TCP segment, like the ESP32 client's rx buffer
+    size_t head;
+    size_t tail;
+    bool peerClosed;
+
+    WiFiSocket(int fd) : fd(fd), head(0), tail(0), peerClosed(false) {}
+    ~WiFiSocket() { if (fd >= 0) ::close(fd); }
+};
+
+WiFiClient::WiFiClient() {}
+
+WiFiClient::~WiFiClient() {}
+
+int WiFiClient::connect(const char* host, uint16_t port, int32_t timeoutMs) {
+    stop();
+    String target = HalNative::resolveHost(host);
+    char portText[8];
+    snprintf(portText, sizeof(portText), "%u", port);
+    struct addrinfo hints;
+    memset(&hints, 0, sizeof(hints));
+    hints.ai_family = AF_INET;
+    hints.ai_socktype = SOCK_STREAM;
+    struct addrinfo* addresses = nullptr;
+    if (getaddrinfo(target.c_str(), portText, &hints, &addresses) != 0 || addresses == nullptr) {
+        return 0;
+    }
+
+    int fd = ::socket(addresses->ai_family, SOCK_STREAM, 0);
+    if (fd < 0) {
+        freeaddrinfo(addresses);
+        return 0;
+    }
+    fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+    int rc = ::connect(fd, addresses->ai_addr, addresses->ai_addrlen);
+    freeaddrinfo(addresses);
+    if (rc != 0 && errno == EINPROGRESS) {
+        struct pollfd p = {fd, POLLOUT, 0};
+        int soError = 0;
+        socklen_t len = sizeof(soError);
+        if (poll(&p, 1, timeoutMs) == 1 && getsockopt(fd, SOL_SOCKET, SO_ERROR, &soError, &len) == 0 && soError == 0) {
+            rc = 0;
+        }
+    }
+    if (rc != 0) {
+        ::close(fd);
+        return 0;
+    }
+    int one = 1;
+    setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+    socket = std::make_shared<WiFiSocket>(fd);
+    return 1;
+}
+
+size_t WiFiClient::write(const uint8_t* buf, size_t size) {
+    if (!socket) return 0;
+    size_t sent = 0;
+    while (sent < size) {
+        ssize_t n = ::send(socket->fd, buf + sent, size - sent, MSG_NOSIGNAL);
+        if (n > 0) {
+            sent += n;
+        } else if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+            struct pollfd p = {socket->fd, POLLOUT, 0};
+            if (poll(&p, 1, (int)timeoutMs) != 1) break;
+        } else {
+            socket->peerClosed = true;
+            break;
+        }
+    }
+    return sent;
+}
+
+// Top up the buffer from the socket; wait = block up to timeoutMs for the first byte
+bool WiFiClient::fill(bool wait, uint32_t timeoutMs) {
+    if (!socket) return false;
+    WiFiSocket& s = *socket;
+    if (s.head < s.tail) return true;
+    if (s.peerClosed) return false;
+    if (wait) {
+        struct pollfd p = {s.fd, POLLIN, 0};
+        if (poll(&p, 1, (int)timeoutMs) != 1) return false;
+    }
+    ssize_t n = ::recv(s.fd, s.buffer, sizeof(s.buffer), MSG_DONTWAIT);
+    if (n > 0) {
+        s.head = 0;
+        s.tail = n;
+        return true;
+    }
+    if (n == 0 || (errno != EAGAIN && errno != EWOULDBLOCK)) {
+        s.peerClosed = true;
+    }
+    return false;
+}
+
+bool WiFiClient::waitReadable(uint32_t timeoutMs) {
+    return fill(true, timeoutMs) || (socket && socket->peerClosed);
+}
+
+int WiFiClient::available() {
+    if (!fill(false, 0)) return 0;
+    int pending = 0;
+    ioctl(socket->fd, FIONREAD, &pending);
+    return (int)(socket->tail - socket->head) + pending;
+}
+
+int WiFiClient::read() {
+    if (!fill(false, 0)) return -1;
+    return socket->buffer[socket->head++];
+}
+
+int WiFiClient::read(uint8_t* buf, size_t size) {
+    size_t got = 0;
+    while (got < size && fill(false, 0)) {
+        size_t n = socket->tail - socket->head;
+        if (n > size - got) n = size - got;
+        memcpy(buf + got, socket->buffer + socket->head, n);
+        socket->head += n;
+        got += n;
+    }
+    return got > 0 ? (int)got : (socket && socket->peerClosed ? -1 : 0);
+}
+
+int WiFiClient::peek() {
+    if (!fill(false, 0)) return -1;
+    return socket->buffer[socket->head];
+}
+
+void WiFiClient::stop() {
+    socket.reset();
+}
+
+uint8_t WiFiClient::connected() {
+    if (!socket) return 0;
+    if (socket->head < socket->tail) return 1;
+    fill(false, 0);
+    return (socket->head < socket->tail || !socket->peerClosed) ? 1 : 0;
+}
+
+int WiFiClient::setNoDelay(bool nodelay) {
+    if (!socket) return -1;
+    int flag = nodelay ? 1 : 0;
+    return setsockopt(socket->fd, IPPROTO_TCP, TCP_NODELAY, &flag, sizeof(flag));
+}
@@ -0,0 +1,81 @@
+#ifndef WiFi_h
+#define WiFi_h
+
+#include <Arduino.h>
+#include "IPAddress.h"
+#include "WiFiClient.h"
+
+typedef enum {
+    WL_NO_SHIELD = 255,
+    WL_IDLE_STATUS = 0,
+    WL_NO_SSID_AVAIL = 1,
+    WL_SCAN_COMPLETED = 2,
+    WL_CONNECTED = 3,
+    WL_CONNECT_FAILED = 4,
+    WL_CONNECTION_LOST = 5,
+    WL_DISCONNECTED = 6
+} wl_status_t;
+
+typedef enum {
+    WIFI_MODE_NULL = 0,
+    WIFI_MODE_STA,
+    WIFI_MODE_AP,
+    WIFI_MODE_APSTA
+} wifi_mode_t;
+
+#define WIFI_OFF WIFI_MODE_NULL
+#define WIFI_STA WIFI_MODE_STA
+#define WIFI_AP WIFI_MODE_AP
+#define WIFI_AP_STA WIFI_MODE_APSTA
+
+typedef enum {
+    WIFI_AUTH_OPEN = 0,
+    WIFI_AUTH_WEP,
+    WIFI_AUTH_WPA_PSK,
+    WIFI_AUTH_WPA2_PSK,
+    WIFI_AUTH_WPA_WPA2_PSK,
+    WIFI_AUTH_WPA2_ENTERPRISE
+} wifi_auth_mode_t;
+
+#define WIFI_SCAN_RUNNING (-1)
+#define WIFI_SCAN_FAILED (-2)
+
+// Station only. The scan finds the --wifi networks; begin() connects after
+// CONNECT_MS if the SSID is listed and the password matches (open
+// networks take any), like a home router would.
+class WiFiClass {
+public:
+    static const uint32_t CONNECT_MS = 300;
+
+    bool mode(wifi_mode_t m) { currentMode = m; return true; }
+    wifi_mode_t getMode() const { return currentMode; }
+
+    wl_status_t begin(const char* ssid, const char* passphrase = NULL);
+    wl_status_t status();
+    bool isConnected() { return status() == WL_CONNECTED; }
+    bool disconnect(bool wifioff = false, bool eraseap = false);
+
+    int16_t scanNetworks(bool async = false, bool show_hidden = false);
+    int16_t scanComplete() const { return scanCount; }
+    void scanDelete() { scanCount = WIFI_SCAN_FAILED; }
+    String SSID(uint8_t i);
+    int32_t RSSI(uint8_t i);
+    wifi_auth_mode_t encryptionType(uint8_t i);
+
+    String SSID();
+    int8_t RSSI();
+    IPAddress localIP();
+    String macAddress() { return String("24:0A:C4:00:00:01"); }
+
+private:
+    wifi_mode_t currentMode = WIFI_MODE_NULL;
+    wl_status_t result = WL_IDLE_STATUS;   // Where the current attempt ends up
+    bool connecting = false;
+    uint32_t beginMs = 0;
+    int network = -1;
+    int16_t scanCount = WIFI_SCAN_FAILED;
+};
+
+extern WiFiClass WiFi;
+
+#endif
@@ -0,0 +1,45 @@
+#ifndef _WIFICLIENT_H_
+#define _WIFICLIENT_H_
+
+#include <Arduino.h>
+#include <memory>
+#include "IPAddress.h"
+
+struct WiFiSocket;
+
+// TCP client on a POSIX socket. Copies share the connection, like the
+// ESP32's. Hosts go through --map-host first (see hal_native.h).
+class WiFiClient : public Stream {
+public:
+    WiFiClient();
+    ~WiFiClient();
+
+    int connect(IPAddress ip, uint16_t port) { return connect(ip.toString().c_str(), port); }
+    int connect(const char* host, uint16_t port) { return connect(host, port, CONNECT_TIMEOUT_MS); }
+    int connect(const char* host, uint16_t port, int32_t timeoutMs);
+
+    size_t write(uint8_t data) override { return write(&data, 1); }
+    size_t write(const uint8_t* buf, size_t size) override;
+    using Print::write;
+    int available() override;
+    int read() override;
+    int read(uint8_t* buf, size_t size);
+    int peek() override;
+    void flush() override {}
+    void stop();
+    uint8_t connected();
+    operator bool() { return connected(); }
+    int setNoDelay(bool nodelay);
+
+    // Host only: wait up to timeoutMs for data (or the peer closing)
+    bool waitReadable(uint32_t timeoutMs);
+
+private:
+    static const int32_t CONNECT_TIMEOUT_MS = 3000;
+
+    std::shared_ptr<WiFiSocket> socket;
+
+    bool fill(bool wait, uint32_t timeoutMs);
+};
+
+#endif
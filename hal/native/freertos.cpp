@@ -0,0 +1,308 @@
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/queue.h"
+#include "freertos/semphr.h"
+#include <Arduino.h>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <string>
+#include <vector>
+#include <pthread.h>
+#include <sched.h>
+#include <sys/mman.h>
+
+// Host stacks: the configured size times this, plus headroom for glibc
+#define HAL_STACK_SCALE 4
+#define HAL_STACK_EXTRA (64 * 1024)
+#define HAL_STACK_PAINT 0xA5
+
+struct HalTask {
+    pthread_t thread;
+    TaskFunction_t function;
+    void* parameter;
+    std::string name;
+    UBaseType_t priority;
+    BaseType_t core;
+    uint32_t stackBytes;        // As configured for the device
+    uint8_t* stack;             // Painted host stack (nullptr: not ours)
+    size_t stackSize;
+    std::atomic<bool> deleted;
+};
+
+static thread_local HalTask* currentTask = nullptr;
+
+void halAssertFailed(const char* file, int line) {
+    fprintf(stderr, "configASSERT failed at %s:%d\n", file, line);
+    fflush(stdout);
+    abort();
+}
+
+void vPortEnterCritical(portMUX_TYPE* mux) {
+    while (__atomic_exchange_n(&mux->locked, 1, __ATOMIC_ACQUIRE)) {
+        sched_yield();
+    }
+}
+
+void vPortExitCritical(portMUX_TYPE* mux) {
+    __atomic_store_n(&mux->locked, 0, __ATOMIC_RELEASE);
+}
+
+// ----- Tasks -----
+
+static void* taskEntry(void* arg) {
+    HalTask* task = (HalTask*)arg;
+    currentTask = task;
+    task->function(task->parameter);
+    // Returning from a task function is an error on the device; end quietly here
+    return nullptr;
+}
+
+BaseType_t xTaskCreatePinnedToCore(TaskFunction_t function, const char* name, uint32_t stackDepth,
+                                   void* parameter, UBaseType_t priority, TaskHandle_t* createdTask,
+                                   BaseType_t coreId) {
+    HalTask* task = new HalTask();
+    task->function = function;
+    task->parameter = parameter;
+    task->name = name != nullptr ? name : "";
+    task->priority = priority;
+    task->core = (coreId == tskNO_AFFINITY) ? 0 : coreId;
+    task->stackBytes = stackDepth;
+    task->stackSize = (size_t)stackDepth * HAL_STACK_SCALE + HAL_STACK_EXTRA;
+    task->deleted = false;
+
+    void* stack = mmap(nullptr, task->stackSize, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (stack == MAP_FAILED) {
+        delete task;
+        return errCOULD_NOT_ALLOCATE_REQUIRED_MEMORY;
+    }
+    task->stack = (uint8_t*)stack;
+    memset(task->stack, HAL_STACK_PAINT, task->stackSize);
+
+    pthread_attr_t attr;
+    pthread_attr_init(&attr);
+    pthread_attr_setstack(&attr, task->stack, task->stackSize);
+    pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_DETACHED);
+    int rc = pthread_create(&task->thread, &attr, taskEntry, task);
+    pthread_attr_destroy(&attr);
+    if (rc != 0) {
+        munmap(task->stack, task->stackSize);
+        delete task;
+        return errCOULD_NOT_ALLOCATE_REQUIRED_MEMORY;
+    }
+    pthread_setname_np(task->thread, task->name.substr(0, 15).c_str());
+    if (createdTask != nullptr) {
+        *createdTask = task;
+    }
+    return pdPASS;
+}
+
+BaseType_t xTaskCreate(TaskFunction_t function, const char* name, uint32_t stackDepth,
+                       void* parameter, UBaseType_t priority, TaskHandle_t* createdTask) {
+    return xTaskCreatePinnedToCore(function, name, stackDepth, parameter, priority, createdTask, tskNO_AFFINITY);
+}
+
+TaskHandle_t xTaskGetCurrentTaskHandle(void) {
+    if (currentTask == nullptr) {
+        // A thread the HAL didn't create (main, stdin reader): give it a handle
+        HalTask* task = new HalTask();
+        task->thread = pthread_self();
+        task->function = nullptr;
+        task->parameter = nullptr;
+        task->name = "host";
+        task->priority = 1;
+        task->core = 0;
+        task->stackBytes = 0;
+        task->stack = nullptr;
+        task->stackSize = 0;
+        task->deleted = false;
+        currentTask = task;
+    }
+    return currentTask;
+}
+
+void vTaskDelete(TaskHandle_t task) {
+    if (task == nullptr || task == currentTask) {
+        // The stack stays mapped: this thread is still running on it
+        pthread_exit(nullptr);
+    }
+    task->deleted = true;
+}
+
+void vTaskDelay(TickType_t ticks) {
+    HalTask* self = currentTask;
+    if (self != nullptr && self->deleted) {
+        pthread_exit(nullptr);
+    }
+    if (ticks == 0) {
+        sched_yield();
+    } else {
+        delay(ticks);
+    }
+    if (self != nullptr && self->deleted) {
+        pthread_exit(nullptr);
+    }
+}
+
+TickType_t xTaskGetTickCount(void) {
+    return (TickType_t)millis();
+}
+
+BaseType_t xPortGetCoreID(void) {
+    return currentTask != nullptr ? currentTask->core : 0;
+}
+
+UBaseType_t uxTaskPriorityGet(TaskHandle_t task) {
+    if (task == nullptr) task = xTaskGetCurrentTaskHandle();
+    return task->priority;
+}
+
+const char* pcTaskGetName(TaskHandle_t task) {
+    if (task == nullptr) task = xTaskGetCurrentTaskHandle();
+    return task->name.c_str();
+}
+
+UBaseType_t uxTaskGetStackHighWaterMark(TaskHandle_t task) {
+    if (task == nullptr) task = xTaskGetCurrentTaskHandle();
+    if (task->stack == nullptr) {
+        return 0;
+    }
+    // The stack grows down: the lowest byte that lost its paint marks the deepest use
+    size_t untouched = 0;
+    while (untouched < task->stackSize && task->stack[untouched] == HAL_STACK_PAINT) {
+        untouched++;
+    }
+    size_t used = task->stackSize - untouched;
+    return used >= task->stackBytes ? 0 : (UBaseType_t)(task->stackBytes - used);
+}
+
+// ----- Queues and semaphores -----
+
+struct HalQueue {
+    std::mutex lock;
+    std::condition_variable changed;
+    UBaseType_t length;
+    UBaseType_t itemSize;
+    std::vector<uint8_t> items;   // Ring of length * itemSize bytes
+    UBaseType_t head;
+    UBaseType_t count;
+};
+
+static HalQueue* createQueue(UBaseType_t length, UBaseType_t itemSize, UBaseType_t initialCount) {
+    HalQueue* queue = new HalQueue();
+    queue->length = length;
+    queue->itemSize = itemSize;
+    queue->items.resize((size_t)length * itemSize);
+    queue->head = 0;
+    queue->count = initialCount;
+    return queue;
+}
+
+// Wait until ready() holds. portMAX_DELAY waits forever.
+template <typename Ready>
+static bool waitFor(HalQueue* queue, std::unique_lock<std::mutex>& guard, TickType_t ticksToWait, Ready ready) {
+    if (ticksToWait == portMAX_DELAY) {
+        queue->changed.wait(guard, ready);
+        return true;
+    }
+    return queue->changed.wait_for(guard, std::chrono::milliseconds(ticksToWait), ready);
+}
+
+QueueHandle_t xQueueCreate(UBaseType_t length, UBaseType_t itemSize) {
+    if (length == 0) return nullptr;
+    return createQueue(length, itemSize, 0);
+}
+
+void vQueueDelete(QueueHandle_t queue) {
+    delete queue;
+}
+
+static BaseType_t queueSend(QueueHandle_t queue, const void* item, TickType_t ticksToWait, bool front) {
+    std::unique_lock<std::mutex> guard(queue->lock);
+    if (!waitFor(queue, guard, ticksToWait, [queue] { return queue->count < queue->length; })) {
+        return errQUEUE_FULL;
+    }
+    if (queue->itemSize > 0) {
+        UBaseType_t slot;
+        if (front) {
+            queue->head = (queue->head + queue->length - 1) % queue->length;
+            slot = queue->head;
+        } else {
+            slot = (queue->head + queue->count) % queue->length;
+        }
+        memcpy(&queue->items[(size_t)slot * queue->itemSize], item, queue->itemSize);
+    }
+    queue->count++;
+    guard.unlock();
+    queue->changed.notify_all();
+    return pdPASS;
+}
+
+BaseType_t xQueueSend(QueueHandle_t queue, const void* item, TickType_t ticksToWait) {
+    return queueSend(queue, item, ticksToWait, false);
+}
+
+BaseType_t xQueueSendToFront(QueueHandle_t queue, const void* item, TickType_t ticksToWait) {
+    return queueSend(queue, item, ticksToWait, true);
+}
+
+static BaseType_t queueReceive(QueueHandle_t queue, void* buffer, TickType_t ticksToWait, bool remove) {
+    std::unique_lock<std::mutex> guard(queue->lock);
+    if (!waitFor(queue, guard, ticksToWait, [queue] { return queue->count > 0; })) {
+        return errQUEUE_EMPTY;
+    }
+    if (queue->itemSize > 0 && buffer != nullptr) {
+        memcpy(buffer, &queue->items[(size_t)queue->head * queue->itemSize], queue->itemSize);
+    }
+    if (remove) {
+        if (queue->itemSize > 0) {
+            queue->head = (queue->head + 1) % queue->length;
+        }
+        queue->count--;
+        guard.unlock();
+        queue->changed.notify_all();
+    }
+    return pdTRUE;
+}
+
+BaseType_t xQueueReceive(QueueHandle_t queue, void* buffer, TickType_t ticksToWait) {
+    return queueReceive(queue, buffer, ticksToWait, true);
+}
+
+BaseType_t xQueuePeek(QueueHandle_t queue, void* buffer, TickType_t ticksToWait) {
+    return queueReceive(queue, buffer, ticksToWait, false);
+}
+
+BaseType_t xQueueReset(QueueHandle_t queue) {
+    {
+        std::lock_guard<std::mutex> guard(queue->lock);
+        queue->head = 0;
+        queue->count = 0;
+    }
+    queue->changed.notify_all();
+    return pdPASS;
+}
+
+UBaseType_t uxQueueMessagesWaiting(QueueHandle_t queue) {
+    std::lock_guard<std::mutex> guard(queue->lock);
+    return queue->count;
+}
+
+UBaseType_t uxQueueSpacesAvailable(QueueHandle_t queue) {
+    std::lock_guard<std::mutex> guard(queue->lock);
+    return queue->length - queue->count;
+}
+
+// No priority inheritance or owner check: a mutex is a binary semaphore that starts given
+SemaphoreHandle_t xSemaphoreCreateMutex(void) {
+    return createQueue(1, 0, 1);
+}
+
+SemaphoreHandle_t xSemaphoreCreateBinary(void) {
+    return createQueue(1, 0, 0);
+}
+
+SemaphoreHandle_t xSemaphoreCreateCounting(UBaseType_t maxCount, UBaseType_t initialCount) {
+    return createQueue(maxCount, 0, initialCount);
+}
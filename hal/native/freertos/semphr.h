@@ -0,0 +1,18 @@
+#ifndef HAL_NATIVE_FREERTOS_SEMPHR_H
+#define HAL_NATIVE_FREERTOS_SEMPHR_H
+
+#include "queue.h"
+
+// As in FreeRTOS, a semaphore is a queue of empty items
+typedef QueueHandle_t SemaphoreHandle_t;
+
+SemaphoreHandle_t xSemaphoreCreateMutex(void);
+SemaphoreHandle_t xSemaphoreCreateBinary(void);
+SemaphoreHandle_t xSemaphoreCreateCounting(UBaseType_t maxCount, UBaseType_t initialCount);
+
+#define xSemaphoreTake(semaphore, ticksToWait) xQueueReceive((semaphore), NULL, (ticksToWait))
+#define xSemaphoreGive(semaphore) xQueueSend((semaphore), NULL, 0)
+#define vSemaphoreDelete(semaphore) vQueueDelete(semaphore)
+#define uxSemaphoreGetCount(semaphore) uxQueueMessagesWaiting(semaphore)
+
+#endif
@@ -0,0 +1,31 @@
+#ifndef HAL_NATIVE_FREERTOS_TASK_H
+#define HAL_NATIVE_FREERTOS_TASK_H
+
+#include "FreeRTOS.h"
+
+struct HalTask;
+typedef struct HalTask* TaskHandle_t;
+typedef void (*TaskFunction_t)(void*);
+
+// Stack depth is in bytes, as in ESP-IDF
+BaseType_t xTaskCreatePinnedToCore(TaskFunction_t function, const char* name, uint32_t stackDepth,
+                                   void* parameter, UBaseType_t priority, TaskHandle_t* createdTask,
+                                   BaseType_t coreId);
+BaseType_t xTaskCreate(TaskFunction_t function, const char* name, uint32_t stackDepth,
+                       void* parameter, UBaseType_t priority, TaskHandle_t* createdTask);
+
+// vTaskDelete(NULL) ends the calling thread. Another task is only marked:
+// it ends at its next vTaskDelay(), since a pthread can't be killed safely.
+void vTaskDelete(TaskHandle_t task);
+void vTaskDelay(TickType_t ticks);
+TickType_t xTaskGetTickCount(void);
+TaskHandle_t xTaskGetCurrentTaskHandle(void);
+UBaseType_t uxTaskPriorityGet(TaskHandle_t task);
+const char* pcTaskGetName(TaskHandle_t task);
+// Bytes of the configured stack never used, from a painted host stack.
+// Host frames are larger (64-bit, glibc), so this errs on the low side.
+UBaseType_t uxTaskGetStackHighWaterMark(TaskHandle_t task);
+
+#define taskYIELD() vTaskDelay(0)
+
+#endif
@@ -0,0 +1,526 @@
+#include "hal_native.h"
+#include <Adafruit_ST7789.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <mutex>
+#include <random>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+#include <dirent.h>
+#include <signal.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#ifndef CONFIG_ARDUINO_LOOP_STACK_SIZE
+#define CONFIG_ARDUINO_LOOP_STACK_SIZE 8192
+#endif
+#ifndef ARDUINO_RUNNING_CORE
+#define ARDUINO_RUNNING_CORE 1
+#endif
+
+static const int PIN_COUNT = 40;
+static const uint32_t DEFAULT_PRESS_MS = 80;
+static const uint16_t DEFAULT_ANALOG = 2048;   // Pot at mid travel
+
+// ----- Clock -----
+
+static const std::chrono::steady_clock::time_point startTime = std::chrono::steady_clock::now();
+
+unsigned long millis() {
+    return (unsigned long)(uint32_t)std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::steady_clock::now() - startTime).count();
+}
+
+unsigned long micros() {
+    return (unsigned long)(uint32_t)std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now() - startTime).count();
+}
+
+void delay(uint32_t ms) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(ms));
+}
+
+void delayMicroseconds(uint32_t us) {
+    std::this_thread::sleep_for(std::chrono::microseconds(us));
+}
+
+void yield() {
+    std::this_thread::yield();
+}
+
+// ----- GPIO -----
+
+struct PinState {
+    std::atomic<uint8_t> level;
+    std::atomic<uint16_t> analog;
+    std::atomic<int> mode;               // Interrupt mode, 0 = none
+    std::atomic<void (*)(void)> handler;
+};
+
+static PinState pins[PIN_COUNT];
+
+static void initPins() {
+    for (int i = 0; i < PIN_COUNT; i++) {
+        pins[i].level = HIGH;
+        pins[i].analog = DEFAULT_ANALOG;
+        pins[i].mode = 0;
+        pins[i].handler = nullptr;
+    }
+}
+
+void pinMode(uint8_t pin, uint8_t mode) {
+    (void)pin;
+    (void)mode;   // Inputs idle HIGH whatever the pull
+}
+
+void digitalWrite(uint8_t pin, uint8_t val) {
+    if (pin < PIN_COUNT) pins[pin].level = val ? HIGH : LOW;
+}
+
+int digitalRead(uint8_t pin) {
+    return pin < PIN_COUNT ? pins[pin].level.load() : LOW;
+}
+
+uint16_t analogRead(uint8_t pin) {
+    return pin < PIN_COUNT ? pins[pin].analog.load() : 0;
+}
+
+void analogReadResolution(uint8_t bits) {
+    (void)bits;
+}
+
+void analogSetPinAttenuation(uint8_t pin, adc_attenuation_t attenuation) {
+    (void)pin;
+    (void)attenuation;
+}
+
+void attachInterrupt(uint8_t pin, void (*handler)(void), int mode) {
+    if (pin >= PIN_COUNT) return;
+    pins[pin].handler = handler;
+    pins[pin].mode = mode;
+}
+
+void detachInterrupt(uint8_t pin) {
+    if (pin >= PIN_COUNT) return;
+    pins[pin].mode = 0;
+    pins[pin].handler = nullptr;
+}
+
+// A level change on the script thread, the host's "interrupt context"
+static void drivePin(int pin, uint8_t level) {
+    if (pin < 0 || pin >= PIN_COUNT) return;
+    uint8_t old = pins[pin].level.exchange(level);
+    int mode = pins[pin].mode;
+    void (*handler)(void) = pins[pin].handler;
+    if (handler == nullptr || old == level) return;
+    bool fire = (mode == CHANGE) || (mode == RISING && level == HIGH) || (mode == FALLING && level == LOW) ||
+                (mode == ONHIGH && level == HIGH) || (mode == ONLOW && level == LOW);
+    if (fire) handler();
+}
+
+// ----- Misc core -----
+
+static std::mt19937 randomEngine(1);
+
+long random(long howbig) {
+    if (howbig <= 0) return 0;
+    return (long)(randomEngine() % (unsigned long)howbig);
+}
+
+long random(long howsmall, long howbig) {
+    if (howsmall >= howbig) return howsmall;
+    return howsmall + random(howbig - howsmall);
+}
+
+void randomSeed(unsigned long seed) {
+    if (seed != 0) randomEngine.seed(seed);
+}
+
+uint32_t esp_random() {
+    static std::random_device device;
+    return (uint32_t)device();
+}
+
+long map(long x, long in_min, long in_max, long out_min, long out_max) {
+    if (in_max == in_min) return out_min;
+    return (x - in_min) * (out_max - out_min) / (in_max - in_min) + out_min;
+}
+
+EspClass ESP;
+
+// About what an ESP32 has left once Wi-Fi and the WebSocket client are up
+static const uint32_t HOST_HEAP_SIZE = 320 * 1024;
+
+uint32_t EspClass::getFreeHeap() { return HOST_HEAP_SIZE; }
+uint32_t EspClass::getMinFreeHeap() { return HOST_HEAP_SIZE; }
+uint32_t EspClass::getMaxAllocHeap() { return HOST_HEAP_SIZE; }
+uint32_t EspClass::getHeapSize() { return HOST_HEAP_SIZE; }
+
+void EspClass::restart() {
+    Serial.println("Native: ESP.restart() - stopping");
+    Serial.flush();
+    _exit(0);
+}
+
+// ----- Options -----
+
+namespace {
+
+struct Event {
+    uint32_t ms;
+    enum Kind { PIN, ANALOG, SERIAL, FRAME, QUIT } kind;
+    int pin;
+    int value;
+    std::string text;
+};
+
+std::string spiffsDir;
+double spiMhz = 0;
+std::vector<std::pair<std::string, std::string> > hostMap;
+HalNative::Network networks[HalNative::MAX_NETWORKS];
+int networkTotal = 0;
+std::string framesDir;
+uint32_t frameIntervalMs = 0;
+uint32_t durationMs = 0;
+std::vector<Event> events;
+
+Adafruit_ST7789* panel = nullptr;
+std::atomic<bool> stopRequested(false);
+std::atomic<bool> frameRequested(false);
+std::string requestedFrameName;
+std::mutex frameNameLock;
+std::atomic<uint32_t> framesWritten(0);
+std::atomic<uint32_t> loops(0);
+
+}
+
+namespace HalNative {
+
+const char* spiffsRoot() { return spiffsDir.c_str(); }
+double spiMegahertz() { return spiMhz; }
+int networkCount() { return networkTotal; }
+const Network& network(int index) { return networks[index]; }
+
+String resolveHost(const String& host) {
+    for (size_t i = 0; i < hostMap.size(); i++) {
+        if (host == hostMap[i].first.c_str()) return String(hostMap[i].second.c_str());
+    }
+    return host;
+}
+
+void registerPanel(Adafruit_ST7789* p) {
+    panel = p;
+}
+
+}
+
+static void usage(const char* program) {
+    fprintf(stderr,
+            "usage: %s [--duration SEC] [--script FILE] [--frames DIR] [--frame-interval MS]\n"
+            "          [--spiffs DIR] [--spi-mhz N] [--map-host FROM=TO] [--wifi SSID[:PASS[:RSSI]]]\n"
+            "          [--seed N]\n"
+            "See hal/native/hal_native.h.\n", program);
+    exit(2);
+}
+
+static void addNetwork(const std::string& spec) {
+    if (networkTotal >= HalNative::MAX_NETWORKS) return;
+    HalNative::Network& n = networks[networkTotal++];
+    size_t first = spec.find(':');
+    n.ssid = spec.substr(0, first).c_str();
+    n.rssi = -45 - 7 * (networkTotal - 1);
+    if (first == std::string::npos) return;
+    size_t second = spec.find(':', first + 1);
+    n.password = spec.substr(first + 1, second == std::string::npos ? std::string::npos : second - first - 1).c_str();
+    if (second != std::string::npos) n.rssi = atoi(spec.c_str() + second + 1);
+}
+
+static bool loadScript(const char* path) {
+    std::ifstream in(path);
+    if (!in) {
+        fprintf(stderr, "Native: cannot read script %s\n", path);
+        return false;
+    }
+    std::vector<std::pair<Event, uint32_t> > presses;   // Expanded below, once sorted
+    std::string line;
+    int lineNo = 0;
+    while (std::getline(in, line)) {
+        lineNo++;
+        size_t hash = line.find('#');
+        if (hash != std::string::npos) line.erase(hash);
+        std::istringstream fields(line);
+        Event e;
+        std::string kind;
+        if (!(fields >> e.ms)) continue;
+        if (!(fields >> kind)) {
+            fprintf(stderr, "Native: script line %d: missing event\n", lineNo);
+            return false;
+        }
+        e.pin = -1;
+        e.value = 0;
+        if (kind == "pin" && (fields >> e.pin >> e.value)) {
+            e.kind = Event::PIN;
+        } else if (kind == "press" && (fields >> e.pin)) {
+            uint32_t hold = DEFAULT_PRESS_MS;
+            fields >> hold;
+            e.kind = Event::PIN;
+            presses.push_back(std::make_pair(e, hold));
+            continue;
+        } else if (kind == "analog" && (fields >> e.pin >> e.value)) {
+            e.kind = Event::ANALOG;
+        } else if (kind == "serial") {
+            e.kind = Event::SERIAL;
+            std::getline(fields >> std::ws, e.text);
+        } else if (kind == "frame") {
+            e.kind = Event::FRAME;
+            fields >> e.text;
+        } else if (kind == "quit") {
+            e.kind = Event::QUIT;
+        } else {
+            fprintf(stderr, "Native: script line %d: cannot parse \"%s\"\n", lineNo, line.c_str());
+            return false;
+        }
+        events.push_back(e);
+    }
+
+    // A press inverts whatever level the pin has by then
+    for (size_t i = 0; i < presses.size(); i++) {
+        events.push_back(presses[i].first);
+        events.back().value = -1 - (int)presses[i].second;   // Marker: press with hold time
+    }
+    std::stable_sort(events.begin(), events.end(), [](const Event& a, const Event& b) { return a.ms < b.ms; });
+    uint8_t level[PIN_COUNT];
+    memset(level, HIGH, sizeof(level));
+    for (size_t i = 0; i < events.size(); i++) {
+        Event& e = events[i];
+        if (e.kind != Event::PIN || e.pin < 0 || e.pin >= PIN_COUNT) continue;
+        if (e.value < 0) {
+            uint32_t hold = (uint32_t)(-1 - e.value);
+            Event release = e;
+            release.ms = e.ms + hold;
+            release.value = level[e.pin];
+            e.value = !level[e.pin];
+            // Keep the list sorted: the release goes after events at the same time
+            std::vector<Event>::iterator at = std::upper_bound(events.begin() + i + 1, events.end(), release,
+                [](const Event& a, const Event& b) { return a.ms < b.ms; });
+            events.insert(at, release);
+        }
+        level[e.pin] = e.value ? HIGH : LOW;
+    }
+    return true;
+}
+
+static void applyEvent(const Event& e) {
+    switch (e.kind) {
+        case Event::PIN:
+            drivePin(e.pin, e.value ? HIGH : LOW);
+            break;
+        case Event::ANALOG:
+            if (e.pin >= 0 && e.pin < PIN_COUNT) pins[e.pin].analog = (uint16_t)e.value;
+            break;
+        case Event::SERIAL: {
+            std::string line = e.text + "\n";
+            Serial.inject(line.c_str(), line.size());
+            break;
+        }
+        case Event::FRAME: {
+            std::lock_guard<std::mutex> guard(frameNameLock);
+            requestedFrameName = e.text;
+            frameRequested = true;
+            break;
+        }
+        case Event::QUIT:
+            stopRequested = true;
+            break;
+    }
+}
+
+// ----- SPIFFS root -----
+
+static bool copyTree(const std::string& from, const std::string& to) {
+    DIR* dir = opendir(from.c_str());
+    if (dir == nullptr) return false;
+    struct dirent* entry;
+    while ((entry = readdir(dir)) != nullptr) {
+        std::string name = entry->d_name;
+        if (name == "." || name == "..") continue;
+        std::string src = from + "/" + name;
+        std::string dst = to + "/" + name;
+        struct stat st;
+        if (stat(src.c_str(), &st) != 0) continue;
+        if (S_ISDIR(st.st_mode)) {
+            mkdir(dst.c_str(), 0755);
+            copyTree(src, dst);
+        } else {
+            std::ifstream in(src.c_str(), std::ios::binary);
+            std::ofstream out(dst.c_str(), std::ios::binary);
+            out << in.rdbuf();
+        }
+    }
+    closedir(dir);
+    return true;
+}
+
+static bool prepareSpiffs() {
+    if (!spiffsDir.empty()) {
+        mkdir(spiffsDir.c_str(), 0755);
+        return access(spiffsDir.c_str(), W_OK) == 0;
+    }
+    char tmpl[] = "/tmp/spiffs_native_XXXXXX";
+    if (mkdtemp(tmpl) == nullptr) return false;
+    spiffsDir = tmpl;
+    copyTree("data", spiffsDir);
+    return true;
+}
+
+// ----- Frames -----
+
+static void writeFrame(const std::string& name) {
+    if (panel == nullptr || framesDir.empty()) return;
+    std::string path = framesDir + "/" + name + ".ppm";
+    if (panel->writePpm(path.c_str())) {
+        framesWritten++;
+    } else {
+        fprintf(stderr, "Native: cannot write %s\n", path.c_str());
+    }
+}
+
+static std::string frameName(uint32_t ms) {
+    char name[32];
+    snprintf(name, sizeof(name), "frame_%07u", (unsigned)ms);
+    return name;
+}
+
+// ----- Run -----
+
+static void onSignal(int) {
+    stopRequested = true;
+}
+
+static void finish() {
+    uint32_t ms = millis();
+    writeFrame("final");
+    char line[200];
+    snprintf(line, sizeof(line), "Native: %u ms, %u loops, panel %llu px in %u windows, %u frames written",
+             (unsigned)ms, (unsigned)loops.load(),
+             panel != nullptr ? (unsigned long long)panel->getPixelsWritten() : 0ULL,
+             panel != nullptr ? (unsigned)panel->getWindows() : 0u, (unsigned)framesWritten.load());
+    Serial.println(line);
+    Serial.flush();
+    // Other tasks are still running and own static objects: no destructors
+    _exit(0);
+}
+
+// Arduino's loopTask, plus frame dumps between iterations
+static void loopTask(void*) {
+    setup();
+    uint32_t lastFrameMs = 0;
+    uint32_t lastFrameWrites = 0;
+    while (!stopRequested) {
+        loop();
+        loops++;
+        uint32_t now = millis();
+        if (frameRequested.exchange(false)) {
+            std::string name;
+            {
+                std::lock_guard<std::mutex> guard(frameNameLock);
+                name = requestedFrameName;
+            }
+            writeFrame(name.empty() ? frameName(now) : name);
+        }
+        if (frameIntervalMs > 0 && panel != nullptr && now - lastFrameMs >= frameIntervalMs &&
+            panel->getWriteCount() != lastFrameWrites) {
+            lastFrameMs = now;
+            lastFrameWrites = panel->getWriteCount();
+            writeFrame(frameName(now));
+        }
+    }
+    finish();
+}
+
+static void scriptTask() {
+    for (size_t i = 0; i < events.size() && !stopRequested; i++) {
+        const Event& e = events[i];
+        while (millis() < e.ms && !stopRequested) {
+            uint32_t wait = e.ms - millis();
+            delay(wait > 10 ? 10 : wait);
+        }
+        applyEvent(e);
+    }
+}
+
+static void stdinTask() {
+    std::string line;
+    while (std::getline(std::cin, line)) {
+        line += "\n";
+        Serial.inject(line.c_str(), line.size());
+    }
+}
+
+int main(int argc, char** argv) {
+    setvbuf(stdout, nullptr, _IOLBF, 0);
+    initPins();
+    const char* scriptPath = nullptr;
+    unsigned long seed = 1;
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (i + 1 >= argc) usage(argv[0]);
+        const char* value = argv[++i];
+        if (arg == "--duration") durationMs = (uint32_t)(atof(value) * 1000);
+        else if (arg == "--script") scriptPath = value;
+        else if (arg == "--frames") framesDir = value;
+        else if (arg == "--frame-interval") frameIntervalMs = (uint32_t)atoi(value);
+        else if (arg == "--spiffs") spiffsDir = value;
+        else if (arg == "--spi-mhz") spiMhz = atof(value);
+        else if (arg == "--wifi") addNetwork(value);
+        else if (arg == "--seed") seed = strtoul(value, nullptr, 10);
+        else if (arg == "--map-host") {
+            std::string map = value;
+            size_t eq = map.find('=');
+            if (eq == std::string::npos) usage(argv[0]);
+            hostMap.push_back(std::make_pair(map.substr(0, eq), map.substr(eq + 1)));
+        } else usage(argv[0]);
+    }
+    if (networkTotal == 0) addNetwork("HostNet");
+    randomSeed(seed);
+    if (scriptPath != nullptr && !loadScript(scriptPath)) return 2;
+    if (!framesDir.empty()) mkdir(framesDir.c_str(), 0755);
+    if (!prepareSpiffs()) {
+        fprintf(stderr, "Native: cannot use SPIFFS directory %s\n", spiffsDir.c_str());
+        return 2;
+    }
+    fprintf(stderr, "Native: SPIFFS at %s\n", spiffsDir.c_str());
+
+    signal(SIGINT, onSignal);
+    signal(SIGTERM, onSignal);
+    signal(SIGPIPE, SIG_IGN);   // A peer closing a socket shows up as a write error instead
+
+    // Inputs the board has at power-up
+    size_t firstLive = 0;
+    while (firstLive < events.size() && events[firstLive].ms == 0) {
+        applyEvent(events[firstLive++]);
+    }
+    events.erase(events.begin(), events.begin() + firstLive);
+
+    std::thread(scriptTask).detach();
+    std::thread(stdinTask).detach();
+    xTaskCreatePinnedToCore(loopTask, "loopTask", CONFIG_ARDUINO_LOOP_STACK_SIZE, nullptr, 1, nullptr,
+                            ARDUINO_RUNNING_CORE);
+
+    while (!stopRequested && (durationMs == 0 || millis() < durationMs)) {
+        delay(10);
+    }
+    stopRequested = true;
+    // loopTask finishes after the current loop(); give a stuck one a few seconds
+    delay(5000);
+    fprintf(stderr, "Native: loop() did not return within 5 s of the stop\n");
+    fflush(stdout);
+    _exit(1);
+}
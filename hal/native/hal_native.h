@@ -0,0 +1,90 @@
+#ifndef HAL_NATIVE_H
+#define HAL_NATIVE_H
+
+// Headless host build: the firmware's setup()/loop() on Linux, for
+// benchmarks and CI (pio run -e native, see platformio.ini).
+//
+// This directory stands in for the Arduino-ESP32 core and the libraries
+// src/ includes, keeping their names and the parts of their API src/ uses:
+//   Arduino.h, Serial    real clock, scripted GPIO/ADC, stdout/stdin
+//   Adafruit_GFX.h       GFX primitives and the classic 5x7 font
+//   Adafruit_ST7789.h    the panel as an in-memory RGB565 framebuffer
+//   WiFi.h               fake station + scan list, POSIX TCP WiFiClient
+//   HTTPClient.h         HTTP/1.1 with keep-alive
+//   WebSocketsClient.h   RFC 6455 client
+//   FS.h, SPIFFS.h       SPIFFS as a directory
+//   freertos/*.h         tasks, queues, mutexes on pthreads
+// ESP32 is not defined, so the few #ifdef ESP32 blocks in src/ stay out.
+//
+// Usage: .pio/build/native/program [options]
+//   --duration SEC          stop after SEC seconds (default: at "quit" or Ctrl-C)
+//   --script FILE           timed input events, see below
+//   --frames DIR            write the panel as PPM: on "frame" events and at exit
+//   --frame-interval MS     ...and every MS while the panel keeps changing
+//   --spiffs DIR            SPIFFS root, kept between runs (default: a fresh
+//                           copy of data/ under /tmp, like a newly flashed board)
+//   --spi-mhz N             charge panel writes the time an N MHz SPI bus takes
+//                           (default 0: free), so loop timings resemble the device
+//   --map-host FROM=TO      connect to TO whenever the firmware dials FROM
+//                           (e.g. 192.168.1.7=127.0.0.1), repeatable
+//   --wifi SSID[:PASS[:RSSI]]  a network the scan finds, repeatable
+//                           (default: one open network "HostNet")
+//   --seed N                random() seed (default 1)
+//
+// Script: one event per line, "<ms> <event> [args]", ms since start, # comments.
+//   pin GPIO LEVEL          drive an input; fires its attachInterrupt() handler
+//   press GPIO [HOLD_MS]    invert the pin for HOLD_MS (default 80), then restore
+//   analog GPIO VALUE       what analogRead() returns (default 2048)
+//   serial TEXT             TEXT and a newline arrive on Serial
+//   frame [NAME]            dump a frame (DIR/NAME.ppm, default frame_<ms>.ppm)
+//                           after the current loop(), so setup() is never caught
+//   quit                    stop the run
+// Inputs idle HIGH. Events at 0 ms are applied before setup(). Serial also
+// takes lines typed on stdin.
+//
+// At exit it prints "Native: ..." with run time, loop count and panel
+// traffic. Combine with "prof csv" in the script and
+// server/scripts/profile_report.py for per-section numbers.
+
+#include <Arduino.h>
+
+class Adafruit_ST7789;
+
+namespace HalNative {
+
+struct Network {
+    String ssid;
+    String password;    // Empty: open network
+    int32_t rssi;
+};
+
+static const int MAX_NETWORKS = 8;
+
+// Options as parsed from the command line
+const char* spiffsRoot();
+double spiMegahertz();
+int networkCount();
+const Network& network(int index);
+
+// Host to actually connect to for host (--map-host)
+String resolveHost(const String& host);
+
+// The panel registers itself so frames can be dumped
+void registerPanel(Adafruit_ST7789* panel);
+
+// SPIFFS traffic since start or the last reset, for the tools/ benchmarks.
+// reads/writes count calls (single-byte read() included), bytes* their sizes.
+struct FsStats {
+    uint32_t opens;
+    uint32_t reads;
+    uint32_t writes;
+    uint32_t seeks;
+    uint64_t bytesRead;
+    uint64_t bytesWritten;
+};
+FsStats fsStats();
+void resetFsStats();
+
+}
+
+#endif
@@ -756,9 +756,14 @@ async def get_active_sessions(user_id: int):
             conn.close()
 
 
-@router.post("/games/{session_id}/move")
-async def submit_move(session_id: int, request: GameMoveRequest):
-    """Submit a game move (for caro game)."""
+async def apply_move(session_id: int, user_id: int, row: int, col: int) -> dict:
+    """
+    Validate and store one caro move, then push it to both players.
+
+    Shared by POST /games/{session_id}/move and the WebSocket "game_move"
+    message. seq is the move_number of the stored move, so clients apply
+    pushed moves in order and resync only when they see a gap.
+    """
     conn = None
     try:
         conn = get_db_connection()
@@ -787,7 +792,7 @@ async def submit_move(session_id: int, request: GameMoveRequest):
             FROM game_participants
             WHERE session_id = %s AND user_id = %s
             """,
-            (session_id, request.user_id),
+            (session_id, user_id),
         )
         participant = cursor.fetchone()
         if not participant:
@@ -819,7 +824,7 @@ async def submit_move(session_id: int, request: GameMoveRequest):
             SELECT id FROM game_moves
             WHERE session_id = %s AND row = %s AND col = %s
             """,
-            (session_id, request.row, request.col),
+            (session_id, row, col),
         )
         if cursor.fetchone():
             return {"success": False, "message": "Cell already occupied"}
@@ -836,7 +841,7 @@ async def submit_move(session_id: int, request: GameMoveRequest):
 
         # Determine whose turn it is (host goes first, then alternates)
         expected_player = host_id if move_count % 2 == 0 else guest_id
-        if request.user_id != expected_player:
+        if user_id != expected_player:
             return {"success": False, "message": "Not your turn"}
 
         # Insert move
@@ -846,7 +851,7 @@ async def submit_move(session_id: int, request: GameMoveRequest):
             VALUES (%s, %s, %s, %s, %s)
             RETURNING id
             """,
-            (session_id, request.user_id, request.row, request.col, move_count + 1),
+            (session_id, user_id, row, col, move_count + 1),
         )
         move_id = cursor.fetchone()["id"]
 
@@ -894,9 +899,9 @@ async def submit_move(session_id: int, request: GameMoveRequest):
                     return True
             return False
 
-        if check_win(request.row, request.col, request.user_id):
+        if check_win(row, col, user_id):
             game_status = "completed"
-            winner_id = request.user_id
+            winner_id = user_id
             cursor.execute(
                 """
                 UPDATE game_sessions
@@ -920,17 +925,18 @@ async def submit_move(session_id: int, request: GameMoveRequest):
 
         # Calculate current turn after this move
         # After a move, turn switches to the other player
-        current_turn = guest_id if request.user_id == host_id else host_id
+        current_turn = guest_id if user_id == host_id else host_id
+        seq = move_count + 1
         
         # Broadcast move to BOTH players (so both know the current state)
         # This allows ESP32 to know when it's their turn
-        opponent_id = guest_id if request.user_id == host_id else host_id
         event_data = {
             "event_type": "move",
             "session_id": session_id,
-            "user_id": request.user_id,
-            "row": request.row,
-            "col": request.col,
+            "seq": seq,
+            "user_id": user_id,
+            "row": row,
+            "col": col,
             "game_status": game_status,
             "winner_id": winner_id,
             "current_turn": current_turn,  # Add current turn so clients know whose turn it is now
@@ -942,20 +948,147 @@ async def submit_move(session_id: int, request: GameMoveRequest):
             "success": True,
             "message": "Move submitted",
             "move_id": move_id,
+            "seq": seq,
             "game_status": game_status,
             "winner_id": winner_id,
+            "current_turn": current_turn,
         }
-    except Exception as exc:  # noqa: BLE001
+    except Exception:
         if conn:
             conn.rollback()
+        raise
+    finally:
+        if conn:
+            conn.close()
+
+
+async def replay_moves(session_id: int, user_id: int, since_seq: int) -> int:
+    """
+    Re-send every move after since_seq to one player, as regular move events.
+
+    Used when a client detects a gap in seq (dropped frame, reconnect).
+    Returns the number of moves sent.
+    """
+    conn = None
+    try:
+        conn = get_db_connection()
+        cursor = conn.cursor(cursor_factory=RealDictCursor)
+
+        cursor.execute(
+            """
+            SELECT id, host_user_id, status
+            FROM game_sessions
+            WHERE id = %s
+            """,
+            (session_id,),
+        )
+        session = cursor.fetchone()
+        if not session:
+            return 0
+
+        cursor.execute(
+            """
+            SELECT user_id FROM game_participants
+            WHERE session_id = %s
+            """,
+            (session_id,),
+        )
+        participant_ids = [p["user_id"] for p in cursor.fetchall()]
+        if user_id not in participant_ids:
+            return 0
+        host_id = session["host_user_id"]
+        guest_id = next((uid for uid in participant_ids if uid != host_id), None)
+
+        cursor.execute(
+            """
+            SELECT user_id, row, col, move_number
+            FROM game_moves
+            WHERE session_id = %s AND move_number > %s
+            ORDER BY move_number ASC
+            """,
+            (session_id, since_seq),
+        )
+        moves = cursor.fetchall()
+
+        for index, move in enumerate(moves):
+            is_last = index == len(moves) - 1
+            completed = is_last and session["status"] == "completed"
+            event_data = {
+                "event_type": "move",
+                "session_id": session_id,
+                "seq": move["move_number"],
+                "user_id": move["user_id"],
+                "row": move["row"],
+                "col": move["col"],
+                # Completed sessions without a full board were won by the last mover
+                "game_status": "completed" if completed else "playing",
+                "winner_id": move["user_id"] if completed and move["move_number"] < 15 * 20 else None,
+                "current_turn": guest_id if move["user_id"] == host_id else host_id,
+            }
+            await websocket_manager.send_game_event(user_id, event_data)
+        return len(moves)
+    finally:
+        if conn:
+            conn.close()
+
+
+async def relay_billiard(session_id: int, user_id: int, event_data: dict) -> int:
+    """
+    Forward a billiard lockstep message (shot or sync) to the other player.
+
+    The server keeps no billiard state: both devices simulate every shot and
+    compare state hashes themselves, so this only checks that the sender
+    plays in the running session. Returns the number of players reached.
+    """
+    conn = None
+    try:
+        conn = get_db_connection()
+        cursor = conn.cursor(cursor_factory=RealDictCursor)
+
+        cursor.execute(
+            """
+            SELECT status FROM game_sessions
+            WHERE id = %s
+            """,
+            (session_id,),
+        )
+        session = cursor.fetchone()
+        if not session or session["status"] != "in_progress":
+            return 0
+
+        cursor.execute(
+            """
+            SELECT user_id FROM game_participants
+            WHERE session_id = %s
+            """,
+            (session_id,),
+        )
+        participant_ids = [p["user_id"] for p in cursor.fetchall()]
+        if user_id not in participant_ids:
+            return 0
+    finally:
+        if conn:
+            conn.close()
+
+    event = {**event_data, "session_id": session_id, "user_id": user_id}
+    sent = 0
+    for uid in participant_ids:
+        if uid != user_id and await websocket_manager.send_game_event(uid, event):
+            sent += 1
+    return sent
+
+
+@router.post("/games/{session_id}/move")
+async def submit_move(session_id: int, request: GameMoveRequest):
+    """Submit a game move (for caro game)."""
+    try:
+        return await apply_move(session_id, request.user_id, request.row, request.col)
+    except Exception as exc:  # noqa: BLE001
         import traceback
         error_trace = traceback.format_exc()
         print(f"[{datetime.now().strftime('%Y-%m-%d %H:%M:%S')}] ❌ Submit move error: {str(exc)}")
         print(f"Traceback: {error_trace}")
         raise HTTPException(status_code=500, detail=f"Failed to submit move: {str(exc)}")
-    finally:
-        if conn:
-            conn.close()
 
 
 @router.get("/games/{session_id}/state")
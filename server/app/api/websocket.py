@@ -3,9 +3,11 @@ from datetime import datetime
 import json
 import logging
 from typing import Dict, Optional
-from collections import defaultdict, deque
+from collections import defaultdict, deque, OrderedDict
 import asyncio
 
+from app.api import wire
+
 logger = logging.getLogger(__name__)
 
 class WebSocketManager:
@@ -20,6 +22,14 @@ class WebSocketManager:
         # Rate limiting: Track message counts per user
         self.message_counts: Dict[int, deque] = {}  # user_id -> deque of timestamps
         self.max_messages_per_second = 10
+
+        # Sockets that negotiated the binary "tlv1" framing in init (see wire.py)
+        self.binary_sockets = set()
+
+        # Recently delivered message_ids per sender: devices re-send chat until they
+        # see message_delivered, so a repeat is acked again instead of forwarded twice
+        self.delivered_message_ids: Dict[int, OrderedDict] = {}
+        self.max_remembered_message_ids = 256
     
     async def connect(self, websocket: WebSocket, client_id: str):
         await websocket.accept()
@@ -29,11 +39,21 @@ class WebSocketManager:
         print(f"  Client ID: {client_id}")
         print(f"  Client IP: {client_ip}")
     
+    async def send_message(self, websocket: WebSocket, message: dict):
+        """Send as a binary wire frame if this socket negotiated it, JSON text otherwise."""
+        if websocket in self.binary_sockets:
+            frame = wire.encode(message)
+            if frame is not None:
+                await websocket.send_bytes(frame)
+                return
+        await websocket.send_text(json.dumps(message))
+    
     async def disconnect(self, client_id: str):
         if client_id in self.active_connections:
             # Capture user_id (if any) before cleanup so we can broadcast offline
             user_id: Optional[int] = self.client_to_user.get(client_id)
 
+            self.binary_sockets.discard(self.active_connections[client_id])
             del self.active_connections[client_id]
             # Remove user_id mapping if exists
             if user_id is not None:
@@ -81,7 +101,7 @@ class WebSocketManager:
                 "type": "notification",
                 "notification": notification_data
             }
-            await websocket.send_text(json.dumps(message))
+            await self.send_message(websocket, message)
             print(f"[{datetime.now().strftime('%Y-%m-%d %H:%M:%S')}] ✅ Sent notification to user {user_id} (client {client_id})")
             return True
         except Exception as e:
@@ -110,7 +130,7 @@ class WebSocketManager:
         websocket = self.active_connections[client_id]
         try:
             message = {"type": "game_event", "event": event_data}
-            await websocket.send_text(json.dumps(message))
+            await self.send_message(websocket, message)
             print(f"[{datetime.now().strftime('%Y-%m-%d %H:%M:%S')}] ✅ Sent game event to user {user_id} (client {client_id})")
             return True
         except Exception as e:
@@ -118,6 +138,17 @@ class WebSocketManager:
             logger.error(f"Error sending game event: {str(e)}", exc_info=True)
             return False
     
+    def _was_delivered(self, user_id: int, message_id: str) -> bool:
+        return bool(message_id) and message_id in self.delivered_message_ids.get(user_id, {})
+
+    def _remember_delivered(self, user_id: int, message_id: str):
+        if not message_id:
+            return
+        remembered = self.delivered_message_ids.setdefault(user_id, OrderedDict())
+        remembered[message_id] = True
+        while len(remembered) > self.max_remembered_message_ids:
+            remembered.popitem(last=False)
+
     def _check_rate_limit(self, user_id: int) -> bool:
         """Check if user has exceeded rate limit. Returns True if allowed, False if rate limited."""
         now = datetime.now()
@@ -211,7 +242,7 @@ class WebSocketManager:
             except:
                 chat_message["from_nickname"] = f"User{from_user_id}"
             
-            await websocket.send_text(json.dumps(chat_message))
+            await self.send_message(websocket, chat_message)
             
             # Send delivery confirmation to sender
             await self.send_delivery_status(from_user_id, message_data.get("message_id", ""), "delivered")
@@ -278,7 +309,7 @@ class WebSocketManager:
                 "from_nickname": sender_nickname
             }
             
-            await websocket.send_text(json.dumps(typing_message))
+            await self.send_message(websocket, typing_message)
             
             # Track typing state
             if typing_type == "typing_start":
@@ -314,7 +345,7 @@ class WebSocketManager:
                 "message_id": message_id,
                 "timestamp": datetime.now().isoformat()
             }
-            await websocket.send_text(json.dumps(status_message))
+            await self.send_message(websocket, status_message)
             return True
         except Exception as e:
             print(f"[{datetime.now().strftime('%Y-%m-%d %H:%M:%S')}] ❌ Error sending delivery status: {str(e)}")
@@ -344,7 +375,7 @@ class WebSocketManager:
                 "message_id": message_id,
                 "timestamp": datetime.now().isoformat()
             }
-            await websocket.send_text(json.dumps(read_receipt))
+            await self.send_message(websocket, read_receipt)
             return True
         except Exception as e:
             print(f"[{datetime.now().strftime('%Y-%m-%d %H:%M:%S')}] ❌ Error sending read receipt: {str(e)}")
@@ -378,7 +409,6 @@ class WebSocketManager:
                 "status": status,
                 "timestamp": datetime.now().isoformat()
             }
-            message_json = json.dumps(status_message)
             
             # Send to each friend who is online
             notified_count = 0
@@ -388,7 +418,7 @@ class WebSocketManager:
                     if client_id in self.active_connections:
                         websocket = self.active_connections[client_id]
                         try:
-                            await websocket.send_text(message_json)
+                            await self.send_message(websocket, status_message)
                             notified_count += 1
                             print(f"[{datetime.now().strftime('%Y-%m-%d %H:%M:%S')}] ✅ Sent status update to friend {friend_id} (client {client_id})")
                         except Exception as e:
@@ -440,7 +470,7 @@ class WebSocketManager:
                             "timestamp": datetime.now().isoformat()
                         }
                         try:
-                            await target_ws.send_text(json.dumps(msg))
+                            await self.send_message(target_ws, msg)
                             sent += 1
                         except Exception as e:
                             print(f"[{datetime.now().strftime('%Y-%m-%d %H:%M:%S')}] ⚠️ Error syncing online friend {friend_id} to user {user_id}: {str(e)}")
@@ -511,7 +541,7 @@ class WebSocketManager:
                 }
                 message = {"type": "game_event", "event": event_data}
                 try:
-                    await target_ws.send_text(json.dumps(message))
+                    await self.send_message(target_ws, message)
                     sent += 1
                 except Exception as e:
                     print(f"[{datetime.now().strftime('%Y-%m-%d %H:%M:%S')}] ⚠️ Error sending pending invite to user {user_id}: {str(e)}")
@@ -543,7 +573,8 @@ class WebSocketManager:
     
     async def handle_message(self, websocket: WebSocket, message: str, client_id: str):
         try:
-            data = json.loads(message)
+            # Text frames arrive as JSON, binary frames already decoded by wire.decode()
+            data = json.loads(message) if isinstance(message, str) else message
             message_type = data.get("type", "unknown")
             
             # Handle ping for keep-alive
@@ -553,7 +584,7 @@ class WebSocketManager:
                     "type": "pong",
                     "timestamp": datetime.now().isoformat()
                 }
-                await websocket.send_text(json.dumps(pong))
+                await self.send_message(websocket, pong)
                 # Don't log ping/pong to reduce noise
                 return
             
@@ -617,24 +648,40 @@ class WebSocketManager:
                     "message": "Socket initialized successfully",
                     "timestamp": datetime.now().isoformat()
                 }
-                await websocket.send_text(json.dumps(ack))
+                # Binary framing only if the client offered it; echoing "wire" switches both sides
+                if data.get("wire") == wire.FORMAT_NAME:
+                    self.binary_sockets.add(websocket)
+                    ack["wire"] = wire.FORMAT_NAME
+                else:
+                    self.binary_sockets.discard(websocket)
+                # Client may pack several messages per frame ("batch" below)
+                if data.get("batch"):
+                    ack["batch"] = True
+                await self.send_message(websocket, ack)
                 print(f"[{datetime.now().strftime('%Y-%m-%d %H:%M:%S')}] Sent init acknowledgment to {client_id}")
             
+            # Several messages the client queued in one tick, handled in order
+            elif message_type == "batch":
+                for item in data.get("messages", []):
+                    if isinstance(item, dict) and item.get("type") not in ("batch", "init"):
+                        await self.handle_message(websocket, item, client_id)
+
             # Handle chat message
             elif message_type == "chat_message":
                 sender_id = self.client_to_user.get(client_id)
+                message_id = data.get("message_id", "")
                 if not sender_id:
                     error_response = {
                         "type": "chat_error",
                         "message": "User not authenticated",
-                        "code": "NOT_AUTHENTICATED"
+                        "code": "NOT_AUTHENTICATED",
+                        "message_id": message_id
                     }
-                    await websocket.send_text(json.dumps(error_response))
+                    await self.send_message(websocket, error_response)
                     return
                 
                 to_user_id = data.get("to_user_id")
                 message_text = data.get("message", "").strip()
-                message_id = data.get("message_id", "")
                 timestamp = data.get("timestamp", datetime.now().isoformat())
                 
                 # Validate message
@@ -642,27 +689,35 @@ class WebSocketManager:
                     error_response = {
                         "type": "chat_error",
                         "message": "Missing to_user_id",
-                        "code": "INVALID_RECIPIENT"
+                        "code": "INVALID_RECIPIENT",
+                        "message_id": message_id
                     }
-                    await websocket.send_text(json.dumps(error_response))
+                    await self.send_message(websocket, error_response)
                     return
                 
                 if not message_text:
                     error_response = {
                         "type": "chat_error",
                         "message": "Message cannot be empty",
-                        "code": "EMPTY_MESSAGE"
+                        "code": "EMPTY_MESSAGE",
+                        "message_id": message_id
                     }
-                    await websocket.send_text(json.dumps(error_response))
+                    await self.send_message(websocket, error_response)
                     return
                 
                 if len(message_text) > 500:
                     error_response = {
                         "type": "chat_error",
                         "message": "Message too long (max 500 characters)",
-                        "code": "MESSAGE_TOO_LONG"
+                        "code": "MESSAGE_TOO_LONG",
+                        "message_id": message_id
                     }
-                    await websocket.send_text(json.dumps(error_response))
+                    await self.send_message(websocket, error_response)
+                    return
+                
+                # Retry of a message that already went through: just confirm it again
+                if self._was_delivered(sender_id, message_id):
+                    await self.send_delivery_status(sender_id, message_id, "delivered")
                     return
                 
                 # Send chat message
@@ -676,14 +731,18 @@ class WebSocketManager:
                     }
                 )
                 
+                if result.get("status") == "success":
+                    self._remember_delivered(sender_id, message_id)
+                
                 # Send error response to sender if failed
                 if result.get("status") != "success":
                     error_response = {
                         "type": "chat_error",
                         "message": result.get("message", "Failed to send message"),
-                        "code": result.get("code", "UNKNOWN_ERROR")
+                        "code": result.get("code", "UNKNOWN_ERROR"),
+                        "message_id": message_id
                     }
-                    await websocket.send_text(json.dumps(error_response))
+                    await self.send_message(websocket, error_response)
             
             # Handle typing indicators
             elif message_type in ["typing_start", "typing_stop"]:
@@ -710,7 +769,59 @@ class WebSocketManager:
                     return  # Silently ignore invalid read receipt
                 
                 await self.send_read_receipt(sender_id, to_user_id, message_id)
-            
+
+            # Handle caro move submitted over the socket (same rules as POST /games/{id}/move)
+            elif message_type == "game_move":
+                # Imported here: games.py imports websocket_manager from this module
+                from app.api.games import apply_move
+
+                sender_id = self.client_to_user.get(client_id)
+                session_id = data.get("session_id")
+                seq = data.get("seq")
+                ack = {"type": "game_move_ack", "session_id": session_id, "seq": seq}
+
+                if not sender_id:
+                    ack.update({"success": False, "message": "User not authenticated"})
+                elif session_id is None or data.get("row") is None or data.get("col") is None:
+                    ack.update({"success": False, "message": "Missing session_id/row/col"})
+                else:
+                    try:
+                        result = await apply_move(int(session_id), sender_id, int(data["row"]), int(data["col"]))
+                        ack.update(result)
+                        ack.pop("move_id", None)
+                    except Exception as move_error:
+                        print(f"[{datetime.now().strftime('%Y-%m-%d %H:%M:%S')}] ❌ game_move error: {str(move_error)}")
+                        ack.update({"success": False, "message": "Failed to submit move"})
+
+                await self.send_message(websocket, ack)
+
+            # Client saw a gap in move seq numbers: re-send the moves it missed
+            elif message_type == "game_resync":
+                from app.api.games import replay_moves
+
+                sender_id = self.client_to_user.get(client_id)
+                session_id = data.get("session_id")
+                if not sender_id or session_id is None:
+                    return  # Silently ignore invalid resync request
+
+                since_seq = int(data.get("since_seq", 0))
+                sent = await replay_moves(int(session_id), sender_id, since_seq)
+                print(f"[{datetime.now().strftime('%Y-%m-%d %H:%M:%S')}] 🔁 Resync session {session_id} for user {sender_id}: {sent} move(s) after seq {since_seq}")
+
+            # Billiard lockstep: shots and snapshots go to the opponent as game events
+            elif message_type in ("billiard_shot", "billiard_sync"):
+                from app.api.games import relay_billiard
+
+                sender_id = self.client_to_user.get(client_id)
+                session_id = data.get("session_id")
+                if not sender_id or session_id is None:
+                    return  # Silently ignore, like game_resync
+
+                fields = ("seq", "tick", "angle", "power", "hash", "snapshot")
+                event_data = {"event_type": message_type}
+                event_data.update({key: data[key] for key in fields if data.get(key) is not None})
+                await relay_billiard(int(session_id), sender_id, event_data)
+
             else:
                 # Handle other message types
                 print(f"[{datetime.now().strftime('%Y-%m-%d %H:%M:%S')}] Received message type: {message_type} from {client_id}")
@@ -726,7 +837,7 @@ class WebSocketManager:
                 "message": "Invalid JSON format",
                 "error": str(e)
             }
-            await websocket.send_text(json.dumps(error_response))
+            await self.send_message(websocket, error_response)
         except Exception as e:
             print(f"[{datetime.now().strftime('%Y-%m-%d %H:%M:%S')}] ❌ Error handling message from {client_id}: {str(e)}")
             logger.error(f"WebSocket error: {str(e)}", exc_info=True)
@@ -755,7 +866,17 @@ async def websocket_endpoint(websocket: WebSocket, client_id: str = None):
     try:
         print(f"[{datetime.now().strftime('%Y-%m-%d %H:%M:%S')}] ✅ WebSocket connection established, waiting for messages...")
         while True:
-            data = await websocket.receive_text()
+            frame = await websocket.receive()
+            if frame["type"] == "websocket.disconnect":
+                raise WebSocketDisconnect(frame.get("code", 1000))
+            if frame.get("bytes") is not None:
+                try:
+                    data = wire.decode(frame["bytes"])
+                except ValueError as wire_error:
+                    print(f"[{datetime.now().strftime('%Y-%m-%d %H:%M:%S')}] ❌ Invalid binary frame from {client_id}: {str(wire_error)}")
+                    continue
+            else:
+                data = frame.get("text", "")
             print(f"[{datetime.now().strftime('%Y-%m-%d %H:%M:%S')}] 📨 Received raw message from {client_id}: {data}")
             await websocket_manager.handle_message(websocket, data, client_id)
             
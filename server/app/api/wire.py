@@ -0,0 +1,193 @@
+"""
+Compact binary WebSocket framing ("tlv1") - mirror of src/wire_codec.h.
+
+Negotiated in init: the client sends "wire": "tlv1", the server echoes it in
+init_ack, and from then on the message types below travel as binary frames
+to and from that client. Anything else (or any message with a key/value the
+format can't hold) is still sent as JSON text.
+
+Frame:  0xB1 | type (u8) | field*
+Field:  key (u8) = kind << 6 | tag
+          kind 0  int     zigzag varint
+          kind 1  string  varint length + UTF-8
+          kind 2  false
+          kind 3  true
+        None values are left out.
+
+game_event frames carry the fields of the nested "event" dict directly.
+
+batch frames (client -> server only) hold whole frames instead of fields:
+0xB1 | batch | (varint length + frame)*, decoded to
+{"type": "batch", "messages": [...]}.
+"""
+from typing import Optional
+
+FORMAT_NAME = "tlv1"
+MAGIC = 0xB1
+
+# Index = wire code. Order is part of the protocol: append only.
+TYPES = [
+    None,
+    "chat_message",
+    "typing_start",
+    "typing_stop",
+    "message_delivered",
+    "message_read",
+    "read_receipt",
+    "user_status_update",
+    "game_event",
+    "game_move",
+    "game_move_ack",
+    "game_resync",
+    "batch",
+    "billiard_shot",
+    "billiard_sync",
+]
+
+KEYS = [
+    None,
+    "from_user_id",
+    "to_user_id",
+    "user_id",
+    "message",
+    "message_id",
+    "timestamp",
+    "from_nickname",
+    "status",
+    "session_id",
+    "event_type",
+    "game_type",
+    "host_user_id",
+    "host_nickname",
+    "user_nickname",
+    "accepted",
+    "ready",
+    "row",
+    "col",
+    "seq",
+    "game_status",
+    "winner_id",
+    "current_turn",
+    "max_players",
+    "success",
+    "since_seq",
+    "code",
+    "nickname",
+    "tick",
+    "angle",
+    "power",
+    "hash",
+    "snapshot",
+]
+
+_TYPE_CODES = {name: code for code, name in enumerate(TYPES) if name}
+_KEY_CODES = {name: code for code, name in enumerate(KEYS) if name}
+
+KIND_INT, KIND_STRING, KIND_FALSE, KIND_TRUE = 0, 1, 2, 3
+
+
+def _put_varint(out: bytearray, value: int):
+    while value >= 0x80:
+        out.append((value & 0x7F) | 0x80)
+        value >>= 7
+    out.append(value)
+
+
+def _read_varint(data: bytes, pos: int):
+    value = 0
+    shift = 0
+    while True:
+        if pos >= len(data) or shift > 28:
+            raise ValueError("truncated varint")
+        b = data[pos]
+        pos += 1
+        if shift == 28 and b > 0x0F:
+            raise ValueError("varint over 32 bits")
+        value |= (b & 0x7F) << shift
+        if not b & 0x80:
+            return value, pos
+        shift += 7
+
+
+def encode(message: dict) -> Optional[bytes]:
+    """Binary frame for message, or None if it has to stay JSON."""
+    code = _TYPE_CODES.get(message.get("type"))
+    if code is None:
+        return None
+
+    if code == _TYPE_CODES["game_event"]:
+        fields = message.get("event")
+        if not isinstance(fields, dict) or set(message) - {"type", "event"}:
+            return None
+    else:
+        fields = {k: v for k, v in message.items() if k != "type"}
+
+    out = bytearray((MAGIC, code))
+    for key, value in fields.items():
+        if value is None:
+            continue
+        tag = _KEY_CODES.get(key)
+        if tag is None:
+            return None
+        if isinstance(value, bool):
+            out.append(((KIND_TRUE if value else KIND_FALSE) << 6) | tag)
+        elif isinstance(value, int):
+            if not -(2 ** 31) <= value < 2 ** 31:
+                return None
+            out.append((KIND_INT << 6) | tag)
+            _put_varint(out, ((value << 1) ^ (value >> 31)) & 0xFFFFFFFF)
+        elif isinstance(value, str):
+            raw = value.encode("utf-8")
+            out.append((KIND_STRING << 6) | tag)
+            _put_varint(out, len(raw))
+            out += raw
+        else:
+            return None  # Lists, dicts, floats
+    return bytes(out)
+
+
+def decode(data: bytes) -> dict:
+    """Message dict from a binary frame. Raises ValueError if malformed."""
+    if len(data) < 2 or data[0] != MAGIC:
+        raise ValueError("not a wire frame")
+    if not 0 < data[1] < len(TYPES):
+        raise ValueError(f"unknown wire type {data[1]}")
+
+    if TYPES[data[1]] == "batch":
+        messages = []
+        pos = 2
+        while pos < len(data):
+            length, pos = _read_varint(data, pos)
+            if pos + length > len(data):
+                raise ValueError("truncated batch entry")
+            inner = data[pos:pos + length]
+            if len(inner) >= 2 and inner[1] == data[1]:
+                raise ValueError("nested batch")
+            messages.append(decode(inner))
+            pos += length
+        return {"type": "batch", "messages": messages}
+
+    fields = {}
+    pos = 2
+    while pos < len(data):
+        header = data[pos]
+        pos += 1
+        kind, tag = header >> 6, header & 0x3F
+        if not 0 < tag < len(KEYS):
+            raise ValueError(f"unknown wire key {tag}")
+        if kind == KIND_INT:
+            raw, pos = _read_varint(data, pos)
+            fields[KEYS[tag]] = (raw >> 1) ^ -(raw & 1)
+        elif kind == KIND_STRING:
+            length, pos = _read_varint(data, pos)
+            if pos + length > len(data):
+                raise ValueError("truncated string")
+            fields[KEYS[tag]] = data[pos:pos + length].decode("utf-8")
+            pos += length
+        else:
+            fields[KEYS[tag]] = kind == KIND_TRUE
+
+    message_type = TYPES[data[1]]
+    if message_type == "game_event":
+        return {"type": message_type, "event": fields}
+    return {"type": message_type, **fields}
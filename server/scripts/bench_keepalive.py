@@ -0,0 +1,219 @@
+"""
+Keep-alive vs new-connection benchmark for the ESP32 login-to-lobby flow.
+
+Usage (PowerShell):
+  cd "D:\\tiny game\\server"
+  python scripts/bench_keepalive.py                   # against the server on localhost:8080
+  python scripts/bench_keepalive.py --flows 200
+  python scripts/bench_keepalive.py --standin         # no server needed, see below
+  python scripts/bench_keepalive.py --standin --handshake-ms 30
+
+Only the standard library is used.
+
+Defaults:
+  --host localhost:8080
+  USERNAME = "test"   # user_id=3 in DB
+  PIN = "0000"
+
+One flow = the requests the device makes between login and the lobby:
+  POST /api/login
+  GET  /api/friends/<id>/list
+  GET  /api/notifications/<id>
+  GET  /api/games/active/<id>
+
+Modes:
+  fresh      - "Connection: close" on every request (ApiClient before pooling)
+  keepalive  - one persistent connection (ApiConnectionPool)
+
+Prints requests/second and p50/p99 latency per request for each mode.
+
+--standin starts a local HTTP/1.1 server on a free port that answers the four
+endpoints with canned JSON and benchmarks against it. --handshake-ms makes
+the stand-in wait that long before serving each new connection, a crude model
+of the TCP handshake over Wi-Fi. Numbers from the stand-in measure the
+connection cost only: no database, no FastAPI, loopback network.
+"""
+import argparse
+import http.client
+import json
+import threading
+import time
+from http.server import BaseHTTPRequestHandler, ThreadingHTTPServer
+
+# Default: user 3 in DB (username: test, nickname: Tester)
+USERNAME = "test"
+PIN = "0000"
+
+
+def run_flow(send, latencies):
+    def timed(method, path, body=None):
+        start = time.perf_counter()
+        status, data = send(method, path, body)
+        latencies.append(time.perf_counter() - start)
+        if status != 200:
+            raise RuntimeError(f"{method} {path}: HTTP {status}")
+        return data
+
+    data = json.loads(timed("POST", "/api/login", {"username": USERNAME, "pin": PIN}))
+    user_id = data.get("user_id")
+    if not data.get("success") or not user_id:
+        raise RuntimeError(f"login failed: {data}")
+    timed("GET", f"/api/friends/{user_id}/list")
+    timed("GET", f"/api/notifications/{user_id}")
+    timed("GET", f"/api/games/active/{user_id}")
+
+
+def percentile(sorted_values, fraction):
+    index = min(len(sorted_values) - 1, int(round(fraction * (len(sorted_values) - 1))))
+    return sorted_values[index]
+
+
+def bench(name, send, flows):
+    latencies = []
+    start = time.perf_counter()
+    for _ in range(flows):
+        run_flow(send, latencies)
+    elapsed = time.perf_counter() - start
+
+    latencies.sort()
+    print(
+        f"[{name:9}] {len(latencies)} requests in {elapsed:.2f}s  "
+        f"{len(latencies) / elapsed:7.1f} req/s  "
+        f"p50={percentile(latencies, 0.50) * 1000:6.1f}ms  "
+        f"p99={percentile(latencies, 0.99) * 1000:6.1f}ms"
+    )
+
+
+class Sender:
+    """One request at a time over http.client, like HTTPClient on the device."""
+
+    def __init__(self, host, port, keepalive):
+        self.host = host
+        self.port = port
+        self.keepalive = keepalive
+        self.conn = None
+        self.connections = 0
+
+    def __call__(self, method, path, body=None):
+        if self.conn is None:
+            self.conn = http.client.HTTPConnection(self.host, self.port, timeout=5)
+            self.connections += 1
+        headers = {"Connection": "keep-alive" if self.keepalive else "close"}
+        payload = None
+        if body is not None:
+            payload = json.dumps(body)
+            headers["Content-Type"] = "application/json"
+        try:
+            self.conn.request(method, path, body=payload, headers=headers)
+            resp = self.conn.getresponse()
+            data = resp.read()
+        except (http.client.HTTPException, OSError):
+            # Server dropped an idle connection: reconnect once, like the pool
+            self.close()
+            self.conn = http.client.HTTPConnection(self.host, self.port, timeout=5)
+            self.connections += 1
+            self.conn.request(method, path, body=payload, headers=headers)
+            resp = self.conn.getresponse()
+            data = resp.read()
+        if not self.keepalive or resp.will_close:
+            self.close()
+        return resp.status, data
+
+    def close(self):
+        if self.conn is not None:
+            self.conn.close()
+            self.conn = None
+
+
+# ----- Stand-in server -----
+
+STANDIN_ANSWERS = {
+    "login": {"success": True, "message": "Login successful", "account_exists": True,
+              "user_id": 3, "username": USERNAME, "nickname": "Tester"},
+    "list": "5,alice,1|7,bob,0",
+    "notifications": {"success": True, "notifications": []},
+    "active": {"success": True, "games": []},
+}
+
+
+class StandinHandler(BaseHTTPRequestHandler):
+    protocol_version = "HTTP/1.1"   # Keep-alive unless the client says close
+    disable_nagle_algorithm = True  # Headers and body go out separately, like uvicorn's TCP_NODELAY
+    handshake_ms = 0.0
+
+    def setup(self):
+        if self.handshake_ms > 0:
+            time.sleep(self.handshake_ms / 1000.0)
+        super().setup()
+
+    def answer(self):
+        length = int(self.headers.get("Content-Length") or 0)
+        if length:
+            self.rfile.read(length)
+        key = self.path.rstrip("/").split("/")[-1]
+        if self.path.startswith("/api/notifications/"):
+            key = "notifications"
+        elif self.path.startswith("/api/games/active/"):
+            key = "active"
+        answer = STANDIN_ANSWERS.get(key)
+        if answer is None:
+            self.send_error(404)
+            return
+        body = (answer if isinstance(answer, str) else json.dumps(answer)).encode()
+        self.send_response(200)
+        self.send_header("Content-Type", "application/json")
+        self.send_header("Content-Length", str(len(body)))
+        self.end_headers()
+        self.wfile.write(body)
+
+    do_GET = answer
+    do_POST = answer
+
+    def log_message(self, format, *args):
+        pass
+
+
+def start_standin(handshake_ms):
+    StandinHandler.handshake_ms = handshake_ms
+    server = ThreadingHTTPServer(("127.0.0.1", 0), StandinHandler)
+    server.daemon_threads = True
+    threading.Thread(target=server.serve_forever, daemon=True).start()
+    return server
+
+
+def main():
+    parser = argparse.ArgumentParser()
+    parser.add_argument("--flows", type=int, default=50, help="login-to-lobby flows per mode")
+    parser.add_argument("--host", default="localhost:8080", help="server host:port")
+    parser.add_argument("--standin", action="store_true", help="benchmark a local stand-in instead")
+    parser.add_argument("--handshake-ms", type=float, default=0.0,
+                        help="stand-in delay per new connection (simulated handshake)")
+    args = parser.parse_args()
+
+    server = None
+    if args.standin:
+        server = start_standin(args.handshake_ms)
+        host, port = server.server_address[0], server.server_address[1]
+        print(f"Stand-in on {host}:{port}, handshake {args.handshake_ms:.0f} ms "
+              f"(loopback, canned answers: connection cost only)")
+    else:
+        host, _, port = args.host.partition(":")
+        port = int(port or 80)
+
+    fresh = Sender(host, port, keepalive=False)
+    keepalive = Sender(host, port, keepalive=True)
+
+    # Warm up the server (DB connections, imports) before measuring
+    run_flow(keepalive, [])
+    keepalive.connections = 0
+
+    bench("fresh", fresh, args.flows)
+    bench("keepalive", keepalive, args.flows)
+    print(f"TCP connections opened during the runs: fresh={fresh.connections}  keepalive={keepalive.connections}")
+    keepalive.close()
+    if server is not None:
+        server.shutdown()
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,137 @@
+"""
+Summarize the profiler's CSV stream (see src/profiler.h).
+
+Usage (PowerShell):
+  cd "D:\\tiny game\\server"
+  # On the device: type "prof csv" in the serial monitor, use the app, then
+  # save the monitor output (pio device monitor | Tee-Object serial.log)
+  python scripts/profile_report.py serial.log
+  python scripts/profile_report.py serial.log --top 10 --from-ms 60000
+
+Any other serial output in the log is skipped, so the capture can be the raw
+monitor log. Reads stdin when no file is given.
+
+Report:
+  loop      loops/s, average loop time, per-window worst loop (p50/p95/max)
+  spi       bytes the compositor pushed per second (avg / peak)
+  heap      free heap first/last/lowest, largest free block lowest, and the
+            free-heap trend in bytes/minute (a steady negative trend is a leak)
+  traffic   HTTP requests and WebSocket frames/bytes, totals and per second
+  sections  per Profiler::Scope name: calls, avg/worst time, share of loop time
+"""
+import argparse
+import sys
+
+P_FIELDS = ["ms", "loops", "loop_avg_us", "loop_max_us", "spi_bytes", "heap_free", "heap_largest",
+            "heap_min", "http", "http_ms", "ws_in", "ws_in_bytes", "ws_out", "ws_out_bytes"]
+
+
+def parse(lines, from_ms):
+    windows, sections = [], {}
+    for raw in lines:
+        line = raw.strip()
+        # Monitor filters may prefix a timestamp ("12:00:01.123 > P,...")
+        for tag in ("P,", "S,"):
+            at = line.find(tag)
+            if at >= 0 and (at == 0 or line[at - 1] in " >\t"):
+                line = line[at:]
+                break
+        else:
+            continue
+        parts = line.split(",")
+        try:
+            if parts[0] == "P" and len(parts) == len(P_FIELDS) + 1:
+                w = dict(zip(P_FIELDS, (int(v) for v in parts[1:])))
+                if w["ms"] >= from_ms:
+                    windows.append(w)
+            elif parts[0] == "S" and len(parts) == 6:
+                ms, name = int(parts[1]), parts[2]
+                calls, total, worst = int(parts[3]), int(parts[4]), int(parts[5])
+                if ms < from_ms:
+                    continue
+                s = sections.setdefault(name, {"calls": 0, "total": 0, "max": 0, "windows": 0})
+                s["calls"] += calls
+                s["total"] += total
+                s["max"] = max(s["max"], worst)
+                s["windows"] += 1
+        except ValueError:
+            continue  # Line cut off by a reset or mixed with other output
+    return windows, sections
+
+
+def pct(values, p):
+    values = sorted(values)
+    return values[min(len(values) - 1, int(p / 100.0 * len(values)))]
+
+
+def slope_per_minute(xs_ms, ys):
+    n = len(xs_ms)
+    if n < 2:
+        return 0.0
+    mx, my = sum(xs_ms) / n, sum(ys) / n
+    var = sum((x - mx) ** 2 for x in xs_ms)
+    if var == 0:
+        return 0.0
+    return sum((x - mx) * (y - my) for x, y in zip(xs_ms, ys)) / var * 60000.0
+
+
+def report(windows, sections, top):
+    if not windows:
+        print("No P lines found - was the stream on (\"prof csv\")?")
+        return 1
+    # Windows are equally long; the first one started a window before its timestamp
+    span_s = 1.0
+    if len(windows) > 1:
+        span_s = (windows[-1]["ms"] - windows[0]["ms"]) / 1000.0 * len(windows) / (len(windows) - 1)
+    loops = sum(w["loops"] for w in windows)
+    loop_us = sum(w["loops"] * w["loop_avg_us"] for w in windows)
+    worst = [w["loop_max_us"] / 1000.0 for w in windows]
+    print(f"{len(windows)} windows, {span_s:.0f} s")
+    print(f"loop      {loops / span_s:6.1f}/s, avg {loop_us / max(loops, 1) / 1000.0:.2f} ms, "
+          f"worst per window p50 {pct(worst, 50):.1f} / p95 {pct(worst, 95):.1f} / max {max(worst):.1f} ms")
+
+    spi = [w["spi_bytes"] for w in windows]
+    print(f"spi       avg {sum(spi) / span_s / 1024.0:7.1f} KB/s, peak window {max(spi) / 1024.0:.1f} KB")
+
+    free = [w["heap_free"] for w in windows]
+    if any(free):
+        largest = [w["heap_largest"] for w in windows]
+        trend = slope_per_minute([w["ms"] for w in windows], free)
+        print(f"heap      free {free[0]} -> {free[-1]} (lowest {min(free)}, lowest since boot {windows[-1]['heap_min']}), "
+              f"largest block lowest {min(largest)}, trend {trend:+.0f} B/min")
+    else:
+        print("heap      not sampled (host build)")
+
+    def total(key):
+        return sum(w[key] for w in windows)
+
+    print(f"traffic   http {total('http')} ({total('http') / span_s:.2f}/s, {total('http_ms')} ms leased), "
+          f"ws in {total('ws_in')} frames / {total('ws_in_bytes')} B, "
+          f"ws out {total('ws_out')} frames / {total('ws_out_bytes')} B")
+
+    if sections:
+        print("section                     calls    avg us    max us  loop%")
+        ranked = sorted(sections.items(), key=lambda kv: kv[1]["total"], reverse=True)
+        for name, s in ranked[:top]:
+            share = 100.0 * s["total"] / loop_us if loop_us else 0.0
+            print(f"{name:26s} {s['calls']:7d} {s['total'] / max(s['calls'], 1):9.0f} {s['max']:9d} {share:6.1f}")
+    return 0
+
+
+def main():
+    parser = argparse.ArgumentParser()
+    parser.add_argument("log", nargs="?", help="captured serial output (default: stdin)")
+    parser.add_argument("--top", type=int, default=20, help="sections to list")
+    parser.add_argument("--from-ms", type=int, default=0, help="skip windows before this uptime")
+    args = parser.parse_args()
+
+    if args.log:
+        with open(args.log, encoding="utf-8", errors="replace") as f:
+            windows, sections = parse(f, args.from_ms)
+    else:
+        windows, sections = parse(sys.stdin, args.from_ms)
+    sys.exit(report(windows, sections, args.top))
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,220 @@
+"""
+Scheduler MODEL of the ESP32 task graph (see src/task_layout.h). It does not
+run any firmware code: every task below is a stand-in whose CPU costs are
+assumed, not measured on the device. Use it to reason about what pinning can
+and cannot change; the numbers it prints are not firmware measurements.
+Real per-task load comes from the "tasks" serial command on the device.
+
+Usage (PowerShell):
+  cd "D:\\tiny game\\server"
+  python scripts/task_layout_sim.py                  # 60 s of simulated time per layout
+  python scripts/task_layout_sim.py --seconds 300 --chat-rate 8
+
+Models the ESP-IDF dual-core scheduler: the highest-priority ready task
+allowed on a core runs there, equal priorities round-robin on the 1 ms tick,
+and an unpinned task can run on either core. Compared layouts:
+
+  unpinned - WebSocketTask from xTaskCreate (no affinity), ApiWorkerTask and
+             TftPushTask on core 0, loopTask on core 1 (before task_layout.h)
+  pinned   - every network task on core 0, loopTask alone on core 1
+
+Assumed workload (ms of CPU, drawn per occurrence; estimates, not profiled):
+  loopTask       input poll 0.4, then update/draw (2-6, 5 % full redraws of
+                 25-40), then delay(10)
+  WebSocketTask  wakes every 10 ms, 0.15 + 3-6 per received frame (parse,
+                 JSON tokenize and Serial logging); frames arrive --chat-rate/s
+  ApiWorkerTask  --http-rate jobs/s, 3 ms building the request, 60 ms waiting
+                 for the server, 4 ms reading/parsing the response
+  TftPushTask    priority 2, 0.5 ms per ms of drawing, after each draw
+  Wi-Fi/lwIP     core 0, priority 23, 0.3 ms every 10 ms
+
+A button press at a random moment is seen at the start of the next input
+poll; the report prints that latency (p50/p95/p99/max) and each core's load.
+The firmware counterpart is the "tasks" serial command (TaskLayout::printReport).
+"""
+import argparse
+import random
+
+TICK = 1.0    # FreeRTOS tick (ms)
+STEP = 0.05   # Simulation step (ms)
+
+
+class Task:
+    def __init__(self, name, priority, core):
+        self.name = name
+        self.priority = priority
+        self.core = core          # None = no affinity
+        self.work = 0.0           # CPU ms left in the current burst
+        self.wake_at = 0.0        # Blocked until then
+        self.last_ran = -1.0
+        self.busy = 0.0
+
+    def ready(self, now):
+        return self.work > 0 and now >= self.wake_at
+
+    def burst_done(self, now, sim):
+        pass
+
+
+class LoopTask(Task):
+    def __init__(self, core, rng):
+        super().__init__("loopTask", 1, core)
+        self.rng = rng
+        self.polled = False
+        self.draw = 0.0
+        self.work = 0.4
+
+    def on_start(self, now, sim):
+        if not self.polled:
+            sim.poll_times.append(now)
+            self.polled = True
+
+    def burst_done(self, now, sim):
+        sim.tft.work += 0.5 * self.draw
+        self.draw = self.rng.uniform(25, 40) if self.rng.random() < 0.05 else self.rng.uniform(2, 6)
+        self.work = 0.4 + self.draw
+        self.wake_at = now + 10.0
+        self.polled = False
+
+
+class SocketTask(Task):
+    def __init__(self, core, rng, rate):
+        super().__init__("WebSocketTask", 1, core)
+        self.rng = rng
+        self.rate = rate
+        self.work = 0.15
+
+    def burst_done(self, now, sim):
+        frames = sum(1 for _ in range(10) if self.rng.random() < self.rate / 100.0)
+        self.work = 0.15 + sum(self.rng.uniform(3, 6) for _ in range(frames))
+        self.wake_at = now + 10.0
+
+
+class ApiWorker(Task):
+    def __init__(self, core, rng, rate):
+        super().__init__("ApiWorkerTask", 1, core)
+        self.rng = rng
+        self.rate = rate
+        self.phase = 0
+        self.wake_at = rng.expovariate(rate / 1000.0) if rate > 0 else float("inf")
+        self.work = 3.0
+
+    def burst_done(self, now, sim):
+        if self.phase == 0:
+            self.phase, self.work, self.wake_at = 1, 4.0, now + 60.0
+        else:
+            gap = self.rng.expovariate(self.rate / 1000.0)
+            self.phase, self.work, self.wake_at = 0, 3.0, now + gap
+
+
+class TftPush(Task):
+    def __init__(self, core):
+        super().__init__("TftPushTask", 2, core)
+
+
+class WifiTask(Task):
+    def __init__(self, core):
+        super().__init__("wifi", 23, core)
+        self.work = 0.3
+
+    def burst_done(self, now, sim):
+        self.work, self.wake_at = 0.3, now + 10.0
+
+
+class Sim:
+    def __init__(self, layout, seconds, chat_rate, http_rate, seed):
+        # One generator per source, so both layouts see the same workload
+        socket_core = None if layout == "unpinned" else 0
+        self.loop = LoopTask(1, random.Random(seed))
+        self.tft = TftPush(0)
+        self.tasks = [
+            WifiTask(0), self.tft, self.loop,
+            SocketTask(socket_core, random.Random(seed + 1), chat_rate),
+            ApiWorker(0, random.Random(seed + 2), http_rate),
+        ]
+        self.poll_times = []
+        self.seconds = seconds
+        presses = random.Random(seed + 3)
+        self.presses = [presses.uniform(0, seconds * 1000.0) for _ in range(int(seconds * 20))]
+        self.core_busy = [0.0, 0.0]
+
+    def pick(self, core, now, running, tick):
+        other = running.get(1 - core)  # A task runs on one core at a time
+        candidates = [t for t in self.tasks if t.ready(now) and t.core in (core, None) and t is not other]
+        if not candidates:
+            return None
+        current = running.get(core)
+        top = max(t.priority for t in candidates)
+        peers = [t for t in candidates if t.priority == top]
+        if current in peers and not tick:
+            return current
+        # Time slice over (or preempted): least recently run peer goes next
+        return min(peers, key=lambda t: (t is current, t.last_ran))
+
+    def run(self):
+        running = {}
+        now, end = 0.0, self.seconds * 1000.0
+        next_tick = TICK
+        while now < end:
+            tick = now >= next_tick
+            if tick:
+                next_tick += TICK
+            for core in (0, 1):
+                task = self.pick(core, now, running, tick)
+                if task is None:
+                    running.pop(core, None)
+                    continue
+                if running.get(core) is not task and hasattr(task, "on_start"):
+                    task.on_start(now, self)
+                running[core] = task
+                task.last_ran = now
+                task.work -= STEP
+                task.busy += STEP
+                self.core_busy[core] += STEP
+                if task.work <= 1e-9:
+                    task.work = 0.0
+                    task.burst_done(now + STEP, self)
+            now += STEP
+        return self.report()
+
+    def report(self):
+        polls = self.poll_times
+        latencies = []
+        j = 0
+        for press in sorted(self.presses):
+            while j < len(polls) and polls[j] < press:
+                j += 1
+            if j < len(polls):
+                latencies.append(polls[j] - press)
+        latencies.sort()
+
+        def pct(p):
+            return latencies[min(len(latencies) - 1, int(p / 100.0 * len(latencies)))]
+
+        total = self.seconds * 1000.0
+        return {
+            "p50": pct(50), "p95": pct(95), "p99": pct(99), "max": latencies[-1],
+            "core0": 100.0 * self.core_busy[0] / total, "core1": 100.0 * self.core_busy[1] / total,
+            "loop_hz": len(polls) / self.seconds,
+        }
+
+
+def main():
+    parser = argparse.ArgumentParser()
+    parser.add_argument("--seconds", type=float, default=60.0)
+    parser.add_argument("--chat-rate", type=float, default=5.0, help="socket frames per second")
+    parser.add_argument("--http-rate", type=float, default=0.5, help="HTTP jobs per second")
+    parser.add_argument("--seed", type=int, default=1)
+    args = parser.parse_args()
+
+    print("MODEL: assumed task costs, not measured on the device (see the docstring)")
+    print(f"{args.seconds:.0f} s simulated, {args.chat_rate} frames/s, {args.http_rate} HTTP jobs/s")
+    print("layout     input latency ms (p50 / p95 / p99 / max)   loop Hz   core0 %  core1 %")
+    for layout in ("unpinned", "pinned"):
+        r = Sim(layout, args.seconds, args.chat_rate, args.http_rate, args.seed).run()
+        print(f"{layout:9s}  {r['p50']:6.1f} / {r['p95']:6.1f} / {r['p99']:6.1f} / {r['max']:6.1f}"
+              f"          {r['loop_hz']:6.1f}   {r['core0']:6.1f}   {r['core1']:6.1f}")
+
+
+if __name__ == "__main__":
+    main()
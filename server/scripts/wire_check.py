@@ -0,0 +1,205 @@
+"""
+Round-trip checks for app/api/wire.py (tlv1) and the device's encoder.
+
+Usage (PowerShell):
+  cd "D:\\tiny game\\server"
+  python scripts/wire_check.py                              # wire.py on its own
+  python scripts/wire_check.py --emit server_frames.txt     # frames for wirebench
+  python scripts/wire_check.py --device-frames device_frames.txt
+
+Only the standard library and app/api/wire.py are used.
+
+On its own: every message type the server sends binary goes through
+wire.encode and wire.decode and must come back equal to the dict (None
+values dropped), then json.dumps/json.loads for the JSON size. Malformed
+frames (every truncation, bad magic, unknown type/key, varints over 5 bytes
+or 32 bits, nested batch) must raise ValueError. Prints JSON and tlv1 bytes
+and encode/decode microseconds per type.
+
+Cross-language, with tools/wirebench on the device side:
+  --emit FILE           write "<label> <hex> <json>" lines, then
+                        .pio/build/wirebench/program --server-frames FILE
+                        checks SocketProtocol::decodeEvent gives the same
+                        event for the tlv1 and the JSON of each
+  --device-frames FILE  read what .pio/build/wirebench/program --dump FILE
+                        wrote; wire.decode(tlv1) must equal json.loads(JSON)
+Exits non-zero on any mismatch.
+"""
+import argparse
+import json
+import os
+import sys
+import time
+
+sys.path.insert(0, os.path.join(os.path.dirname(os.path.abspath(__file__)), ".."))
+
+from app.api import wire  # noqa: E402
+
+VIETNAMESE = "Xin chào, bạn khoẻ không? 👋"
+TIMESTAMP = "2026-10-17T01:00:00.123456"
+
+SERVER_FRAMES = [
+    ("chat_message", {"type": "chat_message", "from_user_id": 12, "message": "hey, ban co ranh khong?",
+                      "from_nickname": "Minh", "message_id": "3f2a9c41-000017", "timestamp": TIMESTAMP}),
+    ("chat_message_utf8_escapes", {"type": "chat_message", "from_user_id": 12, "message": VIETNAMESE,
+                                   "from_nickname": "Ngô \"Q\" \\ \t\r\n\x01", "message_id": "a",
+                                   "timestamp": ""}),
+    ("chat_message_500_chars", {"type": "chat_message", "from_user_id": 12,
+                                "message": "".join(chr(ord("a") + i % 26) for i in range(500)),
+                                "from_nickname": "Minh", "message_id": "b", "timestamp": TIMESTAMP}),
+    ("typing_start", {"type": "typing_start", "from_user_id": 12, "from_nickname": "Minh"}),
+    ("typing_stop", {"type": "typing_stop", "from_user_id": 12, "from_nickname": "Minh"}),
+    ("message_delivered", {"type": "message_delivered", "message_id": "3f2a9c41-000017", "status": "delivered",
+                           "timestamp": TIMESTAMP}),
+    ("message_read", {"type": "message_read", "message_id": "3f2a9c41-000017", "timestamp": TIMESTAMP}),
+    ("user_status_update", {"type": "user_status_update", "user_id": 12, "status": "online"}),
+    ("game_event_move", {"type": "game_event", "event": {
+        "event_type": "move", "session_id": 431, "seq": 24, "user_id": 12, "row": 7, "col": 13,
+        "game_status": "playing", "winner_id": None, "current_turn": 9}}),
+    ("game_event_invite", {"type": "game_event", "event": {
+        "event_type": "invite", "session_id": 431, "user_id": 12, "game_type": "caro", "status": "waiting",
+        "host_nickname": "Minh", "user_nickname": "Lan", "accepted": False, "ready": True, "max_players": 2}}),
+    ("game_event_billiard_shot", {"type": "game_event", "event": {
+        "event_type": "billiard_shot", "session_id": 431, "user_id": 12, "seq": 5, "tick": 1250,
+        "angle": -31415, "power": 87, "hash": -1640531527}}),
+    ("game_event_billiard_sync", {"type": "game_event", "event": {
+        "event_type": "billiard_sync", "session_id": 431, "user_id": 12, "seq": 6,
+        "snapshot": "0a1b2c3d4e5f60718293a4b5c6d7e8f9" * 2}}),
+    ("game_move_ack", {"type": "game_move_ack", "session_id": 431, "seq": 24, "success": True,
+                       "message": "Move submitted successfully", "game_status": "completed", "winner_id": 12,
+                       "current_turn": 9}),
+    ("game_move_ack_limits", {"type": "game_move_ack", "session_id": 2 ** 31 - 1, "seq": 0, "success": False,
+                              "message": "Not your turn", "winner_id": -(2 ** 31)}),
+]
+
+MALFORMED = [
+    ("bad magic", bytes((0xB2, 9, 0x11, 0x02))),
+    ("unknown type", bytes((wire.MAGIC, len(wire.TYPES), 0x11, 0x02))),
+    ("type 0", bytes((wire.MAGIC, 0, 0x11, 0x02))),
+    ("unknown key", bytes((wire.MAGIC, 9, len(wire.KEYS), 0x02))),
+    ("varint over 5 bytes", bytes((wire.MAGIC, 9, 0x11, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0x01))),
+    ("varint above 32 bits", bytes((wire.MAGIC, 9, 0x11, 0xFF, 0xFF, 0xFF, 0xFF, 0x1F))),
+    ("string longer than the frame", bytes((wire.MAGIC, 1, 0x44, 0x05, 0x61, 0x62))),
+    ("nested batch", bytes((wire.MAGIC, 12, 0x02, wire.MAGIC, 12))),
+]
+
+
+def check(condition, what):
+    print(f"  {what:<60} {'ok' if condition else 'FAILED'}")
+    return condition
+
+
+def without_none(message):
+    """What decode() gives back: None values are left out of the frame."""
+    if message["type"] == "game_event":
+        return {"type": "game_event", "event": {k: v for k, v in message["event"].items() if v is not None}}
+    return {k: v for k, v in message.items() if v is not None}
+
+
+def per_call_us(fn, iterations):
+    start = time.perf_counter()
+    for _ in range(iterations):
+        fn()
+    return (time.perf_counter() - start) * 1e6 / iterations
+
+
+def self_check(iterations):
+    ok = True
+    print(f"Server -> device ({iterations} iterations; bytes = payload)")
+    print(f"{'':28} {'JSON':>6} {'tlv1':>6} {'ratio':>6}   {'enc JSON':>9} {'enc tlv1':>9}   {'dec JSON':>9} {'dec tlv1':>9}")
+    bad = []
+    for label, message in SERVER_FRAMES:
+        text = json.dumps(message)
+        frame = wire.encode(message)
+        if frame is None or wire.decode(frame) != without_none(message):
+            bad.append(label)
+            continue
+        print(f"{label:<28} {len(text):>6} {len(frame):>6} {len(text) / len(frame):>5.1f}x   "
+              f"{per_call_us(lambda: json.dumps(message), iterations):>6.2f} us "
+              f"{per_call_us(lambda: wire.encode(message), iterations):>6.2f} us   "
+              f"{per_call_us(lambda: json.loads(text), iterations):>6.2f} us "
+              f"{per_call_us(lambda: wire.decode(frame), iterations):>6.2f} us")
+
+    print("\nChecks:")
+    for label in bad:
+        print(f"    {label}: does not round-trip")
+    ok &= check(not bad, f"{len(SERVER_FRAMES)} server frames round-trip through wire.py")
+
+    ok &= check(wire.encode({"type": "chat_message", "message": [1]}) is None, "list value stays JSON")
+    ok &= check(wire.encode({"type": "chat_message", "unknown_key": 1}) is None, "unknown key stays JSON")
+    ok &= check(wire.encode({"type": "game_move_ack", "seq": 2 ** 31}) is None, "int beyond int32 stays JSON")
+    ok &= check(wire.encode({"type": "init_ack"}) is None, "untyped message stays JSON")
+
+    prefixes = wrong = 0
+    for label, message in SERVER_FRAMES:
+        frame = wire.encode(message)
+        full = len(wire.decode(frame).get("event", wire.decode(frame)))
+        for cut in range(len(frame)):
+            prefixes += 1
+            try:
+                decoded = wire.decode(frame[:cut])
+            except ValueError:
+                continue
+            if len(decoded.get("event", decoded)) >= full:
+                wrong += 1
+    ok &= check(wrong == 0, f"{prefixes} truncated frames rejected or shorter")
+
+    for label, frame in MALFORMED:
+        try:
+            wire.decode(frame)
+            rejected = False
+        except ValueError:
+            rejected = True
+        ok &= check(rejected, f"{label} rejected")
+    return ok
+
+
+def emit(path):
+    with open(path, "w", encoding="ascii") as out:
+        for label, message in SERVER_FRAMES:
+            # What websocket.py sends: json.dumps defaults (ensure_ascii, ", " separators)
+            out.write(f"{label} {wire.encode(message).hex()} {json.dumps(message)}\n")
+    print(f"Wrote {len(SERVER_FRAMES)} server frames to {path}")
+
+
+def device_frames(path):
+    count = 0
+    bad = []
+    with open(path, encoding="utf-8", newline="\n") as lines:
+        for line in lines:
+            label, hex_frame, text = line.rstrip("\n").split(" ", 2)
+            count += 1
+            try:
+                from_json = json.loads(text)
+            except ValueError as e:
+                bad.append(f"{label}: JSON does not parse ({e})")
+                continue
+            try:
+                from_wire = wire.decode(bytes.fromhex(hex_frame))
+            except ValueError as e:
+                bad.append(f"{label}: tlv1 does not decode ({e})")
+                continue
+            if from_wire != from_json:
+                bad.append(f"{label}: {from_wire} != {from_json}")
+    for line in bad:
+        print(f"    {line}")
+    return check(count > 0 and not bad, f"{count} device frames: wire.decode equals json.loads")
+
+
+def main():
+    parser = argparse.ArgumentParser()
+    parser.add_argument("--iterations", type=int, default=20000, help="timing iterations per type")
+    parser.add_argument("--emit", metavar="FILE", help="write server frames for wirebench --server-frames")
+    parser.add_argument("--device-frames", metavar="FILE", help="check frames from wirebench --dump")
+    args = parser.parse_args()
+
+    ok = self_check(max(1, args.iterations))
+    if args.device_frames:
+        ok &= device_frames(args.device_frames)
+    if args.emit:
+        emit(args.emit)
+    sys.exit(0 if ok else 1)
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,167 @@
+"""
+Local WebSocket stand-in for measuring the ESP32's outbound socket traffic.
+
+Usage (PowerShell):
+  cd "D:\\tiny game\\server"
+  python scripts/ws_standin.py                 # listens on 0.0.0.0:8080/ws
+  python scripts/ws_standin.py --no-batch      # refuse batching (one message per frame)
+  python scripts/ws_standin.py --json          # refuse the binary wire format
+  python scripts/ws_standin.py --drop-every 5  # drop the connection every ~5 s
+
+Point the device at this machine (socketManager->begin(<pc ip>, 8080, "/ws")),
+open a chat and type fast. The stand-in answers init/ping like the real
+server but forwards nothing; it only counts what arrives.
+
+Every second it prints frames/s, messages/s and bytes/s. On Ctrl+C it prints
+the totals and an estimate of radio-on time: each received frame is assumed
+to keep the device's radio awake for --tail ms (TX plus the modem-sleep
+tail), and overlapping windows are merged.
+
+Chat messages are answered with message_delivered like a server whose
+recipient is online, and a repeated message_id is acked again without
+counting it twice (same as the real server). With --drop-every the stand-in
+closes the socket at random points, so the device's chat outbox has to
+re-send; the exit summary lists distinct messages delivered, suppressed
+repeats, and any numbered messages ("... #<n>") that never arrived.
+"""
+import argparse
+import asyncio
+import json
+import os
+import random
+import re
+import sys
+import time
+
+import websockets
+
+sys.path.insert(0, os.path.join(os.path.dirname(__file__), ".."))
+from app.api import wire  # noqa: E402
+
+
+class Counters:
+    def __init__(self):
+        self.frames = 0
+        self.messages = 0
+        self.bytes = 0
+        self.by_type = {}
+        self.frame_times = []
+        self.chat_ids = set()
+        self.chat_numbers = set()
+        self.chat_repeats = 0
+        self.drops = 0
+
+    def add(self, raw, message):
+        self.frames += 1
+        self.bytes += len(raw)
+        self.frame_times.append(time.monotonic())
+        items = message.get("messages", []) if message.get("type") == "batch" else [message]
+        for item in items:
+            self.messages += 1
+            self.by_type[item.get("type")] = self.by_type.get(item.get("type"), 0) + 1
+
+
+def radio_on_ms(frame_times, tail_ms):
+    total = 0.0
+    window_end = None
+    for t in frame_times:
+        start, end = t * 1000.0, t * 1000.0 + tail_ms
+        if window_end is None or start >= window_end:
+            total += tail_ms
+        elif end > window_end:
+            total += end - window_end
+        window_end = end if window_end is None else max(window_end, end)
+    return total
+
+
+async def main():
+    parser = argparse.ArgumentParser()
+    parser.add_argument("--port", type=int, default=8080)
+    parser.add_argument("--no-batch", action="store_true")
+    parser.add_argument("--json", action="store_true")
+    parser.add_argument("--tail", type=float, default=40.0, help="radio-on ms per frame")
+    parser.add_argument("--drop-every", type=float, default=0.0, help="mean seconds between forced disconnects")
+    args = parser.parse_args()
+
+    counters = Counters()
+    started = time.monotonic()
+
+    async def deliver(ws, message):
+        message_id = message.get("message_id", "")
+        if message_id in counters.chat_ids:
+            counters.chat_repeats += 1
+        else:
+            counters.chat_ids.add(message_id)
+            number = re.search(r"#(\d+)", message.get("message", ""))
+            if number:
+                counters.chat_numbers.add(int(number.group(1)))
+        await ws.send(json.dumps({"type": "message_delivered", "message_id": message_id}))
+
+    async def drop_later(ws):
+        await asyncio.sleep(random.uniform(0.5, 1.5) * args.drop_every)
+        counters.drops += 1
+        await ws.close()
+
+    async def handle(ws, path=None):
+        print(f"Device connected from {ws.remote_address}")
+        dropper = asyncio.ensure_future(drop_later(ws)) if args.drop_every > 0 else None
+        try:
+            await serve_device(ws)
+        except websockets.ConnectionClosed:
+            pass
+        finally:
+            if dropper:
+                dropper.cancel()
+
+    async def serve_device(ws):
+        async for raw in ws:
+            message = wire.decode(raw) if isinstance(raw, bytes) else json.loads(raw)
+            if message.get("type") == "init":
+                ack = {"type": "init_ack", "status": "success"}
+                if message.get("wire") == wire.FORMAT_NAME and not args.json:
+                    ack["wire"] = wire.FORMAT_NAME
+                if message.get("batch") and not args.no_batch:
+                    ack["batch"] = True
+                await ws.send(json.dumps(ack))
+                continue
+            if message.get("type") == "ping":
+                await ws.send(json.dumps({"type": "pong"}))
+                continue
+            counters.add(raw, message)
+            items = message.get("messages", []) if message.get("type") == "batch" else [message]
+            for item in items:
+                if item.get("type") == "chat_message":
+                    await deliver(ws, item)
+
+    async def report():
+        last = (0, 0, 0)
+        while True:
+            await asyncio.sleep(1.0)
+            now = (counters.frames, counters.messages, counters.bytes)
+            if now != last:
+                print(f"{now[0] - last[0]:4d} frames/s  {now[1] - last[1]:4d} msgs/s  {now[2] - last[2]:6d} B/s")
+            last = now
+
+    async with websockets.serve(handle, "0.0.0.0", args.port):
+        print(f"Stand-in listening on ws://0.0.0.0:{args.port}/ws")
+        try:
+            await report()
+        finally:
+            elapsed = time.monotonic() - started
+            print(f"\n{counters.frames} frames, {counters.messages} messages, {counters.bytes} bytes in {elapsed:.1f}s")
+            print(f"by type: {counters.by_type}")
+            print(f"radio-on estimate: {radio_on_ms(counters.frame_times, args.tail):.0f} ms (tail {args.tail:.0f} ms/frame)")
+            if counters.chat_ids:
+                print(f"chat: {len(counters.chat_ids)} delivered, {counters.chat_repeats} repeats suppressed, "
+                      f"{counters.drops} forced disconnects")
+                if counters.chat_numbers:
+                    expected = set(range(min(counters.chat_numbers), max(counters.chat_numbers) + 1))
+                    missing = sorted(expected - counters.chat_numbers)
+                    print(f"missing numbered messages: {missing if missing else 'none'}")
+
+
+if __name__ == "__main__":
+    try:
+        asyncio.run(main())
+    except KeyboardInterrupt:
+        pass
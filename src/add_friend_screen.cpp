@@ -1,4 +1,6 @@
 #include "add_friend_screen.h"
+#include "tft_compositor.h"
+#include "profiler.h"
 
 // Deep Space Arcade Theme (matching Buddy List Screen)
 #define FRIEND_BG_DARK   0x0042  // Deep Midnight Blue #020817
@@ -64,6 +66,8 @@ void AddFriendScreen::updateInputArea(bool showErrorMsg) {
 }
 
 void AddFriendScreen::draw() {
+    Profiler::Scope profile("AddFriendScreen.draw");
+    TftCompositor::Frame frame("AddFriendScreen");
     drawBackground();
 
     // Header bar matching BuddyListScreen style
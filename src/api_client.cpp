@@ -1,231 +1,5 @@
 #include "api_client.h"
-
-// Helper: Parse login response string manually
-void ApiClient::parseLoginResponse(const String& response, LoginResult& result) {
-    result.success = false;
-    result.accountExists = false;
-    result.user_id = -1;
-    result.username = "";
-    result.message = "";
-    
-    // Parse response string manually using indexOf and substring
-    
-    // Check success
-    int successIdx = response.indexOf("\"success\":");
-    if (successIdx >= 0) {
-        int valueStart = response.indexOf(":", successIdx) + 1;
-        int valueEnd = response.indexOf(",", valueStart);
-        if (valueEnd < 0) valueEnd = response.indexOf("}", valueStart);
-        String successStr = response.substring(valueStart, valueEnd);
-        successStr.trim();
-        result.success = (successStr == "true");
-    }
-    
-    // Check account_exists
-    int accountExistsIdx = response.indexOf("\"account_exists\":");
-    if (accountExistsIdx >= 0) {
-        int valueStart = response.indexOf(":", accountExistsIdx) + 1;
-        int valueEnd = response.indexOf(",", valueStart);
-        if (valueEnd < 0) valueEnd = response.indexOf("}", valueStart);
-        String existsStr = response.substring(valueStart, valueEnd);
-        existsStr.trim();
-        result.accountExists = (existsStr == "true");
-    }
-    
-    // Get message
-    int messageIdx = response.indexOf("\"message\":\"");
-    if (messageIdx >= 0) {
-        int valueStart = messageIdx + 10; // length of "message":"
-        int valueEnd = response.indexOf("\"", valueStart);
-        if (valueEnd > valueStart) {
-            result.message = response.substring(valueStart, valueEnd);
-        }
-    }
-    
-    // Get user_id
-    int userIdIdx = response.indexOf("\"user_id\":");
-    if (userIdIdx >= 0) {
-        int valueStart = response.indexOf(":", userIdIdx) + 1;
-        int valueEnd = response.indexOf(",", valueStart);
-        if (valueEnd < 0) valueEnd = response.indexOf("}", valueStart);
-        String userIdStr = response.substring(valueStart, valueEnd);
-        userIdStr.trim();
-        if (userIdStr.length() > 0 && userIdStr != "null") {
-            result.user_id = userIdStr.toInt();
-        }
-    }
-    
-    // Get username
-    int usernameIdx = response.indexOf("\"username\":\"");
-    if (usernameIdx >= 0) {
-        int valueStart = usernameIdx + 12; // length of "username":"
-        int valueEnd = response.indexOf("\"", valueStart);
-        if (valueEnd > valueStart) {
-            result.username = response.substring(valueStart, valueEnd);
-        }
-    }
-    
-    // Get nickname
-    int nicknameIdx = response.indexOf("\"nickname\":\"");
-    if (nicknameIdx >= 0) {
-        int valueStart = nicknameIdx + 12; // length of "nickname":"
-        int valueEnd = response.indexOf("\"", valueStart);
-        if (valueEnd > valueStart) {
-            result.nickname = response.substring(valueStart, valueEnd);
-        }
-    } else {
-        // Fallback to username if nickname not found
-        result.nickname = result.username;
-    }
-}
-
-// Helper: Parse register response string
-bool ApiClient::parseRegisterResponse(const String& response) {
-    int successIdx = response.indexOf("\"success\":");
-    if (successIdx >= 0) {
-        int valueStart = response.indexOf(":", successIdx) + 1;
-        int valueEnd = response.indexOf(",", valueStart);
-        if (valueEnd < 0) valueEnd = response.indexOf("}", valueStart);
-        String successStr = response.substring(valueStart, valueEnd);
-        successStr.trim();
-        return (successStr == "true");
-    }
-    return false;
-}
-
-// Helper: Parse friend request response string
-void ApiClient::parseFriendRequestResponse(const String& response, FriendRequestResult& result) {
-    result.success = false;
-    result.message = "";
-    result.requestId = -1;
-    result.friendshipId = -1;
-    result.status = "";
-    
-    // Parse success
-    int successIdx = response.indexOf("\"success\":");
-    if (successIdx >= 0) {
-        int valueStart = response.indexOf(":", successIdx) + 1;
-        int valueEnd = response.indexOf(",", valueStart);
-        if (valueEnd < 0) valueEnd = response.indexOf("}", valueStart);
-        String successStr = response.substring(valueStart, valueEnd);
-        successStr.trim();
-        result.success = (successStr == "true");
-    }
-    
-    // Parse message
-    int messageIdx = response.indexOf("\"message\":\"");
-    if (messageIdx >= 0) {
-        int valueStart = messageIdx + 10; // length of "message":"
-        int valueEnd = response.indexOf("\"", valueStart);
-        if (valueEnd > valueStart) {
-            result.message = response.substring(valueStart, valueEnd);
-        }
-    }
-    
-    // Parse request_id
-    int requestIdIdx = response.indexOf("\"request_id\":");
-    if (requestIdIdx >= 0) {
-        int valueStart = response.indexOf(":", requestIdIdx) + 1;
-        int valueEnd = response.indexOf(",", valueStart);
-        if (valueEnd < 0) valueEnd = response.indexOf("}", valueStart);
-        String requestIdStr = response.substring(valueStart, valueEnd);
-        requestIdStr.trim();
-        if (requestIdStr.length() > 0 && requestIdStr != "null") {
-            result.requestId = requestIdStr.toInt();
-        }
-    }
-    
-    // Parse friendship_id
-    int friendshipIdIdx = response.indexOf("\"friendship_id\":");
-    if (friendshipIdIdx >= 0) {
-        int valueStart = response.indexOf(":", friendshipIdIdx) + 1;
-        int valueEnd = response.indexOf(",", valueStart);
-        if (valueEnd < 0) valueEnd = response.indexOf("}", valueStart);
-        String friendshipIdStr = response.substring(valueStart, valueEnd);
-        friendshipIdStr.trim();
-        if (friendshipIdStr.length() > 0 && friendshipIdStr != "null") {
-            result.friendshipId = friendshipIdStr.toInt();
-        }
-    }
-    
-    // Parse status
-    int statusIdx = response.indexOf("\"status\":\"");
-    if (statusIdx >= 0) {
-        int valueStart = statusIdx + 9; // length of "status":"
-        int valueEnd = response.indexOf("\"", valueStart);
-        if (valueEnd > valueStart) {
-            result.status = response.substring(valueStart, valueEnd);
-        }
-    }
-}
-
-// Helper: Parse game session response string
-void ApiClient::parseGameSessionResponse(const String& response, GameSessionResult& result) {
-    result.success = false;
-    result.message = "";
-    result.sessionId = -1;
-    result.status = "";
-    result.participantCount = 0;
-
-    int successIdx = response.indexOf("\"success\":");
-    if (successIdx >= 0) {
-        int valueStart = response.indexOf(":", successIdx) + 1;
-        int valueEnd = response.indexOf(",", valueStart);
-        if (valueEnd < 0) valueEnd = response.indexOf("}", valueStart);
-        String successStr = response.substring(valueStart, valueEnd);
-        successStr.trim();
-        result.success = (successStr == "true");
-    }
-
-    int messageIdx = response.indexOf("\"message\":\"");
-    if (messageIdx >= 0) {
-        int valueStart = messageIdx + 10;
-        int valueEnd = response.indexOf("\"", valueStart);
-        if (valueEnd > valueStart) {
-            result.message = response.substring(valueStart, valueEnd);
-        }
-    }
-
-    int sessionIdx = response.indexOf("\"session_id\":");
-    if (sessionIdx >= 0) {
-        int valueStart = response.indexOf(":", sessionIdx) + 1;
-        int valueEnd = response.indexOf(",", valueStart);
-        if (valueEnd < 0) valueEnd = response.indexOf("}", valueStart);
-        String sessionStr = response.substring(valueStart, valueEnd);
-        sessionStr.trim();
-        if (sessionStr.length() > 0 && sessionStr != "null") {
-            result.sessionId = sessionStr.toInt();
-        }
-    }
-
-    int statusIdx = response.indexOf("\"status\":\"");
-    if (statusIdx >= 0) {
-        int valueStart = statusIdx + 9;
-        int valueEnd = response.indexOf("\"", valueStart);
-        if (valueEnd > valueStart) {
-            result.status = response.substring(valueStart, valueEnd);
-        }
-    }
-
-    // Approximate participant count by counting occurrences of "{"
-    int participantsIdx = response.indexOf("\"participants\":[");
-    if (participantsIdx >= 0) {
-        int arrayStart = response.indexOf("[", participantsIdx);
-        int arrayEnd = response.indexOf("]", participantsIdx);
-        if (arrayStart >= 0 && arrayEnd > arrayStart) {
-            String arrayBody = response.substring(arrayStart, arrayEnd);
-            int count = 0;
-            int pos = 0;
-            while (true) {
-                int bracePos = arrayBody.indexOf("{", pos);
-                if (bracePos < 0) break;
-                count++;
-                pos = bracePos + 1;
-            }
-            result.participantCount = count;
-        }
-    }
-}
+#include "api_connection_pool.h"
 
 ApiClient::LoginResult ApiClient::checkLogin(const String& username, const String& pin, const String& serverHost, uint16_t port) {
     LoginResult result;
@@ -242,7 +16,8 @@ ApiClient::LoginResult ApiClient::checkLogin(const String& username, const Strin
         return result;
     }
     
-    HTTPClient http;
+    ApiConnection connection(serverHost, port);  // Pooled keep-alive socket
+    HTTPClient& http = connection.http();
     String url = "http://" + serverHost + ":" + String(port) + "/api/login";
     
     Serial.println("========================================");
@@ -255,15 +30,10 @@ ApiClient::LoginResult ApiClient::checkLogin(const String& username, const Strin
     Serial.println("****");  // Security: Don't log PIN plaintext
     Serial.println("========================================");
     
-    http.begin(url);
+    connection.begin(url);
     http.addHeader("Content-Type", "application/json");
     
-    // Create payload as string manually
-    String payload = "{\"username\":\"";
-    payload += username;
-    payload += "\",\"pin\":\"";
-    payload += pin;
-    payload += "\"}";
+    String payload = ApiProtocol::loginPayload(username, pin);
     
     Serial.print("API Client: Sending payload: ");
     Serial.println(payload);
@@ -278,7 +48,7 @@ ApiClient::LoginResult ApiClient::checkLogin(const String& username, const Strin
         Serial.println(response);
         
         // Parse response string manually
-        parseLoginResponse(response, result);
+        ApiProtocol::parseLoginResponse(response, result);
         
         Serial.println("========================================");
         Serial.print("API Client: Login result: ");
@@ -316,7 +86,8 @@ bool ApiClient::createAccount(const String& username, const String& pin, const S
         return false;
     }
     
-    HTTPClient http;
+    ApiConnection connection(serverHost, port);  // Pooled keep-alive socket
+    HTTPClient& http = connection.http();
     String url = "http://" + serverHost + ":" + String(port) + "/api/register";
     
     Serial.println("========================================");
@@ -331,17 +102,10 @@ bool ApiClient::createAccount(const String& username, const String& pin, const S
     Serial.println(nickname.length() > 0 ? nickname : "(empty)");
     Serial.println("========================================");
     
-    http.begin(url);
+    connection.begin(url);
     http.addHeader("Content-Type", "application/json");
     
-    // Create payload as string manually
-    String payload = "{\"username\":\"";
-    payload += username;
-    payload += "\",\"pin\":\"";
-    payload += pin;
-    payload += "\",\"nickname\":\"";
-    payload += nickname;  // Always include nickname, even if empty
-    payload += "\"}";
+    String payload = ApiProtocol::registerPayload(username, pin, nickname);
     
     Serial.print("API Client: Sending payload: ");
     Serial.println(payload);
@@ -356,7 +120,7 @@ bool ApiClient::createAccount(const String& username, const String& pin, const S
         Serial.println(response);
         
         // Parse response string manually
-        bool success = parseRegisterResponse(response);
+        bool success = ApiProtocol::parseRegisterResponse(response);
         
         Serial.println("========================================");
         Serial.print("API Client: Create account result: ");
@@ -393,12 +157,13 @@ ApiClient::FriendsListResult ApiClient::getFriends(int userId, const String& ser
         return result;
     }
     
-    HTTPClient http;
+    ApiConnection connection(serverHost, port);  // Pooled keep-alive socket
+    HTTPClient& http = connection.http();
     String url = "http://" + serverHost + ":" + String(port) + "/api/friends/" + String(userId);
     Serial.print("API Client: Getting friends from: ");
     Serial.println(url);
     
-    http.begin(url);
+    connection.begin(url);
     http.setTimeout(5000);
     
     int httpCode = http.GET();
@@ -523,28 +288,18 @@ ApiClient::GameSessionResult ApiClient::createGameSession(int hostUserId, const
         return result;
     }
 
-    HTTPClient http;
+    ApiConnection connection(serverHost, port);  // Pooled keep-alive socket
+    HTTPClient& http = connection.http();
     String url = "http://" + serverHost + ":" + String(port) + "/api/games/create";
     Serial.print("API Client: Creating game session at: ");
     Serial.println(url);
 
-    http.begin(url);
+    connection.begin(url);
     http.addHeader("Content-Type", "application/json");
     http.setTimeout(7000);
 
     // Build participant_ids array
-    String payload = "{\"host_user_id\":";
-    payload += String(hostUserId);
-    payload += ",\"game_type\":\"";
-    payload += gameType;
-    payload += "\",\"max_players\":";
-    payload += String(maxPlayers);
-    payload += ",\"participant_ids\":[";
-    for (int i = 0; i < participantCount; i++) {
-        payload += String(participantIds[i]);
-        if (i < participantCount - 1) payload += ",";
-    }
-    payload += "]}";
+    String payload = ApiProtocol::createGamePayload(hostUserId, gameType, maxPlayers, participantIds, participantCount);
 
     Serial.print("API Client: Payload: ");
     Serial.println(payload);
@@ -557,7 +312,7 @@ ApiClient::GameSessionResult ApiClient::createGameSession(int hostUserId, const
         String response = http.getString();
         Serial.print("API Client: Response: ");
         Serial.println(response);
-        parseGameSessionResponse(response, result);
+        ApiProtocol::parseGameSessionResponse(response, result);
     } else {
         Serial.print("API Client: Create game session failed: ");
         Serial.println(http.errorToString(httpCode));
@@ -582,12 +337,13 @@ ApiClient::GameSessionResult ApiClient::inviteToSession(int sessionId, int hostU
         return result;
     }
 
-    HTTPClient http;
-    String url = "http://" + serverHost + ":" + String(port) + "/api/games/" + String(sessionId) + "/invite";
+    ApiConnection connection(serverHost, port);  // Pooled keep-alive socket
+    HTTPClient& http = connection.http();
+    String url = "http://" + serverHost + ":" + String(port) + ApiProtocol::gamePath(sessionId, "invite");
     Serial.print("API Client: Inviting to session: ");
     Serial.println(url);
 
-    http.begin(url);
+    connection.begin(url);
     http.addHeader("Content-Type", "application/json");
     http.setTimeout(7000);
 
@@ -611,7 +367,7 @@ ApiClient::GameSessionResult ApiClient::inviteToSession(int sessionId, int hostU
         String response = http.getString();
         Serial.print("API Client: Response: ");
         Serial.println(response);
-        parseGameSessionResponse(response, result);
+        ApiProtocol::parseGameSessionResponse(response, result);
     } else {
         Serial.print("API Client: Invite to session failed: ");
         Serial.println(http.errorToString(httpCode));
@@ -636,22 +392,17 @@ ApiClient::GameSessionResult ApiClient::respondGameInvite(int sessionId, int use
         return result;
     }
 
-    HTTPClient http;
-    String url = "http://" + serverHost + ":" + String(port) + "/api/games/" + String(sessionId) + "/respond";
+    ApiConnection connection(serverHost, port);  // Pooled keep-alive socket
+    HTTPClient& http = connection.http();
+    String url = "http://" + serverHost + ":" + String(port) + ApiProtocol::gamePath(sessionId, "respond");
     Serial.print("API Client: Responding to game invite: ");
     Serial.println(url);
 
-    http.begin(url);
+    connection.begin(url);
     http.addHeader("Content-Type", "application/json");
     http.setTimeout(7000);
 
-    String payload = "{\"user_id\":";
-    payload += String(userId);
-    payload += ",\"accept\":";
-    payload += accept ? "true" : "false";
-    payload += ",\"ready_on_accept\":";
-    payload += accept ? "true" : "false";
-    payload += "}";
+    String payload = ApiProtocol::respondInvitePayload(userId, accept);
 
     Serial.print("API Client: Payload: ");
     Serial.println(payload);
@@ -664,7 +415,7 @@ ApiClient::GameSessionResult ApiClient::respondGameInvite(int sessionId, int use
         String response = http.getString();
         Serial.print("API Client: Response: ");
         Serial.println(response);
-        parseGameSessionResponse(response, result);
+        ApiProtocol::parseGameSessionResponse(response, result);
     } else {
         Serial.print("API Client: Respond invite failed: ");
         Serial.println(http.errorToString(httpCode));
@@ -689,20 +440,17 @@ ApiClient::GameSessionResult ApiClient::setGameReady(int sessionId, int userId,
         return result;
     }
 
-    HTTPClient http;
-    String url = "http://" + serverHost + ":" + String(port) + "/api/games/" + String(sessionId) + "/ready";
+    ApiConnection connection(serverHost, port);  // Pooled keep-alive socket
+    HTTPClient& http = connection.http();
+    String url = "http://" + serverHost + ":" + String(port) + ApiProtocol::gamePath(sessionId, "ready");
     Serial.print("API Client: Setting ready state at: ");
     Serial.println(url);
 
-    http.begin(url);
+    connection.begin(url);
     http.addHeader("Content-Type", "application/json");
     http.setTimeout(7000);
 
-    String payload = "{\"user_id\":";
-    payload += String(userId);
-    payload += ",\"ready\":";
-    payload += ready ? "true" : "false";
-    payload += "}";
+    String payload = ApiProtocol::readyPayload(userId, ready);
 
     Serial.print("API Client: Payload: ");
     Serial.println(payload);
@@ -715,7 +463,7 @@ ApiClient::GameSessionResult ApiClient::setGameReady(int sessionId, int userId,
         String response = http.getString();
         Serial.print("API Client: Response: ");
         Serial.println(response);
-        parseGameSessionResponse(response, result);
+        ApiProtocol::parseGameSessionResponse(response, result);
     } else {
         Serial.print("API Client: Ready toggle failed: ");
         Serial.println(http.errorToString(httpCode));
@@ -740,18 +488,17 @@ ApiClient::GameSessionResult ApiClient::leaveGameSession(int sessionId, int user
         return result;
     }
 
-    HTTPClient http;
-    String url = "http://" + serverHost + ":" + String(port) + "/api/games/" + String(sessionId) + "/leave";
+    ApiConnection connection(serverHost, port);  // Pooled keep-alive socket
+    HTTPClient& http = connection.http();
+    String url = "http://" + serverHost + ":" + String(port) + ApiProtocol::gamePath(sessionId, "leave");
     Serial.print("API Client: Leaving game session: ");
     Serial.println(url);
 
-    http.begin(url);
+    connection.begin(url);
     http.addHeader("Content-Type", "application/json");
     http.setTimeout(7000);
 
-    String payload = "{\"user_id\":";
-    payload += String(userId);
-    payload += "}";
+    String payload = ApiProtocol::leavePayload(userId);
 
     Serial.print("API Client: Payload: ");
     Serial.println(payload);
@@ -764,7 +511,7 @@ ApiClient::GameSessionResult ApiClient::leaveGameSession(int sessionId, int user
         String response = http.getString();
         Serial.print("API Client: Response: ");
         Serial.println(response);
-        parseGameSessionResponse(response, result);
+        ApiProtocol::parseGameSessionResponse(response, result);
     } else {
         Serial.print("API Client: Leave session failed: ");
         Serial.println(http.errorToString(httpCode));
@@ -789,22 +536,17 @@ ApiClient::GameMoveResult ApiClient::submitGameMove(int sessionId, int userId, i
         return result;
     }
 
-    HTTPClient http;
-    String url = "http://" + serverHost + ":" + String(port) + "/api/games/" + String(sessionId) + "/move";
+    ApiConnection connection(serverHost, port);  // Pooled keep-alive socket
+    HTTPClient& http = connection.http();
+    String url = "http://" + serverHost + ":" + String(port) + ApiProtocol::gamePath(sessionId, "move");
     Serial.print("API Client: Submitting game move: ");
     Serial.println(url);
 
-    http.begin(url);
+    connection.begin(url);
     http.addHeader("Content-Type", "application/json");
     http.setTimeout(7000);
 
-    String payload = "{\"user_id\":";
-    payload += String(userId);
-    payload += ",\"row\":";
-    payload += String(row);
-    payload += ",\"col\":";
-    payload += String(col);
-    payload += "}";
+    String payload = ApiProtocol::movePayload(userId, row, col);
 
     Serial.print("API Client: Payload: ");
     Serial.println(payload);
@@ -900,12 +642,13 @@ ApiClient::GameStateResult ApiClient::getGameState(int sessionId, const String&
         return result;
     }
 
-    HTTPClient http;
-    String url = "http://" + serverHost + ":" + String(port) + "/api/games/" + String(sessionId) + "/state";
+    ApiConnection connection(serverHost, port);  // Pooled keep-alive socket
+    HTTPClient& http = connection.http();
+    String url = "http://" + serverHost + ":" + String(port) + ApiProtocol::gamePath(sessionId, "state");
     Serial.print("API Client: Getting game state: ");
     Serial.println(url);
 
-    http.begin(url);
+    connection.begin(url);
     http.setTimeout(7000);
 
     int httpCode = http.GET();
@@ -1035,12 +778,13 @@ String ApiClient::getFriendsList(int userId, const String& serverHost, uint16_t
         return result;
     }
     
-    HTTPClient http;
+    ApiConnection connection(serverHost, port);  // Pooled keep-alive socket
+    HTTPClient& http = connection.http();
     String url = "http://" + serverHost + ":" + String(port) + "/api/friends/" + String(userId) + "/list";
     Serial.print("API Client: Getting friends list (string format) from: ");
     Serial.println(url);
     
-    http.begin(url);
+    connection.begin(url);
     http.setTimeout(5000);
     
     int httpCode = http.GET();
@@ -1082,12 +826,13 @@ ApiClient::NotificationsResult ApiClient::getNotifications(int userId, const Str
         return result;
     }
     
-    HTTPClient http;
+    ApiConnection connection(serverHost, port);  // Pooled keep-alive socket
+    HTTPClient& http = connection.http();
     String url = "http://" + serverHost + ":" + String(port) + "/api/notifications/" + String(userId);
     Serial.print("API Client: Getting notifications from: ");
     Serial.println(url);
     
-    http.begin(url);
+    connection.begin(url);
     http.setTimeout(5000);
     
     int httpCode = http.GET();
@@ -1309,29 +1054,18 @@ ApiClient::FriendRequestResult ApiClient::sendFriendRequest(int fromUserId, cons
         return result;
     }
     
-    HTTPClient http;
+    ApiConnection connection(serverHost, port);  // Pooled keep-alive socket
+    HTTPClient& http = connection.http();
     String url = "http://" + serverHost + ":" + String(port) + "/api/friend-requests/send";
     Serial.print("API Client: Sending friend request to: ");
     Serial.println(url);
     
-    http.begin(url);
+    connection.begin(url);
     http.addHeader("Content-Type", "application/json");
     http.setTimeout(10000);  // Increased timeout for reliability (10 seconds)
     
-    // Create payload with trimmed nickname and escape JSON special characters
-    String escapedNickname = trimmedNickname;
-    // Basic JSON escaping (replace " with \", \ with \\, newlines, etc.)
-    escapedNickname.replace("\\", "\\\\");
-    escapedNickname.replace("\"", "\\\"");
-    escapedNickname.replace("\n", "\\n");
-    escapedNickname.replace("\r", "\\r");
-    escapedNickname.replace("\t", "\\t");
-    
-    String payload = "{\"from_user_id\":";
-    payload += String(fromUserId);
-    payload += ",\"to_nickname\":\"";
-    payload += escapedNickname;
-    payload += "\"}";
+    // Trimmed nickname; the builder escapes JSON special characters
+    String payload = ApiProtocol::friendRequestPayload(fromUserId, trimmedNickname);
     
     Serial.print("API Client: Payload: ");
     Serial.println(payload);
@@ -1344,14 +1078,14 @@ ApiClient::FriendRequestResult ApiClient::sendFriendRequest(int fromUserId, cons
         String response = http.getString();
         Serial.print("API Client: Response: ");
         Serial.println(response);
-        parseFriendRequestResponse(response, result);
+        ApiProtocol::parseFriendRequestResponse(response, result);
     } else if (httpCode == HTTP_CODE_BAD_REQUEST || httpCode == 400) {
         // Bad request - try to parse error message
         String error = http.getString();
         Serial.print("API Client: Bad request (400): ");
         Serial.println(error);
         if (error.length() > 0) {
-            parseFriendRequestResponse(error, result);
+            ApiProtocol::parseFriendRequestResponse(error, result);
         } else {
             result.message = "Invalid request. Please check the nickname and try again.";
         }
@@ -1360,7 +1094,7 @@ ApiClient::FriendRequestResult ApiClient::sendFriendRequest(int fromUserId, cons
         Serial.print("API Client: Not found (404): ");
         Serial.println(error);
         if (error.length() > 0) {
-            parseFriendRequestResponse(error, result);
+            ApiProtocol::parseFriendRequestResponse(error, result);
         } else {
             result.message = "User not found";
         }
@@ -1370,7 +1104,7 @@ ApiClient::FriendRequestResult ApiClient::sendFriendRequest(int fromUserId, cons
         Serial.print("API Client: Conflict (409): ");
         Serial.println(error);
         if (error.length() > 0) {
-            parseFriendRequestResponse(error, result);
+            ApiProtocol::parseFriendRequestResponse(error, result);
         } else {
             result.message = "Friend request conflict. You may already be friends or have a pending request.";
         }
@@ -1390,7 +1124,7 @@ ApiClient::FriendRequestResult ApiClient::sendFriendRequest(int fromUserId, cons
         
         // Try to parse error message from response
         if (error.length() > 0) {
-            parseFriendRequestResponse(error, result);
+            ApiProtocol::parseFriendRequestResponse(error, result);
         } else {
             result.message = "Server error (HTTP " + String(httpCode) + "). Please try again later.";
         }
@@ -1434,23 +1168,18 @@ ApiClient::FriendRequestResult ApiClient::acceptFriendRequest(int userId, int no
         return result;
     }
     
-    HTTPClient http;
+    ApiConnection connection(serverHost, port);  // Pooled keep-alive socket
+    HTTPClient& http = connection.http();
     String url = "http://" + serverHost + ":" + String(port) + "/api/friend-requests/accept";
     Serial.print("API Client: Accepting friend request at: ");
     Serial.println(url);
     
     // Configure HTTP client with retry and timeout settings
-    http.begin(url);
+    connection.begin(url);
     http.addHeader("Content-Type", "application/json");
     http.setTimeout(10000);  // Increased timeout for better reliability
-    http.setReuse(true);  // Reuse connection if possible
     
-    // Create payload with validation
-    String payload = "{\"user_id\":";
-    payload += String(userId);
-    payload += ",\"notification_id\":";
-    payload += String(notificationId);
-    payload += "}";
+    String payload = ApiProtocol::notificationPayload(userId, notificationId);
     
     Serial.print("API Client: Payload: ");
     Serial.println(payload);
@@ -1499,7 +1228,7 @@ ApiClient::FriendRequestResult ApiClient::acceptFriendRequest(int userId, int no
     if (httpCode == HTTP_CODE_OK || httpCode == 200) {
         Serial.print("API Client: Response: ");
         Serial.println(response);
-        parseFriendRequestResponse(response, result);
+        ApiProtocol::parseFriendRequestResponse(response, result);
         
         if (!result.success && result.message.length() == 0) {
             result.message = "Failed to accept friend request. Please try again.";
@@ -1509,7 +1238,7 @@ ApiClient::FriendRequestResult ApiClient::acceptFriendRequest(int userId, int no
         Serial.print("API Client: Bad request (400): ");
         Serial.println(response);
         if (response.length() > 0) {
-            parseFriendRequestResponse(response, result);
+            ApiProtocol::parseFriendRequestResponse(response, result);
         }
         if (result.message.length() == 0) {
             result.message = "Invalid request. Please check your input.";
@@ -1519,7 +1248,7 @@ ApiClient::FriendRequestResult ApiClient::acceptFriendRequest(int userId, int no
     } else if (httpCode == HTTP_CODE_CONFLICT || httpCode == 409) {
         // Conflict - request may already be accepted/rejected
         if (response.length() > 0) {
-            parseFriendRequestResponse(response, result);
+            ApiProtocol::parseFriendRequestResponse(response, result);
         }
         if (result.message.length() == 0) {
             result.message = "Friend request status has changed. Please refresh and try again.";
@@ -1536,7 +1265,7 @@ ApiClient::FriendRequestResult ApiClient::acceptFriendRequest(int userId, int no
         Serial.println(response);
         
         if (response.length() > 0) {
-            parseFriendRequestResponse(response, result);
+            ApiProtocol::parseFriendRequestResponse(response, result);
         }
         
         if (result.message.length() == 0) {
@@ -1565,21 +1294,17 @@ ApiClient::FriendRequestResult ApiClient::rejectFriendRequest(int userId, int no
         return result;
     }
     
-    HTTPClient http;
+    ApiConnection connection(serverHost, port);  // Pooled keep-alive socket
+    HTTPClient& http = connection.http();
     String url = "http://" + serverHost + ":" + String(port) + "/api/friend-requests/reject";
     Serial.print("API Client: Rejecting friend request at: ");
     Serial.println(url);
     
-    http.begin(url);
+    connection.begin(url);
     http.addHeader("Content-Type", "application/json");
     http.setTimeout(5000);
     
-    // Create payload
-    String payload = "{\"user_id\":";
-    payload += String(userId);
-    payload += ",\"notification_id\":";
-    payload += String(notificationId);
-    payload += "}";
+    String payload = ApiProtocol::notificationPayload(userId, notificationId);
     
     Serial.print("API Client: Payload: ");
     Serial.println(payload);
@@ -1592,14 +1317,14 @@ ApiClient::FriendRequestResult ApiClient::rejectFriendRequest(int userId, int no
         String response = http.getString();
         Serial.print("API Client: Response: ");
         Serial.println(response);
-        parseFriendRequestResponse(response, result);
+        ApiProtocol::parseFriendRequestResponse(response, result);
     } else {
         String error = http.getString();
         Serial.print("API Client: Reject friend request failed: ");
         Serial.println(error);
         result.message = "HTTP error: " + String(httpCode);
         if (error.length() > 0) {
-            parseFriendRequestResponse(error, result);
+            ApiProtocol::parseFriendRequestResponse(error, result);
         }
     }
     
@@ -1621,12 +1346,13 @@ ApiClient::FriendRequestResult ApiClient::cancelFriendRequest(int fromUserId, in
         return result;
     }
     
-    HTTPClient http;
+    ApiConnection connection(serverHost, port);  // Pooled keep-alive socket
+    HTTPClient& http = connection.http();
     String url = "http://" + serverHost + ":" + String(port) + "/api/friend-requests/cancel";
     Serial.print("API Client: Cancelling friend request at: ");
     Serial.println(url);
     
-    http.begin(url);
+    connection.begin(url);
     http.addHeader("Content-Type", "application/json");
     http.setTimeout(5000);
     
@@ -1648,14 +1374,14 @@ ApiClient::FriendRequestResult ApiClient::cancelFriendRequest(int fromUserId, in
         String response = http.getString();
         Serial.print("API Client: Response: ");
         Serial.println(response);
-        parseFriendRequestResponse(response, result);
+        ApiProtocol::parseFriendRequestResponse(response, result);
     } else {
         String error = http.getString();
         Serial.print("API Client: Cancel friend request failed: ");
         Serial.println(error);
         result.message = "HTTP error: " + String(httpCode);
         if (error.length() > 0) {
-            parseFriendRequestResponse(error, result);
+            ApiProtocol::parseFriendRequestResponse(error, result);
         }
     }
     
@@ -1677,12 +1403,13 @@ ApiClient::FriendRequestResult ApiClient::removeFriend(int userId, int friendId,
         return result;
     }
     
-    HTTPClient http;
+    ApiConnection connection(serverHost, port);  // Pooled keep-alive socket
+    HTTPClient& http = connection.http();
     String url = "http://" + serverHost + ":" + String(port) + "/api/friends/" + String(userId) + "/" + String(friendId);
     Serial.print("API Client: Removing friend at: ");
     Serial.println(url);
     
-    http.begin(url);
+    connection.begin(url);
     http.setTimeout(5000);
     
     int httpCode = http.sendRequest("DELETE");
@@ -1693,14 +1420,14 @@ ApiClient::FriendRequestResult ApiClient::removeFriend(int userId, int friendId,
         String response = http.getString();
         Serial.print("API Client: Response: ");
         Serial.println(response);
-        parseFriendRequestResponse(response, result);
+        ApiProtocol::parseFriendRequestResponse(response, result);
     } else {
         String error = http.getString();
         Serial.print("API Client: Remove friend failed: ");
         Serial.println(error);
         result.message = "HTTP error: " + String(httpCode);
         if (error.length() > 0) {
-            parseFriendRequestResponse(error, result);
+            ApiProtocol::parseFriendRequestResponse(error, result);
         }
     }
     
@@ -4,17 +4,11 @@
 #include <Arduino.h>
 #include <HTTPClient.h>
 #include <WiFi.h>
+#include "api_protocol.h"
 
 class ApiClient {
 public:
-    struct LoginResult {
-        bool success;
-        bool accountExists;
-        String message;
-        int user_id;
-        String username;  // Keep for authentication
-        String nickname;  // Display name for UI
-    };
+    typedef ApiProtocol::LoginResult LoginResult;
     
     struct FriendEntry {
         String nickname;  // Display name (nickname or username fallback)
@@ -44,21 +38,9 @@ public:
         int count;
     };
     
-    struct FriendRequestResult {
-        bool success;
-        String message;
-        int requestId;
-        int friendshipId;  // For accept response
-        String status;  // "pending", "accepted", "rejected"
-    };
+    typedef ApiProtocol::FriendRequestResult FriendRequestResult;
 
-    struct GameSessionResult {
-        bool success;
-        String message;
-        int sessionId;
-        String status;
-        int participantCount;
-    };
+    typedef ApiProtocol::GameSessionResult GameSessionResult;
 
     struct GameMoveResult {
         bool success;
@@ -100,13 +82,6 @@ public:
     static GameMoveResult submitGameMove(int sessionId, int userId, int row, int col, const String& serverHost, uint16_t port);
     static GameStateResult getGameState(int sessionId, const String& serverHost, uint16_t port);
     static void printResponse(const String& response);
-    
-private:
-    // Helper methods to parse response strings manually
-    static void parseLoginResponse(const String& response, LoginResult& result);
-    static bool parseRegisterResponse(const String& response);
-    static void parseFriendRequestResponse(const String& response, FriendRequestResult& result);
-    static void parseGameSessionResponse(const String& response, GameSessionResult& result);
 };
 
 #endif
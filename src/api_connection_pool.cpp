@@ -0,0 +1,113 @@
+#include "api_connection_pool.h"
+#include "profiler.h"
+
+ApiConnectionPool::Slot ApiConnectionPool::slots[ApiConnectionPool::POOL_SIZE];
+portMUX_TYPE ApiConnectionPool::lock = portMUX_INITIALIZER_UNLOCKED;
+ApiConnectionPool::Stats ApiConnectionPool::stats = {0, 0, 0, 0};
+
+ApiConnectionPool::Slot* ApiConnectionPool::acquire(const String& host, uint16_t port) {
+    Slot* match = nullptr;
+    Slot* spare = nullptr;
+
+    portENTER_CRITICAL(&lock);
+    stats.requests++;
+    for (int i = 0; i < POOL_SIZE; i++) {
+        Slot& slot = slots[i];
+        if (slot.inUse) continue;
+        if (slot.port == port && slot.host == host) {
+            match = &slot;
+            break;
+        }
+        // Otherwise repurpose the least recently used free slot
+        if (spare == nullptr || slot.lastUsedMs < spare->lastUsedMs) {
+            spare = &slot;
+        }
+    }
+    Slot* chosen = (match != nullptr) ? match : spare;
+    if (chosen != nullptr) {
+        chosen->inUse = true;
+    } else {
+        stats.oneShot++;
+    }
+    portEXIT_CRITICAL(&lock);
+
+    if (chosen == nullptr) {
+        return nullptr;
+    }
+
+    // Socket work happens outside the critical section
+    if (chosen != match) {
+        chosen->client.stop();  // Was connected to another server
+        chosen->host = host;
+        chosen->port = port;
+    } else if (chosen->client.connected()) {
+        if (millis() - chosen->lastUsedMs > IDLE_TIMEOUT_MS) {
+            chosen->client.stop();  // Server has probably dropped it already
+            stats.evicted++;
+        } else {
+            stats.reused++;
+        }
+    }
+    return chosen;
+}
+
+void ApiConnectionPool::release(Slot* slot) {
+    portENTER_CRITICAL(&lock);
+    slot->lastUsedMs = millis();
+    slot->inUse = false;
+    portEXIT_CRITICAL(&lock);
+}
+
+void ApiConnectionPool::closeAll() {
+    for (int i = 0; i < POOL_SIZE; i++) {
+        portENTER_CRITICAL(&lock);
+        bool busy = slots[i].inUse;
+        if (!busy) slots[i].inUse = true;
+        portEXIT_CRITICAL(&lock);
+        if (busy) continue;
+
+        slots[i].client.stop();
+        release(&slots[i]);
+    }
+}
+
+void ApiConnectionPool::printStats() {
+    Serial.print("API Pool: requests=");
+    Serial.print(stats.requests);
+    Serial.print(", reused=");
+    Serial.print(stats.reused);
+    Serial.print(", evicted=");
+    Serial.print(stats.evicted);
+    Serial.print(", oneShot=");
+    Serial.println(stats.oneShot);
+}
+
+ApiConnection::ApiConnection(const String& host, uint16_t port) {
+    this->slot = ApiConnectionPool::acquire(host, port);
+    this->startMicros = micros();
+    this->oneShotHttp = nullptr;
+    this->oneShotClient = nullptr;
+    if (slot == nullptr) {
+        oneShotClient = new WiFiClient();
+        oneShotHttp = new HTTPClient();
+    }
+}
+
+ApiConnection::~ApiConnection() {
+    Profiler::count(Profiler::COUNTER_HTTP_REQUESTS);
+    Profiler::count(Profiler::COUNTER_HTTP_MICROS, micros() - startMicros);
+    if (slot != nullptr) {
+        ApiConnectionPool::release(slot);
+    } else {
+        delete oneShotHttp;  // Closes the socket
+        delete oneShotClient;
+    }
+}
+
+bool ApiConnection::begin(const String& url) {
+    WiFiClient& client = (slot != nullptr) ? slot->client : *oneShotClient;
+    HTTPClient& request = http();
+    request.setReuse(slot != nullptr);  // Sends "Connection: keep-alive"
+    request.setTimeout(ApiConnectionPool::DEFAULT_TIMEOUT_MS);  // Don't inherit the last caller's timeout
+    return request.begin(client, url);
+}
@@ -0,0 +1,89 @@
+#ifndef API_CONNECTION_POOL_H
+#define API_CONNECTION_POOL_H
+
+#include <Arduino.h>
+#include <HTTPClient.h>
+#include <WiFi.h>
+#include <freertos/FreeRTOS.h>
+
+// Persistent HTTP/1.1 keep-alive connections for ApiClient.
+//
+// HTTPClient closes its socket in the destructor, so a pooled connection
+// keeps both the WiFiClient and the HTTPClient alive between calls. When the
+// next request goes to the same host:port, HTTPClient::connect() finds the
+// socket still open and skips the TCP handshake.
+//
+// - Each slot is used by one caller at a time. The main loop and the
+//   ApiRequestQueue workers share the pool.
+// - A slot idle longer than IDLE_TIMEOUT_MS is closed before reuse, ahead
+//   of uvicorn's 5 s keep-alive timeout, so requests rarely land on a
+//   socket the server has already dropped.
+// - A socket that did die is stopped by HTTPClient when the request fails,
+//   and the next lease reconnects.
+// - If every slot is busy, the lease falls back to a one-shot connection,
+//   like before pooling.
+class ApiConnectionPool {
+public:
+    static const int POOL_SIZE = 3;                    // Main loop + 2 queue workers
+    static const unsigned long IDLE_TIMEOUT_MS = 4000;
+    static const uint16_t DEFAULT_TIMEOUT_MS = 5000;   // HTTPClient default, restored on every lease
+
+    struct Stats {
+        uint32_t requests;   // Leases handed out
+        uint32_t reused;     // Lease found its socket still open
+        uint32_t evicted;    // Idle sockets closed before reuse
+        uint32_t oneShot;    // Pool exhausted, temporary connection
+    };
+
+    // Close every idle socket (e.g. after WiFi drops)
+    static void closeAll();
+    static const Stats& getStats() { return stats; }
+    static void printStats();
+
+private:
+    friend class ApiConnection;
+
+    struct Slot {
+        WiFiClient client;      // Declared first: ~HTTPClient() still stops it
+        HTTPClient http;
+        String host;
+        uint16_t port;
+        unsigned long lastUsedMs;
+        bool inUse;
+    };
+
+    static Slot slots[POOL_SIZE];
+    static portMUX_TYPE lock;
+    static Stats stats;
+
+    // nullptr if every slot is busy
+    static Slot* acquire(const String& host, uint16_t port);
+    static void release(Slot* slot);
+};
+
+// One request's lease on a pooled connection, returned on scope exit.
+//
+//   ApiConnection connection(serverHost, port);
+//   HTTPClient& http = connection.http();
+//   connection.begin(url);
+//   ... http.GET() / http.POST() ...
+//   http.end();   // Keeps the socket open when the server allows it
+class ApiConnection {
+public:
+    ApiConnection(const String& host, uint16_t port);
+    ~ApiConnection();
+
+    HTTPClient& http() { return slot != nullptr ? slot->http : *oneShotHttp; }
+    bool begin(const String& url);
+
+private:
+    ApiConnectionPool::Slot* slot;
+    uint32_t startMicros;          // Lease time, for the profiler's HTTP counters
+    HTTPClient* oneShotHttp;
+    WiFiClient* oneShotClient;
+
+    ApiConnection(const ApiConnection&);
+    ApiConnection& operator=(const ApiConnection&);
+};
+
+#endif
@@ -0,0 +1,332 @@
+#include "api_protocol.h"
+
+String ApiProtocol::loginPayload(const String& username, const String& pin) {
+    String payload = "{\"username\":\"";
+    payload += username;
+    payload += "\",\"pin\":\"";
+    payload += pin;
+    payload += "\"}";
+    return payload;
+}
+
+String ApiProtocol::registerPayload(const String& username, const String& pin, const String& nickname) {
+    String payload = "{\"username\":\"";
+    payload += username;
+    payload += "\",\"pin\":\"";
+    payload += pin;
+    payload += "\",\"nickname\":\"";
+    payload += nickname;  // Always include nickname, even if empty
+    payload += "\"}";
+    return payload;
+}
+
+String ApiProtocol::friendRequestPayload(int fromUserId, const String& toNickname) {
+    String escapedNickname = toNickname;
+    // Basic JSON escaping (replace " with \", \ with \\, newlines, etc.)
+    escapedNickname.replace("\\", "\\\\");
+    escapedNickname.replace("\"", "\\\"");
+    escapedNickname.replace("\n", "\\n");
+    escapedNickname.replace("\r", "\\r");
+    escapedNickname.replace("\t", "\\t");
+
+    String payload = "{\"from_user_id\":";
+    payload += String(fromUserId);
+    payload += ",\"to_nickname\":\"";
+    payload += escapedNickname;
+    payload += "\"}";
+    return payload;
+}
+
+String ApiProtocol::notificationPayload(int userId, int notificationId) {
+    String payload = "{\"user_id\":";
+    payload += String(userId);
+    payload += ",\"notification_id\":";
+    payload += String(notificationId);
+    payload += "}";
+    return payload;
+}
+
+String ApiProtocol::createGamePayload(int hostUserId, const String& gameType, int maxPlayers, const int* participantIds, int participantCount) {
+    String payload = "{\"host_user_id\":";
+    payload += String(hostUserId);
+    payload += ",\"game_type\":\"";
+    payload += gameType;
+    payload += "\",\"max_players\":";
+    payload += String(maxPlayers);
+    payload += ",\"participant_ids\":[";
+    for (int i = 0; i < participantCount; i++) {
+        payload += String(participantIds[i]);
+        if (i < participantCount - 1) payload += ",";
+    }
+    payload += "]}";
+    return payload;
+}
+
+String ApiProtocol::respondInvitePayload(int userId, bool accept) {
+    String payload = "{\"user_id\":";
+    payload += String(userId);
+    payload += ",\"accept\":";
+    payload += accept ? "true" : "false";
+    payload += ",\"ready_on_accept\":";
+    payload += accept ? "true" : "false";
+    payload += "}";
+    return payload;
+}
+
+String ApiProtocol::readyPayload(int userId, bool ready) {
+    String payload = "{\"user_id\":";
+    payload += String(userId);
+    payload += ",\"ready\":";
+    payload += ready ? "true" : "false";
+    payload += "}";
+    return payload;
+}
+
+String ApiProtocol::leavePayload(int userId) {
+    String payload = "{\"user_id\":";
+    payload += String(userId);
+    payload += "}";
+    return payload;
+}
+
+String ApiProtocol::movePayload(int userId, int row, int col) {
+    String payload = "{\"user_id\":";
+    payload += String(userId);
+    payload += ",\"row\":";
+    payload += String(row);
+    payload += ",\"col\":";
+    payload += String(col);
+    payload += "}";
+    return payload;
+}
+
+String ApiProtocol::gamePath(int sessionId, const char* action) {
+    return "/api/games/" + String(sessionId) + "/" + action;
+}
+
+// Helper: Parse login response string manually
+void ApiProtocol::parseLoginResponse(const String& response, LoginResult& result) {
+    result.success = false;
+    result.accountExists = false;
+    result.user_id = -1;
+    result.username = "";
+    result.message = "";
+    
+    // Parse response string manually using indexOf and substring
+    
+    // Check success
+    int successIdx = response.indexOf("\"success\":");
+    if (successIdx >= 0) {
+        int valueStart = response.indexOf(":", successIdx) + 1;
+        int valueEnd = response.indexOf(",", valueStart);
+        if (valueEnd < 0) valueEnd = response.indexOf("}", valueStart);
+        String successStr = response.substring(valueStart, valueEnd);
+        successStr.trim();
+        result.success = (successStr == "true");
+    }
+    
+    // Check account_exists
+    int accountExistsIdx = response.indexOf("\"account_exists\":");
+    if (accountExistsIdx >= 0) {
+        int valueStart = response.indexOf(":", accountExistsIdx) + 1;
+        int valueEnd = response.indexOf(",", valueStart);
+        if (valueEnd < 0) valueEnd = response.indexOf("}", valueStart);
+        String existsStr = response.substring(valueStart, valueEnd);
+        existsStr.trim();
+        result.accountExists = (existsStr == "true");
+    }
+    
+    // Get message
+    int messageIdx = response.indexOf("\"message\":\"");
+    if (messageIdx >= 0) {
+        int valueStart = messageIdx + 11; // length of "message":"
+        int valueEnd = response.indexOf("\"", valueStart);
+        if (valueEnd > valueStart) {
+            result.message = response.substring(valueStart, valueEnd);
+        }
+    }
+    
+    // Get user_id
+    int userIdIdx = response.indexOf("\"user_id\":");
+    if (userIdIdx >= 0) {
+        int valueStart = response.indexOf(":", userIdIdx) + 1;
+        int valueEnd = response.indexOf(",", valueStart);
+        if (valueEnd < 0) valueEnd = response.indexOf("}", valueStart);
+        String userIdStr = response.substring(valueStart, valueEnd);
+        userIdStr.trim();
+        if (userIdStr.length() > 0 && userIdStr != "null") {
+            result.user_id = userIdStr.toInt();
+        }
+    }
+    
+    // Get username
+    int usernameIdx = response.indexOf("\"username\":\"");
+    if (usernameIdx >= 0) {
+        int valueStart = usernameIdx + 12; // length of "username":"
+        int valueEnd = response.indexOf("\"", valueStart);
+        if (valueEnd > valueStart) {
+            result.username = response.substring(valueStart, valueEnd);
+        }
+    }
+    
+    // Get nickname
+    int nicknameIdx = response.indexOf("\"nickname\":\"");
+    if (nicknameIdx >= 0) {
+        int valueStart = nicknameIdx + 12; // length of "nickname":"
+        int valueEnd = response.indexOf("\"", valueStart);
+        if (valueEnd > valueStart) {
+            result.nickname = response.substring(valueStart, valueEnd);
+        }
+    } else {
+        // Fallback to username if nickname not found
+        result.nickname = result.username;
+    }
+}
+
+// Helper: Parse register response string
+bool ApiProtocol::parseRegisterResponse(const String& response) {
+    int successIdx = response.indexOf("\"success\":");
+    if (successIdx >= 0) {
+        int valueStart = response.indexOf(":", successIdx) + 1;
+        int valueEnd = response.indexOf(",", valueStart);
+        if (valueEnd < 0) valueEnd = response.indexOf("}", valueStart);
+        String successStr = response.substring(valueStart, valueEnd);
+        successStr.trim();
+        return (successStr == "true");
+    }
+    return false;
+}
+
+// Helper: Parse friend request response string
+void ApiProtocol::parseFriendRequestResponse(const String& response, FriendRequestResult& result) {
+    result.success = false;
+    result.message = "";
+    result.requestId = -1;
+    result.friendshipId = -1;
+    result.status = "";
+    
+    // Parse success
+    int successIdx = response.indexOf("\"success\":");
+    if (successIdx >= 0) {
+        int valueStart = response.indexOf(":", successIdx) + 1;
+        int valueEnd = response.indexOf(",", valueStart);
+        if (valueEnd < 0) valueEnd = response.indexOf("}", valueStart);
+        String successStr = response.substring(valueStart, valueEnd);
+        successStr.trim();
+        result.success = (successStr == "true");
+    }
+    
+    // Parse message
+    int messageIdx = response.indexOf("\"message\":\"");
+    if (messageIdx >= 0) {
+        int valueStart = messageIdx + 11; // length of "message":"
+        int valueEnd = response.indexOf("\"", valueStart);
+        if (valueEnd > valueStart) {
+            result.message = response.substring(valueStart, valueEnd);
+        }
+    }
+    
+    // Parse request_id
+    int requestIdIdx = response.indexOf("\"request_id\":");
+    if (requestIdIdx >= 0) {
+        int valueStart = response.indexOf(":", requestIdIdx) + 1;
+        int valueEnd = response.indexOf(",", valueStart);
+        if (valueEnd < 0) valueEnd = response.indexOf("}", valueStart);
+        String requestIdStr = response.substring(valueStart, valueEnd);
+        requestIdStr.trim();
+        if (requestIdStr.length() > 0 && requestIdStr != "null") {
+            result.requestId = requestIdStr.toInt();
+        }
+    }
+    
+    // Parse friendship_id
+    int friendshipIdIdx = response.indexOf("\"friendship_id\":");
+    if (friendshipIdIdx >= 0) {
+        int valueStart = response.indexOf(":", friendshipIdIdx) + 1;
+        int valueEnd = response.indexOf(",", valueStart);
+        if (valueEnd < 0) valueEnd = response.indexOf("}", valueStart);
+        String friendshipIdStr = response.substring(valueStart, valueEnd);
+        friendshipIdStr.trim();
+        if (friendshipIdStr.length() > 0 && friendshipIdStr != "null") {
+            result.friendshipId = friendshipIdStr.toInt();
+        }
+    }
+    
+    // Parse status
+    int statusIdx = response.indexOf("\"status\":\"");
+    if (statusIdx >= 0) {
+        int valueStart = statusIdx + 10; // length of "status":"
+        int valueEnd = response.indexOf("\"", valueStart);
+        if (valueEnd > valueStart) {
+            result.status = response.substring(valueStart, valueEnd);
+        }
+    }
+}
+
+// Helper: Parse game session response string
+void ApiProtocol::parseGameSessionResponse(const String& response, GameSessionResult& result) {
+    result.success = false;
+    result.message = "";
+    result.sessionId = -1;
+    result.status = "";
+    result.participantCount = 0;
+
+    int successIdx = response.indexOf("\"success\":");
+    if (successIdx >= 0) {
+        int valueStart = response.indexOf(":", successIdx) + 1;
+        int valueEnd = response.indexOf(",", valueStart);
+        if (valueEnd < 0) valueEnd = response.indexOf("}", valueStart);
+        String successStr = response.substring(valueStart, valueEnd);
+        successStr.trim();
+        result.success = (successStr == "true");
+    }
+
+    int messageIdx = response.indexOf("\"message\":\"");
+    if (messageIdx >= 0) {
+        int valueStart = messageIdx + 11;
+        int valueEnd = response.indexOf("\"", valueStart);
+        if (valueEnd > valueStart) {
+            result.message = response.substring(valueStart, valueEnd);
+        }
+    }
+
+    int sessionIdx = response.indexOf("\"session_id\":");
+    if (sessionIdx >= 0) {
+        int valueStart = response.indexOf(":", sessionIdx) + 1;
+        int valueEnd = response.indexOf(",", valueStart);
+        if (valueEnd < 0) valueEnd = response.indexOf("}", valueStart);
+        String sessionStr = response.substring(valueStart, valueEnd);
+        sessionStr.trim();
+        if (sessionStr.length() > 0 && sessionStr != "null") {
+            result.sessionId = sessionStr.toInt();
+        }
+    }
+
+    int statusIdx = response.indexOf("\"status\":\"");
+    if (statusIdx >= 0) {
+        int valueStart = statusIdx + 10;
+        int valueEnd = response.indexOf("\"", valueStart);
+        if (valueEnd > valueStart) {
+            result.status = response.substring(valueStart, valueEnd);
+        }
+    }
+
+    // Approximate participant count by counting occurrences of "{"
+    int participantsIdx = response.indexOf("\"participants\":[");
+    if (participantsIdx >= 0) {
+        int arrayStart = response.indexOf("[", participantsIdx);
+        int arrayEnd = response.indexOf("]", participantsIdx);
+        if (arrayStart >= 0 && arrayEnd > arrayStart) {
+            String arrayBody = response.substring(arrayStart, arrayEnd);
+            int count = 0;
+            int pos = 0;
+            while (true) {
+                int bracePos = arrayBody.indexOf("{", pos);
+                if (bracePos < 0) break;
+                count++;
+                pos = bracePos + 1;
+            }
+            result.participantCount = count;
+        }
+    }
+}
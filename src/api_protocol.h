@@ -0,0 +1,57 @@
+#ifndef API_PROTOCOL_H
+#define API_PROTOCOL_H
+
+#include <Arduino.h>
+
+// REST request bodies and response parsing shared by ApiClient (over the
+// pooled HTTPClient) and tools/loadgen (over its own sockets). Pure String
+// work: no HTTP, Serial or WiFi in here.
+class ApiProtocol {
+public:
+    struct LoginResult {
+        bool success;
+        bool accountExists;
+        String message;
+        int user_id;
+        String username;  // Keep for authentication
+        String nickname;  // Display name for UI
+    };
+
+    struct FriendRequestResult {
+        bool success;
+        String message;
+        int requestId;
+        int friendshipId;  // For accept response
+        String status;  // "pending", "accepted", "rejected"
+    };
+
+    struct GameSessionResult {
+        bool success;
+        String message;
+        int sessionId;
+        String status;
+        int participantCount;
+    };
+
+    // Request bodies, byte-for-byte what the server has always received
+    static String loginPayload(const String& username, const String& pin);
+    static String registerPayload(const String& username, const String& pin, const String& nickname);
+    static String friendRequestPayload(int fromUserId, const String& toNickname);  // Escapes the nickname
+    static String notificationPayload(int userId, int notificationId);             // accept / reject
+    static String createGamePayload(int hostUserId, const String& gameType, int maxPlayers, const int* participantIds, int participantCount);
+    static String respondInvitePayload(int userId, bool accept);
+    static String readyPayload(int userId, bool ready);
+    static String leavePayload(int userId);
+    static String movePayload(int userId, int row, int col);
+
+    // "/api/games/<id>/<action>"
+    static String gamePath(int sessionId, const char* action);
+
+    // Helper methods to parse response strings manually
+    static void parseLoginResponse(const String& response, LoginResult& result);
+    static bool parseRegisterResponse(const String& response);
+    static void parseFriendRequestResponse(const String& response, FriendRequestResult& result);
+    static void parseGameSessionResponse(const String& response, GameSessionResult& result);
+};
+
+#endif
@@ -0,0 +1,264 @@
+#include "api_request_queue.h"
+#include "task_layout.h"
+
+ApiRequestQueue::Job ApiRequestQueue::jobs[ApiRequestQueue::MAX_JOBS];
+bool ApiRequestQueue::used[ApiRequestQueue::MAX_JOBS] = {false};
+ApiRequestQueue::ResultRing ApiRequestQueue::results[ApiRequestQueue::MAX_WORKERS];
+QueueHandle_t ApiRequestQueue::pendingJobs = nullptr;
+TaskHandle_t ApiRequestQueue::workerHandles[ApiRequestQueue::MAX_WORKERS] = {nullptr};
+int ApiRequestQueue::workerCount = 0;
+ApiRequestQueue::Stats ApiRequestQueue::stats = {0, 0, 0, 0, 0, 0};
+
+bool ApiRequestQueue::begin(int workers) {
+    if (workerCount > 0) {
+        return true;
+    }
+    if (workers < 1) workers = 1;
+    if (workers > MAX_WORKERS) workers = MAX_WORKERS;
+
+    pendingJobs = xQueueCreate(MAX_JOBS, sizeof(uint8_t));
+    if (pendingJobs == nullptr) {
+        Serial.println("API Queue: Could not create job queue, requests stay blocking");
+        return false;
+    }
+
+    for (int i = 0; i < MAX_WORKERS; i++) {
+        results[i].reset();
+    }
+
+    for (int i = 0; i < workers; i++) {
+        // Parameter = worker index -> its result ring
+        BaseType_t ok = TaskLayout::spawn(TaskLayout::ROLE_API_WORKER, workerTask, (void*)(intptr_t)i, &workerHandles[i]);
+        if (ok != pdPASS) {
+            workerHandles[i] = nullptr;
+            break;
+        }
+        workerCount++;
+    }
+
+    if (workerCount == 0) {
+        Serial.println("API Queue: Could not start worker task, requests stay blocking");
+        vQueueDelete(pendingJobs);
+        pendingJobs = nullptr;
+        return false;
+    }
+
+    Serial.print("API Queue: ");
+    Serial.print(workerCount);
+    Serial.print(" worker(s) on core ");
+    Serial.println((int)TaskLayout::getSpec(TaskLayout::ROLE_API_WORKER).core);
+    return true;
+}
+
+// ----- Enqueue (main loop) -----
+
+int ApiRequestQueue::claimSlot(uint8_t type, void* context) {
+    for (int i = 0; i < MAX_JOBS; i++) {
+        if (!used[i]) {
+            used[i] = true;
+            Job& job = jobs[i];
+            job.type = type;
+            job.cancelled = false;
+            job.context = context;
+            job.onGameState = nullptr;
+            job.onGameMove = nullptr;
+            job.onFriendsList = nullptr;
+            job.enqueuedMs = millis();
+            return i;
+        }
+    }
+    stats.rejected++;
+    Serial.println("API Queue: All request slots busy, rejecting request");
+    return -1;
+}
+
+void ApiRequestQueue::submit(int slot) {
+    if (workerCount == 0) {
+        // Not started: behave like the plain ApiClient call
+        stats.inlineCalls++;
+        execute(jobs[slot]);
+        deliver(jobs[slot]);
+        releaseSlot(slot);
+        return;
+    }
+    uint8_t index = (uint8_t)slot;
+    // Never blocks: the queue holds MAX_JOBS and a slot was just claimed
+    xQueueSend(pendingJobs, &index, 0);
+    stats.enqueued++;
+}
+
+void ApiRequestQueue::getGameState(int sessionId, const String& serverHost, uint16_t port,
+                                   OnGameStateCallback callback, void* context) {
+    int slot = claimSlot(JOB_GAME_STATE, context);
+    if (slot < 0) {
+        ApiClient::GameStateResult result;
+        result.success = false;
+        result.message = "Request queue full";
+        if (callback != nullptr) callback(result, context);
+        return;
+    }
+    Job& job = jobs[slot];
+    job.onGameState = callback;
+    job.sessionId = sessionId;
+    job.serverHost = serverHost;
+    job.port = port;
+    submit(slot);
+}
+
+void ApiRequestQueue::submitGameMove(int sessionId, int userId, int row, int col, const String& serverHost, uint16_t port,
+                                     OnGameMoveCallback callback, void* context) {
+    int slot = claimSlot(JOB_GAME_MOVE, context);
+    if (slot < 0) {
+        ApiClient::GameMoveResult result;
+        result.success = false;
+        result.message = "Request queue full";
+        result.moveId = -1;
+        result.winnerId = -1;
+        if (callback != nullptr) callback(result, context);
+        return;
+    }
+    Job& job = jobs[slot];
+    job.onGameMove = callback;
+    job.sessionId = sessionId;
+    job.userId = userId;
+    job.row = row;
+    job.col = col;
+    job.serverHost = serverHost;
+    job.port = port;
+    submit(slot);
+}
+
+void ApiRequestQueue::getFriendsList(int userId, const String& serverHost, uint16_t port,
+                                     OnFriendsListCallback callback, void* context) {
+    int slot = claimSlot(JOB_FRIENDS_LIST, context);
+    if (slot < 0) {
+        if (callback != nullptr) callback(false, String(""), context);
+        return;
+    }
+    Job& job = jobs[slot];
+    job.onFriendsList = callback;
+    job.userId = userId;
+    job.serverHost = serverHost;
+    job.port = port;
+    submit(slot);
+}
+
+// ----- Worker side -----
+
+void ApiRequestQueue::execute(Job& job) {
+    switch (job.type) {
+        case JOB_GAME_STATE:
+            job.gameState = ApiClient::getGameState(job.sessionId, job.serverHost, job.port);
+            break;
+        case JOB_GAME_MOVE:
+            job.gameMove = ApiClient::submitGameMove(job.sessionId, job.userId, job.row, job.col, job.serverHost, job.port);
+            break;
+        case JOB_FRIENDS_LIST:
+            job.friendsList = ApiClient::getFriendsList(job.userId, job.serverHost, job.port);
+            break;
+    }
+}
+
+void ApiRequestQueue::workerTask(void* parameter) {
+    runWorkerTask((int)(intptr_t)parameter);
+    vTaskDelete(NULL);
+}
+
+void ApiRequestQueue::runWorkerTask(int worker) {
+    ResultRing& ring = results[worker];
+    uint8_t index;
+    while (true) {
+        if (xQueueReceive(pendingJobs, &index, portMAX_DELAY) != pdTRUE) {
+            continue;
+        }
+        {
+            TaskLayout::BusyScope busy;
+            execute(jobs[index]);
+        }
+
+        // At most MAX_JOBS jobs exist, so the ring can never be full
+        ring.push(index);
+    }
+}
+
+// ----- Delivery (main loop) -----
+
+void ApiRequestQueue::deliver(Job& job) {
+    if (job.cancelled) {
+        return;
+    }
+    switch (job.type) {
+        case JOB_GAME_STATE:
+            if (job.onGameState != nullptr) job.onGameState(job.gameState, job.context);
+            break;
+        case JOB_GAME_MOVE:
+            if (job.onGameMove != nullptr) job.onGameMove(job.gameMove, job.context);
+            break;
+        case JOB_FRIENDS_LIST:
+            // ApiClient::getFriendsList returns "" both for errors and for no friends
+            if (job.onFriendsList != nullptr) job.onFriendsList(true, job.friendsList, job.context);
+            break;
+    }
+    stats.completed++;
+    uint32_t latency = millis() - job.enqueuedMs;
+    if (latency > stats.maxLatencyMs) stats.maxLatencyMs = latency;
+}
+
+void ApiRequestQueue::releaseSlot(int slot) {
+    // Drop response Strings now instead of holding them until the slot is reused
+    jobs[slot].serverHost = String();
+    jobs[slot].friendsList = String();
+    jobs[slot].gameState = ApiClient::GameStateResult();
+    jobs[slot].gameMove = ApiClient::GameMoveResult();
+    used[slot] = false;
+}
+
+void ApiRequestQueue::poll() {
+    if (workerCount == 0) {
+        return;
+    }
+    unsigned long startMicros = micros();
+    for (int w = 0; w < workerCount; w++) {
+        ResultRing& ring = results[w];
+        uint8_t index;
+        while (ring.pop(index)) {
+            // Callbacks may enqueue again; the slot is freed only afterwards
+            deliver(jobs[index]);
+            releaseSlot(index);
+        }
+    }
+    uint32_t elapsed = micros() - startMicros;
+    if (elapsed > stats.maxPollMicros) stats.maxPollMicros = elapsed;
+}
+
+void ApiRequestQueue::cancel(void* context) {
+    for (int i = 0; i < MAX_JOBS; i++) {
+        if (used[i] && jobs[i].context == context) {
+            jobs[i].cancelled = true;
+        }
+    }
+}
+
+int ApiRequestQueue::getPendingCount() {
+    int count = 0;
+    for (int i = 0; i < MAX_JOBS; i++) {
+        if (used[i]) count++;
+    }
+    return count;
+}
+
+void ApiRequestQueue::printStats() {
+    Serial.print("API Queue: enqueued=");
+    Serial.print(stats.enqueued);
+    Serial.print(", completed=");
+    Serial.print(stats.completed);
+    Serial.print(", inline=");
+    Serial.print(stats.inlineCalls);
+    Serial.print(", rejected=");
+    Serial.print(stats.rejected);
+    Serial.print(", maxLatency=");
+    Serial.print(stats.maxLatencyMs);
+    Serial.print("ms, maxPoll=");
+    Serial.print(stats.maxPollMicros);
+    Serial.println("us");
+}
@@ -0,0 +1,119 @@
+#ifndef API_REQUEST_QUEUE_H
+#define API_REQUEST_QUEUE_H
+
+#include <Arduino.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#include <freertos/queue.h>
+#include "api_client.h"
+#include "spsc_ring.h"
+
+// Non-blocking front end for ApiClient.
+//
+// Callers enqueue a request together with a completion callback and return
+// immediately. Worker tasks (at most MAX_WORKERS, so at most that many HTTP
+// connections at once) run the blocking ApiClient call; finished jobs come
+// back through one lock-free single-producer/single-consumer ring per
+// worker, and poll() - called from loop() - runs the callbacks. Callbacks
+// therefore always run on the main loop and may draw or touch screen state.
+//
+// With one worker requests complete in the order they were enqueued (a move
+// submit is answered before the sync queued after it).
+//
+// Each callback fires exactly once unless cancel() is called for its
+// context first. If the queue is not running, or all MAX_JOBS slots are
+// busy, the callback fires before the enqueue call returns (inline blocking
+// call, or success = false respectively).
+class ApiRequestQueue {
+public:
+    typedef void (*OnGameStateCallback)(const ApiClient::GameStateResult& result, void* context);
+    typedef void (*OnGameMoveCallback)(const ApiClient::GameMoveResult& result, void* context);
+    typedef void (*OnFriendsListCallback)(bool success, const String& friendsList, void* context);
+
+    struct Stats {
+        uint32_t enqueued;      // Requests handed to a worker
+        uint32_t completed;     // Callbacks delivered by poll()
+        uint32_t inlineCalls;   // Ran blocking because the queue was not running
+        uint32_t rejected;      // No free slot
+        uint32_t maxLatencyMs;  // Enqueue -> callback, slowest request
+        uint32_t maxPollMicros; // Longest single poll() (main-loop time spent here)
+    };
+
+    static const int MAX_WORKERS = 2;
+    static const int MAX_JOBS = 8;  // Power of two (result ring size)
+
+    // Start the worker tasks (network core, see task_layout.h). Safe to call more than once.
+    static bool begin(int workers = 1);
+    static bool isRunning() { return workerCount > 0; }
+
+    // Deliver finished requests. Call once per loop().
+    static void poll();
+    // Drop the callbacks of every request queued with this context
+    // (e.g. from a screen's destructor). The HTTP call itself still runs.
+    static void cancel(void* context);
+    // Requests enqueued whose callback has not run yet
+    static int getPendingCount();
+
+    static void getGameState(int sessionId, const String& serverHost, uint16_t port,
+                             OnGameStateCallback callback, void* context);
+    static void submitGameMove(int sessionId, int userId, int row, int col, const String& serverHost, uint16_t port,
+                               OnGameMoveCallback callback, void* context);
+    static void getFriendsList(int userId, const String& serverHost, uint16_t port,
+                               OnFriendsListCallback callback, void* context);
+
+    static const Stats& getStats() { return stats; }
+    static void printStats();
+
+private:
+    enum JobType {
+        JOB_GAME_STATE,
+        JOB_GAME_MOVE,
+        JOB_FRIENDS_LIST
+    };
+
+    struct Job {
+        uint8_t type;
+        bool cancelled;
+        void* context;
+        OnGameStateCallback onGameState;
+        OnGameMoveCallback onGameMove;
+        OnFriendsListCallback onFriendsList;
+        unsigned long enqueuedMs;
+
+        // Request
+        int sessionId;
+        int userId;
+        int row;
+        int col;
+        String serverHost;
+        uint16_t port;
+
+        // Response (written by the worker, read by poll())
+        ApiClient::GameStateResult gameState;
+        ApiClient::GameMoveResult gameMove;
+        String friendsList;
+    };
+
+    // One per worker: the worker pushes finished slot indices, poll() pops
+    typedef SpscRing<uint8_t, MAX_JOBS> ResultRing;
+
+    // Slots are only claimed/released on the main loop, so `used` needs no lock
+    static Job jobs[MAX_JOBS];
+    static bool used[MAX_JOBS];
+    static ResultRing results[MAX_WORKERS];
+    static QueueHandle_t pendingJobs;  // uint8_t slot index
+    static TaskHandle_t workerHandles[MAX_WORKERS];
+    static int workerCount;
+    static Stats stats;
+
+    static int claimSlot(uint8_t type, void* context);
+    static void submit(int slot);
+    static void execute(Job& job);
+    static void deliver(Job& job);
+    static void releaseSlot(int slot);
+
+    static void workerTask(void* parameter);
+    static void runWorkerTask(int worker);
+};
+
+#endif
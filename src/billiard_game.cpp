@@ -1,7 +1,10 @@
 #include <Arduino.h>
 #include "billiard_game.h"
+#include "tft_compositor.h"
+#include "profiler.h"
+#include "socket_manager.h"
 
-BilliardGame::BilliardGame(Adafruit_ST7789* tft) {
+BilliardGame::BilliardGame(Adafruit_ST7789* tft) : lockstep(physics) {
     this->tft = tft;
     this->cueAngle = 0.0f;
     this->oldCueAngle = 0.0f;
@@ -12,18 +15,31 @@ BilliardGame::BilliardGame(Adafruit_ST7789* tft) {
     this->activeBallIndex = 0;
     this->tableDrawn = false;
     this->collisionThisFrame = false;
+    this->balls = physics.getBalls();
+    this->lastPhysicsMs = 0;
     this->lastPowerFillWidth = 0;
     this->powerBarVisible = false;
+    this->online = false;
+    this->onlineHost = false;
+    this->sessionId = -1;
+    this->socketManager = nullptr;
     
     // Initialize old positions
     for (int i = 0; i < BALL_COUNT; i++) {
         oldBallX[i] = 0;
         oldBallY[i] = 0;
     }
+    
+#if BILLIARD_SPRITES
+    buildBackgroundRuns();
+    buildBallSprite();
+#endif
 }
 
 void BilliardGame::init() {
     resetGame();
+    physics.resetClock();
+    lastPhysicsMs = millis();
     tableDrawn = false;
     // Draw table once
     drawTable();
@@ -47,74 +63,19 @@ void BilliardGame::init() {
 }
 
 void BilliardGame::resetGame() {
-    // Initialize cue ball (white) at bottom left
-    balls[0].x = TABLE_X + 80;
-    balls[0].y = TABLE_Y + TABLE_HEIGHT - 40;
-    balls[0].vx = 0.0f;
-    balls[0].vy = 0.0f;
-    balls[0].color = COLOR_CUE_BALL;
-    balls[0].isActive = false;
-    
-    // Initialize target balls in triangle formation (1 cue ball + 8 target balls)
-    // Xếp thành hình tam giác: 1, 2, 3, 2 (tổng 8 quả)
-    float startX = TABLE_X + TABLE_WIDTH - 80;
-    float startY = TABLE_Y + TABLE_HEIGHT / 2;
-    float ballSpacing = 13.0f;  // Khoảng cách giữa các quả bi
-    
-    uint16_t ballColors[8] = {
-        COLOR_BALL1, COLOR_BALL2, COLOR_BALL3, COLOR_BALL4,
-        COLOR_BALL5, COLOR_BALL6, COLOR_BALL7, COLOR_BALL8
-    };
-    
-    int ballIndex = 1;  // Bắt đầu từ quả bi 1 (quả bi 0 là cue ball)
-    
-    // Row 1: 1 ball (center)
-    balls[ballIndex].x = startX;
-    balls[ballIndex].y = startY;
-    balls[ballIndex].vx = 0.0f;
-    balls[ballIndex].vy = 0.0f;
-    balls[ballIndex].color = ballColors[ballIndex - 1];
-    balls[ballIndex].isActive = false;
-    ballIndex++;
-    
-    // Row 2: 2 balls
-    for (int i = 0; i < 2; i++) {
-        balls[ballIndex].x = startX - ballSpacing;
-        balls[ballIndex].y = startY - ballSpacing * 0.5f + ballSpacing * i;
-        balls[ballIndex].vx = 0.0f;
-        balls[ballIndex].vy = 0.0f;
-        balls[ballIndex].color = ballColors[ballIndex - 1];
-        balls[ballIndex].isActive = false;
-        ballIndex++;
-    }
-    
-    // Row 3: 3 balls
-    for (int i = 0; i < 3; i++) {
-        balls[ballIndex].x = startX - ballSpacing * 2;
-        balls[ballIndex].y = startY - ballSpacing + ballSpacing * i;
-        balls[ballIndex].vx = 0.0f;
-        balls[ballIndex].vy = 0.0f;
-        balls[ballIndex].color = ballColors[ballIndex - 1];
-        balls[ballIndex].isActive = false;
-        ballIndex++;
-    }
-    
-    // Row 4: 2 balls (last row)
-    for (int i = 0; i < 2; i++) {
-        balls[ballIndex].x = startX - ballSpacing * 3;
-        balls[ballIndex].y = startY - ballSpacing * 0.5f + ballSpacing * i;
-        balls[ballIndex].vx = 0.0f;
-        balls[ballIndex].vy = 0.0f;
-        balls[ballIndex].color = ballColors[ballIndex - 1];
-        balls[ballIndex].isActive = false;
-        ballIndex++;
+    // Bi trắng ở góc dưới trái, 8 quả bi xếp tam giác 1, 2, 3, 2
+    if (online) {
+        lockstep.start(onlineHost ? 0 : 1);
+    } else {
+        physics.rack();
     }
+    applyBallColors();
     
     cueAngle = 0.0f;
     oldCueAngle = 0.0f;
     cuePower = 0.0f;
     oldCuePower = 0.0f;
-    isAiming = true;
+    isAiming = !online || onlineHost;  // Online: chủ phòng phá bi trước
     isCharging = false;
     
     // Initialize old positions
@@ -124,7 +85,24 @@ void BilliardGame::resetGame() {
     }
 }
 
+void BilliardGame::applyBallColors() {
+    uint16_t ballColors[8] = {
+        COLOR_BALL1, COLOR_BALL2, COLOR_BALL3, COLOR_BALL4,
+        COLOR_BALL5, COLOR_BALL6, COLOR_BALL7, COLOR_BALL8
+    };
+    balls[0].color = COLOR_CUE_BALL;
+    for (int i = 1; i < BALL_COUNT; i++) {
+        balls[i].color = ballColors[(i - 1) % 8];
+    }
+}
+
 void BilliardGame::drawTable() {
+#if BILLIARD_SPRITES
+    // Vẽ bàn từ chính bộ nhớ đệm nền để các tile sau này khớp từng pixel
+    TileRect screen = { 0, 0, SCREEN_WIDTH - 1, SCREEN_HEIGHT - 1 };
+    repaintRect(screen);
+    return;
+#endif
     // Draw black background around table first (to cover any ball parts outside table)
     tft->fillScreen(0x0000);  // Black background
     
@@ -194,10 +172,10 @@ void BilliardGame::drawTable() {
 void BilliardGame::eraseBall(int index) {
     // Erase old ball position by redrawing table background and border
     // Tối ưu: chỉ xóa vị trí cũ, không xóa toàn bộ đường đi để giảm nháy
-    float oldX = oldBallX[index];
-    float oldY = oldBallY[index];
-    float newX = balls[index].x;
-    float newY = balls[index].y;
+    float oldX = (float)oldBallX[index];
+    float oldY = (float)oldBallY[index];
+    float newX = (float)balls[index].x;
+    float newY = (float)balls[index].y;
     
     // Calculate distance moved
     float dx = newX - oldX;
@@ -223,6 +201,13 @@ void BilliardGame::eraseBallAtPosition(float x, float y, int radius) {
     int screenX = (int)x;
     int screenY = SCREEN_HEIGHT - (int)y;
     
+#if BILLIARD_SPRITES
+    // Box of the circle plus the shadow's 1 px offset (left/down)
+    TileRect box = { screenX - radius - 1, screenY - radius, screenX + radius, screenY + radius + 1 };
+    repaintRect(box);
+    return;
+#endif
+    
     // Only erase if within reasonable bounds to avoid drawing off-screen
     if (screenX < -radius || screenX > SCREEN_WIDTH + radius ||
         screenY < -radius || screenY > SCREEN_HEIGHT + radius) {
@@ -266,7 +251,7 @@ void BilliardGame::eraseBallAtPosition(float x, float y, int radius) {
                     (screenX >= TABLE_X - railThickness && screenX <= TABLE_X + TABLE_WIDTH + railThickness &&
                      (screenY + radius >= SCREEN_HEIGHT - TABLE_Y - railThickness ||
                       screenY - radius <= SCREEN_HEIGHT - (TABLE_Y + TABLE_HEIGHT) + railThickness));
-    bool nearPocket = isBallNearPocket(x, y);
+    bool nearPocket = BilliardPhysics::isInAttractionZone(x, y);
     
     if (touchedRail || nearRail) {
         redrawBorderNear(screenX, screenY, radius);
@@ -416,6 +401,13 @@ void BilliardGame::drawBall(int index) {
         return;  // Ball is out of bounds (in pocket)
     }
     
+#if BILLIARD_SPRITES
+    repaintRect(spriteRect((float)ball.x, (float)ball.y));
+    oldBallX[index] = ball.x;
+    oldBallY[index] = ball.y;
+    return;
+#endif
+    
     // Convert to screen coordinates (Y-axis is inverted)
     int screenX = (int)ball.x;
     int screenY = SCREEN_HEIGHT - (int)ball.y;
@@ -426,7 +418,7 @@ void BilliardGame::drawBall(int index) {
     // This keeps the ball's shape and color intact when hitting the border
     
     // Draw ball shadow first (darker circle, offset)
-    tft->fillCircle(screenX - 1, screenY + 1, radius, 0x2104);
+    tft->fillCircle(screenX - 1, screenY + 1, radius, COLOR_BALL_SHADOW);
     
     // Draw ball main body (full circle, keeps shape even when crossing border)
     tft->fillCircle(screenX, screenY, radius, ball.color);
@@ -448,14 +440,19 @@ void BilliardGame::eraseCueStick() {
         return;
     }
     
+#if BILLIARD_SPRITES
+    eraseCueStickAtPosition(oldCueAngle, oldCuePower);
+    return;
+#endif
+    
     Ball& cueBall = balls[activeBallIndex];
     int screenX = (int)cueBall.x;
     int screenY = SCREEN_HEIGHT - (int)cueBall.y;
     
     // Calculate old cue stick position (gậy nằm phía sau, ngược với hướng bắn)
     float oldStickLength = 40.0f + oldCuePower * 0.3f;
-    float oldStickEndX = cueBall.x - cos(oldCueAngle) * (BALL_RADIUS + oldStickLength);
-    float oldStickEndY = cueBall.y - sin(oldCueAngle) * (BALL_RADIUS + oldStickLength);
+    float oldStickEndX = (float)cueBall.x - cos(oldCueAngle) * (BALL_RADIUS + oldStickLength);
+    float oldStickEndY = (float)cueBall.y - sin(oldCueAngle) * (BALL_RADIUS + oldStickLength);
     
     int oldStickEndScreenX = (int)oldStickEndX;
     int oldStickEndScreenY = SCREEN_HEIGHT - (int)oldStickEndY;
@@ -594,14 +591,19 @@ void BilliardGame::eraseCueStick() {
 
 void BilliardGame::eraseCueStickAtPosition(float angle, float power) {
     // Hàm xóa gậy dựa trên góc và lực cụ thể, không phụ thuộc vào isAiming
+#if BILLIARD_SPRITES
+    // Vẽ lại cả hình chữ nhật bao gậy (nền + bi) thay vì từng pixel Bresenham
+    repaintRect(cueStickRect(angle, power));
+    return;
+#endif
     Ball& cueBall = balls[activeBallIndex];
     int screenX = (int)cueBall.x;
     int screenY = SCREEN_HEIGHT - (int)cueBall.y;
     
     // Calculate cue stick position
     float stickLength = 40.0f + power * 0.3f;
-    float stickEndX = cueBall.x - cos(angle) * (BALL_RADIUS + stickLength);
-    float stickEndY = cueBall.y - sin(angle) * (BALL_RADIUS + stickLength);
+    float stickEndX = (float)cueBall.x - cos(angle) * (BALL_RADIUS + stickLength);
+    float stickEndY = (float)cueBall.y - sin(angle) * (BALL_RADIUS + stickLength);
     
     int oldStickEndScreenX = (int)stickEndX;
     int oldStickEndScreenY = SCREEN_HEIGHT - (int)stickEndY;
@@ -749,6 +751,211 @@ uint16_t BilliardGame::getBackgroundColorAt(int screenX, int screenY) {
     return 0x0000;  // Màu đen
 }
 
+#if BILLIARD_SPRITES
+// GFX target that records which drawBall() layer covers each sprite pixel,
+// so the sprite is rasterized by the same fillCircle as the direct path
+class SpriteMaskCanvas : public Adafruit_GFX {
+public:
+    SpriteMaskCanvas(uint8_t* mask, int16_t size) : Adafruit_GFX(size, size) {
+        this->mask = mask;
+        this->size = size;
+    }
+    
+    void drawPixel(int16_t x, int16_t y, uint16_t layer) override {
+        if (x >= 0 && x < size && y >= 0 && y < size) {
+            mask[y * size + x] = (uint8_t)layer;
+        }
+    }
+    
+private:
+    uint8_t* mask;
+    int16_t size;
+};
+
+void BilliardGame::buildBackgroundRuns() {
+    int used = 0;
+    int previousOffset = 0;
+    int previousCount = 0;
+    for (int py = 0; py < SCREEN_HEIGHT; py++) {
+        int offset = used;
+        int count = 0;
+        uint16_t color = 0;
+        for (int px = 0; px < SCREEN_WIDTH; px++) {
+            uint16_t c = getBackgroundColorAt(px, py);
+            if (px > 0 && c == color) continue;
+            color = c;
+            if (used >= MAX_BACKGROUND_RUNS) {
+                Serial.println("BilliardGame: Background run table full");
+                break;
+            }
+            backgroundRuns[used].x = (int16_t)px;
+            backgroundRuns[used].color = c;
+            used++;
+            count++;
+        }
+        
+        // Hàng giống hệt hàng trước thì dùng chung các run
+        if (py > 0 && count == previousCount &&
+            memcmp(&backgroundRuns[offset], &backgroundRuns[previousOffset], count * sizeof(BackgroundRun)) == 0) {
+            used = offset;
+            offset = previousOffset;
+        }
+        rowRunOffset[py] = (uint16_t)offset;
+        rowRunCount[py] = (uint8_t)count;
+        previousOffset = offset;
+        previousCount = count;
+    }
+}
+
+void BilliardGame::buildBallSprite() {
+    memset(ballSprite, SPRITE_CLEAR, sizeof(ballSprite));
+    SpriteMaskCanvas canvas(&ballSprite[0][0], SPRITE_SIZE);
+    // Tâm bi trong sprite: bóng lệch (-1, +1) nằm gọn trong khung 14x14
+    int centerX = BALL_RADIUS + 1;
+    int centerY = BALL_RADIUS;
+    canvas.fillCircle(centerX - 1, centerY + 1, BALL_RADIUS, SPRITE_SHADOW);
+    canvas.fillCircle(centerX, centerY, BALL_RADIUS, SPRITE_BODY);
+    canvas.fillCircle(centerX - 2, centerY - 2, 2, SPRITE_HIGHLIGHT);
+}
+
+bool BilliardGame::isBallVisible(int index) const {
+    const Ball& ball = balls[index];
+    if (ball.x < 0) return false;
+    return !(ball.x < TABLE_X - BALL_RADIUS || ball.x > TABLE_X + TABLE_WIDTH + BALL_RADIUS ||
+             ball.y < TABLE_Y - BALL_RADIUS || ball.y > TABLE_Y + TABLE_HEIGHT + BALL_RADIUS);
+}
+
+BilliardGame::TileRect BilliardGame::spriteRect(float x, float y) {
+    TileRect r;
+    r.x0 = (int)x - BALL_RADIUS - 1;
+    r.y0 = SCREEN_HEIGHT - (int)y - BALL_RADIUS;
+    r.x1 = r.x0 + SPRITE_SIZE - 1;
+    r.y1 = r.y0 + SPRITE_SIZE - 1;
+    return r;
+}
+
+void BilliardGame::renderBallSprite(int index) {
+    Ball& ball = balls[index];
+    bool hasOld = oldBallX[index] >= 0 && oldBallY[index] >= 0;
+    bool hasNew = isBallVisible(index);
+    TileRect oldRect = spriteRect((float)oldBallX[index], (float)oldBallY[index]);
+    TileRect newRect = spriteRect((float)ball.x, (float)ball.y);
+    
+    if (hasOld && hasNew && oldRect.x0 == newRect.x0 && oldRect.y0 == newRect.y0) {
+        return;  // Chưa đổi pixel nào trên màn hình
+    }
+    
+    if (hasOld && hasNew) {
+        TileRect both;
+        both.x0 = oldRect.x0 < newRect.x0 ? oldRect.x0 : newRect.x0;
+        both.y0 = oldRect.y0 < newRect.y0 ? oldRect.y0 : newRect.y0;
+        both.x1 = oldRect.x1 > newRect.x1 ? oldRect.x1 : newRect.x1;
+        both.y1 = oldRect.y1 > newRect.y1 ? oldRect.y1 : newRect.y1;
+        if ((both.x1 - both.x0 + 1) * (both.y1 - both.y0 + 1) <= TILE_PIXELS) {
+            repaintRect(both);
+        } else {
+            // Bi chạy nhanh: hai tile nhỏ rẻ hơn một tile lớn
+            repaintRect(oldRect);
+            repaintRect(newRect);
+        }
+    } else if (hasOld) {
+        repaintRect(oldRect);
+    } else if (hasNew) {
+        repaintRect(newRect);
+    }
+    
+    if (ball.x < 0) {
+        oldBallX[index] = -100;
+        oldBallY[index] = -100;
+    } else {
+        oldBallX[index] = ball.x;
+        oldBallY[index] = ball.y;
+    }
+}
+
+void BilliardGame::repaintRect(TileRect r) {
+    if (r.x0 < 0) r.x0 = 0;
+    if (r.y0 < 0) r.y0 = 0;
+    if (r.x1 >= SCREEN_WIDTH) r.x1 = SCREEN_WIDTH - 1;
+    if (r.y1 >= SCREEN_HEIGHT) r.y1 = SCREEN_HEIGHT - 1;
+    if (r.x0 > r.x1 || r.y0 > r.y1) return;
+    
+    int w = r.x1 - r.x0 + 1;
+    int rowsPerTile = TILE_PIXELS / w;
+    for (int y = r.y0; y <= r.y1; y += rowsPerTile) {
+        int h = (r.y1 - y + 1 < rowsPerTile) ? (r.y1 - y + 1) : rowsPerTile;
+        composeTile(r.x0, y, w, h);
+        pushTile(r.x0, y, w, h);
+    }
+}
+
+void BilliardGame::composeTile(int x, int y, int w, int h) {
+    // Nền: chép các run của từng hàng
+    for (int j = 0; j < h; j++) {
+        const BackgroundRun* runs = &backgroundRuns[rowRunOffset[y + j]];
+        int count = rowRunCount[y + j];
+        uint16_t* out = &tile[j * w];
+        int run = 0;
+        for (int i = 0; i < w; i++) {
+            while (run + 1 < count && runs[run + 1].x <= x + i) run++;
+            out[i] = runs[run].color;
+        }
+    }
+    
+    // Các quả bi chồng lên tile, cùng thứ tự như draw(): bi trắng sau cùng
+    for (int n = 0; n < BALL_COUNT; n++) {
+        int i = (n < BALL_COUNT - 1) ? (n < activeBallIndex ? n : n + 1) : activeBallIndex;
+        if (!isBallVisible(i)) continue;
+        TileRect s = spriteRect((float)balls[i].x, (float)balls[i].y);
+        int x0 = s.x0 > x ? s.x0 : x;
+        int y0 = s.y0 > y ? s.y0 : y;
+        int x1 = s.x1 < x + w - 1 ? s.x1 : x + w - 1;
+        int y1 = s.y1 < y + h - 1 ? s.y1 : y + h - 1;
+        if (x0 > x1 || y0 > y1) continue;
+        
+        uint16_t colors[4] = { 0, COLOR_BALL_SHADOW, balls[i].color,
+                               (uint16_t)(balls[i].color != COLOR_CUE_BALL ? 0xFFFF : balls[i].color) };
+        for (int py = y0; py <= y1; py++) {
+            const uint8_t* mask = ballSprite[py - s.y0];
+            uint16_t* out = &tile[(py - y) * w];
+            for (int px = x0; px <= x1; px++) {
+                uint8_t layer = mask[px - s.x0];
+                if (layer != SPRITE_CLEAR) out[px - x] = colors[layer];
+            }
+        }
+    }
+}
+
+void BilliardGame::pushTile(int x, int y, int w, int h) {
+    TftCompositor* compositor = TftCompositor::getInstance();
+    if (compositor != nullptr && compositor == tft) {
+        compositor->pushTile(x, y, w, h, tile);  // Vào shadow nếu đang compositing
+        return;
+    }
+    tft->startWrite();
+    tft->setAddrWindow(x, y, w, h);
+    tft->writePixels(tile, (uint32_t)w * h, true, false);
+    tft->endWrite();
+}
+
+BilliardGame::TileRect BilliardGame::cueStickRect(float angle, float power) {
+    // Cùng công thức đầu/cuối gậy như drawCueStick(), nới thêm nửa độ dày
+    Ball& cueBall = balls[activeBallIndex];
+    float stickLength = 40.0f + power * 0.3f;
+    int startX = (int)cueBall.x;
+    int startY = SCREEN_HEIGHT - (int)cueBall.y;
+    int endX = (int)((float)cueBall.x - cos(angle) * (BALL_RADIUS + stickLength));
+    int endY = SCREEN_HEIGHT - (int)((float)cueBall.y - sin(angle) * (BALL_RADIUS + stickLength));
+    int pad = 3;
+    TileRect r;
+    r.x0 = (startX < endX ? startX : endX) - pad;
+    r.y0 = (startY < endY ? startY : endY) - pad;
+    r.x1 = (startX > endX ? startX : endX) + pad;
+    r.y1 = (startY > endY ? startY : endY) + pad;
+    return r;
+}
+#endif
+
 void BilliardGame::drawCueStick() {
     if (!isAiming || balls[activeBallIndex].isActive) {
         return;  // Don't draw cue stick if not aiming or ball is moving
@@ -761,8 +968,8 @@ void BilliardGame::drawCueStick() {
     // Calculate cue stick position
     // Gậy nằm phía sau quả bi (ngược với hướng bắn), đẩy quả bi về phía trước
     float stickLength = 40.0f + cuePower * 0.3f;  // Stick extends based on power
-    float stickEndX = cueBall.x - cos(cueAngle) * (BALL_RADIUS + stickLength);
-    float stickEndY = cueBall.y - sin(cueAngle) * (BALL_RADIUS + stickLength);
+    float stickEndX = (float)cueBall.x - cos(cueAngle) * (BALL_RADIUS + stickLength);
+    float stickEndY = (float)cueBall.y - sin(cueAngle) * (BALL_RADIUS + stickLength);
     
     int stickStartX = screenX;
     int stickStartY = screenY;
@@ -832,12 +1039,23 @@ void BilliardGame::drawCueStick() {
 }
 
 void BilliardGame::draw() {
+    Profiler::Scope profile("BilliardGame.draw");
+    TftCompositor::Frame frame("BilliardGame");
     // Only draw table once
     if (!tableDrawn) {
         drawTable();
         tableDrawn = true;
     }
     
+#if BILLIARD_SPRITES
+    // Tile ghép mọi quả bi chồng lên nó, nên khung va chạm không cần xóa hết rồi vẽ lại
+    for (int i = 0; i < BALL_COUNT; i++) {
+        if (i == activeBallIndex) continue;
+        renderBallSprite(i);
+    }
+    renderBallSprite(activeBallIndex);
+    collisionThisFrame = false;
+#else
     auto renderBallOptimized = [&](int i) {
         if (balls[i].x < 0) return;  // Pocketed
         
@@ -855,7 +1073,7 @@ void BilliardGame::draw() {
         int eraseRadius = BALL_RADIUS + 2;
         for (int i = 0; i < BALL_COUNT; i++) {
             if (oldBallX[i] < 0 || oldBallY[i] < 0) continue;  // Already pocketed sentinel
-            eraseBallAtPosition(oldBallX[i], oldBallY[i], eraseRadius);
+            eraseBallAtPosition((float)oldBallX[i], (float)oldBallY[i], eraseRadius);
         }
         // Ensure pockets stay on top after erasing near edges
         redrawAllPockets();
@@ -893,6 +1111,7 @@ void BilliardGame::draw() {
         }
         renderBallOptimized(activeBallIndex);
     }
+#endif
     
     // Update cue stick if angle or power changed
     if (isAiming && !balls[activeBallIndex].isActive) {
@@ -982,12 +1201,17 @@ void BilliardGame::drawPowerBarStatic() {
     const int clearHeight = barHeight + 12;
     
     // Khôi phục nền đúng màu một lần (pixel-by-pixel nhưng chỉ 1 lần mỗi lần hiện thanh)
+#if BILLIARD_SPRITES
+    TileRect area = { clearX, clearY, clearX + clearWidth - 1, clearY + clearHeight - 1 };
+    repaintRect(area);
+#else
     for (int py = clearY; py < clearY + clearHeight; py++) {
         for (int px = clearX; px < clearX + clearWidth; px++) {
             uint16_t bgColor = getBackgroundColorAt(px, py);
             tft->drawPixel(px, py, bgColor);
         }
     }
+#endif
     
     // Vẽ phần nền trong thanh (màu bàn) và viền trắng
     tft->fillRect(barX + 1, barY + 1, barWidth - 2, barHeight - 2, COLOR_TABLE);
@@ -1009,6 +1233,11 @@ void BilliardGame::clearPowerBarArea() {
     const int clearWidth = barWidth + textWidth;
     const int clearHeight = barHeight + 12;
     
+#if BILLIARD_SPRITES
+    // Tile đã gồm cả các quả bi nằm trong vùng thanh lực
+    TileRect area = { clearX, clearY, clearX + clearWidth - 1, clearY + clearHeight - 1 };
+    repaintRect(area);
+#else
     // Khôi phục nền đúng màu (chỉ khi cần xóa thanh)
     for (int py = clearY; py < clearY + clearHeight; py++) {
         for (int px = clearX; px < clearX + clearWidth; px++) {
@@ -1031,6 +1260,7 @@ void BilliardGame::clearPowerBarArea() {
             drawBall(i);
         }
     }
+#endif
     
     powerBarVisible = false;
     lastPowerFillWidth = 0;
@@ -1038,6 +1268,7 @@ void BilliardGame::clearPowerBarArea() {
 }
 
 void BilliardGame::update() {
+    Profiler::Scope profile("BilliardGame.update");
     // Reset collision flag each frame; will be set during physics when collisions occur
     collisionThisFrame = false;
     
@@ -1051,703 +1282,152 @@ void BilliardGame::update() {
         drawPowerBar();
     }
     
-    updatePhysics();
-}
-
-void BilliardGame::updatePhysics() {
-    bool anyBallMoving = false;
-    
-    // Update ball positions
-    for (int i = 0; i < BALL_COUNT; i++) {
-        if (!balls[i].isActive) {
-            // Reactivate slow/stuck balls that are already in the pocket mouth
-            if (balls[i].x >= 0 && isBallInPocketAttractionZone(balls[i])) {
-                balls[i].isActive = true;
-            } else {
-                continue;
-            }
-        }
-        
-        // Apply friction
-        balls[i].vx *= FRICTION;
-        balls[i].vy *= FRICTION;
-        
-        bool inPocketAttraction = (balls[i].x >= 0) ? isBallInPocketAttractionZone(balls[i]) : false;
-        
-        // Stop ball if velocity is too low (but never stop inside pocket attraction)
-        float speed = sqrt(balls[i].vx * balls[i].vx + balls[i].vy * balls[i].vy);
-        if (speed < MIN_VELOCITY) {
-            if (inPocketAttraction) {
-                // Keep the ball moving gently toward the pocket
-                balls[i].vx *= 0.5f;
-                balls[i].vy *= 0.5f;
-                balls[i].isActive = true;
-                anyBallMoving = true;
-            } else {
-                balls[i].vx = 0.0f;
-                balls[i].vy = 0.0f;
-                balls[i].isActive = false;
-            }
-        } else {
-            anyBallMoving = true;
-        }
-        
-        if (inPocketAttraction) {
-            applyPocketAttraction(balls[i]);
-        }
-        
-        // Update position (use smaller steps to prevent tunneling)
-        float timeStep = 0.5f;
-        balls[i].x += balls[i].vx * timeStep;
-        balls[i].y += balls[i].vy * timeStep;
-        
-        // Check if ball fell into pocket FIRST (before wall collision check)
-        // This prevents ball from going too far outside before being detected
-        if (balls[i].x >= 0 && isBallInPocket(balls[i])) {
-            bool isCueBall = (i == activeBallIndex);
-            
-            // QUAN TRỌNG: Xóa quả bi khỏi màn hình TRƯỚC KHI đặt x = -100
-            // Điều này đảm bảo quả bi được xóa ở đúng vị trí cũ
-            eraseBall(i);
-            
-            // SAU KHI xóa xong, mới đánh dấu quả bi đã rơi vào lỗ (x = -100)
-            // Điều này đảm bảo quả bi không bao giờ được vẽ lại hoặc xử lý tiếp
-            if (!isCueBall) {
-                // Quả bi khác rơi vào lỗ - đánh dấu NGAY LẬP TỨC
-                balls[i].x = -100;
-                balls[i].y = -100;
-                oldBallX[i] = -100;
-                oldBallY[i] = -100;
-            }
-            
-            // Dừng quả bi
-            balls[i].isActive = false;
-            balls[i].vx = 0.0f;
-            balls[i].vy = 0.0f;
-            
-            if (isCueBall) {
-                // Cập nhật oldBallX/Y cho cue ball (sẽ được set lại ở dưới)
-                oldBallX[i] = balls[i].x;
-                oldBallY[i] = balls[i].y;
-            }
-            
-            // Xử lý đặc biệt cho quả bi trắng (cue ball) - index 0
-            if (isCueBall) {
-                // Quả bi trắng rơi vào lỗ - đặt lại ở vị trí ban đầu
-                Serial.println("Cue ball pocketed! Resetting cue ball position...");
-                
-                // Đặt lại quả bi trắng ở vị trí ban đầu (góc dưới trái)
-                balls[i].x = TABLE_X + 80;
-                balls[i].y = TABLE_Y + TABLE_HEIGHT - 40;
-                oldBallX[i] = balls[i].x;
-                oldBallY[i] = balls[i].y;
-                
-                // Vẽ lại quả bi trắng ở vị trí mới
-                drawBall(i);
-                
-                // Cho phép ngắm lại
-                isAiming = true;
-                isCharging = false;
-                cuePower = 0.0f;
-                oldCuePower = 0.0f;
-                
-                Serial.println("Cue ball reset to starting position.");
-            } else {
-                // Quả bi khác rơi vào lỗ - MẤT VĨNH VIỄN, không bao giờ lên lại
-                // Đảm bảo x = -100 để đánh dấu đã rơi vào lỗ
-                balls[i].x = -100;
-                balls[i].y = -100;
-                oldBallX[i] = -100;
-                oldBallY[i] = -100;
-                
-                Serial.print("Ball ");
-                Serial.print(i);
-                Serial.println(" pocketed! (permanently removed)");
-            }
-            continue;  // Skip wall collision check for pocketed ball
-        }
-        
-        // Check wall collisions ONLY if ball hasn't been pocketed AND not in pocket mouth
-        if (balls[i].x >= 0 && !isBallInPocketAttractionZone(balls[i])) {
-            checkWallCollisions(balls[i]);
-        } else if (balls[i].x >= 0) {
-            // If inside attraction zone after moving, keep pulling toward pocket
-            applyPocketAttraction(balls[i]);
-            anyBallMoving = true;
-        }
+    // Fixed-timestep physics: số tick chạy theo thời gian thực, không theo tốc độ vẽ
+    unsigned long now = millis();
+    if (online) {
+        // Lockstep: chỉ chạy tick khi có cú đánh, kết quả không phụ thuộc tốc độ vẽ
+        lockstep.advance((uint32_t)(now - lastPhysicsMs));
+    } else {
+        physics.advance((uint32_t)(now - lastPhysicsMs));
     }
+    lastPhysicsMs = now;
     
-    // Check ball-to-ball collisions (multiple times to handle fast collisions)
-    // Nhưng bỏ qua các quả bi đã rơi vào lỗ hoặc đang gần lỗ
-    checkBallCollisions();
+    collisionThisFrame = physics.hadCollision();
+    handlePocketEvents();
     
-    // Apply remaining movement
-    for (int i = 0; i < BALL_COUNT; i++) {
-        if (balls[i].x < 0 || !balls[i].isActive) continue;
-        
-        bool inPocketAttraction = isBallInPocketAttractionZone(balls[i]);
-        if (inPocketAttraction) {
-            applyPocketAttraction(balls[i]);
-        }
-        
-        float timeStep = 0.5f;
-        balls[i].x += balls[i].vx * timeStep;
-        balls[i].y += balls[i].vy * timeStep;
-        
-        // Check pocket again after second movement
-        if (isBallInPocket(balls[i])) {
-            bool isCueBall = (i == activeBallIndex);
-            
-            // QUAN TRỌNG: Xóa quả bi khỏi màn hình TRƯỚC KHI đặt x = -100
-            // Điều này đảm bảo quả bi được xóa ở đúng vị trí cũ
-            eraseBall(i);
-            
-            // SAU KHI xóa xong, mới đánh dấu quả bi đã rơi vào lỗ (x = -100)
-            // Điều này đảm bảo quả bi không bao giờ được vẽ lại hoặc xử lý tiếp
-            if (!isCueBall) {
-                // Quả bi khác rơi vào lỗ - đánh dấu NGAY LẬP TỨC
-                balls[i].x = -100;
-                balls[i].y = -100;
-                oldBallX[i] = -100;
-                oldBallY[i] = -100;
-            }
-            
-            // Dừng quả bi
-            balls[i].isActive = false;
-            balls[i].vx = 0.0f;
-            balls[i].vy = 0.0f;
-            
-            if (isCueBall) {
-                // Cập nhật oldBallX/Y cho cue ball (sẽ được set lại ở dưới)
-                oldBallX[i] = balls[i].x;
-                oldBallY[i] = balls[i].y;
-            }
-            
-            // Xử lý đặc biệt cho quả bi trắng (cue ball) - index 0
-            if (isCueBall) {
-                // Quả bi trắng rơi vào lỗ - đặt lại ở vị trí ban đầu
-                Serial.println("Cue ball pocketed! Resetting cue ball position...");
-                
-                // Đặt lại quả bi trắng ở vị trí ban đầu (góc dưới trái)
-                balls[i].x = TABLE_X + 80;
-                balls[i].y = TABLE_Y + TABLE_HEIGHT - 40;
-                oldBallX[i] = balls[i].x;
-                oldBallY[i] = balls[i].y;
-                
-                // Vẽ lại quả bi trắng ở vị trí mới
-                drawBall(i);
-                
-                // Cho phép ngắm lại
-                isAiming = true;
-                isCharging = false;
-                cuePower = 0.0f;
-                oldCuePower = 0.0f;
-                
-                Serial.println("Cue ball reset to starting position.");
-            } else {
-                // Quả bi khác rơi vào lỗ - MẤT VĨNH VIỄN, không bao giờ lên lại
-                // Đảm bảo x = -100 để đánh dấu đã rơi vào lỗ
-                balls[i].x = -100;
-                balls[i].y = -100;
-                oldBallX[i] = -100;
-                oldBallY[i] = -100;
-                
-                Serial.print("Ball ");
-                Serial.print(i);
-                Serial.println(" pocketed! (permanently removed)");
-            }
-            continue;  // Bỏ qua wall collision check
-        }
-        
-        // Check wall collisions after second movement - CHỈ nếu quả bi chưa rơi vào lỗ
-        if (balls[i].x >= 0 && !isBallInPocket(balls[i]) && !isBallInPocketAttractionZone(balls[i])) {
-            checkWallCollisions(balls[i]);
-        }
+    if (online) {
+        sendLockstepOutgoing();
+        updateOnlineTurn();
+        return;
     }
     
-    // Check collisions again after second movement
-    checkBallCollisions();
-    
     // If all balls stopped, allow aiming again
-    if (!anyBallMoving && !isAiming) {
+    if (!physics.isMoving() && !isAiming) {
         isAiming = true;
         // Redraw to show cue stick
         draw();
     }
 }
 
-void BilliardGame::checkWallCollisions(Ball& ball) {
-    // Kiểm tra NGAY LẬP TỨC nếu quả bi đã rơi vào lỗ (x < 0) - KHÔNG BAO GIỜ xử lý
-    if (ball.x < 0) {
-        return;  // Quả bi đã rơi vào lỗ, không xử lý wall collision
-    }
-    
-    // Pocket and attraction zones have absolute priority over rail collisions
-    // Skip any wall handling once the ball has entered the pocket mouth area
-    if (isBallInPocket(ball) || isBallInPocketAttractionZone(ball)) {
-        return;
-    }
-    
-    // XỬ LÝ ĐẶC BIỆT CHO GÓC: Kiểm tra xem quả bi có đang ở góc giao thành bàn và viền lỗ không
-    // Đảm bảo quả bi không bị biến dạng khi kẹt ở góc
-    int cornerPockets[4][2] = {
-        {TABLE_X, TABLE_Y},  // Top-left corner
-        {TABLE_X + TABLE_WIDTH, TABLE_Y},  // Top-right corner
-        {TABLE_X, TABLE_Y + TABLE_HEIGHT},  // Bottom-left corner
-        {TABLE_X + TABLE_WIDTH, TABLE_Y + TABLE_HEIGHT}  // Bottom-right corner
-    };
-    
-    bool isInCornerArea = false;
-    float cornerPocketDistance = 0;
-    int cornerPocketIndex = -1;
-    
-    // Kiểm tra xem quả bi có đang ở trong vùng góc không (vùng có thể bị kẹt)
-    for (int c = 0; c < 4; c++) {
-        float dx = ball.x - cornerPockets[c][0];
-        float dy = ball.y - cornerPockets[c][1];
-        float distance = sqrt(dx * dx + dy * dy);
-        
-        // Vùng góc: từ POCKET_RADIUS - 2 đến POCKET_RADIUS + BALL_RADIUS + 5
-        // Đây là vùng quả bi có thể bị kẹt giữa thành bàn và viền lỗ
-        if (distance >= POCKET_RADIUS - 2.0f && distance <= POCKET_RADIUS + BALL_RADIUS + 5.0f) {
-            isInCornerArea = true;
-            cornerPocketDistance = distance;
-            cornerPocketIndex = c;
-            break;
-        }
-    }
-    
-    // Nếu quả bi đang ở trong vùng góc, xử lý đặc biệt
-    if (isInCornerArea) {
-        float currentSpeed = sqrt(ball.vx * ball.vx + ball.vy * ball.vy);
-        float minDistanceFromEdge = BALL_RADIUS + 1.0f;  // Đảm bảo quả bi không bị "ăn" vào thành bàn
-        
-        // QUAN TRỌNG: LUÔN đảm bảo quả bi cách thành bàn đủ xa khi ở góc (bất kể vận tốc)
-        // Điều này ngăn quả bi bị "ăn" vào thành bàn ở góc
-        if (cornerPocketIndex == 0) {  // Top-left
-            if (ball.x < TABLE_X + minDistanceFromEdge) {
-                ball.x = TABLE_X + minDistanceFromEdge;
-            }
-            if (ball.y < TABLE_Y + minDistanceFromEdge) {
-                ball.y = TABLE_Y + minDistanceFromEdge;
-            }
-        } else if (cornerPocketIndex == 1) {  // Top-right
-            if (ball.x > TABLE_X + TABLE_WIDTH - minDistanceFromEdge) {
-                ball.x = TABLE_X + TABLE_WIDTH - minDistanceFromEdge;
-            }
-            if (ball.y < TABLE_Y + minDistanceFromEdge) {
-                ball.y = TABLE_Y + minDistanceFromEdge;
-            }
-        } else if (cornerPocketIndex == 2) {  // Bottom-left
-            if (ball.x < TABLE_X + minDistanceFromEdge) {
-                ball.x = TABLE_X + minDistanceFromEdge;
-            }
-            if (ball.y > TABLE_Y + TABLE_HEIGHT - minDistanceFromEdge) {
-                ball.y = TABLE_Y + TABLE_HEIGHT - minDistanceFromEdge;
-            }
-        } else if (cornerPocketIndex == 3) {  // Bottom-right
-            if (ball.x > TABLE_X + TABLE_WIDTH - minDistanceFromEdge) {
-                ball.x = TABLE_X + TABLE_WIDTH - minDistanceFromEdge;
-            }
-            if (ball.y > TABLE_Y + TABLE_HEIGHT - minDistanceFromEdge) {
-                ball.y = TABLE_Y + TABLE_HEIGHT - minDistanceFromEdge;
-            }
-        }
-        
-        // Tính vector từ tâm lỗ đến tâm quả bi
-        float dx = ball.x - cornerPockets[cornerPocketIndex][0];
-        float dy = ball.y - cornerPockets[cornerPocketIndex][1];
-        float distToCorner = sqrt(dx * dx + dy * dy);
-        if (distToCorner > 0.01f) {
-            // Tính vector vận tốc hướng vào lỗ hay ra ngoài
-            float dotProduct = (ball.vx * dx + ball.vy * dy) / distToCorner;
-            bool movingTowardPocket = dotProduct < 0;  // Vận tốc hướng vào lỗ nếu dotProduct < 0
-            
-            // Nếu quả bi đi chậm và ở góc
-            if (currentSpeed < MIN_VELOCITY * 3.0f) {
-                // Dừng quả bi để tránh bị kẹt và biến dạng
-                ball.vx = 0.0f;
-                ball.vy = 0.0f;
-                return;  // Không xử lý wall collision khi ở góc và đi chậm
-            } else if (movingTowardPocket) {
-                // Quả bi đi đủ nhanh và hướng vào lỗ - để rơi vào lỗ tự nhiên
-                // Không bounce, chỉ giảm vận tốc một chút
-                ball.vx *= 0.95f;
-                ball.vy *= 0.95f;
-                return;  // Không xử lý wall collision
-            }
-            // Nếu quả bi đi đủ nhanh và hướng ra ngoài, tiếp tục xử lý wall collision bình thường
-            // Nhưng vị trí đã được đảm bảo cách thành bàn đủ xa ở trên
-        }
-    }
-    
-    // Check if ball is near pocket areas - don't bounce if too close to pocket
-    // Use larger detection radius to allow balls to fall into pockets
-    float pocketDetectionRadius = POCKET_RADIUS + BALL_RADIUS + 3.0f;
-    
-    bool nearTopLeftPocket = (ball.x - TABLE_X) * (ball.x - TABLE_X) + (ball.y - TABLE_Y) * (ball.y - TABLE_Y) < pocketDetectionRadius * pocketDetectionRadius;
-    bool nearTopRightPocket = (ball.x - (TABLE_X + TABLE_WIDTH)) * (ball.x - (TABLE_X + TABLE_WIDTH)) + (ball.y - TABLE_Y) * (ball.y - TABLE_Y) < pocketDetectionRadius * pocketDetectionRadius;
-    bool nearBottomLeftPocket = (ball.x - TABLE_X) * (ball.x - TABLE_X) + (ball.y - (TABLE_Y + TABLE_HEIGHT)) * (ball.y - (TABLE_Y + TABLE_HEIGHT)) < pocketDetectionRadius * pocketDetectionRadius;
-    bool nearBottomRightPocket = (ball.x - (TABLE_X + TABLE_WIDTH)) * (ball.x - (TABLE_X + TABLE_WIDTH)) + (ball.y - (TABLE_Y + TABLE_HEIGHT)) * (ball.y - (TABLE_Y + TABLE_HEIGHT)) < pocketDetectionRadius * pocketDetectionRadius;
-    bool nearTopMiddlePocket = (ball.x - (TABLE_X + TABLE_WIDTH / 2)) * (ball.x - (TABLE_X + TABLE_WIDTH / 2)) + (ball.y - TABLE_Y) * (ball.y - TABLE_Y) < pocketDetectionRadius * pocketDetectionRadius;
-    bool nearBottomMiddlePocket = (ball.x - (TABLE_X + TABLE_WIDTH / 2)) * (ball.x - (TABLE_X + TABLE_WIDTH / 2)) + (ball.y - (TABLE_Y + TABLE_HEIGHT)) * (ball.y - (TABLE_Y + TABLE_HEIGHT)) < pocketDetectionRadius * pocketDetectionRadius;
-    
-    // Đảm bảo quả bi không bị "ăn" vào thành bàn - phải cách mép bàn đủ xa
-    // Thành bàn có độ dày, nên cần thêm margin để quả bi hoàn toàn nằm trên bàn
-    int railThickness = 4;  // Độ dày thành bàn
-    float minDistanceFromEdge = BALL_RADIUS + 1.0f;  // Khoảng cách tối thiểu từ mép bàn (BALL_RADIUS + 1 để đảm bảo không bị ăn vào)
-    
-    // Tính vận tốc hiện tại để quyết định có nên bounce hay dừng lại
-    float currentSpeed = sqrt(ball.vx * ball.vx + ball.vy * ball.vy);
-    float bounceThreshold = MIN_VELOCITY * 2.0f;  // Nếu vận tốc < threshold * 2, dừng lại thay vì bounce
-    
-    // Left wall (but not near top-left or bottom-left pockets)
-    // Đặt quả bi cách mép bàn đủ xa để toàn bộ quả bi nằm trên bàn
-    if (ball.x - BALL_RADIUS < TABLE_X && !nearTopLeftPocket && !nearBottomLeftPocket) {
-        ball.x = TABLE_X + minDistanceFromEdge;  // Cách mép bàn đủ xa
-        // Nếu vận tốc quá thấp, dừng lại thay vì bounce
-        if (currentSpeed < bounceThreshold) {
-            ball.vx = 0.0f;
-            ball.vy = 0.0f;
-        } else {
-            ball.vx = -ball.vx * 0.8f;  // Bounce with some energy loss
-        }
-    }
-    // Right wall (but not near top-right or bottom-right pockets)
-    if (ball.x + BALL_RADIUS > TABLE_X + TABLE_WIDTH && !nearTopRightPocket && !nearBottomRightPocket) {
-        ball.x = TABLE_X + TABLE_WIDTH - minDistanceFromEdge;  // Cách mép bàn đủ xa
-        // Nếu vận tốc quá thấp, dừng lại thay vì bounce
-        if (currentSpeed < bounceThreshold) {
-            ball.vx = 0.0f;
-            ball.vy = 0.0f;
-        } else {
-            ball.vx = -ball.vx * 0.8f;
-        }
-    }
-    // Top wall (but not near top pockets)
-    if (ball.y - BALL_RADIUS < TABLE_Y && !nearTopLeftPocket && !nearTopRightPocket && !nearTopMiddlePocket) {
-        ball.y = TABLE_Y + minDistanceFromEdge;  // Cách mép bàn đủ xa
-        // Nếu vận tốc quá thấp, dừng lại thay vì bounce
-        if (currentSpeed < bounceThreshold) {
-            ball.vx = 0.0f;
-            ball.vy = 0.0f;
-        } else {
-            ball.vy = -ball.vy * 0.8f;
-        }
-    }
-    // Bottom wall (but not near bottom pockets)
-    if (ball.y + BALL_RADIUS > TABLE_Y + TABLE_HEIGHT && !nearBottomLeftPocket && !nearBottomRightPocket && !nearBottomMiddlePocket) {
-        ball.y = TABLE_Y + TABLE_HEIGHT - minDistanceFromEdge;  // Cách mép bàn đủ xa
-        // Nếu vận tốc quá thấp, dừng lại thay vì bounce
-        if (currentSpeed < bounceThreshold) {
-            ball.vx = 0.0f;
-            ball.vy = 0.0f;
-        } else {
-            ball.vy = -ball.vy * 0.8f;
-        }
+void BilliardGame::startOnline(SocketManager* socketManager, int sessionId, bool isHost) {
+    this->socketManager = socketManager;
+    this->sessionId = sessionId;
+    this->online = true;
+    this->onlineHost = isHost;
+    init();
+}
+
+void BilliardGame::updateOnlineTurn() {
+    // Chỉ ngắm khi đến lượt mình và socket còn kết nối (cú đánh không gửi được thì hai máy lệch nhau)
+    bool myTurn = lockstep.canShoot() && socketManager != nullptr && socketManager->connected();
+    if (myTurn && !isAiming) {
+        isAiming = true;
+        draw();
+    } else if (!myTurn && isAiming) {
+        // Snapshot trao lượt cho đối thủ hoặc mất kết nối: cất gậy
+        eraseCueStick();
+        isAiming = false;
+        isCharging = false;
+        cuePower = 0.0f;
+        draw();
     }
-    
-    // Đảm bảo quả bi không đi sâu vào cạnh bàn (thêm kiểm tra an toàn)
-    // Nhưng không áp dụng nếu quả bi đang gần lỗ (để quả bi có thể rơi vào lỗ)
-    bool nearAnyPocket = nearTopLeftPocket || nearTopRightPocket || nearBottomLeftPocket || 
-                         nearBottomRightPocket || nearTopMiddlePocket || nearBottomMiddlePocket;
-    
-    if (!nearAnyPocket) {
-        // Chỉ đẩy quả bi ra nếu không gần lỗ
-        // Đảm bảo bi không đi ra ngoài bàn quá xa và không bị "ăn" vào thành bàn
-        float minDistanceFromEdge = BALL_RADIUS + 1.0f;  // Khoảng cách tối thiểu từ mép bàn
-        float currentSpeed = sqrt(ball.vx * ball.vx + ball.vy * ball.vy);
-        float bounceThreshold = MIN_VELOCITY * 2.0f;  // Nếu vận tốc < threshold * 2, dừng lại
-        
-        if (ball.x < TABLE_X + minDistanceFromEdge) {
-            ball.x = TABLE_X + minDistanceFromEdge;
-            // Nếu vận tốc quá thấp, dừng lại thay vì bounce
-            if (currentSpeed < bounceThreshold) {
-                ball.vx = 0.0f;
-                ball.vy = 0.0f;
-            } else {
-                ball.vx = -ball.vx * 0.8f;  // Bounce if not near pocket
-            }
-        }
-        if (ball.x > TABLE_X + TABLE_WIDTH - minDistanceFromEdge) {
-            ball.x = TABLE_X + TABLE_WIDTH - minDistanceFromEdge;
-            // Nếu vận tốc quá thấp, dừng lại thay vì bounce
-            if (currentSpeed < bounceThreshold) {
-                ball.vx = 0.0f;
-                ball.vy = 0.0f;
-            } else {
-                ball.vx = -ball.vx * 0.8f;
-            }
-        }
-        if (ball.y < TABLE_Y + minDistanceFromEdge) {
-            ball.y = TABLE_Y + minDistanceFromEdge;
-            // Nếu vận tốc quá thấp, dừng lại thay vì bounce
-            if (currentSpeed < bounceThreshold) {
-                ball.vx = 0.0f;
-                ball.vy = 0.0f;
-            } else {
-                ball.vy = -ball.vy * 0.8f;
+}
+
+void BilliardGame::sendLockstepOutgoing() {
+    switch (lockstep.pollOutgoing()) {
+        case BilliardLockstep::OUTGOING_SYNC_REQUEST:
+            Serial.println("Billiard: Desync - requesting snapshot from host");
+            if (socketManager != nullptr) {
+                socketManager->sendBilliardSync(sessionId, lockstep.getSeq());
             }
-        }
-        if (ball.y > TABLE_Y + TABLE_HEIGHT - minDistanceFromEdge) {
-            ball.y = TABLE_Y + TABLE_HEIGHT - minDistanceFromEdge;
-            // Nếu vận tốc quá thấp, dừng lại thay vì bounce
-            if (currentSpeed < bounceThreshold) {
-                ball.vx = 0.0f;
-                ball.vy = 0.0f;
-            } else {
-                ball.vy = -ball.vy * 0.8f;
+            break;
+        case BilliardLockstep::OUTGOING_SNAPSHOT:
+            if (socketManager != nullptr) {
+                socketManager->sendBilliardSync(sessionId, lockstep.getSeq(), lockstep.writeSnapshotText());
             }
-        }
-    } else {
-        // Nếu gần lỗ, vẫn cần giới hạn bi không đi quá xa ngoài bàn
-        // Chỉ cho phép bi đi ra ngoài một chút để có thể rơi vào lỗ
-        float maxOutsideMargin = POCKET_RADIUS + BALL_RADIUS + 2.0f;  // Cho phép đi ra ngoài một chút
-        
-        // Giới hạn bi không đi quá xa ngoài bàn, ngay cả khi gần lỗ
-        if (ball.x < TABLE_X - maxOutsideMargin) {
-            ball.x = TABLE_X - maxOutsideMargin;
-            ball.vx = 0.0f;  // Dừng lại nếu đi quá xa
-        }
-        if (ball.x > TABLE_X + TABLE_WIDTH + maxOutsideMargin) {
-            ball.x = TABLE_X + TABLE_WIDTH + maxOutsideMargin;
-            ball.vx = 0.0f;
-        }
-        if (ball.y < TABLE_Y - maxOutsideMargin) {
-            ball.y = TABLE_Y - maxOutsideMargin;
-            ball.vy = 0.0f;
-        }
-        if (ball.y > TABLE_Y + TABLE_HEIGHT + maxOutsideMargin) {
-            ball.y = TABLE_Y + TABLE_HEIGHT + maxOutsideMargin;
-            ball.vy = 0.0f;
-        }
+            break;
+        default:
+            break;
     }
 }
 
-bool BilliardGame::isBallInPocketAttractionZone(const Ball& ball) {
-    if (ball.x < 0) {
-        return false;  // Already pocketed sentinel
+void BilliardGame::onBilliardShotReceived(int seq, uint32_t tick, int32_t angle, int power, uint32_t hash) {
+    if (!online) {
+        return;
     }
-    
-    float attractionRadius = POCKET_RADIUS + BALL_RADIUS + POCKET_ATTRACTION_MARGIN;
-    float attractionRadiusSq = attractionRadius * attractionRadius;
-    
-    int pockets[6][2] = {
-        {TABLE_X, TABLE_Y},  // Top-left
-        {TABLE_X + TABLE_WIDTH, TABLE_Y},  // Top-right
-        {TABLE_X, TABLE_Y + TABLE_HEIGHT},  // Bottom-left
-        {TABLE_X + TABLE_WIDTH, TABLE_Y + TABLE_HEIGHT},  // Bottom-right
-        {TABLE_X + TABLE_WIDTH / 2, TABLE_Y},  // Top middle
-        {TABLE_X + TABLE_WIDTH / 2, TABLE_Y + TABLE_HEIGHT}  // Bottom middle
-    };
-    
-    for (int p = 0; p < 6; p++) {
-        float dx = ball.x - pockets[p][0];
-        float dy = ball.y - pockets[p][1];
-        float distSq = dx * dx + dy * dy;
-        if (distSq <= attractionRadiusSq) {
-            return true;
-        }
+    BilliardLockstep::Shot shot;
+    shot.seq = (uint16_t)seq;
+    shot.tick = tick;
+    shot.angle = angle;
+    shot.power = (uint16_t)power;
+    shot.hash = hash;
+    if (lockstep.receive(shot) == BilliardLockstep::RECEIVE_DESYNC) {
+        Serial.print("Billiard: Shot ");
+        Serial.print(seq);
+        Serial.println(" does not match the local table - resyncing");
     }
-    return false;
 }
 
-void BilliardGame::applyPocketAttraction(Ball& ball) {
-    // Only apply when inside the attraction zone
-    float attractionRadius = POCKET_RADIUS + BALL_RADIUS + POCKET_ATTRACTION_MARGIN;
-    float attractionRadiusSq = attractionRadius * attractionRadius;
-    
-    int pockets[6][2] = {
-        {TABLE_X, TABLE_Y},  // Top-left
-        {TABLE_X + TABLE_WIDTH, TABLE_Y},  // Top-right
-        {TABLE_X, TABLE_Y + TABLE_HEIGHT},  // Bottom-left
-        {TABLE_X + TABLE_WIDTH, TABLE_Y + TABLE_HEIGHT},  // Bottom-right
-        {TABLE_X + TABLE_WIDTH / 2, TABLE_Y},  // Top middle
-        {TABLE_X + TABLE_WIDTH / 2, TABLE_Y + TABLE_HEIGHT}  // Bottom middle
-    };
-    
-    int targetPocket = -1;
-    float closestDistSq = attractionRadiusSq;
-    
-    for (int p = 0; p < 6; p++) {
-        float dx = ball.x - pockets[p][0];
-        float dy = ball.y - pockets[p][1];
-        float distSq = dx * dx + dy * dy;
-        if (distSq < closestDistSq) {
-            closestDistSq = distSq;
-            targetPocket = p;
-        }
-    }
-    
-    if (targetPocket == -1) {
+void BilliardGame::onBilliardSyncReceived(int seq, const String& snapshot) {
+    if (!online) {
         return;
     }
-    
-    float dirX = pockets[targetPocket][0] - ball.x;
-    float dirY = pockets[targetPocket][1] - ball.y;
-    float dist = sqrt(dirX * dirX + dirY * dirY);
-    if (dist < 0.001f) {
+    if (snapshot.length() == 0) {
+        lockstep.requestSnapshot();  // Chỉ có tác dụng trên máy chủ phòng
         return;
     }
-    
-    float normX = dirX / dist;
-    float normY = dirY / dist;
-    
-    ball.vx += normX * POCKET_ATTRACTION;
-    ball.vy += normY * POCKET_ATTRACTION;
-    ball.isActive = true;  // Keep ball active while being pulled in
-}
-
-bool BilliardGame::isBallNearPocket(float x, float y) {
-    float pocketCheckRadius = POCKET_RADIUS + BALL_RADIUS + POCKET_ATTRACTION_MARGIN;
-    int pockets[6][2] = {
-        {TABLE_X, TABLE_Y},  // Top-left
-        {TABLE_X + TABLE_WIDTH, TABLE_Y},  // Top-right
-        {TABLE_X, TABLE_Y + TABLE_HEIGHT},  // Bottom-left
-        {TABLE_X + TABLE_WIDTH, TABLE_Y + TABLE_HEIGHT},  // Bottom-right
-        {TABLE_X + TABLE_WIDTH / 2, TABLE_Y},  // Top middle
-        {TABLE_X + TABLE_WIDTH / 2, TABLE_Y + TABLE_HEIGHT}  // Bottom middle
-    };
-    for (int p = 0; p < 6; p++) {
-        float dx = x - pockets[p][0];
-        float dy = y - pockets[p][1];
-        float dist = sqrt(dx * dx + dy * dy);
-        if (dist < pocketCheckRadius) {
-            return true;
-        }
+    if (lockstep.readSnapshotText(snapshot)) {
+        Serial.print("Billiard: Adopted host snapshot at seq ");
+        Serial.println(seq);
+        collisionThisFrame = true;  // Nhiều bi đổi chỗ cùng lúc
     }
-    return false;
 }
 
-void BilliardGame::checkBallCollisions() {
-    // Check multiple times per frame to prevent fast balls from passing through
-    const int iterations = 3;
-    
-    for (int iter = 0; iter < iterations; iter++) {
-        for (int i = 0; i < BALL_COUNT; i++) {
-            // Skip if ball is already pocketed (x < 0)
-            if (balls[i].x < 0) continue;
-            // Skip if ball is already in pocket (kiểm tra lại để chắc chắn)
-            if (isBallInPocket(balls[i])) continue;
-            // Skip attraction zone to avoid unnatural bounces when falling in
-            if (isBallInPocketAttractionZone(balls[i])) continue;
-            if (!balls[i].isActive && iter == 0) continue;  // Only check active balls on first iteration
-            // Skip if ball is near pocket (đang rơi vào lỗ) - tránh bounce khi rơi vào lỗ
-            if (isBallNearPocket(balls[i].x, balls[i].y)) continue;
-            
-            for (int j = i + 1; j < BALL_COUNT; j++) {
-                // Skip if ball is already pocketed (x < 0)
-                if (balls[j].x < 0) continue;
-                // Skip if ball is already in pocket (kiểm tra lại để chắc chắn)
-                if (isBallInPocket(balls[j])) continue;
-                // Skip attraction zone to avoid unnatural bounces when falling in
-                if (isBallInPocketAttractionZone(balls[j])) continue;
-                if (!balls[j].isActive && iter == 0) continue;  // Only check active balls on first iteration
-                // Skip if ball is near pocket (đang rơi vào lỗ) - tránh bounce khi rơi vào lỗ
-                if (isBallNearPocket(balls[j].x, balls[j].y)) continue;
-                
-                // Calculate distance between balls
-                float dx = balls[j].x - balls[i].x;
-                float dy = balls[j].y - balls[i].y;
-                float distance = sqrt(dx * dx + dy * dy);
-                
-                // Minimum distance should be 2 * BALL_RADIUS
-                float minDistance = BALL_RADIUS * 2;
-                
-                // Luôn coi là khung va chạm nếu bi chạm nhẹ (mở rộng margin cho va chậm)
-                if (distance < minDistance * 1.12f) {
-                    collisionThisFrame = true;
-                }
-                
-                // Check if balls are overlapping or very close
-                if (distance < minDistance && distance > 0.01f) {
-                    // Normalize collision vector
-                    float nx = dx / distance;
-                    float ny = dy / distance;
-                    
-                    // Separate balls to prevent overlap (always do this, even if not moving)
-                    float overlap = minDistance - distance;
-                    float separation = overlap * 0.6f;  // Separate by 60% of overlap to prevent jitter
-                    
-                    // Move balls apart
-                    balls[i].x -= nx * separation;
-                    balls[i].y -= ny * separation;
-                    balls[j].x += nx * separation;
-                    balls[j].y += ny * separation;
-                    
-                    // Calculate relative velocity
-                    float dvx = balls[j].vx - balls[i].vx;
-                    float dvy = balls[j].vy - balls[i].vy;
-                    
-                    // Relative velocity along collision normal
-                    float dot = dvx * nx + dvy * ny;
-                    
-                    // Apply collision impulse if balls are moving towards each other
-                    // Or if they're already overlapping (to push them apart)
-                    if (dot < 0 || distance < minDistance * 0.9f) {
-                        // Elastic collision: exchange momentum along collision normal
-                        // Assuming equal mass (all balls have same mass)
-                        // Giảm hệ số va chạm để cân bằng - quả bi đánh đi không quá yếu, quả bi bị đánh không quá mạnh
-                        float impulse = 0.6f * dot;  // Giảm từ 0.8f xuống 0.6f để cân bằng hơn
-                        
-                        balls[i].vx += impulse * nx;
-                        balls[i].vy += impulse * ny;
-                        balls[j].vx -= impulse * nx;
-                        balls[j].vy -= impulse * ny;
-                        
-                        // Activate both balls after collision
-                        balls[i].isActive = true;
-                        balls[j].isActive = true;
-                        
-                        if (iter == 0) {  // Only log on first iteration
-                            Serial.print("Collision: Ball ");
-                            Serial.print(i);
-                            Serial.print(" hit Ball ");
-                            Serial.print(j);
-                            Serial.print(" (distance: ");
-                            Serial.print(distance);
-                            Serial.println(")");
-                        }
-                    }
-                }
-            }
-        }
-    }
-}
-
-bool BilliardGame::isBallInPocket(Ball& ball) {
-    // Kiểm tra tất cả các lỗ trước, không cần kiểm tra margin ngay lập tức
-    // Vì bi có thể đi ra ngoài một chút khi rơi vào lỗ góc
-    
-    // Check all 6 pockets
-    int pockets[6][2] = {
-        {TABLE_X, TABLE_Y},  // Top-left
-        {TABLE_X + TABLE_WIDTH, TABLE_Y},  // Top-right
-        {TABLE_X, TABLE_Y + TABLE_HEIGHT},  // Bottom-left
-        {TABLE_X + TABLE_WIDTH, TABLE_Y + TABLE_HEIGHT},  // Bottom-right
-        {TABLE_X + TABLE_WIDTH / 2, TABLE_Y},  // Top middle
-        {TABLE_X + TABLE_WIDTH / 2, TABLE_Y + TABLE_HEIGHT}  // Bottom middle
-    };
-    
-    for (int i = 0; i < 6; i++) {
-        float dx = ball.x - pockets[i][0];
-        float dy = ball.y - pockets[i][1];
-        float distance = sqrt(dx * dx + dy * dy);
+void BilliardGame::handlePocketEvents() {
+    for (int e = 0; e < physics.getPocketEventCount(); e++) {
+        const BilliardPhysics::PocketEvent& event = physics.getPocketEvent(e);
+        int i = event.ball;
         
-        // Bi rơi vào lỗ khi tâm bi nằm trong bán kính lỗ
-        // Sử dụng POCKET_RADIUS để cho phép bi rơi vào lỗ dễ hơn
-        // Nếu tâm bi cách tâm lỗ < POCKET_RADIUS thì coi là rơi vào lỗ
-        float maxDistance = POCKET_RADIUS;  // 12 pixel - cho phép bi rơi vào lỗ dễ hơn
+        // Xóa quả bi ở vị trí đã vẽ lần cuối và ở vị trí rơi vào lỗ
+        eraseBallAtPosition((float)oldBallX[i], (float)oldBallY[i], BALL_RADIUS);
+        eraseBallAtPosition((float)event.x, (float)event.y, BALL_RADIUS);
         
-        // Coi là rơi vào lỗ nếu tâm bi nằm trong phạm vi này
-        if (distance < maxDistance) {
-            return true;
+        if (i == activeBallIndex && online) {
+            // Online: BilliardLockstep đặt lại bi trắng khi bàn dừng (giống hệt trên máy đối thủ)
+            oldBallX[i] = -100;
+            oldBallY[i] = -100;
+        } else if (i == activeBallIndex) {
+            // Quả bi trắng rơi vào lỗ - đặt lại ở vị trí ban đầu
+            Serial.println("Cue ball pocketed! Resetting cue ball position...");
+            
+            // Đặt lại quả bi trắng ở vị trí ban đầu (góc dưới trái)
+            physics.placeBall(i, sim_t(CUE_START_X), sim_t(CUE_START_Y));
+            oldBallX[i] = balls[i].x;
+            oldBallY[i] = balls[i].y;
+            
+            // Vẽ lại quả bi trắng ở vị trí mới
+            drawBall(i);
+            
+            // Cho phép ngắm lại
+            isAiming = true;
+            isCharging = false;
+            cuePower = 0.0f;
+            oldCuePower = 0.0f;
+            
+            Serial.println("Cue ball reset to starting position.");
+        } else {
+            // Quả bi khác rơi vào lỗ - MẤT VĨNH VIỄN, không bao giờ lên lại
+            oldBallX[i] = -100;
+            oldBallY[i] = -100;
+            
+            Serial.print("Ball ");
+            Serial.print(i);
+            Serial.println(" pocketed! (permanently removed)");
         }
     }
-    
-    return false;
 }
 
+
 void BilliardGame::handleAimLeft() {
     if (isAiming && !balls[activeBallIndex].isActive) {
         eraseCueStick();
@@ -1867,20 +1547,22 @@ void BilliardGame::handleChargeRelease() {
         
         // Shoot the cue ball
         // Quả bi chạy về hướng cueAngle (phía trước), gậy nằm phía sau
-        Ball& cueBall = balls[activeBallIndex];
-        
-        // Đảm bảo có lực tối thiểu để bắn
-        float finalPower = cuePower;
-        if (finalPower < 5.0f) {
-            finalPower = 5.0f;  // Lực tối thiểu
+        if (online) {
+            // Lockstep: bắn cú đã lượng tử hóa, gửi đúng cú đó cho đối thủ
+            BilliardLockstep::Shot shot;
+            if (lockstep.shoot(cueAngle, cuePower, shot) && socketManager != nullptr) {
+                socketManager->sendBilliardShot(sessionId, shot.seq, shot.tick, shot.angle, shot.power, shot.hash);
+            }
+        } else {
+            Ball& cueBall = balls[activeBallIndex];
+            
+            // Lực tối thiểu MIN_SHOT_POWER, tốc độ = lực * SHOT_SPEED_PER_POWER (cùng công thức với bộ dự đoán)
+            sim_t speed = BilliardPhysics::shotSpeed(cuePower);
+            cueBall.vx = simCos(sim_t(cueAngle)) * speed;  // Chạy về hướng góc (phía trước)
+            cueBall.vy = simSin(sim_t(cueAngle)) * speed;  // Chạy về hướng góc (phía trước)
+            cueBall.isActive = true;
         }
         
-        // Scale power to velocity - điều chỉnh để cân bằng hơn
-        float speed = finalPower * 0.3f;  // Giảm từ 0.4f xuống 0.3f để cân bằng với va chạm
-        cueBall.vx = cos(cueAngle) * speed;  // Chạy về hướng góc (phía trước)
-        cueBall.vy = sin(cueAngle) * speed;  // Chạy về hướng góc (phía trước)
-        cueBall.isActive = true;
-        
         // Tắt aiming và charging SAU KHI đã xóa gậy và đánh quả bi
         isAiming = false;
         isCharging = false;
@@ -1943,8 +1625,8 @@ void BilliardGame::aimAtNearestBall() {
         if (i == activeBallIndex) continue;  // Bỏ qua cue ball
         if (balls[i].x < 0) continue;  // Bỏ qua quả bi đã rơi vào lỗ
         
-        float dx = balls[i].x - cueBall.x;
-        float dy = balls[i].y - cueBall.y;
+        float dx = (float)(balls[i].x - cueBall.x);
+        float dy = (float)(balls[i].y - cueBall.y);
         float distance = sqrt(dx * dx + dy * dy);
         
         if (distance < minDistance) {
@@ -1955,8 +1637,8 @@ void BilliardGame::aimAtNearestBall() {
     
     // Nếu tìm thấy quả bi gần nhất, ngắm về nó
     if (nearestIndex >= 0) {
-        float dx = balls[nearestIndex].x - cueBall.x;
-        float dy = balls[nearestIndex].y - cueBall.y;
+        float dx = (float)(balls[nearestIndex].x - cueBall.x);
+        float dy = (float)(balls[nearestIndex].y - cueBall.y);
         
         // Tính góc để ngắm về quả bi
         float targetAngle = atan2(dy, dx);
@@ -1994,8 +1676,8 @@ void BilliardGame::aimAtNearestPocket() {
     int nearestPocketIndex = -1;
     
     for (int i = 0; i < 6; i++) {
-        float dx = pockets[i][0] - cueBall.x;
-        float dy = pockets[i][1] - cueBall.y;
+        float dx = pockets[i][0] - (float)cueBall.x;
+        float dy = pockets[i][1] - (float)cueBall.y;
         float distance = sqrt(dx * dx + dy * dy);
         
         if (distance < minDistance) {
@@ -2006,8 +1688,8 @@ void BilliardGame::aimAtNearestPocket() {
     
     // Nếu tìm thấy lỗ gần nhất, ngắm thẳng vào nó
     if (nearestPocketIndex >= 0) {
-        float dx = pockets[nearestPocketIndex][0] - cueBall.x;
-        float dy = pockets[nearestPocketIndex][1] - cueBall.y;
+        float dx = pockets[nearestPocketIndex][0] - (float)cueBall.x;
+        float dy = pockets[nearestPocketIndex][1] - (float)cueBall.y;
         
         // Tính góc để ngắm thẳng vào lỗ
         float targetAngle = atan2(dy, dx);
@@ -2028,3 +1710,27 @@ void BilliardGame::aimAtNearestPocket() {
     }
 }
 
+void BilliardGame::predictShot(float power, BilliardShotPredictor::Prediction& out) const {
+    BilliardShotPredictor::predict(balls, activeBallIndex, cueAngle, power, out);
+}
+
+bool BilliardGame::aimAtBestShot(float power) {
+    if (!isAiming || balls[activeBallIndex].isActive) {
+        return false;  // Không thể ngắm nếu đang không ở chế độ ngắm hoặc quả bi đang di chuyển
+    }
+    
+    BilliardShotPredictor::Prediction best;
+    bool pots = BilliardShotPredictor::findBestShot(balls, activeBallIndex, power, AIM_SEARCH_STEPS, best);
+    
+    eraseCueStick();
+    cueAngle = best.angle;
+    drawCueStick();
+    
+    Serial.print("Aiming at best shot: ball ");
+    Serial.print(best.objectBall);
+    Serial.print(" at angle: ");
+    Serial.print(best.angle * 180.0f / M_PI);
+    Serial.println(pots ? " (pot)" : " (no pot found)");
+    return pots;
+}
+
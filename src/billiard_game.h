@@ -5,26 +5,16 @@
 #include <Adafruit_GFX.h>
 #include <Adafruit_ST7789.h>
 #include <math.h>
+#include "billiard_physics.h"
+#include "billiard_predictor.h"
+#include "billiard_lockstep.h"
+
+class SocketManager;
 
 // Screen dimensions
 #define SCREEN_WIDTH 320
 #define SCREEN_HEIGHT 240
 
-// Table dimensions - smaller to show cue stick and have margins
-#define TABLE_X 20
-#define TABLE_Y 20
-#define TABLE_WIDTH 280
-#define TABLE_HEIGHT 200
-#define POCKET_RADIUS 12  // Larger pocket radius for clearer visibility
-
-// Ball properties
-#define BALL_RADIUS 6
-#define BALL_COUNT 9  // 1 cue ball + 8 target balls
-#define FRICTION 0.975f  // Friction coefficient (tăng ma sát để quả bi dừng lại nhanh hơn)
-#define MIN_VELOCITY 0.2f  // Minimum velocity to stop ball (tăng để quả bi dừng sớm hơn)
-#define POCKET_ATTRACTION 0.3f  // Attraction force when near pocket
-#define POCKET_ATTRACTION_MARGIN 6.0f  // Extra radius for pocket attraction zone
-
 // Colors
 #define COLOR_TABLE 0x03E0      // Green table
 #define COLOR_TABLE_BORDER 0x8200  // Brown border (màu nâu)
@@ -50,21 +40,32 @@
 #define COLOR_BALL19 0x8410         // Brown
 #define COLOR_CUE_STICK 0x8410      // Brown
 #define COLOR_POCKET 0x0000         // Black
+#define COLOR_BALL_SHADOW 0x2104
 
-struct Ball {
-    float x, y;           // Position
-    float vx, vy;         // Velocity
-    uint16_t color;       // Ball color
-    bool isActive;        // Is ball moving
-};
+// Sprite rendering: the static table (felt, rails, pockets) is cached as
+// per-row color runs, each ball is a pre-rasterized sprite, and a ball move
+// redraws one tile - the box covering its old and new position - composed
+// in RAM from the runs plus every ball overlapping it, pushed as a single
+// setAddrWindow burst (or into TftCompositor's shadow).
+// -DBILLIARD_SPRITES=0 goes back to per-pixel erase + fillCircle.
+#ifndef BILLIARD_SPRITES
+#define BILLIARD_SPRITES 1
+#endif
+
+// Aim assist (aimAtBestShot): angles tried per search, power assumed before charging
+#define AIM_SEARCH_STEPS 360
+#define AIM_ASSIST_POWER 60.0f
 
 class BilliardGame {
 private:
     Adafruit_ST7789* tft;
     
-    Ball balls[BALL_COUNT];
-    float oldBallX[BALL_COUNT];  // Previous ball positions for erasing
-    float oldBallY[BALL_COUNT];
+    BilliardPhysics physics;
+    BilliardLockstep lockstep;  // Online only: physics is driven shot by shot
+    Ball* balls;          // physics.getBalls()
+    unsigned long lastPhysicsMs;  // millis() of the last physics advance
+    sim_t oldBallX[BALL_COUNT];  // Previous ball positions for erasing
+    sim_t oldBallY[BALL_COUNT];
     float cueAngle;       // Angle of cue stick (in radians)
     float oldCueAngle;    // Previous cue angle
     float cuePower;       // Power of shot (0-100)
@@ -77,6 +78,12 @@ private:
     int lastPowerFillWidth;  // Cached fill width to update power bar incrementally
     bool powerBarVisible;    // Track whether power bar UI is currently drawn
     
+    // Online (lockstep) mode: only shots go over the socket
+    bool online;
+    bool onlineHost;
+    int sessionId;
+    SocketManager* socketManager;
+    
     void drawTable();
     void eraseBall(int index);
     void eraseBallAtPosition(float x, float y, int radius);  // Erase ball at specific position with proper clipping
@@ -84,26 +91,66 @@ private:
     void eraseCueStick();
     void eraseCueStickAtPosition(float angle, float power);  // Erase cue stick at specific angle and power (không phụ thuộc isAiming)
     void drawCueStick();
-    void updatePhysics();
-    void checkWallCollisions(Ball& ball);
-    void checkBallCollisions();
-    bool isBallInPocket(Ball& ball);
+    void handlePocketEvents();  // Xóa/đặt lại bi đã rơi vào lỗ sau mỗi lần advance
     void resetGame();
+    void applyBallColors();
+    void updateOnlineTurn();    // Show/hide the cue stick as the turn changes hands
+    void sendLockstepOutgoing();
     void redrawBorderNear(int screenX, int screenY, int radius);  // Redraw border near erased area
     void redrawPocketsNear(float x, float y, int radius);  // Redraw pockets near ball position
     void redrawAllPockets();  // Redraw all pockets (to ensure they're always on top)
     uint16_t getBackgroundColorAt(int screenX, int screenY);  // Get background color at screen position
-    bool isBallNearPocket(float x, float y);  // Kiểm tra quả bi có gần lỗ không
     void drawPowerBar();  // Vẽ thanh lực
     void drawPowerBarStatic();  // Vẽ phần tĩnh của thanh lực (background + border)
     void clearPowerBarArea();   // Khôi phục nền thanh lực một lần khi không dùng
-    bool isBallInPocketAttractionZone(const Ball& ball);  // Vùng hút lỗ
-    void applyPocketAttraction(Ball& ball);  // Kéo bi về tâm lỗ khi trong vùng hút
+    
+#if BILLIARD_SPRITES
+    static const int SPRITE_SIZE = 2 * BALL_RADIUS + 2;  // 13x13 ball + 1 px shadow offset
+    static const int TILE_PIXELS = 1024;                  // Tile buffer, 2 KB
+    static const int MAX_BACKGROUND_RUNS = 640;           // The table needs ~540
+    
+    // Layers of drawBall(), topmost wins
+    enum SpriteLayer { SPRITE_CLEAR = 0, SPRITE_SHADOW, SPRITE_BODY, SPRITE_HIGHLIGHT };
+    
+    struct BackgroundRun {
+        int16_t x;        // Runs until the next run of the row starts
+        uint16_t color;
+    };
+    
+    struct TileRect {
+        int x0, y0, x1, y1;  // Inclusive, screen coordinates
+    };
+    
+    // Rows with identical runs share them
+    BackgroundRun backgroundRuns[MAX_BACKGROUND_RUNS];
+    uint16_t rowRunOffset[SCREEN_HEIGHT];
+    uint8_t rowRunCount[SCREEN_HEIGHT];
+    uint8_t ballSprite[SPRITE_SIZE][SPRITE_SIZE];
+    uint16_t tile[TILE_PIXELS];
+    
+    void buildBackgroundRuns();
+    void buildBallSprite();
+    bool isBallVisible(int index) const;  // Same test as drawBall()
+    static TileRect spriteRect(float x, float y);
+    void renderBallSprite(int index);  // Redraw a moved ball: one tile when old and new box are close
+    void repaintRect(TileRect r);      // Compose + push, in chunks of rows that fit the tile
+    void composeTile(int x, int y, int w, int h);
+    void pushTile(int x, int y, int w, int h);
+    TileRect cueStickRect(float angle, float power);
+#endif
     
 public:
     BilliardGame(Adafruit_ST7789* tft);
     void init();
     void update();
+    
+    // Lockstep multiplayer over the WebSocket (see BilliardLockstep); the host breaks.
+    // Build both devices with -DSIM_FIXED_POINT so their simulations match bit for bit.
+    void startOnline(SocketManager* socketManager, int sessionId, bool isHost);
+    bool isOnline() const { return online; }
+    // From SocketManager's billiard callbacks (main loop)
+    void onBilliardShotReceived(int seq, uint32_t tick, int32_t angle, int power, uint32_t hash);
+    void onBilliardSyncReceived(int seq, const String& snapshot);
     void draw();
     
     // Input handlers
@@ -135,6 +182,13 @@ public:
     int countActiveBalls() const;  // Đếm số quả bi còn trên bàn
     void aimAtNearestBall();  // Tự động ngắm về quả bi gần nhất
     void aimAtNearestPocket();  // Tự động ngắm thẳng vào lỗ gần nhất (để test)
+
+    // Dự đoán cú đánh với cueAngle hiện tại (không đổi trạng thái bàn, đủ nhanh để gọi mỗi frame).
+    // power 0-100: truyền getCuePower() khi đang nạp lực, hoặc một lực giả định khi mới ngắm
+    void predictShot(float power, BilliardShotPredictor::Prediction& out) const;
+    // Thử AIM_SEARCH_STEPS góc với lực power và ngắm vào cú vào lỗ an toàn nhất.
+    // Trả về false nếu không góc nào đưa bi vào lỗ (khi đó ngắm cú đưa bi gần lỗ nhất)
+    bool aimAtBestShot(float power = AIM_ASSIST_POWER);
 };
 
 #endif
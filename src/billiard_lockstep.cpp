@@ -0,0 +1,418 @@
+#include "billiard_lockstep.h"
+
+static const float FULL_TURN = (float)TWO_PI;
+static const uint32_t FNV_OFFSET = 2166136261u;
+static const uint32_t FNV_PRIME = 16777619u;
+static const size_t SNAPSHOT_HEADER_BYTES = 10;  // version, seq, tick, shooter, on-table mask
+static const float RESPAWN_CLEARANCE_SQ = (BALL_RADIUS * 2 + 1) * (BALL_RADIUS * 2 + 1);
+static const int RESPAWN_ATTEMPTS = 8;
+
+// Raw bits of a position, for hashing and snapshots
+static uint32_t bitsOf(sim_t v) {
+#ifdef SIM_FIXED_POINT
+    return (uint32_t)v.getRaw();
+#else
+    uint32_t bits;
+    memcpy(&bits, &v, sizeof(bits));
+    return bits;
+#endif
+}
+
+static sim_t fromBits(uint32_t bits) {
+#ifdef SIM_FIXED_POINT
+    return Fixed16::fromRaw((int32_t)bits);
+#else
+    float v;
+    memcpy(&v, &bits, sizeof(v));
+    return v;
+#endif
+}
+
+static sim_t angleOf(int32_t raw) {
+#ifdef SIM_FIXED_POINT
+    return Fixed16::fromRaw(raw);
+#else
+    return (float)raw / 65536.0f;
+#endif
+}
+
+static uint8_t snapshotVersion() {
+#ifdef SIM_FIXED_POINT
+    return BilliardLockstep::SNAPSHOT_VERSION | BilliardLockstep::SNAPSHOT_FIXED_POINT;
+#else
+    return BilliardLockstep::SNAPSHOT_VERSION;
+#endif
+}
+
+static uint32_t fnv(uint32_t hash, uint32_t value, int bytes) {
+    for (int i = 0; i < bytes; i++) {
+        hash = (hash ^ ((value >> (8 * i)) & 0xFF)) * FNV_PRIME;
+    }
+    return hash;
+}
+
+static void putLe(uint8_t* out, uint32_t value, int bytes) {
+    for (int i = 0; i < bytes; i++) {
+        out[i] = (uint8_t)(value >> (8 * i));
+    }
+}
+
+static uint32_t getLe(const uint8_t* in, int bytes) {
+    uint32_t value = 0;
+    for (int i = 0; i < bytes; i++) {
+        value |= (uint32_t)in[i] << (8 * i);
+    }
+    return value;
+}
+
+static int hexDigit(char c) {
+    if (c >= '0' && c <= '9') return c - '0';
+    if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+    if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+    return -1;
+}
+
+BilliardLockstep::BilliardLockstep(BilliardPhysics& physics) : physics(physics) {
+    start(0);
+}
+
+void BilliardLockstep::start(uint8_t localPlayer) {
+    this->localPlayer = localPlayer;
+    physics.rack();
+    seq = 0;
+    tick = 0;
+    shooter = 0;
+    inShot = false;
+    lastShotLocal = false;
+    objectsBeforeShot = 0;
+    shotTicks = 0;
+    accumulatorMs = 0;
+    pendingCount = 0;
+    waitingForSync = false;
+    syncRequestDue = false;
+    syncWaitMs = 0;
+    snapshotDue = false;
+    desyncCount = 0;
+    snapshotsAdopted = 0;
+}
+
+int BilliardLockstep::advance(uint32_t elapsedMs) {
+    physics.clearEvents();
+
+    if (waitingForSync) {
+        syncWaitMs += elapsedMs;
+        if (syncWaitMs >= SYNC_RETRY_MS) {
+            syncWaitMs = 0;
+            syncRequestDue = true;
+        }
+    }
+
+    if (!inShot && pendingCount > 0 && !waitingForSync) {
+        Shot next = pending[0];
+        pendingCount--;
+        for (int i = 0; i < pendingCount; i++) {
+            pending[i] = pending[i + 1];
+        }
+        playRemote(next);
+    }
+    if (!inShot) {
+        accumulatorMs = 0;
+        return 0;
+    }
+
+    // Only whole ticks while balls move: the tick count of a shot is the same on both devices
+    accumulatorMs += elapsedMs;
+    int ticks = 0;
+    while (inShot && accumulatorMs >= BilliardPhysics::TICK_MS) {
+        if (ticks == BilliardPhysics::MAX_TICKS_PER_ADVANCE) {
+            accumulatorMs = 0;
+            break;
+        }
+        physics.step();
+        tick++;
+        shotTicks++;
+        ticks++;
+        accumulatorMs -= BilliardPhysics::TICK_MS;
+        if (!physics.isMoving() || shotTicks >= MAX_SHOT_TICKS) {
+            finishShot();
+        }
+    }
+    return ticks;
+}
+
+bool BilliardLockstep::canShoot() const {
+    return !inShot && shooter == localPlayer && pendingCount == 0 && !waitingForSync && !snapshotDue;
+}
+
+bool BilliardLockstep::shoot(float angle, float power, Shot& out) {
+    if (!canShoot()) {
+        return false;
+    }
+
+    float a = fmodf(angle, FULL_TURN);
+    if (a < 0.0f) a += FULL_TURN;
+    if (power < 0.0f) power = 0.0f;
+    if (power > 100.0f) power = 100.0f;
+
+    out.seq = (uint16_t)(seq + 1);
+    out.tick = tick;
+    out.angle = (int32_t)(a * 65536.0f + 0.5f);
+    out.power = (uint16_t)(power * 100.0f + 0.5f);
+    out.hash = stateHash();
+    // Play the quantized shot, exactly what the opponent will replay
+    applyShot(out, true);
+    return true;
+}
+
+BilliardLockstep::ReceiveResult BilliardLockstep::receive(const Shot& shot) {
+    if (waitingForSync) {
+        return RECEIVE_IGNORED;
+    }
+
+    uint16_t last = (uint16_t)(seq + pendingCount);
+    int16_t ahead = (int16_t)(shot.seq - last);
+    if (ahead <= 0) {
+        if (shot.seq == seq && lastShotLocal) {
+            // Both sides shot with the same seq: they disagreed on whose turn it was
+            onDesync();
+            return RECEIVE_DESYNC;
+        }
+        return RECEIVE_DUPLICATE;
+    }
+    if (ahead > 1 || pendingCount == MAX_PENDING_SHOTS) {
+        onDesync();  // Missed a shot
+        return RECEIVE_DESYNC;
+    }
+    if (inShot || pendingCount > 0) {
+        pending[pendingCount++] = shot;
+        return RECEIVE_QUEUED;
+    }
+    return playRemote(shot);
+}
+
+BilliardLockstep::ReceiveResult BilliardLockstep::playRemote(const Shot& shot) {
+    bool theirTurn = shooter != localPlayer;
+    if (theirTurn && shot.tick == tick && shot.hash == stateHash()) {
+        applyShot(shot, false);
+        return RECEIVE_APPLIED;
+    }
+
+    onDesync();
+    if (isHost() && theirTurn) {
+        // Our table is the reference: the shot stands on it, the snapshot follows
+        applyShot(shot, false);
+    }
+    return RECEIVE_DESYNC;
+}
+
+void BilliardLockstep::applyShot(const Shot& shot, bool local) {
+    seq = shot.seq;
+    lastShotLocal = local;
+    objectsBeforeShot = countObjectBalls();
+    shotTicks = 0;
+    accumulatorMs = 0;
+
+    Ball& cueBall = physics.getBalls()[0];
+    sim_t speed = BilliardPhysics::shotSpeed(shot.power / 100.0f);
+    sim_t angle = angleOf(shot.angle);
+    cueBall.vx = simCos(angle) * speed;
+    cueBall.vy = simSin(angle) * speed;
+    cueBall.isActive = true;
+    inShot = true;
+}
+
+void BilliardLockstep::finishShot() {
+    Ball* balls = physics.getBalls();
+    if (shotTicks >= MAX_SHOT_TICKS) {
+        // Still circling a pocket mouth after a minute: stop everything where it is
+        for (int i = 0; i < BALL_COUNT; i++) {
+            if (balls[i].x >= 0) {
+                physics.placeBall(i, balls[i].x, balls[i].y);
+            }
+        }
+    }
+
+    bool scratch = balls[0].x < 0;
+    int objects = countObjectBalls();
+    bool potted = objects < objectsBeforeShot;
+    if (scratch) {
+        respawnCueBall();
+    }
+    if (objects == 0) {
+        physics.rack();
+    }
+    if (!potted || scratch) {
+        shooter ^= 1;
+    }
+    inShot = false;
+}
+
+void BilliardLockstep::respawnCueBall() {
+    const Ball* balls = physics.getBalls();
+    float x = CUE_START_X;
+    float y = CUE_START_Y;
+    for (int attempt = 0; attempt < RESPAWN_ATTEMPTS; attempt++) {
+        bool blocked = false;
+        for (int i = 1; i < BALL_COUNT && !blocked; i++) {
+            if (balls[i].x < 0) continue;
+            float dx = (float)balls[i].x - x;
+            float dy = (float)balls[i].y - y;
+            blocked = dx * dx + dy * dy < RESPAWN_CLEARANCE_SQ;
+        }
+        if (!blocked) break;
+        x += RACK_SPACING;
+    }
+    physics.placeBall(0, sim_t(x), sim_t(y));
+}
+
+int BilliardLockstep::countObjectBalls() const {
+    const Ball* balls = physics.getBalls();
+    int count = 0;
+    for (int i = 1; i < BALL_COUNT; i++) {
+        if (balls[i].x >= 0) count++;
+    }
+    return count;
+}
+
+void BilliardLockstep::onDesync() {
+    desyncCount++;
+    if (isHost()) {
+        snapshotDue = true;
+    } else {
+        waitingForSync = true;
+        syncRequestDue = true;
+        syncWaitMs = 0;
+        pendingCount = 0;
+    }
+}
+
+void BilliardLockstep::requestSnapshot() {
+    if (isHost()) {
+        snapshotDue = true;
+    }
+}
+
+BilliardLockstep::Outgoing BilliardLockstep::pollOutgoing() {
+    if (syncRequestDue) {
+        syncRequestDue = false;
+        return OUTGOING_SYNC_REQUEST;
+    }
+    if (snapshotDue && !inShot) {
+        snapshotDue = false;
+        return OUTGOING_SNAPSHOT;
+    }
+    return OUTGOING_NONE;
+}
+
+uint32_t BilliardLockstep::stateHash() const {
+    const Ball* balls = physics.getBalls();
+    uint32_t hash = FNV_OFFSET;
+    hash = fnv(hash, seq, 2);
+    hash = fnv(hash, tick, 4);
+    hash = fnv(hash, shooter, 1);
+    for (int i = 0; i < BALL_COUNT; i++) {
+        hash = fnv(hash, bitsOf(balls[i].x), 4);
+        hash = fnv(hash, bitsOf(balls[i].y), 4);
+    }
+    return hash;
+}
+
+size_t BilliardLockstep::writeSnapshot(uint8_t* out, size_t capacity) const {
+    if (inShot) {
+        return 0;  // Velocities aren't part of a snapshot
+    }
+    const Ball* balls = physics.getBalls();
+    uint16_t mask = 0;
+    size_t length = SNAPSHOT_HEADER_BYTES;
+    for (int i = 0; i < BALL_COUNT; i++) {
+        if (balls[i].x >= 0) {
+            mask |= (uint16_t)(1u << i);
+            length += 8;
+        }
+    }
+    if (length > capacity) {
+        return 0;
+    }
+
+    out[0] = snapshotVersion();
+    putLe(out + 1, seq, 2);
+    putLe(out + 3, tick, 4);
+    out[7] = shooter;
+    putLe(out + 8, mask, 2);
+    uint8_t* p = out + SNAPSHOT_HEADER_BYTES;
+    for (int i = 0; i < BALL_COUNT; i++) {
+        if (mask & (1u << i)) {
+            putLe(p, bitsOf(balls[i].x), 4);
+            putLe(p + 4, bitsOf(balls[i].y), 4);
+            p += 8;
+        }
+    }
+    return length;
+}
+
+String BilliardLockstep::writeSnapshotText() const {
+    static const char HEX_DIGITS[] = "0123456789abcdef";
+    uint8_t bytes[SNAPSHOT_MAX_BYTES];
+    size_t length = writeSnapshot(bytes, sizeof(bytes));
+    String text;
+    text.reserve(length * 2);
+    for (size_t i = 0; i < length; i++) {
+        text += HEX_DIGITS[bytes[i] >> 4];
+        text += HEX_DIGITS[bytes[i] & 0x0F];
+    }
+    return text;
+}
+
+bool BilliardLockstep::readSnapshot(const uint8_t* data, size_t length) {
+    if (isHost() || length < SNAPSHOT_HEADER_BYTES || data[0] != snapshotVersion()) {
+        return false;
+    }
+    uint16_t mask = (uint16_t)getLe(data + 8, 2);
+    size_t expected = SNAPSHOT_HEADER_BYTES;
+    for (int i = 0; i < BALL_COUNT; i++) {
+        if (mask & (1u << i)) expected += 8;
+    }
+    // Cue ball is always on a settled table
+    if (length != expected || (mask >> BALL_COUNT) != 0 || (mask & 1u) == 0 || data[7] > 1) {
+        return false;
+    }
+
+    const uint8_t* p = data + SNAPSHOT_HEADER_BYTES;
+    for (int i = 0; i < BALL_COUNT; i++) {
+        if (mask & (1u << i)) {
+            physics.placeBall(i, fromBits(getLe(p, 4)), fromBits(getLe(p + 4, 4)));
+            p += 8;
+        } else {
+            physics.removeBall(i);
+        }
+    }
+    seq = (uint16_t)getLe(data + 1, 2);
+    tick = getLe(data + 3, 4);
+    shooter = data[7];
+    inShot = false;
+    lastShotLocal = false;
+    accumulatorMs = 0;
+    pendingCount = 0;
+    waitingForSync = false;
+    syncRequestDue = false;
+    syncWaitMs = 0;
+    snapshotsAdopted++;
+    return true;
+}
+
+bool BilliardLockstep::readSnapshotText(const String& text) {
+    uint8_t bytes[SNAPSHOT_MAX_BYTES];
+    size_t length = text.length() / 2;
+    if (text.length() % 2 != 0 || length > sizeof(bytes)) {
+        return false;
+    }
+    for (size_t i = 0; i < length; i++) {
+        int high = hexDigit(text[2 * i]);
+        int low = hexDigit(text[2 * i + 1]);
+        if (high < 0 || low < 0) {
+            return false;
+        }
+        bytes[i] = (uint8_t)(high << 4 | low);
+    }
+    return readSnapshot(bytes, length);
+}
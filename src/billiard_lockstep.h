@@ -0,0 +1,141 @@
+#ifndef BILLIARD_LOCKSTEP_H
+#define BILLIARD_LOCKSTEP_H
+
+#include <Arduino.h>
+#include "billiard_physics.h"
+
+// Two-player billiards where only shots travel over the network.
+//
+// Both devices run the same BilliardPhysics from the same rack; a shot is
+// (seq, tick, angle, power) plus a hash of the table it was taken from, and
+// the receiver replays it on its own table. The simulation only ticks while
+// balls are moving and runs each shot until the table settles, so how often
+// a device renders never changes the result: after shot n both tables hold
+// the same bits. Build both sides with -DSIM_FIXED_POINT - float only matches
+// between identical builds on identical hardware.
+//
+// Rules applied at every settle, identically on both sides: a pocketed cue
+// ball comes back on its spot (or the first free spot right of it), the
+// shooter keeps the turn after potting an object ball without scratching,
+// and a cleared table is racked again. Player 0 (the session host) breaks.
+//
+// Desync: each incoming shot's tick/hash is checked against the local table
+// before it is applied. Player 0 is the authority - on a mismatch it keeps
+// its own table and sends a snapshot (about 80 bytes: positions of the balls
+// still on the table) once it settles; player 1 drops the shot, asks for a
+// snapshot and adopts it. Shots arriving while a previous one still plays
+// are queued.
+//
+// Transport-free (no Serial, no SocketManager): the caller sends what
+// shoot() fills in and what pollOutgoing() asks for, and feeds receive() /
+// readSnapshot() with what arrives. tools/lockstep drives two of these
+// through the real wire encoding.
+class BilliardLockstep {
+public:
+    static const uint8_t SNAPSHOT_VERSION = 1;
+    static const uint8_t SNAPSHOT_FIXED_POINT = 0x80;  // Version flag: positions are Q16.16
+    static const size_t SNAPSHOT_MAX_BYTES = 10 + BALL_COUNT * 8;
+    static const int MAX_PENDING_SHOTS = 4;
+    static const uint32_t MAX_SHOT_TICKS = 3000;  // 60 s of play, then the table is stopped where it is
+    static const uint32_t SYNC_RETRY_MS = 2000;   // Player 1 repeats an unanswered snapshot request
+
+    struct Shot {
+        uint16_t seq;     // 1 for the first shot of the session
+        uint32_t tick;    // Simulation ticks played before this shot
+        int32_t angle;    // Radians, Q16.16, [0, 2pi)
+        uint16_t power;   // Hundredths, 0-10000
+        uint32_t hash;    // stateHash() of the table the shot was taken from
+    };
+
+    enum ReceiveResult {
+        RECEIVE_APPLIED = 0,  // Playing now
+        RECEIVE_QUEUED,       // Plays after the current shot settles
+        RECEIVE_DUPLICATE,    // Already applied
+        RECEIVE_IGNORED,      // Waiting for a snapshot, which will cover it
+        RECEIVE_DESYNC        // Did not match the local table (see class comment)
+    };
+
+    enum Outgoing {
+        OUTGOING_NONE = 0,
+        OUTGOING_SYNC_REQUEST,  // Send a sync message without a snapshot
+        OUTGOING_SNAPSHOT       // Send writeSnapshotText()
+    };
+
+    explicit BilliardLockstep(BilliardPhysics& physics);
+
+    // Fresh rack, seq 0, player 0 to shoot. localPlayer: 0 = host, 1 = guest.
+    void start(uint8_t localPlayer);
+
+    // Play the current shot for elapsedMs (whole ticks of BilliardPhysics::TICK_MS).
+    // Pocket events / collision flag cover this call, like BilliardPhysics::advance().
+    // Returns the ticks played.
+    int advance(uint32_t elapsedMs);
+
+    // Settled, local player's turn, nothing queued, not waiting for a snapshot
+    bool canShoot() const;
+
+    // Quantize and play a local shot. Fills out for the opponent; false if !canShoot().
+    bool shoot(float angle, float power, Shot& out);
+
+    ReceiveResult receive(const Shot& shot);
+
+    // Player 0: the opponent asked for a snapshot (sent once settled)
+    void requestSnapshot();
+
+    // What the caller should send now, if anything (each request is returned once)
+    Outgoing pollOutgoing();
+
+    // Settled table as bytes (0 if moving or capacity is too small) / hex text
+    size_t writeSnapshot(uint8_t* out, size_t capacity) const;
+    String writeSnapshotText() const;
+
+    // Player 1: adopt player 0's table - always, player 0 is the truth. Ignored
+    // on player 0 and for snapshots of the other number format. True if adopted.
+    bool readSnapshot(const uint8_t* data, size_t length);
+    bool readSnapshotText(const String& text);
+
+    // FNV-1a over seq, tick, shooter and the raw bits of every ball position
+    uint32_t stateHash() const;
+
+    bool isHost() const { return localPlayer == 0; }
+    bool isSettled() const { return !inShot; }
+    bool isLocalTurn() const { return shooter == localPlayer; }
+    bool isWaitingForSync() const { return waitingForSync; }
+    uint8_t getShooter() const { return shooter; }
+    uint16_t getSeq() const { return seq; }
+    uint32_t getTick() const { return tick; }
+    uint32_t getDesyncCount() const { return desyncCount; }
+    uint32_t getSnapshotsAdopted() const { return snapshotsAdopted; }
+
+private:
+    BilliardPhysics& physics;
+    uint8_t localPlayer;
+
+    uint16_t seq;          // Last shot applied
+    uint32_t tick;
+    uint8_t shooter;       // Whose turn it is (settled) / who is shooting (inShot)
+    bool inShot;
+    bool lastShotLocal;    // Shot seq was ours (a remote shot with the same seq is a conflict)
+    int objectsBeforeShot;
+    uint32_t shotTicks;
+    uint32_t accumulatorMs;
+
+    Shot pending[MAX_PENDING_SHOTS];
+    int pendingCount;
+
+    bool waitingForSync;   // Player 1: table is stale until a snapshot arrives
+    bool syncRequestDue;
+    uint32_t syncWaitMs;
+    bool snapshotDue;      // Player 0: send a snapshot at the next settle
+    uint32_t desyncCount;
+    uint32_t snapshotsAdopted;
+
+    void applyShot(const Shot& shot, bool local);
+    ReceiveResult playRemote(const Shot& shot);
+    void finishShot();
+    void respawnCueBall();
+    int countObjectBalls() const;
+    void onDesync();
+};
+
+#endif
@@ -0,0 +1,404 @@
+#include "billiard_physics.h"
+
+static const sim_t POCKETS[BilliardPhysics::POCKET_COUNT][2] = {
+    {sim_t(TABLE_X), sim_t(TABLE_Y)},                                  // Top-left
+    {sim_t(TABLE_X + TABLE_WIDTH), sim_t(TABLE_Y)},                    // Top-right
+    {sim_t(TABLE_X), sim_t(TABLE_Y + TABLE_HEIGHT)},                   // Bottom-left
+    {sim_t(TABLE_X + TABLE_WIDTH), sim_t(TABLE_Y + TABLE_HEIGHT)},     // Bottom-right
+    {sim_t(TABLE_X + TABLE_WIDTH / 2), sim_t(TABLE_Y)},                // Top middle
+    {sim_t(TABLE_X + TABLE_WIDTH / 2), sim_t(TABLE_Y + TABLE_HEIGHT)}  // Bottom middle
+};
+
+static const sim_t ZERO = sim_t(0);
+static const sim_t HALF = sim_t(0.5f);
+static const sim_t POCKET_R = sim_t(POCKET_RADIUS);
+static const sim_t POCKET_RADIUS_SQ = sim_t(POCKET_RADIUS * POCKET_RADIUS);
+static const sim_t ATTRACTION_RADIUS = sim_t(POCKET_RADIUS + BALL_RADIUS + POCKET_ATTRACTION_MARGIN);
+static const sim_t ATTRACTION_RADIUS_SQ = ATTRACTION_RADIUS * ATTRACTION_RADIUS;
+static const sim_t ATTRACTION = sim_t(POCKET_ATTRACTION);
+static const sim_t FRICTION_FACTOR = sim_t(FRICTION);
+static const sim_t MIN_VELOCITY_SQ = sim_t(MIN_VELOCITY * MIN_VELOCITY);
+static const sim_t BOUNCE_THRESHOLD_SQ = sim_t((MIN_VELOCITY * 2.0f) * (MIN_VELOCITY * 2.0f));
+static const sim_t BOUNCE = sim_t(WALL_BOUNCE);
+static const sim_t CONTACT_DISTANCE = sim_t(BALL_RADIUS * 2);
+static const sim_t CONTACT_DISTANCE_SQ = sim_t(BALL_RADIUS * 2 * BALL_RADIUS * 2);
+static const sim_t TOUCH_DISTANCE = sim_t(BALL_RADIUS * 2 * 1.12f);  // Nới margin để bắt cả va chạm nhẹ
+static const sim_t TOUCH_DISTANCE_SQ = TOUCH_DISTANCE * TOUCH_DISTANCE;
+static const sim_t DEEP_OVERLAP_DISTANCE = sim_t(BALL_RADIUS * 2 * 0.9f);
+static const sim_t SEPARATION = sim_t(0.6f);
+static const sim_t RESTITUTION = sim_t(BALL_RESTITUTION);
+static const sim_t MIN_DIST_SQ = sim_t(0.0001f);
+static const sim_t MAX_TRAVEL_PER_SUBSTEP = sim_t(BALL_RADIUS * 0.5f);
+static const sim_t EDGE_MIN_X = sim_t(TABLE_X + BALL_RADIUS + 1);  // Không để bi "ăn" vào thành bàn
+static const sim_t EDGE_MAX_X = sim_t(TABLE_X + TABLE_WIDTH - BALL_RADIUS - 1);
+static const sim_t EDGE_MIN_Y = sim_t(TABLE_Y + BALL_RADIUS + 1);
+static const sim_t EDGE_MAX_Y = sim_t(TABLE_Y + TABLE_HEIGHT - BALL_RADIUS - 1);
+static const sim_t TABLE_LEFT = sim_t(TABLE_X);
+static const sim_t TABLE_RIGHT = sim_t(TABLE_X + TABLE_WIDTH);
+static const sim_t TABLE_TOP = sim_t(TABLE_Y);
+static const sim_t TABLE_BOTTOM = sim_t(TABLE_Y + TABLE_HEIGHT);
+static const sim_t POCKETED_POSITION = sim_t(-100);
+
+// |dx|, |dy| are checked first: cheap rejection, and keeps the squares small
+// enough for Q16.16
+static bool withinRadius(sim_t dx, sim_t dy, sim_t radius, sim_t radiusSq, sim_t& distSq) {
+    if (simAbs(dx) > radius || simAbs(dy) > radius) {
+        return false;
+    }
+    distSq = dx * dx + dy * dy;
+    return distSq <= radiusSq;
+}
+
+BilliardPhysics::BilliardPhysics() {
+    for (int i = 0; i < BALL_COUNT; i++) {
+        balls[i].x = POCKETED_POSITION;
+        balls[i].y = POCKETED_POSITION;
+        balls[i].vx = ZERO;
+        balls[i].vy = ZERO;
+        balls[i].color = 0;
+        balls[i].isActive = false;
+        order[i] = i;
+        excluded[i] = true;
+    }
+    accumulatorMs = 0;
+    tickCount = 0;
+    collision = false;
+    pocketEventCount = 0;
+}
+
+void BilliardPhysics::rack() {
+    placeBall(0, sim_t(CUE_START_X), sim_t(CUE_START_Y));
+
+    // Xếp thành hình tam giác: 1, 2, 3, 2 (tổng 8 quả), đỉnh hướng về bi trắng
+    static const int ROW_SIZES[] = { 1, 2, 3, 2 };
+    float startX = TABLE_X + TABLE_WIDTH - 80;
+    float startY = TABLE_Y + TABLE_HEIGHT / 2;
+    int index = 1;
+    for (int row = 0; row < 4 && index < BALL_COUNT; row++) {
+        float x = startX - RACK_SPACING * row;
+        float top = startY - RACK_SPACING * 0.5f * (ROW_SIZES[row] - 1);
+        for (int i = 0; i < ROW_SIZES[row] && index < BALL_COUNT; i++) {
+            placeBall(index++, sim_t(x), sim_t(top + RACK_SPACING * i));
+        }
+    }
+    while (index < BALL_COUNT) {
+        removeBall(index++);
+    }
+}
+
+void BilliardPhysics::placeBall(int index, sim_t x, sim_t y) {
+    balls[index].x = x;
+    balls[index].y = y;
+    balls[index].vx = ZERO;
+    balls[index].vy = ZERO;
+    balls[index].isActive = false;
+}
+
+void BilliardPhysics::removeBall(int index) {
+    placeBall(index, POCKETED_POSITION, POCKETED_POSITION);
+}
+
+void BilliardPhysics::clearEvents() {
+    collision = false;
+    pocketEventCount = 0;
+}
+
+bool BilliardPhysics::isInPocket(sim_t x, sim_t y) {
+    for (int p = 0; p < POCKET_COUNT; p++) {
+        sim_t distSq;
+        if (withinRadius(x - POCKETS[p][0], y - POCKETS[p][1], POCKET_R, POCKET_RADIUS_SQ, distSq) &&
+            distSq < POCKET_RADIUS_SQ) {
+            return true;
+        }
+    }
+    // The pocket mouth has no rails: a center past the cushion line there has
+    // dropped, otherwise it would sail off the cloth beside the pocket
+    bool offCloth = x < TABLE_LEFT || x > TABLE_RIGHT || y < TABLE_TOP || y > TABLE_BOTTOM;
+    return offCloth && isInAttractionZone(x, y);
+}
+
+bool BilliardPhysics::isInAttractionZone(sim_t x, sim_t y) {
+    if (x < ZERO) {
+        return false;  // Already pocketed sentinel
+    }
+    for (int p = 0; p < POCKET_COUNT; p++) {
+        sim_t distSq;
+        if (withinRadius(x - POCKETS[p][0], y - POCKETS[p][1], ATTRACTION_RADIUS, ATTRACTION_RADIUS_SQ, distSq)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+void BilliardPhysics::getPocketPosition(int pocket, sim_t& x, sim_t& y) {
+    x = POCKETS[pocket][0];
+    y = POCKETS[pocket][1];
+}
+
+sim_t BilliardPhysics::getAttractionRadius() {
+    return ATTRACTION_RADIUS;
+}
+
+void BilliardPhysics::getCushionBounds(sim_t& minX, sim_t& minY, sim_t& maxX, sim_t& maxY) {
+    minX = EDGE_MIN_X;
+    minY = EDGE_MIN_Y;
+    maxX = EDGE_MAX_X;
+    maxY = EDGE_MAX_Y;
+}
+
+sim_t BilliardPhysics::shotSpeed(float power) {
+    if (power < MIN_SHOT_POWER) {
+        power = MIN_SHOT_POWER;
+    }
+    return sim_t(power * SHOT_SPEED_PER_POWER);
+}
+
+bool BilliardPhysics::isMoving() const {
+    for (int i = 0; i < BALL_COUNT; i++) {
+        if (balls[i].x >= ZERO && balls[i].isActive) {
+            return true;
+        }
+    }
+    return false;
+}
+
+int BilliardPhysics::advance(uint32_t elapsedMs) {
+    clearEvents();
+
+    accumulatorMs += elapsedMs;
+    int ticks = 0;
+    while (accumulatorMs >= TICK_MS) {
+        if (ticks == MAX_TICKS_PER_ADVANCE) {
+            accumulatorMs = 0;
+            break;
+        }
+        step();
+        accumulatorMs -= TICK_MS;
+        ticks++;
+    }
+    return ticks;
+}
+
+void BilliardPhysics::step() {
+    applyFrictionAndRest();
+
+    int substeps = chooseSubsteps();
+    sim_t dt = sim_t(1) / sim_t(substeps);
+    for (int s = 0; s < substeps; s++) {
+        moveBalls(dt);
+        collideBalls();
+    }
+    tickCount++;
+}
+
+void BilliardPhysics::applyFrictionAndRest() {
+    for (int i = 0; i < BALL_COUNT; i++) {
+        Ball& ball = balls[i];
+        if (ball.x < ZERO) continue;
+
+        bool inZone = isInAttractionZone(ball.x, ball.y);
+        if (!ball.isActive) {
+            // Reactivate slow/stuck balls that are already in the pocket mouth
+            if (!inZone) continue;
+            ball.isActive = true;
+        }
+
+        ball.vx *= FRICTION_FACTOR;
+        ball.vy *= FRICTION_FACTOR;
+
+        // Stop ball if velocity is too low (but never stop inside pocket attraction)
+        if (ball.vx * ball.vx + ball.vy * ball.vy < MIN_VELOCITY_SQ) {
+            if (inZone) {
+                // Keep the ball moving gently toward the pocket
+                ball.vx *= HALF;
+                ball.vy *= HALF;
+            } else {
+                ball.vx = ZERO;
+                ball.vy = ZERO;
+                ball.isActive = false;
+            }
+        }
+
+        if (inZone) {
+            attract(ball, sim_t(1));
+        }
+    }
+}
+
+int BilliardPhysics::chooseSubsteps() const {
+    sim_t maxSpeedSq = ZERO;
+    for (int i = 0; i < BALL_COUNT; i++) {
+        if (balls[i].x < ZERO || !balls[i].isActive) continue;
+        sim_t speedSq = balls[i].vx * balls[i].vx + balls[i].vy * balls[i].vy;
+        if (speedSq > maxSpeedSq) maxSpeedSq = speedSq;
+    }
+    return substepsFor(maxSpeedSq);
+}
+
+int BilliardPhysics::substepsFor(sim_t maxSpeedSq) {
+    // Smallest n with maxSpeed / n <= MAX_TRAVEL_PER_SUBSTEP
+    int n = MIN_SUBSTEPS;
+    while (n < MAX_SUBSTEPS) {
+        sim_t travel = sim_t(n) * MAX_TRAVEL_PER_SUBSTEP;
+        if (maxSpeedSq <= travel * travel) break;
+        n++;
+    }
+    return n;
+}
+
+void BilliardPhysics::moveBalls(sim_t dt) {
+    for (int i = 0; i < BALL_COUNT; i++) {
+        Ball& ball = balls[i];
+        if (ball.x < ZERO || !ball.isActive) continue;
+
+        ball.x += ball.vx * dt;
+        ball.y += ball.vy * dt;
+
+        // Pocket first, so a ball never bounces off the rail it should drop through
+        if (isInPocket(ball.x, ball.y)) {
+            pocketBall(i);
+            continue;
+        }
+
+        if (isInAttractionZone(ball.x, ball.y)) {
+            // Pocket mouth: no rails, keep pulling toward the pocket
+            attract(ball, dt);
+        } else {
+            collideWalls(ball);
+        }
+    }
+}
+
+void BilliardPhysics::pocketBall(int index) {
+    Ball& ball = balls[index];
+    if (pocketEventCount < BALL_COUNT) {
+        PocketEvent& e = pocketEvents[pocketEventCount++];
+        e.ball = (uint8_t)index;
+        e.x = ball.x;
+        e.y = ball.y;
+    }
+    ball.x = POCKETED_POSITION;
+    ball.y = POCKETED_POSITION;
+    ball.vx = ZERO;
+    ball.vy = ZERO;
+    ball.isActive = false;
+}
+
+void BilliardPhysics::attract(Ball& ball, sim_t scale) {
+    int target = -1;
+    sim_t closestDistSq = ATTRACTION_RADIUS_SQ;
+    for (int p = 0; p < POCKET_COUNT; p++) {
+        sim_t distSq;
+        if (withinRadius(ball.x - POCKETS[p][0], ball.y - POCKETS[p][1], ATTRACTION_RADIUS, ATTRACTION_RADIUS_SQ, distSq) &&
+            distSq < closestDistSq) {
+            closestDistSq = distSq;
+            target = p;
+        }
+    }
+    if (target == -1 || closestDistSq <= MIN_DIST_SQ) {
+        return;
+    }
+
+    sim_t pull = ATTRACTION * scale / simSqrt(closestDistSq);
+    ball.vx += (POCKETS[target][0] - ball.x) * pull;
+    ball.vy += (POCKETS[target][1] - ball.y) * pull;
+    ball.isActive = true;  // Keep ball active while being pulled in
+}
+
+void BilliardPhysics::collideWalls(Ball& ball) {
+    // Caller already excluded the pocket attraction zone, which covers every
+    // pocket mouth, so the rails are plain lines here
+    bool tooSlow = ball.vx * ball.vx + ball.vy * ball.vy < BOUNCE_THRESHOLD_SQ;
+
+    if (ball.x < EDGE_MIN_X || ball.x > EDGE_MAX_X) {
+        ball.x = ball.x < EDGE_MIN_X ? EDGE_MIN_X : EDGE_MAX_X;
+        if (tooSlow) {
+            ball.vx = ZERO;
+            ball.vy = ZERO;
+        } else {
+            ball.vx = -ball.vx * BOUNCE;  // Bounce with some energy loss
+        }
+    }
+    if (ball.y < EDGE_MIN_Y || ball.y > EDGE_MAX_Y) {
+        ball.y = ball.y < EDGE_MIN_Y ? EDGE_MIN_Y : EDGE_MAX_Y;
+        if (tooSlow) {
+            ball.vx = ZERO;
+            ball.vy = ZERO;
+        } else {
+            ball.vy = -ball.vy * BOUNCE;
+        }
+    }
+}
+
+void BilliardPhysics::collideBalls() {
+    // Broad phase: keep indices sorted by x (insertion sort - nearly sorted
+    // between substeps) and only test pairs whose x spans overlap. Equal x
+    // (a racked row) falls back to the index, so the order - and the contact
+    // resolution order - never depends on earlier ticks
+    for (int a = 1; a < BALL_COUNT; a++) {
+        uint8_t idx = order[a];
+        sim_t x = balls[idx].x;
+        int b = a - 1;
+        while (b >= 0 && (balls[order[b]].x > x || (balls[order[b]].x == x && order[b] > idx))) {
+            order[b + 1] = order[b];
+            b--;
+        }
+        order[b + 1] = idx;
+    }
+    for (int i = 0; i < BALL_COUNT; i++) {
+        // Skip attraction zone to avoid unnatural bounces when falling in
+        excluded[i] = balls[i].x < ZERO || isInAttractionZone(balls[i].x, balls[i].y);
+    }
+
+    for (int iter = 0; iter < COLLISION_ITERATIONS; iter++) {
+        for (int a = 0; a < BALL_COUNT; a++) {
+            int i = order[a];
+            if (excluded[i]) continue;
+
+            for (int b = a + 1; b < BALL_COUNT; b++) {
+                int j = order[b];
+                sim_t dx = balls[j].x - balls[i].x;
+                if (dx > TOUCH_DISTANCE) break;  // Sorted: no further ball can touch i
+                if (excluded[j]) continue;
+                sim_t dy = balls[j].y - balls[i].y;
+                sim_t distSq;
+                if (!withinRadius(dx, dy, TOUCH_DISTANCE, TOUCH_DISTANCE_SQ, distSq)) {
+                    continue;
+                }
+
+                // Luôn coi là khung va chạm nếu bi chạm nhẹ (mở rộng margin cho va chạm)
+                collision = true;
+                if (distSq >= CONTACT_DISTANCE_SQ || distSq <= MIN_DIST_SQ) {
+                    continue;
+                }
+
+                // Narrow phase: only touching balls pay for the sqrt
+                sim_t distance = simSqrt(distSq);
+                sim_t nx = dx / distance;
+                sim_t ny = dy / distance;
+
+                // Separate balls to prevent overlap (60% of overlap to prevent jitter)
+                sim_t separation = (CONTACT_DISTANCE - distance) * SEPARATION;
+                balls[i].x -= nx * separation;
+                balls[i].y -= ny * separation;
+                balls[j].x += nx * separation;
+                balls[j].y += ny * separation;
+
+                // Relative velocity along collision normal
+                sim_t dot = (balls[j].vx - balls[i].vx) * nx + (balls[j].vy - balls[i].vy) * ny;
+
+                // Apply impulse if approaching, or if deeply overlapping (push apart)
+                if (dot < ZERO || distance < DEEP_OVERLAP_DISTANCE) {
+                    // Equal masses; 0.6 keeps cue ball / object ball energy balanced
+                    sim_t impulse = RESTITUTION * dot;
+                    balls[i].vx += impulse * nx;
+                    balls[i].vy += impulse * ny;
+                    balls[j].vx -= impulse * nx;
+                    balls[j].vy -= impulse * ny;
+                    balls[i].isActive = true;
+                    balls[j].isActive = true;
+                }
+            }
+        }
+    }
+}
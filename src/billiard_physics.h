@@ -0,0 +1,125 @@
+#ifndef BILLIARD_PHYSICS_H
+#define BILLIARD_PHYSICS_H
+
+#include <Arduino.h>
+#include "sim_math.h"
+
+// Table dimensions - smaller to show cue stick and have margins
+#define TABLE_X 20
+#define TABLE_Y 20
+#define TABLE_WIDTH 280
+#define TABLE_HEIGHT 200
+#define POCKET_RADIUS 12  // Larger pocket radius for clearer visibility
+
+// Ball properties
+#define BALL_RADIUS 6
+#define BALL_COUNT 9  // 1 cue ball + 8 target balls
+#define FRICTION 0.975f  // Friction coefficient (tăng ma sát để quả bi dừng lại nhanh hơn)
+#define MIN_VELOCITY 0.2f  // Minimum velocity to stop ball (tăng để quả bi dừng sớm hơn)
+#define POCKET_ATTRACTION 0.3f  // Attraction force when near pocket
+#define POCKET_ATTRACTION_MARGIN 6.0f  // Extra radius for pocket attraction zone
+#define WALL_BOUNCE 0.8f  // Rail returns 80% of the speed into it
+#define BALL_RESTITUTION 0.6f  // Share of the normal speed a struck ball takes over
+#define SHOT_SPEED_PER_POWER 0.3f  // Cue ball speed (pixels per tick) per power point
+#define MIN_SHOT_POWER 5.0f
+#define CUE_START_X (TABLE_X + 80)  // Cue ball spot (bottom left), also where it respawns
+#define CUE_START_Y (TABLE_Y + TABLE_HEIGHT - 40)
+#define RACK_SPACING 13.0f  // Distance between racked ball centers
+
+struct Ball {
+    sim_t x, y;           // Position (table coordinates, x < 0 = pocketed)
+    sim_t vx, vy;         // Velocity (pixels per tick)
+    uint16_t color;       // Ball color
+    bool isActive;        // Is ball moving
+};
+
+// Display-independent billiard simulation.
+//
+// advance() feeds wall-clock time into an accumulator and runs whole fixed
+// ticks of TICK_MS, so the simulation rate does not depend on how often the
+// game renders. Each tick is split into substeps sized so no ball travels
+// more than half its radius per substep (fast breaks cannot tunnel).
+// Distance tests compare squared values; sqrt is only taken for balls that
+// actually touch or are being pulled into a pocket. Ball pairs are pruned by
+// a sweep over balls sorted by x. No allocation, no Serial, no drawing.
+// All state and math use sim_t (see sim_math.h), so -DSIM_FIXED_POINT makes
+// a shot replay bit-identical on device and host.
+//
+// Pocketed balls are parked at (-100, -100) and reported as PocketEvents so
+// the game can erase them and apply its rules (cue ball respawn etc.).
+// Everything a tick depends on lives in balls[] (the sweep order is a pure
+// function of the positions), so copying positions copies the simulation -
+// BilliardLockstep relies on that for its snapshots.
+class BilliardPhysics {
+public:
+    static const uint32_t TICK_MS = 20;
+    static const int MAX_TICKS_PER_ADVANCE = 5;  // After a long stall, drop time instead of catching up
+    static const int MIN_SUBSTEPS = 2;
+    static const int MAX_SUBSTEPS = 16;
+    static const int COLLISION_ITERATIONS = 2;   // Relaxation passes per substep
+    static const int POCKET_COUNT = 6;
+
+    struct PocketEvent {
+        uint8_t ball;
+        sim_t x, y;  // Where the ball went in
+    };
+
+    BilliardPhysics();
+
+    Ball* getBalls() { return balls; }
+    const Ball* getBalls() const { return balls; }
+
+    // Cue ball on its spot, object balls in a 1-2-3-2 triangle, all at rest.
+    // Colors are left to the game.
+    void rack();
+    void placeBall(int index, sim_t x, sim_t y);  // At rest, no event
+    void removeBall(int index);                   // Park off the table, no event
+    void clearEvents();
+
+    // Run as many fixed ticks as elapsedMs (plus leftover) allows.
+    // Events and the collision flag cover all ticks of this call.
+    int advance(uint32_t elapsedMs);
+    void resetClock() { accumulatorMs = 0; }
+
+    // One fixed tick (used by advance(), also handy for deterministic replays)
+    void step();
+
+    bool isMoving() const;
+    bool hadCollision() const { return collision; }
+    int getPocketEventCount() const { return pocketEventCount; }
+    const PocketEvent& getPocketEvent(int index) const { return pocketEvents[index]; }
+    uint32_t getTickCount() const { return tickCount; }
+
+    // Geometry helpers shared with the renderer
+    static bool isInPocket(sim_t x, sim_t y);
+    static bool isInAttractionZone(sim_t x, sim_t y);
+    static void getPocketPosition(int pocket, sim_t& x, sim_t& y);
+    static sim_t getAttractionRadius();
+    // Lines the ball centers bounce off (the rails, minus a ball radius)
+    static void getCushionBounds(sim_t& minX, sim_t& minY, sim_t& maxX, sim_t& maxY);
+    
+    // Single-ball rules, also run by BilliardShotPredictor
+    static sim_t shotSpeed(float power);  // Cue ball launch speed for a 0-100 power
+    static int substepsFor(sim_t maxSpeedSq);
+    static void collideWalls(Ball& ball);
+    static void attract(Ball& ball, sim_t scale);
+
+private:
+    Ball balls[BALL_COUNT];
+    uint8_t order[BALL_COUNT];  // Ball indices sorted by x (sweep-and-prune)
+    bool excluded[BALL_COUNT];  // Pocketed / falling in - no ball-ball contact
+
+    uint32_t accumulatorMs;
+    uint32_t tickCount;
+    bool collision;
+    PocketEvent pocketEvents[BALL_COUNT];
+    int pocketEventCount;
+
+    void applyFrictionAndRest();
+    int chooseSubsteps() const;
+    void moveBalls(sim_t dt);
+    void collideBalls();
+    void pocketBall(int index);
+};
+
+#endif
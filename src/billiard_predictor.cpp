@@ -0,0 +1,539 @@
+#include "billiard_predictor.h"
+
+namespace {
+
+const float CONTACT_DISTANCE = BALL_RADIUS * 2.0f;
+const float CONTACT_DISTANCE_SQ = CONTACT_DISTANCE * CONTACT_DISTANCE;
+const float DEEP_OVERLAP_DISTANCE = CONTACT_DISTANCE * 0.9f;
+const float SEPARATION = 0.6f;
+const float MIN_VELOCITY_SQ = MIN_VELOCITY * MIN_VELOCITY;
+const float FULL_TURN = 6.28318531f;
+const float ZONE_NUDGE = 0.01f;  // Step past a zone boundary so the zone test agrees
+const int MAX_GRAZES = 3;        // Balls the cue ball skims without a contact being resolved
+
+// A rolling ball between ticks' worth of BilliardPhysics rules. Within a tick
+// the ball moves in a straight line at (vx, vy); at every tick boundary the
+// speed drops by FRICTION and the ball rests once it falls under MIN_VELOCITY.
+// Rails, pockets and contacts are only checked at the end of a substep, so the
+// phase is kept to land events where the physics does.
+struct Mover {
+    float x, y;
+    float vx, vy;   // Velocity for the current tick (friction already applied)
+    float phase;    // Share of the current tick already run, 0..1
+};
+
+enum Event {
+    EVENT_REST = 0,
+    EVENT_RAIL,
+    EVENT_BALL,
+    EVENT_ZONE
+};
+
+enum ZoneResult {
+    ZONE_LEFT = 0,
+    ZONE_DROPPED,
+    ZONE_STUCK
+};
+
+struct Table {
+    float pocketX[BilliardPhysics::POCKET_COUNT];
+    float pocketY[BilliardPhysics::POCKET_COUNT];
+    float zoneRadius;
+    float minX, minY, maxX, maxY;
+    bool blocking[BALL_COUNT];  // On the table and outside every zone - can be hit
+    float logFriction;
+};
+
+void loadTable(const Ball* balls, Table& table) {
+    for (int p = 0; p < BilliardPhysics::POCKET_COUNT; p++) {
+        sim_t px, py;
+        BilliardPhysics::getPocketPosition(p, px, py);
+        table.pocketX[p] = (float)px;
+        table.pocketY[p] = (float)py;
+    }
+    table.zoneRadius = (float)BilliardPhysics::getAttractionRadius();
+    sim_t minX, minY, maxX, maxY;
+    BilliardPhysics::getCushionBounds(minX, minY, maxX, maxY);
+    table.minX = (float)minX;
+    table.minY = (float)minY;
+    table.maxX = (float)maxX;
+    table.maxY = (float)maxY;
+    // BilliardPhysics leaves balls in a pocket mouth out of ball-ball contacts
+    for (int i = 0; i < BALL_COUNT; i++) {
+        table.blocking[i] = balls[i].x >= sim_t(0) && !BilliardPhysics::isInAttractionZone(balls[i].x, balls[i].y);
+    }
+    table.logFriction = logf(FRICTION);
+}
+
+int nearestPocket(const Table& table, float x, float y) {
+    int nearest = 0;
+    float nearestSq = 1e30f;
+    for (int p = 0; p < BilliardPhysics::POCKET_COUNT; p++) {
+        float dx = table.pocketX[p] - x;
+        float dy = table.pocketY[p] - y;
+        float distSq = dx * dx + dy * dy;
+        if (distSq < nearestSq) {
+            nearestSq = distSq;
+            nearest = p;
+        }
+    }
+    return nearest;
+}
+
+// Distance along the unit ray (dx, dy) to the circle of radius r around
+// (cx, cy), or -1 if the ray misses or points away from it
+float rayToCircle(float x, float y, float dx, float dy, float cx, float cy, float r) {
+    float ox = cx - x;
+    float oy = cy - y;
+    float along = ox * dx + oy * dy;
+    if (along <= 0.0f) return -1.0f;
+    float missSq = ox * ox + oy * oy - along * along;
+    float rSq = r * r;
+    if (missSq >= rSq) return -1.0f;
+    float t = along - sqrtf(rSq - missSq);
+    return t > 0.0f ? t : 0.0f;
+}
+
+void addPoint(BilliardShotPredictor::Path& path, float x, float y) {
+    int i = path.count < BilliardShotPredictor::MAX_PATH_POINTS ? path.count++ : path.count - 1;
+    path.x[i] = x;
+    path.y[i] = y;
+}
+
+float speedSq(const Mover& m) {
+    return m.vx * m.vx + m.vy * m.vy;
+}
+
+int substepsOf(const Mover& m) {
+    return BilliardPhysics::substepsFor(sim_t(speedSq(m)));
+}
+
+Ball toBall(const Mover& m) {
+    Ball ball;
+    ball.x = sim_t(m.x);
+    ball.y = sim_t(m.y);
+    ball.vx = sim_t(m.vx);
+    ball.vy = sim_t(m.vy);
+    ball.color = 0;
+    ball.isActive = true;
+    return ball;
+}
+
+void fromBall(const Ball& ball, Mover& m) {
+    m.x = (float)ball.x;
+    m.y = (float)ball.y;
+    m.vx = (float)ball.vx;
+    m.vy = (float)ball.vy;
+}
+
+// Start the next tick outside a pocket mouth; false if the ball comes to rest
+bool nextTick(Mover& m) {
+    m.vx *= FRICTION;
+    m.vy *= FRICTION;
+    m.phase = 0.0f;
+    if (speedSq(m) < MIN_VELOCITY_SQ) {
+        m.vx = 0.0f;
+        m.vy = 0.0f;
+        return false;
+    }
+    return true;
+}
+
+// Distance left before the ball rests: the rest of this tick, then v*f^k for
+// every later tick k whose speed is still at least MIN_VELOCITY
+float reach(const Table& table, const Mover& m) {
+    float v = sqrtf(speedSq(m));
+    float distance = (1.0f - m.phase) * v;
+    if (v * FRICTION >= MIN_VELOCITY) {
+        int ticks = (int)floorf(logf(MIN_VELOCITY / v) / table.logFriction);
+        distance += v * FRICTION * (1.0f - powf(FRICTION, (float)ticks)) / (1.0f - FRICTION);
+    }
+    return distance;
+}
+
+// Roll a distance shorter than reach() in a straight line, through as many
+// tick boundaries as it takes
+void roll(const Table& table, Mover& m, float distance) {
+    float v = sqrtf(speedSq(m));
+    if (v <= 0.0f) return;
+    m.x += m.vx / v * distance;
+    m.y += m.vy / v * distance;
+
+    float left = (1.0f - m.phase) * v;
+    if (distance < left) {
+        m.phase += distance / v;
+        return;
+    }
+    // k whole ticks from speed w cover w*(1 - f^k)/(1 - f)
+    distance -= left;
+    float w = v * FRICTION;
+    float ratio = 1.0f - distance * (1.0f - FRICTION) / w;
+    int ticks = ratio > 0.0f ? (int)floorf(logf(ratio) / table.logFriction) : 0;
+    float decay = powf(FRICTION, (float)ticks);
+    distance -= w * (1.0f - decay) / (1.0f - FRICTION);
+    w *= decay;
+    float scale = w / v;
+    m.vx *= scale;
+    m.vy *= scale;
+    m.phase = distance > 0.0f ? distance / w : 0.0f;
+    if (m.phase > 1.0f) m.phase = 1.0f;
+}
+
+// Run on to the end of the current substep, where the physics looks at rails,
+// pockets and contacts
+void toSubstepEnd(Mover& m, int substeps) {
+    float end = ceilf(m.phase * substeps - 1e-4f);
+    if (end < 1.0f) end = 1.0f;
+    float dt = end / substeps - m.phase;
+    m.x += m.vx * dt;
+    m.y += m.vy * dt;
+    m.phase = end / substeps;
+}
+
+// The physics' per-substep checks for one ball (BilliardPhysics::moveBalls)
+bool applySubstepRules(const Table& table, Mover& m, int substeps, int& pocket) {
+    Ball ball = toBall(m);
+    if (BilliardPhysics::isInPocket(ball.x, ball.y)) {
+        pocket = nearestPocket(table, m.x, m.y);
+        return true;
+    }
+    if (BilliardPhysics::isInAttractionZone(ball.x, ball.y)) {
+        BilliardPhysics::attract(ball, sim_t(1) / sim_t(substeps));
+    } else {
+        BilliardPhysics::collideWalls(ball);
+    }
+    fromBall(ball, m);
+    return false;
+}
+
+// Tick a ball through a pocket mouth with the physics' own rules, from the
+// middle of a tick until it drops or is outside the zone at a tick boundary
+ZoneResult stepZone(const Table& table, Mover& m, int& pocket) {
+    Ball ball = toBall(m);
+    const sim_t friction = sim_t(FRICTION);
+    const sim_t minVelocitySq = sim_t(MIN_VELOCITY_SQ);
+
+    int substeps = substepsOf(m);
+    int done = (int)ceilf(m.phase * substeps - 1e-4f);
+    sim_t dt = sim_t(1) / sim_t(substeps);
+    // Partial substep up to the next boundary, then whole ones
+    sim_t first = sim_t((done < 1 ? 1 : done) / (float)substeps - m.phase);
+    if (done < 1) done = 1;
+
+    for (int tick = 0; tick < BilliardShotPredictor::MAX_ZONE_TICKS; tick++) {
+        for (int s = done; s <= substeps; s++) {
+            sim_t step = s == done ? first : dt;
+            ball.x += ball.vx * step;
+            ball.y += ball.vy * step;
+            if (BilliardPhysics::isInPocket(ball.x, ball.y)) {
+                fromBall(ball, m);
+                pocket = nearestPocket(table, m.x, m.y);
+                return ZONE_DROPPED;
+            }
+            if (BilliardPhysics::isInAttractionZone(ball.x, ball.y)) {
+                BilliardPhysics::attract(ball, dt);
+            } else {
+                BilliardPhysics::collideWalls(ball);
+            }
+        }
+
+        if (!BilliardPhysics::isInAttractionZone(ball.x, ball.y)) {
+            fromBall(ball, m);
+            m.phase = 1.0f;  // Caller starts the next tick with the plain rules
+            return ZONE_LEFT;
+        }
+        ball.vx *= friction;
+        ball.vy *= friction;
+        if (ball.vx * ball.vx + ball.vy * ball.vy < minVelocitySq) {
+            ball.vx *= sim_t(0.5f);
+            ball.vy *= sim_t(0.5f);
+        }
+        BilliardPhysics::attract(ball, sim_t(1));
+        substeps = BilliardPhysics::substepsFor(ball.vx * ball.vx + ball.vy * ball.vy);
+        dt = sim_t(1) / sim_t(substeps);
+        first = dt;
+        done = 1;
+    }
+    fromBall(ball, m);
+    return ZONE_STUCK;
+}
+
+// Follow one ball until it rests, drops or touches a ball other than
+// self/ignore/graze. Appends to path; m ends at the last event (for
+// OUTCOME_HIT_BALL: where the two balls just touch).
+void trace(const Table& table, const Ball* balls, int self, int ignore, int graze,
+           Mover& m, BilliardShotPredictor::Path& path) {
+    path.outcome = BilliardShotPredictor::OUTCOME_STOPPED;
+    path.pocket = -1;
+    path.ball = -1;
+
+    for (int event = 0; event < BilliardShotPredictor::MAX_EVENTS; event++) {
+        if (m.phase >= 1.0f && !nextTick(m)) break;
+        if (speedSq(m) <= 0.0f) break;
+
+        if (BilliardPhysics::isInAttractionZone(sim_t(m.x), sim_t(m.y))) {
+            int pocket = -1;
+            ZoneResult zone = stepZone(table, m, pocket);
+            addPoint(path, m.x, m.y);
+            if (zone == ZONE_DROPPED) {
+                path.outcome = BilliardShotPredictor::OUTCOME_POCKETED;
+                path.pocket = pocket;
+                return;
+            }
+            if (zone == ZONE_STUCK) return;
+            continue;
+        }
+
+        float speed = sqrtf(speedSq(m));
+        float dx = m.vx / speed;
+        float dy = m.vy / speed;
+        float travel = reach(table, m);
+        Event next = EVENT_REST;
+        int hitBall = -1;
+
+        if (dx != 0.0f) {
+            float t = ((dx < 0.0f ? table.minX : table.maxX) - m.x) / dx;
+            if (t < 0.0f) t = 0.0f;
+            if (t < travel) {
+                travel = t;
+                next = EVENT_RAIL;
+            }
+        }
+        if (dy != 0.0f) {
+            float t = ((dy < 0.0f ? table.minY : table.maxY) - m.y) / dy;
+            if (t < 0.0f) t = 0.0f;
+            if (t < travel) {
+                travel = t;
+                next = EVENT_RAIL;
+            }
+        }
+        for (int j = 0; j < BALL_COUNT; j++) {
+            if (j == self || j == ignore || j == graze || !table.blocking[j]) continue;
+            float t = rayToCircle(m.x, m.y, dx, dy, (float)balls[j].x, (float)balls[j].y, CONTACT_DISTANCE);
+            if (t >= 0.0f && t < travel) {
+                travel = t;
+                next = EVENT_BALL;
+                hitBall = j;
+            }
+        }
+        for (int p = 0; p < BilliardPhysics::POCKET_COUNT; p++) {
+            float t = rayToCircle(m.x, m.y, dx, dy, table.pocketX[p], table.pocketY[p], table.zoneRadius);
+            if (t >= 0.0f && t < travel) {
+                travel = t;
+                next = EVENT_ZONE;
+            }
+        }
+
+        roll(table, m, travel);
+
+        if (next == EVENT_REST) {
+            m.vx = 0.0f;
+            m.vy = 0.0f;
+            addPoint(path, m.x, m.y);
+            return;
+        }
+        if (next == EVENT_BALL) {
+            addPoint(path, m.x, m.y);
+            path.outcome = BilliardShotPredictor::OUTCOME_HIT_BALL;
+            path.ball = hitBall;
+            return;
+        }
+        if (next == EVENT_ZONE) {
+            m.x += dx * ZONE_NUDGE;
+            m.y += dy * ZONE_NUDGE;
+            continue;
+        }
+
+        // Rail: the physics notices it one substep late and clamps the ball back
+        toSubstepEnd(m, substepsOf(m));
+        int pocket = -1;
+        if (applySubstepRules(table, m, substepsOf(m), pocket)) {
+            addPoint(path, m.x, m.y);
+            path.outcome = BilliardShotPredictor::OUTCOME_POCKETED;
+            path.pocket = pocket;
+            return;
+        }
+        addPoint(path, m.x, m.y);
+        if (speedSq(m) <= 0.0f) return;  // Too slow to bounce
+    }
+    // Out of events, or a tick boundary found it too slow: it ends here
+    m.vx = 0.0f;
+    m.vy = 0.0f;
+    addPoint(path, m.x, m.y);
+}
+
+// The touching pair through BilliardPhysics::collideBalls: at the end of the
+// substep where they first overlap, push apart and exchange impulse.
+// Returns false if the cue ball only skimmed past without a contact.
+bool resolveContact(Mover& cue, Mover& object) {
+    toSubstepEnd(cue, substepsOf(cue));
+    object.phase = cue.phase;
+    bool touched = false;
+    for (int iter = 0; iter < BilliardPhysics::COLLISION_ITERATIONS; iter++) {
+        float dx = object.x - cue.x;
+        float dy = object.y - cue.y;
+        float distSq = dx * dx + dy * dy;
+        if (distSq >= CONTACT_DISTANCE_SQ || distSq <= 0.0001f) continue;
+        float distance = sqrtf(distSq);
+        float nx = dx / distance;
+        float ny = dy / distance;
+
+        float separation = (CONTACT_DISTANCE - distance) * SEPARATION;
+        cue.x -= nx * separation;
+        cue.y -= ny * separation;
+        object.x += nx * separation;
+        object.y += ny * separation;
+
+        float dot = (object.vx - cue.vx) * nx + (object.vy - cue.vy) * ny;
+        if (dot < 0.0f || distance < DEEP_OVERLAP_DISTANCE) {
+            float impulse = BALL_RESTITUTION * dot;
+            cue.vx += impulse * nx;
+            cue.vy += impulse * ny;
+            object.vx -= impulse * nx;
+            object.vy -= impulse * ny;
+            touched = true;
+        }
+    }
+    return touched;
+}
+
+float pocketMiss(const Table& table, const BilliardShotPredictor::Path& path) {
+    float x = path.x[path.count - 1];
+    float y = path.y[path.count - 1];
+    int p = nearestPocket(table, x, y);
+    float dx = table.pocketX[p] - x;
+    float dy = table.pocketY[p] - y;
+    return sqrtf(dx * dx + dy * dy);
+}
+
+}  // namespace
+
+void BilliardShotPredictor::predict(const Ball* balls, int cueIndex, float angle, float power, Prediction& out) {
+    Table table;
+    loadTable(balls, table);
+
+    const Ball& cueBall = balls[cueIndex];
+    Mover cue;
+    cue.x = (float)cueBall.x;
+    cue.y = (float)cueBall.y;
+
+    out.angle = angle;
+    out.power = power;
+    out.objectBall = -1;
+    out.contactX = cue.x;
+    out.contactY = cue.y;
+    out.objectAngle = 0.0f;
+    out.cue.count = 0;
+    out.object.count = 0;
+    out.object.outcome = OUTCOME_STOPPED;
+    out.object.pocket = -1;
+    out.object.ball = -1;
+
+    addPoint(out.cue, cue.x, cue.y);
+    if (cueBall.x < sim_t(0)) {
+        out.cue.outcome = OUTCOME_STOPPED;
+        out.cue.pocket = -1;
+        out.cue.ball = -1;
+        return;
+    }
+
+    // Same launch as BilliardGame::handleChargeRelease; the first tick starts
+    // with friction like every other
+    sim_t speed = BilliardPhysics::shotSpeed(power);
+    cue.vx = (float)(simCos(sim_t(angle)) * speed);
+    cue.vy = (float)(simSin(sim_t(angle)) * speed);
+    cue.phase = 1.0f;
+
+    int graze = -1;
+    for (int attempt = 0; attempt <= MAX_GRAZES; attempt++) {
+        trace(table, balls, cueIndex, -1, graze, cue, out.cue);
+        if (out.cue.outcome != OUTCOME_HIT_BALL) return;
+
+        int j = out.cue.ball;
+        Mover object;
+        object.x = (float)balls[j].x;
+        object.y = (float)balls[j].y;
+        object.vx = 0.0f;
+        object.vy = 0.0f;
+        if (!resolveContact(cue, object)) {
+            graze = j;
+            continue;
+        }
+
+        out.objectBall = j;
+        out.contactX = cue.x;
+        out.contactY = cue.y;
+        out.objectAngle = atan2f(object.vy, object.vx);
+        addPoint(out.cue, cue.x, cue.y);
+        addPoint(out.object, (float)balls[j].x, (float)balls[j].y);
+        trace(table, balls, j, cueIndex, -1, object, out.object);
+        trace(table, balls, cueIndex, j, -1, cue, out.cue);
+        return;
+    }
+}
+
+bool BilliardShotPredictor::findBestShot(const Ball* balls, int cueIndex, float power, int angleSteps, Prediction& best) {
+    if (angleSteps < 1) angleSteps = 1;
+    if (angleSteps > MAX_SEARCH_STEPS) angleSteps = MAX_SEARCH_STEPS;
+    const float stepAngle = FULL_TURN / angleSteps;
+
+    Table table;
+    loadTable(balls, table);
+
+    bool pots[MAX_SEARCH_STEPS];
+    int potCount = 0;
+    int closestMissStep = -1;
+    float closestMiss = 1e30f;
+    Prediction trial;
+    for (int k = 0; k < angleSteps; k++) {
+        predict(balls, cueIndex, k * stepAngle, power, trial);
+        pots[k] = trial.isPot();
+        if (pots[k]) {
+            potCount++;
+        } else if (trial.objectBall >= 0 && !trial.isScratch()) {
+            float miss = pocketMiss(table, trial.object);
+            if (miss < closestMiss) {
+                closestMiss = miss;
+                closestMissStep = k;
+            }
+        }
+    }
+
+    if (potCount == 0) {
+        predict(balls, cueIndex, closestMissStep >= 0 ? closestMissStep * stepAngle : 0.0f, power, best);
+        return false;
+    }
+
+    // Widest run of potting angles (wrapping past 0): the aim with the most
+    // room for error on either side
+    float aim = 0.0f;
+    if (potCount < angleSteps) {
+        int first = 0;
+        while (pots[first]) first++;  // Start scanning just after a miss
+        int bestStart = 0;
+        int bestLength = 0;
+        int runStart = 0;
+        int runLength = 0;
+        for (int i = 1; i <= angleSteps; i++) {
+            int k = (first + i) % angleSteps;
+            if (pots[k]) {
+                if (runLength == 0) runStart = first + i;
+                runLength++;
+                if (runLength > bestLength) {
+                    bestLength = runLength;
+                    bestStart = runStart;
+                }
+            } else {
+                runLength = 0;
+            }
+        }
+        aim = (bestStart + (bestLength - 1) * 0.5f) * stepAngle;
+        if (aim >= FULL_TURN) aim -= FULL_TURN;
+    }
+    predict(balls, cueIndex, aim, power, best);
+    if (!best.isPot()) {
+        // Half-step aim between two potting angles missed: fall back to the run's own angle
+        predict(balls, cueIndex, (float)((int)(aim / stepAngle + 0.5f) % angleSteps) * stepAngle, power, best);
+    }
+    return best.isPot();
+}
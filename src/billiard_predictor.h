@@ -0,0 +1,69 @@
+#ifndef BILLIARD_PREDICTOR_H
+#define BILLIARD_PREDICTOR_H
+
+#include <Arduino.h>
+#include "billiard_physics.h"
+
+// Shot preview / aim assist on top of BilliardPhysics.
+//
+// Instead of ticking the whole table, a prediction casts the cue ball as a
+// ray: straight segments between events (rail, first ball contact, entering
+// a pocket's attraction zone), with the per-tick FRICTION decay summed in
+// closed form. The tick/substep phase is carried along, so rails and contacts
+// land at the end of the same substep as in BilliardPhysics and are resolved
+// with its rules (collideWalls, the contact's separation + impulse). Only
+// inside an attraction zone, where the pull bends the path, is the ball
+// stepped substep by substep with BilliardPhysics::attract.
+//
+// After the first contact both balls are traced until they stop, drop, or
+// touch another ball - chain collisions, including the cue ball meeting the
+// object ball again, are not followed.
+//
+// Math is float even with -DSIM_FIXED_POINT (squared distances across the
+// table overflow Q16.16). No allocation, no Serial, no drawing - the caller's
+// Ball array is only read.
+class BilliardShotPredictor {
+public:
+    static const int MAX_PATH_POINTS = 10;
+    static const int MAX_EVENTS = 24;          // Segments per ball before giving up
+    static const int MAX_ZONE_TICKS = 250;     // Ticks spent circling one pocket mouth
+    static const int MAX_SEARCH_STEPS = 720;
+
+    enum Outcome {
+        OUTCOME_STOPPED = 0,  // Came to rest on the table
+        OUTCOME_POCKETED,
+        OUTCOME_HIT_BALL      // Touched another ball - not followed further
+    };
+
+    struct Path {
+        float x[MAX_PATH_POINTS];  // Start, each rail bounce, end (the end point is always kept)
+        float y[MAX_PATH_POINTS];
+        int count;
+        Outcome outcome;
+        int pocket;                // OUTCOME_POCKETED: pocket index, else -1
+        int ball;                  // OUTCOME_HIT_BALL: ball index, else -1
+    };
+
+    struct Prediction {
+        float angle;
+        float power;
+        int objectBall;            // First ball the cue ball touches, -1 if none
+        float contactX, contactY;  // Cue ball center at that contact
+        float objectAngle;         // Direction the object ball leaves in (radians)
+        Path cue;                  // Whole cue ball path, through the contact point
+        Path object;               // Object ball path from its rest position
+
+        bool isScratch() const { return cue.outcome == OUTCOME_POCKETED; }
+        bool isPot() const { return objectBall >= 0 && object.outcome == OUTCOME_POCKETED && !isScratch(); }
+    };
+
+    // Predict the shot the game would play for cueAngle/cuePower
+    static void predict(const Ball* balls, int cueIndex, float angle, float power, Prediction& out);
+
+    // Try angleSteps evenly spaced angles (capped at MAX_SEARCH_STEPS). Picks the
+    // middle of the widest window of potting angles; if nothing pots, the shot
+    // leaving the object ball closest to a pocket. Returns true if best pots.
+    static bool findBestShot(const Ball* balls, int cueIndex, float power, int angleSteps, Prediction& best);
+};
+
+#endif
@@ -0,0 +1,111 @@
+#include "caro_bitboard.h"
+
+CaroBitboard::CaroBitboard() {
+    clear();
+}
+
+void CaroBitboard::clear() {
+    memset(rows, 0, sizeof(rows));
+    memset(cols, 0, sizeof(cols));
+    memset(diagonals, 0, sizeof(diagonals));
+    memset(antiDiagonals, 0, sizeof(antiDiagonals));
+    memset(candidates, 0, sizeof(candidates));
+    moveCount = 0;
+}
+
+bool CaroBitboard::hasRun(uint32_t line, int bit) {
+    // Bit i survives only if bits i..i+4 are all set
+    uint32_t run = line;
+    for (int shift = 1; shift < WIN_COUNT; shift++) {
+        run &= line >> shift;
+    }
+    // Only runs starting at bit-4..bit pass through the new stone
+    int first = bit - (WIN_COUNT - 1);
+    uint32_t starts = (2UL << bit) - 1;
+    if (first > 0) starts &= ~((1UL << first) - 1);
+    return (run & starts) != 0;
+}
+
+CellState CaroBitboard::get(int row, int col) const {
+    if (row < 0 || row >= BOARD_ROWS || col < 0 || col >= BOARD_COLS) {
+        return CELL_EMPTY;  // Out of bounds
+    }
+    uint32_t bit = 1UL << col;
+    if (rows[0][row] & bit) return CELL_X;
+    if (rows[1][row] & bit) return CELL_O;
+    return CELL_EMPTY;
+}
+
+bool CaroBitboard::place(int row, int col, bool isX) {
+    if (row < 0 || row >= BOARD_ROWS || col < 0 || col >= BOARD_COLS) {
+        return false;
+    }
+    uint32_t bit = 1UL << col;
+    if ((rows[0][row] | rows[1][row]) & bit) {
+        return false;
+    }
+
+    int p = isX ? 0 : 1;
+    rows[p][row] |= bit;
+    cols[p][col] |= (uint16_t)(1U << row);
+    diagonals[p][row - col + BOARD_COLS - 1] |= (uint16_t)(1U << row);
+    antiDiagonals[p][row + col] |= (uint16_t)(1U << row);
+    moveCount++;
+
+    // Neighbours become candidates, the cell itself stops being one
+    uint32_t around = (bit | (bit << 1) | (bit >> 1)) & ROW_MASK;
+    for (int r = row - 1; r <= row + 1; r++) {
+        if (r < 0 || r >= BOARD_ROWS) continue;
+        candidates[r] = (candidates[r] | around) & ~(rows[0][r] | rows[1][r]);
+    }
+    return true;
+}
+
+bool CaroBitboard::isWinningMove(int row, int col) const {
+    CellState cell = get(row, col);
+    if (cell == CELL_EMPTY) {
+        return false;
+    }
+    int p = (cell == CELL_X) ? 0 : 1;
+    return hasRun(rows[p][row], col) ||
+           hasRun(cols[p][col], row) ||
+           hasRun(diagonals[p][row - col + BOARD_COLS - 1], row) ||
+           hasRun(antiDiagonals[p][row + col], row);
+}
+
+bool CaroBitboard::findNearestEmpty(int centerRow, int centerCol, int maxRadius, int& row, int& col) const {
+    if (isEmpty(centerRow, centerCol) &&
+        centerRow >= 0 && centerRow < BOARD_ROWS && centerCol >= 0 && centerCol < BOARD_COLS) {
+        row = centerRow;
+        col = centerCol;
+        return true;
+    }
+    if (moveCount == 0) {
+        return false;
+    }
+
+    // With the center taken, the nearest empty cell always borders a stone
+    // (every closer ring is full), so only candidate masks need checking
+    for (int radius = 1; radius <= maxRadius; radius++) {
+        int left = centerCol - radius;
+        int right = centerCol + radius;
+        uint32_t edges = 0;
+        if (left >= 0) edges |= 1UL << left;
+        if (right < BOARD_COLS) edges |= 1UL << right;
+        uint32_t span = ROW_MASK;
+        if (left > 0) span &= ~((1UL << left) - 1);
+        if (right < BOARD_COLS - 1) span &= (1UL << (right + 1)) - 1;
+
+        for (int r = centerRow - radius; r <= centerRow + radius; r++) {
+            if (r < 0 || r >= BOARD_ROWS) continue;
+            bool ringRow = (r == centerRow - radius || r == centerRow + radius);
+            uint32_t found = candidates[r] & (ringRow ? span : edges);
+            if (found != 0) {
+                row = r;
+                col = __builtin_ctz(found);  // Leftmost column first
+                return true;
+            }
+        }
+    }
+    return false;
+}
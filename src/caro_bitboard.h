@@ -0,0 +1,68 @@
+#ifndef CARO_BITBOARD_H
+#define CARO_BITBOARD_H
+
+#include <Arduino.h>
+
+// Board size
+#define BOARD_ROWS 15  // 15 rows (height)
+#define BOARD_COLS 20  // 20 columns (width) - fit full screen width
+#define WIN_COUNT 5    // Number of consecutive pieces to win
+
+enum CellState {
+    CELL_EMPTY,
+    CELL_X,
+    CELL_O
+};
+
+// Caro board as bit masks, one set per player.
+//
+// Every stone is stored in four line masks - its row, column, diagonal and
+// anti-diagonal - so the full line through a move is a single word and
+// five-in-a-row is m & m>>1 & m>>2 & m>>3 & m>>4: a constant number of
+// operations per move instead of walking four directions cell by cell.
+//
+// Candidate cells (empty and next to a stone) are kept up to date as moves
+// are placed, so move search looks at a few row masks instead of scanning
+// the whole board.
+//
+// ~540 bytes including candidates, versus 1200 for CellState[15][20].
+class CaroBitboard {
+public:
+    static const int DIAGONALS = BOARD_ROWS + BOARD_COLS - 1;
+
+    CaroBitboard();
+
+    void clear();
+    // Returns false if out of bounds or occupied
+    bool place(int row, int col, bool isX);
+    CellState get(int row, int col) const;
+    bool isEmpty(int row, int col) const { return get(row, col) == CELL_EMPTY; }
+    int getMoveCount() const { return moveCount; }
+    bool isFull() const { return moveCount >= BOARD_ROWS * BOARD_COLS; }
+
+    // Does the stone at (row, col) complete WIN_COUNT in a row?
+    bool isWinningMove(int row, int col) const;
+
+    // Empty cell closest to (centerRow, centerCol) by rings of growing
+    // Chebyshev radius, scanning each ring top-to-bottom, left-to-right.
+    // Returns false if none within maxRadius.
+    bool findNearestEmpty(int centerRow, int centerCol, int maxRadius, int& row, int& col) const;
+
+    // Empty cells adjacent (8 directions) to any stone, one mask per row
+    uint32_t getCandidates(int row) const { return candidates[row]; }
+
+private:
+    uint32_t rows[2][BOARD_ROWS];        // bit = col
+    uint16_t cols[2][BOARD_COLS];        // bit = row
+    uint16_t diagonals[2][DIAGONALS];    // index row - col + COLS - 1, bit = row
+    uint16_t antiDiagonals[2][DIAGONALS];// index row + col, bit = row
+    uint32_t candidates[BOARD_ROWS];
+    int moveCount;
+
+    static const uint32_t ROW_MASK = (1UL << BOARD_COLS) - 1;
+
+    // WIN_COUNT set bits in a row that include `bit`
+    static bool hasRun(uint32_t line, int bit);
+};
+
+#endif
@@ -1,5 +1,7 @@
 #include <Arduino.h>
 #include "caro_game.h"
+#include "tft_compositor.h"
+#include "profiler.h"
 #include <Adafruit_GFX.h>
 #include <Adafruit_ST7789.h>
 
@@ -13,12 +15,7 @@ CaroGame::CaroGame(Adafruit_ST7789* tft) {
     this->oldCursorCol = this->cursorCol;
     this->cursorColor = COLOR_HIGHLIGHT;  // Default yellow
     
-    // Initialize board to empty
-    for (int i = 0; i < BOARD_ROWS; i++) {
-        for (int j = 0; j < BOARD_COLS; j++) {
-            board[i][j] = CELL_EMPTY;
-        }
-    }
+    // Board starts empty (CaroBitboard constructor)
 }
 
 void CaroGame::init() {
@@ -28,11 +25,7 @@ void CaroGame::init() {
 
 void CaroGame::resetGame() {
     // Clear board
-    for (int i = 0; i < BOARD_ROWS; i++) {
-        for (int j = 0; j < BOARD_COLS; j++) {
-            board[i][j] = CELL_EMPTY;
-        }
-    }
+    board.clear();
     
     isPlayerXTurn = true;
     gameState = GAME_PLAYING;
@@ -72,9 +65,10 @@ void CaroGame::drawCell(int row, int col, bool highlight) {
     }
     
     // Draw X or O
-    if (board[row][col] == CELL_X) {
+    CellState cell = board.get(row, col);
+    if (cell == CELL_X) {
         drawX(row, col);
-    } else if (board[row][col] == CELL_O) {
+    } else if (cell == CELL_O) {
         drawO(row, col);
     }
 }
@@ -162,6 +156,8 @@ void CaroGame::drawStatus() {
 }
 
 void CaroGame::draw() {
+    Profiler::Scope profile("CaroGame.draw");
+    TftCompositor::Frame frame("CaroGame");
     drawBoard();
     
     // Draw all cells
@@ -221,16 +217,12 @@ void CaroGame::handleSelect() {
     }
     
     // Check if cell is empty
-    if (board[cursorRow][cursorCol] != CELL_EMPTY) {
+    if (!board.isEmpty(cursorRow, cursorCol)) {
         return;  // Cell already occupied
     }
     
     // Place X or O
-    if (isPlayerXTurn) {
-        board[cursorRow][cursorCol] = CELL_X;
-    } else {
-        board[cursorRow][cursorCol] = CELL_O;
-    }
+    board.place(cursorRow, cursorCol, isPlayerXTurn);
     
     // Redraw cell
     drawCell(cursorRow, cursorCol, false);
@@ -262,111 +254,23 @@ void CaroGame::handleSelect() {
 }
 
 bool CaroGame::checkWin(int row, int col) {
-    // Check all directions: horizontal, vertical, diagonal, anti-diagonal
-    return checkHorizontal(row, col) || 
-           checkVertical(row, col) || 
-           checkDiagonal(row, col) || 
-           checkAntiDiagonal(row, col);
-}
-
-bool CaroGame::checkHorizontal(int row, int col) {
-    CellState player = board[row][col];
-    int count = 1;  // Count current cell
-    
-    // Check left
-    for (int c = col - 1; c >= 0 && board[row][c] == player; c--) {
-        count++;
-    }
-    
-    // Check right
-    for (int c = col + 1; c < BOARD_COLS && board[row][c] == player; c++) {
-        count++;
-    }
-    
-    return count >= WIN_COUNT;
-}
-
-bool CaroGame::checkVertical(int row, int col) {
-    CellState player = board[row][col];
-    int count = 1;  // Count current cell
-    
-    // Check up
-    for (int r = row - 1; r >= 0 && board[r][col] == player; r--) {
-        count++;
-    }
-    
-    // Check down
-    for (int r = row + 1; r < BOARD_ROWS && board[r][col] == player; r++) {
-        count++;
-    }
-    
-    return count >= WIN_COUNT;
-}
-
-bool CaroGame::checkDiagonal(int row, int col) {
-    CellState player = board[row][col];
-    int count = 1;  // Count current cell
-    
-    // Check top-left to bottom-right diagonal
-    // Check top-left
-    for (int r = row - 1, c = col - 1; r >= 0 && c >= 0 && board[r][c] == player; r--, c--) {
-        count++;
-    }
-    
-    // Check bottom-right
-    for (int r = row + 1, c = col + 1; r < BOARD_ROWS && c < BOARD_COLS && board[r][c] == player; r++, c++) {
-        count++;
-    }
-    
-    return count >= WIN_COUNT;
-}
-
-bool CaroGame::checkAntiDiagonal(int row, int col) {
-    CellState player = board[row][col];
-    int count = 1;  // Count current cell
-    
-    // Check top-right to bottom-left diagonal
-    // Check top-right
-    for (int r = row - 1, c = col + 1; r >= 0 && c < BOARD_COLS && board[r][c] == player; r--, c++) {
-        count++;
-    }
-    
-    // Check bottom-left
-    for (int r = row + 1, c = col - 1; r < BOARD_ROWS && c >= 0 && board[r][c] == player; r++, c--) {
-        count++;
-    }
-    
-    return count >= WIN_COUNT;
+    // All four directions in one shift-and-AND pass over the line masks
+    return board.isWinningMove(row, col);
 }
 
 bool CaroGame::isBoardFull() {
-    for (int i = 0; i < BOARD_ROWS; i++) {
-        for (int j = 0; j < BOARD_COLS; j++) {
-            if (board[i][j] == CELL_EMPTY) {
-                return false;
-            }
-        }
-    }
-    return true;
+    return board.isFull();
 }
 
 CellState CaroGame::getCell(int row, int col) const {
-    if (row < 0 || row >= BOARD_ROWS || col < 0 || col >= BOARD_COLS) {
-        return CELL_EMPTY;  // Out of bounds
-    }
-    return board[row][col];
+    return board.get(row, col);  // CELL_EMPTY when out of bounds
 }
 
 void CaroGame::placeMove(int row, int col, bool isX) {
-    if (row < 0 || row >= BOARD_ROWS || col < 0 || col >= BOARD_COLS) {
-        return;
-    }
-    if (board[row][col] != CELL_EMPTY) {
-        return;
+    if (!board.place(row, col, isX)) {
+        return;  // Out of bounds or occupied
     }
     
-    board[row][col] = isX ? CELL_X : CELL_O;
-    
     // Check for win
     if (checkWin(row, col)) {
         gameState = isX ? GAME_X_WIN : GAME_O_WIN;
@@ -378,9 +282,12 @@ void CaroGame::placeMove(int row, int col, bool isX) {
 }
 
 void CaroGame::setBoardState(CellState newBoard[BOARD_ROWS][BOARD_COLS]) {
+    board.clear();
     for (int i = 0; i < BOARD_ROWS; i++) {
         for (int j = 0; j < BOARD_COLS; j++) {
-            board[i][j] = newBoard[i][j];
+            if (newBoard[i][j] != CELL_EMPTY) {
+                board.place(i, j, newBoard[i][j] == CELL_X);
+            }
         }
     }
 }
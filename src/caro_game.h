@@ -4,14 +4,12 @@
 #include <Arduino.h>
 #include <Adafruit_GFX.h>
 #include <Adafruit_ST7789.h>
+#include "caro_bitboard.h"
 
-// Board size
-#define BOARD_ROWS 15  // 15 rows (height)
-#define BOARD_COLS 20  // 20 columns (width) - fit full screen width
+// Board layout (BOARD_ROWS/BOARD_COLS/WIN_COUNT live in caro_bitboard.h)
 #define CELL_SIZE 16   // Size of each cell in pixels (15*16 = 240px height, 20*16 = 320px width)
 #define BOARD_X 0      // X position of board (start from left, full width)
 #define BOARD_Y 0      // Y position of board (start from top)
-#define WIN_COUNT 5    // Number of consecutive pieces to win
 
 // Colors
 #define COLOR_BOARD_BG 0x0000      // Black
@@ -21,12 +19,6 @@
 #define COLOR_HIGHLIGHT 0xFFE0     // Yellow
 #define COLOR_TEXT 0xFFFF          // White
 
-enum CellState {
-    CELL_EMPTY,
-    CELL_X,
-    CELL_O
-};
-
 enum GameState {
     GAME_PLAYING,
     GAME_X_WIN,
@@ -39,7 +31,7 @@ private:
     Adafruit_ST7789* tft;
     
     // Game state
-    CellState board[BOARD_ROWS][BOARD_COLS];
+    CaroBitboard board;
     bool isPlayerXTurn;  // true = X's turn, false = O's turn
     GameState gameState;
     int cursorRow, cursorCol;  // Current cursor position
@@ -57,10 +49,6 @@ private:
     
     // Game logic
     bool checkWin(int row, int col);
-    bool checkHorizontal(int row, int col);
-    bool checkVertical(int row, int col);
-    bool checkDiagonal(int row, int col);
-    bool checkAntiDiagonal(int row, int col);
     bool isBoardFull();
     void resetGame();
     
@@ -87,6 +75,7 @@ public:
     // Methods for external control
     void placeMove(int row, int col, bool isX);
     CellState getCell(int row, int col) const;  // Get cell state at position
+    const CaroBitboard& getBoard() const { return board; }
     void setBoardState(CellState newBoard[BOARD_ROWS][BOARD_COLS]);
     void setGameState(GameState state);
     void setTurn(bool isXTurn);
@@ -1,4 +1,7 @@
 #include "caro_game_screen.h"
+#include "tft_compositor.h"
+#include "profiler.h"
+#include "socket_manager.h"
 
 CaroGameScreen::CaroGameScreen(Adafruit_ST7789* tft, const SocialTheme& theme) {
     this->tft = tft;
@@ -18,12 +21,26 @@ CaroGameScreen::CaroGameScreen(Adafruit_ST7789* tft, const SocialTheme& theme) {
     this->gameStatus = "playing";
     this->winnerId = -1;
     this->needsRedraw = true;  // Initial draw needed
+    this->movePending = false;
+    this->syncPending = false;
+    this->socketManager = nullptr;
+    this->deltaQueue = xQueueCreate(DELTA_QUEUE_SIZE, sizeof(GameDelta));
+    this->deltaOverflow = false;
+    this->lastSeq = 0;
+    this->socketWasConnected = false;
+    this->lastResyncTime = 0;
+    this->lastHttpSyncTime = 0;
+    this->moveSentTime = 0;
     this->onExit = nullptr;
     this->autoPlay = true;  // Enable auto-play by default
     this->lastAutoPlayTime = 0;
 }
 
 CaroGameScreen::~CaroGameScreen() {
+    ApiRequestQueue::cancel(this);
+    if (deltaQueue != nullptr) {
+        vQueueDelete(deltaQueue);
+    }
     if (caroGame != nullptr) {
         delete caroGame;
     }
@@ -42,16 +59,36 @@ void CaroGameScreen::setup(int sessionId, const String& hostName, const String&
     this->winnerId = -1;
     this->needsRedraw = true;  // Force initial draw
     
+    // Answers still queued for the previous session must not touch this one
+    ApiRequestQueue::cancel(this);
+    this->movePending = false;
+    this->syncPending = false;
+    this->lastSeq = 0;  // Fresh board: the server's first move is seq 1
+    this->lastResyncTime = 0;
+    this->lastHttpSyncTime = millis();
+    this->socketWasConnected = socketManager != nullptr && socketManager->connected();
+    this->deltaOverflow = false;
+    if (deltaQueue != nullptr) {
+        xQueueReset(deltaQueue);  // Drop pushes left over from the previous session
+    }
+    
     // Initialize game
     caroGame->init();
     
-    // Sync initial game state from server
+    // Record the session so it can be replayed offline (CaroReplay)
+    recorder.begin(sessionId, myUserId);
+    recorder.recordBoard(*caroGame);
+    
+    // Sync initial game state from server (turn/status; moves already played
+    // are replayed over the socket when moveCount > lastSeq)
     syncGameState();
     
     draw();
 }
 
 void CaroGameScreen::draw() {
+    Profiler::Scope profile("CaroGameScreen.draw");
+    TftCompositor::Frame frame("CaroGameScreen");
     if (!active) return;
     
     // Chỉ vẽ khi có thay đổi thực sự để tránh nháy màn hình
@@ -175,6 +212,7 @@ void CaroGameScreen::handleSelect() {
     if (!active) return;
     if (gameStatus == "completed") {
         // Game finished, any key to exit
+        recorder.end();
         if (onExit != nullptr) {
             onExit();
         }
@@ -193,6 +231,7 @@ void CaroGameScreen::handleExit() {
     if (!active) return;
     
     // Exit game
+    recorder.end();
     if (onExit != nullptr) {
         onExit();
     }
@@ -224,6 +263,7 @@ void CaroGameScreen::handleKeyPress(const String& key) {
     
     if (gameStatus == "completed") {
         // Game finished, any key to exit
+        recorder.end();
         if (onExit != nullptr) {
             onExit();
         }
@@ -253,13 +293,34 @@ void CaroGameScreen::handleKeyPress(const String& key) {
 }
 
 void CaroGameScreen::update() {
+    Profiler::Scope profile("CaroGameScreen.update");
     if (!active) return;
     
-    // Periodically sync game state from server (every 3 seconds) to ensure we have correct turn
-    static unsigned long lastSyncTime = 0;
+    // Apply moves/acks pushed over the WebSocket
+    processDeltas();
+    
+    // No answer to our move (socket dropped mid-flight): give up and resync
+    if (movePending && millis() - moveSentTime >= MOVE_ACK_TIMEOUT) {
+        Serial.println("Caro Game Screen: Move not acknowledged - resyncing");
+        movePending = false;
+        requestResync();
+        syncGameState();
+    }
+    
+    // The server pushes every move, so no polling while the socket is up.
+    // After a reconnect ask for anything missed; while down, fall back to HTTP polling.
+    bool socketUp = socketManager != nullptr && socketManager->connected();
+    if (socketUp && !socketWasConnected) {
+        Serial.println("Caro Game Screen: Socket (re)connected - resyncing");
+        lastResyncTime = 0;
+        requestResync();
+        syncGameState();
+    }
+    socketWasConnected = socketUp;
+    
     unsigned long currentSyncTime = millis();
-    if (currentSyncTime - lastSyncTime >= 3000) {
-        lastSyncTime = currentSyncTime;
+    if (!socketUp && currentSyncTime - lastHttpSyncTime >= HTTP_SYNC_INTERVAL) {
+        lastHttpSyncTime = currentSyncTime;
         syncGameState();
     }
     
@@ -289,38 +350,13 @@ void CaroGameScreen::update() {
         
         // Wait a bit before auto-playing (to avoid too fast moves)
         if (currentTime - lastAutoPlayTime >= AUTO_PLAY_DELAY) {
-            // Tìm cell trống từ center (đơn giản, không tìm gần cursor)
+            // Tìm cell trống gần center nhất (theo từng vòng bán kính)
+            // Bitboard giữ sẵn các ô ứng viên cạnh quân đã đánh, không cần quét cả bàn
             int bestRow = -1;
             int bestCol = -1;
             int currentRow = caroGame->getCursorRow();
             int currentCol = caroGame->getCursorCol();
-            
-            // Tìm từ center ra ngoài
-            int centerRow = 7;  // Board center
-            int centerCol = 10;
-            bool found = false;
-            
-            for (int radius = 0; radius < 8 && !found; radius++) {
-                for (int dr = -radius; dr <= radius && !found; dr++) {
-                    for (int dc = -radius; dc <= radius && !found; dc++) {
-                        // Only check cells on the current radius
-                        if (abs(dr) != radius && abs(dc) != radius) continue;
-                        
-                        int row = centerRow + dr;
-                        int col = centerCol + dc;
-                        
-                        // Check bounds
-                        if (row < 0 || row >= 15 || col < 0 || col >= 20) continue;
-                        
-                        // Check if cell is empty
-                        if (caroGame->getCell(row, col) == CELL_EMPTY) {
-                            bestRow = row;
-                            bestCol = col;
-                            found = true;
-                        }
-                    }
-                }
-            }
+            caroGame->getBoard().findNearestEmpty(BOARD_ROWS / 2, BOARD_COLS / 2, 7, bestRow, bestCol);
             
             // Nếu tìm thấy cell, điều hướng cursor rồi đánh
             if (bestRow >= 0 && bestCol >= 0) {
@@ -366,8 +402,97 @@ void CaroGameScreen::update() {
     }
 }
 
-void CaroGameScreen::onMoveReceived(int row, int col, int userId, const String& gameStatus, int winnerId, int currentTurn) {
-    if (!active) return;
+void CaroGameScreen::onMoveReceived(int row, int col, int userId, const String& gameStatus, int winnerId, int currentTurn, int seq) {
+    if (!active || deltaQueue == nullptr) return;
+    
+    GameDelta delta;
+    delta.kind = GameDelta::MOVE;
+    delta.success = true;
+    delta.status = CaroRecorder::encodeStatus(gameStatus);
+    delta.row = (int8_t)row;
+    delta.col = (int8_t)col;
+    delta.userId = userId;
+    delta.winnerId = winnerId;
+    delta.currentTurn = currentTurn;
+    delta.seq = seq;
+    if (xQueueSend(deltaQueue, &delta, 0) != pdTRUE) {
+        deltaOverflow = true;  // update() will resync from lastSeq
+    }
+}
+
+void CaroGameScreen::onMoveAck(int seq, bool success, const String& message, const String& gameStatus, int winnerId, int currentTurn) {
+    if (!active || deltaQueue == nullptr) return;
+    
+    if (!success) {
+        Serial.print("Caro Game Screen: Move rejected: ");
+        Serial.println(message);
+    }
+    GameDelta delta;
+    delta.kind = GameDelta::ACK;
+    delta.success = success;
+    delta.status = CaroRecorder::encodeStatus(gameStatus);
+    delta.row = -1;
+    delta.col = -1;
+    delta.userId = myUserId;
+    delta.winnerId = winnerId;
+    delta.currentTurn = currentTurn;
+    delta.seq = seq;
+    if (xQueueSend(deltaQueue, &delta, 0) != pdTRUE) {
+        deltaOverflow = true;
+    }
+}
+
+void CaroGameScreen::processDeltas() {
+    GameDelta delta;
+    while (xQueueReceive(deltaQueue, &delta, 0) == pdTRUE) {
+        if (delta.kind == GameDelta::ACK) {
+            applyMoveAck(delta);
+        } else {
+            applyMoveDelta(delta);
+        }
+    }
+    if (deltaOverflow) {
+        deltaOverflow = false;
+        Serial.println("Caro Game Screen: Delta queue overflow - resyncing");
+        requestResync();
+    }
+}
+
+void CaroGameScreen::requestResync() {
+    if (socketManager == nullptr || !socketManager->connected()) {
+        return;  // HTTP fallback keeps turn/status fresh until the socket is back
+    }
+    unsigned long now = millis();
+    if (lastResyncTime != 0 && now - lastResyncTime < RESYNC_INTERVAL) {
+        return;  // Replay of the previous request is probably still arriving
+    }
+    lastResyncTime = now;
+    socketManager->requestGameResync(sessionId, lastSeq);
+}
+
+void CaroGameScreen::applyMoveDelta(const GameDelta& delta) {
+    // seq < 0: server without move numbers, apply as-is
+    if (delta.seq > 0) {
+        if (delta.seq <= lastSeq) {
+            return;  // Already applied (echo of our own acked move, or replay overlap)
+        }
+        if (delta.seq > lastSeq + 1) {
+            Serial.print("Caro Game Screen: Gap in moves - have seq ");
+            Serial.print(lastSeq);
+            Serial.print(", got ");
+            Serial.println(delta.seq);
+            requestResync();
+            return;  // The replay re-sends this move in order
+        }
+        lastSeq = delta.seq;
+    }
+    
+    int row = delta.row;
+    int col = delta.col;
+    int userId = delta.userId;
+    int winnerId = delta.winnerId;
+    int currentTurn = delta.currentTurn;
+    String gameStatus = CaroRecorder::decodeStatus(delta.status);
     
     Serial.print("Caro Game Screen: onMoveReceived - row=");
     Serial.print(row);
@@ -375,18 +500,22 @@ void CaroGameScreen::onMoveReceived(int row, int col, int userId, const String&
     Serial.print(col);
     Serial.print(", userId=");
     Serial.print(userId);
+    Serial.print(", seq=");
+    Serial.print(delta.seq);
     Serial.print(", gameStatus=");
     Serial.print(gameStatus);
     Serial.print(", currentTurn=");
     Serial.println(currentTurn);
     
+    recorder.recordRemoteMove(row, col, userId, gameStatus, winnerId, currentTurn);
+    
     this->gameStatus = gameStatus;
     this->winnerId = winnerId;
     
-    // Place move on board
+    // Place move on board (no-op for our own optimistic stone)
     bool isX = (userId == hostUserId);  // Host is X, Guest is O
     caroGame->placeMove(row, col, isX);
-    
+
     // Update turn from server (use server's current_turn instead of calculating locally)
     int oldTurn = this->currentTurn;
     if (currentTurn > 0) {
@@ -423,7 +552,7 @@ void CaroGameScreen::onMoveReceived(int row, int col, int userId, const String&
 }
 
 void CaroGameScreen::submitMove(int row, int col) {
-    if (!isMyTurn()) return;
+    if (!isMyTurn() || movePending) return;
     
     // Ensure cursor is at target position before submitting
     int currentRow = caroGame->getCursorRow();
@@ -448,18 +577,59 @@ void CaroGameScreen::submitMove(int row, int col) {
     // Place move locally first (optimistic update)
     bool isX = isHost;  // Host is X, Guest is O
     caroGame->placeMove(row, col, isX);
+    recorder.recordLocalMove(row, col, isX);
+    
+    // Submit over the WebSocket (answer: game_move_ack -> onMoveAck), or HTTP
+    // through the request queue (answer: onMoveResult) when the socket is down
+    movePending = true;
+    moveSentTime = millis();
+    if (socketManager == nullptr || !socketManager->sendGameMove(sessionId, row, col, lastSeq + 1)) {
+        ApiRequestQueue::submitGameMove(sessionId, myUserId, row, col, serverHost, serverPort, onMoveResult, this);
+    }
+}
+
+void CaroGameScreen::onMoveResult(const ApiClient::GameMoveResult& result, void* context) {
+    ((CaroGameScreen*)context)->applyMoveResult(result);
+}
+
+void CaroGameScreen::applyMoveResult(const ApiClient::GameMoveResult& result) {
+    if (!movePending) {
+        return;  // Timed out already, a resync has taken over
+    }
+    // HTTP answer has no current_turn: after our move it is the opponent's
+    int opponent = (myUserId == hostUserId) ? guestUserId : hostUserId;
+    finishMove(result.success, result.message, result.gameStatus, result.winnerId, opponent);
+}
+
+void CaroGameScreen::applyMoveAck(const GameDelta& delta) {
+    if (!movePending) {
+        return;  // Late ack after a timeout/resync
+    }
+    if (delta.success && delta.seq > lastSeq) {
+        lastSeq = delta.seq;  // Ack overtook the move push
+    }
+    int opponent = (myUserId == hostUserId) ? guestUserId : hostUserId;
+    int newTurn = (delta.currentTurn > 0) ? delta.currentTurn : opponent;
+    finishMove(delta.success, delta.success ? String("") : String("Rejected by server"),
+               CaroRecorder::decodeStatus(delta.status), delta.winnerId, newTurn);
+}
+
+void CaroGameScreen::finishMove(bool success, const String& message, const String& gameStatus, int winnerId, int newTurn) {
+    movePending = false;
+    recorder.recordSubmitResult(success, gameStatus, winnerId);
     
-    // Submit to server
-    ApiClient::GameMoveResult result = ApiClient::submitGameMove(sessionId, myUserId, row, col, serverHost, serverPort);
+    Serial.print("Caro Game Screen: Move answered in ");
+    Serial.print(millis() - moveSentTime);
+    Serial.println(" ms");
     
-    if (result.success) {
-        gameStatus = result.gameStatus;
-        winnerId = result.winnerId;
+    if (success) {
+        this->gameStatus = gameStatus;
+        this->winnerId = winnerId;
         
-        if (result.gameStatus == "completed") {
-            if (result.winnerId == myUserId) {
+        if (gameStatus == "completed") {
+            if (winnerId == myUserId) {
                 caroGame->setGameState(isHost ? GAME_X_WIN : GAME_O_WIN);
-            } else if (result.winnerId > 0) {
+            } else if (winnerId > 0) {
                 caroGame->setGameState(isHost ? GAME_O_WIN : GAME_X_WIN);
             } else {
                 caroGame->setGameState(GAME_DRAW);
@@ -467,8 +637,7 @@ void CaroGameScreen::submitMove(int row, int col) {
         }
         
         // Update turn
-        int oldTurn = currentTurn;
-        currentTurn = (currentTurn == hostUserId) ? guestUserId : hostUserId;
+        currentTurn = newTurn;
         
         // Reset auto-play timer when turn changes (for next time it's our turn)
         // But don't reset if it's still our turn (shouldn't happen, but just in case)
@@ -486,7 +655,7 @@ void CaroGameScreen::submitMove(int row, int col) {
         draw();
     } else {
         Serial.print("Caro Game Screen: Failed to submit move: ");
-        Serial.println(result.message);
+        Serial.println(message);
         // Revert move by syncing state from server
         syncGameState();
         needsRedraw = true;  // State synced, need redraw
@@ -495,8 +664,18 @@ void CaroGameScreen::submitMove(int row, int col) {
 }
 
 void CaroGameScreen::syncGameState() {
+    if (syncPending) return;  // Previous sync still in flight
     Serial.println("Caro Game Screen: Syncing game state from server...");
-    ApiClient::GameStateResult result = ApiClient::getGameState(sessionId, serverHost, serverPort);
+    syncPending = true;
+    ApiRequestQueue::getGameState(sessionId, serverHost, serverPort, onGameStateResult, this);
+}
+
+void CaroGameScreen::onGameStateResult(const ApiClient::GameStateResult& result, void* context) {
+    ((CaroGameScreen*)context)->applyGameState(result);
+}
+
+void CaroGameScreen::applyGameState(const ApiClient::GameStateResult& result) {
+    syncPending = false;
     
     if (result.success) {
         int oldTurn = currentTurn;
@@ -504,6 +683,12 @@ void CaroGameScreen::syncGameState() {
         gameStatus = result.status;
         hostUserId = result.hostId;
         guestUserId = result.guestId;
+        recorder.recordSync(currentTurn, hostUserId, guestUserId, gameStatus);
+        
+        // Server has moves we never saw (joined mid-game, missed pushes)
+        if (result.moveCount > lastSeq) {
+            requestResync();
+        }
         
         // Reset auto-play timer when turn changes to my turn
         if (currentTurn == myUserId && oldTurn != myUserId) {
@@ -522,6 +707,12 @@ void CaroGameScreen::syncGameState() {
         // CaroGame doesn't have a method to set board state
         // We need to modify CaroGame or rebuild board from moves
         // For MVP, we'll just update turn info
+        
+        // Turn/status may have changed the cursor color
+        if (currentTurn != oldTurn) {
+            needsRedraw = true;
+            draw();
+        }
     }
 }
 
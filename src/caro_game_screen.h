@@ -4,10 +4,16 @@
 #include <Arduino.h>
 #include <Adafruit_GFX.h>
 #include <Adafruit_ST7789.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/queue.h>
 #include "caro_game.h"
+#include "caro_replay.h"
 #include "api_client.h"
+#include "api_request_queue.h"
 #include "social_theme.h"
 
+class SocketManager;
+
 class CaroGameScreen {
 public:
     CaroGameScreen(Adafruit_ST7789* tft, const SocialTheme& theme);
@@ -26,8 +32,13 @@ public:
     void handleSelect();
     void handleExit();
     
-    // Handle move received from server
-    void onMoveReceived(int row, int col, int userId, const String& gameStatus, int winnerId, int currentTurn);
+    // Handle move pushed by the server / ack of our own move.
+    // Called from SocketManager::dispatchEvents(): both only queue the delta, update() applies it.
+    void onMoveReceived(int row, int col, int userId, const String& gameStatus, int winnerId, int currentTurn, int seq);
+    void onMoveAck(int seq, bool success, const String& message, const String& gameStatus, int winnerId, int currentTurn);
+    
+    // Moves go over the WebSocket when it is connected, HTTP otherwise
+    void setSocketManager(SocketManager* socketManager) { this->socketManager = socketManager; }
     
     // Callbacks
     typedef void (*OnExitGameCallback)();
@@ -38,9 +49,29 @@ public:
     int getSessionId() const { return sessionId; }
 
 private:
+    // Server push (move or ack) waiting for the main loop.
+    // Status is stored as a CaroRecorder::Status byte so the struct can be copied through a queue.
+    struct GameDelta {
+        enum Kind : uint8_t { MOVE, ACK };
+        uint8_t kind;
+        bool success;       // ACK only
+        uint8_t status;
+        int8_t row;         // MOVE only
+        int8_t col;
+        int userId;         // MOVE only
+        int winnerId;
+        int currentTurn;
+        int seq;
+    };
+    static const int DELTA_QUEUE_SIZE = 8;
+    static const unsigned long RESYNC_INTERVAL = 1000;  // Min gap between resync requests
+    static const unsigned long HTTP_SYNC_INTERVAL = 3000;  // Polling fallback while the socket is down
+    static const unsigned long MOVE_ACK_TIMEOUT = 8000;  // Longer than the 7 s HTTP timeout
+
     Adafruit_ST7789* tft;
     SocialTheme theme;
     CaroGame* caroGame;
+    CaroRecorder recorder;  // Moves/syncs of the current session -> /caro.rec
     
     bool active;
     int sessionId;
@@ -57,6 +88,18 @@ private:
     String gameStatus;
     int winnerId;
     bool needsRedraw;  // Flag to prevent unnecessary redraws
+    bool movePending;  // Move submitted, waiting for the server's answer
+    bool syncPending;  // Game state request in flight
+    
+    // Push-based state: server numbers moves 1, 2, 3...; lastSeq = last one applied
+    SocketManager* socketManager;
+    QueueHandle_t deltaQueue;
+    volatile bool deltaOverflow;  // Queue was full, a delta got dropped -> resync
+    int lastSeq;
+    bool socketWasConnected;
+    unsigned long lastResyncTime;
+    unsigned long lastHttpSyncTime;
+    unsigned long moveSentTime;   // Move-to-ack latency
     
     // Auto-play mode
     bool autoPlay;
@@ -70,6 +113,16 @@ private:
     void drawTurnIndicator();
     void submitMove(int row, int col);
     void syncGameState();
+    void requestResync();
+    void processDeltas();
+    void applyMoveDelta(const GameDelta& delta);
+    void applyMoveAck(const GameDelta& delta);
+    void finishMove(bool success, const String& message, const String& gameStatus, int winnerId, int newTurn);
+    void applyMoveResult(const ApiClient::GameMoveResult& result);
+    void applyGameState(const ApiClient::GameStateResult& result);
+    // ApiRequestQueue callbacks (context = this), run on the main loop
+    static void onMoveResult(const ApiClient::GameMoveResult& result, void* context);
+    static void onGameStateResult(const ApiClient::GameStateResult& result, void* context);
     bool isMyTurn() const;
     String getCurrentPlayerName() const;
 };
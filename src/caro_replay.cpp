@@ -0,0 +1,391 @@
+#include "caro_replay.h"
+
+const char* CaroRecorder::FILE_NAME = "/caro.rec";
+
+static void putU32(uint8_t* out, uint32_t value) {
+    out[0] = (uint8_t)(value & 0xFF);
+    out[1] = (uint8_t)((value >> 8) & 0xFF);
+    out[2] = (uint8_t)((value >> 16) & 0xFF);
+    out[3] = (uint8_t)((value >> 24) & 0xFF);
+}
+
+static uint32_t getU32(const uint8_t* in) {
+    return (uint32_t)in[0] | ((uint32_t)in[1] << 8) |
+           ((uint32_t)in[2] << 16) | ((uint32_t)in[3] << 24);
+}
+
+// ---------------------------------------------------------------------------
+// CaroRecorder
+
+CaroRecorder::CaroRecorder() {
+    this->recording = false;
+    this->startMs = 0;
+    this->fileSize = 0;
+}
+
+CaroRecorder::~CaroRecorder() {
+    end();
+}
+
+uint8_t CaroRecorder::encodeStatus(const String& gameStatus) {
+    if (gameStatus == "playing") return STATUS_PLAYING;
+    if (gameStatus == "in_progress") return STATUS_IN_PROGRESS;
+    if (gameStatus == "completed") return STATUS_COMPLETED;
+    return STATUS_OTHER;
+}
+
+const char* CaroRecorder::decodeStatus(uint8_t status) {
+    switch (status) {
+        case STATUS_PLAYING: return "playing";
+        case STATUS_IN_PROGRESS: return "in_progress";
+        case STATUS_COMPLETED: return "completed";
+        default: return "";
+    }
+}
+
+int CaroRecorder::getPayloadSize(uint8_t type) {
+    switch (type) {
+        case RECORD_LOCAL_MOVE: return 3;
+        case RECORD_REMOTE_MOVE: return 15;
+        case RECORD_SUBMIT_RESULT: return 6;
+        case RECORD_SYNC: return 13;
+        case RECORD_BOARD: return BOARD_BYTES;
+        default: return -1;
+    }
+}
+
+bool CaroRecorder::begin(int sessionId, int myUserId) {
+    end();
+
+    file = SPIFFS.open(FILE_NAME, "w");
+    if (!file) {
+        Serial.println("Caro Replay: Failed to create recording");
+        return false;
+    }
+
+    uint8_t header[FILE_HEADER_SIZE] = {
+        (uint8_t)(MAGIC & 0xFF), (uint8_t)((MAGIC >> 8) & 0xFF),
+        (uint8_t)((MAGIC >> 16) & 0xFF), (uint8_t)((MAGIC >> 24) & 0xFF),
+        VERSION, 0, 0, 0
+    };
+    putU32(header + 8, (uint32_t)sessionId);
+    putU32(header + 12, (uint32_t)myUserId);
+    if (file.write(header, FILE_HEADER_SIZE) != FILE_HEADER_SIZE) {
+        Serial.println("Caro Replay: Failed to write recording header");
+        file.close();
+        return false;
+    }
+
+    recording = true;
+    startMs = millis();
+    fileSize = FILE_HEADER_SIZE;
+
+    Serial.print("Caro Replay: Recording session ");
+    Serial.print(sessionId);
+    Serial.print(" to ");
+    Serial.println(FILE_NAME);
+    return true;
+}
+
+void CaroRecorder::end() {
+    if (!recording) {
+        return;
+    }
+    file.close();
+    recording = false;
+
+    Serial.print("Caro Replay: Recording closed (");
+    Serial.print(fileSize);
+    Serial.println(" bytes)");
+}
+
+void CaroRecorder::writeRecord(uint8_t type, const uint8_t* payload, size_t length) {
+    if (!recording) {
+        return;
+    }
+    size_t recordSize = RECORD_HEADER_SIZE + length;
+    if (fileSize + recordSize > MAX_FILE_SIZE) {
+        Serial.println("Caro Replay: Recording full, stopping");
+        end();
+        return;
+    }
+
+    // One write per record so a torn tail is at most one record
+    uint8_t buffer[RECORD_HEADER_SIZE + MAX_PAYLOAD_SIZE];
+    buffer[0] = type;
+    putU32(buffer + 1, (uint32_t)(millis() - startMs));
+    memcpy(buffer + RECORD_HEADER_SIZE, payload, length);
+
+    if (file.write(buffer, recordSize) != recordSize) {
+        Serial.println("Caro Replay: Write failed, stopping recording");
+        end();
+        return;
+    }
+    file.flush();
+    fileSize += recordSize;
+}
+
+void CaroRecorder::recordLocalMove(int row, int col, bool isX) {
+    uint8_t payload[3] = { (uint8_t)row, (uint8_t)col, (uint8_t)(isX ? 1 : 0) };
+    writeRecord(RECORD_LOCAL_MOVE, payload, sizeof(payload));
+}
+
+void CaroRecorder::recordRemoteMove(int row, int col, int userId, const String& gameStatus, int winnerId, int currentTurn) {
+    uint8_t payload[15];
+    payload[0] = (uint8_t)row;
+    payload[1] = (uint8_t)col;
+    putU32(payload + 2, (uint32_t)userId);
+    putU32(payload + 6, (uint32_t)currentTurn);
+    putU32(payload + 10, (uint32_t)winnerId);
+    payload[14] = encodeStatus(gameStatus);
+    writeRecord(RECORD_REMOTE_MOVE, payload, sizeof(payload));
+}
+
+void CaroRecorder::recordSubmitResult(bool success, const String& gameStatus, int winnerId) {
+    uint8_t payload[6];
+    payload[0] = success ? 1 : 0;
+    putU32(payload + 1, (uint32_t)winnerId);
+    payload[5] = encodeStatus(gameStatus);
+    writeRecord(RECORD_SUBMIT_RESULT, payload, sizeof(payload));
+}
+
+void CaroRecorder::recordSync(int currentTurn, int hostId, int guestId, const String& gameStatus) {
+    uint8_t payload[13];
+    putU32(payload, (uint32_t)currentTurn);
+    putU32(payload + 4, (uint32_t)hostId);
+    putU32(payload + 8, (uint32_t)guestId);
+    payload[12] = encodeStatus(gameStatus);
+    writeRecord(RECORD_SYNC, payload, sizeof(payload));
+}
+
+void CaroRecorder::recordBoard(const CaroGame& game) {
+    uint8_t payload[BOARD_BYTES];
+    memset(payload, 0, sizeof(payload));
+    for (int row = 0; row < BOARD_ROWS; row++) {
+        for (int col = 0; col < BOARD_COLS; col++) {
+            int cell = row * BOARD_COLS + col;
+            payload[cell >> 2] |= (uint8_t)(game.getCell(row, col) & 0x03) << ((cell & 3) * 2);
+        }
+    }
+    writeRecord(RECORD_BOARD, payload, sizeof(payload));
+}
+
+// ---------------------------------------------------------------------------
+// CaroReplay
+
+CaroReplay::CaroReplay(CaroGame* game) {
+    this->game = game;
+    this->speed = 1.0f;
+    this->finished = true;
+    this->startMs = 0;
+    this->hasPending = false;
+    this->pendingType = 0;
+    this->pendingTimeMs = 0;
+    this->sessionId = -1;
+    this->myUserId = -1;
+    this->hostUserId = -1;
+    this->guestUserId = -1;
+    this->currentTurn = -1;
+    this->status = CaroRecorder::STATUS_OTHER;
+    this->winnerId = -1;
+    memset(&stats, 0, sizeof(stats));
+}
+
+CaroReplay::~CaroReplay() {
+    close();
+}
+
+bool CaroReplay::open(const char* fileName) {
+    close();
+
+    file = SPIFFS.open(fileName, "r");
+    if (!file) {
+        Serial.print("Caro Replay: Cannot open ");
+        Serial.println(fileName);
+        return false;
+    }
+
+    uint8_t header[CaroRecorder::FILE_HEADER_SIZE];
+    if (file.read(header, CaroRecorder::FILE_HEADER_SIZE) != CaroRecorder::FILE_HEADER_SIZE ||
+        getU32(header) != CaroRecorder::MAGIC || header[4] != CaroRecorder::VERSION) {
+        Serial.println("Caro Replay: Not a recording");
+        file.close();
+        return false;
+    }
+    sessionId = (int)getU32(header + 8);
+    myUserId = (int)getU32(header + 12);
+
+    // Start from an empty board, X to move - the recording's BOARD record
+    // (if any) overwrites this
+    CellState empty[BOARD_ROWS][BOARD_COLS];
+    for (int row = 0; row < BOARD_ROWS; row++) {
+        for (int col = 0; col < BOARD_COLS; col++) {
+            empty[row][col] = CELL_EMPTY;
+        }
+    }
+    game->setBoardState(empty);
+    game->setGameState(GAME_PLAYING);
+    game->setTurn(true);
+
+    hostUserId = -1;
+    guestUserId = -1;
+    currentTurn = -1;
+    status = CaroRecorder::STATUS_OTHER;
+    winnerId = -1;
+    memset(&stats, 0, sizeof(stats));
+    finished = false;
+    startMs = millis();
+    hasPending = readNext();
+
+    Serial.print("Caro Replay: Playing session ");
+    Serial.println(sessionId);
+    return true;
+}
+
+void CaroReplay::close() {
+    if (file) {
+        file.close();
+    }
+    hasPending = false;
+    finished = true;
+}
+
+bool CaroReplay::readNext() {
+    uint8_t header[CaroRecorder::RECORD_HEADER_SIZE];
+    if (file.read(header, CaroRecorder::RECORD_HEADER_SIZE) != CaroRecorder::RECORD_HEADER_SIZE) {
+        return false;
+    }
+    int payloadSize = CaroRecorder::getPayloadSize(header[0]);
+    if (payloadSize < 0 || file.read(pendingPayload, (size_t)payloadSize) != (size_t)payloadSize) {
+        Serial.println("Caro Replay: Torn or unknown record, stopping");
+        return false;
+    }
+    pendingType = header[0];
+    pendingTimeMs = getU32(header + 1);
+    return true;
+}
+
+bool CaroReplay::step() {
+    if (!hasPending) {
+        if (!finished) {
+            finished = true;
+            printStats();
+        }
+        return false;
+    }
+    apply(pendingType, pendingPayload);
+    stats.records++;
+    hasPending = readNext();
+    return true;
+}
+
+bool CaroReplay::update() {
+    if (finished) {
+        return false;
+    }
+    unsigned long elapsed = millis() - startMs;
+    while (hasPending) {
+        if (speed > 0.0f && (float)pendingTimeMs > elapsed * speed) {
+            return true;  // Not due yet
+        }
+        step();
+    }
+    return step();
+}
+
+void CaroReplay::runToEnd() {
+    while (step()) {
+    }
+}
+
+void CaroReplay::applyCompleted(int winnerId) {
+    if (winnerId == hostUserId) {
+        game->setGameState(GAME_X_WIN);
+    } else if (winnerId == guestUserId) {
+        game->setGameState(GAME_O_WIN);
+    } else {
+        game->setGameState(GAME_DRAW);
+    }
+}
+
+void CaroReplay::apply(uint8_t type, const uint8_t* payload) {
+    switch (type) {
+        case CaroRecorder::RECORD_LOCAL_MOVE: {
+            unsigned long t0 = micros();
+            game->placeMove(payload[0], payload[1], payload[2] != 0);
+            uint32_t spent = (uint32_t)(micros() - t0);
+            stats.moves++;
+            stats.totalMicros += spent;
+            stats.lastMicros = spent;
+            if (spent > stats.maxMicros) stats.maxMicros = spent;
+            break;
+        }
+        case CaroRecorder::RECORD_REMOTE_MOVE: {
+            int userId = (int)getU32(payload + 2);
+            int turn = (int)getU32(payload + 6);
+            winnerId = (int)getU32(payload + 10);
+            status = payload[14];
+
+            // Same handling as CaroGameScreen::applyMoveDelta
+            unsigned long t0 = micros();
+            game->placeMove(payload[0], payload[1], userId == hostUserId);
+            if (status == CaroRecorder::STATUS_COMPLETED) {
+                applyCompleted(winnerId);
+            }
+            uint32_t spent = (uint32_t)(micros() - t0);
+            stats.moves++;
+            stats.totalMicros += spent;
+            stats.lastMicros = spent;
+            if (spent > stats.maxMicros) stats.maxMicros = spent;
+
+            if (turn > 0) {
+                currentTurn = turn;
+            } else {
+                currentTurn = (currentTurn == hostUserId) ? guestUserId : hostUserId;
+            }
+            break;
+        }
+        case CaroRecorder::RECORD_SUBMIT_RESULT: {
+            if (payload[0] == 0) {
+                break;  // Failed submit - the screen resynced, SYNC record follows
+            }
+            winnerId = (int)getU32(payload + 1);
+            status = payload[5];
+            if (status == CaroRecorder::STATUS_COMPLETED) {
+                applyCompleted(winnerId);
+            }
+            currentTurn = (currentTurn == hostUserId) ? guestUserId : hostUserId;
+            break;
+        }
+        case CaroRecorder::RECORD_SYNC: {
+            currentTurn = (int)getU32(payload);
+            hostUserId = (int)getU32(payload + 4);
+            guestUserId = (int)getU32(payload + 8);
+            status = payload[12];
+            game->setTurn(currentTurn == hostUserId);
+            break;
+        }
+        case CaroRecorder::RECORD_BOARD: {
+            CellState board[BOARD_ROWS][BOARD_COLS];
+            for (int row = 0; row < BOARD_ROWS; row++) {
+                for (int col = 0; col < BOARD_COLS; col++) {
+                    int cell = row * BOARD_COLS + col;
+                    board[row][col] = (CellState)((payload[cell >> 2] >> ((cell & 3) * 2)) & 0x03);
+                }
+            }
+            game->setBoardState(board);
+            break;
+        }
+    }
+}
+
+void CaroReplay::printStats() const {
+    Serial.print("Caro Replay: records=");
+    Serial.print(stats.records);
+    Serial.print(" moves=");
+    Serial.print(stats.moves);
+    Serial.print(" avgMoveUs=");
+    Serial.print(stats.moves > 0 ? stats.totalMicros / stats.moves : 0);
+    Serial.print(" maxMoveUs=");
+    Serial.println(stats.maxMicros);
+}
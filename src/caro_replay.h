@@ -0,0 +1,153 @@
+#ifndef CARO_REPLAY_H
+#define CARO_REPLAY_H
+
+#include <Arduino.h>
+#include <FS.h>
+#include <SPIFFS.h>
+#include "caro_game.h"
+
+// Binary recording of one networked Caro session on SPIFFS, and a driver
+// that plays it back into a CaroGame.
+//
+// File: "/caro.rec" (latest session only, overwritten by the next game)
+//   [file header]  magic "CRP1" (4) + version (1) + reserved (3)
+//                  + sessionId (i32 LE) + myUserId (i32 LE)
+//   [record]*      type (u8) + timeMs since begin() (u32 LE) + payload
+//
+// Payloads (fixed size per type, integers LE):
+//   LOCAL_MOVE     row (u8) + col (u8) + isX (u8)
+//   REMOTE_MOVE    row (u8) + col (u8) + userId (i32) + currentTurn (i32)
+//                  + winnerId (i32) + status (u8)
+//   SUBMIT_RESULT  success (u8) + winnerId (i32) + status (u8)
+//   SYNC           currentTurn (i32) + hostId (i32) + guestId (i32) + status (u8)
+//   BOARD          300 cells, 2 bits each, row-major (75 bytes)
+//
+// A record is written with one write() and flushed, so a reset loses at most
+// the record in flight; the replay stops cleanly at a torn tail.
+class CaroRecorder {
+public:
+    static const uint32_t MAGIC = 0x31505243;         // "CRP1" little-endian
+    static const uint8_t VERSION = 1;
+    static const size_t FILE_HEADER_SIZE = 16;
+    static const size_t RECORD_HEADER_SIZE = 5;       // type + timeMs
+    static const size_t BOARD_BYTES = (BOARD_ROWS * BOARD_COLS + 3) / 4;
+    static const size_t MAX_PAYLOAD_SIZE = BOARD_BYTES;
+    static const size_t MAX_FILE_SIZE = 32 * 1024;    // Stop recording past this (SPIFFS is shared with chat logs)
+
+    enum RecordType {
+        RECORD_LOCAL_MOVE = 1,
+        RECORD_REMOTE_MOVE = 2,
+        RECORD_SUBMIT_RESULT = 3,
+        RECORD_SYNC = 4,
+        RECORD_BOARD = 5
+    };
+
+    // Server game status strings, stored as one byte
+    enum Status {
+        STATUS_OTHER = 0,
+        STATUS_PLAYING = 1,
+        STATUS_IN_PROGRESS = 2,
+        STATUS_COMPLETED = 3
+    };
+
+    static const char* FILE_NAME;
+
+    CaroRecorder();
+    ~CaroRecorder();
+
+    // Start a new recording (replaces the previous one)
+    bool begin(int sessionId, int myUserId);
+    void end();
+    bool isRecording() const { return recording; }
+
+    void recordLocalMove(int row, int col, bool isX);
+    void recordRemoteMove(int row, int col, int userId, const String& gameStatus, int winnerId, int currentTurn);
+    void recordSubmitResult(bool success, const String& gameStatus, int winnerId);
+    void recordSync(int currentTurn, int hostId, int guestId, const String& gameStatus);
+    void recordBoard(const CaroGame& game);
+
+    static uint8_t encodeStatus(const String& gameStatus);
+    static const char* decodeStatus(uint8_t status);
+    // Payload size for a record type, or -1 if unknown
+    static int getPayloadSize(uint8_t type);
+
+private:
+    File file;
+    bool recording;
+    unsigned long startMs;
+    size_t fileSize;
+
+    void writeRecord(uint8_t type, const uint8_t* payload, size_t length);
+};
+
+// Plays a recording back into a CaroGame (the game may be headless - the
+// driver never draws). update() applies records as their timestamps come due,
+// scaled by the speed factor; step() applies the next record immediately.
+class CaroReplay {
+public:
+    struct Stats {
+        uint32_t records;       // Records applied
+        uint32_t moves;         // LOCAL_MOVE + REMOTE_MOVE applied
+        uint32_t totalMicros;   // Time spent applying moves
+        uint32_t maxMicros;     // Slowest single move
+        uint32_t lastMicros;    // Most recent move
+    };
+
+    explicit CaroReplay(CaroGame* game);
+    ~CaroReplay();
+
+    bool open(const char* fileName = CaroRecorder::FILE_NAME);
+    void close();
+    bool isOpen() const { return (bool)file; }
+    bool isFinished() const { return finished; }
+
+    // 1.0 = original timing, 4.0 = four times faster, 0 = no waiting
+    void setSpeed(float speed) { this->speed = speed; }
+
+    // Apply every record whose (scaled) time has come. Returns false when done.
+    bool update();
+    // Apply the next record now. Returns false at end of recording.
+    bool step();
+    // Apply everything as fast as possible
+    void runToEnd();
+
+    const Stats& getStats() const { return stats; }
+    void printStats() const;
+
+    int getSessionId() const { return sessionId; }
+    int getMyUserId() const { return myUserId; }
+    int getHostUserId() const { return hostUserId; }
+    int getGuestUserId() const { return guestUserId; }
+    int getCurrentTurn() const { return currentTurn; }
+    const char* getGameStatus() const { return CaroRecorder::decodeStatus(status); }
+    int getWinnerId() const { return winnerId; }
+
+private:
+    CaroGame* game;
+    File file;
+    float speed;
+    bool finished;
+    unsigned long startMs;
+
+    // Next record, read ahead so update() knows when it is due
+    bool hasPending;
+    uint8_t pendingType;
+    uint32_t pendingTimeMs;
+    uint8_t pendingPayload[CaroRecorder::MAX_PAYLOAD_SIZE];
+
+    int sessionId;
+    int myUserId;
+    int hostUserId;
+    int guestUserId;
+    int currentTurn;
+    uint8_t status;
+    int winnerId;
+
+    Stats stats;
+
+    bool readNext();
+    void apply(uint8_t type, const uint8_t* payload);
+    void applyCompleted(int winnerId);
+};
+
+#endif
@@ -0,0 +1,567 @@
+#include "chat_log.h"
+
+static const char* TEMP_SUFFIX = ".tmp";  // Copy of a log while its torn tail is cut off
+
+String ChatLog::getFileName(int userIdA, int userIdB) {
+    int minId = (userIdA < userIdB) ? userIdA : userIdB;
+    int maxId = (userIdA > userIdB) ? userIdA : userIdB;
+    String fileName = "/";
+    fileName += String(minId);
+    fileName += "-";
+    fileName += String(maxId);
+    fileName += ".log";
+    return fileName;
+}
+
+String ChatLog::getLegacyFileName(int userIdA, int userIdB) {
+    int minId = (userIdA < userIdB) ? userIdA : userIdB;
+    int maxId = (userIdA > userIdB) ? userIdA : userIdB;
+    String fileName = "/";
+    fileName += String(minId);
+    fileName += "-";
+    fileName += String(maxId);
+    fileName += ".txt";
+    return fileName;
+}
+
+String ChatLog::getIndexFileName(int userIdA, int userIdB) {
+    int minId = (userIdA < userIdB) ? userIdA : userIdB;
+    int maxId = (userIdA > userIdB) ? userIdA : userIdB;
+    String fileName = "/";
+    fileName += String(minId);
+    fileName += "-";
+    fileName += String(maxId);
+    fileName += ".idx";
+    return fileName;
+}
+
+void ChatLog::encodeRecordHeader(uint8_t* out, uint16_t length, uint8_t flags, uint32_t timestamp) {
+    out[0] = (uint8_t)(length & 0xFF);
+    out[1] = (uint8_t)(length >> 8);
+    out[2] = flags;
+    out[3] = (uint8_t)(timestamp & 0xFF);
+    out[4] = (uint8_t)((timestamp >> 8) & 0xFF);
+    out[5] = (uint8_t)((timestamp >> 16) & 0xFF);
+    out[6] = (uint8_t)((timestamp >> 24) & 0xFF);
+}
+
+bool ChatLog::writeFileHeader(File& file) {
+    uint8_t header[FILE_HEADER_SIZE] = {
+        (uint8_t)(MAGIC & 0xFF), (uint8_t)((MAGIC >> 8) & 0xFF),
+        (uint8_t)((MAGIC >> 16) & 0xFF), (uint8_t)((MAGIC >> 24) & 0xFF),
+        VERSION, 0, 0, 0
+    };
+    return file.write(header, FILE_HEADER_SIZE) == FILE_HEADER_SIZE;
+}
+
+bool ChatLog::checkHeader(File& file) {
+    uint8_t header[FILE_HEADER_SIZE];
+    file.seek(0);
+    if (file.read(header, FILE_HEADER_SIZE) != FILE_HEADER_SIZE) {
+        return false;
+    }
+    uint32_t magic = (uint32_t)header[0] | ((uint32_t)header[1] << 8) |
+                     ((uint32_t)header[2] << 16) | ((uint32_t)header[3] << 24);
+    return magic == MAGIC && header[4] == VERSION;
+}
+
+bool ChatLog::parseLegacyLine(const String& line, String& text, bool& isUser, uint32_t& timestamp) {
+    // Format: isUser|text|timestamp (text itself may contain '|')
+    int pipe1 = line.indexOf('|');
+    int pipe2 = line.lastIndexOf('|');
+    if (pipe1 <= 0 || pipe2 <= pipe1) {
+        return false;
+    }
+    isUser = (line.substring(0, pipe1) == "1");
+    text = line.substring(pipe1 + 1, pipe2);
+    timestamp = (uint32_t)line.substring(pipe2 + 1).toInt();
+    return true;
+}
+
+bool ChatLog::migrateLegacyFile(int userIdA, int userIdB) {
+    String legacyName = getLegacyFileName(userIdA, userIdB);
+    if (!SPIFFS.exists(legacyName)) {
+        return true;
+    }
+
+    String logName = getFileName(userIdA, userIdB);
+    if (SPIFFS.exists(logName)) {
+        // Already migrated (stale legacy copy left behind) - binary log wins
+        SPIFFS.remove(legacyName);
+        return true;
+    }
+
+    File in = SPIFFS.open(legacyName, "r");
+    if (!in) {
+        Serial.print("ChatLog: Failed to open legacy file: ");
+        Serial.println(legacyName);
+        return false;
+    }
+    File out = SPIFFS.open(logName, "w");
+    if (!out) {
+        in.close();
+        Serial.print("ChatLog: Failed to create log file: ");
+        Serial.println(logName);
+        return false;
+    }
+
+    bool ok = writeFileHeader(out);
+    int migrated = 0;
+
+    in.readStringUntil('\n');  // Skip legacy count line
+    while (ok && in.available()) {
+        String line = in.readStringUntil('\n');
+        line.trim();
+        if (line.length() == 0) continue;
+
+        String text;
+        bool isUser;
+        uint32_t timestamp;
+        if (!parseLegacyLine(line, text, isUser, timestamp)) continue;
+
+        uint16_t length = clampTextLength(text.c_str(), text.length());
+        uint8_t header[RECORD_HEADER_SIZE];
+        encodeRecordHeader(header, length, isUser ? FLAG_FROM_USER : 0, timestamp);
+        ok = out.write(header, RECORD_HEADER_SIZE) == RECORD_HEADER_SIZE &&
+             out.write((const uint8_t*)text.c_str(), length) == length;
+        migrated++;
+    }
+
+    in.close();
+    out.close();
+
+    if (!ok) {
+        // Keep the legacy file so nothing is lost; retry next time
+        SPIFFS.remove(logName);
+        Serial.print("ChatLog: Migration failed for ");
+        Serial.println(legacyName);
+        return false;
+    }
+
+    SPIFFS.remove(legacyName);
+    String indexName = getIndexFileName(userIdA, userIdB);
+    if (SPIFFS.exists(indexName)) {
+        SPIFFS.remove(indexName);
+    }
+    syncIndex(userIdA, userIdB);
+    Serial.print("ChatLog: Migrated ");
+    Serial.print(migrated);
+    Serial.print(" messages ");
+    Serial.print(legacyName);
+    Serial.print(" -> ");
+    Serial.println(logName);
+    return true;
+}
+
+long ChatLog::append(int userIdA, int userIdB, const char* text, size_t length, bool isUser, uint32_t timestamp) {
+    if (!migrateLegacyFile(userIdA, userIdB)) {
+        return -1;
+    }
+
+    String logName = getFileName(userIdA, userIdB);
+    String indexName = getIndexFileName(userIdA, userIdB);
+    bool indexInSync = false;
+    long offset = prepareTail(logName, indexName, indexInSync);
+    if (offset < 0) {
+        return -1;
+    }
+
+    File file = SPIFFS.open(logName, "a");
+    if (!file) {
+        Serial.print("ChatLog: Failed to open for append: ");
+        Serial.println(logName);
+        return -1;
+    }
+
+    if (offset == 0) {
+        if (!writeFileHeader(file)) {
+            file.close();
+            return -1;
+        }
+        offset = FILE_HEADER_SIZE;
+    }
+
+    uint16_t textLength = clampTextLength(text, length);
+    uint8_t header[RECORD_HEADER_SIZE];
+    encodeRecordHeader(header, textLength, isUser ? FLAG_FROM_USER : 0, timestamp);
+
+    bool ok = file.write(header, RECORD_HEADER_SIZE) == RECORD_HEADER_SIZE &&
+              file.write((const uint8_t*)text, textLength) == textLength;
+    file.close();
+    if (!ok) {
+        return -1;  // prepareTail() cuts the partial record off before the next append
+    }
+
+    // Index entry goes after the record, so a crash in between only leaves the
+    // index lagging - syncIndex() picks it up from the last valid entry
+    bool indexed = false;
+    if (indexInSync) {
+        File index = SPIFFS.open(indexName, "a");
+        if (index) {
+            indexed = appendIndexEntry(index, (uint32_t)offset);
+            index.close();
+        }
+    }
+    if (!indexed) {
+        syncIndex(userIdA, userIdB);  // Repairs from the last valid entry, includes this record
+    }
+
+    return offset;
+}
+
+long ChatLog::prepareTail(const String& logName, const String& indexName, bool& indexInSync) {
+    indexInSync = false;
+    String tempName = logName + TEMP_SUFFIX;
+    if (SPIFFS.exists(tempName)) {
+        // A cut was interrupted: the copy is complete only if the log is already gone
+        if (!SPIFFS.exists(logName)) {
+            SPIFFS.rename(tempName, logName);
+        } else {
+            SPIFFS.remove(tempName);
+        }
+    }
+
+    if (!SPIFFS.exists(logName)) {
+        if (SPIFFS.exists(indexName)) {
+            SPIFFS.remove(indexName);
+        }
+        indexInSync = true;
+        return 0;
+    }
+
+    File log = SPIFFS.open(logName, "r");
+    if (!log) {
+        return -1;
+    }
+    size_t logSize = log.size();
+
+    // Fast path: the last indexed record ends exactly at the end of the log
+    size_t scanFrom = FILE_HEADER_SIZE;
+    if (logSize >= FILE_HEADER_SIZE && SPIFFS.exists(indexName)) {
+        File index = SPIFFS.open(indexName, "r");
+        if (index && index.size() % INDEX_ENTRY_SIZE == 0) {
+            int entries = index.size() / INDEX_ENTRY_SIZE;
+            uint32_t lastOffset;
+            if (entries == 0) {
+                indexInSync = (logSize == FILE_HEADER_SIZE);
+            } else if (readIndexEntry(index, entries - 1, lastOffset)) {
+                long next = nextRecordOffset(log, lastOffset);
+                if (next == (long)logSize) {
+                    indexInSync = true;
+                } else if (next > 0) {
+                    scanFrom = (size_t)next;
+                }
+            }
+        }
+        if (index) index.close();
+    } else if (logSize == FILE_HEADER_SIZE) {
+        indexInSync = !SPIFFS.exists(indexName);  // Header only, no records yet
+    }
+    if (indexInSync) {
+        log.close();
+        return (long)logSize;
+    }
+
+    if (logSize < FILE_HEADER_SIZE || !checkHeader(log)) {
+        // Torn or foreign file header: nothing in it can be read back
+        log.close();
+        Serial.print("ChatLog: Unreadable log reset: ");
+        Serial.println(logName);
+        SPIFFS.remove(logName);
+        if (SPIFFS.exists(indexName)) {
+            SPIFFS.remove(indexName);
+        }
+        indexInSync = true;
+        return 0;
+    }
+
+    // Walk the complete records after the index; whatever doesn't parse at the
+    // end is a write cut short by a reset
+    size_t validEnd = scanFrom;
+    log.seek(validEnd);
+    while (validEnd < logSize && skipRecord(log)) {
+        validEnd = log.position();
+    }
+    log.close();
+    if (validEnd == logSize) {
+        return (long)logSize;  // Only the index lags
+    }
+
+    // SPIFFS can't truncate, and a record written after the garbage would be
+    // misread by every later scan - copy the good part and swap it in
+    if (!truncateLog(logName, validEnd)) {
+        Serial.print("ChatLog: Failed to cut torn tail of ");
+        Serial.println(logName);
+        return -1;
+    }
+    Serial.print("ChatLog: Dropped ");
+    Serial.print((unsigned long)(logSize - validEnd));
+    Serial.print(" torn bytes at the end of ");
+    Serial.println(logName);
+    return (long)validEnd;
+}
+
+bool ChatLog::truncateLog(const String& logName, size_t length) {
+    String tempName = logName + TEMP_SUFFIX;
+    File in = SPIFFS.open(logName, "r");
+    File out = SPIFFS.open(tempName, "w");
+    bool ok = in && out;
+    uint8_t chunk[256];
+    size_t copied = 0;
+    while (ok && copied < length) {
+        size_t n = length - copied > sizeof(chunk) ? sizeof(chunk) : length - copied;
+        ok = in.read(chunk, n) == n && out.write(chunk, n) == n;
+        copied += n;
+    }
+    if (in) in.close();
+    if (out) out.close();
+    if (!ok) {
+        SPIFFS.remove(tempName);
+        return false;
+    }
+    // A reset between these two is finished by prepareTail() (temp file, no log)
+    SPIFFS.remove(logName);
+    return SPIFFS.rename(tempName, logName);
+}
+
+uint16_t ChatLog::clampTextLength(const char* text, size_t length) {
+    if (length <= MAX_TEXT_LENGTH) {
+        return (uint16_t)length;
+    }
+    // text[cut] is the first byte dropped - if it continues a sequence, drop
+    // the whole character (Vietnamese is 2-3 bytes per letter)
+    size_t cut = MAX_TEXT_LENGTH;
+    while (cut > 0 && ((uint8_t)text[cut] & 0xC0) == 0x80) {
+        cut--;
+    }
+    return (uint16_t)cut;
+}
+
+bool ChatLog::readIndexEntry(File& index, int entry, uint32_t& offset) {
+    uint8_t buf[INDEX_ENTRY_SIZE];
+    if (!index.seek((size_t)entry * INDEX_ENTRY_SIZE) ||
+        index.read(buf, INDEX_ENTRY_SIZE) != INDEX_ENTRY_SIZE) {
+        return false;
+    }
+    offset = (uint32_t)buf[0] | ((uint32_t)buf[1] << 8) |
+             ((uint32_t)buf[2] << 16) | ((uint32_t)buf[3] << 24);
+    return true;
+}
+
+bool ChatLog::appendIndexEntry(File& index, uint32_t offset) {
+    uint8_t buf[INDEX_ENTRY_SIZE] = {
+        (uint8_t)(offset & 0xFF), (uint8_t)((offset >> 8) & 0xFF),
+        (uint8_t)((offset >> 16) & 0xFF), (uint8_t)((offset >> 24) & 0xFF)
+    };
+    return index.write(buf, INDEX_ENTRY_SIZE) == INDEX_ENTRY_SIZE;
+}
+
+long ChatLog::nextRecordOffset(File& log, uint32_t recordOffset) {
+    if (recordOffset < FILE_HEADER_SIZE || recordOffset >= log.size() || !log.seek(recordOffset)) {
+        return -1;
+    }
+    if (!skipRecord(log)) {
+        return -1;
+    }
+    return (long)log.position();
+}
+
+bool ChatLog::syncIndex(int userIdA, int userIdB) {
+    String logName = getFileName(userIdA, userIdB);
+    String indexName = getIndexFileName(userIdA, userIdB);
+
+    if (!SPIFFS.exists(logName)) {
+        if (SPIFFS.exists(indexName)) {
+            SPIFFS.remove(indexName);
+        }
+        return true;
+    }
+
+    File log = SPIFFS.open(logName, "r");
+    if (!log || !checkHeader(log)) {
+        if (log) log.close();
+        return false;
+    }
+    size_t logSize = log.size();
+
+    // Find where indexing should resume
+    size_t scanFrom = FILE_HEADER_SIZE;
+    bool rebuild = false;
+    if (SPIFFS.exists(indexName)) {
+        File index = SPIFFS.open(indexName, "r");
+        if (!index || index.size() % INDEX_ENTRY_SIZE != 0) {
+            rebuild = true;  // Torn entry - SPIFFS can't truncate, start over
+        } else {
+            int entries = index.size() / INDEX_ENTRY_SIZE;
+            uint32_t lastOffset;
+            if (entries > 0) {
+                long next = readIndexEntry(index, entries - 1, lastOffset) ? nextRecordOffset(log, lastOffset) : -1;
+                if (next < 0 || (size_t)next > logSize) {
+                    rebuild = true;
+                } else {
+                    scanFrom = (size_t)next;
+                }
+            }
+        }
+        if (index) index.close();
+    }
+    if (rebuild) {
+        SPIFFS.remove(indexName);
+        scanFrom = FILE_HEADER_SIZE;
+    }
+
+    if (scanFrom >= logSize) {
+        log.close();
+        return true;  // Already up to date
+    }
+
+    File index = SPIFFS.open(indexName, "a");
+    if (!index) {
+        log.close();
+        return false;
+    }
+
+    int added = 0;
+    size_t pos = scanFrom;
+    log.seek(pos);
+    while (pos < logSize) {
+        if (!skipRecord(log)) {
+            break;  // Torn record at the tail - leave it unindexed
+        }
+        if (!appendIndexEntry(index, (uint32_t)pos)) {
+            break;
+        }
+        added++;
+        pos = log.position();
+    }
+
+    index.close();
+    log.close();
+
+    Serial.print("ChatLog: Indexed ");
+    Serial.print(added);
+    Serial.print(rebuild ? " records (rebuilt) in " : " records in ");
+    Serial.println(indexName);
+    return true;
+}
+
+int ChatLog::getMessageCount(int userIdA, int userIdB) {
+    String indexName = getIndexFileName(userIdA, userIdB);
+    if (!SPIFFS.exists(indexName)) {
+        return 0;
+    }
+    File index = SPIFFS.open(indexName, "r");
+    if (!index) {
+        return 0;
+    }
+    int count = index.size() / INDEX_ENTRY_SIZE;
+    index.close();
+    return count;
+}
+
+long ChatLog::getRecordOffset(int userIdA, int userIdB, int entry) {
+    if (entry < 0) {
+        return -1;
+    }
+    File index = SPIFFS.open(getIndexFileName(userIdA, userIdB), "r");
+    if (!index) {
+        return -1;
+    }
+    uint32_t offset = 0;
+    bool ok = (size_t)(entry + 1) * INDEX_ENTRY_SIZE <= index.size() && readIndexEntry(index, entry, offset);
+    index.close();
+    return ok ? (long)offset : -1;
+}
+
+int ChatLog::getRecordOffsets(int userIdA, int userIdB, int first, int count, uint32_t* offsets) {
+    if (first < 0 || count <= 0) {
+        return 0;
+    }
+    File index = SPIFFS.open(getIndexFileName(userIdA, userIdB), "r");
+    if (!index) {
+        return 0;
+    }
+    int available = (int)(index.size() / INDEX_ENTRY_SIZE) - first;
+    if (count > available) {
+        count = available;
+    }
+    int read = 0;
+    if (count > 0 && index.seek((size_t)first * INDEX_ENTRY_SIZE)) {
+        // Entries are contiguous: one sequential pass
+        uint8_t buf[INDEX_ENTRY_SIZE];
+        while (read < count && index.read(buf, INDEX_ENTRY_SIZE) == INDEX_ENTRY_SIZE) {
+            offsets[read++] = (uint32_t)buf[0] | ((uint32_t)buf[1] << 8) |
+                              ((uint32_t)buf[2] << 16) | ((uint32_t)buf[3] << 24);
+        }
+    }
+    index.close();
+    return read;
+}
+
+void ChatLog::remove(int userIdA, int userIdB) {
+    String logName = getFileName(userIdA, userIdB);
+    if (SPIFFS.exists(logName)) {
+        SPIFFS.remove(logName);
+    }
+    String indexName = getIndexFileName(userIdA, userIdB);
+    if (SPIFFS.exists(indexName)) {
+        SPIFFS.remove(indexName);
+    }
+    String legacyName = getLegacyFileName(userIdA, userIdB);
+    if (SPIFFS.exists(legacyName)) {
+        SPIFFS.remove(legacyName);
+    }
+}
+
+bool ChatLog::readRecordHeader(File& file, uint16_t& length, bool& isUser, uint32_t& timestamp) {
+    uint8_t header[RECORD_HEADER_SIZE];
+    if (file.read(header, RECORD_HEADER_SIZE) != RECORD_HEADER_SIZE) {
+        return false;
+    }
+    length = (uint16_t)header[0] | ((uint16_t)header[1] << 8);
+    if (length > MAX_TEXT_LENGTH) {
+        return false;  // Corrupt record
+    }
+    isUser = (header[2] & FLAG_FROM_USER) != 0;
+    timestamp = (uint32_t)header[3] | ((uint32_t)header[4] << 8) |
+                ((uint32_t)header[5] << 16) | ((uint32_t)header[6] << 24);
+    return true;
+}
+
+bool ChatLog::readRecord(File& file, String& text, bool& isUser, uint32_t& timestamp) {
+    uint16_t length;
+    if (!readRecordHeader(file, length, isUser, timestamp)) {
+        return false;
+    }
+
+    text = "";
+    text.reserve(length);
+    char chunk[65];
+    uint16_t remaining = length;
+    while (remaining > 0) {
+        uint16_t n = remaining > 64 ? 64 : remaining;
+        if (file.read((uint8_t*)chunk, n) != n) {
+            return false;  // Torn write at end of file
+        }
+        chunk[n] = '\0';
+        text += chunk;
+        remaining -= n;
+    }
+    return true;
+}
+
+bool ChatLog::skipRecord(File& file) {
+    uint8_t header[RECORD_HEADER_SIZE];
+    if (file.read(header, RECORD_HEADER_SIZE) != RECORD_HEADER_SIZE) {
+        return false;
+    }
+    uint16_t length = (uint16_t)header[0] | ((uint16_t)header[1] << 8);
+    if (length > MAX_TEXT_LENGTH) {
+        return false;
+    }
+    size_t next = file.position() + length;
+    if (next > file.size()) {
+        return false;  // Torn write at end of file
+    }
+    return file.seek(next);
+}
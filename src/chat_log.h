@@ -0,0 +1,92 @@
+#ifndef CHAT_LOG_H
+#define CHAT_LOG_H
+
+#include <Arduino.h>
+#include <FS.h>
+#include <SPIFFS.h>
+
+// Append-only chat history on SPIFFS.
+//
+// File: "/<min_user_id>-<max_user_id>.log"
+//   [file header]  magic "CLG1" (4 bytes) + version (1) + reserved (3)
+//   [record]*      textLength (u16 LE) + flags (u8) + timestamp (u32 LE) + text bytes
+//
+// Sidecar index: "/<min_user_id>-<max_user_id>.idx"
+//   [entry]*       byte offset of record i in the log (u32 LE, fixed width)
+//
+// Each new message costs one sequential write at the end of the log plus one
+// 4-byte write at the end of the index - existing content is never rewritten.
+// A record cut short by a reset is dropped before the next append (the good
+// part is copied to "<log>.tmp" and renamed over the log), so records never
+// follow garbage.
+// Message count is index size / 4 and record i is one seek away, so opening a
+// chat or paging back k messages never scans the log. Legacy "/<min>-<max>.txt"
+// logs ("<count>\n" + "isUser|text|timestamp" lines) are converted once by
+// migrateLegacyFile().
+class ChatLog {
+public:
+    static const uint32_t MAGIC = 0x31474C43;        // "CLG1" little-endian
+    static const uint8_t VERSION = 1;
+    static const size_t FILE_HEADER_SIZE = 8;
+    static const size_t RECORD_HEADER_SIZE = 7;      // length + flags + timestamp
+    static const uint16_t MAX_TEXT_LENGTH = 2048;    // Server caps chat at 500 chars (UTF-8 up to 4 bytes)
+    static const size_t INDEX_ENTRY_SIZE = 4;
+
+    static const uint8_t FLAG_FROM_USER = 0x01;      // Sent by the device owner
+
+    // "/<min>-<max>.log" (same file regardless of argument order)
+    static String getFileName(int userIdA, int userIdB);
+    static String getLegacyFileName(int userIdA, int userIdB);
+    static String getIndexFileName(int userIdA, int userIdB);
+
+    // Convert a legacy text log to the record format (no-op if already done).
+    // Returns false only if a legacy file exists and could not be converted.
+    static bool migrateLegacyFile(int userIdA, int userIdB);
+
+    // Append one message. Returns byte offset of the new record, or -1 on error.
+    static long append(int userIdA, int userIdB, const char* text, size_t length, bool isUser, uint32_t timestamp);
+    static long append(int userIdA, int userIdB, const String& text, bool isUser, uint32_t timestamp) {
+        return append(userIdA, userIdB, text.c_str(), text.length(), isUser, timestamp);
+    }
+
+    // Delete the log, its index and any legacy file
+    static void remove(int userIdA, int userIdB);
+
+    // Bring the index up to date with the log (only records past the last
+    // indexed one are scanned; a missing/torn index is rebuilt once).
+    static bool syncIndex(int userIdA, int userIdB);
+
+    // O(1) lookups through the index
+    static int getMessageCount(int userIdA, int userIdB);
+    static long getRecordOffset(int userIdA, int userIdB, int index);
+    // Offsets of records [first, first + count) in one index read; returns how many were read
+    static int getRecordOffsets(int userIdA, int userIdB, int first, int count, uint32_t* offsets);
+
+    // Reader helpers - file must be opened for reading.
+    // checkHeader() positions the file on the first record.
+    static bool checkHeader(File& file);
+    // Read the record at the current position (advances past it)
+    static bool readRecord(File& file, String& text, bool& isUser, uint32_t& timestamp);
+    // Skip the record at the current position without reading its text
+    static bool skipRecord(File& file);
+    // Read only the record header - file is left on the first text byte so the
+    // caller can read `length` bytes into its own buffer
+    static bool readRecordHeader(File& file, uint16_t& length, bool& isUser, uint32_t& timestamp);
+
+private:
+    static void encodeRecordHeader(uint8_t* out, uint16_t length, uint8_t flags, uint32_t timestamp);
+    static bool writeFileHeader(File& file);
+    static bool parseLegacyLine(const String& line, String& text, bool& isUser, uint32_t& timestamp);
+    static bool readIndexEntry(File& index, int entry, uint32_t& offset);
+    static bool appendIndexEntry(File& index, uint32_t offset);
+    static long nextRecordOffset(File& log, uint32_t recordOffset);
+    // Offset for the next record (0: log must be created), after cutting off a
+    // torn tail. indexInSync: the index already covers every record before it.
+    static long prepareTail(const String& logName, const String& indexName, bool& indexInSync);
+    // Keep only the first length bytes of the log
+    static bool truncateLog(const String& logName, size_t length);
+    // Longest prefix of text, at most MAX_TEXT_LENGTH bytes, that doesn't split a UTF-8 character
+    static uint16_t clampTextLength(const char* text, size_t length);
+};
+
+#endif
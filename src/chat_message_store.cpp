@@ -0,0 +1,129 @@
+#include "chat_message_store.h"
+#include <string.h>
+
+ChatMessageStore::ChatMessageStore() {
+    clear();
+}
+
+void ChatMessageStore::clear() {
+    slotHead = 0;
+    slotCount = 0;
+    textHead = 0;
+    textTail = 0;
+    used = 0;
+}
+
+void ChatMessageStore::pushNewest(const char* text, uint16_t length, bool isUser, uint32_t timestamp) {
+    if (length > MAX_TEXT_LENGTH) {
+        length = MAX_TEXT_LENGTH;
+    }
+    memcpy(pushNewest(length, isUser, timestamp), text, length);
+}
+
+char* ChatMessageStore::pushNewest(uint16_t length, bool isUser, uint32_t timestamp) {
+    if (length > MAX_TEXT_LENGTH) {
+        length = MAX_TEXT_LENGTH;
+    }
+
+    uint16_t pos;
+    uint16_t padding;
+    while (true) {
+        if (slotCount == 0) {
+            clear();
+        }
+        // Text must stay contiguous: if it does not fit before the arena end,
+        // skip the remaining bytes and start again at 0
+        pos = textTail;
+        padding = 0;
+        if (pos + length > ARENA_SIZE) {
+            padding = ARENA_SIZE - pos;
+            pos = 0;
+        }
+        if (slotCount < CAPACITY && freeBytes() >= padding + length) {
+            break;
+        }
+        popOldest();
+    }
+
+    Slot& s = slots[(slotHead + slotCount) % CAPACITY];
+    s.offset = pos;
+    s.length = length;
+    s.isUser = isUser;
+    s.timestamp = timestamp;
+    slotCount++;
+    used += padding + length;
+    textTail = pos + length;
+    return arena + pos;
+}
+
+char* ChatMessageStore::pushOldest(uint16_t length, bool isUser, uint32_t timestamp) {
+    if (length > MAX_TEXT_LENGTH || slotCount >= CAPACITY) {
+        return nullptr;
+    }
+
+    uint16_t pos;
+    uint16_t needed;
+    if (slotCount == 0) {
+        clear();
+        pos = 0;
+        needed = length;
+        textTail = length;
+    } else if (textHead >= length) {
+        pos = textHead - length;
+        needed = length;
+    } else {
+        // Not enough room before the oldest text: the bytes in front of it
+        // become padding and the text goes at the arena end
+        pos = ARENA_SIZE - length;
+        needed = textHead + length;
+    }
+    if (freeBytes() < needed) {
+        return nullptr;
+    }
+
+    slotHead = (slotHead + CAPACITY - 1) % CAPACITY;
+    Slot& s = slots[slotHead];
+    s.offset = pos;
+    s.length = length;
+    s.isUser = isUser;
+    s.timestamp = timestamp;
+    slotCount++;
+    used += needed;
+    textHead = pos;
+    return arena + pos;
+}
+
+void ChatMessageStore::popOldest() {
+    if (slotCount == 0) {
+        return;
+    }
+    slotHead = (slotHead + 1) % CAPACITY;
+    slotCount--;
+    if (slotCount == 0) {
+        clear();
+        return;
+    }
+    // Released bytes = distance to the next text (covers any padding between)
+    uint16_t next = slots[slotHead].offset;
+    uint16_t released = (uint16_t)((next + ARENA_SIZE - textHead) % ARENA_SIZE);
+    used -= released;
+    textHead = next;
+}
+
+void ChatMessageStore::popNewest() {
+    if (slotCount == 0) {
+        return;
+    }
+    slotCount--;
+    if (slotCount == 0) {
+        clear();
+        return;
+    }
+    // Released bytes = distance back to the end of the previous text (covers
+    // the padding skipped when the popped text wrapped to the arena start)
+    const Slot& s = slots[(slotHead + slotCount - 1) % CAPACITY];
+    uint16_t end = s.offset + s.length;
+    uint16_t released = (uint16_t)((textTail + ARENA_SIZE - end) % ARENA_SIZE);
+    used -= released;
+    textTail = end;
+}
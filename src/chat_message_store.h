@@ -0,0 +1,71 @@
+#ifndef CHAT_MESSAGE_STORE_H
+#define CHAT_MESSAGE_STORE_H
+
+#include <Arduino.h>
+
+// Bounded in-memory window of chat messages for ChatScreen.
+//
+// Slots form a ring (index 0 = oldest loaded message) and all message text
+// lives in one fixed byte arena that is itself used as a ring: new messages
+// are written after the newest text, older history is written before the
+// oldest text. A message never wraps around the arena end (the unused tail is
+// skipped as padding), so getText() is always one contiguous run.
+//
+// Nothing is allocated after construction: pushNewest() evicts the oldest
+// messages until the text fits. pushOldest() refuses when the window is full;
+// the caller makes room with popNewest() so the window slides back through
+// history. All are O(1) per message.
+class ChatMessageStore {
+public:
+    static const int CAPACITY = 50;
+    static const uint16_t ARENA_SIZE = 4096;
+    static const uint16_t MAX_TEXT_LENGTH = ARENA_SIZE / 2;   // Longer text is truncated
+
+    ChatMessageStore();
+
+    int count() const { return slotCount; }
+    bool isEmpty() const { return slotCount == 0; }
+    void clear();
+
+    // Append as newest message (evicts oldest messages if needed)
+    void pushNewest(const char* text, uint16_t length, bool isUser, uint32_t timestamp);
+    // Same, but returns the arena location for `length` text bytes (caller fills it)
+    char* pushNewest(uint16_t length, bool isUser, uint32_t timestamp);
+    void popNewest();
+
+    // Reserve room for a message older than everything loaded. Returns the
+    // arena location for `length` text bytes (caller fills it), or nullptr
+    // if the window is full.
+    char* pushOldest(uint16_t length, bool isUser, uint32_t timestamp);
+    void popOldest();
+
+    // Accessors by logical index (0 = oldest). Text is NOT null-terminated.
+    const char* getText(int index) const { return arena + slot(index).offset; }
+    uint16_t getLength(int index) const { return slot(index).length; }
+    bool isUser(int index) const { return slot(index).isUser; }
+    uint32_t getTimestamp(int index) const { return slot(index).timestamp; }
+
+    uint16_t bytesUsed() const { return used; }
+
+private:
+    struct Slot {
+        uint16_t offset;
+        uint16_t length;
+        uint32_t timestamp;
+        bool isUser;
+    };
+
+    Slot slots[CAPACITY];
+    char arena[ARENA_SIZE];
+
+    int slotHead;       // Ring index of the oldest message
+    int slotCount;
+    uint16_t textHead;  // Arena offset of the oldest text
+    uint16_t textTail;  // Arena offset just past the newest text
+    uint16_t used;      // Bytes between textHead and textTail (including padding)
+
+    const Slot& slot(int index) const { return slots[(slotHead + index) % CAPACITY]; }
+    uint16_t freeBytes() const { return ARENA_SIZE - used; }
+};
+
+#endif
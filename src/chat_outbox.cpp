@@ -0,0 +1,608 @@
+#include "chat_outbox.h"
+#include "json_tokenizer.h"
+
+const char* ChatOutbox::FILE_NAME = "/chat_outbox.log";
+static const char* COMPACT_FILE_NAME = "/chat_outbox.tmp";
+
+static void putU16(uint8_t* out, uint16_t value) {
+    out[0] = (uint8_t)(value & 0xFF);
+    out[1] = (uint8_t)(value >> 8);
+}
+
+static void putI32(uint8_t* out, int32_t value) {
+    uint32_t v = (uint32_t)value;
+    out[0] = (uint8_t)(v & 0xFF);
+    out[1] = (uint8_t)((v >> 8) & 0xFF);
+    out[2] = (uint8_t)((v >> 16) & 0xFF);
+    out[3] = (uint8_t)((v >> 24) & 0xFF);
+}
+
+static int32_t getI32(const uint8_t* in) {
+    return (int32_t)((uint32_t)in[0] | ((uint32_t)in[1] << 8) | ((uint32_t)in[2] << 16) | ((uint32_t)in[3] << 24));
+}
+
+static uint32_t hashId(const String& messageId) {
+    return JsonTokenizer::hashBytes(messageId.c_str(), messageId.length());
+}
+
+static bool writeHeader(File& file) {
+    uint8_t header[ChatOutbox::FILE_HEADER_SIZE] = {
+        (uint8_t)(ChatOutbox::MAGIC & 0xFF), (uint8_t)((ChatOutbox::MAGIC >> 8) & 0xFF),
+        (uint8_t)((ChatOutbox::MAGIC >> 16) & 0xFF), (uint8_t)((ChatOutbox::MAGIC >> 24) & 0xFF),
+        ChatOutbox::VERSION, 0, 0, 0
+    };
+    return file.write(header, ChatOutbox::FILE_HEADER_SIZE) == ChatOutbox::FILE_HEADER_SIZE;
+}
+
+static bool writeQueued(File& file, int32_t fromUserId, int32_t toUserId, const String& messageId, const String& text) {
+    uint8_t head[2];
+    head[0] = ChatOutbox::KIND_QUEUED;
+    head[1] = (uint8_t)messageId.length();
+    uint8_t tail[10];
+    putI32(tail, fromUserId);
+    putI32(tail + 4, toUserId);
+    putU16(tail + 8, (uint16_t)text.length());
+    return file.write(head, 2) == 2 &&
+           file.write((const uint8_t*)messageId.c_str(), messageId.length()) == messageId.length() &&
+           file.write(tail, sizeof(tail)) == sizeof(tail) &&
+           file.write((const uint8_t*)text.c_str(), text.length()) == text.length();
+}
+
+ChatOutbox::ChatOutbox() {
+    this->count = 0;
+    this->spilled = 0;
+    this->recentAckNext = 0;
+    this->idNonce = 0;
+    this->idCounter = 0;
+    this->renamePending = false;
+    this->stats = {0, 0, 0, 0, 0};
+    memset(recentAcks, 0, sizeof(recentAcks));
+    this->mutex = xSemaphoreCreateMutex();
+    if (mutex == NULL) {
+        Serial.println("Chat Outbox: Failed to create mutex!");
+    }
+}
+
+ChatOutbox::~ChatOutbox() {
+    if (mutex != NULL) {
+        vSemaphoreDelete(mutex);
+        mutex = NULL;
+    }
+}
+
+unsigned long ChatOutbox::retryDelay(uint8_t attempts) {
+    unsigned long delayMs = RETRY_BASE_MS;
+    for (uint8_t i = 1; i < attempts && delayMs < RETRY_MAX_MS; i++) {
+        delayMs *= 2;
+    }
+    return (delayMs < RETRY_MAX_MS) ? delayMs : RETRY_MAX_MS;
+}
+
+// Hashes can collide: a match is confirmed against the id on flash.
+// Caller holds the mutex.
+int ChatOutbox::find(const String& messageId) {
+    uint32_t hash = hashId(messageId);
+    String id;
+    for (int i = 0; i < count; i++) {
+        if (entries[i].idHash == hash && idAt(entries[i].offset, id) && id == messageId) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+bool ChatOutbox::idAt(uint32_t offset, String& messageId) {
+    File file = openJournal("r");
+    uint8_t kind;
+    int32_t from;
+    int32_t to;
+    bool ok = file && file.seek(offset) && readRecord(file, kind, messageId, from, to, nullptr);
+    if (file) {
+        file.close();
+    }
+    return ok;
+}
+
+// The journal, after finishing a compact() whose rename failed (no file
+// while it still can't). Caller holds the mutex.
+File ChatOutbox::openJournal(const char* mode) {
+    if (renamePending && SPIFFS.rename(COMPACT_FILE_NAME, FILE_NAME)) {
+        renamePending = false;
+    }
+    if (renamePending) {
+        return File();
+    }
+    return SPIFFS.open(FILE_NAME, mode);
+}
+
+void ChatOutbox::removeAt(int index) {
+    for (int i = index + 1; i < count; i++) {
+        entries[i - 1] = entries[i];
+    }
+    count--;
+}
+
+bool ChatOutbox::readRecord(File& file, uint8_t& kind, String& messageId, int32_t& fromUserId, int32_t& toUserId, String* text) {
+    uint8_t head[2];
+    if (file.read(head, 2) != 2) {
+        return false;
+    }
+    kind = head[0];
+    uint8_t idLength = head[1];
+    if ((kind != KIND_QUEUED && kind != KIND_DONE) || idLength == 0 || idLength > MAX_ID_LENGTH) {
+        return false;
+    }
+
+    char id[MAX_ID_LENGTH + 1];
+    if (file.read((uint8_t*)id, idLength) != idLength) {
+        return false;
+    }
+    id[idLength] = '\0';
+    messageId = id;
+    if (kind == KIND_DONE) {
+        return true;
+    }
+
+    uint8_t tail[10];
+    if (file.read(tail, sizeof(tail)) != sizeof(tail)) {
+        return false;
+    }
+    fromUserId = getI32(tail);
+    toUserId = getI32(tail + 4);
+    uint16_t textLength = (uint16_t)(tail[8] | (tail[9] << 8));
+    if (file.available() < textLength) {
+        return false;  // Torn write at the end
+    }
+    if (text == nullptr) {
+        return file.seek(file.position() + textLength);
+    }
+
+    char buffer[128];
+    *text = "";
+    text->reserve(textLength);
+    while (textLength > 0) {
+        uint16_t chunk = (textLength < sizeof(buffer) - 1) ? textLength : (uint16_t)(sizeof(buffer) - 1);
+        if (file.read((uint8_t*)buffer, chunk) != chunk) {
+            return false;
+        }
+        buffer[chunk] = '\0';
+        *text += buffer;
+        textLength -= chunk;
+    }
+    return true;
+}
+
+// Rebuild entries from the journal, oldest first. QUEUED records that don't
+// fit are counted in spilled; an entry that was already in the same slot
+// keeps its retry timer. False if the file is torn. Caller holds the mutex.
+bool ChatOutbox::replay() {
+    File file = openJournal("r");
+    if (!file && renamePending) {
+        return false;  // Records are all in the copy: keep RAM as it is
+    }
+    int previous = count;
+    count = 0;
+    spilled = 0;
+
+    bool torn = false;
+    if (!file || file.size() < FILE_HEADER_SIZE) {
+        torn = true;
+    } else {
+        uint8_t header[FILE_HEADER_SIZE];
+        file.read(header, FILE_HEADER_SIZE);
+        torn = getI32(header) != (int32_t)MAGIC || header[4] != VERSION;
+    }
+
+    while (!torn && file.available() > 0) {
+        uint32_t offset = file.position();
+        uint8_t kind;
+        String messageId;
+        int32_t fromUserId = 0;
+        int32_t toUserId = 0;
+        if (!readRecord(file, kind, messageId, fromUserId, toUserId, nullptr)) {
+            torn = true;  // Power lost mid-append: keep what came before
+            break;
+        }
+        if (kind == KIND_DONE) {
+            int index = find(messageId);
+            if (index >= 0) {
+                removeAt(index);
+            }
+        } else if (count < MAX_PENDING) {
+            Entry& entry = entries[count];
+            uint32_t hash = hashId(messageId);
+            if (count >= previous || entry.idHash != hash) {
+                entry.attempts = 0;
+                entry.nextAttemptAt = 0;
+            }
+            entry.idHash = hash;
+            entry.offset = offset;
+            entry.fromUserId = fromUserId;
+            entry.toUserId = toUserId;
+            count++;
+        } else {
+            spilled++;  // Stays on flash until a slot frees up
+        }
+    }
+    if (file) {
+        file.close();
+    }
+    return !torn;
+}
+
+int ChatOutbox::load() {
+    if (mutex == NULL || xSemaphoreTake(mutex, portMAX_DELAY) != pdTRUE) {
+        return 0;
+    }
+    count = 0;
+    spilled = 0;
+
+    if (SPIFFS.exists(COMPACT_FILE_NAME)) {
+        // compact() was cut short: the copy is complete only if the journal is already gone
+        renamePending = !SPIFFS.exists(FILE_NAME);
+        if (!renamePending) {
+            SPIFFS.remove(COMPACT_FILE_NAME);
+        }
+    }
+
+    if (renamePending || SPIFFS.exists(FILE_NAME)) {
+        bool torn = !replay();
+        if (count == 0) {
+            SPIFFS.remove(FILE_NAME);
+        } else if (torn || spilled > 0) {
+            // Drop the torn tail so later appends stay parseable. With a spill
+            // the DONEs go too: one after a spilled record would let a newer
+            // message into RAM ahead of it, the second replay keeps the order.
+            if (compact(true) && spilled > 0) {
+                replay();
+            }
+        }
+    }
+
+    int pending = count;
+    int onFlash = spilled;
+    xSemaphoreGive(mutex);
+
+    Serial.print("Chat Outbox: ");
+    Serial.print(pending + onFlash);
+    Serial.print(" message(s) waiting from last session");
+    if (onFlash > 0) {
+        Serial.print(", ");
+        Serial.print(onFlash);
+        Serial.print(" kept on flash until the outbox has room");
+    }
+    Serial.println();
+    return pending + onFlash;
+}
+
+bool ChatOutbox::enqueue(int fromUserId, int toUserId, const String& messageId, const String& text) {
+    if (messageId.length() == 0 || messageId.length() > MAX_ID_LENGTH) {
+        return false;
+    }
+    if (mutex == NULL || xSemaphoreTake(mutex, portMAX_DELAY) != pdTRUE) {
+        return false;
+    }
+
+    bool ok = false;
+    if (count >= MAX_PENDING || spilled > 0) {  // A spilled message must go first
+        Serial.println("Chat Outbox: ⚠️  Full - message not queued");
+    } else {
+        bool fresh = !renamePending && !SPIFFS.exists(FILE_NAME);
+        File file = openJournal("a");
+        if (file) {
+            if (fresh || file.size() == 0) {
+                writeHeader(file);
+            }
+            uint32_t offset = file.size();
+            if (writeQueued(file, fromUserId, toUserId, messageId, text)) {
+                Entry& entry = entries[count++];
+                entry.idHash = hashId(messageId);
+                entry.offset = offset;
+                entry.fromUserId = fromUserId;
+                entry.toUserId = toUserId;
+                entry.attempts = 0;
+                entry.nextAttemptAt = 0;
+                stats.queued++;
+                ok = true;
+            }
+            file.close();
+        }
+        if (!ok) {
+            Serial.println("Chat Outbox: ⚠️  Failed to write message to flash");
+        }
+    }
+
+    xSemaphoreGive(mutex);
+    return ok;
+}
+
+bool ChatOutbox::nextDue(int fromUserId, unsigned long now, int& toUserId, String& messageId, String& text) {
+    if (count == 0 || mutex == NULL || xSemaphoreTake(mutex, portMAX_DELAY) != pdTRUE) {
+        return false;
+    }
+
+    // A friend whose oldest message is still waiting (in flight or backing
+    // off) gets nothing newer until that one is answered
+    int32_t blocked[MAX_PENDING];
+    int blockedCount = 0;
+    bool found = false;
+
+    for (int i = 0; i < count && !found; i++) {
+        Entry& entry = entries[i];
+        if (entry.fromUserId != fromUserId) {
+            continue;  // Queued by another account on this device
+        }
+        bool isBlocked = false;
+        for (int b = 0; b < blockedCount; b++) {
+            if (blocked[b] == entry.toUserId) {
+                isBlocked = true;
+                break;
+            }
+        }
+        if (isBlocked) {
+            continue;
+        }
+        if (entry.attempts > 0 && (long)(now - entry.nextAttemptAt) < 0) {
+            blocked[blockedCount++] = entry.toUserId;
+            continue;
+        }
+
+        File file = openJournal("r");
+        if (!file && renamePending) {
+            break;  // Journal is still the compact copy: try again next tick
+        }
+        uint8_t kind;
+        int32_t from;
+        int32_t to;
+        if (file && file.seek(entry.offset) && readRecord(file, kind, messageId, from, to, &text) && kind == KIND_QUEUED) {
+            toUserId = to;
+            if (entry.attempts < 255) {
+                entry.attempts++;
+            }
+            entry.nextAttemptAt = now + retryDelay(entry.attempts);
+            stats.sent++;
+            found = true;
+        } else {
+            // Unreadable record: nothing to resend, don't let it block the queue
+            Serial.println("Chat Outbox: ⚠️  Unreadable record dropped");
+            removeAt(i);
+            i--;
+        }
+        if (file) {
+            file.close();
+        }
+    }
+
+    xSemaphoreGive(mutex);
+    return found;
+}
+
+bool ChatOutbox::appendDone(const String& messageId) {
+    File file = openJournal("a");
+    if (!file) {
+        return false;
+    }
+    uint8_t head[2] = {KIND_DONE, (uint8_t)messageId.length()};
+    bool ok = file.write(head, 2) == 2 &&
+              file.write((const uint8_t*)messageId.c_str(), messageId.length()) == messageId.length();
+    file.close();
+    return ok;
+}
+
+// True if a DONE for messageId comes after position in the journal.
+// Caller holds the mutex.
+bool ChatOutbox::doneLater(const String& messageId, uint32_t position) {
+    File file = openJournal("r");
+    bool done = false;
+    if (file && file.seek(position)) {
+        uint8_t kind;
+        String id;
+        int32_t from;
+        int32_t to;
+        while (!done && file.available() > 0 && readRecord(file, kind, id, from, to, nullptr)) {
+            done = kind == KIND_DONE && id == messageId;
+        }
+    }
+    if (file) {
+        file.close();
+    }
+    return done;
+}
+
+// An entry left RAM for good (its DONE appended if the journal stays).
+// Caller holds the mutex.
+void ChatOutbox::removed() {
+    if (spilled > 0) {
+        // Rewrite without DONEs so the replay keeps journal order, then pull
+        // the oldest spilled message into the free slot
+        if (compact(true)) {
+            replay();
+        }
+    } else if (count == 0) {
+        SPIFFS.remove(FILE_NAME);  // Nothing owed: start the next journal empty
+        if (renamePending) {
+            SPIFFS.remove(COMPACT_FILE_NAME);
+            renamePending = false;
+        }
+    } else {
+        compact(false);
+    }
+}
+
+ChatOutbox::AckResult ChatOutbox::acknowledge(const String& messageId) {
+    if (mutex == NULL || xSemaphoreTake(mutex, portMAX_DELAY) != pdTRUE) {
+        return ACK_UNKNOWN;
+    }
+
+    uint32_t hash = hashId(messageId);
+    int index = find(messageId);
+    if (index < 0) {
+        AckResult result = ACK_UNKNOWN;
+        for (int i = 0; i < RECENT_ACKS; i++) {
+            if (recentAcks[i] == hash) {
+                result = ACK_DUPLICATE;
+                stats.duplicateAcks++;
+                break;
+            }
+        }
+        xSemaphoreGive(mutex);
+        return result;
+    }
+
+    removeAt(index);
+    recentAcks[recentAckNext] = hash;
+    recentAckNext = (recentAckNext + 1) % RECENT_ACKS;
+    stats.delivered++;
+    if (count > 0 || spilled > 0) {
+        appendDone(messageId);
+    }
+    removed();
+
+    xSemaphoreGive(mutex);
+    return ACK_DELIVERED;
+}
+
+void ChatOutbox::reject(const String& messageId, bool permanent, unsigned long now, unsigned long retryAfterMs) {
+    if (mutex == NULL || xSemaphoreTake(mutex, portMAX_DELAY) != pdTRUE) {
+        return;
+    }
+
+    int index = find(messageId);
+    if (index >= 0) {
+        if (permanent) {
+            removeAt(index);
+            stats.rejected++;
+            if (count > 0 || spilled > 0) {
+                appendDone(messageId);
+            }
+            removed();
+        } else {
+            entries[index].nextAttemptAt = now + (retryAfterMs > 0 ? retryAfterMs : retryDelay(entries[index].attempts));
+        }
+    }
+
+    xSemaphoreGive(mutex);
+}
+
+void ChatOutbox::resetTimers() {
+    if (mutex == NULL || xSemaphoreTake(mutex, portMAX_DELAY) != pdTRUE) {
+        return;
+    }
+    for (int i = 0; i < count; i++) {
+        entries[i].attempts = 0;
+        entries[i].nextAttemptAt = 0;
+    }
+    xSemaphoreGive(mutex);
+}
+
+String ChatOutbox::newMessageId() {
+    bool locked = mutex != NULL && xSemaphoreTake(mutex, portMAX_DELAY) == pdTRUE;
+    // Drawn on first use, when Wi-Fi is up: esp_random() needs the radio on
+    // to be truly random. 32 bits keep two boots from sharing a prefix.
+    while (idNonce == 0) {
+        idNonce = esp_random();
+    }
+    idCounter++;
+    char id[20];
+    snprintf(id, sizeof(id), "%08lx-%06lx", (unsigned long)idNonce, (unsigned long)idCounter);
+    if (locked) {
+        xSemaphoreGive(mutex);
+    }
+    return String(id);
+}
+
+// Rewrite the journal with only the pending records (force = even if small).
+// With a spill that is every QUEUED record without a later DONE, in journal
+// order; otherwise just the entries in RAM. False if the rewrite failed (the
+// old journal stays). Caller holds the mutex.
+bool ChatOutbox::compact(bool force) {
+    File in = openJournal("r");
+    if (!in) {
+        return false;
+    }
+    if (!force && in.size() < COMPACT_SIZE) {
+        in.close();
+        return true;
+    }
+
+    File out = SPIFFS.open(COMPACT_FILE_NAME, "w");
+    uint32_t newOffsets[MAX_PENDING];
+    bool ok = out && writeHeader(out);
+    uint8_t kind;
+    String messageId;
+    String text;
+    int32_t from;
+    int32_t to;
+    if (spilled == 0) {
+        for (int i = 0; i < count && ok; i++) {
+            newOffsets[i] = out.size();
+            ok = in.seek(entries[i].offset) && readRecord(in, kind, messageId, from, to, &text) &&
+                 writeQueued(out, from, to, messageId, text);
+        }
+    } else {
+        int copied = 0;
+        ok = ok && in.seek(FILE_HEADER_SIZE);
+        while (ok && in.available() > 0) {
+            uint32_t offset = in.position();
+            if (!readRecord(in, kind, messageId, from, to, &text)) {
+                break;  // Torn tail
+            }
+            if (kind == KIND_DONE) {
+                continue;
+            }
+            int index = -1;
+            for (int i = 0; i < count; i++) {
+                if (entries[i].offset == offset) {
+                    index = i;
+                    break;
+                }
+            }
+            if (index < 0 && doneLater(messageId, in.position())) {
+                continue;  // Delivered earlier
+            }
+            if (index >= 0) {
+                newOffsets[index] = out.size();
+                copied++;
+            }
+            ok = writeQueued(out, from, to, messageId, text);
+        }
+        ok = ok && copied == count;
+    }
+    in.close();
+    if (out) {
+        out.close();
+    }
+
+    if (!ok) {
+        SPIFFS.remove(COMPACT_FILE_NAME);
+        return false;
+    }
+    // A reset between these two is finished by load() (copy, no journal);
+    // a failed rename by the next openJournal()
+    SPIFFS.remove(FILE_NAME);
+    renamePending = !SPIFFS.rename(COMPACT_FILE_NAME, FILE_NAME);
+    if (renamePending) {
+        Serial.println("Chat Outbox: ⚠️  Rename failed - messages kept in the compact copy");
+    }
+    for (int i = 0; i < count; i++) {
+        entries[i].offset = newOffsets[i];
+    }
+    return true;
+}
+
+void ChatOutbox::printStats() const {
+    Serial.print("Chat Outbox: pending=");
+    Serial.print(count);
+    Serial.print(", spilled=");
+    Serial.print(spilled);
+    Serial.print(", queued=");
+    Serial.print(stats.queued);
+    Serial.print(", sent=");
+    Serial.print(stats.sent);
+    Serial.print(", delivered=");
+    Serial.print(stats.delivered);
+    Serial.print(", rejected=");
+    Serial.print(stats.rejected);
+    Serial.print(", duplicateAcks=");
+    Serial.println(stats.duplicateAcks);
+}
@@ -0,0 +1,137 @@
+#ifndef CHAT_OUTBOX_H
+#define CHAT_OUTBOX_H
+
+#include <Arduino.h>
+#include <FS.h>
+#include <SPIFFS.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/semphr.h>
+
+// Outgoing chat messages that the server hasn't confirmed yet, persisted on
+// SPIFFS so a disconnect (or a reboot) doesn't lose them.
+//
+// File: "/chat_outbox.log" (append-only journal)
+//   [file header]  magic "COB1" (4 bytes) + version (1) + reserved (3)
+//   [record]*      kind (u8) + idLength (u8) + id bytes, then for KIND_QUEUED:
+//                  fromUserId (i32 LE) + toUserId (i32 LE) + textLength (u16 LE) + text bytes
+//
+// A message is QUEUED when the user sends it and DONE when the server answers
+// with message_delivered (or a chat_error that retrying can't fix). On boot
+// the journal is replayed; whatever is QUEUED without a DONE is still owed.
+// The file is deleted once nothing is pending and rewritten when it grows
+// past COMPACT_SIZE. Only id hash, recipient and file offset stay in RAM -
+// the text is read back from flash when the message is (re)sent, the id when
+// a hash matches.
+//
+// Compaction writes "/chat_outbox.tmp", removes the journal and renames the
+// copy. load() finishes a cut-short one: a copy without a journal is adopted,
+// a copy next to the journal is unfinished and removed.
+//
+// Spill: a journal can hold more than MAX_PENDING owed messages (a DONE that
+// failed to write, an older build with a bigger outbox). The oldest
+// MAX_PENDING go to RAM and the rest stay on flash: nothing is compacted
+// away, enqueue() refuses new messages so they can't overtake the spilled
+// ones, and every delivery rewrites the journal and pulls the next one in.
+//
+// Delivery: SocketManager calls nextDue() every socket tick while connected.
+// Messages go out oldest first; a message waiting on its retry timer holds
+// back later messages to the same friend so they arrive in order. A message
+// without an answer is re-sent after RETRY_BASE_MS, doubling up to
+// RETRY_MAX_MS. The server remembers recent message_ids per sender and
+// answers a repeat with message_delivered instead of forwarding it again, so
+// retries can't show a message twice.
+class ChatOutbox {
+public:
+    static const uint32_t MAGIC = 0x31424F43;        // "COB1" little-endian
+    static const uint8_t VERSION = 1;
+    static const size_t FILE_HEADER_SIZE = 8;
+    static const uint8_t KIND_QUEUED = 1;
+    static const uint8_t KIND_DONE = 2;
+    static const int MAX_PENDING = 32;
+    static const int RECENT_ACKS = MAX_PENDING;       // Delivered ids remembered for duplicate acks
+    static const size_t MAX_ID_LENGTH = 48;
+    static const size_t COMPACT_SIZE = 16384;
+    static const unsigned long RETRY_BASE_MS = 2000;
+    static const unsigned long RETRY_MAX_MS = 60000;
+    static const char* FILE_NAME;
+
+    struct Stats {
+        uint32_t queued;
+        uint32_t sent;        // Send attempts, including retries
+        uint32_t delivered;
+        uint32_t rejected;    // chat_error that retrying can't fix
+        uint32_t duplicateAcks;
+    };
+
+    enum AckResult {
+        ACK_DELIVERED,    // Was pending, now done
+        ACK_DUPLICATE,    // Delivered a moment ago - a retry the server answered again
+        ACK_UNKNOWN       // Never queued here (sent best effort, or from before a reboot)
+    };
+
+    ChatOutbox();
+    ~ChatOutbox();
+
+    // Replay the journal (SPIFFS must be mounted). Returns pending count.
+    int load();
+
+    // Persist a new message. False if the outbox is full or flash write failed.
+    bool enqueue(int fromUserId, int toUserId, const String& messageId, const String& text);
+
+    // Oldest message from fromUserId that is due at now. Fills the outputs,
+    // arms its retry timer and returns true; false if nothing is due.
+    bool nextDue(int fromUserId, unsigned long now, int& toUserId, String& messageId, String& text);
+
+    // message_delivered for messageId
+    AckResult acknowledge(const String& messageId);
+
+    // chat_error for messageId: permanent errors drop it, others retry after
+    // retryAfterMs (0 = the usual backoff)
+    void reject(const String& messageId, bool permanent, unsigned long now, unsigned long retryAfterMs = 0);
+
+    // New connection: everything pending is due again (oldest first)
+    void resetTimers();
+
+    // message_id that no other message from this device has used, across
+    // reboots too: "<boot nonce>-<counter>" in hex
+    String newMessageId();
+
+    int getPendingCount() const { return count + spilled; }  // Spilled ones included
+    const Stats& getStats() const { return stats; }
+    void printStats() const;
+
+private:
+    struct Entry {
+        uint32_t idHash;
+        uint32_t offset;          // Record start in the journal
+        int32_t fromUserId;
+        int32_t toUserId;
+        uint8_t attempts;
+        unsigned long nextAttemptAt;
+    };
+
+    Entry entries[MAX_PENDING];   // Oldest first
+    int count;
+    int spilled;                  // Owed messages left on flash (RAM full)
+    uint32_t recentAcks[RECENT_ACKS];
+    int recentAckNext;
+    uint32_t idNonce;
+    uint32_t idCounter;
+    bool renamePending;           // compact() removed the journal, rename failed
+    SemaphoreHandle_t mutex;
+    Stats stats;
+
+    int find(const String& messageId);
+    bool idAt(uint32_t offset, String& messageId);
+    File openJournal(const char* mode);
+    void removeAt(int index);
+    void removed();
+    bool appendDone(const String& messageId);
+    bool readRecord(File& file, uint8_t& kind, String& messageId, int32_t& fromUserId, int32_t& toUserId, String* text);
+    bool replay();
+    bool doneLater(const String& messageId, uint32_t position);
+    bool compact(bool force);
+    static unsigned long retryDelay(uint8_t attempts);
+};
+
+#endif
@@ -2,7 +2,10 @@
 #include <Adafruit_GFX.h>
 #include <Adafruit_ST7789.h>
 #include "chat_screen.h"
+#include "tft_compositor.h"
+#include "profiler.h"
 #include "socket_manager.h"
+#include "chat_log.h"
 #include <FS.h>
 #include <SPIFFS.h>
 
@@ -76,7 +79,6 @@ ChatScreen::ChatScreen(Adafruit_ST7789* tft, Keyboard* keyboard) {
     this->confirmationDialog = new ConfirmationDialog(tft);
     
     // Khởi tạo tin nhắn
-    this->messageCount = 0;
     this->scrollOffset = 0;
     
     // Khởi tạo lazy loading tracking
@@ -84,16 +86,13 @@ ChatScreen::ChatScreen(Adafruit_ST7789* tft, Keyboard* keyboard) {
     this->totalMessagesInFile = 0;
     this->hasMoreMessages = false;
     this->fileReadPosition = 0;
+    this->fileNewestPosition = 0;
     
     // Khởi tạo loading state flags
     this->isLoadingMessages = false;
     this->lastLoadTime = 0;
     this->showLoadingIndicator = false;
     
-    // Khởi tạo file position cache
-    this->fileLinePositions = nullptr;
-    this->cachedLineCount = 0;
-    this->positionCacheValid = false;
     this->currentMessage = "";
     this->inputCursorPos = 0;
     this->keyboardVisible = false;  // Bàn phím ẩn mặc định
@@ -168,11 +167,6 @@ ChatScreen::ChatScreen(Adafruit_ST7789* tft, Keyboard* keyboard) {
 }
 
 ChatScreen::~ChatScreen() {
-    // Giải phóng file position cache
-    if (fileLinePositions != nullptr) {
-        delete[] fileLinePositions;
-        fileLinePositions = nullptr;
-    }
 }
 
 void ChatScreen::drawTitle() {
@@ -371,11 +365,12 @@ int ChatScreen::calculateTotalLines() const {
     int totalLines = 0;
     const int charsPerLine = 20;
     
+    int messageCount = messages.count();
     for (int i = 0; i < messageCount; i++) {
-        if (i > 0 && messages[i].isUser != messages[i - 1].isUser) {
+        if (i > 0 && messages.isUser(i) != messages.isUser(i - 1)) {
             totalLines += 1;  // Thêm 1 dòng spacing giữa hai người gửi
         }
-        int messageLength = messages[i].text.length();
+        int messageLength = messages.getLength(i);
         int numLines = (messageLength + charsPerLine - 1) / charsPerLine;
         totalLines += numLines;
     }
@@ -494,11 +489,12 @@ void ChatScreen::drawScrollbar() {
     // Tính tổng số dòng và vị trí scroll
     int totalLines = 0;
     int charsPerLine = 20;
+    int messageCount = messages.count();
     for (int i = 0; i < messageCount; i++) {
-        if (i > 0 && messages[i].isUser != messages[i-1].isUser) {
+        if (i > 0 && messages.isUser(i) != messages.isUser(i - 1)) {
             totalLines += 1;  // Spacing
         }
-        int messageLength = messages[i].text.length();
+        int messageLength = messages.getLength(i);
         int numLines = (messageLength + charsPerLine - 1) / charsPerLine;
         totalLines += numLines;
     }
@@ -574,18 +570,19 @@ void ChatScreen::drawMessages() {
     int totalLines = 0;
     int charsPerLine = 20;
     // Lưu số dòng của mỗi tin nhắn và spacing
-    int lineCounts[50];  // MAX_MESSAGES = 50
-    bool hasSpacing[50]; // MAX_MESSAGES = 50
+    int lineCounts[MAX_MESSAGES];
+    bool hasSpacing[MAX_MESSAGES];
+    int messageCount = messages.count();
     
     for (int i = 0; i < messageCount; i++) {
         // Kiểm tra có spacing trước tin nhắn này không
-        hasSpacing[i] = (i > 0 && messages[i].isUser != messages[i-1].isUser);
+        hasSpacing[i] = (i > 0 && messages.isUser(i) != messages.isUser(i - 1));
         if (hasSpacing[i]) {
             totalLines += 1;  // Thêm 1 dòng spacing
         }
         
         // Tính số dòng của tin nhắn này
-        int messageLength = messages[i].text.length();
+        int messageLength = messages.getLength(i);
         int numLines = (messageLength + charsPerLine - 1) / charsPerLine;
         lineCounts[i] = numLines;
         totalLines += numLines;
@@ -599,22 +596,25 @@ void ChatScreen::drawMessages() {
     // Loại bỏ điều kiện lineIndex < maxLines để lấp đầy toàn bộ khoảng trống (fit here).
     for (int i = messageCount - 1; i >= 0; i--) {
         if (i >= 0 && i < messageCount) {
-            uint16_t msgColor = messages[i].isUser ? userMessageColor : otherMessageColor;
+            bool isUserMessage = messages.isUser(i);
+            uint16_t msgColor = isUserMessage ? userMessageColor : otherMessageColor;
             tft->setTextColor(msgColor, chatAreaBgColor);
             tft->setTextSize(2);  // Cỡ chữ tầm trung (size 2)
             
-            String messageText = messages[i].text;
+            // Đọc trực tiếp từ arena (không copy ra String)
+            const char* messageText = messages.getText(i);
             uint16_t margin = 10;  // Margin từ cạnh màn hình
             
             // Chia tin nhắn thành các dòng 20 ký tự
-            int messageLength = messageText.length();
+            int messageLength = messages.getLength(i);
             int numLines = lineCounts[i];  // Sử dụng số dòng đã tính
             
             // Vẽ từng dòng của tin nhắn TỪ DƯỚI LÊN (dòng cuối trước, dòng đầu sau)
             for (int line = numLines - 1; line >= 0; line--) {
                 int startChar = line * charsPerLine;
                 int endChar = (startChar + charsPerLine < messageLength) ? (startChar + charsPerLine) : messageLength;
-                String lineText = messageText.substring(startChar, endChar);
+                const char* lineText = messageText + startChar;
+                int lineLength = endChar - startChar;
                 
                 // Tính vị trí Y: ĐI LÊN từ bottomY.
                 // Cộng (groupTransitions * gapReduction) để GIẢM khoảng trống (vì ta đang trừ lineHeight)
@@ -626,8 +626,8 @@ void ChatScreen::drawMessages() {
                 
                 // Tính vị trí X: user căn phải, other căn trái
                 uint16_t textX;
-                uint16_t approxWidth = lineText.length() * 12;  // ước lượng
-                if (messages[i].isUser) {
+                uint16_t approxWidth = lineLength * 12;  // ước lượng
+                if (isUserMessage) {
                     // Tin nhắn của user: căn phải
                     textX = chatAreaWidth - approxWidth - margin;
                 } else {
@@ -637,25 +637,25 @@ void ChatScreen::drawMessages() {
                 
                 // Vẽ bubble background nếu bật decor (chỉ cho dòng cuối của mỗi tin nhắn)
                 if (showMessageBubbles && line == numLines - 1) {
-                    int bubbleWidth = lineText.length() * 12 + 10;
+                    int bubbleWidth = lineLength * 12 + 10;
                     int bubbleHeight = lineHeight;
-                    int bubbleX = messages[i].isUser ? (textX - 5) : (textX - 5);
+                    int bubbleX = textX - 5;
                     int bubbleY = yPos - 2;
-                    drawMessageBubble(bubbleX, bubbleY, bubbleWidth, bubbleHeight, msgColor, messages[i].isUser);
+                    drawMessageBubble(bubbleX, bubbleY, bubbleWidth, bubbleHeight, msgColor, isUserMessage);
                 }
                 
                 // Vẽ dòng này
                 tft->setTextColor(msgColor, chatAreaBgColor);
                 tft->setTextSize(2);
                 uint16_t cursorX = textX;
-                for (uint16_t cIndex = 0; cIndex < lineText.length(); cIndex++) {
-                    char c = lineText.charAt(cIndex);
+                for (int cIndex = 0; cIndex < lineLength; cIndex++) {
+                    char c = lineText[cIndex];
                     if (c >= Keyboard::ICON_SMILE && c <= Keyboard::ICON_WINK) {
                         drawIconInline(cursorX, yPos, 12, msgColor, chatAreaBgColor, c);
                         cursorX += 12;
                     } else {
                         tft->setCursor(cursorX, yPos);
-                        tft->print(String(c));
+                        tft->print(c);
                         cursorX += 12;
                     }
                 }
@@ -664,7 +664,7 @@ void ChatScreen::drawMessages() {
             }
             
             // Thêm spacing giữa các nhóm người gửi khác nhau (khi vẽ ngược)
-            if (i > 0 && messages[i].isUser != messages[i-1].isUser) {
+            if (i > 0 && isUserMessage != messages.isUser(i - 1)) {
                 groupTransitions++;
                 lineIndex++;
             }
@@ -932,6 +932,8 @@ void ChatScreen::forceRedraw() {
 }
 
 void ChatScreen::draw() {
+    Profiler::Scope profile("ChatScreen.draw");
+    TftCompositor::Frame frame("ChatScreen");
     // Chỉ vẽ lại khi cần thiết (optimization để tránh vẽ liên tục)
     if (!needsRedraw) return;
     
@@ -1065,6 +1067,7 @@ void ChatScreen::handleKeyPress(String key) {
             return;
         }
         // Otherwise exit chat screen
+        notifyTyping(false);
         if (onExitCallback != nullptr) {
             onExitCallback();
         }
@@ -1121,6 +1124,7 @@ void ChatScreen::handleKeyPress(String key) {
             inputCursorPos--;
             needsInputRedraw = true;
             drawCurrentMessage();
+            notifyTyping(currentMessage.length() > 0);
         }
     } else if (key == " ") {
         // Space - thêm dấu cách
@@ -1129,6 +1133,7 @@ void ChatScreen::handleKeyPress(String key) {
             inputCursorPos++;
             needsInputRedraw = true;
             drawCurrentMessage();
+            notifyTyping(true);
         }
     } else if (key != "123" && key != "ABC" && key != Keyboard::KEY_ICON && key != "shift") {
         // Thêm ký tự thông thường
@@ -1137,31 +1142,57 @@ void ChatScreen::handleKeyPress(String key) {
             inputCursorPos += key.length();
             needsInputRedraw = true;
             drawCurrentMessage();
+            notifyTyping(true);
         }
     }
 }
 
+void ChatScreen::notifyTyping(bool typing) {
+    if (socketManager == nullptr || friendUserId <= 0) {
+        return;
+    }
+    if (typing) {
+        socketManager->sendTypingStart(friendUserId);
+    } else {
+        socketManager->sendTypingStop(friendUserId);
+    }
+}
+
 void ChatScreen::addMessage(String text, bool isUser, bool persist) {
-    if (messageCount >= MAX_MESSAGES) {
-        // Dịch chuyển mảng, xóa tin nhắn cũ nhất
-        for (int i = 0; i < MAX_MESSAGES - 1; i++) {
-            messages[i] = messages[i + 1];
-        }
-        messageCount = MAX_MESSAGES - 1;
+    // Cửa sổ đang ở đoạn lịch sử cũ (tin mới hơn đã bị đẩy ra khi cuộn lên):
+    // nhảy về cuối để tin nhắn mới không nằm sau một khoảng trống
+    if (fileNewestPosition < totalMessagesInFile) {
+        messages.clear();
+        loadedMessageCount = 0;
+        fileReadPosition = totalMessagesInFile;
+        fileNewestPosition = totalMessagesInFile;
+        hasMoreMessages = (fileReadPosition > 0);
     }
     
-    messages[messageCount].text = text;
-    messages[messageCount].isUser = isUser;
-    messages[messageCount].timestamp = millis();
-    messageCount++;
+    // Ring buffer: tin nhắn cũ nhất tự bị đẩy ra khi đầy (O(1), không dịch mảng)
+    uint32_t timestamp = millis();
+    int countBefore = messages.count();
+    messages.pushNewest(text.c_str(), text.length(), isUser, timestamp);
+    
+    // Tin nhắn bị đẩy ra vẫn nằm trong file -> có thể load lại khi scroll lên
+    int evicted = countBefore + 1 - messages.count();
+    if (evicted > 0) {
+        loadedMessageCount -= evicted;
+        fileReadPosition += evicted;
+        hasMoreMessages = true;
+    }
     
     // Tự động cuộn xuống tin nhắn mới nhất
     scrollToLatest();
     
     // Lưu tin nhắn vào file (optional)
     if (persist) {
-        saveMessagesToFile();
+        appendMessageToFile(text, isUser, timestamp);
+    } else if (ownerUserId > 0 && friendUserId > 0) {
+        // Already appended by the caller (SocketManager saves incoming messages)
+        totalMessagesInFile = ChatLog::getMessageCount(ownerUserId, friendUserId);
     }
+    fileNewestPosition = totalMessagesInFile;
     
     // Đánh dấu cần vẽ lại messages
     needsMessagesRedraw = true;
@@ -1199,6 +1230,7 @@ void ChatScreen::sendMessage() {
         if (socketManager != nullptr && friendUserId > 0) {
             Serial.print("Chat: Sending message via socket to user ");
             Serial.println(friendUserId);
+            socketManager->sendTypingStop(friendUserId);  // Goes out ahead of the message, same frame
             socketManager->sendChatMessage(friendUserId, currentMessage);
         } else {
             Serial.println("Chat: ⚠️  Cannot send message - socketManager or friendUserId not set");
@@ -1285,6 +1317,23 @@ void ChatScreen::handleDown() {
         return;
     }
     
+    // Gần cuối cửa sổ nhưng tin nhắn mới hơn đã bị đẩy ra khi cuộn lên: load lại
+    const int PREFETCH_THRESHOLD = 5;
+    const unsigned long LOAD_DEBOUNCE_MS = 200;
+    if (scrollOffset <= PREFETCH_THRESHOLD &&
+        fileNewestPosition < totalMessagesInFile &&
+        !isLoadingMessages &&
+        (millis() - lastLoadTime) > LOAD_DEBOUNCE_MS) {
+        isLoadingMessages = true;
+        showLoadingIndicator = true;
+        lastLoadTime = millis();
+        
+        loadNewerMessages(2);
+        
+        isLoadingMessages = false;
+        showLoadingIndicator = false;
+    }
+    
     // Cuộn xuống (xem tin nhắn mới hơn) - scroll theo từng dòng
     if (scrollOffset > 0) {
         scrollOffset--;  // Giảm 1 dòng
@@ -1347,7 +1396,7 @@ void ChatScreen::handleSelect() {
 }
 
 void ChatScreen::clearMessages() {
-    messageCount = 0;
+    messages.clear();
     scrollOffset = 0;
     
     // Reset lazy loading state
@@ -1355,16 +1404,13 @@ void ChatScreen::clearMessages() {
     totalMessagesInFile = 0;
     hasMoreMessages = false;
     fileReadPosition = 0;
-    
-    // Invalidate position cache
-    invalidatePositionCache();
+    fileNewestPosition = 0;
     
     // Xóa file lịch sử
-    String fileName = getChatHistoryFileName();
-    if (SPIFFS.exists(fileName)) {
-        SPIFFS.remove(fileName);
+    if (ownerUserId > 0 && friendUserId > 0) {
+        ChatLog::remove(ownerUserId, friendUserId);
         Serial.print("Chat: Cleared chat history file: ");
-        Serial.println(fileName);
+        Serial.println(getChatHistoryFileName());
     }
     
     needsMessagesRedraw = true;
@@ -1373,29 +1419,16 @@ void ChatScreen::clearMessages() {
 
 String ChatScreen::getChatHistoryFileName() {
     // Tạo tên file từ user IDs
-    // Format: "/<min_user_id>-<max_user_id>.txt"
-    // Ví dụ: user 1 chat với user 5 → "/1-5.txt"
-    //        user 5 chat với user 1 → "/1-5.txt" (cùng file)
+    // Format: "/<min_user_id>-<max_user_id>.log" (xem ChatLog)
+    // Ví dụ: user 1 chat với user 5 → "/1-5.log"
+    //        user 5 chat với user 1 → "/1-5.log" (cùng file)
     
     if (ownerUserId <= 0 || friendUserId <= 0) {
         Serial.println("Chat: ⚠️  Invalid user IDs for file name generation");
-        return "/invalid.txt";
+        return "/invalid.log";
     }
     
-    // Đảm bảo tên file nhất quán: luôn dùng min-max
-    int minId = (ownerUserId < friendUserId) ? ownerUserId : friendUserId;
-    int maxId = (ownerUserId > friendUserId) ? ownerUserId : friendUserId;
-    
-    String fileName = "/";
-    fileName += String(minId);
-    fileName += "-";
-    fileName += String(maxId);
-    fileName += ".txt";
-    
-    Serial.print("Chat: Generated file name: ");
-    Serial.println(fileName);
-    
-    return fileName;
+    return ChatLog::getFileName(ownerUserId, friendUserId);
 }
 
 // Static callback wrappers for ConfirmationDialog
@@ -1431,271 +1464,138 @@ void ChatScreen::onUnfriendCancel() {
     Serial.println("Chat: Unfriend cancelled");
 }
 
-// Helper: Calculate total lines for a set of messages
-int ChatScreen::calculateLinesForMessages(const ChatMessage* msgs, int msgCount) const {
-    int totalLines = 0;
-    const int charsPerLine = 20;
-    
-    for (int i = 0; i < msgCount; i++) {
-        if (i > 0 && msgs[i].isUser != msgs[i-1].isUser) {
-            totalLines += 1;  // Spacing between different senders
-        }
-        int messageLength = msgs[i].text.length();
-        int numLines = (messageLength + charsPerLine - 1) / charsPerLine;
-        totalLines += numLines;
+// Helper: Read messages [startIndex, startIndex + count) from file into the store.
+// Records are prepended newest-first, so text goes straight from SPIFFS into the
+// arena without a temporary copy. When the window is full the newest messages
+// are evicted (fileNewestPosition moves back) so older history stays reachable.
+int ChatScreen::prependMessagesFromFile(File& file, int startIndex, int count) {
+    if (startIndex < 0 || count <= 0 || startIndex >= totalMessagesInFile) {
+        return 0;
     }
     
-    return totalLines;
-}
-
-// Helper: Invalidate position cache
-void ChatScreen::invalidatePositionCache() {
-    positionCacheValid = false;
-    if (fileLinePositions != nullptr) {
-        delete[] fileLinePositions;
-        fileLinePositions = nullptr;
-        cachedLineCount = 0;
-    }
-}
-
-// Helper: Build file position cache for efficient seeking
-void ChatScreen::buildFilePositionCache() {
-    String fileName = getChatHistoryFileName();
-    if (!SPIFFS.exists(fileName)) {
-        invalidatePositionCache();
-        return;
+    if (startIndex + count > totalMessagesInFile) {
+        count = totalMessagesInFile - startIndex;
     }
-    
-    File file = SPIFFS.open(fileName, "r");
-    if (!file) {
-        invalidatePositionCache();
-        return;
+    // Keep the newest end of the range (reading goes backwards from it)
+    const int MAX_BATCH = 16;
+    if (count > MAX_BATCH) {
+        startIndex += count - MAX_BATCH;
+        count = MAX_BATCH;
     }
     
-    // Free old cache
-    if (fileLinePositions != nullptr) {
-        delete[] fileLinePositions;
+    // One index read for the whole batch
+    uint32_t offsets[MAX_BATCH];
+    int offsetCount = ChatLog::getRecordOffsets(ownerUserId, friendUserId, startIndex, count, offsets);
+    if (offsetCount < count) {
+        Serial.println("Chat: Warning - message index lookup failed");
+        return 0;
     }
     
-    // Allocate cache for max messages
-    fileLinePositions = new size_t[totalMessagesInFile + 1];  // +1 for count line
-    cachedLineCount = 0;
-    
-    // Read first line (count) - cache its position
-    fileLinePositions[0] = 0;  // Start of file
-    String countLine = file.readStringUntil('\n');
-    cachedLineCount = 1;
-    
-    // Read each message line and cache its position
-    size_t currentPos = file.position();
-    int messageIndex = 0;
-    while (file.available() && messageIndex < totalMessagesInFile) {
-        fileLinePositions[cachedLineCount] = currentPos;
-        String line = file.readStringUntil('\n');
-        currentPos = file.position();
-        if (line.length() > 0) {
-            cachedLineCount++;
-            messageIndex++;
+    int prepended = 0;
+    for (int i = count - 1; i >= 0; i--) {
+        uint16_t length;
+        bool isUser;
+        uint32_t timestamp;
+        if (!file.seek(offsets[i]) || !ChatLog::readRecordHeader(file, length, isUser, timestamp)) {
+            break;
         }
-    }
-    
-    file.close();
-    positionCacheValid = true;
-    
-    Serial.print("Chat: Built position cache for ");
-    Serial.print(cachedLineCount - 1);  // -1 for count line
-    Serial.println(" messages");
-}
-
-// Helper: Read message at specific line using cache
-ChatMessage ChatScreen::readMessageAtLine(File& file, int lineIndex) {
-    ChatMessage msg;
-    msg.text = "";
-    msg.isUser = false;
-    msg.timestamp = 0;
-    
-    if (lineIndex < 0 || lineIndex >= cachedLineCount - 1) {
-        return msg;  // Invalid index
-    }
-    
-    // Seek to line position (lineIndex + 1 because line 0 is count)
-    if (positionCacheValid && fileLinePositions != nullptr) {
-        file.seek(fileLinePositions[lineIndex + 1]);
-    }
-    
-    String line = file.readStringUntil('\n');
-    line.trim();
-    
-    if (line.length() == 0) {
-        return msg;
-    }
-    
-    // Parse: isUser|text|timestamp
-    int pipe1 = line.indexOf('|');
-    int pipe2 = line.indexOf('|', pipe1 + 1);
-    
-    if (pipe1 > 0 && pipe2 > pipe1) {
-        String isUserStr = line.substring(0, pipe1);
-        String text = line.substring(pipe1 + 1, pipe2);
-        String timestampStr = line.substring(pipe2 + 1);
-        
-        msg.isUser = (isUserStr == "1");
-        msg.text = text;
-        msg.timestamp = timestampStr.toInt();
-    }
-    
-    return msg;
-}
-
-// Helper: Read last N messages efficiently (Facebook-style)
-void ChatScreen::readLastNMessages(File& file, int n, ChatMessage* output, int& outputCount) {
-    outputCount = 0;
-    
-    if (n <= 0 || totalMessagesInFile == 0) {
-        return;
-    }
-    
-    int messagesToRead = (n > totalMessagesInFile) ? totalMessagesInFile : n;
-    int startLineIndex = totalMessagesInFile - messagesToRead;
-    
-    // Cache should be built before calling this function
-    if (!positionCacheValid || fileLinePositions == nullptr) {
-        Serial.println("Chat: Warning - position cache not valid, falling back to sequential read");
-        // Fallback: sequential read from end
-        // Skip count line
-        file.seek(0);
-        file.readStringUntil('\n');
-        
-        // Read all lines to find last N
-        String* tempLines = new String[totalMessagesInFile];
-        int tempCount = 0;
-        while (file.available() && tempCount < totalMessagesInFile) {
-            String line = file.readStringUntil('\n');
-            line.trim();
-            if (line.length() > 0) {
-                tempLines[tempCount] = line;
-                tempCount++;
-            }
+        char* text = messages.pushOldest(length, isUser, timestamp);
+        // Window full: drop the newest message (still in the file, reloaded on
+        // scroll-down) - never one from this batch
+        while (text == nullptr && messages.count() > prepended) {
+            messages.popNewest();
+            loadedMessageCount--;
+            fileNewestPosition--;
+            text = messages.pushOldest(length, isUser, timestamp);
         }
-        
-        // Parse last N messages
-        int startIdx = (tempCount > messagesToRead) ? (tempCount - messagesToRead) : 0;
-        for (int i = startIdx; i < tempCount && outputCount < messagesToRead; i++) {
-            String line = tempLines[i];
-            int pipe1 = line.indexOf('|');
-            int pipe2 = line.indexOf('|', pipe1 + 1);
-            if (pipe1 > 0 && pipe2 > pipe1) {
-                output[outputCount].isUser = (line.substring(0, pipe1) == "1");
-                output[outputCount].text = line.substring(pipe1 + 1, pipe2);
-                output[outputCount].timestamp = line.substring(pipe2 + 1).toInt();
-                outputCount++;
-            }
+        if (text == nullptr) {
+            break;
         }
-        
-        delete[] tempLines;
-        return;
-    }
-    
-    // Read messages using cache
-    for (int i = startLineIndex; i < totalMessagesInFile && outputCount < messagesToRead; i++) {
-        ChatMessage msg = readMessageAtLine(file, i);
-        if (msg.text.length() > 0) {
-            output[outputCount] = msg;
-            outputCount++;
+        if (file.read((uint8_t*)text, length) != length) {
+            messages.popOldest();  // Torn record
+            break;
         }
+        prepended++;
     }
+    return prepended;
 }
 
-// Helper: Read messages from specific position
-void ChatScreen::readMessagesFromPosition(File& file, int startIndex, int count, ChatMessage* output, int& outputCount) {
-    outputCount = 0;
-    
+// Helper: Read messages [startIndex, startIndex + count) from file to the newest
+// end of the store (scroll-down after newer messages were evicted). pushNewest
+// evicts the oldest messages as needed, fileReadPosition follows.
+int ChatScreen::appendMessagesFromFile(File& file, int startIndex, int count) {
     if (startIndex < 0 || count <= 0 || startIndex >= totalMessagesInFile) {
-        return;
+        return 0;
     }
     
-    int messagesToRead = count;
-    if (startIndex + messagesToRead > totalMessagesInFile) {
-        messagesToRead = totalMessagesInFile - startIndex;
+    if (startIndex + count > totalMessagesInFile) {
+        count = totalMessagesInFile - startIndex;
+    }
+    const int MAX_BATCH = 16;
+    if (count > MAX_BATCH) {
+        count = MAX_BATCH;
     }
     
-    // Cache should be built before calling this function
-    if (!positionCacheValid || fileLinePositions == nullptr) {
-        Serial.println("Chat: Warning - position cache not valid, falling back to sequential read");
-        // Fallback: sequential read
-        file.seek(0);
-        file.readStringUntil('\n');  // Skip count line
-        
-        // Skip to startIndex
-        for (int i = 0; i < startIndex; i++) {
-            file.readStringUntil('\n');
-        }
-        
-        // Read messages
-        for (int i = 0; i < messagesToRead && file.available(); i++) {
-            String line = file.readStringUntil('\n');
-            line.trim();
-            if (line.length() > 0) {
-                int pipe1 = line.indexOf('|');
-                int pipe2 = line.indexOf('|', pipe1 + 1);
-                if (pipe1 > 0 && pipe2 > pipe1) {
-                    output[outputCount].isUser = (line.substring(0, pipe1) == "1");
-                    output[outputCount].text = line.substring(pipe1 + 1, pipe2);
-                    output[outputCount].timestamp = line.substring(pipe2 + 1).toInt();
-                    outputCount++;
-                }
-            }
-        }
-        return;
+    uint32_t offsets[MAX_BATCH];
+    int offsetCount = ChatLog::getRecordOffsets(ownerUserId, friendUserId, startIndex, count, offsets);
+    if (offsetCount < count) {
+        Serial.println("Chat: Warning - message index lookup failed");
+        return 0;
     }
     
-    // Read messages using cache
-    for (int i = startIndex; i < startIndex + messagesToRead && outputCount < messagesToRead; i++) {
-        ChatMessage msg = readMessageAtLine(file, i);
-        if (msg.text.length() > 0) {
-            output[outputCount] = msg;
-            outputCount++;
+    int appended = 0;
+    for (int i = 0; i < count; i++) {
+        uint16_t length;
+        bool isUser;
+        uint32_t timestamp;
+        if (!file.seek(offsets[i]) || !ChatLog::readRecordHeader(file, length, isUser, timestamp)) {
+            break;
+        }
+        if (length > ChatMessageStore::MAX_TEXT_LENGTH) {
+            length = ChatMessageStore::MAX_TEXT_LENGTH;  // Store keeps the head of over-long text
+        }
+        int countBefore = messages.count();
+        char* text = messages.pushNewest(length, isUser, timestamp);
+        if (file.read((uint8_t*)text, length) != length) {
+            messages.popNewest();  // Torn record
+            countBefore--;
+            break;
+        }
+        int evicted = countBefore + 1 - messages.count();
+        if (evicted > 0) {
+            loadedMessageCount -= evicted;
+            fileReadPosition += evicted;
         }
+        appended++;
     }
+    return appended;
 }
 
-void ChatScreen::saveMessagesToFile() {
-    String fileName = getChatHistoryFileName();
-    
-    // Mở file để ghi
-    File file = SPIFFS.open(fileName, "w");
-    if (!file) {
-        Serial.print("Chat: Failed to open file for writing: ");
-        Serial.println(fileName);
+void ChatScreen::appendMessageToFile(const String& text, bool isUser, uint32_t timestamp) {
+    if (ownerUserId <= 0 || friendUserId <= 0) {
+        Serial.println("Chat: ⚠️  Cannot save message - invalid user IDs");
         return;
     }
     
-    // Ghi số lượng tin nhắn
-    file.println(messageCount);
-    
-    // Ghi từng tin nhắn
-    for (int i = 0; i < messageCount; i++) {
-        // Format: isUser|text|timestamp
-        file.print(messages[i].isUser ? "1" : "0");
-        file.print("|");
-        file.print(messages[i].text);
-        file.print("|");
-        file.println(messages[i].timestamp);
+    // Append-only: chỉ ghi thêm 1 record vào cuối file
+    long offset = ChatLog::append(ownerUserId, friendUserId, text, isUser, timestamp);
+    if (offset < 0) {
+        Serial.print("Chat: Failed to append message to file: ");
+        Serial.println(getChatHistoryFileName());
+        return;
     }
     
-    file.close();
-    Serial.print("Chat: Saved ");
-    Serial.print(messageCount);
-    Serial.print(" messages to file: ");
-    Serial.println(fileName);
-    
-    // Invalidate position cache when file is modified
-    invalidatePositionCache();
+    totalMessagesInFile++;
+    Serial.print("Chat: Appended message at offset ");
+    Serial.println(offset);
 }
 
 void ChatScreen::loadMessagesFromFile() {
     String fileName = getChatHistoryFileName();
     
+    // One-time conversion of old text history
+    ChatLog::migrateLegacyFile(ownerUserId, friendUserId);
+    
     // Kiểm tra file có tồn tại không
     if (!SPIFFS.exists(fileName)) {
         Serial.print("Chat: No history file found: ");
@@ -1703,7 +1603,19 @@ void ChatScreen::loadMessagesFromFile() {
         totalMessagesInFile = 0;
         loadedMessageCount = 0;
         hasMoreMessages = false;
-        invalidatePositionCache();
+        return;
+    }
+    
+    // Index is normally already in sync (only a crash mid-append leaves work here)
+    ChatLog::syncIndex(ownerUserId, friendUserId);
+    totalMessagesInFile = ChatLog::getMessageCount(ownerUserId, friendUserId);
+    
+    if (totalMessagesInFile == 0) {
+        messages.clear();
+        loadedMessageCount = 0;
+        hasMoreMessages = false;
+        fileReadPosition = 0;
+        fileNewestPosition = 0;
         return;
     }
     
@@ -1715,25 +1627,6 @@ void ChatScreen::loadMessagesFromFile() {
         totalMessagesInFile = 0;
         loadedMessageCount = 0;
         hasMoreMessages = false;
-        invalidatePositionCache();
-        return;
-    }
-    
-    // Đọc số lượng tin nhắn
-    String countStr = file.readStringUntil('\n');
-    totalMessagesInFile = countStr.toInt();
-    
-    if (totalMessagesInFile > MAX_MESSAGES) {
-        totalMessagesInFile = MAX_MESSAGES;
-    }
-    
-    if (totalMessagesInFile == 0) {
-        file.close();
-        messageCount = 0;
-        loadedMessageCount = 0;
-        hasMoreMessages = false;
-        fileReadPosition = 0;
-        invalidatePositionCache();
         return;
     }
     
@@ -1742,37 +1635,27 @@ void ChatScreen::loadMessagesFromFile() {
     const int INITIAL_LOAD_COUNT = 1;
     int messagesToLoad = (totalMessagesInFile < INITIAL_LOAD_COUNT) ? totalMessagesInFile : INITIAL_LOAD_COUNT;
     
-    // Build position cache for efficient seeking
-    buildFilePositionCache();
-    
-    // Read last N messages using efficient method
-    ChatMessage loadedMsgs[50];
-    int loadedCount = 0;
-    readLastNMessages(file, messagesToLoad, loadedMsgs, loadedCount);
+    // Read last N messages straight into the ring buffer
+    messages.clear();
+    fileNewestPosition = totalMessagesInFile;
+    int loadedCount = prependMessagesFromFile(file, totalMessagesInFile - messagesToLoad, messagesToLoad);
     
     file.close();
     
-    // Copy loaded messages to messages array
-    messageCount = 0;
-    for (int i = 0; i < loadedCount && messageCount < MAX_MESSAGES; i++) {
-        messages[messageCount] = loadedMsgs[i];
-        messageCount++;
-    }
-    
     // Update lazy loading state
-    loadedMessageCount = messageCount;
+    loadedMessageCount = loadedCount;
     fileReadPosition = totalMessagesInFile - loadedCount;  // Vị trí bắt đầu đã đọc
     hasMoreMessages = (fileReadPosition > 0);  // Còn tin nhắn cũ hơn để load
     
     Serial.print("Chat: Initial load - ");
-    Serial.print(messageCount);
+    Serial.print(loadedCount);
     Serial.print(" message(s) of ");
     Serial.print(totalMessagesInFile);
     Serial.print(" total. More will load on scroll. File: ");
     Serial.println(fileName);
     
     // Vẽ lại tin nhắn sau khi load (via flag system, not direct call)
-    if (messageCount > 0) {
+    if (loadedCount > 0) {
         recalculateLayout();
         scrollToLatest();
         needsMessagesRedraw = true;
@@ -1793,19 +1676,14 @@ bool ChatScreen::loadMoreMessages(int count) {
         return false;
     }
     
-    // Build cache if needed (before opening file for reading)
-    if (!positionCacheValid) {
-        buildFilePositionCache();
-    }
+    // Messages appended since open only grow the count; older indices are stable
+    totalMessagesInFile = ChatLog::getMessageCount(ownerUserId, friendUserId);
     
     File file = SPIFFS.open(fileName, "r");
     if (!file) {
         return false;
     }
     
-    // Bỏ qua dòng đầu (total count)
-    file.readStringUntil('\n');
-    
     // Tính số tin nhắn cần load
     int messagesToLoad = count;
     if (fileReadPosition < messagesToLoad) {
@@ -1815,41 +1693,20 @@ bool ChatScreen::loadMoreMessages(int count) {
     // Tính vị trí bắt đầu load (từ fileReadPosition - messagesToLoad)
     int startIndex = fileReadPosition - messagesToLoad;
     
-    // FACEBOOK-STYLE: Efficient reading - sử dụng cache và helper method
-    ChatMessage newMessages[50];
-    int newMessageCount = 0;
-    readMessagesFromPosition(file, startIndex, messagesToLoad, newMessages, newMessageCount);
+    // Prepend trực tiếp vào ring buffer (O(1) mỗi tin nhắn, không dịch mảng).
+    // Khi cửa sổ đầy, tin nhắn mới nhất bị đẩy ra (load lại khi scroll xuống).
+    int newMessageCount = prependMessagesFromFile(file, startIndex, messagesToLoad);
     
     file.close();
     
     if (newMessageCount == 0) {
+        Serial.println("Chat: Failed to read older messages");
         hasMoreMessages = false;
         return false;
     }
     
-    // Kiểm tra nếu thêm vào sẽ vượt quá MAX_MESSAGES
-    if (messageCount + newMessageCount > MAX_MESSAGES) {
-        // Xóa tin nhắn cũ nhất (ở cuối mảng) để nhường chỗ
-        int excess = (messageCount + newMessageCount) - MAX_MESSAGES;
-        for (int i = 0; i < messageCount - excess; i++) {
-            messages[i] = messages[i + excess];
-        }
-        messageCount = messageCount - excess;
-    }
-    
-    // Dịch chuyển tin nhắn hiện tại để nhường chỗ cho tin nhắn cũ hơn
-    for (int i = messageCount - 1; i >= 0; i--) {
-        messages[i + newMessageCount] = messages[i];
-    }
-    
-    // Chèn tin nhắn mới vào đầu (tin nhắn cũ nhất ở index 0)
-    for (int i = 0; i < newMessageCount; i++) {
-        messages[i] = newMessages[i];
-    }
-    
-    messageCount += newMessageCount;
     loadedMessageCount += newMessageCount;
-    fileReadPosition = startIndex;
+    fileReadPosition -= newMessageCount;
     hasMoreMessages = (fileReadPosition > 0);
     
     // FACEBOOK-STYLE: Maintain scroll position - tính số dòng sau khi load
@@ -1877,6 +1734,56 @@ bool ChatScreen::loadMoreMessages(int count) {
     return true;
 }
 
+bool ChatScreen::loadNewerMessages(int count) {
+    if (fileNewestPosition >= totalMessagesInFile || isLoadingMessages) {
+        return false;  // Cửa sổ đã chứa tin nhắn mới nhất
+    }
+    
+    String fileName = getChatHistoryFileName();
+    if (!SPIFFS.exists(fileName)) {
+        return false;
+    }
+    
+    totalMessagesInFile = ChatLog::getMessageCount(ownerUserId, friendUserId);
+    
+    File file = SPIFFS.open(fileName, "r");
+    if (!file) {
+        return false;
+    }
+    
+    int linesBeforeLoad = calculateTotalLines();
+    int newMessageCount = appendMessagesFromFile(file, fileNewestPosition, count);
+    
+    file.close();
+    
+    if (newMessageCount == 0) {
+        Serial.println("Chat: Failed to read newer messages");
+        fileNewestPosition = totalMessagesInFile;  // Không thử lại mãi
+        return false;
+    }
+    
+    loadedMessageCount += newMessageCount;
+    fileNewestPosition += newMessageCount;
+    hasMoreMessages = (fileReadPosition > 0);
+    
+    // Giữ nguyên vị trí đang xem: tin nhắn mới thêm vào phía dưới
+    int addedLines = calculateTotalLines() - linesBeforeLoad;
+    scrollOffset += addedLines;
+    clampScrollOffset();
+    
+    Serial.print("Chat: Reloaded ");
+    Serial.print(newMessageCount);
+    Serial.print(" newer messages, window ");
+    Serial.print(fileReadPosition);
+    Serial.print("-");
+    Serial.print(fileNewestPosition);
+    Serial.print("/");
+    Serial.println(totalMessagesInFile);
+    
+    needsMessagesRedraw = true;
+    return true;
+}
+
 void ChatScreen::setFriendStatus(uint8_t status) {
     friendStatus = status;
     // Chỉ cần vẽ lại title bar để cập nhật dot
@@ -1904,6 +1811,7 @@ void ChatScreen::disableAllDecor() {
 }
 
 void ChatScreen::updateDecorAnimation() {
+    Profiler::Scope profile("ChatScreen.decor");
     // Chỉ update animation nếu có decor nào đó được bật
     bool hasActiveDecor = showTitleBarGradient || showChatAreaPattern || 
                           showInputBoxGlow || showMessageBubbles || 
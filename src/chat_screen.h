@@ -5,6 +5,7 @@
 #include <Adafruit_ST7789.h>
 #include "keyboard.h"
 #include "confirmation_dialog.h"
+#include "chat_message_store.h"
 #include <FS.h>
 #include <SPIFFS.h>
 
@@ -14,13 +15,6 @@ class SocketManager;
 // Callback type for exiting chat screen
 typedef void (*ExitCallback)();
 
-// Cấu trúc tin nhắn
-struct ChatMessage {
-    String text;
-    bool isUser;  // true = tin nhắn của user, false = tin nhắn từ người khác
-    unsigned long timestamp;
-};
-
 class ChatScreen {
 private:
     Adafruit_ST7789* tft;
@@ -46,10 +40,9 @@ private:
     // Exit callback for navigation
     ExitCallback onExitCallback;
     
-    // Danh sách tin nhắn
-    static const int MAX_MESSAGES = 50;
-    ChatMessage messages[MAX_MESSAGES];
-    int messageCount;
+    // Danh sách tin nhắn - ring buffer cố định (1 arena text, không String/heap cho từng tin nhắn)
+    static const int MAX_MESSAGES = ChatMessageStore::CAPACITY;
+    ChatMessageStore messages;
     int scrollOffset;  // Số dòng đã cuộn (scroll theo dòng, không phải theo tin nhắn)
     
     // Lazy loading tracking
@@ -57,17 +50,13 @@ private:
     int totalMessagesInFile;     // Tổng số tin nhắn trong file
     bool hasMoreMessages;        // Còn tin nhắn để load không
     int fileReadPosition;        // Vị trí đọc file (số dòng đã đọc từ đầu file)
+    int fileNewestPosition;      // Index (trong file) ngay sau tin nhắn mới nhất đang load - < totalMessagesInFile khi đã cuộn lùi xa
     
     // Loading state flags to prevent race conditions
     bool isLoadingMessages;      // Flag để prevent concurrent loading
     unsigned long lastLoadTime;  // Thời gian load cuối cùng (để debounce)
     bool showLoadingIndicator;   // Flag để hiển thị loading indicator khi đang load
     
-    // File position cache for efficient seeking (Facebook-style)
-    size_t* fileLinePositions;   // Cache byte positions of each line in file
-    int cachedLineCount;         // Number of cached positions
-    bool positionCacheValid;     // Whether cache is up to date
-    
     // Tin nhắn đang nhập
     String currentMessage;
     int inputCursorPos;  // Vị trí con trỏ trong currentMessage (theo ký tự)
@@ -147,6 +136,9 @@ private:
     void drawIconInline(uint16_t x, uint16_t y, uint16_t size, uint16_t color, uint16_t bgColor, char iconCode);  // Vẽ icon trong text/input
     bool containsIcon(const String& text) const;  // Kiểm tra tin nhắn có chứa icon hay không
     
+    // Typing indicator cho bạn chat (SocketManager gộp các phím liên tiếp thành 1 frame)
+    void notifyTyping(bool typing);
+    
     // Cuộn tin nhắn
     void scrollUp();
     void scrollDown();
@@ -162,17 +154,14 @@ private:
     void recalculateLayout();
     
     // Lưu/tải lịch sử chat
-    String getChatHistoryFileName();  // Tạo tên file từ nickname
-    void saveMessagesToFile();        // Lưu tin nhắn vào file
+    String getChatHistoryFileName();  // Tạo tên file từ user IDs (ChatLog format)
+    void appendMessageToFile(const String& text, bool isUser, uint32_t timestamp);  // Ghi thêm 1 tin nhắn vào cuối file (append-only)
     bool loadMoreMessages(int count = 5);  // Load thêm tin nhắn cũ hơn khi scroll lên
+    bool loadNewerMessages(int count = 5);  // Load lại tin nhắn mới hơn (đã bị đẩy ra) khi scroll xuống
     
-    // File reading helpers (Facebook-style efficient reading)
-    void buildFilePositionCache();     // Build cache of file line positions
-    void invalidatePositionCache();    // Mark cache as invalid
-    ChatMessage readMessageAtLine(File& file, int lineIndex);  // Read message at specific line using cache
-    void readLastNMessages(File& file, int n, ChatMessage* output, int& count);  // Read last N messages efficiently
-    void readMessagesFromPosition(File& file, int startIndex, int count, ChatMessage* output, int& outputCount);  // Read messages from position
-    int calculateLinesForMessages(const ChatMessage* msgs, int msgCount) const;  // Calculate total lines for messages
+    // File reading helpers - record offsets come from the ChatLog sidecar index
+    int prependMessagesFromFile(File& file, int startIndex, int count);  // Read [startIndex, startIndex+count) straight into the store, returns how many
+    int appendMessagesFromFile(File& file, int startIndex, int count);   // Same, oldest first at the newest end of the store
 
 public:
     // Lưu/tải lịch sử chat (public methods)
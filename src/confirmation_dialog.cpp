@@ -1,4 +1,6 @@
 #include "confirmation_dialog.h"
+#include "tft_compositor.h"
+#include "profiler.h"
 
 // Deep Space Arcade Theme (matching Login Screen)
 #define WIN_BG_DARK   0x0042  // Deep Midnight Blue #020817
@@ -41,6 +43,8 @@ void ConfirmationDialog::hide() {
 }
 
 void ConfirmationDialog::draw() {
+    Profiler::Scope profile("ConfirmationDialog.draw");
+    TftCompositor::Frame frame("ConfirmationDialog");
     if (!visible || tft == nullptr) return;
     
     const uint16_t screenWidth = 320;
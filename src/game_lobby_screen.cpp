@@ -1,4 +1,6 @@
 #include "game_lobby_screen.h"
+#include "tft_compositor.h"
+#include "profiler.h"
 #include "api_client.h"
 
 static GameLobbyScreen* s_gameLobbyInstance = nullptr;
@@ -68,6 +70,8 @@ void GameLobbyScreen::setSessionInfo(int sessionId, int hostUserId, const String
 }
 
 void GameLobbyScreen::draw() {
+    Profiler::Scope profile("GameLobbyScreen.draw");
+    TftCompositor::Frame frame("GameLobbyScreen");
     // 1. Left Sidebar
     tft->fillRect(0, 0, 80, 240, theme.colorCardBg);
     tft->drawFastVLine(80, 0, 240, theme.colorAccent); // High-tech divider
@@ -315,6 +319,7 @@ void GameLobbyScreen::triggerStart() {
 }
 
 void GameLobbyScreen::update() {
+    Profiler::Scope profile("GameLobbyScreen.update");
     // Check if 10 seconds have passed since setup
     unsigned long elapsed = millis() - startTimeSimulation;
     
@@ -1,5 +1,7 @@
 #include <Arduino.h>
 #include "game_menu.h"
+#include "tft_compositor.h"
+#include "profiler.h"
 #include <Adafruit_GFX.h>
 #include <Adafruit_ST7789.h>
 
@@ -108,6 +110,8 @@ void GameMenuScreen::drawMenuItem(uint16_t index, bool isSelected) {
 }
 
 void GameMenuScreen::draw() {
+    Profiler::Scope profile("GameMenuScreen.draw");
+    TftCompositor::Frame frame("GameMenuScreen");
     drawBackground();
     drawTitle();
     
@@ -141,6 +145,7 @@ void GameMenuScreen::selectItem(MenuItem item) {
 }
 
 void GameMenuScreen::update() {
+    Profiler::Scope profile("GameMenuScreen.update");
     // Cập nhật animation frame cho hiệu ứng
     animationFrame++;
     if (animationFrame > 1000) animationFrame = 0;
@@ -1,5 +1,7 @@
 #include <Arduino.h>
 #include "gunny_game.h"
+#include "tft_compositor.h"
+#include "profiler.h"
 #include <Adafruit_GFX.h>
 #include <Adafruit_ST7789.h>
 #include <math.h>
@@ -24,6 +26,8 @@ GunnyGame::GunnyGame(Adafruit_ST7789* tft) {
     this->projVx = 0;
     this->projVy = 0;
     this->projTime = 0;
+    this->impactX = 0;
+    this->impactY = 0;
     this->oldProjX = 0;
     this->oldProjY = 0;
     this->animationFrame = 0;
@@ -209,7 +213,7 @@ void GunnyGame::drawTrajectory() {
     // Draw trajectory curve (dotted line)
     for (float t = 0.0f; t < 2.0f; t += 0.1f) {
         float x = playerX + v0x * t + 0.5f * aWind * t * t;
-        float y = playerY + v0y * t - 0.5f * gravity * t * t;
+        float y = playerY + v0y * t - 0.5f * (float)gravity * t * t;
         
         int xInt = (int)x;
         int yInt = (int)y;
@@ -319,6 +323,8 @@ void GunnyGame::eraseProjectile(int x, int y) {
 }
 
 void GunnyGame::draw() {
+    Profiler::Scope profile("GunnyGame.draw");
+    TftCompositor::Frame frame("GunnyGame");
     drawTerrain();
     drawPlayer();
     drawTrajectory();  // Draw predicted trajectory
@@ -332,6 +338,7 @@ void GunnyGame::draw() {
 }
 
 void GunnyGame::update() {
+    Profiler::Scope profile("GunnyGame.update");
     // Update animation frame
     animationFrame++;
     if (animationFrame > 10000) animationFrame = 0;
@@ -396,19 +403,19 @@ void GunnyGame::startFiring() {
     if (savedPower < 50) savedPower = 50;  // Minimum power
     
     // Calculate initial velocity from power
-    float v0 = (savedPower / (float)MAX_POWER) * V_MAX;
+    sim_t v0 = sim_t(savedPower) / sim_t(MAX_POWER) * sim_t(V_MAX);
     
     // Convert angle to radians
-    float angleRad = currentAngle * (M_PI / 180.0f);
+    sim_t angleRad = sim_t(currentAngle) * SIM_DEG_TO_RAD;
     
     // Calculate initial velocities
-    projVx = v0 * cos(angleRad);
-    projVy = v0 * sin(angleRad);
+    projVx = v0 * simCos(angleRad);
+    projVy = v0 * simSin(angleRad);
     
     // Set initial position (at current active player position)
-    projX = (float)currentPlayerX;
-    projY = (float)currentPlayerY + 5;  // Start slightly above player
-    projTime = 0.0f;
+    projX = sim_t(currentPlayerX);
+    projY = sim_t(currentPlayerY + 5);  // Start slightly above player
+    projTime = sim_t(0);
     
     isFiring = true;
     power = 0;
@@ -420,7 +427,7 @@ void GunnyGame::startFiring() {
     Serial.print(", Angle: ");
     Serial.print(currentAngle);
     Serial.print(", v0: ");
-    Serial.println(v0);
+    Serial.println((float)v0);
     
     // Draw initial projectile
     drawProjectile((int)projX, (int)projY);
@@ -431,7 +438,7 @@ void GunnyGame::updateProjectile() {
     eraseProjectile((int)projX, (int)projY);
     
     // Calculate wind acceleration
-    float aWind = windDirection * windSpeed * WIND_SCALE;
+    sim_t aWind = sim_t(windDirection * windSpeed) * sim_t(WIND_SCALE);
     
     // Update time
     projTime += timeStep;
@@ -439,14 +446,16 @@ void GunnyGame::updateProjectile() {
     // Calculate new position using physics equations
     // x(t) = v0x * t + 0.5 * a_wind * t^2
     // y(t) = v0y * t - 0.5 * g * t^2
-    float newX = projX + projVx * projTime + 0.5f * aWind * projTime * projTime;
-    float newY = projY + projVy * projTime - 0.5f * gravity * projTime * projTime;
+    sim_t newX = projX + projVx * projTime + sim_t(0.5f) * aWind * projTime * projTime;
+    sim_t newY = projY + projVy * projTime - sim_t(0.5f) * gravity * projTime * projTime;
     
     // Check for impact
     int xInt = (int)newX;
     if (xInt < 0 || xInt >= SCREEN_WIDTH) {
         // Out of bounds
         isFiring = false;
+        impactX = newX;
+        impactY = newY;
         draw();  // Redraw everything
         return;
     }
@@ -455,6 +464,8 @@ void GunnyGame::updateProjectile() {
     if (newY <= terrain[xInt]) {
         // Impact!
         isFiring = false;
+        impactX = newX;
+        impactY = newY;
         
         // Draw explosion/splash effect
         int impactScreenY = SCREEN_HEIGHT - terrain[xInt];
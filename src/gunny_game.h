@@ -4,6 +4,7 @@
 #include <Arduino.h>
 #include <Adafruit_GFX.h>
 #include <Adafruit_ST7789.h>
+#include "sim_math.h"
 
 // Screen dimensions
 #define SCREEN_WIDTH 320
@@ -63,17 +64,18 @@ private:
     int terrain[320];        // Y height at each X column
     
     // Projectile state
-    float projX, projY;      // Current projectile position
-    float projVx, projVy;    // Current projectile velocity
-    float projTime;          // Time since launch
+    sim_t projX, projY;      // Current projectile position
+    sim_t projVx, projVy;    // Current projectile velocity
+    sim_t projTime;          // Time since launch
+    sim_t impactX, impactY;  // Where the last shot ended (terrain or screen edge)
     int oldProjX, oldProjY;  // Previous position for erasing
     
     // Animation
     uint16_t animationFrame; // For cloud animation
     
     // Physics
-    float timeStep;
-    float gravity;
+    sim_t timeStep;
+    sim_t gravity;
     
     // Drawing methods
     void drawTerrain();
@@ -112,6 +114,9 @@ public:
     // Getters
     bool getIsFiring() const { return isFiring; }
     bool getIsCharging() const { return isCharging; }
+    float getProjectileX() const { return (float)projX; }
+    float getProjectileY() const { return (float)projY; }
+    void getLastImpact(float& x, float& y) const { x = (float)impactX; y = (float)impactY; }
 };
 
 #endif
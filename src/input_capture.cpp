@@ -0,0 +1,258 @@
+#include "input_capture.h"
+
+// ----- Quadrature decode (runs in the encoder interrupt) -----
+
+// (previous << 2) | current -> +1 right, -1 left, 0 no move / both lines changed.
+// Right turn runs 00 -> 10 -> 11 -> 01 -> 00 as (CLK, DT): CLK leads DT.
+// DRAM_ATTR: read from the interrupt handler.
+static const DRAM_ATTR int8_t QUADRATURE_DELTA[16] = {
+     0, -1, +1,  0,
+    +1,  0,  0, -1,
+    -1,  0,  0, +1,
+     0, +1, -1,  0
+};
+
+int IRAM_ATTR QuadratureDecoder::update(uint8_t level) {
+    level &= 3;
+    int8_t delta = QUADRATURE_DELTA[(state << 2) | level];
+    if (delta == 0 && level != state) {
+        invalid++;
+    }
+    state = level;
+    count += delta;
+    if (count >= STEPS_PER_DETENT) {
+        count -= STEPS_PER_DETENT;
+        return 1;
+    }
+    if (count <= -STEPS_PER_DETENT) {
+        count += STEPS_PER_DETENT;
+        return -1;
+    }
+    return 0;
+}
+
+// ----- Decoder (pure logic) -----
+
+InputDecoder::InputDecoder() {
+    for (int i = 0; i < LINE_ENCODER; i++) {
+        buttons[i] = {false, true, true, true, 0, 0, 0};
+    }
+    this->actionCount = 0;
+    this->droppedActions = 0;
+}
+
+void InputDecoder::configureButton(Line line, bool idleLevel, uint32_t debounceMicros) {
+    if (line >= LINE_ENCODER) return;
+    Button& b = buttons[line];
+    b.configured = true;
+    b.idle = idleLevel;
+    b.stable = idleLevel;
+    b.pending = idleLevel;
+    b.lastEdge = 0;
+    b.firstEdge = 0;
+    b.debounce = debounceMicros;
+}
+
+void InputDecoder::emit(uint8_t key, uint32_t edgeMicros) {
+    if (actionCount >= MAX_ACTIONS) {
+        droppedActions++;
+        return;
+    }
+    actions[actionCount].key = key;
+    actions[actionCount].edgeMicros = edgeMicros;
+    actionCount++;
+}
+
+// Accept the pending level if it has held for the debounce time by nowMicros
+void InputDecoder::settle(Line line, uint32_t nowMicros) {
+    Button& b = buttons[line];
+    if (b.pending == b.stable || (uint32_t)(nowMicros - b.lastEdge) < b.debounce) {
+        return;
+    }
+    b.stable = b.pending;
+    bool pressed = (b.stable != b.idle);
+    if (line == LINE_SELECT) {
+        emit(pressed ? KEY_SELECT_PRESS : KEY_SELECT_RELEASE, b.firstEdge);
+    } else if (pressed) {
+        emit(line == LINE_UP ? KEY_UP_PRESS : KEY_DOWN_PRESS, b.firstEdge);
+    }
+}
+
+void InputDecoder::feed(const InputEdge& edge) {
+    if (edge.line == LINE_ENCODER) {
+        emit(edge.level ? KEY_RIGHT : KEY_LEFT, edge.micros);
+        return;
+    }
+
+    if (edge.line >= LINE_ENCODER) return;
+    Line line = (Line)edge.line;
+    Button& b = buttons[line];
+    if (!b.configured) return;
+
+    // The level before this edge may already have held long enough
+    settle(line, edge.micros);
+
+    bool level = edge.level != 0;
+    if (level == b.pending) {
+        return;  // Glitch shorter than the interrupt latency - nothing changed
+    }
+    if (b.pending == b.stable && (uint32_t)(edge.micros - b.lastEdge) >= b.debounce) {
+        b.firstEdge = edge.micros;  // Start of a change (not a bounce back within the last one)
+    }
+    b.pending = level;
+    b.lastEdge = edge.micros;
+}
+
+int InputDecoder::poll(uint32_t nowMicros, Action* out, int capacity) {
+    for (int i = 0; i < LINE_ENCODER; i++) {
+        // No room: the level stays pending and settles on the next poll
+        if (buttons[i].configured && !isFull()) {
+            settle((Line)i, nowMicros);
+        }
+    }
+    return take(out, capacity);
+}
+
+int InputDecoder::take(Action* out, int capacity) {
+    int n = (actionCount < capacity) ? actionCount : capacity;
+    for (int i = 0; i < n; i++) {
+        out[i] = actions[i];
+    }
+    for (int i = n; i < actionCount; i++) {
+        actions[i - n] = actions[i];
+    }
+    actionCount -= n;
+    return n;
+}
+
+// ----- Capture (interrupts) -----
+
+SpscRing<InputEdge, InputCapture::RING_SIZE> InputCapture::ring;
+QuadratureDecoder InputCapture::quadrature = {0, 0, 0};
+std::atomic<int32_t> InputCapture::overflowSteps(0);
+std::atomic<uint32_t> InputCapture::overflows(0);
+volatile bool InputCapture::buttonOverflow = false;
+InputCapture::Stats InputCapture::stats = {0, 0, 0, 0, 0};
+int InputCapture::pins[InputDecoder::LINE_COUNT] = {-1, -1, -1, -1};
+int InputCapture::encoderDtPin = -1;
+
+bool IRAM_ATTR InputCapture::push(uint8_t line, uint8_t level, uint32_t keepFree) {
+    InputEdge edge;
+    edge.micros = micros();
+    edge.line = line;
+    edge.level = level;
+    if (ring.freeSpace() > keepFree && ring.push(edge)) {
+        return true;
+    }
+    overflows.fetch_add(1, std::memory_order_relaxed);
+    return false;
+}
+
+void IRAM_ATTR InputCapture::pushButton(uint8_t line) {
+    if (!push(line, digitalRead(pins[line]), 0)) {
+        buttonOverflow = true;
+    }
+}
+
+void IRAM_ATTR InputCapture::onUpEdge() {
+    pushButton(InputDecoder::LINE_UP);
+}
+
+void IRAM_ATTR InputCapture::onDownEdge() {
+    pushButton(InputDecoder::LINE_DOWN);
+}
+
+void IRAM_ATTR InputCapture::onSelectEdge() {
+    pushButton(InputDecoder::LINE_SELECT);
+}
+
+// Same handler for CLK and DT: both levels, read together
+void IRAM_ATTR InputCapture::onEncoderEdge() {
+    uint8_t level = (digitalRead(pins[InputDecoder::LINE_ENCODER]) << 1) | digitalRead(encoderDtPin);
+    int step = quadrature.update(level);
+    if (step == 0) {
+        return;
+    }
+    // Once a step has overflowed, later ones queue behind it in the count
+    // (not the ring) until drain() has replayed it, so the order holds
+    if (overflowSteps.load(std::memory_order_relaxed) != 0 ||
+        !push(InputDecoder::LINE_ENCODER, step > 0 ? 1 : 0, BUTTON_RESERVE)) {
+        overflowSteps.fetch_add(step, std::memory_order_relaxed);
+    }
+}
+
+void InputCapture::begin(int upPin, int downPin, int selectPin, int encoderClkPin, int encoderDtPin) {
+    pins[InputDecoder::LINE_UP] = upPin;
+    pins[InputDecoder::LINE_DOWN] = downPin;
+    pins[InputDecoder::LINE_SELECT] = selectPin;
+    pins[InputDecoder::LINE_ENCODER] = encoderClkPin;
+    InputCapture::encoderDtPin = encoderDtPin;
+
+    if (upPin >= 0) attachInterrupt(digitalPinToInterrupt(upPin), onUpEdge, CHANGE);
+    if (downPin >= 0) attachInterrupt(digitalPinToInterrupt(downPin), onDownEdge, CHANGE);
+    if (selectPin >= 0) attachInterrupt(digitalPinToInterrupt(selectPin), onSelectEdge, CHANGE);
+    if (encoderClkPin >= 0 && encoderDtPin >= 0) {
+        quadrature.reset((digitalRead(encoderClkPin) << 1) | digitalRead(encoderDtPin));
+        attachInterrupt(digitalPinToInterrupt(encoderClkPin), onEncoderEdge, CHANGE);
+        attachInterrupt(digitalPinToInterrupt(encoderDtPin), onEncoderEdge, CHANGE);
+    }
+    Serial.println("Input Capture: GPIO interrupts attached");
+}
+
+// Ring is empty: replay what didn't fit. Encoder steps come back as their
+// net count; a lost button edge is made up for by the current pin level.
+void InputCapture::recoverOverflow(InputDecoder& decoder) {
+    int32_t steps = overflowSteps.exchange(0, std::memory_order_relaxed);
+    uint32_t now = micros();
+    while (steps != 0 && !decoder.isFull()) {
+        InputEdge edge = {now, InputDecoder::LINE_ENCODER, (uint8_t)(steps > 0 ? 1 : 0)};
+        decoder.feed(edge);
+        steps += (steps > 0) ? -1 : 1;
+    }
+    if (steps != 0) {
+        overflowSteps.fetch_add(steps, std::memory_order_relaxed);  // Rest on the next drain
+    }
+
+    if (buttonOverflow && !decoder.isFull()) {
+        buttonOverflow = false;
+        for (int line = 0; line < InputDecoder::LINE_ENCODER; line++) {
+            if (pins[line] >= 0) {
+                InputEdge edge = {now, (uint8_t)line, (uint8_t)digitalRead(pins[line])};
+                decoder.feed(edge);
+            }
+        }
+    }
+}
+
+bool InputCapture::drain(InputDecoder& decoder) {
+    uint32_t backlog = ring.size();
+    if (backlog > stats.maxBacklog) stats.maxBacklog = backlog;
+    stats.overflows = overflows.load(std::memory_order_relaxed);
+    stats.invalidTransitions = quadrature.invalid;
+    InputEdge edge;
+    while (!decoder.isFull()) {
+        if (!ring.pop(edge)) {
+            if (overflowSteps.load(std::memory_order_relaxed) != 0 || buttonOverflow) {
+                recoverOverflow(decoder);
+                return overflowSteps.load(std::memory_order_relaxed) == 0;  // Else the decoder filled up
+            }
+            return true;
+        }
+        decoder.feed(edge);
+        stats.edges++;
+    }
+    return false;
+}
+
+void InputCapture::printStats() {
+    Serial.print("Input Capture: edges=");
+    Serial.print(stats.edges);
+    Serial.print(", overflows=");
+    Serial.print(stats.overflows);
+    Serial.print(", maxBacklog=");
+    Serial.print(stats.maxBacklog);
+    Serial.print(", maxLatency=");
+    Serial.print(stats.maxLatencyUs);
+    Serial.print(" us, invalidTransitions=");
+    Serial.println(stats.invalidTransitions);
+}
@@ -0,0 +1,160 @@
+#ifndef INPUT_CAPTURE_H
+#define INPUT_CAPTURE_H
+
+#include <Arduino.h>
+#include <atomic>
+#include "spsc_ring.h"
+
+// One input event as recorded by the interrupt handler
+struct InputEdge {
+    uint32_t micros;   // esp_timer time of the interrupt
+    uint8_t line;      // InputDecoder::Line
+    uint8_t level;     // Button: pin level. Encoder: 1 = step right, 0 = step left
+};
+
+// Quadrature (Gray code) decode of an encoder's CLK/DT levels, fed on every
+// edge of either line. Contact bounce on one line moves the count +1/-1 and
+// cancels out, so no time debounce is needed; STEPS_PER_DETENT transitions
+// make one step (2 = one step per CLK change, like the polled code before).
+// Runs inside the encoder interrupt, so only whole steps reach the queue.
+struct QuadratureDecoder {
+    static const int STEPS_PER_DETENT = 2;
+
+    uint8_t state;        // Last (CLK << 1) | DT
+    int8_t count;         // Transitions since the last step
+    uint32_t invalid;     // Both lines changed between two interrupts
+
+    void reset(uint8_t level) { state = level & 3; count = 0; invalid = 0; }
+    // +1 step right, -1 step left, 0 no step yet
+    int update(uint8_t level);
+};
+
+// Turns timestamped edges into key presses and encoder steps.
+//
+// Buttons: a level counts once it has held for the debounce time since the
+// last edge on that line. Edges are judged by their own timestamps, not by
+// when the main loop gets to them, so a press and release that both happen
+// during a long redraw still produce the press.
+//
+// No Arduino calls - runs the same on the host.
+class InputDecoder {
+public:
+    enum Line {
+        LINE_UP = 0,
+        LINE_DOWN,
+        LINE_SELECT,
+        LINE_ENCODER,
+        LINE_COUNT
+    };
+
+    enum Key {
+        KEY_UP_PRESS = 0,
+        KEY_DOWN_PRESS,
+        KEY_SELECT_PRESS,
+        KEY_SELECT_RELEASE,
+        KEY_LEFT,
+        KEY_RIGHT
+    };
+
+    struct Action {
+        uint8_t key;
+        uint32_t edgeMicros;    // First edge of the change (latency = dispatch - this)
+    };
+
+    static const int MAX_ACTIONS = 16;
+
+    InputDecoder();
+
+    // idleLevel = pin level when not pressed (sampled at boot)
+    void configureButton(Line line, bool idleLevel, uint32_t debounceMicros);
+
+    // Edges in arrival order. Each edge decides at most one action; stop
+    // feeding while isFull() and take() first (past that they're dropped,
+    // see getDroppedActions).
+    void feed(const InputEdge& edge);
+    bool isFull() const { return actionCount >= MAX_ACTIONS; }
+
+    // Hand out the actions decided so far. Returns the action count.
+    int take(Action* out, int capacity);
+
+    // Settle buttons whose last edge is older than their debounce at now,
+    // then take(). Only call once every captured edge has been fed.
+    int poll(uint32_t nowMicros, Action* out, int capacity);
+
+    bool isPressed(Line line) const { return buttons[line].stable != buttons[line].idle; }
+    uint32_t getDroppedActions() const { return droppedActions; }
+
+private:
+    struct Button {
+        bool configured;
+        bool idle;
+        bool stable;          // Debounced level
+        bool pending;         // Latest raw level
+        uint32_t lastEdge;    // Time of the latest raw edge
+        uint32_t firstEdge;   // First edge since the level was last stable
+        uint32_t debounce;
+    };
+
+    Button buttons[LINE_ENCODER];
+    Action actions[MAX_ACTIONS];
+    int actionCount;
+    uint32_t droppedActions;
+
+    void settle(Line line, uint32_t nowMicros);
+    void emit(uint8_t key, uint32_t edgeMicros);
+};
+
+// GPIO interrupts -> ring of InputEdge, drained by the main loop.
+//
+// One CHANGE interrupt per pin. All GPIO interrupts are served one at a
+// time by the same core, so the handlers together are the ring's single
+// producer; loop() (via drain) is the consumer.
+//
+// Nothing is lost when the ring is full: encoder steps that don't fit (they
+// leave BUTTON_RESERVE slots free) are added to a net step count that
+// drain() replays without their own timestamps, and a lost button edge makes
+// drain() re-read the button pins once the ring is empty.
+class InputCapture {
+public:
+    static const uint32_t RING_SIZE = 128;  // Power of two
+    static const uint32_t BUTTON_RESERVE = 32;  // Slots encoder steps leave to button edges
+
+    struct Stats {
+        uint32_t edges;
+        uint32_t overflows;      // Events that didn't fit (recovered, see above)
+        uint32_t maxBacklog;     // Most edges waiting at one drain
+        uint32_t maxLatencyUs;   // Edge -> action dispatched, slowest
+        uint32_t invalidTransitions;  // Encoder: both lines changed between two interrupts
+    };
+
+    // Pins < 0 are skipped. Call after pinMode().
+    static void begin(int upPin, int downPin, int selectPin, int encoderClkPin, int encoderDtPin);
+
+    // Main loop: feed captured edges to the decoder until the ring is empty
+    // (returns true) or the decoder is full (false - take() and call again)
+    static bool drain(InputDecoder& decoder);
+
+    static void noteLatency(uint32_t micros) { if (micros > stats.maxLatencyUs) stats.maxLatencyUs = micros; }
+    static const Stats& getStats() { return stats; }
+    static void printStats();
+
+private:
+    static SpscRing<InputEdge, RING_SIZE> ring;
+    static QuadratureDecoder quadrature;          // Interrupt only
+    static std::atomic<int32_t> overflowSteps;    // Net encoder steps that didn't fit
+    static std::atomic<uint32_t> overflows;
+    static volatile bool buttonOverflow;
+    static Stats stats;
+    static int pins[InputDecoder::LINE_COUNT];
+    static int encoderDtPin;
+
+    static bool push(uint8_t line, uint8_t level, uint32_t keepFree);
+    static void pushButton(uint8_t line);
+    static void recoverOverflow(InputDecoder& decoder);
+    static void onUpEdge();
+    static void onDownEdge();
+    static void onSelectEdge();
+    static void onEncoderEdge();
+};
+
+#endif
@@ -0,0 +1,408 @@
+#include "json_tokenizer.h"
+#include <string.h>
+
+JsonTokenizer::JsonTokenizer() {
+    fieldCount = 0;
+    typeHash = 0;
+    overflowed = false;
+    cur = nullptr;
+    end = nullptr;
+}
+
+uint32_t JsonTokenizer::hashBytes(const char* s, size_t length) {
+    uint32_t h = 2166136261u;
+    for (size_t i = 0; i < length; i++) {
+        h = (h ^ (uint8_t)s[i]) * 16777619u;
+    }
+    return h;
+}
+
+bool JsonTokenizer::parse(const uint8_t* data, size_t length) {
+    fieldCount = 0;
+    typeHash = 0;
+    overflowed = false;
+    if (data == nullptr || length == 0) {
+        return false;
+    }
+
+    cur = (const char*)data;
+    end = cur + length;
+
+    skipWhitespace();
+    if (cur >= end || *cur != '{' || !parseObject(0)) {
+        fieldCount = 0;
+        return false;
+    }
+
+    const JsonField* typeField = find("type", 0);
+    if (typeField != nullptr && typeField->type == JSON_STRING) {
+        typeHash = hashBytes(typeField->value, typeField->valueLength);
+    }
+    return true;
+}
+
+void JsonTokenizer::skipWhitespace() {
+    while (cur < end && (*cur == ' ' || *cur == '\t' || *cur == '\n' || *cur == '\r')) {
+        cur++;
+    }
+}
+
+bool JsonTokenizer::scanString(const char*& start, uint16_t& length, bool& escaped) {
+    // *cur == '"'
+    cur++;
+    start = cur;
+    escaped = false;
+    while (cur < end && *cur != '"') {
+        if (*cur == '\\') {
+            escaped = true;
+            cur++;  // Skip escaped char (covers \" and \\)
+        }
+        cur++;
+    }
+    if (cur >= end || cur - start > 0xFFFF) {
+        return false;
+    }
+    length = (uint16_t)(cur - start);
+    cur++;  // Closing quote
+    return true;
+}
+
+bool JsonTokenizer::matchLiteral(const char* literal) {
+    size_t len = strlen(literal);
+    if ((size_t)(end - cur) < len || memcmp(cur, literal, len) != 0) {
+        return false;
+    }
+    cur += len;
+    return true;
+}
+
+bool JsonTokenizer::skipComposite() {
+    // Skip a nested object/array without recording fields (too deep or array)
+    int nesting = 0;
+    while (cur < end) {
+        char c = *cur;
+        if (c == '"') {
+            const char* s;
+            uint16_t len;
+            bool esc;
+            if (!scanString(s, len, esc)) return false;
+            continue;
+        }
+        if (c == '{' || c == '[') {
+            nesting++;
+        } else if (c == '}' || c == ']') {
+            nesting--;
+            if (nesting == 0) {
+                cur++;
+                return true;
+            }
+        }
+        cur++;
+    }
+    return false;
+}
+
+bool JsonTokenizer::parseObject(uint8_t depth) {
+    // *cur == '{'
+    cur++;
+    skipWhitespace();
+    if (cur < end && *cur == '}') {
+        cur++;
+        return true;
+    }
+
+    while (cur < end) {
+        skipWhitespace();
+        if (cur >= end || *cur != '"') return false;
+
+        JsonField field;
+        bool keyEscaped;
+        if (!scanString(field.key, field.keyLength, keyEscaped)) return false;
+
+        skipWhitespace();
+        if (cur >= end || *cur != ':') return false;
+        cur++;
+        skipWhitespace();
+
+        field.depth = depth;
+        field.escaped = false;
+
+        // Reserve the slot before descending so a parent precedes its children.
+        // A full table fails the frame: callers must not act on half of it.
+        if (fieldCount >= MAX_FIELDS) {
+            overflowed = true;
+            return false;
+        }
+        int slot = fieldCount++;
+        if (!parseValue(field, depth)) return false;
+        fields[slot] = field;
+
+        skipWhitespace();
+        if (cur >= end) return false;
+        if (*cur == ',') {
+            cur++;
+            continue;
+        }
+        if (*cur == '}') {
+            cur++;
+            return true;
+        }
+        return false;
+    }
+    return false;
+}
+
+bool JsonTokenizer::parseValue(JsonField& field, uint8_t depth) {
+    if (cur >= end) return false;
+
+    const char* start = cur;
+    char c = *cur;
+
+    if (c == '"') {
+        field.type = JSON_STRING;
+        return scanString(field.value, field.valueLength, field.escaped);
+    }
+
+    if (c == '{' || c == '[') {
+        bool ok;
+        if (c == '{' && depth + 1 < MAX_DEPTH) {
+            field.type = JSON_OBJECT;
+            ok = parseObject(depth + 1);
+        } else {
+            field.type = (c == '{') ? JSON_OBJECT : JSON_ARRAY;
+            ok = skipComposite();
+        }
+        field.value = start;
+        field.valueLength = (uint16_t)(cur - start);
+        return ok;
+    }
+
+    if (c == 't' || c == 'f') {
+        field.type = JSON_BOOL;
+        if (!matchLiteral(c == 't' ? "true" : "false")) return false;
+    } else if (c == 'n') {
+        field.type = JSON_NULL;
+        if (!matchLiteral("null")) return false;
+    } else if (c == '-' || (c >= '0' && c <= '9')) {
+        field.type = JSON_NUMBER;
+        while (cur < end) {
+            c = *cur;
+            if ((c >= '0' && c <= '9') || c == '-' || c == '+' || c == '.' || c == 'e' || c == 'E') {
+                cur++;
+            } else {
+                break;
+            }
+        }
+    } else {
+        return false;
+    }
+
+    field.value = start;
+    field.valueLength = (uint16_t)(cur - start);
+    return true;
+}
+
+const JsonField* JsonTokenizer::find(const char* key, int depth) const {
+    size_t keyLen = strlen(key);
+    for (int i = 0; i < fieldCount; i++) {
+        const JsonField& f = fields[i];
+        if (depth != ANY_DEPTH && f.depth != depth) continue;
+        if (f.keyLength == keyLen && memcmp(f.key, key, keyLen) == 0) {
+            return &f;
+        }
+    }
+    return nullptr;
+}
+
+int JsonTokenizer::parseIntView(const char* s, size_t length, int defaultValue) {
+    size_t i = 0;
+    bool negative = false;
+    if (i < length && (s[i] == '-' || s[i] == '+')) {
+        negative = (s[i] == '-');
+        i++;
+    }
+    if (i >= length || s[i] < '0' || s[i] > '9') {
+        return defaultValue;
+    }
+    long value = 0;
+    while (i < length && s[i] >= '0' && s[i] <= '9') {
+        value = value * 10 + (s[i] - '0');
+        i++;
+    }
+    return (int)(negative ? -value : value);
+}
+
+int JsonTokenizer::getInt(const char* key, int defaultValue, int depth) const {
+    const JsonField* f = find(key, depth);
+    if (f == nullptr) return defaultValue;
+    if (f->type == JSON_NUMBER || f->type == JSON_STRING) {
+        return parseIntView(f->value, f->valueLength, defaultValue);
+    }
+    if (f->type == JSON_BOOL) {
+        return f->value[0] == 't' ? 1 : 0;
+    }
+    return defaultValue;
+}
+
+bool JsonTokenizer::getBool(const char* key, bool defaultValue, int depth) const {
+    const JsonField* f = find(key, depth);
+    if (f == nullptr) return defaultValue;
+    if (f->type == JSON_BOOL) {
+        return f->value[0] == 't';
+    }
+    if (f->type == JSON_NUMBER) {
+        return parseIntView(f->value, f->valueLength, 0) != 0;
+    }
+    return defaultValue;
+}
+
+bool JsonTokenizer::valueEquals(const char* key, const char* literal, int depth) const {
+    const JsonField* f = find(key, depth);
+    if (f == nullptr || f->type != JSON_STRING) return false;
+    size_t len = strlen(literal);
+    return f->valueLength == len && memcmp(f->value, literal, len) == 0;
+}
+
+static size_t encodeUtf8(uint32_t cp, char* out) {
+    if (cp < 0x80) {
+        out[0] = (char)cp;
+        return 1;
+    }
+    if (cp < 0x800) {
+        out[0] = (char)(0xC0 | (cp >> 6));
+        out[1] = (char)(0x80 | (cp & 0x3F));
+        return 2;
+    }
+    if (cp < 0x10000) {
+        out[0] = (char)(0xE0 | (cp >> 12));
+        out[1] = (char)(0x80 | ((cp >> 6) & 0x3F));
+        out[2] = (char)(0x80 | (cp & 0x3F));
+        return 3;
+    }
+    out[0] = (char)(0xF0 | (cp >> 18));
+    out[1] = (char)(0x80 | ((cp >> 12) & 0x3F));
+    out[2] = (char)(0x80 | ((cp >> 6) & 0x3F));
+    out[3] = (char)(0x80 | (cp & 0x3F));
+    return 4;
+}
+
+static bool readHex4(const char* s, size_t remaining, uint32_t& out) {
+    if (remaining < 4) return false;
+    out = 0;
+    for (int i = 0; i < 4; i++) {
+        char c = s[i];
+        uint32_t v;
+        if (c >= '0' && c <= '9') v = c - '0';
+        else if (c >= 'a' && c <= 'f') v = c - 'a' + 10;
+        else if (c >= 'A' && c <= 'F') v = c - 'A' + 10;
+        else return false;
+        out = (out << 4) | v;
+    }
+    return true;
+}
+
+// Decode one (possibly escaped) character at src[i], advancing i.
+// Writes 1-4 UTF-8 bytes to out and returns the count.
+static size_t decodeChar(const char* src, size_t length, size_t& i, char* out) {
+    char c = src[i++];
+    if (c != '\\' || i >= length) {
+        out[0] = c;
+        return 1;
+    }
+
+    char e = src[i++];
+    switch (e) {
+        case 'n': out[0] = '\n'; return 1;
+        case 't': out[0] = '\t'; return 1;
+        case 'r': out[0] = '\r'; return 1;
+        case 'b': out[0] = '\b'; return 1;
+        case 'f': out[0] = '\f'; return 1;
+        case 'u': {
+            uint32_t cp;
+            if (!readHex4(src + i, length - i, cp)) {
+                out[0] = 'u';
+                return 1;
+            }
+            i += 4;
+            // Surrogate pair (emoji etc.)
+            if (cp >= 0xD800 && cp <= 0xDBFF && i + 1 < length && src[i] == '\\' && src[i + 1] == 'u') {
+                uint32_t low;
+                if (readHex4(src + i + 2, length - i - 2, low) && low >= 0xDC00 && low <= 0xDFFF) {
+                    cp = 0x10000 + ((cp - 0xD800) << 10) + (low - 0xDC00);
+                    i += 6;
+                }
+            }
+            // NUL would end the C string / String early, a lone surrogate is not UTF-8
+            if (cp == 0 || (cp >= 0xD800 && cp <= 0xDFFF)) {
+                cp = 0xFFFD;
+            }
+            return encodeUtf8(cp, out);
+        }
+        default:
+            // \" \\ \/ and unknown escapes map to the char itself
+            out[0] = e;
+            return 1;
+    }
+}
+
+size_t JsonTokenizer::unescape(const char* src, size_t length, char* out, size_t capacity) {
+    if (capacity == 0) return 0;
+    size_t limit = capacity - 1;  // Keep room for terminator
+    size_t pos = 0;
+    size_t i = 0;
+    char buf[4];
+
+    while (i < length) {
+        size_t n = decodeChar(src, length, i, buf);
+        if (pos + n > limit) break;
+        memcpy(out + pos, buf, n);
+        pos += n;
+    }
+
+    out[pos] = '\0';
+    return pos;
+}
+
+size_t JsonTokenizer::copyString(const char* key, char* out, size_t capacity, int depth) const {
+    if (capacity == 0) return 0;
+    const JsonField* f = find(key, depth);
+    if (f == nullptr || f->type != JSON_STRING) {
+        out[0] = '\0';
+        return 0;
+    }
+    if (!f->escaped) {
+        size_t n = f->valueLength < capacity - 1 ? f->valueLength : capacity - 1;
+        memcpy(out, f->value, n);
+        out[n] = '\0';
+        return n;
+    }
+    return unescape(f->value, f->valueLength, out, capacity);
+}
+
+String JsonTokenizer::getString(const char* key, int depth) const {
+    const JsonField* f = find(key, depth);
+    String result;
+    if (f == nullptr || f->type != JSON_STRING || f->valueLength == 0) {
+        return result;
+    }
+    // Unescaped text is never longer than the raw value, so one reserve() is enough
+    result.reserve(f->valueLength);
+    if (!f->escaped) {
+        result.concat(f->value, f->valueLength);
+        return result;
+    }
+
+    // Decode into a small chunk and append by length, not as C strings
+    size_t i = 0;
+    char chunk[64];
+    size_t used = 0;
+    while (i < f->valueLength) {
+        if (used > sizeof(chunk) - 4) {
+            result.concat(chunk, used);
+            used = 0;
+        }
+        used += decodeChar(f->value, f->valueLength, i, chunk + used);
+    }
+    result.concat(chunk, used);
+    return result;
+}
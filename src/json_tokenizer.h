@@ -0,0 +1,98 @@
+#ifndef JSON_TOKENIZER_H
+#define JSON_TOKENIZER_H
+
+#include <Arduino.h>
+
+// Single-pass JSON tokenizer for incoming WebSocket frames.
+// Walks the payload in place (no copy, no heap) and records a flat list of
+// key/value views. Nested objects are tokenized too, tagged with their depth,
+// so {"type":"game_event","event":{"event_type":"move",...}} yields
+// "type" at depth 0 and "event_type" at depth 1.
+// Values stay pointing into the original buffer - the tokenizer is only valid
+// while that buffer is alive.
+
+enum JsonValueType : uint8_t {
+    JSON_NULL = 0,
+    JSON_BOOL,
+    JSON_NUMBER,
+    JSON_STRING,
+    JSON_OBJECT,
+    JSON_ARRAY
+};
+
+struct JsonField {
+    const char* key;        // Key bytes (without quotes)
+    const char* value;      // String: content without quotes, others: raw token
+    uint16_t keyLength;
+    uint16_t valueLength;
+    uint8_t type;           // JsonValueType
+    uint8_t depth;          // 0 = top-level object
+    bool escaped;           // String value contains backslash escapes
+};
+
+class JsonTokenizer {
+public:
+    static const int MAX_FIELDS = 32;
+    static const uint8_t MAX_DEPTH = 4;
+    static const int ANY_DEPTH = -1;
+
+    JsonTokenizer();
+
+    // Tokenize payload. Returns false on malformed JSON or when the frame has
+    // more than MAX_FIELDS keys (fields are cleared - never a partial frame).
+    bool parse(const uint8_t* data, size_t length);
+
+    // Last parse() failed because the field table was full, not on bad JSON
+    bool isOverflowed() const { return overflowed; }
+
+    int getFieldCount() const { return fieldCount; }
+    const JsonField& getField(int index) const { return fields[index]; }
+
+    // FNV-1a hash of the top-level "type" string (0 if missing)
+    uint32_t getTypeHash() const { return typeHash; }
+
+    // Lookup helpers - depth = ANY_DEPTH returns first match at any level
+    const JsonField* find(const char* key, int depth = ANY_DEPTH) const;
+    bool has(const char* key, int depth = ANY_DEPTH) const { return find(key, depth) != nullptr; }
+    int getInt(const char* key, int defaultValue = 0, int depth = ANY_DEPTH) const;
+    bool getBool(const char* key, bool defaultValue = false, int depth = ANY_DEPTH) const;
+    bool valueEquals(const char* key, const char* literal, int depth = ANY_DEPTH) const;
+
+    // Copy unescaped string value into caller buffer (always null-terminated).
+    // Returns number of bytes written (excluding terminator).
+    size_t copyString(const char* key, char* out, size_t capacity, int depth = ANY_DEPTH) const;
+
+    // Build an Arduino String (only used at callback boundaries).
+    // \u0000 becomes U+FFFD here and in copyString() - a NUL would cut the text short.
+    String getString(const char* key, int depth = ANY_DEPTH) const;
+
+    // Hash helpers - hashOf() is constexpr so it can be used as a switch label
+    static constexpr uint32_t hashOf(const char* s, uint32_t h = 2166136261u) {
+        return *s ? hashOf(s + 1, (h ^ (uint8_t)*s) * 16777619u) : h;
+    }
+    static uint32_t hashBytes(const char* s, size_t length);
+
+    static size_t unescape(const char* src, size_t length, char* out, size_t capacity);
+    static int parseIntView(const char* s, size_t length, int defaultValue);
+
+private:
+    friend class WireCodec;  // Fills fields from binary frames
+
+    JsonField fields[MAX_FIELDS];
+    int fieldCount;
+    uint32_t typeHash;
+    bool overflowed;
+
+    // Scanner state (valid only during parse())
+    const char* cur;
+    const char* end;
+
+    void skipWhitespace();
+    bool scanString(const char*& start, uint16_t& length, bool& escaped);
+    bool parseObject(uint8_t depth);
+    bool parseValue(JsonField& field, uint8_t depth);
+    bool skipComposite();
+    bool matchLiteral(const char* literal);
+};
+
+#endif
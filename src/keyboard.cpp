@@ -1,5 +1,7 @@
 #include <Arduino.h>
 #include "keyboard.h"
+#include "tft_compositor.h"
+#include "profiler.h"
 #include "keyboard_skins_wrapper.h"  // Include wrapper để có KeyboardSkins namespace
 #include <Adafruit_GFX.h>
 #include <Adafruit_ST7789.h>
@@ -90,6 +92,8 @@ Keyboard::~Keyboard() {
 }
 
 void Keyboard::draw() {
+    Profiler::Scope profile("Keyboard.draw");
+    TftCompositor::Frame frame("Keyboard");
     // Don't draw if drawing is disabled (e.g., when social screen is active)
     if (!drawingEnabled) {
         return;
@@ -1,4 +1,6 @@
 #include "login_screen.h"
+#include "tft_compositor.h"
+#include "profiler.h"
 #include "api_client.h"
 
 // Static instance pointer for callbacks
@@ -200,6 +202,8 @@ void LoginScreen::drawSuccessScreen() {
 }
 
 void LoginScreen::draw() {
+    Profiler::Scope profile("LoginScreen.draw");
+    TftCompositor::Frame frame("LoginScreen");
     // If confirmation dialog is visible, never allow the keyboard to redraw on top
     const bool dialogVisible = (confirmationDialog && confirmationDialog->isVisible());
     if (keyboard != nullptr) {
@@ -20,6 +20,11 @@
 #include "caro_game_screen.h"
 #include "game_lobby_screen.h"
 #include "auto_navigator.h"
+#include "tft_compositor.h"
+#include "task_layout.h"
+#include "input_capture.h"
+#include "profiler.h"
+#include "api_request_queue.h"
 
 // ST7789 pins
 #define TFT_CS    15   // CS pin
@@ -44,7 +49,8 @@
 // Set to 1 to print VR1 ADC readings to Serial (throttled)
 #define VR_NAV_DEBUG 0
 
-Adafruit_ST7789 tft = Adafruit_ST7789(&SPI, TFT_CS, TFT_DC, TFT_RST);
+// Screens still see an Adafruit_ST7789*; drawing goes through the damage-tracking shadow
+TftCompositor tft(&SPI, TFT_CS, TFT_DC, TFT_RST);
 Keyboard* keyboard;
 WiFiManager* wifiManager;
 LoginScreen* loginScreen;
@@ -58,134 +64,85 @@ int currentChatFriendUserId = -1;  // ID của friend đang chat (nếu ChatScre
 bool isSocialScreenActive = false;
 bool hasTransitionedToLogin = false;  // Track if we've already transitioned to login screen
 
-// Button state tracking (debounce + auto-detect active level by sampling idle state at boot)
-struct ButtonDebounce {
-    uint8_t pin;
-    bool idleState;              // sampled at boot
-    bool stableState;            // debounced current state
-    bool lastReading;            // last raw reading
-    unsigned long lastChangeMs;  // last time raw reading changed
-};
+// Buttons and encoder: GPIO interrupts capture every edge with its timestamp
+// (input_capture.h), handleHardwareInputs() decodes them once per loop().
+// Idle level of each button is sampled at boot to auto-detect the active level.
+static const unsigned long DEBOUNCE_DELAY = 50;  // 50ms debounce (measured between edge timestamps)
+InputDecoder inputDecoder;
 
-static const unsigned long DEBOUNCE_DELAY = 50;  // 50ms debounce
-ButtonDebounce btnUp   = { BTN_UP,   true, true, true, 0 };
-ButtonDebounce btnDown = { BTN_DOWN, true, true, true, 0 };
-ButtonDebounce btnSelect = { BTN_SELECT, true, true, true, 0 };
-
-// Encoder state tracking
-int lastEncoderCLK = HIGH;
-int lastEncoderDT = HIGH;
-unsigned long lastEncoderTime = 0;
-const unsigned long ENCODER_DEBOUNCE = 5;  // 5ms debounce
+// Avoid conflicts if encoder pins overlap with button pins
+static const bool ENCODER_ENABLED =
+    (ENCODER_CLK != BTN_UP) && (ENCODER_CLK != BTN_DOWN) && (ENCODER_CLK != BTN_SELECT) &&
+    (ENCODER_DT != BTN_UP) && (ENCODER_DT != BTN_DOWN) && (ENCODER_DT != BTN_SELECT);
 
 // Forward declaration
 void onKeyboardKeySelected(const String& key);
 
-static void initButton(ButtonDebounce& b) {
-    bool r = digitalRead(b.pin);
-    b.idleState = r;
-    b.stableState = r;
-    b.lastReading = r;
-    b.lastChangeMs = millis();
-}
-
-// Returns true only on a debounced PRESS (state deviates from idle)
-static bool readButtonPressed(ButtonDebounce& b) {
-    bool reading = digitalRead(b.pin);
-    unsigned long now = millis();
+// Select button:
+// - Short press -> "select"
+// - Hold 2 seconds -> "exit" (fires once, does not also trigger "select")
+// Hold time comes from the edge timestamps, so a loop() stall can't turn one into the other.
+static uint32_t selectPressMicros = 0;
+static bool selectLongFired = false;
+static bool selectPendingClick = false;
 
-    if (reading != b.lastReading) {
-        b.lastReading = reading;
-        b.lastChangeMs = now;
-    }
-
-    if ((now - b.lastChangeMs) < DEBOUNCE_DELAY) {
-        return false;
-    }
-
-    if (reading != b.stableState) {
-        b.stableState = reading;
-        // Press = stable state differs from idle state
-        return (b.stableState != b.idleState);
-    }
-
-    return false;
-}
-
-// Function to read rotary encoder
-void readEncoder() {
-    int clkState = digitalRead(ENCODER_CLK);
-    int dtState = digitalRead(ENCODER_DT);
-    unsigned long now = millis();
-    
-    // Debounce
-    if (now - lastEncoderTime < ENCODER_DEBOUNCE) {
-        return;
-    }
-    
-    if (clkState != lastEncoderCLK) {
-        lastEncoderTime = now;
-        if (dtState != clkState) {
-            // Clockwise rotation -> Right
+static void dispatchInputAction(const InputDecoder::Action& action, uint32_t nowMicros) {
+    InputCapture::noteLatency(nowMicros - action.edgeMicros);
+    switch (action.key) {
+        case InputDecoder::KEY_UP_PRESS:
+            onKeyboardKeySelected("up");
+            break;
+        case InputDecoder::KEY_DOWN_PRESS:
+            onKeyboardKeySelected("down");
+            break;
+        case InputDecoder::KEY_RIGHT:
             onKeyboardKeySelected("right");
-        } else {
-            // Counter-clockwise rotation -> Left
+            break;
+        case InputDecoder::KEY_LEFT:
             onKeyboardKeySelected("left");
-        }
+            break;
+        case InputDecoder::KEY_SELECT_PRESS:
+            selectPressMicros = action.edgeMicros;
+            selectLongFired = false;
+            selectPendingClick = true;
+            break;
+        case InputDecoder::KEY_SELECT_RELEASE:
+            if (selectPendingClick && !selectLongFired) {
+                bool heldLong = (action.edgeMicros - selectPressMicros) >= 2000000UL;
+                onKeyboardKeySelected(heldLong ? "exit" : "select");
+            }
+            selectLongFired = false;
+            selectPendingClick = false;
+            break;
     }
-    
-    lastEncoderCLK = clkState;
-    lastEncoderDT = dtState;
 }
 
 // Function to handle hardware buttons and encoder
 void handleHardwareInputs() {
-    // Read Up button (GPIO36) - map to "up"
-    if (readButtonPressed(btnUp)) {
-        onKeyboardKeySelected("up");
-    }
-    
-    // Read Down button (GPIO39) - map to "down"
-    if (readButtonPressed(btnDown)) {
-        onKeyboardKeySelected("down");
-    }
-
-    // Select button:
-    // - Short press -> "select"
-    // - Hold 2 seconds -> "exit" (fires once, does not also trigger "select")
-    readButtonPressed(btnSelect);  // update debounce state every loop
-    static bool selectWasHeld = false;
-    static unsigned long selectHoldStartMs = 0;
-    static bool selectLongFired = false;
-    static bool selectPendingClick = false;
-    const bool selectHeld = (btnSelect.stableState != btnSelect.idleState);
-    const unsigned long nowMs2 = millis();
-
-    if (selectHeld && !selectWasHeld) {
-        // press edge
-        selectHoldStartMs = nowMs2;
-        selectLongFired = false;
-        selectPendingClick = true;
-    }
+    TaskLayout::noteInputPoll();
+    
+    // Edges captured since the last loop, decoded in the order they happened.
+    // Buttons settle against "now" only once every captured edge has been fed.
+    InputDecoder::Action actions[InputDecoder::MAX_ACTIONS];
+    bool drained;
+    do {
+        drained = InputCapture::drain(inputDecoder);
+        const uint32_t nowMicros = micros();
+        const int actionCount = drained
+            ? inputDecoder.poll(nowMicros, actions, InputDecoder::MAX_ACTIONS)
+            : inputDecoder.take(actions, InputDecoder::MAX_ACTIONS);
+        for (int i = 0; i < actionCount; i++) {
+            dispatchInputAction(actions[i], nowMicros);
+        }
+    } while (!drained);
 
-    if (selectHeld && !selectLongFired && selectHoldStartMs != 0 && (nowMs2 - selectHoldStartMs) >= 2000) {
+    if (selectPendingClick && !selectLongFired && inputDecoder.isPressed(InputDecoder::LINE_SELECT) &&
+        (micros() - selectPressMicros) >= 2000000UL) {
         onKeyboardKeySelected("exit");
         selectLongFired = true;
         selectPendingClick = false;
     }
 
-    if (!selectHeld && selectWasHeld) {
-        // release edge
-        if (selectPendingClick && !selectLongFired) {
-            onKeyboardKeySelected("select");
-        }
-        selectHoldStartMs = 0;
-        selectLongFired = false;
-        selectPendingClick = false;
-    }
-
-    selectWasHeld = selectHeld;
-
     // Read analog value from GPIO 32 (VR1 net ADC, 0-4095)
     // Average more samples to reduce noise (helps consistent stepping)
     int vrValue = 0;
@@ -255,15 +212,6 @@ void handleHardwareInputs() {
             vrAcc += step;
         }
     }
-    
-    // Read rotary encoder
-    // Avoid conflicts if encoder pins overlap with button pins
-    const bool encoderEnabled =
-        (ENCODER_CLK != BTN_UP) && (ENCODER_CLK != BTN_DOWN) && (ENCODER_CLK != BTN_SELECT) &&
-        (ENCODER_DT != BTN_UP) && (ENCODER_DT != BTN_DOWN) && (ENCODER_DT != BTN_SELECT);
-    if (encoderEnabled) {
-        readEncoder();
-    }
 }
 
 // Function to handle Serial input for navigation
@@ -315,11 +263,23 @@ void handleSerialNavigation() {
         } else if (command == "exit" || command == "x" || command == "back" || command == "b") {
             Serial.println("Serial: Received EXIT command");
             onKeyboardKeySelected("exit");
+        } else if (command == "tasks") {
+            TaskLayout::printReport();
+            InputCapture::printStats();
+        } else if (command == "prof") {
+            Profiler::printReport();
+        } else if (command == "prof csv") {
+            Profiler::setCsvStreaming(!Profiler::isCsvStreaming());
+        } else if (command == "prof overlay") {
+            Profiler::setOverlay(&tft, !Profiler::isOverlayEnabled());
+        } else if (command == "prof reset") {
+            Profiler::reset();
+            Serial.println("Profiler: Totals reset");
         } else if (command.length() > 0) {
             // Unknown command
             Serial.print("Serial: Unknown command: ");
             Serial.println(command);
-            Serial.println("Serial: Available commands: up/u, down/d, left/l, right/r, select/s/enter/e, exit/x/back/b");
+            Serial.println("Serial: Available commands: up/u, down/d, left/l, right/r, select/s/enter/e, exit/x/back/b, tasks, prof, prof csv, prof overlay, prof reset");
             Serial.println("Serial: Auto Navigator: auto:load:/path, auto:exec:commands, auto:start, auto:stop, auto:run, auto:status");
         }
     }
@@ -766,6 +726,13 @@ void onLoginSuccess() {
             // Initialize socket connection
             socketManager->begin("192.168.1.7", 8080, "/ws");
             
+            // Wi-Fi, WebSocket task and API worker hold their buffers now, so the
+            // headroom check sees the heap the shadow + strips really share.
+            // Falls back to direct drawing / blocking flushes if it is short.
+            if (!tft.isCompositing()) {
+                tft.beginCompositing(true);
+            }
+            
             // Set SocialScreen state để socket_manager có thể xử lý notification và badge
             if (socketManager != nullptr && socialScreen != nullptr) {
                 socketManager->setSocialScreen(socialScreen);
@@ -812,9 +779,14 @@ void onLoginSuccess() {
             });
             // Set callback for game events (invites/respond/ready)
             socketManager->setOnGameEventCallback(SocialScreen::onGameEvent);
-            socketManager->setOnGameMoveCallback([](int sessionId, int userId, int row, int col, const String& gameStatus, int winnerId, int currentTurn) {
+            socketManager->setOnGameMoveCallback([](int sessionId, int userId, int row, int col, const String& gameStatus, int winnerId, int currentTurn, int seq) {
+                if (socialScreen != nullptr) {
+                    socialScreen->onGameMoveReceived(sessionId, userId, row, col, gameStatus, winnerId, currentTurn, seq);
+                }
+            });
+            socketManager->setOnGameMoveAckCallback([](int sessionId, int seq, bool success, const String& message, const String& gameStatus, int winnerId, int currentTurn) {
                 if (socialScreen != nullptr) {
-                    socialScreen->onGameMoveReceived(sessionId, userId, row, col, gameStatus, winnerId, currentTurn);
+                    socialScreen->onGameMoveAckReceived(sessionId, seq, success, message, gameStatus, winnerId, currentTurn);
                 }
             });
             Serial.println("Main: Set user status update callback");
@@ -900,6 +872,9 @@ void clearWiFiCredentials() {
 void setup() {
     Serial.begin(115200);
     delay(200);
+    
+    // loop() runs in this task: input + drawing on the UI core (see task_layout.h)
+    TaskLayout::adoptCurrentTask(TaskLayout::ROLE_LOOP);
 
     // Initialize backlight (IO27) - must be HIGH to turn on
     pinMode(TFT_BLK, OUTPUT);
@@ -920,23 +895,30 @@ void setup() {
 
     Serial.println("Buttons initialized (Up: GPIO" + String(BTN_UP) + ", Down: GPIO" + String(BTN_DOWN) + ", Select: GPIO" + String(BTN_SELECT) + ")");
     // Sample idle state after pinMode so we can auto-detect active level
-    initButton(btnUp);
-    initButton(btnDown);
-    initButton(btnSelect);
+    inputDecoder.configureButton(InputDecoder::LINE_UP, digitalRead(BTN_UP), DEBOUNCE_DELAY * 1000UL);
+    inputDecoder.configureButton(InputDecoder::LINE_DOWN, digitalRead(BTN_DOWN), DEBOUNCE_DELAY * 1000UL);
+    inputDecoder.configureButton(InputDecoder::LINE_SELECT, digitalRead(BTN_SELECT), DEBOUNCE_DELAY * 1000UL);
     
     // Initialize rotary encoder pins (INPUT_PULLUP)
     pinMode(ENCODER_CLK, INPUT_PULLUP);
     pinMode(ENCODER_DT, INPUT_PULLUP);
-    lastEncoderCLK = digitalRead(ENCODER_CLK);
-    lastEncoderDT = digitalRead(ENCODER_DT);
-    Serial.println("Rotary encoder initialized (CLK: GPIO" + String(ENCODER_CLK) + ", DT: GPIO" + String(ENCODER_DT) + ")");
+    if (ENCODER_ENABLED) {
+        Serial.println("Rotary encoder initialized (CLK: GPIO" + String(ENCODER_CLK) + ", DT: GPIO" + String(ENCODER_DT) + ")");
+    } else {
+        Serial.println("Rotary encoder disabled (pins shared with buttons)");
+    }
+    
+    // GPIO36/39 can show short false pulses while the ADC or Wi-Fi powers up;
+    // the handler reads the level, and the decoder ignores edges that change nothing
+    InputCapture::begin(BTN_UP, BTN_DOWN, BTN_SELECT,
+                        ENCODER_ENABLED ? ENCODER_CLK : -1, ENCODER_ENABLED ? ENCODER_DT : -1);
 
     SPI.begin(TFT_SCLK, -1, TFT_MOSI, TFT_CS);
     SPI.setFrequency(27000000);
 
     tft.init(240, 320);     // Official Adafruit init
     tft.setRotation(3);  // Rotate -90 degrees (rotation 3: 320x240, origin at bottom left)
-    tft.fillScreen(ST77XX_BLACK);
+    tft.fillScreen(ST77XX_BLACK);  // Direct drawing until the network is up (see onLoginSuccess)
 
     Serial.println("Display initialized: 240x320");
     Serial.println("WiFi Manager: Starting...");
@@ -979,6 +961,9 @@ void setup() {
     // Initialize Socket Manager
     socketManager = new SocketManager();
     
+    // Game/friends HTTP calls run on a worker task, results come back via poll() in loop()
+    ApiRequestQueue::begin(1);
+    
     // Initialize Auto Navigator
     autoNavigator = new AutoNavigator();
     autoNavigator->setCommandCallback(onKeyboardKeySelected);
@@ -998,8 +983,14 @@ void setup() {
 }
 
 void loop() {
+    uint32_t loopStartMicros = micros();
+    Profiler::beginLoop();
+    
     // Handle hardware buttons and encoder
-    handleHardwareInputs();
+    {
+        Profiler::Scope profile("input");
+        handleHardwareInputs();
+    }
     
     // Handle Serial navigation input
     handleSerialNavigation();
@@ -1009,8 +1000,21 @@ void loop() {
         autoNavigator->executeNext();
     }
     
+    // Deliver finished API requests (callbacks run here, on the main loop)
+    {
+        Profiler::Scope profile("api.poll");
+        ApiRequestQueue::poll();
+    }
+    
+    // Chat / presence / game frames decoded by the WebSocket task
+    if (socketManager != nullptr) {
+        Profiler::Scope profile("socket.dispatch");
+        socketManager->dispatchEvents();
+    }
+    
     // Update WiFi Manager state (check connection status)
     if (wifiManager != nullptr) {
+        Profiler::Scope profile("WiFiManager.update");
         wifiManager->update();
     }
     
@@ -1046,5 +1050,7 @@ void loop() {
         socialScreen->update();
     }
     
+    TaskLayout::addBusy(micros() - loopStartMicros);  // busy% of loopTask in the "tasks" report
+    Profiler::endLoop();  // Closes the window once a second (CSV line, overlay)
     delay(10);  // Fast polling for ultra real-time VR1 response
 }
@@ -1,4 +1,6 @@
 #include "nickname_screen.h"
+#include "tft_compositor.h"
+#include "profiler.h"
 
 // Deep Space Arcade Theme (matching Buddy List Screen)
 #define NICKNAME_BG_DARK   0x0042  // Deep Midnight Blue #020817
@@ -78,6 +80,8 @@ void NicknameScreen::updateInputArea(bool showErrorMsg) {
 }
 
 void NicknameScreen::draw() {
+    Profiler::Scope profile("NicknameScreen.draw");
+    TftCompositor::Frame frame("NicknameScreen");
     drawBackground();
 
     // Header bar matching BuddyListScreen style
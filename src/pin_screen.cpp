@@ -1,4 +1,6 @@
 #include "pin_screen.h"
+#include "tft_compositor.h"
+#include "profiler.h"
 
 // Deep Space Arcade Theme (matching Buddy List Screen)
 #define WIN_BG_DARK   0x0042  // Deep Midnight Blue #020817
@@ -158,6 +160,8 @@ void PinScreen::drawPinScreen() {
 }
 
 void PinScreen::draw() {
+    Profiler::Scope profile("PinScreen.draw");
+    TftCompositor::Frame frame("PinScreen");
     drawPinScreen();
 }
 
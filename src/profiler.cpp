@@ -0,0 +1,289 @@
+#include "profiler.h"
+#include "tft_compositor.h"
+
+Profiler::Section Profiler::sections[Profiler::MAX_SECTIONS];
+Profiler::Total Profiler::totals[Profiler::MAX_SECTIONS];
+int Profiler::sectionCount = 0;
+std::atomic<uint32_t> Profiler::counters[Profiler::COUNTER_COUNT];
+uint32_t Profiler::counterBase[Profiler::COUNTER_COUNT];
+uint32_t Profiler::counterReset[Profiler::COUNTER_COUNT];
+
+Profiler::Window Profiler::current;
+Profiler::Window Profiler::lastWindow;
+uint32_t Profiler::windowStartMillis = 0;
+uint32_t Profiler::loopStartMicros = 0;
+uint32_t Profiler::spiBase = 0;
+uint32_t Profiler::resetMillis = 0;
+uint64_t Profiler::totalLoopMicros = 0;
+uint32_t Profiler::totalLoops = 0;
+uint32_t Profiler::worstLoopMicros = 0;
+uint32_t Profiler::lowestHeapLargest = 0xFFFFFFFF;
+const char* Profiler::lastTopName = nullptr;
+uint32_t Profiler::lastTopMicros = 0;
+
+bool Profiler::csvStreaming = false;
+Adafruit_GFX* Profiler::overlayDisplay = nullptr;
+
+// Overlay box (text size 1 = 6x8 px glyphs)
+static const int16_t OVERLAY_CHARS = 21;
+static const int16_t OVERLAY_LINES = 4;
+static const int16_t OVERLAY_LINE_BUFFER = 64;  // Longest line with no field clamped (59)
+static const int16_t OVERLAY_W = OVERLAY_CHARS * 6 + 4;
+static const int16_t OVERLAY_H = OVERLAY_LINES * 9 + 3;
+static const uint16_t OVERLAY_BG = 0x0000;
+static const uint16_t OVERLAY_FG = 0x07E0;  // Green
+
+int Profiler::findSection(const char* name) {
+    for (int i = 0; i < sectionCount; i++) {
+        if (sections[i].name == name) {
+            return i;
+        }
+    }
+    // Same text from another translation unit may be a different pointer
+    for (int i = 0; i < sectionCount; i++) {
+        if (strcmp(sections[i].name, name) == 0) {
+            return i;
+        }
+    }
+    if (sectionCount >= MAX_SECTIONS) {
+        return -1;
+    }
+    sections[sectionCount] = {name, 0, 0, 0};
+    totals[sectionCount] = {0, 0, 0};
+    return sectionCount++;
+}
+
+void Profiler::record(int section, uint32_t micros) {
+    if (section < 0) return;
+    Section& s = sections[section];
+    s.calls++;
+    s.totalMicros += micros;
+    if (micros > s.maxMicros) s.maxMicros = micros;
+}
+
+uint32_t Profiler::spiBytesPushed() {
+    TftCompositor* compositor = TftCompositor::getInstance();
+    // Pass-through drawing isn't counted
+    return compositor != nullptr ? compositor->getTotalStats().pixelsPushed * 2 : 0;
+}
+
+void Profiler::sampleHeap(Window& window) {
+#ifdef ESP32
+    window.heapFree = ESP.getFreeHeap();
+    window.heapLargest = ESP.getMaxAllocHeap();
+    window.heapMin = ESP.getMinFreeHeap();
+#else
+    window.heapFree = 0;
+    window.heapLargest = 0;
+    window.heapMin = 0;
+#endif
+}
+
+void Profiler::beginLoop() {
+    loopStartMicros = micros();
+    if (windowStartMillis == 0) {
+        windowStartMillis = millis();
+        resetMillis = windowStartMillis;
+        spiBase = spiBytesPushed();
+    }
+}
+
+void Profiler::endLoop() {
+    uint32_t elapsed = micros() - loopStartMicros;
+    current.loops++;
+    current.loopTotalMicros += elapsed;
+    if (elapsed > current.loopMaxMicros) current.loopMaxMicros = elapsed;
+
+    uint32_t now = millis();
+    if (now - windowStartMillis >= PROFILER_WINDOW_MS) {
+        closeWindow(now);
+    }
+}
+
+void Profiler::closeWindow(uint32_t nowMillis) {
+    current.endMillis = nowMillis;
+    uint32_t spi = spiBytesPushed();
+    current.spiBytes = (spi >= spiBase) ? spi - spiBase : spi;  // Compositor stats were reset
+    spiBase = spi;
+    sampleHeap(current);
+    for (int i = 0; i < COUNTER_COUNT; i++) {
+        uint32_t value = counters[i].load(std::memory_order_relaxed);
+        current.counters[i] = value - counterBase[i];
+        counterBase[i] = value;
+    }
+
+    totalLoops += current.loops;
+    totalLoopMicros += current.loopTotalMicros;
+    if (current.loopMaxMicros > worstLoopMicros) worstLoopMicros = current.loopMaxMicros;
+    if (current.heapLargest < lowestHeapLargest) lowestHeapLargest = current.heapLargest;
+
+    lastWindow = current;
+    if (csvStreaming) {
+        printCsv();
+    }
+    lastTopName = nullptr;
+    lastTopMicros = 0;
+    for (int i = 0; i < sectionCount; i++) {
+        Section& s = sections[i];
+        Total& t = totals[i];
+        t.calls += s.calls;
+        t.totalMicros += s.totalMicros;
+        if (s.maxMicros > t.maxMicros) t.maxMicros = s.maxMicros;
+        if (s.calls > 0 && s.totalMicros >= lastTopMicros) {
+            lastTopName = s.name;
+            lastTopMicros = s.totalMicros;
+        }
+        s.calls = 0;
+        s.totalMicros = 0;
+        s.maxMicros = 0;
+    }
+
+    current = Window();
+    windowStartMillis = nowMillis;
+    if (overlayDisplay != nullptr) {
+        drawOverlay();  // Counted in the new window
+    }
+}
+
+void Profiler::printCsv() {
+    const Window& w = lastWindow;
+    char line[160];
+    snprintf(line, sizeof(line), "P,%u,%u,%u,%u,%u,%u,%u,%u,%u,%u,%u,%u,%u,%u",
+             (unsigned)w.endMillis, (unsigned)w.loops,
+             (unsigned)(w.loops > 0 ? w.loopTotalMicros / w.loops : 0), (unsigned)w.loopMaxMicros,
+             (unsigned)w.spiBytes, (unsigned)w.heapFree, (unsigned)w.heapLargest, (unsigned)w.heapMin,
+             (unsigned)w.counters[COUNTER_HTTP_REQUESTS], (unsigned)(w.counters[COUNTER_HTTP_MICROS] / 1000),
+             (unsigned)w.counters[COUNTER_WS_FRAMES_IN], (unsigned)w.counters[COUNTER_WS_BYTES_IN],
+             (unsigned)w.counters[COUNTER_WS_FRAMES_OUT], (unsigned)w.counters[COUNTER_WS_BYTES_OUT]);
+    Serial.println(line);
+    for (int i = 0; i < sectionCount; i++) {
+        const Section& s = sections[i];
+        if (s.calls == 0) continue;
+        snprintf(line, sizeof(line), "S,%u,%s,%u,%u,%u",
+                 (unsigned)w.endMillis, s.name, (unsigned)s.calls, (unsigned)s.totalMicros, (unsigned)s.maxMicros);
+        Serial.println(line);
+    }
+}
+
+void Profiler::setCsvStreaming(bool enabled) {
+    csvStreaming = enabled;
+    if (enabled) {
+        Serial.println("#P,ms,loops,loop_avg_us,loop_max_us,spi_bytes,heap_free,heap_largest,heap_min,"
+                       "http,http_ms,ws_in,ws_in_bytes,ws_out,ws_out_bytes");
+        Serial.println("#S,ms,section,calls,total_us,max_us");
+    }
+    Serial.print("Profiler: CSV stream ");
+    Serial.println(enabled ? "on" : "off");
+}
+
+void Profiler::setOverlay(Adafruit_GFX* display, bool enabled) {
+    overlayDisplay = enabled ? display : nullptr;
+    Serial.print("Profiler: Overlay ");
+    Serial.println(enabled ? "on" : "off");
+}
+
+// Overlay fields have fixed widths: a value past its field shows as the maximum
+static unsigned clampField(uint32_t value, unsigned max) {
+    return value < max ? (unsigned)value : max;
+}
+
+void Profiler::drawOverlay() {
+    Scope scope("Profiler.overlay");
+    TftCompositor::Frame frame("Profiler");
+
+    const Window& w = lastWindow;
+    uint32_t windowMs = PROFILER_WINDOW_MS;
+
+    // Clamped, every line fits OVERLAY_CHARS (times in 0.1 ms steps); the buffers
+    // still hold unclamped output, as the compiler can't always see the clamps
+    char lines[OVERLAY_LINES][OVERLAY_LINE_BUFFER];
+    unsigned loopAvg = clampField(w.loops > 0 ? w.loopTotalMicros / 100 / w.loops : 0, 999);
+    unsigned loopMax = clampField(w.loopMaxMicros / 100, 9999);
+    snprintf(lines[0], sizeof(lines[0]), "%3u/s %2u.%u %3u.%ums",
+             clampField(w.loops * 1000 / windowMs, 999), loopAvg / 10, loopAvg % 10, loopMax / 10, loopMax % 10);
+    snprintf(lines[1], sizeof(lines[1]), "heap %3uk blk %3uk",
+             clampField(w.heapFree / 1024, 9999), clampField(w.heapLargest / 1024, 9999));
+    snprintf(lines[2], sizeof(lines[2]), "spi%4uk h%2u ws%2u/%2u",  // h = HTTP requests
+             clampField(w.spiBytes / 1024, 9999), clampField(w.counters[COUNTER_HTTP_REQUESTS], 99),
+             clampField(w.counters[COUNTER_WS_FRAMES_IN], 99), clampField(w.counters[COUNTER_WS_FRAMES_OUT], 99));
+    if (lastTopName != nullptr) {
+        unsigned topMs = clampField(lastTopMicros / 100, 9999);
+        snprintf(lines[3], sizeof(lines[3]), "%-14.14s%4u.%u", lastTopName, topMs / 10, topMs % 10);
+    } else {
+        lines[3][0] = '\0';
+    }
+
+    int16_t x = overlayDisplay->width() - OVERLAY_W;
+    overlayDisplay->fillRect(x, 0, OVERLAY_W, OVERLAY_H, OVERLAY_BG);
+    overlayDisplay->setTextSize(1);
+    overlayDisplay->setTextColor(OVERLAY_FG, OVERLAY_BG);
+    for (int i = 0; i < OVERLAY_LINES; i++) {
+        overlayDisplay->setCursor(x + 2, 2 + i * 9);
+        overlayDisplay->print(lines[i]);
+    }
+}
+
+void Profiler::printReport() {
+    uint32_t now = millis();
+    uint32_t elapsedMs = now - resetMillis;
+    if (elapsedMs == 0) elapsedMs = 1;
+
+    Serial.print("Profiler: ");
+    Serial.print(elapsedMs / 1000);
+    Serial.print(" s, loops=");
+    Serial.print(totalLoops);
+    Serial.print(", avg loop=");
+    Serial.print(totalLoops > 0 ? (uint32_t)(totalLoopMicros / totalLoops) : 0);
+    Serial.print(" us, worst=");
+    Serial.print(worstLoopMicros);
+    Serial.println(" us");
+
+    Window heap;
+    sampleHeap(heap);
+    Serial.print("Profiler: heap free=");
+    Serial.print(heap.heapFree);
+    Serial.print(", largest=");
+    Serial.print(heap.heapLargest);
+    Serial.print(" (lowest seen ");
+    Serial.print(lowestHeapLargest == 0xFFFFFFFF ? heap.heapLargest : lowestHeapLargest);
+    Serial.print("), min free=");
+    Serial.println(heap.heapMin);
+
+    uint32_t totalCounters[COUNTER_COUNT];
+    for (int i = 0; i < COUNTER_COUNT; i++) {
+        totalCounters[i] = counters[i].load(std::memory_order_relaxed) - counterReset[i];
+    }
+    char line[112];
+    snprintf(line, sizeof(line), "Profiler: http=%u (%u ms), ws in=%u (%u B), ws out=%u (%u B)",
+             (unsigned)totalCounters[COUNTER_HTTP_REQUESTS], (unsigned)(totalCounters[COUNTER_HTTP_MICROS] / 1000),
+             (unsigned)totalCounters[COUNTER_WS_FRAMES_IN], (unsigned)totalCounters[COUNTER_WS_BYTES_IN],
+             (unsigned)totalCounters[COUNTER_WS_FRAMES_OUT], (unsigned)totalCounters[COUNTER_WS_BYTES_OUT]);
+    Serial.println(line);
+
+    // Closed windows only; share = section time / loop time
+    Serial.println("Profiler: section                calls   avg us   max us  loop%");
+    for (int i = 0; i < sectionCount; i++) {
+        const Total& t = totals[i];
+        if (t.calls == 0) continue;
+        snprintf(line, sizeof(line), "  %-22s %7u %8u %8u %6.1f",
+                 sections[i].name, (unsigned)t.calls, (unsigned)(t.totalMicros / t.calls), (unsigned)t.maxMicros,
+                 totalLoopMicros > 0 ? (float)(t.totalMicros * 100.0 / totalLoopMicros) : 0.0f);
+        Serial.println(line);
+    }
+}
+
+void Profiler::reset() {
+    for (int i = 0; i < sectionCount; i++) {
+        totals[i].calls = 0;
+        totals[i].totalMicros = 0;
+        totals[i].maxMicros = 0;
+    }
+    for (int i = 0; i < COUNTER_COUNT; i++) {
+        counterReset[i] = counters[i].load(std::memory_order_relaxed);
+    }
+    resetMillis = millis();
+    totalLoopMicros = 0;
+    totalLoops = 0;
+    worstLoopMicros = 0;
+    lowestHeapLargest = 0xFFFFFFFF;
+}
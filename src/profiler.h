@@ -0,0 +1,151 @@
+#ifndef PROFILER_H
+#define PROFILER_H
+
+#include <Arduino.h>
+#include <Adafruit_GFX.h>
+#include <atomic>
+
+// Frame-time, heap and traffic instrumentation.
+//
+// - Sections: Profiler::Scope times a block under a name (a string literal,
+//   matched by pointer). Screens open one at the top of draw()/update(),
+//   before their TftCompositor::Frame, so a draw's time includes its flush.
+//   Nested scopes count inclusive time (SocialScreen.draw includes
+//   Keyboard.draw). Sections are for the loop task only.
+// - Counters: HTTP leases and WebSocket frames/bytes, bumped from any task.
+// - Every PROFILER_WINDOW_MS, endLoop() closes a window: loop count and time,
+//   bytes the compositor pushed over SPI, free heap / largest block / lowest
+//   free heap, counter deltas and each section's calls/total/max.
+//
+// A closed window goes to the Serial CSV stream (setCsvStreaming) and to the
+// on-screen overlay (setOverlay), both off by default. CSV lines:
+//   P,ms,loops,loop_avg_us,loop_max_us,spi_bytes,heap_free,heap_largest,heap_min,
+//     http,http_ms,ws_in,ws_in_bytes,ws_out,ws_out_bytes
+//   S,ms,section,calls,total_us,max_us        (sections that ran in the window)
+// server/scripts/profile_report.py turns a captured log into a report.
+//
+// Build with -DPROFILER_ENABLED=0 to compile every Scope and count() out.
+#ifndef PROFILER_ENABLED
+#define PROFILER_ENABLED 1
+#endif
+#ifndef PROFILER_WINDOW_MS
+#define PROFILER_WINDOW_MS 1000
+#endif
+
+class Profiler {
+public:
+    enum Counter {
+        COUNTER_HTTP_REQUESTS = 0,
+        COUNTER_HTTP_MICROS,      // Time requests held their connection lease
+        COUNTER_WS_FRAMES_IN,
+        COUNTER_WS_BYTES_IN,
+        COUNTER_WS_FRAMES_OUT,
+        COUNTER_WS_BYTES_OUT,
+        COUNTER_COUNT
+    };
+
+    static const int MAX_SECTIONS = 32;
+
+    struct Section {
+        const char* name;
+        uint32_t calls;
+        uint32_t totalMicros;
+        uint32_t maxMicros;
+    };
+
+    struct Window {
+        uint32_t endMillis;
+        uint32_t loops;
+        uint32_t loopTotalMicros;
+        uint32_t loopMaxMicros;
+        uint32_t spiBytes;
+        uint32_t heapFree;
+        uint32_t heapLargest;     // Largest allocatable block
+        uint32_t heapMin;         // Lowest free heap since boot
+        uint32_t counters[COUNTER_COUNT];
+    };
+
+    class Scope {
+    public:
+#if PROFILER_ENABLED
+        explicit Scope(const char* name) : section(findSection(name)), startMicros(micros()) {}
+        ~Scope() { record(section, micros() - startMicros); }
+    private:
+        int section;
+        uint32_t startMicros;
+#else
+        explicit Scope(const char*) {}
+#endif
+    };
+
+    static void count(Counter counter, uint32_t amount = 1) {
+#if PROFILER_ENABLED
+        counters[counter].fetch_add(amount, std::memory_order_relaxed);
+#else
+        (void)counter;
+        (void)amount;
+#endif
+    }
+
+    // Index of the named section, added on first use (-1 once the table is full)
+    static int findSection(const char* name);
+    static void record(int section, uint32_t micros);
+
+    // Around each loop() iteration; endLoop() closes the window when it is due
+    static void beginLoop();
+    static void endLoop();
+
+    // CSV stream over Serial (prints the column header when turned on)
+    static void setCsvStreaming(bool enabled);
+    static bool isCsvStreaming() { return csvStreaming; }
+
+    // Overlay box in the top-right corner, redrawn once per window. Turning it
+    // off leaves the box until the screen underneath next repaints it.
+    static void setOverlay(Adafruit_GFX* display, bool enabled);
+    static bool isOverlayEnabled() { return overlayDisplay != nullptr; }
+
+    static const Window& getLastWindow() { return lastWindow; }
+
+    // Totals since boot (or the last reset): per-section calls/avg/max/share of
+    // loop time, worst loop, lowest heap, counters
+    static void printReport();
+    static void reset();
+
+private:
+    struct Total {
+        uint32_t calls;
+        uint64_t totalMicros;
+        uint32_t maxMicros;
+    };
+
+    static Section sections[MAX_SECTIONS];   // Current window
+    static Total totals[MAX_SECTIONS];       // Closed windows since reset
+    static int sectionCount;
+    static std::atomic<uint32_t> counters[COUNTER_COUNT];
+    static uint32_t counterBase[COUNTER_COUNT];   // Values at the window start
+    static uint32_t counterReset[COUNTER_COUNT];  // Values at reset()
+
+    static Window current;
+    static Window lastWindow;
+    static uint32_t windowStartMillis;
+    static uint32_t loopStartMicros;
+    static uint32_t spiBase;
+    static uint32_t resetMillis;
+    static uint64_t totalLoopMicros;
+    static uint32_t totalLoops;
+    static uint32_t worstLoopMicros;
+    static uint32_t lowestHeapLargest;
+    static const char* lastTopName;          // Busiest section of the last window
+    static uint32_t lastTopMicros;
+
+    static bool csvStreaming;
+    static Adafruit_GFX* overlayDisplay;
+
+    static uint32_t spiBytesPushed();
+    static void sampleHeap(Window& window);
+    static void closeWindow(uint32_t nowMillis);
+    static void printCsv();
+    static void drawOverlay();
+};
+
+#endif
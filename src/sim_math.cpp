@@ -0,0 +1,84 @@
+#include "sim_math.h"
+
+// sin(i * (pi/2) / 128) in Q16.16, i = 0..128
+static const int32_t QUARTER_SINE[129] = {
+    0, 804, 1608, 2412, 3216, 4019, 4821, 5623,
+    6424, 7224, 8022, 8820, 9616, 10411, 11204, 11996,
+    12785, 13573, 14359, 15143, 15924, 16703, 17479, 18253,
+    19024, 19792, 20557, 21320, 22078, 22834, 23586, 24335,
+    25080, 25821, 26558, 27291, 28020, 28745, 29466, 30182,
+    30893, 31600, 32303, 33000, 33692, 34380, 35062, 35738,
+    36410, 37076, 37736, 38391, 39040, 39683, 40320, 40951,
+    41576, 42194, 42806, 43412, 44011, 44604, 45190, 45769,
+    46341, 46906, 47464, 48015, 48559, 49095, 49624, 50146,
+    50660, 51166, 51665, 52156, 52639, 53114, 53581, 54040,
+    54491, 54934, 55368, 55794, 56212, 56621, 57022, 57414,
+    57798, 58172, 58538, 58896, 59244, 59583, 59914, 60235,
+    60547, 60851, 61145, 61429, 61705, 61971, 62228, 62476,
+    62714, 62943, 63162, 63372, 63572, 63763, 63944, 64115,
+    64277, 64429, 64571, 64704, 64827, 64940, 65043, 65137,
+    65220, 65294, 65358, 65413, 65457, 65492, 65516, 65531,
+    65536,
+};
+
+// 2^32 / (2*pi): radians (Q16.16) -> turns with 16 fractional bits
+static const int64_t RADIANS_TO_TURNS = 683565276LL;
+
+// p = 0..16384 within one quarter turn
+static int32_t quarterSine(uint32_t p) {
+    uint32_t index = p >> 7;
+    if (index >= 128) {
+        return QUARTER_SINE[128];
+    }
+    int32_t a = QUARTER_SINE[index];
+    int32_t b = QUARTER_SINE[index + 1];
+    return a + (((b - a) * (int32_t)(p & 127)) >> 7);
+}
+
+// u = angle in 1/65536 turns (wraps naturally)
+static int32_t sineOfTurns(uint32_t u) {
+    u &= 0xFFFF;
+    uint32_t quadrant = u >> 14;
+    uint32_t p = u & 0x3FFF;
+    switch (quadrant) {
+        case 0: return quarterSine(p);
+        case 1: return quarterSine(16384 - p);
+        case 2: return -quarterSine(p);
+        default: return -quarterSine(16384 - p);
+    }
+}
+
+static uint32_t toTurns(Fixed16 radians) {
+    return (uint32_t)(((int64_t)radians.getRaw() * RADIANS_TO_TURNS + (1LL << 31)) >> 32);
+}
+
+Fixed16 simSin(Fixed16 radians) {
+    return Fixed16::fromRaw(sineOfTurns(toTurns(radians)));
+}
+
+Fixed16 simCos(Fixed16 radians) {
+    return Fixed16::fromRaw(sineOfTurns(toTurns(radians) + 16384));
+}
+
+Fixed16 simSqrt(Fixed16 v) {
+    if (v.getRaw() <= 0) {
+        return Fixed16();
+    }
+    // sqrt(raw / 2^16) * 2^16 == sqrt(raw << 16); bit-by-bit integer sqrt
+    uint64_t n = (uint64_t)v.getRaw() << Fixed16::FRAC_BITS;
+    uint64_t result = 0;
+    uint64_t bit = 1ULL << 46;  // Highest power of 4 <= 2^47
+    while (bit > n) {
+        bit >>= 2;
+    }
+    while (bit != 0) {
+        if (n >= result + bit) {
+            n -= result + bit;
+            result = (result >> 1) + bit;
+        } else {
+            result >>= 1;
+        }
+        bit >>= 2;
+    }
+    return Fixed16::fromRaw((int32_t)result);
+}
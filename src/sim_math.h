@@ -0,0 +1,85 @@
+#ifndef SIM_MATH_H
+#define SIM_MATH_H
+
+#include <Arduino.h>
+#include <math.h>
+
+// Numeric type for game simulations (billiard physics, gunny projectile).
+//
+// Default build: sim_t is float, simSin/simCos/simSqrt map to sinf/cosf/sqrtf.
+// Build with -DSIM_FIXED_POINT: sim_t is Fixed16 (Q16.16 in an int32_t) and
+// trig comes from a quarter-wave lookup table, so a simulation produces the
+// same bits on the ESP32 and on a host build.
+//
+// Q16.16 range is +-32767 with 1/65536 resolution: keep squared distances
+// small (prune with |dx|, |dy| first) before multiplying.
+//
+// Rendering code stays in float/int: read sim_t with (float)x or (int)x.
+
+class Fixed16 {
+public:
+    static const int FRAC_BITS = 16;
+    static const int32_t ONE = 1 << FRAC_BITS;
+
+    constexpr Fixed16() : raw(0) {}
+    constexpr Fixed16(int v) : raw((int32_t)((uint32_t)v << FRAC_BITS)) {}
+    constexpr Fixed16(float v) : raw((int32_t)(v * 65536.0f + (v >= 0 ? 0.5f : -0.5f))) {}
+    constexpr Fixed16(double v) : raw((int32_t)(v * 65536.0 + (v >= 0 ? 0.5 : -0.5))) {}
+
+    static Fixed16 fromRaw(int32_t r) { Fixed16 f; f.raw = r; return f; }
+    int32_t getRaw() const { return raw; }
+
+    // Truncates toward zero like (int) on a float
+    explicit operator int() const { return raw >= 0 ? (raw >> FRAC_BITS) : -((-raw) >> FRAC_BITS); }
+    explicit operator float() const { return raw / 65536.0f; }
+
+    Fixed16 operator-() const { return fromRaw(-raw); }
+    Fixed16& operator+=(Fixed16 o) { raw += o.raw; return *this; }
+    Fixed16& operator-=(Fixed16 o) { raw -= o.raw; return *this; }
+    Fixed16& operator*=(Fixed16 o) { raw = mulRaw(raw, o.raw); return *this; }
+    Fixed16& operator/=(Fixed16 o) { raw = divRaw(raw, o.raw); return *this; }
+
+    friend Fixed16 operator+(Fixed16 a, Fixed16 b) { return fromRaw(a.raw + b.raw); }
+    friend Fixed16 operator-(Fixed16 a, Fixed16 b) { return fromRaw(a.raw - b.raw); }
+    friend Fixed16 operator*(Fixed16 a, Fixed16 b) { return fromRaw(mulRaw(a.raw, b.raw)); }
+    friend Fixed16 operator/(Fixed16 a, Fixed16 b) { return fromRaw(divRaw(a.raw, b.raw)); }
+
+    friend bool operator==(Fixed16 a, Fixed16 b) { return a.raw == b.raw; }
+    friend bool operator!=(Fixed16 a, Fixed16 b) { return a.raw != b.raw; }
+    friend bool operator<(Fixed16 a, Fixed16 b) { return a.raw < b.raw; }
+    friend bool operator<=(Fixed16 a, Fixed16 b) { return a.raw <= b.raw; }
+    friend bool operator>(Fixed16 a, Fixed16 b) { return a.raw > b.raw; }
+    friend bool operator>=(Fixed16 a, Fixed16 b) { return a.raw >= b.raw; }
+
+private:
+    int32_t raw;
+
+    // Round to nearest so positive and negative values decay alike under friction
+    static int32_t mulRaw(int32_t a, int32_t b) {
+        return (int32_t)(((int64_t)a * b + (1 << (FRAC_BITS - 1))) >> FRAC_BITS);
+    }
+    static int32_t divRaw(int32_t a, int32_t b) {
+        if (b == 0) return a >= 0 ? INT32_MAX : INT32_MIN;
+        return (int32_t)(((int64_t)a << FRAC_BITS) / b);
+    }
+};
+
+Fixed16 simSqrt(Fixed16 v);
+Fixed16 simSin(Fixed16 radians);
+Fixed16 simCos(Fixed16 radians);
+inline Fixed16 simAbs(Fixed16 v) { return v < Fixed16() ? -v : v; }
+
+inline float simSqrt(float v) { return sqrtf(v); }
+inline float simSin(float radians) { return sinf(radians); }
+inline float simCos(float radians) { return cosf(radians); }
+inline float simAbs(float v) { return fabsf(v); }
+
+#ifdef SIM_FIXED_POINT
+typedef Fixed16 sim_t;
+#else
+typedef float sim_t;
+#endif
+
+static const sim_t SIM_DEG_TO_RAD = sim_t(0.017453292519943295);
+
+#endif
@@ -1,4 +1,6 @@
 #include "social_screen.h"
+#include "tft_compositor.h"
+#include "profiler.h"
 #include "game_lobby_screen.h"
 #include "caro_game_screen.h"
 
@@ -83,6 +85,7 @@ SocialScreen::SocialScreen(Adafruit_ST7789* tft, Keyboard* keyboard) {
     this->confirmationDialog = new ConfirmationDialog(tft);
     this->gameLobby = new GameLobbyScreen(tft, themeDeepSpace);
     this->caroGameScreen = nullptr;
+    this->socketManager = nullptr;
     
     // Set up game lobby callbacks
     this->gameLobby->setOnStartGame([]() {
@@ -248,6 +251,7 @@ bool SocialScreen::isFriendOnline(int friendUserId) const {
 }
 
 SocialScreen::~SocialScreen() {
+    ApiRequestQueue::cancel(this);
     clearFriends();
     clearNotifications();
     if (miniAddFriend != nullptr) {
@@ -882,6 +886,8 @@ void SocialScreen::drawContentArea() {
 }
 
 void SocialScreen::draw() {
+    Profiler::Scope profile("SocialScreen.draw");
+    TftCompositor::Frame frame("SocialScreen");
     if (screenState == STATE_PLAYING_GAME) {
         if (caroGameScreen != nullptr) {
             caroGameScreen->draw();
@@ -2342,7 +2348,19 @@ void SocialScreen::loadFriends() {
     }
     
     Serial.println("Social Screen: Loading friends list...");
-    String friendsString = ApiClient::getFriendsList(userId, serverHost, serverPort);
+    // HTTP runs on the API worker task, the list is applied in onFriendsListLoaded()
+    ApiRequestQueue::getFriendsList(userId, serverHost, serverPort, onFriendsListLoaded, this);
+}
+
+void SocialScreen::onFriendsListLoaded(bool success, const String& friendsString, void* context) {
+    ((SocialScreen*)context)->applyFriendsList(success, friendsString);
+}
+
+void SocialScreen::applyFriendsList(bool success, const String& friendsString) {
+    if (!success) {
+        Serial.println("Social Screen: Friends list request not sent, keeping current list");
+        return;
+    }
     
     if (friendsString.length() > 0) {
         Serial.print("Social Screen: Received friends string: ");
@@ -2522,6 +2540,7 @@ void SocialScreen::startGame() {
     if (caroGameScreen == nullptr) {
         caroGameScreen = new CaroGameScreen(tft, currentTheme);
     }
+    caroGameScreen->setSocketManager(socketManager);  // Moves go over the WebSocket when connected
     
     // Setup game screen
     caroGameScreen->setup(
@@ -2586,14 +2605,29 @@ void SocialScreen::exitGame() {
     }
 }
 
-void SocialScreen::onGameMoveReceived(int sessionId, int userId, int row, int col, const String& gameStatus, int winnerId, int currentTurn) {
+void SocialScreen::onGameMoveReceived(int sessionId, int userId, int row, int col, const String& gameStatus, int winnerId, int currentTurn, int seq) {
+    if (screenState == STATE_PLAYING_GAME && caroGameScreen != nullptr && caroGameScreen->isActive()) {
+        if (caroGameScreen->getSessionId() == sessionId) {
+            caroGameScreen->onMoveReceived(row, col, userId, gameStatus, winnerId, currentTurn, seq);
+        }
+    }
+}
+
+void SocialScreen::onGameMoveAckReceived(int sessionId, int seq, bool success, const String& message, const String& gameStatus, int winnerId, int currentTurn) {
     if (screenState == STATE_PLAYING_GAME && caroGameScreen != nullptr && caroGameScreen->isActive()) {
         if (caroGameScreen->getSessionId() == sessionId) {
-            caroGameScreen->onMoveReceived(row, col, userId, gameStatus, winnerId, currentTurn);
+            caroGameScreen->onMoveAck(seq, success, message, gameStatus, winnerId, currentTurn);
         }
     }
 }
 
+void SocialScreen::setSocketManager(SocketManager* socketManager) {
+    this->socketManager = socketManager;
+    if (caroGameScreen != nullptr) {
+        caroGameScreen->setSocketManager(socketManager);
+    }
+}
+
 void SocialScreen::setActive(bool active) {
     bool wasActive = this->isActive;
     this->isActive = active;
@@ -2626,6 +2660,7 @@ void SocialScreen::setActive(bool active) {
 }
 
 void SocialScreen::update() {
+    Profiler::Scope profile("SocialScreen.update");
     // Update lobby if in waiting state (check auto-start timer)
     if (screenState == STATE_WAITING_GAME && gameLobby != nullptr) {
         gameLobby->update();
@@ -10,6 +10,7 @@
 #include "mini_keyboard.h"
 #include "mini_add_friend_screen.h"
 #include "api_client.h"
+#include "api_request_queue.h"
 #include "confirmation_dialog.h"
 #include "social_theme.h"
 
@@ -199,7 +200,11 @@ public:
     void startGame();
     void exitLobby();
     void exitGame();
-    void onGameMoveReceived(int sessionId, int userId, int row, int col, const String& gameStatus, int winnerId, int currentTurn);
+    void onGameMoveReceived(int sessionId, int userId, int row, int col, const String& gameStatus, int winnerId, int currentTurn, int seq);
+    void onGameMoveAckReceived(int sessionId, int seq, bool success, const String& message, const String& gameStatus, int winnerId, int currentTurn);
+    
+    // Set by SocketManager::setSocialScreen, handed to the game screen
+    void setSocketManager(SocketManager* socketManager);
 
 private:
     Adafruit_ST7789* tft;
@@ -209,6 +214,7 @@ private:
     ConfirmationDialog* confirmationDialog;
     GameLobbyScreen* gameLobby;
     CaroGameScreen* caroGameScreen;
+    SocketManager* socketManager;
     
     // Theme configuration (hot-swappable visual style)
     SocialTheme currentTheme;
@@ -317,6 +323,8 @@ private:
 
     // Data parsing
     void parseFriendsString(const String& friendsString);
+    void applyFriendsList(bool success, const String& friendsString);
+    static void onFriendsListLoaded(bool success, const String& friendsString, void* context);  // ApiRequestQueue callback
     void clearFriends();
     void clearNotifications();
     
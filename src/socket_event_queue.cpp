@@ -0,0 +1,128 @@
+#include "socket_event_queue.h"
+
+SocketEventQueue::SocketEventQueue() : textTail(0) {
+    this->textHead = 0;
+    this->holdHead = 0;
+    this->holdCount = 0;
+    this->stats = {0, 0, 0, 0, 0};
+}
+
+bool SocketEventQueue::push(SocketEvent& event, const String* const* texts) {
+    if (!tryPush(event, texts)) {
+        stats.dropped++;
+        return false;
+    }
+    return true;
+}
+
+bool SocketEventQueue::pushOrHold(SocketEvent& event, const String* const* texts) {
+    if (holdCount == 0 && tryPush(event, texts)) {
+        return true;
+    }
+    if (holdCount == HOLD_CAPACITY) {
+        stats.dropped++;
+        return false;
+    }
+    HeldEvent& slot = hold[(holdHead + holdCount) % HOLD_CAPACITY];
+    slot.event = event;
+    for (int i = 0; i < event.textCount && i < SocketEvent::MAX_TEXTS; i++) {
+        slot.texts[i] = *texts[i];
+    }
+    holdCount++;
+    stats.held++;
+    return true;
+}
+
+void SocketEventQueue::retryHeld() {
+    const String* pointers[SocketEvent::MAX_TEXTS];
+    while (holdCount > 0) {
+        HeldEvent& slot = hold[holdHead];
+        for (int i = 0; i < SocketEvent::MAX_TEXTS; i++) {
+            pointers[i] = &slot.texts[i];
+        }
+        if (!tryPush(slot.event, pointers)) {
+            return;
+        }
+        for (int i = 0; i < SocketEvent::MAX_TEXTS; i++) {
+            slot.texts[i] = String();  // Free the copies now, not when the slot is reused
+        }
+        holdHead = (holdHead + 1) % HOLD_CAPACITY;
+        holdCount--;
+    }
+}
+
+// Copy into the rings if both have room; no stats for a full queue
+bool SocketEventQueue::tryPush(SocketEvent& event, const String* const* texts) {
+    if (event.textCount > SocketEvent::MAX_TEXTS) {
+        event.textCount = SocketEvent::MAX_TEXTS;
+    }
+
+    uint32_t needed = 0;
+    for (int i = 0; i < event.textCount; i++) {
+        size_t length = texts[i]->length();
+        event.textLength[i] = (length > MAX_TEXT_LENGTH) ? MAX_TEXT_LENGTH : (uint16_t)length;
+        needed += event.textLength[i];
+    }
+
+    uint32_t used = textHead - textTail.load(std::memory_order_acquire);
+    if (events.freeSpace() == 0 || TEXT_CAPACITY - used < needed) {
+        return false;
+    }
+
+    // Text first; the consumer can't see it until the event is pushed
+    uint32_t head = textHead;
+    for (int i = 0; i < event.textCount; i++) {
+        const char* src = texts[i]->c_str();
+        uint32_t length = event.textLength[i];
+        uint32_t start = head & (TEXT_CAPACITY - 1);
+        uint32_t first = (length < TEXT_CAPACITY - start) ? length : TEXT_CAPACITY - start;
+        memcpy(text + start, src, first);
+        memcpy(text, src + first, length - first);
+        head += length;
+    }
+    textHead = head;
+
+    events.push(event);  // Can't fail: only this task fills the ring and it had room
+    stats.pushed++;
+    uint32_t depth = events.size();
+    if (depth > stats.maxDepth) stats.maxDepth = depth;
+    return true;
+}
+
+bool SocketEventQueue::pop(SocketEvent& event, String* texts) {
+    if (!events.pop(event)) {
+        return false;
+    }
+
+    uint32_t tail = textTail.load(std::memory_order_relaxed);
+    for (int i = 0; i < event.textCount; i++) {
+        uint32_t length = event.textLength[i];
+        uint32_t start = tail & (TEXT_CAPACITY - 1);
+        uint32_t first = (length < TEXT_CAPACITY - start) ? length : TEXT_CAPACITY - start;
+        texts[i] = String();
+        texts[i].reserve(length);
+        texts[i].concat((const char*)text + start, first);
+        texts[i].concat((const char*)text, length - first);
+        tail += length;
+    }
+    for (int i = event.textCount; i < SocketEvent::MAX_TEXTS; i++) {
+        texts[i] = String();
+    }
+    // Hand the bytes back only after they've been copied out
+    textTail.store(tail, std::memory_order_release);
+    stats.popped++;
+    return true;
+}
+
+void SocketEventQueue::printStats() const {
+    Serial.print("Socket Events: pushed=");
+    Serial.print(stats.pushed);
+    Serial.print(", held=");
+    Serial.print(stats.held);
+    Serial.print(", dropped=");
+    Serial.print(stats.dropped);
+    Serial.print(", popped=");
+    Serial.print(stats.popped);
+    Serial.print(", maxDepth=");
+    Serial.println(stats.maxDepth);
+}
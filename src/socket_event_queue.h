@@ -0,0 +1,113 @@
+#ifndef SOCKET_EVENT_QUEUE_H
+#define SOCKET_EVENT_QUEUE_H
+
+#include <Arduino.h>
+#include <atomic>
+#include "spsc_ring.h"
+
+// One decoded server frame, as handed from the WebSocket task to the main loop.
+// Numbers live in values[] (meaning depends on kind, see SocketProtocol::decodeEvent),
+// strings follow in the queue's text ring in textLength[] order.
+struct SocketEvent {
+    enum Kind : uint8_t {
+        CHAT_MESSAGE = 1,   // values: fromUserId            texts: message, fromNickname, messageId, timestamp
+        TYPING,             // values: fromUserId, isTyping  texts: fromNickname
+        DELIVERED,          //                               texts: messageId, status, timestamp
+        READ_RECEIPT,       //                               texts: messageId, timestamp
+        USER_STATUS,        // values: userId                texts: status
+        NOTIFICATION,       // values: id, read              texts: type, message, timestamp
+        GAME_EVENT,         // values: sessionId, userId, accepted, ready
+                            //                               texts: eventType, gameType, status, hostNickname, userNickname
+        GAME_MOVE,          // values: sessionId, userId, row, col, winnerId, currentTurn, seq
+                            //                               texts: gameStatus
+        GAME_MOVE_ACK,      // values: sessionId, seq, success, winnerId, currentTurn
+                            //                               texts: message, gameStatus
+        BILLIARD_SHOT,      // values: sessionId, userId, seq, tick, angle, power, hash
+        BILLIARD_SYNC       // values: sessionId, userId, seq    texts: snapshot (empty = request)
+    };
+
+    static const int MAX_VALUES = 7;
+    static const int MAX_TEXTS = 5;
+
+    uint8_t kind;
+    uint8_t textCount;
+    int32_t values[MAX_VALUES];
+    uint16_t textLength[MAX_TEXTS];
+
+    SocketEvent() : kind(0), textCount(0) {
+        for (int i = 0; i < MAX_VALUES; i++) values[i] = 0;
+        for (int i = 0; i < MAX_TEXTS; i++) textLength[i] = 0;
+    }
+    explicit SocketEvent(uint8_t kind) : SocketEvent() { this->kind = kind; }
+};
+
+// Lock-free hand-off from the WebSocket task (only producer) to the main
+// loop (only consumer).
+//
+// Events are fixed-size structs in an SpscRing; their strings are copied
+// back to back into a separate byte ring so a 500-character chat message
+// doesn't make every slot 500 bytes. Both rings are filled and drained in
+// the same order, so the consumer finds an event's strings at its text tail.
+// The producer writes the text before pushing the event; the event ring's
+// release/acquire pair publishes both.
+//
+// Full (either ring): push() drops the event and counts it, never blocks
+// the socket task. pushOrHold() instead keeps up to HOLD_CAPACITY events on
+// the producer side; retryHeld() moves them in, oldest first, and a held
+// event keeps later pushOrHold() events behind it. Strings longer than
+// MAX_TEXT_LENGTH are truncated.
+class SocketEventQueue {
+public:
+    static const uint32_t EVENT_CAPACITY = 32;     // Power of two
+    static const uint32_t TEXT_CAPACITY = 4096;    // Power of two
+    static const uint16_t MAX_TEXT_LENGTH = 1024;
+    static const int HOLD_CAPACITY = 8;
+
+    struct Stats {
+        uint32_t pushed;
+        uint32_t held;        // Had to wait in the hold (pushOrHold)
+        uint32_t dropped;
+        uint32_t popped;
+        uint32_t maxDepth;    // Most events waiting at once (seen by the producer)
+    };
+
+    SocketEventQueue();
+
+    // Producer (socket task). texts has event.textCount entries.
+    // Returns false (and counts a drop) if the event or its text doesn't fit.
+    bool push(SocketEvent& event, const String* const* texts);
+
+    // Producer, for events that must not be dropped: one that doesn't fit
+    // waits in the hold. False (and counts a drop) only if the hold is full.
+    bool pushOrHold(SocketEvent& event, const String* const* texts);
+
+    // Producer, every tick: move held events in while they fit
+    void retryHeld();
+    int heldCount() const { return holdCount; }
+
+    // Consumer (main loop). texts must have room for SocketEvent::MAX_TEXTS.
+    bool pop(SocketEvent& event, String* texts);
+
+    uint32_t size() const { return events.size(); }
+    const Stats& getStats() const { return stats; }
+    void printStats() const;
+
+private:
+    struct HeldEvent {
+        SocketEvent event;
+        String texts[SocketEvent::MAX_TEXTS];
+    };
+
+    SpscRing<SocketEvent, EVENT_CAPACITY> events;
+    uint8_t text[TEXT_CAPACITY];
+    uint32_t textHead;                 // Producer only (published through the event ring)
+    std::atomic<uint32_t> textTail;    // Consumer writes, producer reads for free space
+    HeldEvent hold[HOLD_CAPACITY];     // Producer only, oldest at holdHead
+    int holdHead;
+    int holdCount;
+    Stats stats;                       // pushed/held/dropped/maxDepth: producer, popped: consumer
+
+    bool tryPush(SocketEvent& event, const String* const* texts);
+};
+
+#endif
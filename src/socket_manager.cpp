@@ -3,6 +3,10 @@
 #include "social_screen.h"
 #include "caro_game_screen.h"
 #include "game_lobby_screen.h"
+#include "chat_log.h"
+#include "task_layout.h"
+#include "wire_codec.h"
+#include "profiler.h"
 #include <FS.h>
 #include <SPIFFS.h>
 
@@ -39,10 +43,12 @@ SocketManager::SocketManager() {
     onUserStatusUpdateCallback = nullptr;
     onGameEventCallback = nullptr;
     onGameMoveCallback = nullptr;
+    onGameMoveAckCallback = nullptr;
+    onBilliardShotCallback = nullptr;
+    onBilliardSyncCallback = nullptr;
     
-    // Typing indicator state
-    lastTypingTime = 0;
-    currentTypingToUserId = -1;
+    binaryWire = false;
+    batchFrames = false;
     
     // User ID
     userId = -1;
@@ -115,18 +121,17 @@ void SocketManager::begin(const String& host, uint16_t port, const String& path)
     
     initialized = true;
     
-    // Create FreeRTOS task for WebSocket connection
+    // Chat left undelivered by the last session goes out after init
+    chatOutbox.load();
+    
+    // Create FreeRTOS task for WebSocket connection (network core, see task_layout.h)
     if (!taskRunning) {
         taskRunning = true;
-        xTaskCreate(
-            socketTask,           // Task function
-            "WebSocketTask",      // Task name
-            4096,                 // Stack size (bytes)
-            this,                 // Parameter to pass
-            1,                    // Priority (0-25, higher = more priority)
-            &socketTaskHandle     // Task handle
-        );
-        Serial.println("Socket Manager: Created WebSocket task");
+        if (TaskLayout::spawn(TaskLayout::ROLE_SOCKET, socketTask, this, &socketTaskHandle) == pdPASS) {
+            Serial.println("Socket Manager: Created WebSocket task");
+        } else {
+            taskRunning = false;
+        }
     }
     
     Serial.println("Socket Manager: Initialized successfully");
@@ -150,25 +155,38 @@ void SocketManager::runSocketTask() {
     // while(true) loop - chạy liên tục sau khi init
     while (taskRunning) {
         if (initialized) {
-            // Process WebSocket events (this is the main loop)
-            webSocket.loop();
-            
-            // Keep-alive: Send ping periodically if connected
-            if (isConnected) {
-                unsigned long now = millis();
+            {
+                TaskLayout::BusyScope busy;  // Work only, not the delay below
                 
-                // Send ping if interval has passed
-                if (now - lastPingTime >= pingInterval) {
-                    String pingMessage = "{\"type\":\"ping\",\"timestamp\":\"" + String(now) + "\"}";
-                    String msgCopy = pingMessage;
-                    webSocket.sendTXT(msgCopy);
-                    lastPingTime = now;
-                    Serial.println("Socket Manager: Sent keep-alive ping");
-                }
+                // Events the main loop had no room for last tick go before new ones
+                events.retryHeld();
                 
-                // Auto-stop typing indicator after 3 seconds of inactivity
-                if (currentTypingToUserId != -1 && now - lastTypingTime >= TYPING_AUTO_STOP_INTERVAL) {
-                    sendTypingStop(currentTypingToUserId);
+                // Process WebSocket events (this is the main loop)
+                webSocket.loop();
+                
+                // Keep-alive: Send ping periodically if connected
+                if (isConnected) {
+                    unsigned long now = millis();
+                
+                    // Send ping if interval has passed
+                    if (now - lastPingTime >= pingInterval) {
+                        String pingMessage = SocketProtocol::pingMessage(now);
+                        sendText(pingMessage);
+                        lastPingTime = now;
+                        Serial.println("Socket Manager: Sent keep-alive ping");
+                    }
+                
+                    // Everything the screens queued since the last tick, as one frame
+                    pumpChatOutbox();
+                    flushOutbox();
+                
+                    // Auto-stop typing indicator after 3 seconds of inactivity. After
+                    // the flush, so a keystroke queued this tick counts first; the
+                    // stop goes out on the next tick.
+                    OutboundMessage stop;
+                    if (typing.autoStop(now, stop)) {
+                        outbox.push(stop);
+                    }
                 }
             }
             
@@ -191,16 +209,25 @@ void SocketManager::update() {
 
 void SocketManager::sendMessage(const String& message) {
     if (isConnected && initialized) {
-        // Create non-const copy because sendTXT requires non-const reference
-        String msgCopy = message;
-        webSocket.sendTXT(msgCopy);
-        Serial.print("Socket Manager: Sent message: ");
-        Serial.println(message);
+        OutboundMessage text(OUTBOUND_TYPE_TEXT, 0);
+        text.text = message;
+        if (queueOutbound(text)) {
+            Serial.print("Socket Manager: Queued message: ");
+            Serial.println(message);
+        }
     } else {
         Serial.println("Socket Manager: Cannot send - not connected or not initialized");
     }
 }
 
+void SocketManager::setUserId(int userId) {
+    this->userId = userId;
+    // If already connected, send updated init message
+    if (isConnected && initialized) {
+        queueOutbound(OutboundMessage(OUTBOUND_TYPE_INIT, userId));
+    }
+}
+
 void SocketManager::disconnect() {
     if (initialized) {
         taskRunning = false;  // Signal task to stop
@@ -210,6 +237,138 @@ void SocketManager::disconnect() {
     }
 }
 
+// Route a tokenized frame (JSON text or decoded binary) by its "type"
+void SocketManager::dispatchFrame() {
+    switch (rxJson.getTypeHash()) {
+        case JsonTokenizer::hashOf("pong"):
+            Serial.println("Socket Manager: Received pong - connection alive");
+            return;
+        case JsonTokenizer::hashOf("chat_error"):
+            parseChatError(rxJson);
+            return;
+        case JsonTokenizer::hashOf("init_ack"):
+            SocketProtocol::readInitAck(rxJson, binaryWire, batchFrames);
+            Serial.print("Socket Manager: Init acknowledged, wire format: ");
+            Serial.print(binaryWire ? WireCodec::FORMAT_NAME : "json");
+            Serial.println(batchFrames ? ", batching" : "");
+            return;
+    }
+    
+    SocketEvent event;
+    if (!SocketProtocol::decodeEvent(rxJson, event, rxDecoded)) {
+        Serial.print("Socket Manager: ⚠️  Unknown or incomplete message type: ");
+        Serial.println(rxJson.getString("type", 0));
+        return;
+    }
+    if (event.kind == SocketEvent::DELIVERED && chatOutbox.acknowledge(rxDecoded[0]) == ChatOutbox::ACK_DUPLICATE) {
+        // Retried message the server had already delivered - UI saw the first ack.
+        // Best-effort chats (ACK_UNKNOWN) were never in the outbox and go through.
+        Serial.println("Socket Manager: Duplicate delivery ack ignored");
+        return;
+    }
+    logEvent(event, rxDecoded);
+    if (event.kind == SocketEvent::CHAT_MESSAGE) {
+        // Saved here, not on the main loop: the server counts it delivered, so
+        // it must reach flash even if the main loop never gets the event
+        if (userId > 0) {
+            saveChatMessageToFile(event.values[0], userId, rxDecoded[0], false);  // false = từ friend
+        } else {
+            Serial.println("Socket Manager: ⚠️  Cannot save message - userId not set");
+        }
+    }
+    publishEvent(event, rxDecoded);
+}
+
+// Socket task: one line per decoded event
+void SocketManager::logEvent(const SocketEvent& event, const String* texts) {
+    const int32_t* v = event.values;
+    Serial.print("Socket Manager: ✅ ");
+    switch (event.kind) {
+        case SocketEvent::CHAT_MESSAGE:
+            Serial.print("Chat message - from: ");
+            Serial.print(v[0]);
+            Serial.print(" (");
+            Serial.print(texts[1]);
+            Serial.print("), message: ");
+            Serial.println(texts[0]);
+            break;
+        case SocketEvent::TYPING:
+            Serial.print(v[1] ? "typing_start" : "typing_stop");
+            Serial.print(" - from: ");
+            Serial.println(v[0]);
+            break;
+        case SocketEvent::DELIVERED:
+            Serial.print("Delivered - message_id: ");
+            Serial.println(texts[0]);
+            break;
+        case SocketEvent::READ_RECEIPT:
+            Serial.print("Read - message_id: ");
+            Serial.println(texts[0]);
+            break;
+        case SocketEvent::USER_STATUS:
+            Serial.print("User status - user_id: ");
+            Serial.print(v[0]);
+            Serial.print(", status: ");
+            Serial.println(texts[0]);
+            break;
+        case SocketEvent::NOTIFICATION:
+            Serial.print("Notification - id: ");
+            Serial.print(v[0]);
+            Serial.print(", type: ");
+            Serial.print(texts[0]);
+            Serial.print(", message: ");
+            Serial.print(texts[1]);
+            Serial.print(", read: ");
+            Serial.println(v[1]);
+            break;
+        case SocketEvent::GAME_EVENT:
+            Serial.print("Game event -> type: ");
+            Serial.print(texts[0]);
+            Serial.print(", session: ");
+            Serial.print(v[0]);
+            Serial.print(", game: ");
+            Serial.print(texts[1]);
+            Serial.print(", status: ");
+            Serial.println(texts[2]);
+            break;
+        case SocketEvent::GAME_MOVE:
+            Serial.print("Game move -> session: ");
+            Serial.print(v[0]);
+            Serial.print(", seq: ");
+            Serial.print(v[6]);
+            Serial.print(", row: ");
+            Serial.print(v[2]);
+            Serial.print(", col: ");
+            Serial.println(v[3]);
+            break;
+        case SocketEvent::GAME_MOVE_ACK:
+            Serial.print("Move ack -> session: ");
+            Serial.print(v[0]);
+            Serial.print(", seq: ");
+            Serial.print(v[1]);
+            Serial.print(", success: ");
+            Serial.print(v[2] ? "true" : "false");
+            Serial.print(", message: ");
+            Serial.println(texts[0]);
+            break;
+        case SocketEvent::BILLIARD_SHOT:
+            Serial.print("Billiard shot -> session: ");
+            Serial.print(v[0]);
+            Serial.print(", seq: ");
+            Serial.print(v[2]);
+            Serial.print(", tick: ");
+            Serial.println(v[3]);
+            break;
+        case SocketEvent::BILLIARD_SYNC:
+            Serial.print("Billiard sync -> session: ");
+            Serial.print(v[0]);
+            Serial.print(", seq: ");
+            Serial.print(v[2]);
+            Serial.println(texts[0].length() > 0 ? ", snapshot" : ", request");
+            break;
+    }
+}
+
 void SocketManager::webSocketEvent(WStype_t type, uint8_t * payload, size_t length) {
     if (instance) {
         instance->onWebSocketEvent(type, payload, length);
@@ -220,6 +379,14 @@ void SocketManager::onWebSocketEvent(WStype_t type, uint8_t * payload, size_t le
     switch(type) {
         case WStype_DISCONNECTED:
             isConnected = false;
+            binaryWire = false;  // Renegotiated on the next init
+            if (chatOutbox.getPendingCount() > 0) {
+                Serial.print("Socket Manager: ");
+                Serial.print(chatOutbox.getPendingCount());
+                Serial.println(" chat message(s) waiting for reconnect");
+            }
+            batchFrames = false;
+            typing.reset();  // New connection, server forgot our typing state
             Serial.println("Socket Manager: WebSocket disconnected");
             break;
             
@@ -231,14 +398,12 @@ void SocketManager::onWebSocketEvent(WStype_t type, uint8_t * payload, size_t le
             
             // Send initial handshake message
             {
-                String initMessage = "{\"type\":\"init\",\"device\":\"ESP32\"";
-                if (userId > 0) {
-                    initMessage += ",\"user_id\":";
-                    initMessage += String(userId);
-                }
-                initMessage += "}";
-                String msgCopy = initMessage;  // Create copy for sendTXT (requires non-const reference)
-                webSocket.sendTXT(msgCopy);
+                binaryWire = false;
+                batchFrames = false;
+                chatOutbox.resetTimers();  // Re-send everything unconfirmed, oldest first
+                // Offer the binary format and batching; JSON, one message per frame, unless init_ack accepts them
+                String initMessage = SocketProtocol::initMessage(userId);
+                sendText(initMessage);
                 Serial.print("Socket Manager: Sent init message: ");
                 Serial.println(initMessage);
             }
@@ -246,55 +411,34 @@ void SocketManager::onWebSocketEvent(WStype_t type, uint8_t * payload, size_t le
             
         case WStype_TEXT:
             {
-                String message = String((char*)payload);
+                Profiler::count(Profiler::COUNTER_WS_FRAMES_IN);
+                Profiler::count(Profiler::COUNTER_WS_BYTES_IN, length);
                 Serial.print("Socket Manager: Received message: ");
-                Serial.println(message);
+                Serial.write(payload, length);
+                Serial.println();
                 
-                // Check if it's a pong response (handle both with and without spaces)
-                if (message.indexOf("\"type\":\"pong\"") >= 0 || message.indexOf("\"type\": \"pong\"") >= 0) {
-                    Serial.println("Socket Manager: Received pong - connection alive");
-                } else if (message.indexOf("\"type\":\"notification\"") >= 0 || message.indexOf("\"type\": \"notification\"") >= 0) {
-                    // Handle notification message (check both with and without spaces in JSON)
-                    Serial.println("Socket Manager: ✅ Received notification message - parsing...");
-                    parseNotificationMessage(message);
-                } else if (message.indexOf("\"type\":\"chat_message\"") >= 0 || message.indexOf("\"type\": \"chat_message\"") >= 0) {
-                    // Handle chat message
-                    Serial.println("Socket Manager: ✅ Received chat message - parsing...");
-                    parseChatMessage(message);
-                } else if (message.indexOf("\"type\":\"typing_start\"") >= 0 || message.indexOf("\"type\": \"typing_start\"") >= 0) {
-                    // Handle typing start
-                    Serial.println("Socket Manager: ✅ Received typing_start - parsing...");
-                    parseTypingIndicator(message, true);
-                } else if (message.indexOf("\"type\":\"typing_stop\"") >= 0 || message.indexOf("\"type\": \"typing_stop\"") >= 0) {
-                    // Handle typing stop
-                    Serial.println("Socket Manager: ✅ Received typing_stop - parsing...");
-                    parseTypingIndicator(message, false);
-                } else if (message.indexOf("\"type\":\"message_delivered\"") >= 0 || message.indexOf("\"type\": \"message_delivered\"") >= 0) {
-                    // Handle delivery status
-                    Serial.println("Socket Manager: ✅ Received message_delivered - parsing...");
-                    parseDeliveryStatus(message, "delivered");
-                } else if (message.indexOf("\"type\":\"message_read\"") >= 0 || message.indexOf("\"type\": \"message_read\"") >= 0) {
-                    // Handle read receipt
-                    Serial.println("Socket Manager: ✅ Received message_read - parsing...");
-                    parseReadReceipt(message);
-                } else if (message.indexOf("\"type\":\"user_status_update\"") >= 0 || message.indexOf("\"type\": \"user_status_update\"") >= 0) {
-                    // Handle user status update
-                    Serial.println("Socket Manager: ✅ Received user_status_update - parsing...");
-                    parseUserStatusUpdate(message);
-                } else if (message.indexOf("\"type\":\"game_event\"") >= 0 || message.indexOf("\"type\": \"game_event\"") >= 0) {
-                    Serial.println("Socket Manager: ✅ Received game_event - parsing...");
-                    parseGameEvent(message);
-                } else {
-                    // Handle other received messages here
-                    Serial.print("Socket Manager: ⚠️  Unknown message type. Full message: ");
-                    Serial.println(message);
+                // Single pass over the payload in place - no String copy of the frame
+                if (!rxJson.parse(payload, length)) {
+                    Serial.println(rxJson.isOverflowed()
+                        ? "Socket Manager: ⚠️  JSON frame has too many fields - ignored"
+                        : "Socket Manager: ⚠️  Malformed JSON frame - ignored");
+                    break;
                 }
+                
+                dispatchFrame();
             }
             break;
             
         case WStype_BIN:
-            Serial.print("Socket Manager: Received binary data, length: ");
+            Profiler::count(Profiler::COUNTER_WS_FRAMES_IN);
+            Profiler::count(Profiler::COUNTER_WS_BYTES_IN, length);
+            Serial.print("Socket Manager: Received binary frame, length: ");
             Serial.println(length);
+            if (!WireCodec::decode(payload, length, rxJson, rxScratch, sizeof(rxScratch))) {
+                Serial.println("Socket Manager: ⚠️  Malformed binary frame - ignored");
+                break;
+            }
+            dispatchFrame();
             break;
             
         case WStype_ERROR:
@@ -328,170 +472,8 @@ void SocketManager::onWebSocketEvent(WStype_t type, uint8_t * payload, size_t le
     }
 }
 
-void SocketManager::parseNotificationMessage(const String& message) {
-    // Parse JSON manually: {"type":"notification","notification":{"id":123,"type":"friend_request_accepted","message":"...","timestamp":"...","read":false}}}
-    // Simple JSON parsing for notification structure
-    
-    Serial.println("Socket Manager: parseNotificationMessage() called");
-    
-    // Bỏ check onNotificationCallback vì đã xử lý trực tiếp trong socket_manager
-    Serial.println("Socket Manager: Parsing notification...");
-    
-    // Find notification object (handle both with and without spaces)
-    int notificationStart = message.indexOf("\"notification\":{");
-    if (notificationStart < 0) {
-        notificationStart = message.indexOf("\"notification\": {");
-    }
-    if (notificationStart < 0) {
-        Serial.println("Socket Manager: ❌ Invalid notification message format - cannot find \"notification\":{");
-        Serial.print("Socket Manager: Message: ");
-        Serial.println(message);
-        return;
-    }
-    
-    Serial.print("Socket Manager: Found notification object at position: ");
-    Serial.println(notificationStart);
-    
-    // Skip "notification":{ or "notification": {
-    if (message.charAt(notificationStart + 14) == '{') {
-        notificationStart += 15;  // Skip "notification":{
-    } else {
-        notificationStart += 16;  // Skip "notification": {
-    }
-    
-    Serial.print("Socket Manager: Starting parse from position: ");
-    Serial.println(notificationStart);
-    
-    // Parse id (handle both "id": and "id": )
-    int idStart = message.indexOf("\"id\":", notificationStart);
-    if (idStart < 0) {
-        idStart = message.indexOf("\"id\": ", notificationStart);
-    }
-    if (idStart < 0) {
-        Serial.println("Socket Manager: ❌ Cannot find \"id\":");
-        return;
-    }
-    idStart += 5;
-    // Skip space if present
-    if (message.charAt(idStart) == ' ') {
-        idStart++;
-    }
-    int idEnd = message.indexOf(',', idStart);
-    if (idEnd < 0) idEnd = message.indexOf('}', idStart);
-    if (idEnd < 0) {
-        Serial.println("Socket Manager: ❌ Cannot find end of id");
-        return;
-    }
-    int notificationId = message.substring(idStart, idEnd).toInt();
-    Serial.print("Socket Manager: Parsed id: ");
-    Serial.println(notificationId);
-    
-    // Parse type (handle both "type":" and "type": ")
-    int typeStart = message.indexOf("\"type\":\"", notificationStart);
-    if (typeStart < 0) {
-        typeStart = message.indexOf("\"type\": \"", notificationStart);
-        if (typeStart >= 0) {
-            typeStart += 9;  // Skip "type": "
-        }
-    } else {
-        typeStart += 8;  // Skip "type":"
-    }
-    if (typeStart < 0 || typeStart < notificationStart) {
-        Serial.println("Socket Manager: ❌ Cannot find \"type\":\"");
-        return;
-    }
-    int typeEnd = message.indexOf('"', typeStart);
-    if (typeEnd < 0) {
-        Serial.println("Socket Manager: ❌ Cannot find end of type");
-        return;
-    }
-    String notificationType = message.substring(typeStart, typeEnd);
-    Serial.print("Socket Manager: Parsed type: ");
-    Serial.println(notificationType);
-    
-    // Parse message (handle both "message":" and "message": ")
-    int msgStart = message.indexOf("\"message\":\"", notificationStart);
-    if (msgStart < 0) {
-        msgStart = message.indexOf("\"message\": \"", notificationStart);
-        if (msgStart >= 0) {
-            msgStart += 12;  // Skip "message": "
-        }
-    } else {
-        msgStart += 11;  // Skip "message":"
-    }
-    if (msgStart < 0 || msgStart < notificationStart) {
-        Serial.println("Socket Manager: ❌ Cannot find \"message\":\"");
-        return;
-    }
-    int msgEnd = message.indexOf('"', msgStart);
-    if (msgEnd < 0) {
-        Serial.println("Socket Manager: ❌ Cannot find end of message");
-        return;
-    }
-    // Handle escaped quotes in message
-    while (msgEnd > msgStart && message.charAt(msgEnd - 1) == '\\') {
-        msgEnd = message.indexOf('"', msgEnd + 1);
-        if (msgEnd < 0) {
-            Serial.println("Socket Manager: ❌ Cannot find end of message (escaped quotes)");
-            return;
-        }
-    }
-    String notificationMessage = message.substring(msgStart, msgEnd);
-    // Unescape JSON string
-    notificationMessage.replace("\\\"", "\"");
-    notificationMessage.replace("\\n", "\n");
-    notificationMessage.replace("\\\\", "\\");
-    Serial.print("Socket Manager: Parsed message: ");
-    Serial.println(notificationMessage);
-    
-    // Parse timestamp (optional)
-    int tsStart = message.indexOf("\"timestamp\":\"", notificationStart);
-    if (tsStart < 0) {
-        tsStart = message.indexOf("\"timestamp\": \"", notificationStart);
-        if (tsStart >= 0) {
-            tsStart += 15;  // Skip "timestamp": "
-        }
-    } else {
-        tsStart += 14;  // Skip "timestamp":"
-    }
-    String notificationTimestamp = "";
-    if (tsStart >= 0 && tsStart > notificationStart) {
-        int tsEnd = message.indexOf('"', tsStart);
-        if (tsEnd >= 0) {
-            notificationTimestamp = message.substring(tsStart, tsEnd);
-        }
-    }
-    
-    // Parse read (handle both "read": and "read": )
-    bool notificationRead = false;
-    int readStart = message.indexOf("\"read\":", notificationStart);
-    if (readStart < 0) {
-        readStart = message.indexOf("\"read\": ", notificationStart);
-    }
-    if (readStart >= 0 && readStart > notificationStart) {
-        readStart += 7;
-        // Skip space if present
-        if (message.charAt(readStart) == ' ') {
-            readStart++;
-        }
-        int readEnd = message.indexOf(',', readStart);
-        if (readEnd < 0) readEnd = message.indexOf('}', readStart);
-        if (readEnd >= 0) {
-            String readStr = message.substring(readStart, readEnd);
-            readStr.trim();
-            notificationRead = (readStr == "true" || readStr == "1");
-        }
-    }
-    
-    Serial.print("Socket Manager: ✅ Parsed notification - id: ");
-    Serial.print(notificationId);
-    Serial.print(", type: ");
-    Serial.print(notificationType);
-    Serial.print(", message: ");
-    Serial.print(notificationMessage);
-    Serial.print(", read: ");
-    Serial.println(notificationRead);
-    
+// Main loop: notification from the server
+void SocketManager::handleNotification(int notificationId, const String& notificationType, const String& notificationMessage, const String& notificationTimestamp, bool notificationRead) {
     // Xử lý notification trực tiếp trong socket_manager
     if (socialScreen != nullptr) {
         // Check parent (SocialScreen) active first
@@ -562,190 +544,25 @@ void SocketManager::saveChatMessageToFile(int fromUserId, int toUserId, const St
         return;
     }
     
-    // Tạo tên file theo format <min_id>-<max_id>.txt
-    int minId = (fromUserId < toUserId) ? fromUserId : toUserId;
-    int maxId = (fromUserId > toUserId) ? fromUserId : toUserId;
-    
-    String fileName = "/";
-    fileName += String(minId);
-    fileName += "-";
-    fileName += String(maxId);
-    fileName += ".txt";
-    
-    Serial.print("Socket Manager: Saving message to file: ");
-    Serial.println(fileName);
-    
-    // Đọc file hiện tại (nếu có)
-    String existingContent = "";
-    int existingCount = 0;
-    
-    if (SPIFFS.exists(fileName)) {
-        File readFile = SPIFFS.open(fileName, "r");
-        if (readFile) {
-            // Đọc count
-            String countStr = readFile.readStringUntil('\n');
-            existingCount = countStr.toInt();
-            
-            // Đọc tất cả messages
-            while (readFile.available()) {
-                String line = readFile.readStringUntil('\n');
-                if (line.length() > 0) {
-                    existingContent += line;
-                    existingContent += "\n";
-                }
-            }
-            readFile.close();
-        }
-    }
-    
-    // Mở file để ghi (append mode không có, nên ghi lại)
-    File file = SPIFFS.open(fileName, "w");
-    if (!file) {
-        Serial.print("Socket Manager: Failed to open file for writing: ");
-        Serial.println(fileName);
-        xSemaphoreGive(fileMutex);  // Release mutex trước khi return
-        return;
-    }
-    
-    // Ghi số lượng tin nhắn mới
-    int newCount = existingCount + 1;
-    file.println(newCount);
-    
-    // Ghi lại messages cũ
-    if (existingContent.length() > 0) {
-        file.print(existingContent);
-    }
-    
-    // Ghi message mới
-    file.print(isFromUser ? "1" : "0");
-    file.print("|");
-    file.print(message);
-    file.print("|");
-    file.println(millis());
-    
-    file.close();
-    Serial.print("Socket Manager: Saved message to file. Total messages: ");
-    Serial.println(newCount);
+    // Append-only: một record được ghi vào cuối file, không đọc/ghi lại nội dung cũ
+    long offset = ChatLog::append(fromUserId, toUserId, message, isFromUser, millis());
     
     // Release mutex
     xSemaphoreGive(fileMutex);
-}
-
-void SocketManager::parseChatMessage(const String& message) {
-    // Bỏ check onChatMessageCallback vì đã xử lý trực tiếp trong socket_manager
-    Serial.println("Socket Manager: Parsing chat message...");
     
-    // Parse from_user_id
-    int fromUserIdStart = message.indexOf("\"from_user_id\":");
-    if (fromUserIdStart < 0) {
-        fromUserIdStart = message.indexOf("\"from_user_id\": ");
-    }
-    if (fromUserIdStart < 0) {
-        Serial.println("Socket Manager: Cannot find from_user_id in chat message");
+    if (offset < 0) {
+        Serial.print("Socket Manager: Failed to append message to ");
+        Serial.println(ChatLog::getFileName(fromUserId, toUserId));
         return;
     }
-    fromUserIdStart += 15;
-    if (message.charAt(fromUserIdStart) == ' ') fromUserIdStart++;
-    int fromUserIdEnd = message.indexOf(',', fromUserIdStart);
-    if (fromUserIdEnd < 0) fromUserIdEnd = message.indexOf('}', fromUserIdStart);
-    if (fromUserIdEnd < 0) return;
-    int fromUserId = message.substring(fromUserIdStart, fromUserIdEnd).toInt();
-    
-    // Parse from_nickname
-    int nicknameStart = message.indexOf("\"from_nickname\":\"");
-    if (nicknameStart < 0) {
-        nicknameStart = message.indexOf("\"from_nickname\": \"");
-        if (nicknameStart >= 0) {
-            nicknameStart += 18;
-        }
-    } else {
-        nicknameStart += 17;
-    }
-    String fromNickname = "";
-    if (nicknameStart >= 0) {
-        int nicknameEnd = message.indexOf('"', nicknameStart);
-        if (nicknameEnd >= 0) {
-            fromNickname = message.substring(nicknameStart, nicknameEnd);
-        }
-    }
-    
-    // Parse message text
-    int msgStart = message.indexOf("\"message\":\"");
-    if (msgStart < 0) {
-        msgStart = message.indexOf("\"message\": \"");
-        if (msgStart >= 0) {
-            msgStart += 12;
-        }
-    } else {
-        msgStart += 11;
-    }
-    if (msgStart < 0) {
-        Serial.println("Socket Manager: Cannot find message in chat message");
-        return;
-    }
-    int msgEnd = message.indexOf('"', msgStart);
-    if (msgEnd < 0) return;
-    // Handle escaped quotes
-    while (msgEnd > msgStart && message.charAt(msgEnd - 1) == '\\') {
-        msgEnd = message.indexOf('"', msgEnd + 1);
-        if (msgEnd < 0) return;
-    }
-    String chatMessage = message.substring(msgStart, msgEnd);
-    chatMessage.replace("\\\"", "\"");
-    chatMessage.replace("\\n", "\n");
-    chatMessage.replace("\\\\", "\\");
-    
-    // Parse message_id
-    int msgIdStart = message.indexOf("\"message_id\":\"");
-    if (msgIdStart < 0) {
-        msgIdStart = message.indexOf("\"message_id\": \"");
-        if (msgIdStart >= 0) {
-            msgIdStart += 15;
-        }
-    } else {
-        msgIdStart += 14;
-    }
-    String messageId = "";
-    if (msgIdStart >= 0) {
-        int msgIdEnd = message.indexOf('"', msgIdStart);
-        if (msgIdEnd >= 0) {
-            messageId = message.substring(msgIdStart, msgIdEnd);
-        }
-    }
-    
-    // Parse timestamp
-    int tsStart = message.indexOf("\"timestamp\":\"");
-    if (tsStart < 0) {
-        tsStart = message.indexOf("\"timestamp\": \"");
-        if (tsStart >= 0) {
-            tsStart += 14;
-        }
-    } else {
-        tsStart += 13;
-    }
-    String timestamp = "";
-    if (tsStart >= 0) {
-        int tsEnd = message.indexOf('"', tsStart);
-        if (tsEnd >= 0) {
-            timestamp = message.substring(tsStart, tsEnd);
-        }
-    }
-    
-    Serial.print("Socket Manager: ✅ Parsed chat message - from: ");
-    Serial.print(fromUserId);
-    Serial.print(" (");
-    Serial.print(fromNickname);
-    Serial.print("), message: ");
-    Serial.println(chatMessage);
-    
-    // Lưu message vào file (nếu có userId)
-    if (userId > 0) {
-        Serial.println("Socket Manager: Saving message to file...");
-        saveChatMessageToFile(fromUserId, userId, chatMessage, false);  // false = từ friend (không phải current user)
-    } else {
-        Serial.println("Socket Manager: ⚠️  Cannot save message - userId not set");
-    }
-    
+    Serial.print("Socket Manager: Appended message to ");
+    Serial.print(ChatLog::getFileName(fromUserId, toUserId));
+    Serial.print(" at offset ");
+    Serial.println(offset);
+}
+
+// Main loop: chat message from a friend (already saved) - show it or badge it
+void SocketManager::handleChatMessage(int fromUserId, const String& chatMessage, const String& fromNickname) {
     // Kiểm tra và hiển thị message nếu chat screen đang mở với friend này
     // Check parent (SocialScreen) active first
     bool isSocialParentActive = isSocialScreenActive && socialScreen != nullptr && socialScreen->getActive();
@@ -840,434 +657,27 @@ void SocketManager::parseChatMessage(const String& message) {
     }
 }
 
-void SocketManager::parseTypingIndicator(const String& message, bool isTyping) {
-    if (onTypingIndicatorCallback == nullptr) {
-        return;
-    }
-    
-    // Parse from_user_id
-    int fromUserIdStart = message.indexOf("\"from_user_id\":");
-    if (fromUserIdStart < 0) {
-        fromUserIdStart = message.indexOf("\"from_user_id\": ");
-    }
-    if (fromUserIdStart < 0) return;
-    fromUserIdStart += 15;
-    if (message.charAt(fromUserIdStart) == ' ') fromUserIdStart++;
-    int fromUserIdEnd = message.indexOf(',', fromUserIdStart);
-    if (fromUserIdEnd < 0) fromUserIdEnd = message.indexOf('}', fromUserIdStart);
-    if (fromUserIdEnd < 0) return;
-    int fromUserId = message.substring(fromUserIdStart, fromUserIdEnd).toInt();
-    
-    // Parse from_nickname
-    int nicknameStart = message.indexOf("\"from_nickname\":\"");
-    if (nicknameStart < 0) {
-        nicknameStart = message.indexOf("\"from_nickname\": \"");
-        if (nicknameStart >= 0) {
-            nicknameStart += 18;
-        }
-    } else {
-        nicknameStart += 17;
-    }
-    String fromNickname = "";
-    if (nicknameStart >= 0) {
-        int nicknameEnd = message.indexOf('"', nicknameStart);
-        if (nicknameEnd >= 0) {
-            fromNickname = message.substring(nicknameStart, nicknameEnd);
-        }
-    }
-    
-    if (onTypingIndicatorCallback != nullptr) {
-        onTypingIndicatorCallback(fromUserId, fromNickname, isTyping);
-    }
-}
-
-void SocketManager::parseDeliveryStatus(const String& message, const String& status) {
-    if (onDeliveryStatusCallback == nullptr) {
-        return;
-    }
-    
-    // Parse message_id
-    int msgIdStart = message.indexOf("\"message_id\":\"");
-    if (msgIdStart < 0) {
-        msgIdStart = message.indexOf("\"message_id\": \"");
-        if (msgIdStart >= 0) {
-            msgIdStart += 15;
-        }
-    } else {
-        msgIdStart += 14;
-    }
-    String messageId = "";
-    if (msgIdStart >= 0) {
-        int msgIdEnd = message.indexOf('"', msgIdStart);
-        if (msgIdEnd >= 0) {
-            messageId = message.substring(msgIdStart, msgIdEnd);
-        }
-    }
-    
-    // Parse timestamp
-    int tsStart = message.indexOf("\"timestamp\":\"");
-    if (tsStart < 0) {
-        tsStart = message.indexOf("\"timestamp\": \"");
-        if (tsStart >= 0) {
-            tsStart += 14;
-        }
-    } else {
-        tsStart += 13;
-    }
-    String timestamp = "";
-    if (tsStart >= 0) {
-        int tsEnd = message.indexOf('"', tsStart);
-        if (tsEnd >= 0) {
-            timestamp = message.substring(tsStart, tsEnd);
-        }
-    }
-    
-    if (onDeliveryStatusCallback != nullptr) {
-        onDeliveryStatusCallback(messageId, status, timestamp);
-    }
-}
-
-void SocketManager::parseReadReceipt(const String& message) {
-    if (onReadReceiptCallback == nullptr) {
-        return;
-    }
-    
-    // Parse message_id
-    int msgIdStart = message.indexOf("\"message_id\":\"");
-    if (msgIdStart < 0) {
-        msgIdStart = message.indexOf("\"message_id\": \"");
-        if (msgIdStart >= 0) {
-            msgIdStart += 15;
-        }
-    } else {
-        msgIdStart += 14;
-    }
-    String messageId = "";
-    if (msgIdStart >= 0) {
-        int msgIdEnd = message.indexOf('"', msgIdStart);
-        if (msgIdEnd >= 0) {
-            messageId = message.substring(msgIdStart, msgIdEnd);
-        }
-    }
-    
-    // Parse timestamp
-    int tsStart = message.indexOf("\"timestamp\":\"");
-    if (tsStart < 0) {
-        tsStart = message.indexOf("\"timestamp\": \"");
-        if (tsStart >= 0) {
-            tsStart += 14;
-        }
-    } else {
-        tsStart += 13;
-    }
-    String timestamp = "";
-    if (tsStart >= 0) {
-        int tsEnd = message.indexOf('"', tsStart);
-        if (tsEnd >= 0) {
-            timestamp = message.substring(tsStart, tsEnd);
-        }
-    }
-    
-    if (onReadReceiptCallback != nullptr) {
-        onReadReceiptCallback(messageId, timestamp);
-    }
-}
-
-void SocketManager::parseUserStatusUpdate(const String& message) {
-    Serial.println("Socket Manager: parseUserStatusUpdate() called");
-    
-    // Parse user_id (handle both with and without spaces)
-    int userIdStart = message.indexOf("\"user_id\":");
-    if (userIdStart < 0) {
-        userIdStart = message.indexOf("\"user_id\": ");
-    }
-    if (userIdStart < 0) {
-        Serial.println("Socket Manager: ❌ Cannot find \"user_id\":");
-        return;
-    }
-    userIdStart += 10;  // Skip "user_id":
-    // Skip space if present
-    if (message.charAt(userIdStart) == ' ') {
-        userIdStart++;
-    }
-    int userIdEnd = message.indexOf(',', userIdStart);
-    if (userIdEnd < 0) userIdEnd = message.indexOf('}', userIdStart);
-    if (userIdEnd < 0) {
-        Serial.println("Socket Manager: ❌ Cannot find end of user_id");
-        return;
+void SocketManager::parseChatError(const JsonTokenizer& json) {
+    String messageId = json.getString("message_id", 0);
+    String code = json.getString("code", 0);
+    Serial.print("Socket Manager: ⚠️  Chat error ");
+    Serial.print(code);
+    Serial.print(" for message_id: ");
+    Serial.println(messageId);
+    if (messageId.length() == 0) {
+        return;  // Older server: the retry timer covers it
     }
-    int userId = message.substring(userIdStart, userIdEnd).toInt();
-    Serial.print("Socket Manager: Parsed user_id: ");
-    Serial.println(userId);
     
-    // Parse status (handle both with and without spaces)
-    int statusStart = message.indexOf("\"status\":\"");
-    if (statusStart < 0) {
-        statusStart = message.indexOf("\"status\": \"");
-        if (statusStart >= 0) {
-            statusStart += 11;  // Skip "status": "
-        }
-    } else {
-        statusStart += 10;  // Skip "status":"
-    }
-    if (statusStart < 0) {
-        Serial.println("Socket Manager: ❌ Cannot find \"status\":\"");
-        return;
-    }
-    int statusEnd = message.indexOf('"', statusStart);
-    if (statusEnd < 0) {
-        Serial.println("Socket Manager: ❌ Cannot find end of status");
-        return;
-    }
-    String status = message.substring(statusStart, statusEnd);
-    Serial.print("Socket Manager: Parsed status: ");
-    Serial.println(status);
-
-    // Always forward presence updates to the callback.
-    // SocialScreen::updateFriendStatus() already knows when to redraw vs update data only.
-    if (onUserStatusUpdateCallback != nullptr) {
-        onUserStatusUpdateCallback(userId, status);
-    } else {
-        Serial.println("Socket Manager: ⚠️ No callback set for user status update");
-    }
+    // Recipient offline / rate limit / init not processed yet / server hiccup: try again later.
+    // Anything else (not friends, empty, too long) won't change on retry.
+    bool permanent = code != "OFFLINE" && code != "RATE_LIMIT" && code != "SEND_ERROR" && code != "NOT_AUTHENTICATED";
+    // Server's rate limit is 10 messages per 1 s window - no point backing off further
+    unsigned long retryAfterMs = (code == "RATE_LIMIT") ? 1000 : 0;
+    chatOutbox.reject(messageId, permanent, millis(), retryAfterMs);
 }
 
-void SocketManager::parseGameEvent(const String& message) {
-    Serial.println("Socket Manager: parseGameEvent() called");
-
-    String eventType = "";
-    String gameType = "";
-    String status = "";
-    String hostNickname = "";
-    String userNickname = "";
-    int sessionId = -1;
-    int userId = -1;
-    bool accepted = false;
-    bool ready = false;
-
-    // Server sends nested: {"type": "game_event", "event": {"event_type": ...}}
-    // Find the "event": { ... } block
-    int eventKeyPos = message.indexOf("\"event\":");
-    int searchStart = 0;
-    
-    if (eventKeyPos >= 0) {
-        // Find the opening brace after "event": (skip spaces)
-        int bracePos = eventKeyPos + 8; // Start after "event":
-        while (bracePos < message.length() && message.charAt(bracePos) == ' ') {
-            bracePos++;
-        }
-        if (bracePos < message.length() && message.charAt(bracePos) == '{') {
-            searchStart = bracePos + 1; // Start searching from inside the event object
-            Serial.print("Socket Manager: Found nested event object at position ");
-            Serial.println(bracePos);
-        }
-    }
-
-    // Try multiple formats for event_type
-    int eventTypeKeyPos = message.indexOf("\"event_type\"", searchStart);
-    if (eventTypeKeyPos >= 0) {
-        // Find the colon after "event_type"
-        int colonPos = message.indexOf(":", eventTypeKeyPos);
-        if (colonPos >= 0) {
-            // Skip colon and any spaces
-            int valueStart = colonPos + 1;
-            while (valueStart < message.length() && (message.charAt(valueStart) == ' ' || message.charAt(valueStart) == '\t')) {
-                valueStart++;
-            }
-            // Should be a quote now
-            if (valueStart < message.length() && message.charAt(valueStart) == '"') {
-                valueStart++; // Skip opening quote
-                int valueEnd = message.indexOf('"', valueStart);
-                if (valueEnd > valueStart) {
-                    eventType = message.substring(valueStart, valueEnd);
-                    Serial.print("Socket Manager: eventType found: ");
-                    Serial.println(eventType);
-                }
-            }
-        }
-    }
-    
-    if (eventType.length() == 0) {
-        Serial.print("Socket Manager: ⚠️  Could not parse event_type. eventTypeKeyPos=");
-        Serial.print(eventTypeKeyPos);
-        Serial.print(", searchStart=");
-        Serial.println(searchStart);
-    }
-
-    int sessionStart = message.indexOf("\"session_id\":", searchStart);
-    if (sessionStart >= 0) {
-        int valueStart = message.indexOf(":", sessionStart) + 1;
-        int valueEnd = message.indexOf(",", valueStart);
-        if (valueEnd < 0) valueEnd = message.indexOf("}", valueStart);
-        if (valueEnd > valueStart) {
-            sessionId = message.substring(valueStart, valueEnd).toInt();
-        }
-    }
-
-    int gameStart = message.indexOf("\"game_type\":\"", searchStart);
-    if (gameStart < 0) {
-        gameStart = message.indexOf("\"game_type\": \"", searchStart);
-        if (gameStart >= 0) gameStart += 13;
-    } else {
-        gameStart += 12;
-    }
-    if (gameStart >= 0) {
-        int gameEnd = message.indexOf('"', gameStart);
-        if (gameEnd > gameStart) {
-            gameType = message.substring(gameStart, gameEnd);
-        }
-    }
-
-    int statusStart = message.indexOf("\"status\":\"", searchStart);
-    if (statusStart < 0) {
-        statusStart = message.indexOf("\"status\": \"", searchStart);
-        if (statusStart >= 0) statusStart += 11;
-    } else {
-        statusStart += 10;
-    }
-    if (statusStart >= 0) {
-        int statusEnd = message.indexOf('"', statusStart);
-        if (statusEnd > statusStart) {
-            status = message.substring(statusStart, statusEnd);
-        }
-    }
-
-    int userStart = message.indexOf("\"user_id\":", searchStart);
-    if (userStart >= 0) {
-        int valueStart = message.indexOf(":", userStart) + 1;
-        int valueEnd = message.indexOf(",", valueStart);
-        if (valueEnd < 0) valueEnd = message.indexOf("}", valueStart);
-        if (valueEnd > valueStart) {
-            userId = message.substring(valueStart, valueEnd).toInt();
-        }
-    }
-
-    int accStart = message.indexOf("\"accepted\":", searchStart);
-    if (accStart >= 0) {
-        int valueStart = message.indexOf(":", accStart) + 1;
-        String v = message.substring(valueStart, valueStart + 6);
-        v.trim();
-        accepted = v.startsWith("true");
-    }
-
-    int readyStart = message.indexOf("\"ready\":", searchStart);
-    if (readyStart >= 0) {
-        int valueStart = message.indexOf(":", readyStart) + 1;
-        String v = message.substring(valueStart, valueStart + 6);
-        v.trim();
-        ready = v.startsWith("true");
-    }
-
-    int hostStart = message.indexOf("\"host_nickname\":\"", searchStart);
-    if (hostStart < 0) {
-        hostStart = message.indexOf("\"host_nickname\": \"", searchStart);
-        if (hostStart >= 0) hostStart += 18;
-    } else {
-        hostStart += 17;
-    }
-    if (hostStart >= 0) {
-        int hostEnd = message.indexOf('"', hostStart);
-        if (hostEnd > hostStart) {
-            hostNickname = message.substring(hostStart, hostEnd);
-        }
-    }
-
-    int userNickStart = message.indexOf("\"user_nickname\":\"", searchStart);
-    if (userNickStart < 0) {
-        userNickStart = message.indexOf("\"user_nickname\": \"", searchStart);
-        if (userNickStart >= 0) userNickStart += 18;
-    } else {
-        userNickStart += 17;
-    }
-    if (userNickStart >= 0) {
-        int userNickEnd = message.indexOf('"', userNickStart);
-        if (userNickEnd > userNickStart) {
-            userNickname = message.substring(userNickStart, userNickEnd);
-        }
-    }
-
-    if (eventType.length() == 0) {
-        Serial.print("Socket Manager: ⚠️  Game event missing event_type. Raw: ");
-        Serial.println(message);
-        eventType = "unknown";
-    }
-
-    Serial.print("Socket Manager: Game event -> type: ");
-    Serial.print(eventType);
-    Serial.print(", session: ");
-    Serial.print(sessionId);
-    Serial.print(", game: ");
-    Serial.print(gameType);
-    Serial.print(", status: ");
-    Serial.println(status);
-
-    // Handle move events separately
-    if (eventType == "move") {
-        int moveRow = -1;
-        int moveCol = -1;
-        String moveGameStatus = "";
-        int moveWinnerId = -1;
-        
-        // Parse move-specific fields
-        int rowStart = message.indexOf("\"row\":", searchStart);
-        if (rowStart >= 0) {
-            int valueStart = message.indexOf(":", rowStart) + 1;
-            int valueEnd = message.indexOf(",", valueStart);
-            if (valueEnd < 0) valueEnd = message.indexOf("}", valueStart);
-            if (valueEnd > valueStart) {
-                moveRow = message.substring(valueStart, valueEnd).toInt();
-            }
-        }
-        
-        int colStart = message.indexOf("\"col\":", searchStart);
-        if (colStart >= 0) {
-            int valueStart = message.indexOf(":", colStart) + 1;
-            int valueEnd = message.indexOf(",", valueStart);
-            if (valueEnd < 0) valueEnd = message.indexOf("}", valueStart);
-            if (valueEnd > valueStart) {
-                moveCol = message.substring(valueStart, valueEnd).toInt();
-            }
-        }
-        
-        int gameStatusStart = message.indexOf("\"game_status\":\"", searchStart);
-        if (gameStatusStart >= 0) {
-            int valueStart = gameStatusStart + 15;
-            int valueEnd = message.indexOf("\"", valueStart);
-            if (valueEnd > valueStart) {
-                moveGameStatus = message.substring(valueStart, valueEnd);
-            }
-        }
-        
-        int winnerIdStart = message.indexOf("\"winner_id\":", searchStart);
-        if (winnerIdStart >= 0) {
-            int valueStart = message.indexOf(":", winnerIdStart) + 1;
-            int valueEnd = message.indexOf(",", valueStart);
-            if (valueEnd < 0) valueEnd = message.indexOf("}", valueStart);
-            String winnerStr = message.substring(valueStart, valueEnd);
-            winnerStr.trim();
-            if (winnerStr != "null" && winnerStr.length() > 0) {
-                moveWinnerId = winnerStr.toInt();
-            }
-        }
-        
-        // Parse current_turn from event
-        int currentTurn = -1;
-        int currentTurnStart = message.indexOf("\"current_turn\":", searchStart);
-        if (currentTurnStart >= 0) {
-            int valueStart = message.indexOf(":", currentTurnStart) + 1;
-            int valueEnd = message.indexOf(",", valueStart);
-            if (valueEnd < 0) valueEnd = message.indexOf("}", valueStart);
-            if (valueEnd > valueStart) {
-                currentTurn = message.substring(valueStart, valueEnd).toInt();
-            }
-        }
-        
-        if (onGameMoveCallback != nullptr && moveRow >= 0 && moveCol >= 0) {
-            onGameMoveCallback(sessionId, userId, moveRow, moveCol, moveGameStatus, moveWinnerId, currentTurn);
-        }
-        return; // Don't process move events as regular game events
-    }
-    
+// Main loop: lobby / invite event (moves go straight to onGameMoveCallback)
+void SocketManager::handleGameEvent(const String& eventType, int sessionId, const String& gameType, const String& status, int userId, bool accepted, bool ready, const String& hostNickname, const String& userNickname) {
     // Check parent (SocialScreen) active first
     if (socialScreen != nullptr) {
         bool isParentActive = isSocialScreenActive && socialScreen->getActive();
@@ -1317,38 +727,214 @@ void SocketManager::parseGameEvent(const String& message) {
     }
 }
 
-void SocketManager::sendChatMessage(int toUserId, const String& message, const String& messageId) {
-    if (!isConnected) {
-        Serial.println("Socket Manager: Cannot send chat message - not connected");
+// Socket task: hand a decoded frame to the main loop. Typing and presence
+// are superseded by the next update and may be dropped when the queue is
+// full; anything else waits in the queue's hold for the next tick.
+void SocketManager::publishEvent(SocketEvent& event, const String* texts) {
+    const String* textPointers[SocketEvent::MAX_TEXTS];
+    for (int i = 0; i < event.textCount; i++) {
+        textPointers[i] = &texts[i];
+    }
+    bool droppable = event.kind == SocketEvent::TYPING || event.kind == SocketEvent::USER_STATUS;
+    if (droppable ? events.push(event, textPointers) : events.pushOrHold(event, textPointers)) {
         return;
     }
+    // Hold full too: the main loop has been stalled for a whole queue plus the hold
+    Serial.print("Socket Manager: ⚠️  Event queue full - dropped event kind ");
+    Serial.print(event.kind);
+    Serial.println(event.kind == SocketEvent::CHAT_MESSAGE ? " (message is on flash)" : "");
+}
+
+// Main loop: run the UI side of everything the socket task decoded since the last call
+void SocketManager::dispatchEvents() {
+    SocketEvent event;
+    // Bounded: events arriving while we dispatch wait for the next loop()
+    for (uint32_t n = 0; n < SocketEventQueue::EVENT_CAPACITY && events.pop(event, rxTexts); n++) {
+        const int32_t* v = event.values;
+        switch (event.kind) {
+            case SocketEvent::CHAT_MESSAGE:
+                handleChatMessage(v[0], rxTexts[0], rxTexts[1]);
+                break;
+            case SocketEvent::TYPING:
+                if (onTypingIndicatorCallback != nullptr) {
+                    onTypingIndicatorCallback(v[0], rxTexts[0], v[1] != 0);
+                }
+                break;
+            case SocketEvent::DELIVERED:
+                if (onDeliveryStatusCallback != nullptr) {
+                    onDeliveryStatusCallback(rxTexts[0], rxTexts[1], rxTexts[2]);
+                }
+                break;
+            case SocketEvent::READ_RECEIPT:
+                if (onReadReceiptCallback != nullptr) {
+                    onReadReceiptCallback(rxTexts[0], rxTexts[1]);
+                }
+                break;
+            case SocketEvent::USER_STATUS:
+                // Always forward presence updates to the callback.
+                // SocialScreen::updateFriendStatus() already knows when to redraw vs update data only.
+                if (onUserStatusUpdateCallback != nullptr) {
+                    onUserStatusUpdateCallback(v[0], rxTexts[0]);
+                } else {
+                    Serial.println("Socket Manager: ⚠️ No callback set for user status update");
+                }
+                break;
+            case SocketEvent::NOTIFICATION:
+                handleNotification(v[0], rxTexts[0], rxTexts[1], rxTexts[2], v[1] != 0);
+                break;
+            case SocketEvent::GAME_EVENT:
+                handleGameEvent(rxTexts[0], v[0], rxTexts[1], rxTexts[2], v[1], v[2] != 0, v[3] != 0, rxTexts[3], rxTexts[4]);
+                break;
+            case SocketEvent::GAME_MOVE:
+                if (onGameMoveCallback != nullptr) {
+                    onGameMoveCallback(v[0], v[1], v[2], v[3], rxTexts[0], v[4], v[5], v[6]);
+                }
+                break;
+            case SocketEvent::GAME_MOVE_ACK:
+                if (onGameMoveAckCallback != nullptr) {
+                    onGameMoveAckCallback(v[0], v[1], v[2] != 0, rxTexts[0], rxTexts[1], v[3], v[4]);
+                }
+                break;
+            case SocketEvent::BILLIARD_SHOT:
+                if (onBilliardShotCallback != nullptr) {
+                    onBilliardShotCallback(v[0], v[1], v[2], (uint32_t)v[3], v[4], v[5], (uint32_t)v[6]);
+                }
+                break;
+            case SocketEvent::BILLIARD_SYNC:
+                if (onBilliardSyncCallback != nullptr) {
+                    onBilliardSyncCallback(v[0], v[1], v[2], rxTexts[0]);
+                }
+                break;
+        }
+    }
+}
+
+bool SocketManager::queueOutbound(const OutboundMessage& message) {
+    if (!outbox.push(message)) {
+        Serial.println("Socket Manager: ⚠️  Outbox full - message dropped");
+        return false;
+    }
+    return true;
+}
+
+bool SocketManager::sendGameMove(int sessionId, int row, int col, int seq) {
+    if (!isConnected) {
+        Serial.println("Socket Manager: Cannot send game move - not connected");
+        return false;
+    }
+    
+    OutboundMessage move(WireCodec::TYPE_GAME_MOVE, sessionId);
+    move.a = row;
+    move.b = col;
+    move.c = seq;
+    if (!queueOutbound(move)) {
+        return false;
+    }
+    Serial.print("Socket Manager: Queued game move seq ");
+    Serial.println(seq);
+    return true;
+}
+
+bool SocketManager::requestGameResync(int sessionId, int sinceSeq) {
+    if (!isConnected) {
+        return false;
+    }
     
-    // Generate message_id if not provided
+    OutboundMessage resync(WireCodec::TYPE_GAME_RESYNC, sessionId);
+    resync.a = sinceSeq;
+    if (!queueOutbound(resync)) {
+        return false;
+    }
+    Serial.print("Socket Manager: Requested game resync after seq ");
+    Serial.println(sinceSeq);
+    return true;
+}
+
+bool SocketManager::sendBilliardShot(int sessionId, int seq, uint32_t tick, int32_t angle, int power, uint32_t hash) {
+    if (!isConnected) {
+        Serial.println("Socket Manager: Cannot send billiard shot - not connected");
+        return false;
+    }
+    
+    OutboundMessage shot(WireCodec::TYPE_BILLIARD_SHOT, sessionId);
+    shot.a = seq;
+    shot.b = (int32_t)tick;
+    shot.c = angle;
+    shot.d = power;
+    shot.e = (int32_t)hash;
+    return queueOutbound(shot);
+}
+
+bool SocketManager::sendBilliardSync(int sessionId, int seq, const String& snapshot) {
+    if (!isConnected) {
+        return false;
+    }
+    
+    OutboundMessage sync(WireCodec::TYPE_BILLIARD_SYNC, sessionId);
+    sync.a = seq;
+    sync.text = snapshot;
+    if (!queueOutbound(sync)) {
+        return false;
+    }
+    Serial.print("Socket Manager: Queued billiard ");
+    Serial.print(snapshot.length() > 0 ? "snapshot" : "snapshot request");
+    Serial.print(" at seq ");
+    Serial.println(seq);
+    return true;
+}
+
+bool SocketManager::sendWire(const uint8_t* data, size_t length) {
+    Profiler::count(Profiler::COUNTER_WS_FRAMES_OUT);
+    Profiler::count(Profiler::COUNTER_WS_BYTES_OUT, length);
+    return webSocket.sendBIN(data, length);
+}
+
+bool SocketManager::sendText(String& frame) {
+    Profiler::count(Profiler::COUNTER_WS_FRAMES_OUT);
+    Profiler::count(Profiler::COUNTER_WS_BYTES_OUT, frame.length());
+    return webSocket.sendTXT(frame);
+}
+
+// SocketFramer output (flushOutbox)
+bool SocketManager::writeFrame(const uint8_t* data, size_t length, int messages) {
+    outbox.countFrame(messages);
+    return sendWire(data, length);
+}
+
+bool SocketManager::writeFrame(String& text, int messages) {
+    outbox.countFrame(messages);
+    return sendText(text);
+}
+
+void SocketManager::sendChatMessage(int toUserId, const String& message, const String& messageId) {
+    // Generate message_id if not provided (the server dedupes retries by it)
     String msgId = messageId;
     if (msgId.length() == 0) {
-        msgId = String(millis()) + "_" + String(random(1000, 9999));
+        msgId = chatOutbox.newMessageId();
+    }
+    
+    // Normal path: persist first, the socket task sends it on its next tick
+    if (userId > 0 && chatOutbox.enqueue(userId, toUserId, msgId, message)) {
+        Serial.print(isConnected ? "Socket Manager: Queued chat message to user " : "Socket Manager: Offline - chat message held for user ");
+        Serial.print(toUserId);
+        Serial.print(", message_id: ");
+        Serial.println(msgId);
+        return;
     }
     
-    // Create JSON message
-    String jsonMessage = "{\"type\":\"chat_message\",\"to_user_id\":";
-    jsonMessage += String(toUserId);
-    jsonMessage += ",\"message\":\"";
-    // Escape message
-    String escapedMessage = message;
-    escapedMessage.replace("\\", "\\\\");
-    escapedMessage.replace("\"", "\\\"");
-    escapedMessage.replace("\n", "\\n");
-    jsonMessage += escapedMessage;
-    jsonMessage += "\",\"message_id\":\"";
-    jsonMessage += msgId;
-    jsonMessage += "\",\"timestamp\":\"";
-    // Simple timestamp (ISO format would be better but keeping it simple)
-    jsonMessage += String(millis());
-    jsonMessage += "\"}";
+    // Outbox full (or not logged in): best effort, no retry
+    if (!isConnected) {
+        Serial.println("Socket Manager: Cannot send chat message - not connected");
+        return;
+    }
     
-    String msgCopy = jsonMessage;
-    webSocket.sendTXT(msgCopy);
-    Serial.print("Socket Manager: Sent chat message to user ");
+    OutboundMessage chat(WireCodec::TYPE_CHAT_MESSAGE, toUserId);
+    chat.text = message;
+    chat.id = msgId;
+    if (!queueOutbound(chat)) {
+        return;
+    }
+    Serial.print("Socket Manager: Queued chat message to user ");
     Serial.print(toUserId);
     Serial.print(", message_id: ");
     Serial.println(msgId);
@@ -1359,22 +945,9 @@ void SocketManager::sendTypingStart(int toUserId) {
         return;
     }
     
-    // Stop previous typing if different user
-    if (currentTypingToUserId != -1 && currentTypingToUserId != toUserId) {
-        sendTypingStop(currentTypingToUserId);
-    }
-    
-    currentTypingToUserId = toUserId;
-    lastTypingTime = millis();
-    
-    String jsonMessage = "{\"type\":\"typing_start\",\"to_user_id\":";
-    jsonMessage += String(toUserId);
-    jsonMessage += "}";
-    
-    String msgCopy = jsonMessage;
-    webSocket.sendTXT(msgCopy);
-    Serial.print("Socket Manager: Sent typing_start to user ");
-    Serial.println(toUserId);
+    // Called on every keystroke: the outbox keeps one typing state per user and
+    // the socket task (SocketTyping) drops it if the server already has it
+    queueOutbound(OutboundMessage(WireCodec::TYPE_TYPING_START, toUserId));
 }
 
 void SocketManager::sendTypingStop(int toUserId) {
@@ -1382,38 +955,80 @@ void SocketManager::sendTypingStop(int toUserId) {
         return;
     }
     
-    if (currentTypingToUserId == toUserId) {
-        currentTypingToUserId = -1;
-        lastTypingTime = 0;
+    queueOutbound(OutboundMessage(WireCodec::TYPE_TYPING_STOP, toUserId));
+}
+
+void SocketManager::sendReadReceipt(int toUserId, const String& messageId) {
+    if (!isConnected) {
+        return;
     }
     
-    String jsonMessage = "{\"type\":\"typing_stop\",\"to_user_id\":";
-    jsonMessage += String(toUserId);
-    jsonMessage += "}";
+    OutboundMessage receipt(WireCodec::TYPE_READ_RECEIPT, toUserId);
+    receipt.id = messageId;
+    queueOutbound(receipt);
+}
+
+// Socket task, once per tick: hand due chat messages (new or timed out) to the outbox
+void SocketManager::pumpChatOutbox() {
+    if (userId <= 0 || chatOutbox.getPendingCount() == 0) {
+        return;
+    }
     
-    String msgCopy = jsonMessage;
-    webSocket.sendTXT(msgCopy);
-    Serial.print("Socket Manager: Sent typing_stop to user ");
-    Serial.println(toUserId);
+    unsigned long now = millis();
+    int toUserId;
+    String messageId;
+    String text;
+    while (outbox.getPendingCount() < SocketOutbox::CAPACITY &&
+           chatOutbox.nextDue(userId, now, toUserId, messageId, text)) {
+        OutboundMessage chat(WireCodec::TYPE_CHAT_MESSAGE, toUserId);
+        chat.id = messageId;
+        chat.text = text;
+        outbox.push(chat);
+    }
 }
 
-void SocketManager::sendReadReceipt(int toUserId, const String& messageId) {
-    if (!isConnected) {
+// Socket task, once per tick: write everything queued since the last flush.
+// One message goes out as-is; several share a "batch" frame if the server
+// accepted batching in init_ack, otherwise they go out one frame each.
+void SocketManager::flushOutbox() {
+    int count = outbox.drain(txBatch, SocketOutbox::CAPACITY);
+    if (count == 0) {
         return;
     }
     
-    String jsonMessage = "{\"type\":\"read_receipt\",\"to_user_id\":";
-    jsonMessage += String(toUserId);
-    jsonMessage += ",\"message_id\":\"";
-    jsonMessage += messageId;
-    jsonMessage += "\"}";
+    // Typing state the server already has needs no frame (refreshed before its 5 s timeout)
+    unsigned long now = millis();
+    int live = 0;
+    for (int i = 0; i < count; i++) {
+        int replaced;
+        bool needed = typing.admit(txBatch[i], now, replaced);
+        if (replaced != -1) {
+            outbox.push(OutboundMessage(WireCodec::TYPE_TYPING_STOP, replaced));  // Next tick
+        }
+        if (!needed) {
+            continue;
+        }
+        if (live != i) {
+            txBatch[live] = txBatch[i];
+        }
+        live++;
+    }
     
-    String msgCopy = jsonMessage;
-    webSocket.sendTXT(msgCopy);
-    Serial.print("Socket Manager: Sent read_receipt to user ");
-    Serial.print(toUserId);
-    Serial.print(", message_id: ");
-    Serial.println(messageId);
+    framer.write(txBatch, live, binaryWire, batchFrames, now, *this);
+    
+    for (int i = 0; i < count; i++) {
+        txBatch[i].text = "";
+        txBatch[i].id = "";
+    }
+}
+
+void SocketManager::setSocialScreen(SocialScreen* socialScreen) {
+    this->socialScreen = socialScreen;
+    
+    // Tự động set SocketManager cho SocialScreen để CaroGameScreen có thể gửi move
+    if (socialScreen != nullptr) {
+        socialScreen->setSocketManager(this);
+    }
 }
 
 void SocketManager::setChatScreen(ChatScreen* chatScreen) {
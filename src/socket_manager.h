@@ -7,15 +7,18 @@
 #include <freertos/FreeRTOS.h>
 #include <freertos/task.h>
 #include <freertos/semphr.h>
-
-// Typing indicator constants
-#define TYPING_AUTO_STOP_INTERVAL 3000  // 3 seconds
+#include "json_tokenizer.h"
+#include "wire_codec.h"
+#include "socket_protocol.h"
+#include "socket_outbox.h"
+#include "chat_outbox.h"
+#include "socket_event_queue.h"
 
 // Forward declaration
 class ChatScreen;
 class SocialScreen;
 
-class SocketManager {
+class SocketManager : private SocketFrameSink {
 private:
     WebSocketsClient webSocket;
     String serverHost;
@@ -34,10 +37,6 @@ private:
     unsigned long lastPingTime;
     unsigned long pingInterval;  // Send ping every 30 seconds
     
-    // Typing indicator state
-    unsigned long lastTypingTime;
-    int currentTypingToUserId;
-    
     // User ID for init message
     int userId;
     
@@ -89,17 +88,60 @@ private:
     typedef void (*OnGameEventCallback)(const String& eventType, int sessionId, const String& gameType, const String& status, int userId, bool accepted, bool ready, const String& userNickname);
     OnGameEventCallback onGameEventCallback;
     
-    // Game move callback
-    typedef void (*OnGameMoveCallback)(int sessionId, int userId, int row, int col, const String& gameStatus, int winnerId, int currentTurn);
+    // Game move callback (seq = server move number, -1 if the server didn't send one)
+    typedef void (*OnGameMoveCallback)(int sessionId, int userId, int row, int col, const String& gameStatus, int winnerId, int currentTurn, int seq);
     OnGameMoveCallback onGameMoveCallback;
     
-    // Helper to parse JSON chat message
-    void parseChatMessage(const String& message);
-    void parseTypingIndicator(const String& message, bool isTyping);
-    void parseDeliveryStatus(const String& message, const String& status);
-    void parseReadReceipt(const String& message);
-    void parseUserStatusUpdate(const String& message);
-    void parseGameEvent(const String& message);
+    // Game move ack callback (answer to sendGameMove)
+    typedef void (*OnGameMoveAckCallback)(int sessionId, int seq, bool success, const String& message, const String& gameStatus, int winnerId, int currentTurn);
+    OnGameMoveAckCallback onGameMoveAckCallback;
+    
+    // Billiard lockstep: opponent's shot / snapshot relayed by the server (see BilliardLockstep)
+    typedef void (*OnBilliardShotCallback)(int sessionId, int userId, int seq, uint32_t tick, int32_t angle, int power, uint32_t hash);
+    OnBilliardShotCallback onBilliardShotCallback;
+    typedef void (*OnBilliardSyncCallback)(int sessionId, int userId, int seq, const String& snapshot);
+    OnBilliardSyncCallback onBilliardSyncCallback;
+    
+    // Tokenizer for incoming frames (member, not stack: the socket task only has 4 KB)
+    JsonTokenizer rxJson;
+    char rxScratch[WireCodec::SCRATCH_SIZE];  // Number text for decoded binary frames
+    
+    // Binary "tlv1" framing accepted by the server in init_ack (see wire_codec.h)
+    bool binaryWire;
+    bool sendWire(const uint8_t* data, size_t length);
+    bool sendText(String& frame);   // Every outbound JSON frame, socket task only (counted for the profiler)
+    void dispatchFrame();
+    
+    // Outbound queue: send* push, the socket task flushes once per tick (see socket_outbox.h)
+    SocketOutbox outbox;
+    bool batchFrames;              // Server accepts "batch" frames (init_ack)
+    SocketTyping typing;           // Typing indicator state (socket task only)
+    OutboundMessage txBatch[SocketOutbox::CAPACITY];
+    SocketFramer framer;           // Frame buffers (socket task)
+    bool queueOutbound(const OutboundMessage& message);
+    void flushOutbox();
+    bool writeFrame(const uint8_t* data, size_t length, int messages) override;
+    bool writeFrame(String& text, int messages) override;
+    
+    // Chat not yet confirmed by message_delivered, kept on SPIFFS (see chat_outbox.h)
+    ChatOutbox chatOutbox;
+    void pumpChatOutbox();
+    
+    // Decoded frames waiting for the main loop (see socket_event_queue.h)
+    SocketEventQueue events;
+    String rxTexts[SocketEvent::MAX_TEXTS];    // Strings of the event being dispatched (main loop)
+    String rxDecoded[SocketEvent::MAX_TEXTS];  // Strings of the frame being decoded (socket task)
+    void publishEvent(SocketEvent& event, const String* texts);
+    void logEvent(const SocketEvent& event, const String* texts);
+    
+    // chat_error feeds the chat outbox, it isn't a UI event
+    void parseChatError(const JsonTokenizer& json);
+    
+    // UI side of the events, run by dispatchEvents() on the main loop.
+    // Incoming chat is already on flash: the socket task saves it on arrival.
+    void handleChatMessage(int fromUserId, const String& chatMessage, const String& fromNickname);
+    void handleNotification(int notificationId, const String& notificationType, const String& notificationMessage, const String& notificationTimestamp, bool notificationRead);
+    void handleGameEvent(const String& eventType, int sessionId, const String& gameType, const String& status, int userId, bool accepted, bool ready, const String& hostNickname, const String& userNickname);
     
     // Helper to save chat message to file
     void saveChatMessageToFile(int fromUserId, int toUserId, const String& message, bool isFromUser);
@@ -109,9 +151,6 @@ private:
     static void webSocketEvent(WStype_t type, uint8_t * payload, size_t length);
     static SocketManager* instance;
     
-    // Helper to parse JSON notification
-    void parseNotificationMessage(const String& message);
-    
     // FreeRTOS task function
     static void socketTask(void* parameter);
     void runSocketTask();  // Actual task implementation
@@ -126,7 +165,11 @@ public:
     // Update socket (call in loop) - now mainly for status logging
     void update();
     
-    // Send message
+    // Call once per loop(): runs the UI callbacks for frames the socket task
+    // decoded since the last call. Screens are only touched from here.
+    void dispatchEvents();
+    
+    // Send a complete JSON frame as-is (queued, its own frame)
     void sendMessage(const String& message);
     
     // Check connection status
@@ -134,6 +177,12 @@ public:
     
     // Check if initialized
     bool isInitialized() const { return initialized; }
+    bool isBinaryWire() const { return binaryWire; }
+    
+    // Outbound queue counters (frames vs messages shows how much batching saves)
+    const SocketOutbox::Stats& getOutboxStats() const { return outbox.getStats(); }
+    void printOutboxStats() const { outbox.printStats(); chatOutbox.printStats(); events.printStats(); }
+    int getUndeliveredChatCount() const { return chatOutbox.getPendingCount(); }
     
     // Disconnect
     void disconnect();
@@ -190,7 +239,35 @@ public:
         onGameMoveCallback = callback;
     }
     
-    // Send chat message
+    // Set game move ack callback
+    void setOnGameMoveAckCallback(OnGameMoveAckCallback callback) {
+        onGameMoveAckCallback = callback;
+    }
+    
+    // Set billiard shot / sync callbacks
+    void setOnBilliardShotCallback(OnBilliardShotCallback callback) {
+        onBilliardShotCallback = callback;
+    }
+    void setOnBilliardSyncCallback(OnBilliardSyncCallback callback) {
+        onBilliardSyncCallback = callback;
+    }
+    
+    // Everything below is queued and written by the socket task on its next tick.
+    
+    // Submit a caro move over the socket; the answer arrives as game_move_ack.
+    // seq = move number the client expects this move to get. Returns false if not connected.
+    bool sendGameMove(int sessionId, int row, int col, int seq);
+    
+    // Ask the server to re-send every move after sinceSeq (gap in seq detected)
+    bool requestGameResync(int sessionId, int sinceSeq);
+    
+    // Billiard lockstep: the server relays both to the opponent as game events.
+    // An empty snapshot asks the opponent (the host) for one.
+    bool sendBilliardShot(int sessionId, int seq, uint32_t tick, int32_t angle, int power, uint32_t hash);
+    bool sendBilliardSync(int sessionId, int seq, const String& snapshot = "");
+    
+    // Send chat message. Works offline too: the message waits in the SPIFFS
+    // outbox and is re-sent until the server confirms it (message_delivered).
     void sendChatMessage(int toUserId, const String& message, const String& messageId = "");
     
     // Send typing indicator
@@ -200,18 +277,9 @@ public:
     // Send read receipt
     void sendReadReceipt(int toUserId, const String& messageId);
     
-    // Set user ID for init message (call before or after begin)
-    void setUserId(int userId) {
-        this->userId = userId;
-        // If already connected, send updated init message
-        if (isConnected && initialized) {
-            String initMessage = "{\"type\":\"init\",\"device\":\"ESP32\",\"user_id\":";
-            initMessage += String(userId);
-            initMessage += "}";
-            String msgCopy = initMessage;
-            webSocket.sendTXT(msgCopy);
-        }
-    }
+    // Set user ID for init message (call before or after begin). If already
+    // connected, the socket task sends an updated init on its next tick.
+    void setUserId(int userId);
     
     // Set ChatScreen state (để xử lý message display)
     // Tự động set SocketManager cho ChatScreen để ChatScreen có thể gửi messages
@@ -226,9 +294,8 @@ public:
     }
     
     // Set SocialScreen state (để xử lý notification và badge)
-    void setSocialScreen(SocialScreen* socialScreen) {
-        this->socialScreen = socialScreen;
-    }
+    // Tự động set SocketManager cho SocialScreen (game screen gửi move qua socket)
+    void setSocialScreen(SocialScreen* socialScreen);
     
     void setSocialScreenActive(bool active) {
         this->isSocialScreenActive = active;
@@ -0,0 +1,110 @@
+#include "socket_outbox.h"
+#include "wire_codec.h"
+
+SocketOutbox::SocketOutbox() {
+    this->count = 0;
+    this->stats = {0, 0, 0, 0, 0};
+    this->mutex = xSemaphoreCreateMutex();
+    if (mutex == NULL) {
+        Serial.println("Socket Outbox: Failed to create mutex!");
+    }
+}
+
+SocketOutbox::~SocketOutbox() {
+    if (mutex != NULL) {
+        vSemaphoreDelete(mutex);
+        mutex = NULL;
+    }
+}
+
+bool SocketOutbox::supersedes(const OutboundMessage& waiting, const OutboundMessage& incoming) {
+    if (waiting.target != incoming.target) {
+        return false;
+    }
+    bool waitingTyping = waiting.type == WireCodec::TYPE_TYPING_START || waiting.type == WireCodec::TYPE_TYPING_STOP;
+    bool incomingTyping = incoming.type == WireCodec::TYPE_TYPING_START || incoming.type == WireCodec::TYPE_TYPING_STOP;
+    if (waitingTyping && incomingTyping) {
+        return true;
+    }
+    return waiting.type == WireCodec::TYPE_READ_RECEIPT && incoming.type == WireCodec::TYPE_READ_RECEIPT;
+}
+
+bool SocketOutbox::push(const OutboundMessage& message) {
+    if (mutex == NULL || xSemaphoreTake(mutex, portMAX_DELAY) != pdTRUE) {
+        return false;
+    }
+
+    bool accepted = true;
+    int merged = -1;
+    for (int i = 0; i < count; i++) {
+        if (supersedes(pending[i], message)) {
+            merged = i;
+            break;
+        }
+    }
+
+    if (merged >= 0) {
+        // Keeps its place in the queue, carries the newer content
+        pending[merged] = message;
+        stats.coalesced++;
+    } else if (count < CAPACITY) {
+        pending[count++] = message;
+    } else {
+        stats.dropped++;
+        accepted = false;
+    }
+    if (accepted) {
+        stats.queued++;
+    }
+
+    xSemaphoreGive(mutex);
+    return accepted;
+}
+
+int SocketOutbox::drain(OutboundMessage* out, int capacity) {
+    if (mutex == NULL || xSemaphoreTake(mutex, portMAX_DELAY) != pdTRUE) {
+        return 0;
+    }
+
+    int n = (count < capacity) ? count : capacity;
+    for (int i = 0; i < n; i++) {
+        out[i] = pending[i];
+        pending[i].text = "";  // Release the chat body now, not when the slot is reused
+        pending[i].id = "";
+    }
+    // Anything past capacity moves to the front for the next tick
+    for (int i = n; i < count; i++) {
+        pending[i - n] = pending[i];
+        pending[i].text = "";
+        pending[i].id = "";
+    }
+    count -= n;
+
+    xSemaphoreGive(mutex);
+    return n;
+}
+
+void SocketOutbox::clear() {
+    if (mutex == NULL || xSemaphoreTake(mutex, portMAX_DELAY) != pdTRUE) {
+        return;
+    }
+    for (int i = 0; i < count; i++) {
+        pending[i].text = "";
+        pending[i].id = "";
+    }
+    count = 0;
+    xSemaphoreGive(mutex);
+}
+
+void SocketOutbox::printStats() const {
+    Serial.print("Socket Outbox: queued=");
+    Serial.print(stats.queued);
+    Serial.print(", coalesced=");
+    Serial.print(stats.coalesced);
+    Serial.print(", dropped=");
+    Serial.print(stats.dropped);
+    Serial.print(", sent=");
+    Serial.print(stats.sent);
+    Serial.print(", frames=");
+    Serial.println(stats.frames);
+}
@@ -0,0 +1,91 @@
+#ifndef SOCKET_OUTBOX_H
+#define SOCKET_OUTBOX_H
+
+#include <Arduino.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/semphr.h>
+
+// One client -> server socket message waiting for the next flush.
+// type is a WireCodec::Type; the fields used depend on it:
+//   chat_message        target = to_user_id, text, id = message_id
+//   typing_start/stop   target = to_user_id
+//   read_receipt        target = to_user_id, id = message_id
+//   game_move           target = session_id, a = row, b = col, c = seq
+//   game_resync         target = session_id, a = since_seq
+//   billiard_shot       target = session_id, a = seq, b = tick, c = angle, d = power, e = hash
+//   billiard_sync       target = session_id, a = seq, text = snapshot (empty: request one)
+// and two device-side types that always go out alone as JSON text, never in
+// a batch or as tlv1:
+//   OUTBOUND_TYPE_INIT  target = user_id (init again after login)
+//   OUTBOUND_TYPE_TEXT  text = a complete JSON frame (SocketManager::sendMessage)
+#define OUTBOUND_TYPE_INIT 0x80
+#define OUTBOUND_TYPE_TEXT 0x81
+
+struct OutboundMessage {
+    uint8_t type;
+    int32_t target;
+    int32_t a;
+    int32_t b;
+    int32_t c;
+    int32_t d;
+    int32_t e;
+    String id;
+    String text;
+
+    OutboundMessage() : type(0), target(0), a(0), b(0), c(0), d(0), e(0) {}
+    OutboundMessage(uint8_t type, int32_t target) : type(type), target(target), a(0), b(0), c(0), d(0), e(0) {}
+};
+
+// Outbound queue between the screens (main loop) and the WebSocket task.
+//
+// SocketManager::send* only push here; the socket task drains everything once
+// per tick and writes it as a single frame. Nothing but the socket task touches
+// WebSocketsClient, and a burst of small messages costs one radio wake-up
+// instead of one per message.
+//
+// Superseded messages are merged in place while they wait:
+// - typing_start/typing_stop to the same user: the latest state wins
+// - read_receipt to the same user: the newest message_id wins (reading a
+//   later message implies the earlier ones)
+// Chat messages, game moves and billiard shots/syncs are never merged.
+class SocketOutbox {
+public:
+    static const int CAPACITY = 16;
+
+    struct Stats {
+        uint32_t queued;      // push() calls accepted
+        uint32_t coalesced;   // Merged into a waiting message
+        uint32_t dropped;     // Outbox full
+        uint32_t sent;        // Messages written to the socket
+        uint32_t frames;      // WebSocket frames those took
+    };
+
+    SocketOutbox();
+    ~SocketOutbox();
+
+    // Main loop side. False if the outbox is full.
+    bool push(const OutboundMessage& message);
+
+    // Socket task side: moves every waiting message into out, oldest first
+    int drain(OutboundMessage* out, int capacity);
+    void clear();
+
+    int getPendingCount() const { return count; }
+
+    void countFrame(int messages) {
+        stats.frames++;
+        stats.sent += messages;
+    }
+    const Stats& getStats() const { return stats; }
+    void printStats() const;
+
+private:
+    OutboundMessage pending[CAPACITY];
+    int count;
+    SemaphoreHandle_t mutex;
+    Stats stats;
+
+    static bool supersedes(const OutboundMessage& waiting, const OutboundMessage& incoming);
+};
+
+#endif
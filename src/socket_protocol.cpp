@@ -0,0 +1,470 @@
+#include "socket_protocol.h"
+
+// text as the inside of a JSON string: quotes, backslashes and every control
+// character escaped (a raw \r or \t is invalid JSON; the server's json.loads rejects it)
+static void appendEscaped(const String& text, String& out) {
+    static const char hex[] = "0123456789abcdef";
+    const char* p = text.c_str();
+    const char* run = p;        // Start of the bytes copied as they are
+    for (; *p; p++) {
+        uint8_t c = (uint8_t)*p;
+        if (c >= 0x20 && c != '"' && c != '\\') continue;
+        out.concat(run, p - run);
+        run = p + 1;
+        char escape[7] = {'\\', (char)c, 0};
+        if (c == '\n') escape[1] = 'n';
+        else if (c == '\r') escape[1] = 'r';
+        else if (c == '\t') escape[1] = 't';
+        else if (c < 0x20) {
+            escape[1] = 'u';
+            escape[2] = '0';
+            escape[3] = '0';
+            escape[4] = hex[c >> 4];
+            escape[5] = hex[c & 15];
+            escape[6] = 0;
+        }
+        out += escape;
+    }
+    out.concat(run, p - run);
+}
+
+String SocketProtocol::initMessage(int userId) {
+    // Offer the binary format and batching; JSON, one message per frame, unless init_ack accepts them
+    String message = "{\"type\":\"init\",\"device\":\"ESP32\",\"wire\":\"";
+    message += WireCodec::FORMAT_NAME;
+    message += "\",\"batch\":true";
+    if (userId > 0) {
+        message += ",\"user_id\":";
+        message += String(userId);
+    }
+    message += "}";
+    return message;
+}
+
+String SocketProtocol::pingMessage(unsigned long now) {
+    return "{\"type\":\"ping\",\"timestamp\":\"" + String(now) + "\"}";
+}
+
+void SocketProtocol::readInitAck(const JsonTokenizer& json, bool& binaryWire, bool& batchFrames) {
+    // Server echoes "wire" only if it speaks the binary format too
+    binaryWire = json.valueEquals("wire", WireCodec::FORMAT_NAME, 0);
+    batchFrames = json.getBool("batch", false, 0);
+}
+
+bool SocketProtocol::encodeWire(const OutboundMessage& message, unsigned long timestamp, WireWriter& wire) {
+    switch (message.type) {
+        case WireCodec::TYPE_CHAT_MESSAGE:
+            wire.putInt(WireCodec::KEY_TO_USER_ID, message.target);
+            wire.putString(WireCodec::KEY_MESSAGE, message.text);
+            wire.putString(WireCodec::KEY_MESSAGE_ID, message.id);
+            wire.putString(WireCodec::KEY_TIMESTAMP, String(timestamp));
+            break;
+        case WireCodec::TYPE_TYPING_START:
+        case WireCodec::TYPE_TYPING_STOP:
+            wire.putInt(WireCodec::KEY_TO_USER_ID, message.target);
+            break;
+        case WireCodec::TYPE_READ_RECEIPT:
+            wire.putInt(WireCodec::KEY_TO_USER_ID, message.target);
+            wire.putString(WireCodec::KEY_MESSAGE_ID, message.id);
+            break;
+        case WireCodec::TYPE_GAME_MOVE:
+            wire.putInt(WireCodec::KEY_SESSION_ID, message.target);
+            wire.putInt(WireCodec::KEY_ROW, message.a);
+            wire.putInt(WireCodec::KEY_COL, message.b);
+            wire.putInt(WireCodec::KEY_SEQ, message.c);
+            break;
+        case WireCodec::TYPE_GAME_RESYNC:
+            wire.putInt(WireCodec::KEY_SESSION_ID, message.target);
+            wire.putInt(WireCodec::KEY_SINCE_SEQ, message.a);
+            break;
+        case WireCodec::TYPE_BILLIARD_SHOT:
+            wire.putInt(WireCodec::KEY_SESSION_ID, message.target);
+            wire.putInt(WireCodec::KEY_SEQ, message.a);
+            wire.putInt(WireCodec::KEY_TICK, message.b);
+            wire.putInt(WireCodec::KEY_ANGLE, message.c);
+            wire.putInt(WireCodec::KEY_POWER, message.d);
+            wire.putInt(WireCodec::KEY_HASH, message.e);
+            break;
+        case WireCodec::TYPE_BILLIARD_SYNC:
+            wire.putInt(WireCodec::KEY_SESSION_ID, message.target);
+            wire.putInt(WireCodec::KEY_SEQ, message.a);
+            if (message.text.length() > 0) {
+                wire.putString(WireCodec::KEY_SNAPSHOT, message.text);
+            }
+            break;
+        default:
+            return false;
+    }
+    return wire.ok();
+}
+
+void SocketProtocol::appendJson(const OutboundMessage& message, unsigned long timestamp, String& out) {
+    if (message.type == OUTBOUND_TYPE_INIT) {
+        out += initMessage(message.target);
+        return;
+    }
+    if (message.type == OUTBOUND_TYPE_TEXT) {
+        out += message.text;
+        return;
+    }
+    out += "{\"type\":\"";
+    out += WireCodec::typeName(message.type);
+    out += "\"";
+    switch (message.type) {
+        case WireCodec::TYPE_CHAT_MESSAGE: {
+            out += ",\"to_user_id\":";
+            out += String(message.target);
+            out += ",\"message\":\"";
+            appendEscaped(message.text, out);
+            out += "\",\"message_id\":\"";
+            out += message.id;
+            out += "\",\"timestamp\":\"";
+            // Simple timestamp (ISO format would be better but keeping it simple)
+            out += String(timestamp);
+            out += "\"";
+            break;
+        }
+        case WireCodec::TYPE_TYPING_START:
+        case WireCodec::TYPE_TYPING_STOP:
+            out += ",\"to_user_id\":";
+            out += String(message.target);
+            break;
+        case WireCodec::TYPE_READ_RECEIPT:
+            out += ",\"to_user_id\":";
+            out += String(message.target);
+            out += ",\"message_id\":\"";
+            out += message.id;
+            out += "\"";
+            break;
+        case WireCodec::TYPE_GAME_MOVE:
+            out += ",\"session_id\":";
+            out += String(message.target);
+            out += ",\"row\":";
+            out += String(message.a);
+            out += ",\"col\":";
+            out += String(message.b);
+            out += ",\"seq\":";
+            out += String(message.c);
+            break;
+        case WireCodec::TYPE_GAME_RESYNC:
+            out += ",\"session_id\":";
+            out += String(message.target);
+            out += ",\"since_seq\":";
+            out += String(message.a);
+            break;
+        case WireCodec::TYPE_BILLIARD_SHOT:
+            out += ",\"session_id\":";
+            out += String(message.target);
+            out += ",\"seq\":";
+            out += String(message.a);
+            out += ",\"tick\":";
+            out += String(message.b);
+            out += ",\"angle\":";
+            out += String(message.c);
+            out += ",\"power\":";
+            out += String(message.d);
+            out += ",\"hash\":";
+            out += String(message.e);
+            break;
+        case WireCodec::TYPE_BILLIARD_SYNC:
+            out += ",\"session_id\":";
+            out += String(message.target);
+            out += ",\"seq\":";
+            out += String(message.a);
+            if (message.text.length() > 0) {
+                // Hex - nothing to escape
+                out += ",\"snapshot\":\"";
+                out += message.text;
+                out += "\"";
+            }
+            break;
+    }
+    out += "}";
+}
+
+bool SocketProtocol::decodeEvent(const JsonTokenizer& json, SocketEvent& event, String* texts) {
+    event = SocketEvent();
+    switch (json.getTypeHash()) {
+        case JsonTokenizer::hashOf("notification"):
+            return decodeNotification(json, event, texts);
+        case JsonTokenizer::hashOf("chat_message"):
+            return decodeChatMessage(json, event, texts);
+        case JsonTokenizer::hashOf("typing_start"):
+        case JsonTokenizer::hashOf("typing_stop"):
+            if (!json.has("from_user_id", 0)) return false;
+            event.kind = SocketEvent::TYPING;
+            event.values[0] = json.getInt("from_user_id", 0, 0);
+            event.values[1] = json.getTypeHash() == JsonTokenizer::hashOf("typing_start") ? 1 : 0;
+            event.textCount = 1;
+            texts[0] = json.getString("from_nickname", 0);
+            return true;
+        case JsonTokenizer::hashOf("message_delivered"):
+            event.kind = SocketEvent::DELIVERED;
+            event.textCount = 3;
+            texts[0] = json.getString("message_id", 0);
+            texts[1] = "delivered";
+            texts[2] = json.getString("timestamp", 0);
+            return true;
+        case JsonTokenizer::hashOf("message_read"):
+            event.kind = SocketEvent::READ_RECEIPT;
+            event.textCount = 2;
+            texts[0] = json.getString("message_id", 0);
+            texts[1] = json.getString("timestamp", 0);
+            return true;
+        case JsonTokenizer::hashOf("user_status_update"):
+            return decodeUserStatus(json, event, texts);
+        case JsonTokenizer::hashOf("game_event"):
+            return decodeGameEvent(json, event, texts);
+        case JsonTokenizer::hashOf("game_move_ack"):
+            return decodeGameMoveAck(json, event, texts);
+        default:
+            return false;
+    }
+}
+
+bool SocketProtocol::decodeNotification(const JsonTokenizer& json, SocketEvent& event, String* texts) {
+    // {"type":"notification","notification":{"id":123,"type":"friend_request_accepted","message":"...","timestamp":"...","read":false}}
+    // Fields of the nested "notification" object are tokenized at depth 1
+    const JsonField* notificationField = json.find("notification", 0);
+    if (notificationField == nullptr || notificationField->type != JSON_OBJECT) {
+        return false;
+    }
+    if (!json.has("id", 1) || !json.has("type", 1) || !json.has("message", 1)) {
+        return false;
+    }
+    event.kind = SocketEvent::NOTIFICATION;
+    event.values[0] = json.getInt("id", 0, 1);
+    event.values[1] = json.getBool("read", false, 1) ? 1 : 0;
+    event.textCount = 3;
+    texts[0] = json.getString("type", 1);
+    texts[1] = json.getString("message", 1);
+    texts[2] = json.getString("timestamp", 1);   // Optional
+    return true;
+}
+
+bool SocketProtocol::decodeChatMessage(const JsonTokenizer& json, SocketEvent& event, String* texts) {
+    if (!json.has("from_user_id", 0) || !json.has("message", 0)) {
+        return false;
+    }
+    event.kind = SocketEvent::CHAT_MESSAGE;
+    event.values[0] = json.getInt("from_user_id", 0, 0);
+    event.textCount = 4;
+    texts[0] = json.getString("message", 0);
+    texts[1] = json.getString("from_nickname", 0);
+    texts[2] = json.getString("message_id", 0);
+    texts[3] = json.getString("timestamp", 0);
+    return true;
+}
+
+bool SocketProtocol::decodeUserStatus(const JsonTokenizer& json, SocketEvent& event, String* texts) {
+    const JsonField* userIdField = json.find("user_id", 0);
+    if (userIdField == nullptr || userIdField->type != JSON_NUMBER || !json.has("status", 0)) {
+        return false;
+    }
+    event.kind = SocketEvent::USER_STATUS;
+    event.values[0] = json.getInt("user_id", 0, 0);
+    event.textCount = 1;
+    texts[0] = json.getString("status", 0);
+    return true;
+}
+
+bool SocketProtocol::decodeGameEvent(const JsonTokenizer& json, SocketEvent& event, String* texts) {
+    // Server sends nested: {"type": "game_event", "event": {"event_type": ...}}
+    // Fields of the "event" object are tokenized at depth 1
+    const JsonField* eventField = json.find("event", 0);
+    int scope = (eventField != nullptr && eventField->type == JSON_OBJECT) ? 1 : 0;
+
+    String eventType = json.getString("event_type", scope);
+    int sessionId = json.getInt("session_id", -1, scope);
+    int userId = json.getInt("user_id", -1, scope);
+
+    if (eventType == "move") {
+        int moveRow = json.getInt("row", -1, scope);
+        int moveCol = json.getInt("col", -1, scope);
+        if (moveRow < 0 || moveCol < 0) {
+            return false;
+        }
+        event.kind = SocketEvent::GAME_MOVE;
+        event.values[0] = sessionId;
+        event.values[1] = userId;
+        event.values[2] = moveRow;
+        event.values[3] = moveCol;
+        event.values[4] = json.getInt("winner_id", -1, scope);  // null -> -1
+        event.values[5] = json.getInt("current_turn", -1, scope);
+        event.values[6] = json.getInt("seq", -1, scope);
+        event.textCount = 1;
+        texts[0] = json.getString("game_status", scope);
+        return true;
+    }
+
+    if (eventType == "billiard_shot") {
+        if (!json.has("seq", scope) || !json.has("angle", scope) || !json.has("power", scope)) {
+            return false;
+        }
+        event.kind = SocketEvent::BILLIARD_SHOT;
+        event.values[0] = sessionId;
+        event.values[1] = userId;
+        event.values[2] = json.getInt("seq", 0, scope);
+        event.values[3] = json.getInt("tick", 0, scope);
+        event.values[4] = json.getInt("angle", 0, scope);
+        event.values[5] = json.getInt("power", 0, scope);
+        event.values[6] = json.getInt("hash", 0, scope);
+        return true;
+    }
+
+    if (eventType == "billiard_sync") {
+        event.kind = SocketEvent::BILLIARD_SYNC;
+        event.values[0] = sessionId;
+        event.values[1] = userId;
+        event.values[2] = json.getInt("seq", 0, scope);
+        event.textCount = 1;
+        texts[0] = json.getString("snapshot", scope);  // Missing -> "" (request)
+        return true;
+    }
+
+    event.kind = SocketEvent::GAME_EVENT;
+    event.values[0] = sessionId;
+    event.values[1] = userId;
+    event.values[2] = json.getBool("accepted", false, scope) ? 1 : 0;
+    event.values[3] = json.getBool("ready", false, scope) ? 1 : 0;
+    event.textCount = 5;
+    texts[0] = eventType.length() > 0 ? eventType : String("unknown");
+    texts[1] = json.getString("game_type", scope);
+    texts[2] = json.getString("status", scope);
+    texts[3] = json.getString("host_nickname", scope);
+    texts[4] = json.getString("user_nickname", scope);
+    return true;
+}
+
+bool SocketProtocol::decodeGameMoveAck(const JsonTokenizer& json, SocketEvent& event, String* texts) {
+    event.kind = SocketEvent::GAME_MOVE_ACK;
+    event.values[0] = json.getInt("session_id", -1, 0);
+    event.values[1] = json.getInt("seq", -1, 0);
+    event.values[2] = json.getBool("success", false, 0) ? 1 : 0;
+    event.values[3] = json.getInt("winner_id", -1, 0);  // null -> -1
+    event.values[4] = json.getInt("current_turn", -1, 0);
+    event.textCount = 2;
+    texts[0] = json.getString("message", 0);
+    texts[1] = json.getString("game_status", 0);
+    return true;
+}
+
+void SocketFramer::write(const OutboundMessage* messages, int count, bool binaryWire, bool batchFrames,
+                         unsigned long now, SocketFrameSink& sink) {
+    int start = 0;
+    for (int i = 0; i < count; i++) {
+        if (messages[i].type != OUTBOUND_TYPE_INIT && messages[i].type != OUTBOUND_TYPE_TEXT) {
+            continue;
+        }
+        if (i > start) {
+            writeRun(messages + start, i - start, binaryWire, batchFrames, now, sink);
+        }
+        String text;
+        SocketProtocol::appendJson(messages[i], now, text);
+        sink.writeFrame(text, 1);
+        start = i + 1;
+    }
+    if (count > start) {
+        writeRun(messages + start, count - start, binaryWire, batchFrames, now, sink);
+    }
+}
+
+void SocketFramer::writeRun(const OutboundMessage* messages, int count, bool binaryWire, bool batchFrames,
+                            unsigned long now, SocketFrameSink& sink) {
+    bool batching = batchFrames && count > 1;
+    if (binaryWire) {
+        WireWriter batch(frame, sizeof(frame), WireCodec::TYPE_BATCH);
+        int inBatch = 0;
+        for (int i = 0; i < count; i++) {
+            WireWriter encoded(item, sizeof(item), messages[i].type);
+            if (!SocketProtocol::encodeWire(messages[i], now, encoded)) {
+                continue;  // Can't happen within the 500-char chat limit
+            }
+            if (!batching) {
+                sink.writeFrame(encoded.data(), encoded.length(), 1);
+                continue;
+            }
+            if (inBatch > 0 && batch.length() + encoded.length() + 2 > sizeof(frame)) {
+                sink.writeFrame(batch.data(), batch.length(), inBatch);
+                batch = WireWriter(frame, sizeof(frame), WireCodec::TYPE_BATCH);
+                inBatch = 0;
+            }
+            batch.putFrame(encoded.data(), encoded.length());
+            inBatch++;
+        }
+        if (inBatch > 0) {
+            sink.writeFrame(batch.data(), batch.length(), inBatch);
+        }
+    } else {
+        String text = batching ? "{\"type\":\"batch\",\"messages\":[" : "";
+        for (int i = 0; i < count; i++) {
+            if (!batching) {
+                text = "";
+                SocketProtocol::appendJson(messages[i], now, text);
+                sink.writeFrame(text, 1);
+                continue;
+            }
+            if (i > 0) {
+                text += ",";
+            }
+            SocketProtocol::appendJson(messages[i], now, text);
+        }
+        if (batching) {
+            text += "]}";
+            sink.writeFrame(text, count);
+        }
+    }
+}
+
+SocketTyping::SocketTyping() {
+    this->typingToUserId = -1;
+    this->lastKeystroke = 0;
+    this->onWireToUserId = -1;
+    this->onWireAt = 0;
+    this->stoppingUserId = -1;
+}
+
+bool SocketTyping::autoStop(unsigned long now, OutboundMessage& stop) {
+    if (typingToUserId == -1 || now - lastKeystroke < TYPING_AUTO_STOP_INTERVAL) {
+        return false;
+    }
+    stop = OutboundMessage(WireCodec::TYPE_TYPING_STOP, typingToUserId);
+    typingToUserId = -1;
+    return true;
+}
+
+bool SocketTyping::admit(const OutboundMessage& message, unsigned long now, int& replaced) {
+    replaced = -1;
+    if (message.type == WireCodec::TYPE_TYPING_START) {
+        // The screens queue one per keystroke; the outbox merged those of this tick
+        if (onWireToUserId != -1 && onWireToUserId != message.target) {
+            replaced = onWireToUserId;
+            stoppingUserId = onWireToUserId;
+        } else if (stoppingUserId == message.target) {
+            stoppingUserId = -1;  // Back before its stop went out: the outbox merged the two
+        }
+        typingToUserId = message.target;
+        lastKeystroke = now;
+        if (onWireToUserId == message.target && now - onWireAt < TYPING_REFRESH_INTERVAL) {
+            return false;
+        }
+        onWireToUserId = message.target;
+        onWireAt = now;
+        return true;
+    }
+    if (message.type == WireCodec::TYPE_TYPING_STOP) {
+        if (typingToUserId == message.target) {
+            typingToUserId = -1;
+        }
+        if (stoppingUserId == message.target) {
+            stoppingUserId = -1;
+            return true;
+        }
+        if (onWireToUserId != message.target) {
+            return false;
+        }
+        onWireToUserId = -1;
+        return true;
+    }
+    return true;
+}
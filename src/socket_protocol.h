@@ -0,0 +1,113 @@
+#ifndef SOCKET_PROTOCOL_H
+#define SOCKET_PROTOCOL_H
+
+#include <Arduino.h>
+#include "json_tokenizer.h"
+#include "wire_codec.h"
+#include "socket_outbox.h"
+#include "socket_event_queue.h"
+
+// Largest frame SocketFramer builds (a batch is split across frames beyond this)
+#define SOCKET_TX_FRAME_SIZE 1024
+
+// Typing indicator constants
+#define TYPING_AUTO_STOP_INTERVAL 3000  // 3 seconds
+#define TYPING_REFRESH_INTERVAL 1900    // Re-send typing_start while typing: the server expires it after 5 s,
+                                        // refresh + auto stop must stay under that or the indicator blinks off
+
+// The device's side of the WebSocket protocol, without the transport:
+// what it sends (init, ping, queued messages as JSON or tlv1) and how it
+// reads server frames into SocketEvents. SocketManager wraps this with
+// WebSocketsClient, the outboxes and the screens; tools/loadgen drives it
+// from an epoll loop, so both speak byte-for-byte the same protocol.
+//
+// No Serial, millis() or FreeRTOS calls in here: callers pass the time.
+class SocketProtocol {
+public:
+    // {"type":"init",...} offering tlv1 and batching; user_id only if userId > 0
+    static String initMessage(int userId);
+    static String pingMessage(unsigned long now);
+
+    // What init_ack accepted: binary wire format, "batch" frames
+    static void readInitAck(const JsonTokenizer& json, bool& binaryWire, bool& batchFrames);
+
+    // One queued message as a JSON object appended to out / as a binary
+    // frame (false if it doesn't fit, or for OUTBOUND_TYPE_INIT/TEXT, which
+    // are JSON only). timestamp goes into chat messages.
+    static void appendJson(const OutboundMessage& message, unsigned long timestamp, String& out);
+    static bool encodeWire(const OutboundMessage& message, unsigned long timestamp, WireWriter& wire);
+
+    // A tokenized server frame (JSON or decoded tlv1) as a SocketEvent, see
+    // socket_event_queue.h for the layout. texts needs SocketEvent::MAX_TEXTS
+    // entries. False for frames that aren't events (init_ack, pong,
+    // chat_error, unknown types) or that miss a required field.
+    static bool decodeEvent(const JsonTokenizer& json, SocketEvent& event, String* texts);
+
+private:
+    static bool decodeNotification(const JsonTokenizer& json, SocketEvent& event, String* texts);
+    static bool decodeChatMessage(const JsonTokenizer& json, SocketEvent& event, String* texts);
+    static bool decodeUserStatus(const JsonTokenizer& json, SocketEvent& event, String* texts);
+    static bool decodeGameEvent(const JsonTokenizer& json, SocketEvent& event, String* texts);
+    static bool decodeGameMoveAck(const JsonTokenizer& json, SocketEvent& event, String* texts);
+};
+
+// Where SocketFramer writes finished frames. messages = how many queued
+// messages the frame carries (for the outbox stats).
+class SocketFrameSink {
+public:
+    virtual ~SocketFrameSink() {}
+    virtual bool writeFrame(const uint8_t* data, size_t length, int messages) = 0;
+    virtual bool writeFrame(String& text, int messages) = 0;
+};
+
+// Turns a drained outbox into frames: one message goes out as-is; several
+// share "batch" frames (at most SOCKET_TX_FRAME_SIZE bytes each) when the
+// server accepted batching, otherwise they go one frame each. init and raw
+// text messages always get a JSON frame of their own, in queue order. Owns
+// the encode buffers so they don't live on the caller's stack.
+class SocketFramer {
+public:
+    void write(const OutboundMessage* messages, int count, bool binaryWire, bool batchFrames,
+               unsigned long now, SocketFrameSink& sink);
+
+private:
+    uint8_t frame[SOCKET_TX_FRAME_SIZE];
+    uint8_t item[600];              // One encoded message (500-char chat + ids)
+
+    void writeRun(const OutboundMessage* messages, int count, bool binaryWire, bool batchFrames,
+                  unsigned long now, SocketFrameSink& sink);
+};
+
+// Typing indicator state, owned by the socket task. The screens only queue
+// typing_start (every keystroke) and typing_stop; this decides which of them
+// reach the server:
+// - typing_start the server already has is dropped until the refresh is due
+//   (TYPING_REFRESH_INTERVAL, the server expires it after 5 s)
+// - typing_stop for a user the server doesn't think we type to is dropped
+// - typing_start to another user stops the previous one
+// - typing stops by itself TYPING_AUTO_STOP_INTERVAL after the last keystroke
+class SocketTyping {
+public:
+    SocketTyping();
+
+    // Once per tick, after the flush: true (stop filled in) when typing should
+    // end by itself
+    bool autoStop(unsigned long now, OutboundMessage& stop);
+
+    // Each drained typing message; false = no frame needed. replaced = user
+    // the server still shows us typing to when a typing_start goes to someone
+    // else (-1 = none): queue a typing_stop for them.
+    bool admit(const OutboundMessage& message, unsigned long now, int& replaced);
+
+    // Connection lost: the server forgot our typing state
+    void reset() { onWireToUserId = -1; }
+
+private:
+    int typingToUserId;             // Latest typing_start from the screens (-1 = none)
+    unsigned long lastKeystroke;
+    int onWireToUserId;             // Typing state the server last got from us (-1 = none)
+    unsigned long onWireAt;
+    int stoppingUserId;             // Replaced by a typing_start to someone else, stop queued
+};
+
+#endif
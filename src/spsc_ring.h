@@ -0,0 +1,72 @@
+#ifndef SPSC_RING_H
+#define SPSC_RING_H
+
+#include <stdint.h>
+#include <atomic>
+
+// Fixed-capacity single-producer / single-consumer ring, no locks.
+//
+// Exactly one task may call the producer side (push, freeSpace) and exactly
+// one the consumer side (pop, size). head is written only by the
+// producer and tail only by the consumer; the release store of one paired
+// with the acquire load on the other side publishes the slot contents.
+// Indices run freely and wrap at 2^32, so CAPACITY must be a power of two
+// and head - tail is always the fill level.
+//
+// T is copied in and out by value - keep it small and trivially copyable.
+template <typename T, uint32_t CAPACITY>
+class SpscRing {
+    static_assert(CAPACITY > 0 && (CAPACITY & (CAPACITY - 1)) == 0, "SpscRing CAPACITY must be a power of two");
+
+public:
+    SpscRing() : head(0), tail(0) {}
+
+    // Producer. False if full (the item is not stored).
+    bool push(const T& item) {
+        uint32_t h = head.load(std::memory_order_relaxed);
+        if (h - tail.load(std::memory_order_acquire) >= CAPACITY) {
+            return false;
+        }
+        slots[h & (CAPACITY - 1)] = item;
+        head.store(h + 1, std::memory_order_release);
+        return true;
+    }
+
+    // Consumer. False if empty.
+    bool pop(T& out) {
+        uint32_t t = tail.load(std::memory_order_relaxed);
+        if (t == head.load(std::memory_order_acquire)) {
+            return false;
+        }
+        out = slots[t & (CAPACITY - 1)];
+        tail.store(t + 1, std::memory_order_release);
+        return true;
+    }
+
+    // Producer side: slots that push() can still fill
+    uint32_t freeSpace() const {
+        return CAPACITY - (head.load(std::memory_order_relaxed) - tail.load(std::memory_order_acquire));
+    }
+
+    // Consumer side: items waiting
+    uint32_t size() const {
+        return head.load(std::memory_order_acquire) - tail.load(std::memory_order_relaxed);
+    }
+
+    bool empty() const { return size() == 0; }
+
+    // Only while neither side is running (e.g. before the producer task starts)
+    void reset() {
+        head.store(0, std::memory_order_relaxed);
+        tail.store(0, std::memory_order_relaxed);
+    }
+
+    static uint32_t capacity() { return CAPACITY; }
+
+private:
+    T slots[CAPACITY];
+    std::atomic<uint32_t> head;  // Next write (producer)
+    std::atomic<uint32_t> tail;  // Next read (consumer)
+};
+
+#endif
@@ -0,0 +1,142 @@
+#include "task_layout.h"
+
+#ifndef ARDUINO_RUNNING_CORE
+#define ARDUINO_RUNNING_CORE TASK_UI_CORE
+#endif
+#ifndef CONFIG_ARDUINO_LOOP_STACK_SIZE
+#define CONFIG_ARDUINO_LOOP_STACK_SIZE 8192
+#endif
+
+const TaskLayout::Spec TaskLayout::specs[TaskLayout::ROLE_COUNT] = {
+    {"WebSocketTask", TASK_SOCKET_STACK, TASK_SOCKET_PRIORITY, TASK_NETWORK_CORE},
+    {"ApiWorkerTask", TASK_API_STACK, TASK_API_PRIORITY, TASK_NETWORK_CORE},
+    {"TftPushTask", TASK_TFT_PUSH_STACK, TASK_TFT_PUSH_PRIORITY, TASK_TFT_PUSH_CORE},
+    {"loopTask", CONFIG_ARDUINO_LOOP_STACK_SIZE, 1, ARDUINO_RUNNING_CORE},  // Created by the Arduino core
+};
+
+TaskLayout::Entry TaskLayout::entries[TaskLayout::MAX_TASKS];
+int TaskLayout::entryCount = 0;
+uint32_t TaskLayout::reportStartMicros = 0;
+uint32_t TaskLayout::lastPollMs = 0;
+TaskLayout::InputStats TaskLayout::input = {0, 0, 0, {0, 0, 0, 0, 0}};
+
+void TaskLayout::registerTask(TaskHandle_t handle, Role role, uint32_t stackBytes, UBaseType_t priority, BaseType_t core) {
+    if (handle == nullptr || entryCount >= MAX_TASKS) {
+        return;
+    }
+    Entry& entry = entries[entryCount];
+    entry.handle = handle;
+    entry.role = role;
+    entry.stackBytes = stackBytes;
+    entry.priority = priority;
+    entry.core = core;
+    entry.busyMicros = 0;
+    entryCount++;  // Published last: addBusy() only looks at complete entries
+    if (reportStartMicros == 0) {
+        reportStartMicros = micros();
+    }
+}
+
+BaseType_t TaskLayout::spawn(Role role, TaskFunction_t function, void* parameter, TaskHandle_t* handle) {
+    const Spec& spec = specs[role];
+    TaskHandle_t created = nullptr;
+    BaseType_t ok = xTaskCreatePinnedToCore(
+        function,
+        spec.name,
+        spec.stackBytes,
+        parameter,
+        spec.priority,
+        &created,
+        spec.core
+    );
+    if (handle != nullptr) {
+        *handle = (ok == pdPASS) ? created : nullptr;
+    }
+    if (ok != pdPASS) {
+        Serial.print("Task Layout: Could not create ");
+        Serial.println(spec.name);
+        return ok;
+    }
+    registerTask(created, role, spec.stackBytes, spec.priority, spec.core);
+    Serial.print("Task Layout: ");
+    Serial.print(spec.name);
+    Serial.print(" on core ");
+    Serial.print((int)spec.core);
+    Serial.print(", priority ");
+    Serial.print((int)spec.priority);
+    Serial.print(", stack ");
+    Serial.println(spec.stackBytes);
+    return ok;
+}
+
+void TaskLayout::adoptCurrentTask(Role role) {
+    BaseType_t core = xPortGetCoreID();
+    registerTask(xTaskGetCurrentTaskHandle(), role, specs[role].stackBytes, uxTaskPriorityGet(NULL), core);
+    if (core != specs[role].core) {
+        Serial.print("Task Layout: ⚠️  ");
+        Serial.print(specs[role].name);
+        Serial.print(" runs on core ");
+        Serial.print((int)core);
+        Serial.print(", expected ");
+        Serial.println((int)specs[role].core);
+    }
+}
+
+void TaskLayout::addBusy(uint32_t micros) {
+    TaskHandle_t self = xTaskGetCurrentTaskHandle();
+    int count = entryCount;
+    for (int i = 0; i < count; i++) {
+        if (entries[i].handle == self) {
+            entries[i].busyMicros += micros;  // Only this task writes its entry
+            return;
+        }
+    }
+}
+
+void TaskLayout::noteInputPoll() {
+    uint32_t now = millis();
+    if (input.polls > 0) {
+        uint32_t gap = now - lastPollMs;
+        input.totalGapMs += gap;
+        if (gap > input.maxGapMs) input.maxGapMs = gap;
+        int bucket = (gap <= 15) ? 0 : (gap <= 30) ? 1 : (gap <= 60) ? 2 : (gap <= 120) ? 3 : 4;
+        input.buckets[bucket]++;
+    }
+    input.polls++;
+    lastPollMs = now;
+}
+
+void TaskLayout::printReport() {
+    uint32_t now = micros();
+    uint32_t window = now - reportStartMicros;
+    if (window == 0) window = 1;
+
+    Serial.println("Task Layout: task            core prio  stack  unused  busy%");
+    for (int i = 0; i < entryCount; i++) {
+        Entry& entry = entries[i];
+        uint32_t busy = entry.busyMicros;
+        entry.busyMicros = 0;  // A concurrent addBusy() may be lost - fine for a report
+        // ESP-IDF reports the high-water mark in bytes
+        uint32_t unused = uxTaskGetStackHighWaterMark(entry.handle);
+        char line[80];
+        snprintf(line, sizeof(line), "  %-16s %4d %4d %6u %7u %5.1f",
+                 specs[entry.role].name, (int)entry.core, (int)entry.priority,
+                 (unsigned)entry.stackBytes, (unsigned)unused, busy * 100.0f / window);
+        Serial.println(line);
+    }
+    reportStartMicros = now;
+
+    uint32_t gaps = input.polls > 1 ? input.polls - 1 : 0;
+    Serial.print("Task Layout: input polls=");
+    Serial.print(input.polls);
+    Serial.print(", avg gap=");
+    Serial.print(gaps > 0 ? input.totalGapMs / gaps : 0);
+    Serial.print(" ms, max gap=");
+    Serial.print(input.maxGapMs);
+    Serial.print(" ms, <=15/30/60/120/>120: ");
+    for (int i = 0; i < 5; i++) {
+        Serial.print(input.buckets[i]);
+        Serial.print(i < 4 ? "/" : "\n");
+    }
+    input = {0, 0, 0, {0, 0, 0, 0, 0}};
+}
@@ -0,0 +1,136 @@
+#ifndef TASK_LAYOUT_H
+#define TASK_LAYOUT_H
+
+#include <Arduino.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+
+// Which FreeRTOS task runs where.
+//
+//   core 0 (network): WebSocketTask, ApiWorkerTask(s)
+//                     - next to the Wi-Fi/lwIP tasks the ESP32 already runs there
+//                     TftPushTask - SPI transfer only (see TASK_TFT_PUSH_CORE)
+//   core 1 (UI):      Arduino loopTask - input polling, screen update/draw
+//                     (all rendering), SocketManager::dispatchEvents(),
+//                     ApiRequestQueue::poll()
+//
+// Nothing that parses network data runs on core 1 any more, so the loop
+// (priority 1) is never time-sliced against the WebSocket task.
+//
+// Cores, stack sizes (bytes) and priorities can be overridden per build with
+// -D flags in platformio.ini, e.g. -DTASK_SOCKET_STACK=6144.
+#ifndef TASK_NETWORK_CORE
+#define TASK_NETWORK_CORE 0
+#endif
+#ifndef TASK_UI_CORE
+#define TASK_UI_CORE 1
+#endif
+
+#ifndef TASK_SOCKET_STACK
+#define TASK_SOCKET_STACK 4096
+#endif
+#ifndef TASK_SOCKET_PRIORITY
+#define TASK_SOCKET_PRIORITY 1
+#endif
+
+#ifndef TASK_API_STACK
+#define TASK_API_STACK 8192          // HTTPClient + response String
+#endif
+#ifndef TASK_API_PRIORITY
+#define TASK_API_PRIORITY 1
+#endif
+
+#ifndef TASK_TFT_PUSH_STACK
+#define TASK_TFT_PUSH_STACK 2048
+#endif
+#ifndef TASK_TFT_PUSH_PRIORITY
+#define TASK_TFT_PUSH_PRIORITY 2     // Above the network tasks so strips never starve
+#endif
+// Not a rendering task: loop() composes every pixel into the strips on core 1,
+// this task only clocks finished strips out. That transfer keeps the CPU busy
+// (Adafruit_SPITFT has no DMA path on the ESP32; SPI.writePixels fills the
+// FIFO in a loop), so on core 1 at priority 2 it would preempt loop() for the
+// whole transfer and the pipelined flush would overlap nothing. On core 0 it
+// only yields to Wi-Fi/lwIP. -DTASK_TFT_PUSH_CORE=1 to compare on a device.
+#ifndef TASK_TFT_PUSH_CORE
+#define TASK_TFT_PUSH_CORE TASK_NETWORK_CORE
+#endif
+
+class TaskLayout {
+public:
+    enum Role {
+        ROLE_SOCKET = 0,
+        ROLE_API_WORKER,
+        ROLE_TFT_PUSH,
+        ROLE_LOOP,
+        ROLE_COUNT
+    };
+
+    struct Spec {
+        const char* name;
+        uint32_t stackBytes;
+        UBaseType_t priority;
+        BaseType_t core;
+    };
+
+    // Input poll gaps = worst-case extra latency before a press is seen
+    struct InputStats {
+        uint32_t polls;
+        uint32_t maxGapMs;
+        uint32_t totalGapMs;
+        uint32_t buckets[5];  // <=15, <=30, <=60, <=120, >120 ms
+    };
+
+    static const int MAX_TASKS = 8;
+
+    static const Spec& getSpec(Role role) { return specs[role]; }
+
+    // xTaskCreatePinnedToCore with the role's name/stack/priority/core.
+    // The task is registered for printReport().
+    static BaseType_t spawn(Role role, TaskFunction_t function, void* parameter, TaskHandle_t* handle);
+
+    // Register the calling task (Arduino's loopTask, created by the core).
+    static void adoptCurrentTask(Role role);
+
+    // Time the calling task spends working instead of waiting for its next
+    // job, for the busy% column (an API worker's includes the HTTP round trip).
+    // Wrap each iteration's work: { TaskLayout::BusyScope busy; ... }
+    class BusyScope {
+    public:
+        BusyScope() : startMicros(micros()) {}
+        ~BusyScope() { addBusy(micros() - startMicros); }
+    private:
+        uint32_t startMicros;
+    };
+    static void addBusy(uint32_t micros);
+
+    // Call at each input poll (handleHardwareInputs)
+    static void noteInputPoll();
+    static const InputStats& getInputStats() { return input; }
+
+    // Per task: core, priority, stack size, stack never used (high-water mark),
+    // busy % since the last report; then the input poll histogram. Resets the
+    // busy and input counters.
+    static void printReport();
+
+private:
+    struct Entry {
+        TaskHandle_t handle;
+        Role role;
+        uint32_t stackBytes;
+        UBaseType_t priority;
+        BaseType_t core;
+        volatile uint32_t busyMicros;
+    };
+
+    static const Spec specs[ROLE_COUNT];
+    static Entry entries[MAX_TASKS];
+    static int entryCount;
+    static uint32_t reportStartMicros;
+    static uint32_t lastPollMs;
+    static InputStats input;
+
+    static void registerTask(TaskHandle_t handle, Role role, uint32_t stackBytes, UBaseType_t priority, BaseType_t core);
+};
+
+#endif
@@ -0,0 +1,550 @@
+#include "tft_compositor.h"
+#include "task_layout.h"
+#include <esp_heap_caps.h>
+
+// A setAddrWindow burst costs about as much as this many pixels, so two rects
+// are merged when the union adds less than that in untouched pixels.
+static const int32_t MERGE_SLACK_PIXELS = 64;
+
+// Both strip buffers of the pipelined flush
+static const uint32_t PIPELINE_BYTES = TftCompositor::STRIP_COUNT * TftCompositor::STRIP_PIXELS * sizeof(uint16_t);
+
+TftCompositor* TftCompositor::instance = nullptr;
+
+TftCompositor::TftCompositor(SPIClass* spiClass, int8_t cs, int8_t dc, int8_t rst)
+    : Adafruit_ST7789(spiClass, cs, dc, rst) {
+    for (int i = 0; i < MAX_BANDS; i++) {
+        bands[i] = nullptr;
+    }
+    bandCount = 0;
+    shadowWidth = 0;
+    shadowHeight = 0;
+    dirtyCount = 0;
+    frameDepth = 0;
+    frameLabel = nullptr;
+    logStats = false;
+    for (int i = 0; i < STRIP_COUNT; i++) {
+        strips[i] = nullptr;
+    }
+    freeStrips = nullptr;
+    pendingStrips = nullptr;
+    pushTaskHandle = nullptr;
+    resetStats();
+    instance = this;
+}
+
+TftCompositor::~TftCompositor() {
+    endCompositing();
+    if (instance == this) {
+        instance = nullptr;
+    }
+}
+
+bool TftCompositor::beginCompositing(bool pipelined) {
+    endCompositing();
+
+    int16_t w = width();
+    int16_t h = height();
+    int needed = (h + BAND_ROWS - 1) / BAND_ROWS;
+    if (needed > MAX_BANDS) {
+        Serial.println("TFT Compositor: Panel too tall, running pass-through");
+        return false;
+    }
+
+    // Everything this needs must fit with MIN_FREE_HEAP to spare - don't take
+    // 150 KB first and find out afterwards
+    size_t bandBytes = (size_t)w * BAND_ROWS * sizeof(uint16_t);
+    uint32_t reserve = MIN_FREE_HEAP + (pipelined ? PIPELINE_BYTES : 0);
+    if (ESP.getFreeHeap() < bandBytes * needed + reserve) {
+        Serial.print("TFT Compositor: Not enough heap for shadow (free ");
+        Serial.print(ESP.getFreeHeap());
+        Serial.println(" bytes), running pass-through");
+        return false;
+    }
+
+    // Shadow starts black - make the panel match it (still pass-through here,
+    // base primitives call the virtual startWrite())
+    Adafruit_ST7789::fillRect(0, 0, w, h, 0x0000);
+
+    for (int i = 0; i < needed; i++) {
+        bands[i] = (uint16_t*)malloc(bandBytes);
+        if (bands[i] == nullptr) {
+            break;
+        }
+        bandCount++;
+    }
+    if (bandCount < needed || ESP.getFreeHeap() < reserve) {
+        Serial.print("TFT Compositor: Not enough heap for shadow (free ");
+        Serial.print(ESP.getFreeHeap());
+        Serial.println(" bytes), running pass-through");
+        endCompositing();
+        return false;
+    }
+
+    shadowWidth = w;
+    shadowHeight = h;
+    for (int i = 0; i < bandCount; i++) {
+        memset(bands[i], 0, bandBytes);
+    }
+    Serial.print("TFT Compositor: Shadow ");
+    Serial.print(w);
+    Serial.print("x");
+    Serial.print(h);
+    Serial.print(" in ");
+    Serial.print(bandCount);
+    Serial.print(" bands, free heap ");
+    Serial.println(ESP.getFreeHeap());
+
+    if (pipelined) {
+        enablePipelinedFlush();  // Stays blocking on failure, the shadow is still worth it
+    }
+    return true;
+}
+
+void TftCompositor::endCompositing() {
+    if (bandCount > 0 && dirtyCount > 0) {
+        flush();
+    }
+    for (int i = 0; i < MAX_BANDS; i++) {
+        free(bands[i]);
+        bands[i] = nullptr;
+    }
+    bandCount = 0;
+    shadowWidth = 0;
+    shadowHeight = 0;
+    dirtyCount = 0;
+    // Direct drawing resumes from this task - the push task must be done with SPI
+    waitIdle();
+}
+
+void TftCompositor::resetStats() {
+    memset(&current, 0, sizeof(current));
+    memset(&lastFrame, 0, sizeof(lastFrame));
+    memset(&total, 0, sizeof(total));
+}
+
+void TftCompositor::beginFrame(const char* label) {
+    if (frameDepth == 0) {
+        frameLabel = label;
+    }
+    frameDepth++;
+}
+
+void TftCompositor::endFrame() {
+    if (frameDepth == 0) {
+        return;
+    }
+    frameDepth--;
+    if (frameDepth == 0) {
+        flush();
+        frameLabel = nullptr;
+    }
+}
+
+TftCompositor::Rect TftCompositor::unite(const Rect& a, const Rect& b) {
+    Rect r;
+    r.x0 = a.x0 < b.x0 ? a.x0 : b.x0;
+    r.y0 = a.y0 < b.y0 ? a.y0 : b.y0;
+    r.x1 = a.x1 > b.x1 ? a.x1 : b.x1;
+    r.y1 = a.y1 > b.y1 ? a.y1 : b.y1;
+    return r;
+}
+
+void TftCompositor::addDamage(Rect r) {
+    // Absorb every rect that is cheaper to push together with r
+    bool merged = true;
+    while (merged) {
+        merged = false;
+        for (int i = 0; i < dirtyCount; i++) {
+            Rect u = unite(dirty[i], r);
+            if (area(u) <= area(dirty[i]) + area(r) + MERGE_SLACK_PIXELS) {
+                r = u;
+                dirty[i] = dirty[--dirtyCount];
+                merged = true;
+                break;
+            }
+        }
+    }
+
+    if (dirtyCount < MAX_DIRTY_RECTS) {
+        dirty[dirtyCount++] = r;
+        return;
+    }
+
+    // List full: grow the rect that gets the least bigger
+    int best = 0;
+    int32_t bestGrowth = INT32_MAX;
+    for (int i = 0; i < dirtyCount; i++) {
+        int32_t growth = area(unite(dirty[i], r)) - area(dirty[i]);
+        if (growth < bestGrowth) {
+            bestGrowth = growth;
+            best = i;
+        }
+    }
+    dirty[best] = unite(dirty[best], r);
+}
+
+void TftCompositor::fillShadow(int16_t x, int16_t y, int16_t w, int16_t h, uint16_t color) {
+    if (w < 0) {
+        x += w + 1;
+        w = -w;
+    }
+    if (h < 0) {
+        y += h + 1;
+        h = -h;
+    }
+    // Clip to panel
+    int16_t x0 = x < 0 ? 0 : x;
+    int16_t y0 = y < 0 ? 0 : y;
+    int16_t x1 = (x + w - 1 >= shadowWidth) ? shadowWidth - 1 : x + w - 1;
+    int16_t y1 = (y + h - 1 >= shadowHeight) ? shadowHeight - 1 : y + h - 1;
+    if (x0 > x1 || y0 > y1) {
+        return;
+    }
+
+    current.pixelsDrawn += (uint32_t)(x1 - x0 + 1) * (y1 - y0 + 1);
+
+    // Store and track the bounding box of pixels that really changed
+    Rect changed = { shadowWidth, shadowHeight, -1, -1 };
+    for (int16_t py = y0; py <= y1; py++) {
+        uint16_t* p = row(py);
+        int16_t first = -1;
+        int16_t last = -1;
+        for (int16_t px = x0; px <= x1; px++) {
+            if (p[px] != color) {
+                p[px] = color;
+                current.pixelsChanged++;
+                if (first < 0) first = px;
+                last = px;
+            }
+        }
+        if (first >= 0) {
+            if (first < changed.x0) changed.x0 = first;
+            if (last > changed.x1) changed.x1 = last;
+            if (py < changed.y0) changed.y0 = py;
+            changed.y1 = py;
+        }
+    }
+    if (changed.x1 >= 0) {
+        addDamage(changed);
+    }
+}
+
+void TftCompositor::pushTile(int16_t x, int16_t y, int16_t w, int16_t h, const uint16_t* pixels) {
+    if (x < 0 || y < 0 || w <= 0 || h <= 0 || x + w > width() || y + h > height()) {
+        return;
+    }
+    if (bandCount == 0) {
+        Adafruit_ST7789::startWrite();
+        setAddrWindow(x, y, w, h);
+        writePixels((uint16_t*)pixels, (uint32_t)w * h, true, false);
+        Adafruit_ST7789::endWrite();
+        return;
+    }
+
+    beginFrame();
+    current.pixelsDrawn += (uint32_t)w * h;
+    Rect changed = { shadowWidth, shadowHeight, -1, -1 };
+    for (int16_t j = 0; j < h; j++) {
+        uint16_t* p = row(y + j) + x;
+        const uint16_t* src = pixels + (int32_t)j * w;
+        int16_t first = -1;
+        int16_t last = -1;
+        for (int16_t i = 0; i < w; i++) {
+            if (p[i] != src[i]) {
+                p[i] = src[i];
+                current.pixelsChanged++;
+                if (first < 0) first = i;
+                last = i;
+            }
+        }
+        if (first >= 0) {
+            if (x + first < changed.x0) changed.x0 = x + first;
+            if (x + last > changed.x1) changed.x1 = x + last;
+            if (y + j < changed.y0) changed.y0 = y + j;
+            changed.y1 = y + j;
+        }
+    }
+    if (changed.x1 >= 0) {
+        addDamage(changed);
+    }
+    endFrame();
+}
+
+void TftCompositor::pushRect(const Rect& r) {
+    uint16_t w = r.x1 - r.x0 + 1;
+    uint16_t h = r.y1 - r.y0 + 1;
+    setAddrWindow(r.x0, r.y0, w, h);
+    for (int16_t y = r.y0; y <= r.y1; y++) {
+        writePixels(row(y) + r.x0, w, true, false);
+    }
+    current.pixelsPushed += (uint32_t)w * h;
+    current.rectsPushed++;
+}
+
+void TftCompositor::queueRect(const Rect& r) {
+    uint16_t w = r.x1 - r.x0 + 1;
+    // Narrow rects pack more rows into one strip
+    int16_t rowsPerStrip = (int16_t)(STRIP_PIXELS / w);
+    for (int16_t y = r.y0; y <= r.y1; y += rowsPerStrip) {
+        uint16_t h = (r.y1 - y + 1 < rowsPerStrip) ? (r.y1 - y + 1) : rowsPerStrip;
+
+        // Waits only if both strips are still being shipped
+        StripJob job;
+        xQueueReceive(freeStrips, &job.pixels, portMAX_DELAY);
+        for (uint16_t i = 0; i < h; i++) {
+            memcpy(job.pixels + i * w, row(y + i) + r.x0, w * sizeof(uint16_t));
+        }
+        job.x = r.x0;
+        job.y = y;
+        job.w = w;
+        job.h = h;
+        xQueueSend(pendingStrips, &job, portMAX_DELAY);
+
+        current.pixelsPushed += (uint32_t)w * h;
+        current.rectsPushed++;
+    }
+}
+
+void TftCompositor::flush() {
+    unsigned long flushStart = micros();
+    if (dirtyCount > 0) {
+        if (pushTaskHandle != nullptr) {
+            for (int i = 0; i < dirtyCount; i++) {
+                queueRect(dirty[i]);
+            }
+        } else {
+            Adafruit_ST7789::startWrite();
+            for (int i = 0; i < dirtyCount; i++) {
+                pushRect(dirty[i]);
+            }
+            Adafruit_ST7789::endWrite();
+        }
+        dirtyCount = 0;
+        current.frames = 1;
+    }
+    current.flushMicros += micros() - flushStart;
+    if (current.pixelsDrawn == 0) {
+        return;
+    }
+
+    lastFrame = current;
+    total.frames += current.frames;
+    total.pixelsDrawn += current.pixelsDrawn;
+    total.pixelsChanged += current.pixelsChanged;
+    total.pixelsPushed += current.pixelsPushed;
+    total.rectsPushed += current.rectsPushed;
+    total.flushMicros += current.flushMicros;
+
+    if (logStats && frameLabel != nullptr) {
+        Serial.print("TFT Compositor: ");
+        Serial.print(frameLabel);
+        Serial.print(" drawn=");
+        Serial.print(current.pixelsDrawn);
+        Serial.print(" changed=");
+        Serial.print(current.pixelsChanged);
+        Serial.print(" pushed=");
+        Serial.print(current.pixelsPushed);
+        Serial.print(" rects=");
+        Serial.print(current.rectsPushed);
+        Serial.print(" flush_us=");
+        Serial.println(current.flushMicros);
+    }
+    memset(&current, 0, sizeof(current));
+}
+
+bool TftCompositor::enablePipelinedFlush() {
+    if (pushTaskHandle != nullptr) {
+        return true;
+    }
+    if (bandCount == 0) {
+        Serial.println("TFT Compositor: Pipelined flush needs the shadow, staying blocking");
+        return false;
+    }
+
+    // Strips share the heap with Wi-Fi/WebSocket/HTTP: blocking flushes are
+    // slower but cost nothing, so only pipeline with MIN_FREE_HEAP to spare
+    if (ESP.getFreeHeap() < PIPELINE_BYTES + MIN_FREE_HEAP) {
+        Serial.print("TFT Compositor: Not enough heap for strips (free ");
+        Serial.print(ESP.getFreeHeap());
+        Serial.println(" bytes), staying blocking");
+        return false;
+    }
+
+    for (int i = 0; i < STRIP_COUNT; i++) {
+        strips[i] = (uint16_t*)heap_caps_malloc(STRIP_PIXELS * sizeof(uint16_t), MALLOC_CAP_DMA);
+    }
+    freeStrips = xQueueCreate(STRIP_COUNT, sizeof(uint16_t*));
+    pendingStrips = xQueueCreate(STRIP_COUNT, sizeof(StripJob));
+
+    bool ok = freeStrips != nullptr && pendingStrips != nullptr && ESP.getFreeHeap() >= MIN_FREE_HEAP;
+    for (int i = 0; i < STRIP_COUNT; i++) {
+        ok = ok && strips[i] != nullptr;
+    }
+    if (ok) {
+        for (int i = 0; i < STRIP_COUNT; i++) {
+            xQueueSend(freeStrips, &strips[i], 0);
+        }
+        ok = TaskLayout::spawn(TaskLayout::ROLE_TFT_PUSH, pushTask, this, &pushTaskHandle) == pdPASS;
+    }
+
+    if (!ok) {
+        Serial.println("TFT Compositor: Could not start pipelined flush, staying blocking");
+        pushTaskHandle = nullptr;
+        if (freeStrips != nullptr) vQueueDelete(freeStrips);
+        if (pendingStrips != nullptr) vQueueDelete(pendingStrips);
+        freeStrips = nullptr;
+        pendingStrips = nullptr;
+        for (int i = 0; i < STRIP_COUNT; i++) {
+            heap_caps_free(strips[i]);
+            strips[i] = nullptr;
+        }
+        return false;
+    }
+
+    Serial.print("TFT Compositor: Pipelined flush on core ");
+    Serial.println((int)TaskLayout::getSpec(TaskLayout::ROLE_TFT_PUSH).core);
+    return true;
+}
+
+void TftCompositor::waitIdle() {
+    if (pushTaskHandle == nullptr) {
+        return;
+    }
+    // Every strip back in the free queue = nothing left in flight
+    uint16_t* held[STRIP_COUNT];
+    for (int i = 0; i < STRIP_COUNT; i++) {
+        xQueueReceive(freeStrips, &held[i], portMAX_DELAY);
+    }
+    for (int i = 0; i < STRIP_COUNT; i++) {
+        xQueueSend(freeStrips, &held[i], 0);
+    }
+}
+
+void TftCompositor::pushTask(void* parameter) {
+    TftCompositor* compositor = (TftCompositor*)parameter;
+    if (compositor) {
+        compositor->runPushTask();
+    }
+    vTaskDelete(NULL);
+}
+
+void TftCompositor::runPushTask() {
+    StripJob job;
+    while (true) {
+        if (xQueueReceive(pendingStrips, &job, portMAX_DELAY) != pdTRUE) {
+            continue;
+        }
+        {
+            TaskLayout::BusyScope busy;
+            Adafruit_ST7789::startWrite();
+            setAddrWindow(job.x, job.y, job.w, job.h);
+            writePixels(job.pixels, (uint32_t)job.w * job.h, true, false);
+            Adafruit_ST7789::endWrite();
+        }
+        xQueueSend(freeStrips, &job.pixels, portMAX_DELAY);
+    }
+}
+
+// ----- Adafruit_GFX overrides -----
+// Pass straight through when no shadow is allocated.
+
+void TftCompositor::startWrite(void) {
+    if (bandCount == 0) {
+        Adafruit_ST7789::startWrite();
+        return;
+    }
+    beginFrame();
+}
+
+void TftCompositor::endWrite(void) {
+    if (bandCount == 0) {
+        Adafruit_ST7789::endWrite();
+        return;
+    }
+    endFrame();
+}
+
+void TftCompositor::drawPixel(int16_t x, int16_t y, uint16_t color) {
+    if (bandCount == 0) {
+        Adafruit_ST7789::drawPixel(x, y, color);
+        return;
+    }
+    beginFrame();
+    fillShadow(x, y, 1, 1, color);
+    endFrame();
+}
+
+void TftCompositor::writePixel(int16_t x, int16_t y, uint16_t color) {
+    if (bandCount == 0) {
+        Adafruit_ST7789::writePixel(x, y, color);
+        return;
+    }
+    fillShadow(x, y, 1, 1, color);
+}
+
+void TftCompositor::writeFillRect(int16_t x, int16_t y, int16_t w, int16_t h, uint16_t color) {
+    if (bandCount == 0) {
+        Adafruit_ST7789::writeFillRect(x, y, w, h, color);
+        return;
+    }
+    fillShadow(x, y, w, h, color);
+}
+
+void TftCompositor::writeFastHLine(int16_t x, int16_t y, int16_t w, uint16_t color) {
+    if (bandCount == 0) {
+        Adafruit_ST7789::writeFastHLine(x, y, w, color);
+        return;
+    }
+    fillShadow(x, y, w, 1, color);
+}
+
+void TftCompositor::writeFastVLine(int16_t x, int16_t y, int16_t h, uint16_t color) {
+    if (bandCount == 0) {
+        Adafruit_ST7789::writeFastVLine(x, y, h, color);
+        return;
+    }
+    fillShadow(x, y, 1, h, color);
+}
+
+void TftCompositor::fillRect(int16_t x, int16_t y, int16_t w, int16_t h, uint16_t color) {
+    if (bandCount == 0) {
+        Adafruit_ST7789::fillRect(x, y, w, h, color);
+        return;
+    }
+    beginFrame();
+    fillShadow(x, y, w, h, color);
+    endFrame();
+}
+
+void TftCompositor::drawFastHLine(int16_t x, int16_t y, int16_t w, uint16_t color) {
+    if (bandCount == 0) {
+        Adafruit_ST7789::drawFastHLine(x, y, w, color);
+        return;
+    }
+    beginFrame();
+    fillShadow(x, y, w, 1, color);
+    endFrame();
+}
+
+void TftCompositor::drawFastVLine(int16_t x, int16_t y, int16_t h, uint16_t color) {
+    if (bandCount == 0) {
+        Adafruit_ST7789::drawFastVLine(x, y, h, color);
+        return;
+    }
+    beginFrame();
+    fillShadow(x, y, 1, h, color);
+    endFrame();
+}
+
+void TftCompositor::setRotation(uint8_t r) {
+    bool wasCompositing = bandCount > 0;
+    if (wasCompositing) {
+        endCompositing();
+    }
+    Adafruit_ST7789::setRotation(r);
+    if (wasCompositing) {
+        // Shadow layout follows the rotated width/height
+        beginCompositing();
+    }
+}
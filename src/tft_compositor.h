@@ -0,0 +1,169 @@
+#ifndef TFT_COMPOSITOR_H
+#define TFT_COMPOSITOR_H
+
+#include <Arduino.h>
+#include <Adafruit_GFX.h>
+#include <Adafruit_ST7789.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#include <freertos/queue.h>
+
+// Damage-tracking layer between the screens and the ST7789.
+//
+// Drop-in replacement for Adafruit_ST7789: screens keep drawing through an
+// Adafruit_ST7789* and every GFX primitive lands in a RAM shadow of the panel
+// instead of going straight to SPI. Only pixels whose color actually changes
+// are recorded as damage; damage rects are coalesced and pushed with one
+// setAddrWindow burst per rect when the outermost frame ends.
+//
+// Frames nest: each GFX primitive is a frame (startWrite/endWrite), and a
+// screen can wrap a whole redraw in TftCompositor::Frame so a full repaint
+// costs one flush of the changed union.
+//
+// The shadow is allocated in bands (no single 150 KB block). If that fails or
+// would leave too little heap (MIN_FREE_HEAP, plus the strips when pipelined),
+// the compositor stays in pass-through mode and behaves exactly like
+// Adafruit_ST7789. Call it once the network stack is up, so the check sees
+// the heap the shadow really has to share.
+//
+// Optional pipelined flush (enablePipelinedFlush): damaged rows are copied
+// into one of two DMA-capable 320x20 strip buffers and a push task ships them
+// over SPI while the caller composes the next strip, so loop() only waits for
+// SPI when both strips are still in flight.
+//
+// While compositing, only GFX primitives and pushTile() are supported - raw
+// pixel pushes (writePixels, pushColor, drawRGBBitmap) bypass the shadow.
+class TftCompositor : public Adafruit_ST7789 {
+public:
+    static const int BAND_ROWS = 16;
+    static const int MAX_BANDS = 20;                 // 320 rows max
+    static const int MAX_DIRTY_RECTS = 8;
+    static const uint32_t MIN_FREE_HEAP = 96 * 1024; // Keep room for WiFi/WebSocket/HTTP
+    static const int STRIP_COUNT = 2;
+    static const uint32_t STRIP_PIXELS = 320 * 20;   // One strip = 12.8 KB RGB565
+
+    struct Stats {
+        uint32_t frames;         // Flushes that pushed something
+        uint32_t pixelsDrawn;    // Pixels touched by primitives
+        uint32_t pixelsChanged;  // Pixels whose color changed
+        uint32_t pixelsPushed;   // Pixels sent over SPI (union of damage)
+        uint32_t rectsPushed;    // setAddrWindow bursts
+        uint32_t flushMicros;    // Time the caller spent inside flush()
+    };
+
+    // RAII frame: coalesce everything drawn in scope into one flush. Every
+    // screen's draw() opens one on its first line, labelled with the class
+    // name (the label tags the flush in stats logging). Frames opened inside
+    // it (a dialog or keyboard drawn by its screen) only nest, so the whole
+    // redraw still flushes once, when the outermost frame closes. With no
+    // TftCompositor the frame is a no-op.
+    class Frame {
+    public:
+        explicit Frame(const char* label = nullptr) {
+            if (instance != nullptr) instance->beginFrame(label);
+        }
+        ~Frame() {
+            if (instance != nullptr) instance->endFrame();
+        }
+    };
+
+    TftCompositor(SPIClass* spiClass, int8_t cs, int8_t dc, int8_t rst);
+    ~TftCompositor();
+
+    // Allocate the shadow for the current rotation and clear panel + shadow to black.
+    // Call after init()/setRotation(). pipelined: also reserve the strips and
+    // enablePipelinedFlush(). Returns false if running pass-through.
+    bool beginCompositing(bool pipelined = false);
+    void endCompositing();
+    bool isCompositing() const { return bandCount > 0; }
+
+    void beginFrame(const char* label = nullptr);
+    void endFrame();
+    void flush();
+
+    // Copy a w x h block of RGB565 pixels (must lie on the panel): into the
+    // shadow when compositing, else one setAddrWindow burst
+    void pushTile(int16_t x, int16_t y, int16_t w, int16_t h, const uint16_t* pixels);
+
+    // Ship strips from a separate task (needs beginCompositing(); core and
+    // priority from task_layout.h). Returns false if the strips would leave
+    // less than MIN_FREE_HEAP or buffers/task could not be created - flush
+    // stays blocking.
+    bool enablePipelinedFlush();
+    bool isPipelined() const { return pushTaskHandle != nullptr; }
+    // Block until every queued strip has reached the panel
+    void waitIdle();
+
+    // Last flushed frame / running totals
+    const Stats& getLastFrameStats() const { return lastFrame; }
+    const Stats& getTotalStats() const { return total; }
+    void resetStats();
+    // Print "TFT Compositor: <label> drawn=.. changed=.. pushed=.." for each flush
+    void setStatsLogging(bool enabled) { logStats = enabled; }
+
+    static TftCompositor* getInstance() { return instance; }
+
+    // Adafruit_GFX overrides
+    void drawPixel(int16_t x, int16_t y, uint16_t color) override;
+    void startWrite(void) override;
+    void endWrite(void) override;
+    void writePixel(int16_t x, int16_t y, uint16_t color) override;
+    void writeFillRect(int16_t x, int16_t y, int16_t w, int16_t h, uint16_t color) override;
+    void writeFastHLine(int16_t x, int16_t y, int16_t w, uint16_t color) override;
+    void writeFastVLine(int16_t x, int16_t y, int16_t h, uint16_t color) override;
+    void fillRect(int16_t x, int16_t y, int16_t w, int16_t h, uint16_t color) override;
+    void drawFastHLine(int16_t x, int16_t y, int16_t w, uint16_t color) override;
+    void drawFastVLine(int16_t x, int16_t y, int16_t h, uint16_t color) override;
+    void setRotation(uint8_t r) override;
+
+private:
+    struct Rect {
+        int16_t x0, y0, x1, y1;  // Inclusive
+    };
+
+    struct StripJob {
+        uint16_t* pixels;
+        int16_t x;
+        int16_t y;
+        uint16_t w;
+        uint16_t h;
+    };
+
+    static TftCompositor* instance;
+
+    uint16_t* bands[MAX_BANDS];
+    int bandCount;
+    int16_t shadowWidth;
+    int16_t shadowHeight;
+
+    Rect dirty[MAX_DIRTY_RECTS];
+    int dirtyCount;
+    int frameDepth;
+    const char* frameLabel;
+
+    // Pipelined flush
+    uint16_t* strips[STRIP_COUNT];
+    QueueHandle_t freeStrips;     // uint16_t* ready to be filled
+    QueueHandle_t pendingStrips;  // StripJob waiting for SPI
+    TaskHandle_t pushTaskHandle;
+
+    Stats current;
+    Stats lastFrame;
+    Stats total;
+    bool logStats;
+
+    uint16_t* row(int16_t y) const { return bands[y / BAND_ROWS] + (y % BAND_ROWS) * shadowWidth; }
+
+    // Write a solid rect into the shadow and record what changed
+    void fillShadow(int16_t x, int16_t y, int16_t w, int16_t h, uint16_t color);
+    void addDamage(Rect r);
+    static int32_t area(const Rect& r) { return (int32_t)(r.x1 - r.x0 + 1) * (r.y1 - r.y0 + 1); }
+    static Rect unite(const Rect& a, const Rect& b);
+    void pushRect(const Rect& r);
+    void queueRect(const Rect& r);
+
+    static void pushTask(void* parameter);
+    void runPushTask();
+};
+
+#endif
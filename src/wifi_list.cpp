@@ -1,5 +1,7 @@
 #include <Arduino.h>
 #include "wifi_list.h"
+#include "tft_compositor.h"
+#include "profiler.h"
 #include <Adafruit_GFX.h>
 #include <Adafruit_ST7789.h>
 
@@ -270,6 +272,8 @@ void WiFiListScreen::updateItem(uint16_t index) {
 }
 
 void WiFiListScreen::draw() {
+    Profiler::Scope profile("WiFiListScreen.draw");
+    TftCompositor::Frame frame("WiFiListScreen");
     Serial.print("WiFi List: Drawing screen with ");
     Serial.print(networkCount);
     Serial.println(" networks");
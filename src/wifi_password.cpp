@@ -2,6 +2,8 @@
 #include <Adafruit_GFX.h>
 #include <Adafruit_ST7789.h>
 #include "wifi_password.h"
+#include "tft_compositor.h"
+#include "profiler.h"
 
 WiFiPasswordScreen::WiFiPasswordScreen(Adafruit_ST7789* tft, Keyboard* keyboard) {
     this->tft = tft;
@@ -90,6 +92,8 @@ void WiFiPasswordScreen::drawPassword() {
 }
 
 void WiFiPasswordScreen::draw() {
+    Profiler::Scope profile("WiFiPasswordScreen.draw");
+    TftCompositor::Frame frame("WiFiPasswordScreen");
     // Draw background
     tft->fillScreen(bgColor);
     
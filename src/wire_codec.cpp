@@ -0,0 +1,222 @@
+#include "wire_codec.h"
+#include <string.h>
+
+const char* const WireCodec::FORMAT_NAME = "tlv1";
+
+static const char* const TYPE_NAMES[WireCodec::TYPE_COUNT] = {
+    nullptr,
+    "chat_message",
+    "typing_start",
+    "typing_stop",
+    "message_delivered",
+    "message_read",
+    "read_receipt",
+    "user_status_update",
+    "game_event",
+    "game_move",
+    "game_move_ack",
+    "game_resync",
+    "batch",
+    "billiard_shot",
+    "billiard_sync"
+};
+
+static const char* const KEY_NAMES[WireCodec::KEY_COUNT] = {
+    nullptr,
+    "from_user_id",
+    "to_user_id",
+    "user_id",
+    "message",
+    "message_id",
+    "timestamp",
+    "from_nickname",
+    "status",
+    "session_id",
+    "event_type",
+    "game_type",
+    "host_user_id",
+    "host_nickname",
+    "user_nickname",
+    "accepted",
+    "ready",
+    "row",
+    "col",
+    "seq",
+    "game_status",
+    "winner_id",
+    "current_turn",
+    "max_players",
+    "success",
+    "since_seq",
+    "code",
+    "nickname",
+    "tick",
+    "angle",
+    "power",
+    "hash",
+    "snapshot"
+};
+
+const char* WireCodec::typeName(uint8_t type) {
+    return (type > 0 && type < TYPE_COUNT) ? TYPE_NAMES[type] : nullptr;
+}
+
+const char* WireCodec::keyName(uint8_t key) {
+    return (key > 0 && key < KEY_COUNT) ? KEY_NAMES[key] : nullptr;
+}
+
+static bool readVarint(const uint8_t*& p, const uint8_t* end, uint32_t& value) {
+    value = 0;
+    for (int shift = 0; shift < 35; shift += 7) {
+        if (p >= end) return false;
+        uint8_t b = *p++;
+        if (shift == 28 && b > 0x0F) return false;     // Bits past 32: not an int32
+        value |= (uint32_t)(b & 0x7F) << shift;
+        if ((b & 0x80) == 0) return true;
+    }
+    return false;
+}
+
+// Decimal text for a number field (snprintf is several times slower here)
+static size_t formatInt(int32_t value, char* out) {
+    char digits[10];
+    uint32_t magnitude = (value < 0) ? 0u - (uint32_t)value : (uint32_t)value;
+    size_t count = 0;
+    do {
+        digits[count++] = (char)('0' + magnitude % 10);
+        magnitude /= 10;
+    } while (magnitude != 0);
+
+    size_t n = 0;
+    if (value < 0) out[n++] = '-';
+    while (count > 0) out[n++] = digits[--count];
+    return n;
+}
+
+static void setField(JsonField& f, const char* key, const char* value, size_t valueLength, uint8_t type, uint8_t depth) {
+    f.key = key;
+    f.keyLength = (uint16_t)strlen(key);
+    f.value = value;
+    f.valueLength = (uint16_t)valueLength;
+    f.type = type;
+    f.depth = depth;
+    f.escaped = false;
+}
+
+bool WireCodec::decode(const uint8_t* data, size_t length, JsonTokenizer& out, char* scratch, size_t scratchSize) {
+    out.fieldCount = 0;
+    out.typeHash = 0;
+    out.overflowed = false;
+    if (!isWireFrame(data, length)) {
+        return false;
+    }
+    const char* type = typeName(data[1]);
+    if (type == nullptr || data[1] == TYPE_BATCH) {
+        return false;
+    }
+
+    // Same shape as the JSON frame: "type" first, game_event fields nested under "event"
+    setField(out.fields[out.fieldCount++], "type", type, strlen(type), JSON_STRING, 0);
+    uint8_t depth = 0;
+    if (data[1] == TYPE_GAME_EVENT) {
+        setField(out.fields[out.fieldCount++], "event", "{}", 2, JSON_OBJECT, 0);
+        depth = 1;
+    }
+
+    const uint8_t* p = data + 2;
+    const uint8_t* end = data + length;
+    size_t scratchUsed = 0;
+    while (p < end) {
+        uint8_t header = *p++;
+        uint8_t kind = header >> 6;
+        const char* key = keyName(header & 0x3F);
+        if (key == nullptr || out.fieldCount >= JsonTokenizer::MAX_FIELDS) {
+            out.overflowed = (key != nullptr);
+            out.fieldCount = 0;
+            return false;
+        }
+        JsonField& f = out.fields[out.fieldCount];
+
+        if (kind == 0) {
+            uint32_t raw;
+            if (!readVarint(p, end, raw) || scratchSize - scratchUsed < 12) {
+                out.fieldCount = 0;
+                return false;
+            }
+            int32_t value = (int32_t)(raw >> 1) ^ -(int32_t)(raw & 1);
+            char* text = scratch + scratchUsed;
+            size_t n = formatInt(value, text);
+            scratchUsed += n;
+            setField(f, key, text, n, JSON_NUMBER, depth);
+        } else if (kind == 1) {
+            uint32_t n;
+            if (!readVarint(p, end, n) || n > (uint32_t)(end - p)) {
+                out.fieldCount = 0;
+                return false;
+            }
+            setField(f, key, (const char*)p, n, JSON_STRING, depth);
+            p += n;
+        } else {
+            bool value = (kind == 3);
+            setField(f, key, value ? "true" : "false", value ? 4 : 5, JSON_BOOL, depth);
+        }
+        out.fieldCount++;
+    }
+
+    out.typeHash = JsonTokenizer::hashBytes(type, strlen(type));
+    return true;
+}
+
+WireWriter::WireWriter(uint8_t* buffer, size_t capacity, uint8_t type) {
+    this->buffer = buffer;
+    this->capacity = capacity;
+    this->used = 0;
+    this->overflow = false;
+    putByte(WireCodec::MAGIC);
+    putByte(type);
+}
+
+void WireWriter::putByte(uint8_t value) {
+    if (used >= capacity) {
+        overflow = true;
+        return;
+    }
+    buffer[used++] = value;
+}
+
+void WireWriter::putVarint(uint32_t value) {
+    while (value >= 0x80) {
+        putByte((uint8_t)(value | 0x80));
+        value >>= 7;
+    }
+    putByte((uint8_t)value);
+}
+
+void WireWriter::putInt(uint8_t key, int32_t value) {
+    putByte(key);
+    putVarint(((uint32_t)value << 1) ^ (uint32_t)(value >> 31));  // zigzag: small negatives stay short
+}
+
+void WireWriter::putBool(uint8_t key, bool value) {
+    putByte((uint8_t)((value ? 3 : 2) << 6) | key);
+}
+
+void WireWriter::putBytes(const uint8_t* data, size_t length) {
+    if (used + length > capacity) {
+        overflow = true;
+        return;
+    }
+    memcpy(buffer + used, data, length);
+    used += length;
+}
+
+void WireWriter::putString(uint8_t key, const char* value, size_t length) {
+    putByte((uint8_t)(1 << 6) | key);
+    putVarint((uint32_t)length);
+    putBytes((const uint8_t*)value, length);
+}
+
+void WireWriter::putFrame(const uint8_t* frame, size_t length) {
+    putVarint((uint32_t)length);
+    putBytes(frame, length);
+}
@@ -0,0 +1,132 @@
+#ifndef WIRE_CODEC_H
+#define WIRE_CODEC_H
+
+#include <Arduino.h>
+#include "json_tokenizer.h"
+
+// Compact binary framing for WebSocket messages ("tlv1"), negotiated during
+// init: the client sends {"type":"init",...,"wire":"tlv1"}, and only if
+// init_ack echoes "wire":"tlv1" do both sides switch the message types below
+// to binary frames. Everything else (init, ping, notifications, anything the
+// encoder can't represent) stays JSON text. Mirror: server/app/api/wire.py.
+//
+// Frame:  0xB1 | type (u8) | field*
+// Field:  key (u8) = kind << 6 | tag, then
+//           kind 0  int     zigzag varint
+//           kind 1  string  varint length + UTF-8 bytes
+//           kind 2  false   (no payload)
+//           kind 3  true    (no payload)
+//         JSON null is simply left out (readers fall back to their default).
+//
+// game_event frames carry the fields of the nested "event" object directly.
+//
+// batch frames (client -> server only, SocketOutbox) hold whole frames instead
+// of fields: 0xB1 | TYPE_BATCH | (varint length + frame)*. decode() rejects
+// them; the device never receives one.
+//
+// Decoding fills a JsonTokenizer with the same key/value views a JSON frame
+// would produce, so SocketManager's parse* helpers read both formats
+// unchanged. String values point into the frame; numbers are written as
+// text into a caller-owned scratch buffer.
+class WireCodec {
+public:
+    static const uint8_t MAGIC = 0xB1;
+    static const char* const FORMAT_NAME;  // "tlv1"
+
+    enum Type : uint8_t {
+        TYPE_CHAT_MESSAGE = 1,
+        TYPE_TYPING_START,
+        TYPE_TYPING_STOP,
+        TYPE_MESSAGE_DELIVERED,
+        TYPE_MESSAGE_READ,
+        TYPE_READ_RECEIPT,
+        TYPE_USER_STATUS_UPDATE,
+        TYPE_GAME_EVENT,
+        TYPE_GAME_MOVE,
+        TYPE_GAME_MOVE_ACK,
+        TYPE_GAME_RESYNC,
+        TYPE_BATCH,
+        TYPE_BILLIARD_SHOT,
+        TYPE_BILLIARD_SYNC,
+        TYPE_COUNT
+    };
+
+    // Field tags - order is part of the protocol, append only
+    enum Key : uint8_t {
+        KEY_FROM_USER_ID = 1,
+        KEY_TO_USER_ID,
+        KEY_USER_ID,
+        KEY_MESSAGE,
+        KEY_MESSAGE_ID,
+        KEY_TIMESTAMP,
+        KEY_FROM_NICKNAME,
+        KEY_STATUS,
+        KEY_SESSION_ID,
+        KEY_EVENT_TYPE,
+        KEY_GAME_TYPE,
+        KEY_HOST_USER_ID,
+        KEY_HOST_NICKNAME,
+        KEY_USER_NICKNAME,
+        KEY_ACCEPTED,
+        KEY_READY,
+        KEY_ROW,
+        KEY_COL,
+        KEY_SEQ,
+        KEY_GAME_STATUS,
+        KEY_WINNER_ID,
+        KEY_CURRENT_TURN,
+        KEY_MAX_PLAYERS,
+        KEY_SUCCESS,
+        KEY_SINCE_SEQ,
+        KEY_CODE,
+        KEY_NICKNAME,
+        KEY_TICK,
+        KEY_ANGLE,
+        KEY_POWER,
+        KEY_HASH,
+        KEY_SNAPSHOT,
+        KEY_COUNT
+    };
+
+    // Scratch needed to decode any frame (numbers as text, <= 12 chars each)
+    static const size_t SCRATCH_SIZE = JsonTokenizer::MAX_FIELDS * 12;
+
+    static bool isWireFrame(const uint8_t* data, size_t length) {
+        return length >= 2 && data[0] == MAGIC;
+    }
+
+    // Returns false on an unknown type, truncated field or too many fields
+    static bool decode(const uint8_t* data, size_t length, JsonTokenizer& out, char* scratch, size_t scratchSize);
+
+    static const char* typeName(uint8_t type);
+    static const char* keyName(uint8_t key);
+};
+
+// Builds one frame into a caller buffer. Writes past the end are dropped and
+// flagged; check ok() before sending.
+class WireWriter {
+public:
+    WireWriter(uint8_t* buffer, size_t capacity, uint8_t type);
+
+    void putInt(uint8_t key, int32_t value);
+    void putBool(uint8_t key, bool value);
+    void putString(uint8_t key, const char* value, size_t length);
+    void putString(uint8_t key, const String& value) { putString(key, value.c_str(), value.length()); }
+    void putFrame(const uint8_t* frame, size_t length);  // Length-prefixed, for TYPE_BATCH
+
+    bool ok() const { return !overflow; }
+    const uint8_t* data() const { return buffer; }
+    size_t length() const { return used; }
+
+private:
+    uint8_t* buffer;
+    size_t capacity;
+    size_t used;
+    bool overflow;
+
+    void putByte(uint8_t value);
+    void putVarint(uint32_t value);
+    void putBytes(const uint8_t* data, size_t length);
+};
+
+#endif
@@ -0,0 +1,280 @@
+// CaroBitboard vs the CellState[15][20] board it replaced.
+//
+// Plays --games random games (moves mostly next to the mover's own stones,
+// so lines form and most games end in a win) and runs each position through
+// both boards:
+//   - place + win check per move, as CaroGame::placeMove does
+//   - win check alone, every stone of every final position
+//   - findNearestEmpty from the center vs the old auto-play spiral scan
+// and prints checks per second and the memory of each board. Results of the
+// two must be identical; exits non-zero on any mismatch.
+//
+//   pio run -e bitboardbench
+//   .pio/build/bitboardbench/program --games 20000
+#include <Arduino.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <vector>
+#include "caro_bitboard.h"
+
+// Condensed copy of the board CaroGame kept before CaroBitboard
+struct LegacyBoard {
+    CellState board[BOARD_ROWS][BOARD_COLS];
+
+    void clear() {
+        for (int i = 0; i < BOARD_ROWS; i++) {
+            for (int j = 0; j < BOARD_COLS; j++) {
+                board[i][j] = CELL_EMPTY;
+            }
+        }
+    }
+
+    bool place(int row, int col, bool isX) {
+        if (board[row][col] != CELL_EMPTY) return false;
+        board[row][col] = isX ? CELL_X : CELL_O;
+        return true;
+    }
+
+    // checkHorizontal/Vertical/Diagonal/AntiDiagonal folded into one walk
+    int count(int row, int col, int dr, int dc) const {
+        CellState player = board[row][col];
+        int n = 1;
+        for (int r = row - dr, c = col - dc;
+             r >= 0 && r < BOARD_ROWS && c >= 0 && c < BOARD_COLS && board[r][c] == player; r -= dr, c -= dc) {
+            n++;
+        }
+        for (int r = row + dr, c = col + dc;
+             r >= 0 && r < BOARD_ROWS && c >= 0 && c < BOARD_COLS && board[r][c] == player; r += dr, c += dc) {
+            n++;
+        }
+        return n;
+    }
+
+    bool checkWin(int row, int col) const {
+        if (board[row][col] == CELL_EMPTY) return false;
+        return count(row, col, 0, 1) >= WIN_COUNT || count(row, col, 1, 0) >= WIN_COUNT ||
+               count(row, col, 1, 1) >= WIN_COUNT || count(row, col, 1, -1) >= WIN_COUNT;
+    }
+
+    // The auto-play spiral from CaroGameScreen::update
+    bool findNearestEmpty(int& bestRow, int& bestCol) const {
+        int centerRow = 7;
+        int centerCol = 10;
+        for (int radius = 0; radius < 8; radius++) {
+            for (int dr = -radius; dr <= radius; dr++) {
+                for (int dc = -radius; dc <= radius; dc++) {
+                    if (abs(dr) != radius && abs(dc) != radius) continue;
+                    int row = centerRow + dr;
+                    int col = centerCol + dc;
+                    if (row < 0 || row >= 15 || col < 0 || col >= 20) continue;
+                    if (board[row][col] == CELL_EMPTY) {
+                        bestRow = row;
+                        bestCol = col;
+                        return true;
+                    }
+                }
+            }
+        }
+        return false;
+    }
+};
+
+struct Move {
+    uint8_t row;
+    uint8_t col;
+};
+
+static uint32_t rngState = 1;
+
+static uint32_t nextRandom() {
+    rngState ^= rngState << 13;
+    rngState ^= rngState >> 17;
+    rngState ^= rngState << 5;
+    return rngState;
+}
+
+static double nowSeconds() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static bool check(bool condition, const char* what) {
+    printf("  %-60s %s\n", what, condition ? "ok" : "FAILED");
+    return condition;
+}
+
+// Mostly next to one of the mover's stones, else any empty cell
+static Move pickMove(const LegacyBoard& b, const std::vector<Move>& own) {
+    if (!own.empty() && nextRandom() % 10 < 8) {
+        for (int attempt = 0; attempt < 16; attempt++) {
+            const Move& from = own[nextRandom() % own.size()];
+            int r = from.row + (int)(nextRandom() % 3) - 1;
+            int c = from.col + (int)(nextRandom() % 3) - 1;
+            if (r >= 0 && r < BOARD_ROWS && c >= 0 && c < BOARD_COLS && b.board[r][c] == CELL_EMPTY) {
+                Move m = {(uint8_t)r, (uint8_t)c};
+                return m;
+            }
+        }
+    }
+    while (true) {
+        int r = nextRandom() % BOARD_ROWS;
+        int c = nextRandom() % BOARD_COLS;
+        if (b.board[r][c] == CELL_EMPTY) {
+            Move m = {(uint8_t)r, (uint8_t)c};
+            return m;
+        }
+    }
+}
+
+int main(int argc, char** argv) {
+    int games = 20000;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--games") == 0 && i + 1 < argc) {
+            games = atoi(argv[++i]);
+        } else {
+            printf("Usage: %s [--games N]\n", argv[0]);
+            return 2;
+        }
+    }
+    if (games < 1) games = 1;
+
+    // ---- Games (the move lists both boards replay) ----
+    std::vector<std::vector<Move> > played(games);
+    LegacyBoard legacy;
+    long totalMoves = 0;
+    int wins = 0;
+    for (int g = 0; g < games; g++) {
+        legacy.clear();
+        std::vector<Move> mine[2];
+        bool isX = true;
+        for (int n = 0; n < BOARD_ROWS * BOARD_COLS; n++) {
+            Move m = pickMove(legacy, mine[isX ? 0 : 1]);
+            legacy.place(m.row, m.col, isX);
+            played[g].push_back(m);
+            mine[isX ? 0 : 1].push_back(m);
+            if (legacy.checkWin(m.row, m.col)) {
+                wins++;
+                break;
+            }
+            isX = !isX;
+        }
+        totalMoves += played[g].size();
+    }
+
+    // ---- place + win check per move ----
+    CaroBitboard bitboard;
+    volatile long sink = 0;
+    double start = nowSeconds();
+    for (int g = 0; g < games; g++) {
+        legacy.clear();
+        bool isX = true;
+        for (const Move& m : played[g]) {
+            legacy.place(m.row, m.col, isX);
+            sink += legacy.checkWin(m.row, m.col);
+            isX = !isX;
+        }
+    }
+    double legacyPlay = nowSeconds() - start;
+
+    start = nowSeconds();
+    for (int g = 0; g < games; g++) {
+        bitboard.clear();
+        bool isX = true;
+        for (const Move& m : played[g]) {
+            bitboard.place(m.row, m.col, isX);
+            sink += bitboard.isWinningMove(m.row, m.col);
+            isX = !isX;
+        }
+    }
+    double bitboardPlay = nowSeconds() - start;
+
+    // ---- Nearest-empty search after every move: replay with and without
+    // it, the difference is the search ----
+    long searches = totalMoves;
+    double legacySearch = 0, bitboardSearch = 0;
+    for (int pass = 0; pass < 2; pass++) {
+        double legacyTime = nowSeconds();
+        for (int g = 0; g < games; g++) {
+            legacy.clear();
+            bool isX = true;
+            for (const Move& m : played[g]) {
+                legacy.place(m.row, m.col, isX);
+                isX = !isX;
+                int r, c;
+                if (pass == 1) sink += legacy.findNearestEmpty(r, c) ? r * BOARD_COLS + c : -1;
+            }
+        }
+        legacyTime = nowSeconds() - legacyTime;
+        double bitboardTime = nowSeconds();
+        for (int g = 0; g < games; g++) {
+            bitboard.clear();
+            bool isX = true;
+            for (const Move& m : played[g]) {
+                bitboard.place(m.row, m.col, isX);
+                isX = !isX;
+                int r, c;
+                if (pass == 1) {
+                    sink += bitboard.findNearestEmpty(BOARD_ROWS / 2, BOARD_COLS / 2, 7, r, c) ? r * BOARD_COLS + c : -1;
+                }
+            }
+        }
+        bitboardTime = nowSeconds() - bitboardTime;
+        legacySearch += pass == 1 ? legacyTime : -legacyTime;
+        bitboardSearch += pass == 1 ? bitboardTime : -bitboardTime;
+    }
+
+    // ---- Win check alone, every stone of every final position ----
+    long checks = 0, winMismatch = 0, searchMismatch = 0;
+    double legacyCheck = 0, bitboardCheck = 0;
+    for (int g = 0; g < games; g++) {
+        legacy.clear();
+        bitboard.clear();
+        bool isX = true;
+        for (const Move& m : played[g]) {
+            legacy.place(m.row, m.col, isX);
+            bitboard.place(m.row, m.col, isX);
+            isX = !isX;
+            int lr = -1, lc = -1, br = -1, bc = -1;
+            bool lf = legacy.findNearestEmpty(lr, lc);
+            bool bf = bitboard.findNearestEmpty(BOARD_ROWS / 2, BOARD_COLS / 2, 7, br, bc);
+            if (lf != bf || (lf && (lr != br || lc != bc))) searchMismatch++;
+        }
+
+        // Timer resolution: one timing around all stones of the position
+        double t0 = nowSeconds();
+        for (const Move& m : played[g]) sink += legacy.checkWin(m.row, m.col);
+        double t1 = nowSeconds();
+        for (const Move& m : played[g]) sink += bitboard.isWinningMove(m.row, m.col);
+        double t2 = nowSeconds();
+        legacyCheck += t1 - t0;
+        bitboardCheck += t2 - t1;
+        for (const Move& m : played[g]) {
+            if (legacy.checkWin(m.row, m.col) != bitboard.isWinningMove(m.row, m.col)) winMismatch++;
+            checks++;
+        }
+    }
+
+    printf("%d games, %ld moves (%.1f per game), %d won\n\n", games, totalMoves, (double)totalMoves / games, wins);
+    printf("%-32s %14s %14s %8s\n", "", "CellState[][]", "CaroBitboard", "ratio");
+    printf("%-32s %10.2f M/s %10.2f M/s %7.1fx\n", "place + win check", totalMoves / legacyPlay / 1e6,
+           totalMoves / bitboardPlay / 1e6, legacyPlay / bitboardPlay);
+    printf("%-32s %10.2f M/s %10.2f M/s %7.1fx\n", "win check alone", checks / legacyCheck / 1e6,
+           checks / bitboardCheck / 1e6, legacyCheck / bitboardCheck);
+    printf("%-32s %10.0f ns   %10.0f ns   %7.1fx\n", "findNearestEmpty from center", legacySearch * 1e9 / searches,
+           bitboardSearch * 1e9 / searches, legacySearch / bitboardSearch);
+    printf("%-32s %10u B   %10u B   %7.2fx\n", "board memory", (unsigned)sizeof(legacy.board),
+           (unsigned)sizeof(CaroBitboard), (double)sizeof(legacy.board) / sizeof(CaroBitboard));
+    printf("(sink %ld)\n", (long)sink);
+
+    printf("\nChecks:\n");
+    bool ok = true;
+    char label[96];
+    snprintf(label, sizeof(label), "win check agrees on %ld stones", checks);
+    ok &= check(winMismatch == 0, label);
+    snprintf(label, sizeof(label), "nearest empty cell agrees on %ld positions", searches);
+    ok &= check(searchMismatch == 0, label);
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,367 @@
+// Caro replay runner: plays CaroRecorder recordings back through CaroReplay
+// into a headless CaroGame and reports the time per move.
+//
+// Without --file it records --games sessions first, the way CaroGameScreen
+// does (BOARD + SYNC at the start, LOCAL_MOVE + SUBMIT_RESULT for our moves,
+// REMOTE_MOVE for the opponent's, a BOARD resync now and then), on the
+// directory-backed SPIFFS from hal/native, then for each one:
+//   - replays it with setSpeed(0) and times every step(): applying the move
+//     (placeMove + win check, CaroReplay::Stats) and reading the next record
+//   - checks the replayed board, game state, winner and turn against the
+//     game that was recorded
+//   - replays it again at --speed on the simulated clock and checks that it
+//     ends at (recorded duration / speed)
+// With --file it replays a recording pulled off a device (/caro.rec) and
+// prints the same timings. Exits non-zero if a check fails.
+//
+//   pio run -e caroreplay
+//   .pio/build/caroreplay/program --games 200 --speed 4
+//   .pio/build/caroreplay/program --file caro.rec
+#include <Arduino.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <algorithm>
+#include <string>
+#include <vector>
+#include "caro_replay.h"
+#include "hal_native.h"
+
+static const int SESSION_ID = 42;
+static const int HOST_ID = 3;   // Recording device, plays X
+static const int GUEST_ID = 7;
+static const int RESYNC_EVERY = 40;  // Moves between BOARD resyncs
+static const char* RECORDING = "/bench.rec";
+
+static std::string root;
+static unsigned long fakeMillis = 0;
+
+// ---- What hal_native.cpp provides to the app ----
+
+// Simulated clock for record timestamps and replay pacing; micros() is real
+unsigned long millis() {
+    return fakeMillis;
+}
+
+void delay(uint32_t ms) {
+    fakeMillis += ms;
+}
+
+unsigned long micros() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (unsigned long)(ts.tv_sec * 1000000ULL + ts.tv_nsec / 1000);
+}
+
+EspClass ESP;
+
+uint32_t EspClass::getFreeHeap() {
+    return 200 * 1024;
+}
+
+namespace HalNative {
+const char* spiffsRoot() { return root.c_str(); }
+double spiMegahertz() { return 0; }
+void registerPanel(Adafruit_ST7789* panel) { (void)panel; }
+}
+
+// ---- Recording ----
+
+static uint32_t rngState = 1;
+
+static uint32_t nextRandom() {
+    rngState ^= rngState << 13;
+    rngState ^= rngState >> 17;
+    rngState ^= rngState << 5;
+    return rngState;
+}
+
+static double nowSeconds() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+// Mostly next to one of our own stones (lines form, games end in a win),
+// otherwise next to any stone, the center on an empty board
+static bool pickMove(const CaroGame& game, bool isX, int& row, int& col) {
+    CellState own = isX ? CELL_X : CELL_O;
+    bool ownOnly = nextRandom() % 10 < 7;
+    for (int attempt = 0; attempt < 400; attempt++) {
+        int r = nextRandom() % BOARD_ROWS;
+        int c = nextRandom() % BOARD_COLS;
+        if (game.getCell(r, c) == CELL_EMPTY) continue;
+        if (ownOnly && attempt < 200 && game.getCell(r, c) != own) continue;
+        int nr = r + (int)(nextRandom() % 3) - 1;
+        int nc = c + (int)(nextRandom() % 3) - 1;
+        if (nr >= 0 && nr < BOARD_ROWS && nc >= 0 && nc < BOARD_COLS && game.getCell(nr, nc) == CELL_EMPTY) {
+            row = nr;
+            col = nc;
+            return true;
+        }
+    }
+    for (int r = 0; r < BOARD_ROWS; r++) {
+        for (int c = 0; c < BOARD_COLS; c++) {
+            int rr = (r + BOARD_ROWS / 2) % BOARD_ROWS;
+            int cc = (c + BOARD_COLS / 2) % BOARD_COLS;
+            if (game.getCell(rr, cc) == CELL_EMPTY) {
+                row = rr;
+                col = cc;
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
+struct Expected {
+    CaroGame* game;       // The game as played
+    int winnerId;
+    int currentTurn;
+    uint32_t durationMs;  // Timestamp of the last record
+    int moves;
+};
+
+// One session as CaroGameScreen records it
+static void recordSession(Expected& expected) {
+    CaroGame& game = *expected.game;
+    CaroRecorder recorder;
+    fakeMillis += 1000;
+    unsigned long startMs = fakeMillis;
+    recorder.begin(SESSION_ID, HOST_ID);
+    recorder.recordBoard(game);
+    recorder.recordSync(HOST_ID, HOST_ID, GUEST_ID, "in_progress");
+
+    bool hostTurn = true;
+    expected.winnerId = -1;
+    expected.moves = 0;
+    while (game.getGameState() == GAME_PLAYING) {
+        fakeMillis += 300 + nextRandom() % 4700;  // Think time
+        int row, col;
+        if (!pickMove(game, hostTurn, row, col)) break;
+        game.placeMove(row, col, hostTurn);
+        expected.moves++;
+
+        GameState state = game.getGameState();
+        const char* status = state == GAME_PLAYING ? "in_progress" : "completed";
+        if (state == GAME_X_WIN) expected.winnerId = HOST_ID;
+        if (state == GAME_O_WIN) expected.winnerId = GUEST_ID;
+        int nextTurn = hostTurn ? GUEST_ID : HOST_ID;
+        if (hostTurn) {
+            recorder.recordLocalMove(row, col, true);
+            fakeMillis += 80 + nextRandom() % 400;  // HTTP round trip
+            recorder.recordSubmitResult(true, status, expected.winnerId);
+        } else {
+            recorder.recordRemoteMove(row, col, GUEST_ID, status, expected.winnerId, nextTurn);
+        }
+        if (expected.moves % RESYNC_EVERY == 0 && state == GAME_PLAYING) {
+            recorder.recordSync(nextTurn, HOST_ID, GUEST_ID, status);
+            recorder.recordBoard(game);
+        }
+        hostTurn = !hostTurn;
+    }
+    expected.currentTurn = hostTurn ? HOST_ID : GUEST_ID;
+    expected.durationMs = (uint32_t)(fakeMillis - startMs);
+    recorder.end();
+}
+
+// ---- Replay ----
+
+struct Timings {
+    std::vector<double> moveNanos;  // step() that applied a move, incl. reading the next record
+    double maxApplyMicros;
+    double totalApplyMicros;
+    long moves;
+    long records;
+    long bytes;
+};
+
+static bool replayTimed(const char* fileName, Timings& timings, CaroReplay& replay) {
+    if (!replay.open(fileName)) return false;
+    replay.setSpeed(0.0f);
+    while (true) {
+        uint32_t movesBefore = replay.getStats().moves;
+        double start = nowSeconds();
+        bool more = replay.step();
+        double spent = nowSeconds() - start;
+        if (!more) break;
+        if (replay.getStats().moves != movesBefore) {
+            timings.moveNanos.push_back(spent * 1e9);
+        }
+    }
+    const CaroReplay::Stats& stats = replay.getStats();
+    timings.moves += stats.moves;
+    timings.records += stats.records;
+    timings.totalApplyMicros += stats.totalMicros;
+    timings.maxApplyMicros = std::max(timings.maxApplyMicros, (double)stats.maxMicros);
+    File f = SPIFFS.open(fileName, "r");
+    timings.bytes += f.size();
+    f.close();
+    return true;
+}
+
+static double percentile(std::vector<double> values, double p) {
+    if (values.empty()) return 0.0;
+    std::sort(values.begin(), values.end());
+    return values[(size_t)(p * (values.size() - 1) + 0.5)];
+}
+
+static void printTimings(const Timings& timings, int sessions) {
+    double mean = 0;
+    for (double ns : timings.moveNanos) mean += ns;
+    mean = timings.moveNanos.empty() ? 0 : mean / timings.moveNanos.size();
+    printf("%d session(s), %ld records, %ld moves, %.1f KB recorded (%.1f B/move)\n", sessions, timings.records,
+           timings.moves, timings.bytes / 1024.0, timings.moves ? (double)timings.bytes / timings.moves : 0.0);
+    printf("per move, step() incl. next-record read: mean %.0f ns  p50 %.0f  p99 %.0f  max %.0f ns\n", mean,
+           percentile(timings.moveNanos, 0.5), percentile(timings.moveNanos, 0.99),
+           percentile(timings.moveNanos, 1.0));
+    printf("per move, placeMove + win check (CaroReplay::Stats): mean %.2f us  max %.0f us\n",
+           timings.moves ? timings.totalApplyMicros / timings.moves : 0.0, timings.maxApplyMicros);
+}
+
+static bool check(bool condition, const char* what) {
+    printf("  %-60s %s\n", what, condition ? "ok" : "FAILED");
+    return condition;
+}
+
+// CaroRecorder / CaroReplay log every session over Serial (stdout here):
+// muted while the generated sessions run, the report follows
+static int mutedStdout = -1;
+
+static void muteSerial(bool mute) {
+    fflush(stdout);
+    if (mute && mutedStdout < 0) {
+        mutedStdout = dup(STDOUT_FILENO);
+        FILE* devNull = fopen("/dev/null", "w");
+        if (devNull != nullptr) {
+            dup2(fileno(devNull), STDOUT_FILENO);
+            fclose(devNull);
+        }
+    } else if (!mute && mutedStdout >= 0) {
+        dup2(mutedStdout, STDOUT_FILENO);
+        close(mutedStdout);
+        mutedStdout = -1;
+    }
+}
+
+static bool copyIntoSpiffs(const char* source, const char* fileName) {
+    FILE* in = fopen(source, "rb");
+    if (in == nullptr) {
+        perror(source);
+        return false;
+    }
+    File out = SPIFFS.open(fileName, "w");
+    uint8_t buffer[512];
+    size_t got;
+    while ((got = fread(buffer, 1, sizeof(buffer), in)) > 0) {
+        out.write(buffer, got);
+    }
+    out.close();
+    fclose(in);
+    return true;
+}
+
+int main(int argc, char** argv) {
+    int games = 200;
+    float speed = 4.0f;
+    const char* devicePath = nullptr;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--games") == 0 && i + 1 < argc) {
+            games = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--speed") == 0 && i + 1 < argc) {
+            speed = (float)atof(argv[++i]);
+        } else if (strcmp(argv[i], "--file") == 0 && i + 1 < argc) {
+            devicePath = argv[++i];
+        } else {
+            printf("Usage: %s [--games N] [--speed S] [--file RECORDING]\n", argv[0]);
+            return 2;
+        }
+    }
+    if (games < 1) games = 1;
+    if (speed <= 0.0f) speed = 1.0f;
+
+    char dir[] = "/tmp/caroreplay.XXXXXX";
+    if (mkdtemp(dir) == nullptr) {
+        perror("mkdtemp");
+        return 1;
+    }
+    root = dir;
+    CaroGame game(nullptr);  // Headless: the replay never draws
+    CaroReplay replay(&game);
+    Timings timings;
+    timings.maxApplyMicros = 0;
+    timings.totalApplyMicros = 0;
+    timings.moves = timings.records = timings.bytes = 0;
+
+    if (devicePath != nullptr) {
+        bool ok = copyIntoSpiffs(devicePath, RECORDING) && replayTimed(RECORDING, timings, replay);
+        if (ok) {
+            printf("session %d, user %d, host %d, guest %d: status \"%s\", winner %d\n", replay.getSessionId(),
+                   replay.getMyUserId(), replay.getHostUserId(), replay.getGuestUserId(), replay.getGameStatus(),
+                   replay.getWinnerId());
+            printTimings(timings, 1);
+        }
+        replay.close();
+        SPIFFS.format();
+        rmdir(dir);
+        return ok ? 0 : 1;
+    }
+
+    int boardMismatch = 0, stateMismatch = 0, winnerMismatch = 0, turnMismatch = 0, paceMismatch = 0;
+    int wins = 0;
+    muteSerial(true);
+    for (int g = 0; g < games; g++) {
+        CaroGame played(nullptr);
+        Expected expected;
+        expected.game = &played;
+        recordSession(expected);
+        if (expected.winnerId >= 0) wins++;
+
+        if (!replayTimed(CaroRecorder::FILE_NAME, timings, replay)) {
+            muteSerial(false);
+            printf("game %d: recording did not open\n", g);
+            return 1;
+        }
+        bool sameBoard = true;
+        for (int row = 0; row < BOARD_ROWS; row++) {
+            for (int col = 0; col < BOARD_COLS; col++) {
+                if (game.getCell(row, col) != played.getCell(row, col)) sameBoard = false;
+            }
+        }
+        if (!sameBoard) boardMismatch++;
+        if (game.getGameState() != played.getGameState()) stateMismatch++;
+        if (replay.getWinnerId() != expected.winnerId) winnerMismatch++;
+        if (replay.getCurrentTurn() != expected.currentTurn) turnMismatch++;
+
+        // Paced replay on the simulated clock, 5 ms per loop()
+        replay.open(CaroRecorder::FILE_NAME);
+        replay.setSpeed(speed);
+        unsigned long openedAt = fakeMillis;
+        while (replay.update()) {
+            fakeMillis += 5;
+        }
+        unsigned long took = fakeMillis - openedAt;
+        unsigned long due = (unsigned long)(expected.durationMs / speed);
+        if (took + 5 < due || took > due + 10) paceMismatch++;
+        replay.close();
+    }
+    muteSerial(false);
+
+    printf("Replay (%d recorded sessions, %d won, the rest drawn):\n", games, wins);
+    printTimings(timings, games);
+
+    printf("\nChecks:\n");
+    bool ok = true;
+    ok &= check(boardMismatch == 0, "replayed board = recorded game");
+    ok &= check(stateMismatch == 0, "replayed game state = recorded game");
+    ok &= check(winnerMismatch == 0 && turnMismatch == 0, "replayed winner and turn = recorded game");
+    char label[96];
+    snprintf(label, sizeof(label), "--speed %.1f replay ends at duration / speed", speed);
+    ok &= check(paceMismatch == 0, label);
+
+    SPIFFS.format();
+    rmdir(dir);
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,251 @@
+// ChatLog append harness: 10k messages into one conversation on the
+// directory-backed SPIFFS from hal/native, counting what reaches the file
+// system (HalNative::fsStats).
+//
+//   - append: bytes written / file opens / reads per message through
+//     ChatLog::append (record + index entry + the index tail check)
+//   - legacy: the old saveChatMessageToFile (read the whole .txt, write it
+//     back with the new line) for the first --legacy messages - it grows
+//     with the history, so 10k of them would write gigabytes
+//   - checks: every record reads back intact through the index, a legacy
+//     .txt migrates, over-long Vietnamese text is cut on a character
+//     boundary. Exits non-zero if one fails.
+//
+//   pio run -e chatlogbench
+//   .pio/build/chatlogbench/program --messages 10000 --legacy 1000
+#include <Arduino.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <string>
+#include <vector>
+#include "chat_log.h"
+#include "hal_native.h"
+
+static const int USER_ID = 3;
+static const int FRIEND_ID = 7;
+
+static std::string root;
+static unsigned long fakeMillis = 0;
+
+// Simulated clock: timestamps only, nothing here waits
+unsigned long millis() {
+    return fakeMillis;
+}
+
+void delay(uint32_t ms) {
+    fakeMillis += ms;
+}
+
+namespace HalNative {
+const char* spiffsRoot() { return root.c_str(); }
+}
+
+static uint32_t rngState = 1;
+
+static uint32_t nextRandom() {
+    rngState ^= rngState << 13;
+    rngState ^= rngState >> 17;
+    rngState ^= rngState << 5;
+    return rngState;
+}
+
+// Chat-like text: mostly short, some long, about a third Vietnamese words
+static String randomMessage() {
+    static const char* WORDS[] = {
+        "ok", "haha", "lol", "where", "are", "you", "game", "caro", "now", "later", "gg", "nice",
+        "ch\xC3\xA0o", "b\xE1\xBA\xA1n", "\xC4\x91i", "\xC4\x83n", "c\xC6\xA1m", "ch\xC6\xA1i",
+        "kh\xC3\xB4ng", "\xC4\x91\xC6\xB0\xE1\xBB\xA3" "c", "t\xE1\xBB\x91i", "nay"
+    };
+    static const int WORD_COUNT = sizeof(WORDS) / sizeof(WORDS[0]);
+    int words = 1 + (nextRandom() % 6);
+    if (nextRandom() % 10 == 0) {
+        words += 10 + nextRandom() % 25;
+    }
+    String text;
+    for (int i = 0; i < words; i++) {
+        if (i > 0) text += " ";
+        text += WORDS[nextRandom() % WORD_COUNT];
+    }
+    return text;
+}
+
+static double nowSeconds() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static bool check(bool condition, const char* what) {
+    printf("  %-56s %s\n", what, condition ? "ok" : "FAILED");
+    return condition;
+}
+
+// Condensed copy of the pre-ChatLog SocketManager::saveChatMessageToFile
+static void legacySave(const String& fileName, const String& message, bool isFromUser) {
+    String existingContent = "";
+    int existingCount = 0;
+    if (SPIFFS.exists(fileName)) {
+        File readFile = SPIFFS.open(fileName, "r");
+        if (readFile) {
+            existingCount = readFile.readStringUntil('\n').toInt();
+            while (readFile.available()) {
+                String line = readFile.readStringUntil('\n');
+                if (line.length() > 0) {
+                    existingContent += line;
+                    existingContent += "\n";
+                }
+            }
+            readFile.close();
+        }
+    }
+    File file = SPIFFS.open(fileName, "w");
+    if (!file) return;
+    file.println(existingCount + 1);
+    if (existingContent.length() > 0) {
+        file.print(existingContent);
+    }
+    file.print(isFromUser ? "1" : "0");
+    file.print("|");
+    file.print(message);
+    file.print("|");
+    file.println(millis());
+    file.close();
+}
+
+static void printCosts(const char* label, int messages, const HalNative::FsStats& stats, double payload,
+                       double elapsed) {
+    printf("%-8s %6d msgs  %8.1f B written/msg (payload %.1f)  %9.1f B read/msg  "
+           "%4.1f opens  %5.1f reads  %4.1f writes per msg  %6.1f us/msg host\n",
+           label, messages, (double)stats.bytesWritten / messages, payload / messages,
+           (double)stats.bytesRead / messages, (double)stats.opens / messages, (double)stats.reads / messages,
+           (double)stats.writes / messages, elapsed * 1e6 / messages);
+}
+
+int main(int argc, char** argv) {
+    int messages = 10000;
+    int legacyMessages = 1000;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--messages") == 0 && i + 1 < argc) {
+            messages = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--legacy") == 0 && i + 1 < argc) {
+            legacyMessages = atoi(argv[++i]);
+        } else {
+            printf("Usage: %s [--messages N] [--legacy N]\n", argv[0]);
+            return 2;
+        }
+    }
+
+    char dir[] = "/tmp/chatlogbench.XXXXXX";
+    if (mkdtemp(dir) == nullptr) {
+        perror("mkdtemp");
+        return 1;
+    }
+    root = dir;
+    bool ok = true;
+
+    // ---- 10k appends through ChatLog ----
+    std::vector<String> sent;
+    sent.reserve(messages);
+    double payload = 0;
+    HalNative::resetFsStats();
+    double start = nowSeconds();
+    for (int i = 0; i < messages; i++) {
+        String text = randomMessage();
+        fakeMillis += 1000 + nextRandom() % 60000;
+        if (ChatLog::append(USER_ID, FRIEND_ID, text, (i % 3) == 0, (uint32_t)fakeMillis) < 0) {
+            printf("append %d failed\n", i);
+            return 1;
+        }
+        payload += text.length();
+        sent.push_back(text);
+    }
+    double elapsed = nowSeconds() - start;
+    HalNative::FsStats appendStats = HalNative::fsStats();
+
+    // ---- Old text format, rewritten per message ----
+    rngState = 1;
+    fakeMillis = 0;
+    double legacyPayload = 0;
+    String legacyName = "/legacy-bench.txt";
+    HalNative::resetFsStats();
+    start = nowSeconds();
+    for (int i = 0; i < legacyMessages; i++) {
+        String text = randomMessage();
+        fakeMillis += 1000 + nextRandom() % 60000;
+        legacySave(legacyName, text, (i % 3) == 0);
+        legacyPayload += text.length();
+    }
+    double legacyElapsed = nowSeconds() - start;
+    HalNative::FsStats legacyStats = HalNative::fsStats();
+    SPIFFS.remove(legacyName);
+
+    printf("Costs:\n");
+    printCosts("append", messages, appendStats, payload, elapsed);
+    if (legacyMessages > 0) {
+        printCosts("legacy", legacyMessages, legacyStats, legacyPayload, legacyElapsed);
+    }
+    File logFile = SPIFFS.open(ChatLog::getFileName(USER_ID, FRIEND_ID), "r");
+    File indexFile = SPIFFS.open(ChatLog::getIndexFileName(USER_ID, FRIEND_ID), "r");
+    printf("On flash: log %u B + index %u B for %d messages (%.1f B/msg)\n\n",
+           (unsigned)logFile.size(), (unsigned)indexFile.size(), messages,
+           (double)(logFile.size() + indexFile.size()) / messages);
+    logFile.close();
+    indexFile.close();
+
+    // ---- Checks ----
+    printf("Checks:\n");
+    ok &= check(ChatLog::getMessageCount(USER_ID, FRIEND_ID) == messages, "index holds one entry per append");
+    int mismatches = 0;
+    File log = SPIFFS.open(ChatLog::getFileName(USER_ID, FRIEND_ID), "r");
+    std::vector<uint32_t> offsets(messages);
+    int got = ChatLog::getRecordOffsets(USER_ID, FRIEND_ID, 0, messages, offsets.data());
+    for (int i = 0; i < got; i++) {
+        String text;
+        bool isUser;
+        uint32_t timestamp;
+        log.seek(offsets[i]);
+        if (!ChatLog::readRecord(log, text, isUser, timestamp) || text != sent[i] || isUser != ((i % 3) == 0)) {
+            mismatches++;
+        }
+    }
+    log.close();
+    ok &= check(got == messages && mismatches == 0, "every record reads back through the index");
+
+    // Legacy .txt migration (other conversation)
+    File legacy = SPIFFS.open(ChatLog::getLegacyFileName(USER_ID, 9), "w");
+    legacy.println(3);
+    legacy.println("1|hello|1000");
+    legacy.println("0|a|b|2000");
+    legacy.println("1|ch\xC3\xA0o|3000");
+    legacy.close();
+    bool migrated = ChatLog::migrateLegacyFile(USER_ID, 9);
+    ok &= check(migrated && !SPIFFS.exists(ChatLog::getLegacyFileName(USER_ID, 9)) &&
+                ChatLog::getMessageCount(USER_ID, 9) == 3, "legacy .txt migrates to records + index");
+    log = SPIFFS.open(ChatLog::getFileName(USER_ID, 9), "r");
+    String text;
+    bool isUser;
+    uint32_t timestamp;
+    ChatLog::checkHeader(log);
+    ChatLog::readRecord(log, text, isUser, timestamp);
+    ChatLog::readRecord(log, text, isUser, timestamp);
+    ok &= check(text == "a|b" && !isUser && timestamp == 2000, "migrated text keeps '|' and its flags");
+    log.close();
+
+    // 3-byte letters across MAX_TEXT_LENGTH: must end on a whole letter
+    String longText;
+    for (int i = 0; i < 1000; i++) longText += "\xE1\xBA\xA1";  // U+1EA1
+    ChatLog::append(USER_ID, 11, String("x") + longText, true, 1);
+    log = SPIFFS.open(ChatLog::getFileName(USER_ID, 11), "r");
+    ChatLog::checkHeader(log);
+    ChatLog::readRecord(log, text, isUser, timestamp);
+    log.close();
+    bool whole = text.length() > 0 && text.length() <= ChatLog::MAX_TEXT_LENGTH && (text.length() - 1) % 3 == 0;
+    ok &= check(whole, "over-long UTF-8 text is cut on a character boundary");
+
+    SPIFFS.format();
+    rmdir(dir);
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,341 @@
+// Open-chat latency sim for ChatLog histories of 100 / 1k / 5k messages on the
+// directory-backed SPIFFS from hal/native.
+//
+//   - open: the ChatScreen::loadMessagesFromFile path (migrate, syncIndex,
+//     count, one index read, newest record) and one page back of 16
+//     (loadMoreMessages), counted through HalNative::fsStats
+//   - rebuild: the same open with the .idx gone, so syncIndex scans every
+//     record - what each open would cost without the index
+//   - legacy: the old text loader (count line + line-position cache + last line)
+//
+// Flash time is estimated from the counts with a simple SPIFFS cost model
+// (per open, per read/seek call, read throughput); the defaults are rough
+// ESP32 figures, override them with the flags to match a real partition.
+// The host time is printed too but says little about flash.
+//
+//   - checks: torn record text, torn record header, torn file header, index
+//     lagging behind a torn tail and a crash in the middle of cutting one -
+//     the next append must land right after the last good record and every
+//     record must read back. Exits non-zero if one fails.
+//
+//   pio run -e chatopenbench
+//   .pio/build/chatopenbench/program [--open-us 2000] [--call-us 40] [--read-kbps 800]
+#include <Arduino.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <string>
+#include <vector>
+#include "chat_log.h"
+#include "hal_native.h"
+
+static const int USER_ID = 3;
+static const int PAGE = 16;         // ChatScreen::loadMoreMessages batch
+static const int LEGACY_CAP = 50;   // Old MAX_MESSAGES clamp on the count line
+
+static std::string root;
+static unsigned long fakeMillis = 0;
+
+// Simulated clock: timestamps only, nothing here waits
+unsigned long millis() {
+    return fakeMillis;
+}
+
+void delay(uint32_t ms) {
+    fakeMillis += ms;
+}
+
+namespace HalNative {
+const char* spiffsRoot() { return root.c_str(); }
+}
+
+static double openCostUs = 2000;
+static double callCostUs = 40;
+static double readKBps = 800;
+
+static uint32_t rngState = 1;
+
+static uint32_t nextRandom() {
+    rngState ^= rngState << 13;
+    rngState ^= rngState >> 17;
+    rngState ^= rngState << 5;
+    return rngState;
+}
+
+static String randomMessage() {
+    static const char* WORDS[] = {
+        "ok", "haha", "where", "are", "you", "caro", "now", "gg", "nice",
+        "ch\xC3\xA0o", "b\xE1\xBA\xA1n", "\xC4\x91i", "ch\xC6\xA1i", "kh\xC3\xB4ng", "t\xE1\xBB\x91i"
+    };
+    static const int WORD_COUNT = sizeof(WORDS) / sizeof(WORDS[0]);
+    int words = 1 + (nextRandom() % 6);
+    if (nextRandom() % 10 == 0) {
+        words += 10 + nextRandom() % 25;
+    }
+    String text;
+    for (int i = 0; i < words; i++) {
+        if (i > 0) text += " ";
+        text += WORDS[nextRandom() % WORD_COUNT];
+    }
+    return text;
+}
+
+static double nowSeconds() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static bool check(bool condition, const char* what) {
+    printf("  %-60s %s\n", what, condition ? "ok" : "FAILED");
+    return condition;
+}
+
+static std::string hostPath(const String& name) {
+    return root + name.c_str();
+}
+
+static double flashMs(const HalNative::FsStats& stats) {
+    return (stats.opens * openCostUs + (stats.reads + stats.seeks) * callCostUs +
+            stats.bytesRead * 1000.0 / (readKBps * 1024.0) * 1000.0) / 1000.0;
+}
+
+static size_t logSize(int friendId) {
+    File log = SPIFFS.open(ChatLog::getFileName(USER_ID, friendId), "r");
+    size_t size = log.size();
+    log.close();
+    return size;
+}
+
+// Condensed loadMessagesFromFile + prependMessagesFromFile (newest `count` records)
+static int openChat(int friendId, int first, int count) {
+    ChatLog::migrateLegacyFile(USER_ID, friendId);
+    String fileName = ChatLog::getFileName(USER_ID, friendId);
+    if (!SPIFFS.exists(fileName)) {
+        return 0;
+    }
+    ChatLog::syncIndex(USER_ID, friendId);
+    int total = ChatLog::getMessageCount(USER_ID, friendId);
+    if (first < 0) {
+        first = total - count;
+    }
+    File file = SPIFFS.open(fileName, "r");
+    uint32_t offsets[PAGE];
+    int got = ChatLog::getRecordOffsets(USER_ID, friendId, first, count, offsets);
+    char text[ChatLog::MAX_TEXT_LENGTH];
+    int loaded = 0;
+    for (int i = got - 1; i >= 0; i--) {
+        uint16_t length;
+        bool isUser;
+        uint32_t timestamp;
+        if (!file.seek(offsets[i]) || !ChatLog::readRecordHeader(file, length, isUser, timestamp) ||
+            file.read((uint8_t*)text, length) != length) {
+            break;
+        }
+        loaded++;
+    }
+    file.close();
+    return loaded;
+}
+
+// Condensed pre-ChatLog loader: count line, then buildFilePositionCache walks
+// the lines (up to the 50-message clamp) and the last cached one is parsed
+static int openLegacy(const String& fileName) {
+    File file = SPIFFS.open(fileName, "r");
+    int total = file.readStringUntil('\n').toInt();
+    file.close();
+    if (total > LEGACY_CAP) total = LEGACY_CAP;
+
+    file = SPIFFS.open(fileName, "r");
+    std::vector<size_t> positions;
+    file.readStringUntil('\n');
+    size_t pos = file.position();
+    while (file.available() && (int)positions.size() < total) {
+        String line = file.readStringUntil('\n');
+        if (line.length() > 0) positions.push_back(pos);
+        pos = file.position();
+    }
+    file.close();
+
+    file = SPIFFS.open(fileName, "r");
+    int loaded = 0;
+    if (!positions.empty() && file.seek(positions.back())) {
+        String line = file.readStringUntil('\n');
+        loaded = line.indexOf('|') > 0 ? 1 : 0;
+    }
+    file.close();
+    return loaded;
+}
+
+static void report(const char* label, int messages, const HalNative::FsStats& stats, double hostUs) {
+    printf("  %-12s %5d msgs  %3u opens %5u reads %4u seeks %9u B read  -> %8.1f ms flash (model)  %8.1f us host\n",
+           label, messages, stats.opens, stats.reads, stats.seeks, (unsigned)stats.bytesRead, flashMs(stats), hostUs);
+}
+
+static void runHistory(int friendId, int messages) {
+    // Same history in both formats
+    String legacyName = ChatLog::getLegacyFileName(USER_ID, 100 + friendId);
+    File legacy = SPIFFS.open(legacyName, "w");
+    legacy.println(messages);
+    for (int i = 0; i < messages; i++) {
+        String text = randomMessage();
+        fakeMillis += 1000 + nextRandom() % 60000;
+        ChatLog::append(USER_ID, friendId, text, (i % 3) == 0, (uint32_t)fakeMillis);
+        legacy.print((i % 3) == 0 ? "1|" : "0|");
+        legacy.print(text);
+        legacy.print("|");
+        legacy.println(fakeMillis);
+    }
+    legacy.close();
+    String indexName = ChatLog::getIndexFileName(USER_ID, friendId);
+    printf("%d messages (log %u B):\n", messages, (unsigned)logSize(friendId));
+
+    HalNative::resetFsStats();
+    double start = nowSeconds();
+    openChat(friendId, -1, 1);
+    double hostUs = (nowSeconds() - start) * 1e6;
+    report("open", messages, HalNative::fsStats(), hostUs);
+
+    int total = ChatLog::getMessageCount(USER_ID, friendId);
+    HalNative::resetFsStats();
+    start = nowSeconds();
+    openChat(friendId, total - 1 - PAGE, PAGE);
+    hostUs = (nowSeconds() - start) * 1e6;
+    report("page back 16", messages, HalNative::fsStats(), hostUs);
+
+    // Without the sidecar syncIndex has to walk every record
+    SPIFFS.remove(indexName);
+    HalNative::resetFsStats();
+    start = nowSeconds();
+    openChat(friendId, -1, 1);
+    hostUs = (nowSeconds() - start) * 1e6;
+    report("rebuild", messages, HalNative::fsStats(), hostUs);
+
+    HalNative::resetFsStats();
+    start = nowSeconds();
+    openLegacy(legacyName);
+    hostUs = (nowSeconds() - start) * 1e6;
+    report("legacy", messages, HalNative::fsStats(), hostUs);
+    SPIFFS.remove(legacyName);
+}
+
+// Every record readable in order and the count matches the index
+static bool readsBack(int friendId, const std::vector<String>& expected) {
+    if (ChatLog::getMessageCount(USER_ID, friendId) != (int)expected.size()) {
+        return false;
+    }
+    File log = SPIFFS.open(ChatLog::getFileName(USER_ID, friendId), "r");
+    if (!log || !ChatLog::checkHeader(log)) {
+        return false;
+    }
+    for (size_t i = 0; i < expected.size(); i++) {
+        String text;
+        bool isUser;
+        uint32_t timestamp;
+        if (!ChatLog::readRecord(log, text, isUser, timestamp) || text != expected[i]) {
+            log.close();
+            return false;
+        }
+    }
+    bool atEnd = !log.available();
+    log.close();
+    return atEnd;
+}
+
+static void appendAll(int friendId, std::vector<String>& expected, int count) {
+    for (int i = 0; i < count; i++) {
+        String text = randomMessage();
+        ChatLog::append(USER_ID, friendId, text, true, ++fakeMillis);
+        expected.push_back(text);
+    }
+}
+
+static void appendRaw(const String& name, const char* bytes, size_t length) {
+    File file = SPIFFS.open(name, "a");
+    file.write((const uint8_t*)bytes, length);
+    file.close();
+}
+
+int main(int argc, char** argv) {
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--open-us") == 0 && i + 1 < argc) {
+            openCostUs = atof(argv[++i]);
+        } else if (strcmp(argv[i], "--call-us") == 0 && i + 1 < argc) {
+            callCostUs = atof(argv[++i]);
+        } else if (strcmp(argv[i], "--read-kbps") == 0 && i + 1 < argc) {
+            readKBps = atof(argv[++i]);
+        } else {
+            printf("Usage: %s [--open-us US] [--call-us US] [--read-kbps KB/s]\n", argv[0]);
+            return 2;
+        }
+    }
+
+    char dir[] = "/tmp/chatopenbench.XXXXXX";
+    if (mkdtemp(dir) == nullptr) {
+        perror("mkdtemp");
+        return 1;
+    }
+    root = dir;
+    bool ok = true;
+
+    printf("Cost model: %.0f us/open, %.0f us/read or seek call, %.0f KB/s\n", openCostUs, callCostUs, readKBps);
+    runHistory(10, 100);
+    runHistory(11, 1000);
+    runHistory(12, 5000);
+
+    printf("\nChecks:\n");
+    std::vector<String> expected;
+
+    // Reset mid-text: header complete, 5 of the text bytes made it
+    appendAll(20, expected, 20);
+    size_t good = logSize(20);
+    char torn[ChatLog::RECORD_HEADER_SIZE + 5] = {40, 0, 1, 1, 0, 0, 0, 'h', 'e', 'l', 'l', 'o'};
+    appendRaw(ChatLog::getFileName(USER_ID, 20), torn, sizeof(torn));
+    appendAll(20, expected, 1);
+    ok &= check(readsBack(20, expected), "torn record text is cut before the next append");
+    ok &= check(logSize(20) > good && !SPIFFS.exists(ChatLog::getFileName(USER_ID, 20) + ".tmp"),
+                "cut log is swapped in, no copy left behind");
+
+    // Reset inside the record header
+    appendRaw(ChatLog::getFileName(USER_ID, 20), torn, 3);
+    appendAll(20, expected, 2);
+    ok &= check(readsBack(20, expected), "torn record header is cut before the next append");
+
+    // Reset while the file header was written
+    std::vector<String> fresh;
+    appendRaw(ChatLog::getFileName(USER_ID, 21), "CLG", 3);
+    appendAll(21, fresh, 3);
+    ok &= check(readsBack(21, fresh), "torn file header starts the log over");
+
+    // Record landed, its index entry didn't, then a torn record after it
+    String indexName = ChatLog::getIndexFileName(USER_ID, 20);
+    appendAll(20, expected, 1);
+    File index = SPIFFS.open(indexName, "r");
+    size_t indexSize = index.size();
+    index.close();
+    if (truncate(hostPath(indexName).c_str(), indexSize - ChatLog::INDEX_ENTRY_SIZE) != 0) {
+        perror("truncate");
+    }
+    appendRaw(ChatLog::getFileName(USER_ID, 20), torn, sizeof(torn));
+    appendAll(20, expected, 1);
+    ok &= check(readsBack(20, expected), "lagging index + torn tail: index catches up, tail cut");
+
+    // Reset after the copy was written and the old log removed, before the rename
+    String logName = ChatLog::getFileName(USER_ID, 20);
+    if (rename(hostPath(logName).c_str(), hostPath(logName + ".tmp").c_str()) != 0) {
+        perror("rename");
+    }
+    appendAll(20, expected, 1);
+    ok &= check(readsBack(20, expected), "interrupted cut: finished copy is renamed back");
+
+    // Reset while the copy was still being written - the log is intact
+    appendRaw(logName + ".tmp", "CLG1", 4);
+    appendAll(20, expected, 1);
+    ok &= check(readsBack(20, expected) && !SPIFFS.exists(logName + ".tmp"), "interrupted copy: partial copy is dropped");
+
+    SPIFFS.format();
+    rmdir(dir);
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,578 @@
+// Heap fragmentation stress test for the chat message window.
+//
+// The same scripted chat session (new messages arriving, scrolling back 2 at
+// a time through a long history, scrolling forward again) runs against:
+//   legacy - the pre-store ChatScreen: ChatMessage[50] of Strings shifted on
+//            every insert, older pages parsed from "isUser|text|ts" lines
+//            into a ChatMessage[50] temporary (condensed from the old
+//            addMessage / loadMoreMessages / readMessagesFromPosition)
+//   store  - ChatMessageStore plus the ChatScreen window bookkeeping
+//            (prependMessagesFromFile / appendMessagesFromFile)
+// while other heap users (socket/HTTP buffers of 32..1024 B with random
+// lifetimes) allocate and free alongside.
+//
+// Allocations are served from an instrumented first-fit heap the size of
+// the ESP32's free heap after Wi-Fi (8-byte headers, splitting, coalescing),
+// by wrapping malloc/calloc/realloc. At the end it reports allocation count,
+// peak use, free bytes, largest free block and fragmentation
+// (1 - largest free / free). The host String is std::string with a 15-byte
+// small-string buffer; Arduino's String allocates every non-empty value, so
+// the legacy numbers are a lower bound for the device.
+//
+// Also checks the store window: scrolling from the newest message back to
+// the first of a long history and forward again must reach both ends with
+// the loaded slice always matching the history, and a random mix of
+// push/pop at both ends must match a reference deque. Exits non-zero if a
+// check fails.
+//
+//   pio run -e chatstorebench
+//   .pio/build/chatstorebench/program --ops 20000 --history 2000
+#include <Arduino.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <deque>
+#include <string>
+#include <vector>
+#include "chat_message_store.h"
+
+extern "C" void* __libc_malloc(size_t size);
+extern "C" void* __libc_calloc(size_t count, size_t size);
+extern "C" void* __libc_realloc(void* ptr, size_t size);
+extern "C" void __libc_free(void* ptr);
+
+// ---- Instrumented heap ----
+
+static const size_t HEAP_SIZE = 96 * 1024;
+static const size_t HEADER_SIZE = 8;
+static const size_t MIN_BLOCK = 16;
+
+struct BlockHeader {
+    uint32_t size;    // Including the header
+    uint32_t isFree;
+};
+
+alignas(16) static uint8_t heapPool[HEAP_SIZE];
+static bool simulating = false;
+
+struct HeapStats {
+    unsigned long allocations;
+    unsigned long failed;      // Did not fit - served by the host heap instead
+    size_t used;
+    size_t peak;
+};
+static HeapStats heapStats;
+
+static BlockHeader* blockAt(size_t offset) {
+    return (BlockHeader*)(heapPool + offset);
+}
+
+static bool inPool(void* ptr) {
+    return ptr >= (void*)heapPool && ptr < (void*)(heapPool + HEAP_SIZE);
+}
+
+static void heapReset() {
+    BlockHeader* first = blockAt(0);
+    first->size = HEAP_SIZE;
+    first->isFree = 1;
+    memset(&heapStats, 0, sizeof(heapStats));
+}
+
+// Merge the free blocks that follow a free block into it
+static void coalesce(BlockHeader* block) {
+    size_t offset = (uint8_t*)block - heapPool;
+    while (offset + block->size < HEAP_SIZE) {
+        BlockHeader* next = blockAt(offset + block->size);
+        if (!next->isFree) break;
+        block->size += next->size;
+    }
+}
+
+static void* heapAlloc(size_t size) {
+    size_t needed = ((size + 7) & ~(size_t)7) + HEADER_SIZE;
+    if (needed < MIN_BLOCK) needed = MIN_BLOCK;
+    for (size_t offset = 0; offset < HEAP_SIZE; offset += blockAt(offset)->size) {
+        BlockHeader* block = blockAt(offset);
+        if (!block->isFree) continue;
+        coalesce(block);
+        if (block->size < needed) continue;
+        if (block->size - needed >= MIN_BLOCK) {
+            BlockHeader* rest = blockAt(offset + needed);
+            rest->size = block->size - needed;
+            rest->isFree = 1;
+            block->size = needed;
+        }
+        block->isFree = 0;
+        heapStats.allocations++;
+        heapStats.used += block->size;
+        if (heapStats.used > heapStats.peak) heapStats.peak = heapStats.used;
+        return (uint8_t*)block + HEADER_SIZE;
+    }
+    heapStats.failed++;
+    return nullptr;
+}
+
+static void heapFree(void* ptr) {
+    BlockHeader* block = (BlockHeader*)((uint8_t*)ptr - HEADER_SIZE);
+    heapStats.used -= block->size;
+    block->isFree = 1;
+}
+
+static void heapFreeSpace(size_t& freeBytes, size_t& largest) {
+    freeBytes = 0;
+    largest = 0;
+    for (size_t offset = 0; offset < HEAP_SIZE; offset += blockAt(offset)->size) {
+        BlockHeader* block = blockAt(offset);
+        if (!block->isFree) continue;
+        coalesce(block);
+        size_t payload = block->size - HEADER_SIZE;
+        freeBytes += payload;
+        if (payload > largest) largest = payload;
+    }
+}
+
+extern "C" void* malloc(size_t size) {
+    if (simulating) {
+        void* ptr = heapAlloc(size);
+        if (ptr != nullptr) return ptr;
+    }
+    return __libc_malloc(size);
+}
+
+extern "C" void* calloc(size_t count, size_t size) {
+    if (simulating) {
+        void* ptr = heapAlloc(count * size);
+        if (ptr != nullptr) {
+            memset(ptr, 0, count * size);
+            return ptr;
+        }
+    }
+    return __libc_calloc(count, size);
+}
+
+extern "C" void* realloc(void* ptr, size_t size) {
+    if (ptr != nullptr && inPool(ptr)) {
+        BlockHeader* block = (BlockHeader*)((uint8_t*)ptr - HEADER_SIZE);
+        size_t oldSize = block->size - HEADER_SIZE;
+        void* moved = malloc(size);
+        memcpy(moved, ptr, oldSize < size ? oldSize : size);
+        heapFree(ptr);
+        return moved;
+    }
+    if (ptr == nullptr) {
+        return malloc(size);
+    }
+    return __libc_realloc(ptr, size);
+}
+
+extern "C" void free(void* ptr) {
+    if (ptr == nullptr) return;
+    if (inPool(ptr)) {
+        heapFree(ptr);
+    } else {
+        __libc_free(ptr);
+    }
+}
+
+// ---- Session script ----
+
+static uint32_t rngState = 1;
+
+static uint32_t nextRandom() {
+    rngState ^= rngState << 13;
+    rngState ^= rngState >> 17;
+    rngState ^= rngState << 5;
+    return rngState;
+}
+
+// History texts live in one block allocated before the run
+struct HistoryEntry {
+    uint32_t offset;
+    uint16_t length;
+    bool isUser;
+};
+static std::vector<char> historyText;
+static std::vector<HistoryEntry> history;
+
+static void buildHistory(int messages) {
+    static const char* WORDS[] = {
+        "ok", "haha", "where", "are", "you", "caro", "now", "gg", "nice",
+        "ch\xC3\xA0o", "b\xE1\xBA\xA1n", "\xC4\x91i", "ch\xC6\xA1i", "kh\xC3\xB4ng", "t\xE1\xBB\x91i"
+    };
+    static const int WORD_COUNT = sizeof(WORDS) / sizeof(WORDS[0]);
+    history.clear();
+    historyText.clear();
+    for (int i = 0; i < messages; i++) {
+        int words = 1 + (nextRandom() % 6);
+        if (nextRandom() % 10 == 0) {
+            words += 10 + nextRandom() % 60;
+        }
+        HistoryEntry entry;
+        entry.offset = historyText.size();
+        for (int w = 0; w < words; w++) {
+            if (w > 0) historyText.push_back(' ');
+            const char* word = WORDS[nextRandom() % WORD_COUNT];
+            historyText.insert(historyText.end(), word, word + strlen(word));
+        }
+        entry.length = historyText.size() - entry.offset;
+        entry.isUser = (nextRandom() % 2) == 0;
+        history.push_back(entry);
+    }
+}
+
+static const char* historyAt(int index) {
+    return historyText.data() + history[index].offset;
+}
+
+// Other heap users: buffers with random sizes and lifetimes
+static const int BACKGROUND_SLOTS = 24;
+static void* background[BACKGROUND_SLOTS];
+static unsigned long backgroundAllocations = 0;
+
+static void churnBackground() {
+    int slot = nextRandom() % BACKGROUND_SLOTS;
+    if (background[slot] != nullptr) {
+        free(background[slot]);
+        background[slot] = nullptr;
+    }
+    if (nextRandom() % 3 != 0) {
+        background[slot] = malloc(32 + nextRandom() % 993);
+        backgroundAllocations++;
+    }
+}
+
+static void releaseBackground() {
+    for (int i = 0; i < BACKGROUND_SLOTS; i++) {
+        free(background[i]);
+        background[i] = nullptr;
+    }
+}
+
+enum Op { OP_NEW_MESSAGE, OP_SCROLL_UP, OP_SCROLL_DOWN };
+
+static Op nextOp() {
+    uint32_t r = nextRandom() % 10;
+    return r < 4 ? OP_NEW_MESSAGE : (r < 8 ? OP_SCROLL_UP : OP_SCROLL_DOWN);
+}
+
+// ---- Legacy window (condensed from the old ChatScreen) ----
+
+struct ChatMessage {
+    String text;
+    bool isUser;
+    unsigned long timestamp;
+};
+
+struct LegacyWindow {
+    static const int MAX_MESSAGES = 50;
+    ChatMessage messages[MAX_MESSAGES];
+    int messageCount;
+    int fileReadPosition;
+    int total;
+
+    void open(int totalMessages) {
+        messageCount = 0;
+        total = totalMessages;
+        fileReadPosition = total;
+        loadMore(1);
+    }
+
+    void addMessage(int index) {
+        if (messageCount >= MAX_MESSAGES) {
+            for (int i = 0; i < MAX_MESSAGES - 1; i++) {
+                messages[i] = messages[i + 1];
+            }
+            messageCount = MAX_MESSAGES - 1;
+        }
+        messages[messageCount].text = String(historyAt(index), history[index].length);
+        messages[messageCount].isUser = history[index].isUser;
+        messages[messageCount].timestamp = index;
+        messageCount++;
+        total = index + 1;
+    }
+
+    // readMessagesFromPosition: one "isUser|text|timestamp" line per message
+    void readMessages(int startIndex, int count, ChatMessage* output, int& outputCount) {
+        outputCount = 0;
+        for (int i = startIndex; i < startIndex + count; i++) {
+            String line = history[i].isUser ? "1|" : "0|";
+            line += String(historyAt(i), history[i].length);
+            line += "|";
+            line += String(i);
+            int pipe1 = line.indexOf('|');
+            int pipe2 = line.lastIndexOf('|');
+            output[outputCount].isUser = (line.substring(0, pipe1) == "1");
+            output[outputCount].text = line.substring(pipe1 + 1, pipe2);
+            output[outputCount].timestamp = line.substring(pipe2 + 1).toInt();
+            outputCount++;
+        }
+    }
+
+    void loadMore(int count) {
+        if (fileReadPosition <= 0) return;
+        int messagesToLoad = fileReadPosition < count ? fileReadPosition : count;
+        int startIndex = fileReadPosition - messagesToLoad;
+        ChatMessage newMessages[50];
+        int newMessageCount = 0;
+        readMessages(startIndex, messagesToLoad, newMessages, newMessageCount);
+        if (messageCount + newMessageCount > MAX_MESSAGES) {
+            int excess = (messageCount + newMessageCount) - MAX_MESSAGES;
+            for (int i = 0; i < messageCount - excess; i++) {
+                messages[i] = messages[i + excess];
+            }
+            messageCount = messageCount - excess;
+        }
+        for (int i = messageCount - 1; i >= 0; i--) {
+            messages[i + newMessageCount] = messages[i];
+        }
+        for (int i = 0; i < newMessageCount; i++) {
+            messages[i] = newMessages[i];
+        }
+        messageCount += newMessageCount;
+        fileReadPosition = startIndex;
+    }
+
+    // Never evicted the newest end, so scroll-down had nothing to reload
+    void loadNewer(int) {}
+    bool consistent() const { return true; }
+};
+
+// ---- Store window (ChatScreen bookkeeping around ChatMessageStore) ----
+
+struct StoreWindow {
+    ChatMessageStore messages;
+    int fileReadPosition;
+    int fileNewestPosition;
+    int total;
+
+    void open(int totalMessages) {
+        messages.clear();
+        total = totalMessages;
+        fileReadPosition = total;
+        fileNewestPosition = total;
+        loadMore(1);
+    }
+
+    void noteEvicted(int countBefore) {
+        int evicted = countBefore + 1 - messages.count();
+        if (evicted > 0) {
+            fileReadPosition += evicted;
+        }
+    }
+
+    void addMessage(int index) {
+        if (fileNewestPosition < total) {
+            messages.clear();
+            fileReadPosition = total;
+            fileNewestPosition = total;
+        }
+        int countBefore = messages.count();
+        messages.pushNewest(historyAt(index), history[index].length, history[index].isUser, index);
+        noteEvicted(countBefore);
+        total = index + 1;
+        fileNewestPosition = total;
+    }
+
+    // prependMessagesFromFile
+    void loadMore(int count) {
+        int startIndex = fileReadPosition - count;
+        if (startIndex < 0) {
+            startIndex = 0;
+            count = fileReadPosition;
+        }
+        int prepended = 0;
+        for (int i = startIndex + count - 1; i >= startIndex; i--) {
+            char* text = messages.pushOldest(history[i].length, history[i].isUser, i);
+            while (text == nullptr && messages.count() > prepended) {
+                messages.popNewest();
+                fileNewestPosition--;
+                text = messages.pushOldest(history[i].length, history[i].isUser, i);
+            }
+            if (text == nullptr) break;
+            memcpy(text, historyAt(i), history[i].length);
+            prepended++;
+        }
+        fileReadPosition -= prepended;
+    }
+
+    // appendMessagesFromFile
+    void loadNewer(int count) {
+        int appended = 0;
+        for (int i = fileNewestPosition; i < total && appended < count; i++) {
+            int countBefore = messages.count();
+            char* text = messages.pushNewest(history[i].length, history[i].isUser, i);
+            memcpy(text, historyAt(i), history[i].length);
+            noteEvicted(countBefore);
+            appended++;
+        }
+        fileNewestPosition += appended;
+    }
+
+    // Loaded slice == history[fileReadPosition, fileNewestPosition)
+    bool consistent() const {
+        if (messages.count() != fileNewestPosition - fileReadPosition ||
+            messages.bytesUsed() > ChatMessageStore::ARENA_SIZE) {
+            return false;
+        }
+        for (int i = 0; i < messages.count(); i++) {
+            int h = fileReadPosition + i;
+            if (messages.getLength(i) != history[h].length || messages.getTimestamp(i) != (uint32_t)h ||
+                memcmp(messages.getText(i), historyAt(h), history[h].length) != 0) {
+                return false;
+            }
+        }
+        return true;
+    }
+};
+
+static LegacyWindow legacyWindow;
+static StoreWindow storeWindow;
+
+static void report(const char* label, int ops) {
+    size_t freeBytes;
+    size_t largest;
+    heapFreeSpace(freeBytes, largest);
+    unsigned long windowAllocations = heapStats.allocations - backgroundAllocations;
+    printf("%-7s %6d ops  %7lu window allocs (%5.2f/op)  %3lu failed  peak %6u B  free %6u B  largest block %6u B  "
+           "fragmentation %5.1f%%\n",
+           label, ops, windowAllocations, (double)windowAllocations / ops, heapStats.failed,
+           (unsigned)heapStats.peak, (unsigned)freeBytes, (unsigned)largest,
+           freeBytes > 0 ? 100.0 * (1.0 - (double)largest / freeBytes) : 0.0);
+}
+
+static bool check(bool condition, const char* what) {
+    printf("  %-60s %s\n", what, condition ? "ok" : "FAILED");
+    return condition;
+}
+
+// Runs the session; returns false if the store window ever went inconsistent
+template <typename Window>
+static bool runSession(Window& window, int ops, int openAt, uint32_t seed, bool verify) {
+    rngState = seed;
+    window.open(openAt);
+    int next = openAt;
+    bool ok = true;
+    for (int i = 0; i < ops; i++) {
+        churnBackground();
+        switch (nextOp()) {
+            case OP_NEW_MESSAGE:
+                if (next < (int)history.size()) {
+                    window.addMessage(next++);
+                }
+                break;
+            case OP_SCROLL_UP:
+                window.loadMore(2);
+                break;
+            case OP_SCROLL_DOWN:
+                window.loadNewer(2);
+                break;
+        }
+        if (verify) {
+            ok &= window.consistent();
+        }
+    }
+    return ok;
+}
+
+int main(int argc, char** argv) {
+    int ops = 20000;
+    int historySize = 2000;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--ops") == 0 && i + 1 < argc) {
+            ops = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--history") == 0 && i + 1 < argc) {
+            historySize = atoi(argv[++i]);
+        } else {
+            printf("Usage: %s [--ops N] [--history N]\n", argv[0]);
+            return 2;
+        }
+    }
+
+    // Enough history for the scroll-back plus every arriving message
+    buildHistory(historySize + ops);
+    int openAt = historySize;
+    bool ok = true;
+
+    // Each run starts from a fresh heap with only the window itself in it
+    heapReset();
+    backgroundAllocations = 0;
+    simulating = true;
+    runSession(legacyWindow, ops, openAt, 7, false);
+    simulating = false;
+    report("legacy", ops);
+    simulating = true;
+    releaseBackground();
+    for (int i = 0; i < LegacyWindow::MAX_MESSAGES; i++) {
+        legacyWindow.messages[i].text = String();
+    }
+    simulating = false;
+
+    heapReset();
+    backgroundAllocations = 0;
+    simulating = true;
+    bool consistent = runSession(storeWindow, ops, openAt, 7, true);
+    simulating = false;
+    report("store", ops);
+    simulating = true;
+    releaseBackground();
+    simulating = false;
+
+    printf("\nChecks:\n");
+    ok &= check(consistent, "window matches the history after every session step");
+
+    // Scroll from the newest message to the first and back
+    buildHistory(historySize);
+    storeWindow.open(historySize);
+    bool steady = true;
+    int steps = 0;
+    while (storeWindow.fileReadPosition > 0 && steps++ < historySize) {
+        storeWindow.loadMore(2);
+        steady &= storeWindow.consistent();
+    }
+    ok &= check(storeWindow.fileReadPosition == 0, "scrolling up reaches the first message of a long history");
+    ok &= check(storeWindow.fileNewestPosition < historySize, "newest messages were evicted to make room");
+    steps = 0;
+    while (storeWindow.fileNewestPosition < historySize && steps++ < historySize) {
+        storeWindow.loadNewer(2);
+        steady &= storeWindow.consistent();
+    }
+    ok &= check(storeWindow.fileNewestPosition == historySize, "scrolling down reloads up to the newest message");
+    ok &= check(steady, "loaded slice stays contiguous in both directions");
+
+    // Random push/pop at both ends against a reference deque
+    ChatMessageStore store;
+    std::deque<std::string> reference;
+    bool matches = true;
+    rngState = 99;
+    for (int i = 0; i < 200000 && matches; i++) {
+        uint32_t r = nextRandom() % 8;
+        uint16_t length = (nextRandom() % 4 == 0) ? nextRandom() % 600 : nextRandom() % 40;
+        std::string text(length, (char)('a' + i % 26));
+        if (r < 3) {
+            store.pushNewest(text.data(), length, true, i);
+            reference.push_back(text);
+            while ((int)reference.size() > store.count()) reference.pop_front();
+        } else if (r < 5) {
+            char* slot = store.pushOldest(length, false, i);
+            if (slot != nullptr) {
+                memcpy(slot, text.data(), length);
+                reference.push_front(text);
+            }
+        } else if (r < 6 && !reference.empty()) {
+            store.popNewest();
+            reference.pop_back();
+        } else if (r < 7 && !reference.empty()) {
+            store.popOldest();
+            reference.pop_front();
+        }
+        matches = (int)reference.size() == store.count() && store.bytesUsed() <= ChatMessageStore::ARENA_SIZE &&
+                  (store.count() > 0 || store.bytesUsed() == 0);
+        for (int k = 0; k < store.count() && matches; k++) {
+            matches = store.getLength(k) == reference[k].size() &&
+                      memcmp(store.getText(k), reference[k].data(), reference[k].size()) == 0;
+        }
+    }
+    ok &= check(matches, "push/pop at both ends matches a reference deque");
+
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,486 @@
+// Edge replay for the button/encoder input path: pin waveforms go through
+// the real InputCapture interrupt handlers and are decoded the way
+// handleHardwareInputs() does it, on a simulated clock.
+//
+// A recording is a list of pin changes (with contact bounce) plus the key
+// actions they are meant to produce. Without --replay one is generated:
+//   - --steps encoder steps in turns of 1-20, 8-60 ms apart, every
+//     transition bouncing 0-3 times; one bounce in 10 is over before its
+//     interrupt runs, so the handler reads the line already back
+//   - a bouncy press every ~2 s on up/down/select, held 60-800 ms (select
+//     now and then 2.1-3 s), bouncing 0-4 times on both edges
+// loop() comes every 10-15 ms, with a 100-400 ms stall (HTTP wait, full
+// redraw) 3 % of the time. Each loop pass drains the ring into an
+// InputDecoder, polls it and "dispatches" the actions.
+//
+// Checks: every encoder step comes out once, in order; every press (and
+// select release) once, stamped with its first edge; no ring overflow; and
+// each action is dispatched within its bound - the longest loop gap for a
+// step, debounce + bounce time + the longest gap for a button.
+//
+// Then a stress run: turns of up to 2000 steps at 200 us per detent and
+// 3 s stalls overflow the ring on purpose. Steps that don't fit come back as a net count, so only the
+// encoder's final position is checked there; lost presses are reported.
+// Exits non-zero if a check fails.
+//
+// Recording file (--write / --replay), one line each:
+//   <micros> <up|down|select|clk|dt> <level> [late]  pin change; "late": its
+//                                                  interrupt runs after the
+//                                                  next change on that pin
+//   <micros> expect <up|down|select|release|left|right>
+//                                                  action with that first edge
+//
+//   pio run -e edgereplay
+//   .pio/build/edgereplay/program [--steps 20000] [--seed 1] [--write FILE]
+//   .pio/build/edgereplay/program --replay FILE
+#include <Arduino.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+#include <vector>
+#include "input_capture.h"
+
+// ---- What hal_native.cpp provides to the app ----
+
+static uint64_t simMicros = 0;
+
+unsigned long micros() {
+    return (uint32_t)simMicros;   // Wraps after 71 minutes like esp_timer's low word
+}
+
+unsigned long millis() {
+    return (unsigned long)(simMicros / 1000);
+}
+
+void delay(uint32_t ms) {
+    simMicros += (uint64_t)ms * 1000;
+}
+
+static const int PIN_COUNT = 40;
+static uint8_t pinLevel[PIN_COUNT];
+static void (*pinHandler[PIN_COUNT])(void);
+
+void pinMode(uint8_t pin, uint8_t mode) {
+    (void)pin;
+    (void)mode;
+}
+
+int digitalRead(uint8_t pin) {
+    return pin < PIN_COUNT ? pinLevel[pin] : 0;
+}
+
+void attachInterrupt(uint8_t pin, void (*handler)(void), int mode) {
+    (void)mode;  // CHANGE only
+    if (pin < PIN_COUNT) pinHandler[pin] = handler;
+}
+
+// ---- Recording ----
+
+// Buttons idle high (pull-ups), the encoder rests at CLK = DT = 1.
+// DOWN gets its own pin here: on the board it shares GPIO14 with the
+// encoder CLK, which is why the encoder is off in main.cpp.
+enum PinName { P_UP = 0, P_DOWN, P_SELECT, P_CLK, P_DT, P_COUNT };
+static const uint8_t PINS[P_COUNT] = {39, 13, 36, 14, 16};
+static const char* PIN_NAMES[P_COUNT] = {"up", "down", "select", "clk", "dt"};
+static const char* KEY_NAMES[] = {"up", "down", "select", "release", "left", "right"};  // InputDecoder::Key order
+static const uint32_t DEBOUNCE_US = 50000;    // main.cpp DEBOUNCE_DELAY
+static const uint64_t MAX_BOUNCE_US = 6000;   // Generated button bounce: 4 x 2 x 700 us at most
+
+struct Change {
+    uint64_t at;
+    uint8_t pin;      // PinName
+    uint8_t level;
+    bool late;        // Interrupt coalesced with the next change on this pin
+};
+
+struct Expect {
+    uint64_t at;
+    uint8_t key;      // InputDecoder::Key
+};
+
+struct Recording {
+    std::vector<Change> changes;
+    std::vector<Expect> expected;
+};
+
+struct Profile {
+    int steps;
+    int turnMax;                // Steps per turn: 1..turnMax
+    uint64_t stepMinUs;
+    uint64_t stepMaxUs;
+    uint64_t bounceMinUs;       // Encoder bounce spacing
+    uint64_t bounceMaxUs;
+    uint64_t stallMinUs;
+    uint64_t stallMaxUs;
+};
+
+static uint32_t rngState = 1;
+
+static uint32_t nextRandom() {
+    rngState ^= rngState << 13;
+    rngState ^= rngState >> 17;
+    rngState ^= rngState << 5;
+    return rngState;
+}
+
+static uint64_t between(uint64_t low, uint64_t high) {
+    return low + nextRandom() % (high - low + 1);
+}
+
+static bool check(bool condition, const char* what) {
+    printf("  %-60s %s\n", what, condition ? "ok" : "FAILED");
+    return condition;
+}
+
+static void addChange(Recording& r, uint64_t at, int pin, int level, bool late) {
+    Change c = {at, (uint8_t)pin, (uint8_t)level, late};
+    r.changes.push_back(c);
+}
+
+// One line changes, then bounces back and forth
+static uint64_t addBouncy(Recording& r, uint64_t at, int pin, int level, int bounces, uint64_t gapMin, uint64_t gapMax) {
+    addChange(r, at, pin, level, false);
+    for (int b = 0; b < bounces; b++) {
+        at += between(gapMin, gapMax);
+        addChange(r, at, pin, !level, nextRandom() % 10 == 0);
+        at += between(gapMin, gapMax);
+        addChange(r, at, pin, level, false);
+    }
+    return at;
+}
+
+static Recording generate(const Profile& profile) {
+    Recording r;
+
+    // Encoder: (CLK, DT) runs 00 -> 10 -> 11 -> 01 for a right turn, two
+    // transitions per step (QuadratureDecoder::STEPS_PER_DETENT)
+    static const uint8_t GRAY[4] = {0, 2, 3, 1};
+    int position = 2;  // 11
+    uint64_t t = 200000;
+    int made = 0;
+    while (made < profile.steps) {
+        int turn = (int)between(1, profile.turnMax);
+        int direction = nextRandom() % 2 ? 1 : -1;
+        for (int s = 0; s < turn && made < profile.steps; s++, made++) {
+            uint64_t interval = between(profile.stepMinUs, profile.stepMaxUs);
+            for (int half = 0; half < 2; half++) {
+                int from = GRAY[position];
+                position = (position + direction + 4) % 4;
+                int to = GRAY[position];
+                int pin = ((from ^ to) & 2) ? P_CLK : P_DT;
+                int level = (pin == P_CLK) ? (to >> 1) : (to & 1);
+                int bounces = (int)(nextRandom() % 4);
+                uint64_t spare = interval / 2 / 4;   // Bounce stays well inside the half step
+                uint64_t gapMax = std::min(profile.bounceMaxUs, std::max(profile.bounceMinUs, spare / 7));
+                addBouncy(r, t, pin, level, bounces, profile.bounceMinUs, gapMax);
+                if (half == 1) {
+                    Expect e = {t, (uint8_t)(direction > 0 ? InputDecoder::KEY_RIGHT : InputDecoder::KEY_LEFT)};
+                    r.expected.push_back(e);
+                }
+                t += interval / 2;
+            }
+        }
+        t += between(200000, 3000000);
+    }
+    uint64_t end = t;
+
+    // Buttons: one press every ~2 s, a line is free again 80 ms after release
+    uint64_t freeAt[3] = {0, 0, 0};
+    for (uint64_t at = 500000; at < end; at += between(200000, 3800000)) {
+        int line = (int)(nextRandom() % 3);
+        uint64_t start = std::max(at, freeAt[line]);
+        uint64_t hold = (line == P_SELECT && nextRandom() % 10 == 0) ? between(2100000, 3000000) : between(60000, 800000);
+        uint64_t pressEnd = addBouncy(r, start, line, 0, (int)(nextRandom() % 5), 100, 700);
+        uint64_t releaseAt = std::max(start + hold, pressEnd + DEBOUNCE_US + 1000);
+        uint64_t releaseEnd = addBouncy(r, releaseAt, line, 1, (int)(nextRandom() % 5), 100, 700);
+        freeAt[line] = releaseEnd + 80000;
+
+        static const uint8_t PRESS[3] = {InputDecoder::KEY_UP_PRESS, InputDecoder::KEY_DOWN_PRESS,
+                                         InputDecoder::KEY_SELECT_PRESS};
+        Expect press = {start, PRESS[line]};
+        r.expected.push_back(press);
+        if (line == P_SELECT) {
+            Expect release = {releaseAt, (uint8_t)InputDecoder::KEY_SELECT_RELEASE};
+            r.expected.push_back(release);
+        }
+    }
+
+    std::stable_sort(r.changes.begin(), r.changes.end(), [](const Change& a, const Change& b) { return a.at < b.at; });
+    std::stable_sort(r.expected.begin(), r.expected.end(), [](const Expect& a, const Expect& b) { return a.at < b.at; });
+    return r;
+}
+
+static bool writeRecording(const Recording& r, const char* path) {
+    FILE* out = fopen(path, "w");
+    if (out == nullptr) {
+        perror(path);
+        return false;
+    }
+    size_t e = 0;
+    for (size_t i = 0; i <= r.changes.size(); i++) {
+        uint64_t at = i < r.changes.size() ? r.changes[i].at : UINT64_MAX;
+        for (; e < r.expected.size() && r.expected[e].at <= at; e++) {
+            fprintf(out, "%llu expect %s\n", (unsigned long long)r.expected[e].at, KEY_NAMES[r.expected[e].key]);
+        }
+        if (i < r.changes.size()) {
+            const Change& c = r.changes[i];
+            fprintf(out, "%llu %s %d%s\n", (unsigned long long)c.at, PIN_NAMES[c.pin], c.level, c.late ? " late" : "");
+        }
+    }
+    fclose(out);
+    return true;
+}
+
+static int lookup(const char* name, const char* const* names, int count) {
+    for (int i = 0; i < count; i++) {
+        if (strcmp(name, names[i]) == 0) return i;
+    }
+    return -1;
+}
+
+static bool readRecording(Recording& r, const char* path) {
+    FILE* in = fopen(path, "r");
+    if (in == nullptr) {
+        perror(path);
+        return false;
+    }
+    char line[128];
+    int number = 0;
+    while (fgets(line, sizeof(line), in) != nullptr) {
+        number++;
+        if (line[0] == '#' || line[0] == '\n') continue;
+        unsigned long long at;
+        char what[16];
+        char arg[16];
+        char flag[16] = "";
+        int fields = sscanf(line, "%llu %15s %15s %15s", &at, what, arg, flag);
+        int pin = lookup(what, PIN_NAMES, P_COUNT);
+        int key = lookup(arg, KEY_NAMES, 6);
+        if (fields >= 3 && strcmp(what, "expect") == 0 && key >= 0) {
+            Expect e = {at, (uint8_t)key};
+            r.expected.push_back(e);
+        } else if (fields >= 3 && pin >= 0 && (arg[0] == '0' || arg[0] == '1')) {
+            addChange(r, at, pin, arg[0] - '0', fields == 4 && strcmp(flag, "late") == 0);
+        } else {
+            printf("%s:%d: can't parse \"%s\"\n", path, number, line);
+            fclose(in);
+            return false;
+        }
+    }
+    fclose(in);
+    return true;
+}
+
+// ---- Replay ----
+
+struct Result {
+    std::vector<InputDecoder::Action> actions;
+    std::vector<uint32_t> latencies;          // Per action, dispatch - edge
+    uint64_t longestGapUs;
+    int encoderPosition;                       // Net steps dispatched
+    InputCapture::Stats stats;
+    uint32_t droppedActions;
+    double seconds;
+};
+
+// Drain + poll + dispatch, like handleHardwareInputs()
+static void loopPass(InputDecoder& decoder, Result& result) {
+    InputDecoder::Action actions[InputDecoder::MAX_ACTIONS];
+    bool drained;
+    do {
+        drained = InputCapture::drain(decoder);
+        uint32_t now = micros();
+        int count = drained ? decoder.poll(now, actions, InputDecoder::MAX_ACTIONS)
+                            : decoder.take(actions, InputDecoder::MAX_ACTIONS);
+        for (int i = 0; i < count; i++) {
+            InputCapture::noteLatency(now - actions[i].edgeMicros);
+            result.actions.push_back(actions[i]);
+            result.latencies.push_back(now - actions[i].edgeMicros);
+            if (actions[i].key == InputDecoder::KEY_RIGHT) result.encoderPosition++;
+            if (actions[i].key == InputDecoder::KEY_LEFT) result.encoderPosition--;
+        }
+    } while (!drained);
+}
+
+static void replay(const Recording& r, const Profile& profile, Result& result) {
+    for (int p = 0; p < P_COUNT; p++) {
+        pinLevel[PINS[p]] = 1;
+    }
+    simMicros = 0;
+    InputCapture::begin(PINS[P_UP], PINS[P_DOWN], PINS[P_SELECT], PINS[P_CLK], PINS[P_DT]);  // Re-reads the encoder
+    InputDecoder decoder;
+    decoder.configureButton(InputDecoder::LINE_UP, 1, DEBOUNCE_US);
+    decoder.configureButton(InputDecoder::LINE_DOWN, 1, DEBOUNCE_US);
+    decoder.configureButton(InputDecoder::LINE_SELECT, 1, DEBOUNCE_US);
+    result.longestGapUs = 0;
+    result.encoderPosition = 0;
+
+    uint64_t end = r.changes.empty() ? 0 : r.changes.back().at + 1000000;
+    uint64_t loopAt = 0;
+    size_t next = 0;
+    while (loopAt < end) {
+        uint64_t gap = nextRandom() % 100 < 3 ? between(profile.stallMinUs, profile.stallMaxUs) : between(10000, 15000);
+        result.longestGapUs = std::max(result.longestGapUs, gap);
+        loopAt += gap;
+
+        // Interrupts between two loop passes, each at its own time
+        for (; next < r.changes.size() && r.changes[next].at <= loopAt; next++) {
+            const Change& c = r.changes[next];
+            simMicros = c.at;
+            pinLevel[PINS[c.pin]] = c.level;
+            if (!c.late) {
+                pinHandler[PINS[c.pin]]();  // A late one is served by the next change's interrupt
+            }
+        }
+        simMicros = loopAt;
+        loopPass(decoder, result);
+    }
+    result.stats = InputCapture::getStats();
+    result.droppedActions = decoder.getDroppedActions();
+    result.seconds = end / 1e6;
+}
+
+static double percentile(std::vector<uint32_t> values, double fraction) {
+    if (values.empty()) return 0;
+    std::sort(values.begin(), values.end());
+    return values[std::min(values.size() - 1, (size_t)(fraction * (values.size() - 1) + 0.5))] / 1000.0;
+}
+
+static bool isStep(uint8_t key) {
+    return key == InputDecoder::KEY_LEFT || key == InputDecoder::KEY_RIGHT;
+}
+
+static bool evaluate(const Recording& r, const Result& result, bool strict, const char* title) {
+    // Encoder: the dispatched step sequence must be the recorded one
+    std::vector<uint8_t> wantSteps;
+    std::vector<uint8_t> gotSteps;
+    int wantPosition = 0;
+    for (size_t i = 0; i < r.expected.size(); i++) {
+        if (!isStep(r.expected[i].key)) continue;
+        wantSteps.push_back(r.expected[i].key);
+        wantPosition += r.expected[i].key == InputDecoder::KEY_RIGHT ? 1 : -1;
+    }
+    std::vector<uint32_t> stepLatency;
+    std::vector<uint32_t> buttonLatency;
+    for (size_t i = 0; i < result.actions.size(); i++) {
+        if (isStep(result.actions[i].key)) {
+            gotSteps.push_back(result.actions[i].key);
+            stepLatency.push_back(result.latencies[i]);
+        } else {
+            buttonLatency.push_back(result.latencies[i]);
+        }
+    }
+
+    // Buttons: each expected action exactly once, matched on key + first edge
+    long wantButtons = 0;
+    long missing = 0;
+    long extra = 0;
+    std::vector<bool> used(result.actions.size(), false);
+    for (size_t e = 0; e < r.expected.size(); e++) {
+        if (isStep(r.expected[e].key)) continue;
+        wantButtons++;
+        bool found = false;
+        for (size_t i = 0; i < result.actions.size() && !found; i++) {
+            if (!used[i] && result.actions[i].key == r.expected[e].key &&
+                result.actions[i].edgeMicros == (uint32_t)r.expected[e].at) {
+                used[i] = found = true;
+            }
+        }
+        if (!found) missing++;
+    }
+    for (size_t i = 0; i < result.actions.size(); i++) {
+        if (!isStep(result.actions[i].key) && !used[i]) extra++;
+    }
+
+    uint64_t stepBound = result.longestGapUs;
+    uint64_t buttonBound = DEBOUNCE_US + MAX_BOUNCE_US + result.longestGapUs;
+    uint32_t stepWorst = stepLatency.empty() ? 0 : *std::max_element(stepLatency.begin(), stepLatency.end());
+    uint32_t buttonWorst = buttonLatency.empty() ? 0 : *std::max_element(buttonLatency.begin(), buttonLatency.end());
+
+    printf("%zu pin changes over %.0f s, longest loop gap %.0f ms\n", r.changes.size(), result.seconds,
+           result.longestGapUs / 1000.0);
+    printf("Steps    %6zu of %6zu  latency p50 %6.1f ms  p99 %6.1f ms  max %6.1f ms (bound %.0f)\n", gotSteps.size(),
+           wantSteps.size(), percentile(stepLatency, 0.5), percentile(stepLatency, 0.99), stepWorst / 1000.0,
+           stepBound / 1000.0);
+    printf("Buttons  %6ld of %6ld  latency p50 %6.1f ms  p99 %6.1f ms  max %6.1f ms (bound %.0f)\n", wantButtons - missing,
+           wantButtons, percentile(buttonLatency, 0.5), percentile(buttonLatency, 0.99), buttonWorst / 1000.0,
+           buttonBound / 1000.0);
+    printf("Capture: %u edges, %u overflows, backlog max %u, %u invalid transitions, %u decoder drops\n",
+           result.stats.edges, result.stats.overflows, result.stats.maxBacklog, result.stats.invalidTransitions,
+           result.droppedActions);
+
+    printf("\n%s:\n", title);
+    bool ok = true;
+    if (strict) {
+        long lostSteps = (long)wantSteps.size() - (long)gotSteps.size();
+        if (gotSteps != wantSteps) {
+            printf("    %ld step(s) short, sequences differ\n", lostSteps);
+        }
+        ok &= check(gotSteps == wantSteps, "every encoder step once, in order");
+        if (missing + extra > 0) {
+            printf("    %ld missing, %ld extra\n", missing, extra);
+        }
+        ok &= check(missing == 0 && extra == 0, "every press + select release once, with its first edge");
+        ok &= check(result.stats.overflows == 0 && result.droppedActions == 0, "no ring overflow, no decoder drop");
+        ok &= check(stepWorst <= stepBound, "steps dispatched within the longest loop gap");
+        ok &= check(buttonWorst <= buttonBound, "buttons within debounce + bounce + longest gap");
+    } else {
+        printf("    presses lost %ld of %ld (%.2f%%), extra %ld\n", missing, wantButtons,
+               wantButtons ? 100.0 * missing / wantButtons : 0.0, extra);
+        ok &= check(result.encoderPosition == wantPosition, "encoder ends at the recorded position");
+        ok &= check(result.stats.invalidTransitions == 0, "no invalid quadrature transition");
+    }
+    return ok;
+}
+
+int main(int argc, char** argv) {
+    int steps = 20000;
+    const char* writePath = nullptr;
+    const char* replayPath = nullptr;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--steps") == 0 && i + 1 < argc) {
+            steps = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--seed") == 0 && i + 1 < argc) {
+            rngState = (uint32_t)atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--write") == 0 && i + 1 < argc) {
+            writePath = argv[++i];
+        } else if (strcmp(argv[i], "--replay") == 0 && i + 1 < argc) {
+            replayPath = argv[++i];
+        } else {
+            printf("Usage: %s [--steps N] [--seed N] [--write FILE] | --replay FILE\n", argv[0]);
+            return 2;
+        }
+    }
+    if (steps <= 0 || rngState == 0) {
+        printf("Usage: %s [--steps N] [--seed N] [--write FILE] | --replay FILE\n", argv[0]);
+        return 2;
+    }
+
+    const Profile normal = {steps, 20, 8000, 60000, 20, 200, 100000, 400000};
+    const Profile stress = {steps, 2000, 200, 200, 5, 20, 3000000, 3000000};
+    bool ok = true;
+
+    Recording recording;
+    if (replayPath != nullptr) {
+        if (!readRecording(recording, replayPath)) return 2;
+    } else {
+        recording = generate(normal);
+        if (writePath != nullptr && !writeRecording(recording, writePath)) return 1;
+    }
+
+    Result result;
+    printf("Replay (%s):\n", replayPath != nullptr ? replayPath : "generated, loop stalls 100-400 ms");
+    replay(recording, normal, result);
+    ok &= evaluate(recording, result, true, "Checks");
+
+    if (replayPath == nullptr) {
+        // InputCapture's stats are static: this run's are on top of the first
+        printf("\nStress (200 us detents, 3 s loop stalls; overflow expected, capture stats cumulative):\n");
+        Recording fast = generate(stress);
+        Result stressed;
+        replay(fast, stress, stressed);
+        ok &= evaluate(fast, stressed, false, "Checks (stress)");
+    }
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,254 @@
+// Frame time of the billiard table and the keyboard with blocking vs
+// pipelined TftCompositor flushes, on the host panel with a simulated SPI
+// sink: every command and pixel byte costs the time a --spi-mhz bus takes
+// (hal/native Adafruit_ST7789), paid by whichever thread is writing.
+//
+//   direct     - pass-through, every primitive goes straight to the panel
+//   blocking   - compositing, flush() pushes the damage from the caller
+//   pipelined  - compositing + enablePipelinedFlush(): strips are copied and
+//                shipped by the push task, the caller only waits when both
+//                strips are in flight
+//
+// Per mode it prints the caller-side time per step (what loop() stalls for:
+// mean, p99, max) and the wall time until the panel is up to date. On the
+// device the same split is in TftCompositor::getLastFrameStats().flushMicros.
+//
+// Also checks that pipelined flushing leaves the panel identical to blocking
+// and that enablePipelinedFlush() stays blocking when the strips would eat
+// into MIN_FREE_HEAP. Exits non-zero if a check fails.
+//
+//   pio run -e flushbench
+//   .pio/build/flushbench/program [--spi-mhz 27]
+#include <Arduino.h>
+#include <malloc.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <algorithm>
+#include <vector>
+#include "tft_compositor.h"
+#include "keyboard.h"
+#include "keyboard_skins_wrapper.h"
+#include "billiard_game.h"
+#include "socket_manager.h"
+#include "hal_native.h"
+
+// ---- What hal_native.cpp provides to the app ----
+
+static unsigned long fakeMillis = 0;
+static double spiMhz = 27;
+
+// Simulated clock for game timing; micros() is real for the flush timers
+unsigned long millis() {
+    return fakeMillis;
+}
+
+void delay(uint32_t ms) {
+    fakeMillis += ms;
+}
+
+unsigned long micros() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (unsigned long)(ts.tv_sec * 1000000ULL + ts.tv_nsec / 1000);
+}
+
+// Free heap = budget minus what the process allocated since the budget was set
+static uint32_t heapBudget = 400 * 1024;
+static size_t heapBaseline = 0;
+
+static void setHeapBudget(uint32_t bytes) {
+    heapBudget = bytes;
+    heapBaseline = mallinfo2().uordblks;
+}
+
+EspClass ESP;
+
+uint32_t EspClass::getFreeHeap() {
+    size_t used = mallinfo2().uordblks;
+    size_t grown = used > heapBaseline ? used - heapBaseline : 0;
+    return grown < heapBudget ? heapBudget - (uint32_t)grown : 0;
+}
+
+namespace HalNative {
+double spiMegahertz() { return spiMhz; }
+void registerPanel(Adafruit_ST7789* panel) { (void)panel; }
+}
+
+// BilliardGame only talks to the socket when started online
+bool SocketManager::sendBilliardShot(int sessionId, int seq, uint32_t tick, int32_t angle, int power, uint32_t hash) {
+    (void)sessionId; (void)seq; (void)tick; (void)angle; (void)power; (void)hash;
+    return false;
+}
+
+bool SocketManager::sendBilliardSync(int sessionId, int seq, const String& snapshot) {
+    (void)sessionId; (void)seq; (void)snapshot;
+    return false;
+}
+
+// ---- Sessions ----
+
+static TftCompositor tft(&SPI, -1, -1, -1);
+static uint32_t rngState = 1;
+static std::vector<unsigned long> stepMicros;
+
+static uint32_t nextRandom() {
+    rngState ^= rngState << 13;
+    rngState ^= rngState >> 17;
+    rngState ^= rngState << 5;
+    return rngState;
+}
+
+// Time one step on the calling thread
+template <typename Step>
+static void timed(Step step) {
+    unsigned long start = micros();
+    step();
+    stepMicros.push_back(micros() - start);
+}
+
+static void keyboardSession() {
+    Keyboard keyboard(&tft);
+    keyboard.setSkin(KeyboardSkins::getFeminineLilac());
+    timed([&] { keyboard.draw(); });
+    for (int i = 0; i < 40; i++) {
+        uint16_t row = nextRandom() % 4;
+        int8_t col = nextRandom() % 10;
+        timed([&] { keyboard.moveCursorTo(row, col); });
+    }
+}
+
+static void billiardSession() {
+    BilliardGame game(&tft);
+    game.init();
+    timed([&] { game.draw(); });
+    for (int i = 0; i < 30; i++) {
+        timed([&] { game.handleAimRotate(0.05f); });
+    }
+    game.handleChargeStart();
+    for (int i = 0; i < 20; i++) {
+        fakeMillis += 16;
+        timed([&] { game.update(); });
+    }
+    game.handleChargeRelease();
+    for (int i = 0; i < 180; i++) {
+        fakeMillis += 16;
+        timed([&] { game.update(); });
+    }
+}
+
+enum Mode { MODE_DIRECT, MODE_BLOCKING, MODE_PIPELINED };
+static const char* MODE_NAMES[] = {"direct", "blocking", "pipelined"};
+
+static bool runSession(void (*session)(), Mode mode, const char* label, const char* ppmPath) {
+    rngState = 1;
+    fakeMillis = 0;
+    stepMicros.clear();
+    if (mode != MODE_DIRECT) {
+        tft.beginCompositing(mode == MODE_PIPELINED);
+    }
+    tft.fillScreen(0x0000);
+    tft.waitIdle();
+
+    unsigned long start = micros();
+    session();
+    tft.waitIdle();
+    unsigned long wall = micros() - start;
+    bool pipelined = tft.isPipelined();
+
+    std::vector<unsigned long> sorted = stepMicros;
+    std::sort(sorted.begin(), sorted.end());
+    double sum = 0;
+    for (unsigned long us : sorted) sum += us;
+    printf("%-9s %-10s %4d steps  per step: mean %7.0f us  p99 %7lu us  max %7lu us   panel done after %7.1f ms\n",
+           label, MODE_NAMES[mode], (int)sorted.size(), sum / sorted.size(),
+           sorted[(sorted.size() * 99) / 100 < sorted.size() ? (sorted.size() * 99) / 100 : sorted.size() - 1],
+           sorted.back(), wall / 1000.0);
+
+    if (ppmPath != nullptr) {
+        tft.writePpm(ppmPath);
+    }
+    tft.endCompositing();
+    return mode != MODE_PIPELINED || pipelined;
+}
+
+static bool sameFile(const char* a, const char* b) {
+    FILE* fa = fopen(a, "rb");
+    FILE* fb = fopen(b, "rb");
+    bool same = fa != nullptr && fb != nullptr;
+    while (same) {
+        int ca = fgetc(fa);
+        int cb = fgetc(fb);
+        same = (ca == cb);
+        if (ca == EOF || cb == EOF) break;
+    }
+    if (fa) fclose(fa);
+    if (fb) fclose(fb);
+    return same;
+}
+
+static bool check(bool condition, const char* what) {
+    printf("  %-64s %s\n", what, condition ? "ok" : "FAILED");
+    return condition;
+}
+
+int main(int argc, char** argv) {
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--spi-mhz") == 0 && i + 1 < argc) {
+            spiMhz = atof(argv[++i]);
+        } else {
+            printf("Usage: %s [--spi-mhz N]\n", argv[0]);
+            return 2;
+        }
+    }
+
+    tft.init(240, 320);
+    tft.setRotation(3);
+
+    char dir[] = "/tmp/flushbench.XXXXXX";
+    if (mkdtemp(dir) == nullptr) {
+        perror("mkdtemp");
+        return 1;
+    }
+    std::string blockingKeyboard = std::string(dir) + "/keyboard-blocking.ppm";
+    std::string pipelinedKeyboard = std::string(dir) + "/keyboard-pipelined.ppm";
+    std::string blockingTable = std::string(dir) + "/table-blocking.ppm";
+    std::string pipelinedTable = std::string(dir) + "/table-pipelined.ppm";
+
+    // Heap guard first: once the push task runs it stays for the process
+    // lifetime, as on the device
+    printf("Checks:\n");
+    bool ok = true;
+    const uint32_t shadowBytes = 320 * 240 * 2;
+    setHeapBudget(shadowBytes + TftCompositor::MIN_FREE_HEAP + 8 * 1024);
+    tft.beginCompositing();
+    bool pipelined = tft.enablePipelinedFlush();
+    ok &= check(tft.isCompositing() && !pipelined && !tft.isPipelined() &&
+                ESP.getFreeHeap() >= TftCompositor::MIN_FREE_HEAP,
+                "strips over the reserve: stays blocking, nothing taken");
+    tft.endCompositing();
+    setHeapBudget(400 * 1024);
+
+    printf("\nSPI sink: %.0f MHz\n", spiMhz);
+    runSession(keyboardSession, MODE_DIRECT, "keyboard", nullptr);
+    runSession(keyboardSession, MODE_BLOCKING, "keyboard", blockingKeyboard.c_str());
+    runSession(billiardSession, MODE_DIRECT, "table", nullptr);
+    runSession(billiardSession, MODE_BLOCKING, "table", blockingTable.c_str());
+    bool started = runSession(keyboardSession, MODE_PIPELINED, "keyboard", pipelinedKeyboard.c_str());
+    started &= runSession(billiardSession, MODE_PIPELINED, "table", pipelinedTable.c_str());
+
+    printf("\n");
+    ok &= check(started, "pipelined flush starts with enough heap");
+    ok &= check(sameFile(blockingKeyboard.c_str(), pipelinedKeyboard.c_str()),
+                "keyboard: pipelined panel matches blocking");
+    ok &= check(sameFile(blockingTable.c_str(), pipelinedTable.c_str()), "table: pipelined panel matches blocking");
+
+    remove(blockingKeyboard.c_str());
+    remove(pipelinedKeyboard.c_str());
+    remove(blockingTable.c_str());
+    remove(pipelinedTable.c_str());
+    rmdir(dir);
+    return ok ? 0 : 1;
+}
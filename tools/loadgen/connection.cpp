@@ -0,0 +1,452 @@
+#include "connection.h"
+#include "metrics.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <netinet/tcp.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+// ---------------------------------------------------------------- TCP
+
+TcpConnection::TcpConnection(EventLoop& loop, Metrics& metrics) : loop(loop), metrics(metrics) {
+    this->fd = -1;
+    this->connecting = false;
+    this->wantWrite = false;
+}
+
+TcpConnection::~TcpConnection() {
+    if (fd >= 0) {
+        loop.remove(fd);
+        ::close(fd);
+    }
+}
+
+bool TcpConnection::connectTo(const struct sockaddr_in& address) {
+    close();
+    inBuffer.clear();
+    outBuffer.clear();
+    metrics.tcpConnects++;
+
+    fd = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (fd < 0) {
+        metrics.tcpConnectErrors++;
+        return false;
+    }
+    int one = 1;
+    setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));   // As WiFiClient::setNoDelay on the device
+
+    if (connect(fd, (const struct sockaddr*)&address, sizeof(address)) < 0 && errno != EINPROGRESS) {
+        ::close(fd);
+        fd = -1;
+        metrics.tcpConnectErrors++;
+        return false;
+    }
+    connecting = true;
+    wantWrite = true;
+    if (!loop.add(fd, EPOLLIN | EPOLLOUT | EPOLLRDHUP, this)) {
+        ::close(fd);
+        fd = -1;
+        metrics.tcpConnectErrors++;
+        return false;
+    }
+    return true;
+}
+
+void TcpConnection::close() {
+    if (fd < 0) return;
+    loop.remove(fd);
+    ::close(fd);
+    fd = -1;
+    connecting = false;
+    wantWrite = false;
+    outBuffer.clear();
+}
+
+// Closed under us: tell the subclass once
+void TcpConnection::fail() {
+    if (fd < 0) return;
+    if (connecting) metrics.tcpConnectErrors++;
+    close();
+    onClosed();
+}
+
+bool TcpConnection::write(const char* data, size_t length) {
+    if (fd < 0) return false;
+    outBuffer.append(data, length);
+    if (!connecting) flush();
+    return fd >= 0;
+}
+
+void TcpConnection::flush() {
+    while (!outBuffer.empty()) {
+        ssize_t n = send(fd, outBuffer.data(), outBuffer.size(), MSG_NOSIGNAL);
+        if (n > 0) {
+            metrics.bytesOut += (uint64_t)n;
+            outBuffer.erase(0, (size_t)n);
+            continue;
+        }
+        if (n < 0 && errno == EINTR) continue;
+        if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) break;
+        fail();
+        return;
+    }
+    bool need = !outBuffer.empty();
+    if (need != wantWrite) {
+        wantWrite = need;
+        loop.modify(fd, EPOLLIN | EPOLLRDHUP | (need ? (uint32_t)EPOLLOUT : 0u), this);
+    }
+}
+
+void TcpConnection::onReady(uint32_t events) {
+    if (fd < 0) return;     // Closed earlier in the same epoll batch
+
+    if (connecting) {
+        if (events & (EPOLLERR | EPOLLHUP)) {
+            fail();
+            return;
+        }
+        if (!(events & EPOLLOUT)) return;
+        int error = 0;
+        socklen_t length = sizeof(error);
+        if (getsockopt(fd, SOL_SOCKET, SO_ERROR, &error, &length) < 0 || error != 0) {
+            fail();
+            return;
+        }
+        connecting = false;
+        onConnected();
+        if (fd < 0) return;
+        flush();
+        if (fd < 0) return;
+    } else if (events & EPOLLOUT) {
+        flush();
+        if (fd < 0) return;
+    }
+
+    if (events & (EPOLLIN | EPOLLRDHUP | EPOLLHUP | EPOLLERR)) {
+        bool closed = (events & EPOLLERR) != 0;
+        char buffer[16384];
+        while (!closed) {
+            ssize_t n = recv(fd, buffer, sizeof(buffer), 0);
+            if (n > 0) {
+                metrics.bytesIn += (uint64_t)n;
+                inBuffer.append(buffer, (size_t)n);
+                if ((size_t)n < sizeof(buffer)) break;
+            } else if (n == 0) {
+                closed = true;
+            } else if (errno == EINTR) {
+                continue;
+            } else if (errno == EAGAIN || errno == EWOULDBLOCK) {
+                break;
+            } else {
+                closed = true;
+            }
+        }
+        // Whatever arrived before the FIN is still handed over
+        if (!inBuffer.empty()) {
+            onData();
+            if (fd < 0) return;
+        }
+        if (closed) fail();
+    }
+}
+
+// ---------------------------------------------------------------- HTTP
+
+HttpConnection::HttpConnection(EventLoop& loop, Metrics& metrics, const struct sockaddr_in& server, const String& hostHeader, HttpListener* listener)
+    : TcpConnection(loop, metrics) {
+    this->server = server;
+    this->hostHeader = hostHeader;
+    this->listener = listener;
+    this->inFlight = false;
+    this->lastUsedUs = 0;
+}
+
+void HttpConnection::post(const String& path, const String& body, int tag) {
+    enqueue("POST", path, body, tag);
+}
+
+void HttpConnection::get(const String& path, int tag) {
+    enqueue("GET", path, String(), tag);
+}
+
+void HttpConnection::enqueue(const char* method, const String& path, const String& body, int tag) {
+    // Same request HTTPClient builds for ApiClient
+    String request = String(method) + " " + path + " HTTP/1.1\r\n";
+    request += "Host: " + hostHeader + "\r\n";
+    request += "User-Agent: ESP32HTTPClient\r\n";
+    request += "Connection: keep-alive\r\n";
+    if (strcmp(method, "POST") == 0) {
+        request += "Content-Length: " + String((unsigned long)body.length()) + "\r\n";
+        request += "Content-Type: application/json\r\n";
+    }
+    request += "\r\n";
+    request += body;
+
+    Request entry;
+    entry.wire.assign(request.c_str(), request.length());
+    entry.tag = tag;
+    entry.queuedUs = EventLoop::nowUs();
+    queue.push_back(entry);
+    metrics.httpRequests++;
+    if (!inFlight) sendNext();
+}
+
+void HttpConnection::sendNext() {
+    while (!inFlight && !queue.empty()) {
+        uint64_t now = EventLoop::nowUs();
+        if (isOpen() && now - lastUsedUs > IDLE_TIMEOUT_US) {
+            close();    // uvicorn drops idle keep-alives after 5 s
+        }
+        if (!isOpen() && !connectTo(server)) {
+            finish(ERROR_CONNECTION_REFUSED, String());
+            continue;
+        }
+        inFlight = true;
+        inBuffer.clear();
+        lastUsedUs = now;
+        write(queue.front().wire);
+    }
+}
+
+void HttpConnection::onConnected() {
+}
+
+void HttpConnection::finish(int code, const String& body) {
+    Request done = queue.front();
+    queue.pop_front();
+    inFlight = false;
+    lastUsedUs = EventLoop::nowUs();
+    if (code < 0 || code >= 400) metrics.httpErrors++;
+    listener->onHttpResponse(done.tag, code, body, lastUsedUs - done.queuedUs);
+    sendNext();
+}
+
+static bool headerEquals(const std::string& headers, const char* name, const char* value) {
+    std::string lower(headers);
+    for (size_t i = 0; i < lower.size(); i++) lower[i] = (char)tolower((unsigned char)lower[i]);
+    std::string needle = std::string("\r\n") + name + ":";
+    size_t at = lower.find(needle);
+    if (at == std::string::npos) return false;
+    at += needle.size();
+    while (at < lower.size() && lower[at] == ' ') at++;
+    return lower.compare(at, strlen(value), value) == 0;
+}
+
+static long headerNumber(const std::string& headers, const char* name) {
+    std::string lower(headers);
+    for (size_t i = 0; i < lower.size(); i++) lower[i] = (char)tolower((unsigned char)lower[i]);
+    std::string needle = std::string("\r\n") + name + ":";
+    size_t at = lower.find(needle);
+    if (at == std::string::npos) return -1;
+    return strtol(lower.c_str() + at + needle.size(), nullptr, 10);
+}
+
+// Content-Length bodies only (all the FastAPI server sends); without one
+// the body runs to EOF, handled in onClosed()
+void HttpConnection::onData() {
+    if (!inFlight) {
+        inBuffer.clear();
+        return;
+    }
+    size_t end = inBuffer.find("\r\n\r\n");
+    if (end == std::string::npos) return;
+    std::string headers = inBuffer.substr(0, end);
+    if (headers.compare(0, 7, "HTTP/1.") != 0) {
+        close();
+        finish(ERROR_CONNECTION_LOST, String());
+        return;
+    }
+    long contentLength = headerNumber(headers, "content-length");
+    if (contentLength < 0) return;
+    if (inBuffer.size() < end + 4 + (size_t)contentLength) return;
+
+    int code = atoi(headers.c_str() + 9);
+    String body;
+    body.concat(inBuffer.data() + end + 4, (unsigned int)contentLength);
+    inBuffer.erase(0, end + 4 + (size_t)contentLength);
+    if (headerEquals(headers, "connection", "close")) {
+        close();
+    }
+    finish(code, body);
+}
+
+void HttpConnection::onClosed() {
+    if (!inFlight) return;
+    size_t end = inBuffer.find("\r\n\r\n");
+    if (end != std::string::npos && inBuffer.compare(0, 7, "HTTP/1.") == 0) {
+        // Close-delimited body
+        String body;
+        body.concat(inBuffer.data() + end + 4, (unsigned int)(inBuffer.size() - end - 4));
+        int code = atoi(inBuffer.c_str() + 9);
+        inBuffer.clear();
+        finish(code, body);
+        return;
+    }
+    finish(ERROR_CONNECTION_LOST, String());
+}
+
+// ---------------------------------------------------------------- WebSocket
+
+static const uint8_t OPCODE_CONTINUATION = 0x0;
+static const uint8_t OPCODE_TEXT = 0x1;
+static const uint8_t OPCODE_BINARY = 0x2;
+static const uint8_t OPCODE_CLOSE = 0x8;
+static const uint8_t OPCODE_PING = 0x9;
+static const uint8_t OPCODE_PONG = 0xA;
+
+WsConnection::WsConnection(EventLoop& loop, Metrics& metrics, const struct sockaddr_in& server, const String& hostHeader, const String& path, WsListener* listener)
+    : TcpConnection(loop, metrics) {
+    this->server = server;
+    this->hostHeader = hostHeader;
+    this->path = path;
+    this->listener = listener;
+    this->upgraded = false;
+    this->messageOpcode = 0;
+    this->maskState = (uint32_t)(uintptr_t)this * 2654435761u | 1;
+}
+
+bool WsConnection::open() {
+    upgraded = false;
+    message.clear();
+    return connectTo(server);
+}
+
+void WsConnection::onConnected() {
+    // The server doesn't check the key's value, only that it's there
+    String request = "GET " + path + " HTTP/1.1\r\n";
+    request += "Host: " + hostHeader + "\r\n";
+    request += "Connection: Upgrade\r\n";
+    request += "Upgrade: websocket\r\n";
+    request += "Sec-WebSocket-Version: 13\r\n";
+    request += "Sec-WebSocket-Key: bG9hZGdlbi12aXJ0dWFsLWRldg==\r\n";
+    request += "Sec-WebSocket-Protocol: arduino\r\n";
+    request += "User-Agent: arduino-WebSocket-Client\r\n\r\n";
+    write(request.c_str(), request.length());
+}
+
+void WsConnection::onData() {
+    if (!upgraded) {
+        size_t end = inBuffer.find("\r\n\r\n");
+        if (end == std::string::npos) return;
+        if (inBuffer.compare(0, 12, "HTTP/1.1 101") != 0) {
+            close();
+            onClosed();
+            return;
+        }
+        inBuffer.erase(0, end + 4);
+        upgraded = true;
+        listener->onWsOpen();
+        if (!isOpen()) return;
+    }
+    while (isOpen() && parseFrame()) {}
+}
+
+void WsConnection::onClosed() {
+    upgraded = false;
+    message.clear();
+    listener->onWsClosed();
+}
+
+bool WsConnection::parseFrame() {
+    if (inBuffer.size() < 2) return false;
+    const uint8_t* p = (const uint8_t*)inBuffer.data();
+    bool fin = (p[0] & 0x80) != 0;
+    uint8_t opcode = p[0] & 0x0F;
+    bool masked = (p[1] & 0x80) != 0;
+    uint64_t length = p[1] & 0x7F;
+    size_t header = 2;
+    if (length == 126) {
+        if (inBuffer.size() < 4) return false;
+        length = ((uint64_t)p[2] << 8) | p[3];
+        header = 4;
+    } else if (length == 127) {
+        if (inBuffer.size() < 10) return false;
+        length = 0;
+        for (int i = 0; i < 8; i++) length = (length << 8) | p[2 + i];
+        header = 10;
+    }
+    size_t maskAt = header;
+    if (masked) header += 4;
+    if (inBuffer.size() < header + length) return false;
+
+    std::string payload = inBuffer.substr(header, (size_t)length);
+    if (masked) {
+        for (size_t i = 0; i < payload.size(); i++) payload[i] ^= inBuffer[maskAt + (i & 3)];
+    }
+    inBuffer.erase(0, header + (size_t)length);
+
+    switch (opcode) {
+        case OPCODE_PING:
+            sendFrame(OPCODE_PONG, (const uint8_t*)payload.data(), payload.size());
+            return isOpen();
+        case OPCODE_PONG:
+            return true;
+        case OPCODE_CLOSE:
+            sendFrame(OPCODE_CLOSE, (const uint8_t*)payload.data(), payload.size() >= 2 ? 2 : 0);
+            close();
+            onClosed();
+            return false;
+        case OPCODE_TEXT:
+        case OPCODE_BINARY:
+            messageOpcode = opcode;
+            message = payload;
+            break;
+        case OPCODE_CONTINUATION:
+            message += payload;
+            break;
+        default:
+            close();
+            onClosed();
+            return false;
+    }
+    if (!fin) return true;
+
+    metrics.framesIn++;
+    size_t messageLength = message.size();
+    message.push_back('\0');
+    listener->onWsMessage(messageOpcode == OPCODE_BINARY, (uint8_t*)&message[0], messageLength);
+    message.clear();
+    return isOpen();
+}
+
+bool WsConnection::sendFrame(uint8_t opcode, const uint8_t* data, size_t length) {
+    if (!isOpen()) return false;
+    std::string frame;
+    frame.reserve(length + 14);
+    frame.push_back((char)(0x80 | opcode));
+    if (length < 126) {
+        frame.push_back((char)(0x80 | length));
+    } else if (length <= 0xFFFF) {
+        frame.push_back((char)(0x80 | 126));
+        frame.push_back((char)(length >> 8));
+        frame.push_back((char)length);
+    } else {
+        frame.push_back((char)(0x80 | 127));
+        for (int i = 0; i < 8; i++) frame.push_back((char)((uint64_t)length >> (56 - 8 * i)));
+    }
+    // xorshift32: masks only need to be unpredictable to proxies, not secure
+    maskState ^= maskState << 13;
+    maskState ^= maskState >> 17;
+    maskState ^= maskState << 5;
+    uint8_t mask[4] = {(uint8_t)maskState, (uint8_t)(maskState >> 8), (uint8_t)(maskState >> 16), (uint8_t)(maskState >> 24)};
+    frame.append((const char*)mask, 4);
+    size_t at = frame.size();
+    frame.append((const char*)data, length);
+    for (size_t i = 0; i < length; i++) frame[at + i] ^= mask[i & 3];
+    return write(frame);
+}
+
+bool WsConnection::sendText(const char* data, size_t length) {
+    if (!isOpenWs()) return false;
+    metrics.framesOut++;
+    return sendFrame(OPCODE_TEXT, (const uint8_t*)data, length);
+}
+
+bool WsConnection::sendBinary(const uint8_t* data, size_t length) {
+    if (!isOpenWs()) return false;
+    metrics.framesOut++;
+    return sendFrame(OPCODE_BINARY, data, length);
+}
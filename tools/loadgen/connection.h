@@ -0,0 +1,135 @@
+#ifndef LOADGEN_CONNECTION_H
+#define LOADGEN_CONNECTION_H
+
+#include <Arduino.h>
+#include <netinet/in.h>
+#include <deque>
+#include <string>
+#include "event_loop.h"
+
+struct Metrics;
+
+// Non-blocking TCP socket on the EventLoop. Output that doesn't fit the
+// kernel buffer waits in outBuffer until EPOLLOUT; input accumulates in
+// inBuffer for the subclass to consume.
+class TcpConnection : public EventLoop::Handler {
+public:
+    TcpConnection(EventLoop& loop, Metrics& metrics);
+    virtual ~TcpConnection();
+
+    bool isOpen() const { return fd >= 0; }
+    bool isConnected() const { return fd >= 0 && !connecting; }
+    void close();
+
+    void onReady(uint32_t events) override;
+
+protected:
+    EventLoop& loop;
+    Metrics& metrics;
+    std::string inBuffer;
+
+    bool connectTo(const struct sockaddr_in& address);
+    bool write(const char* data, size_t length);
+    bool write(const std::string& data) { return write(data.data(), data.size()); }
+
+    virtual void onConnected() = 0;
+    virtual void onData() = 0;          // inBuffer grew
+    virtual void onClosed() = 0;        // Connect failure, reset or EOF; fd is already closed
+
+private:
+    int fd;
+    bool connecting;
+    bool wantWrite;
+    std::string outBuffer;
+
+    void flush();
+    void fail();
+};
+
+class HttpListener {
+public:
+    virtual ~HttpListener() {}
+    // code < 0: HttpConnection::ERROR_*
+    virtual void onHttpResponse(int tag, int code, const String& body, uint64_t latencyUs) = 0;
+};
+
+// One keep-alive HTTP/1.1 connection, one request in flight, more queued.
+// Sends the same headers as the firmware's HTTPClient, and like
+// ApiConnectionPool closes a socket idle longer than IDLE_TIMEOUT_US
+// before reusing it.
+class HttpConnection : public TcpConnection {
+public:
+    static const uint64_t IDLE_TIMEOUT_US = 4000000;   // ApiConnectionPool::IDLE_TIMEOUT_MS
+    static const int ERROR_CONNECTION_REFUSED = -1;     // Same values as HTTPC_ERROR_*
+    static const int ERROR_CONNECTION_LOST = -5;
+
+    HttpConnection(EventLoop& loop, Metrics& metrics, const struct sockaddr_in& server, const String& hostHeader, HttpListener* listener);
+
+    void post(const String& path, const String& body, int tag);
+    void get(const String& path, int tag);
+    bool idle() const { return !inFlight && queue.empty(); }
+
+protected:
+    void onConnected() override;
+    void onData() override;
+    void onClosed() override;
+
+private:
+    struct Request {
+        std::string wire;       // Request line, headers and body
+        int tag;
+        uint64_t queuedUs;
+    };
+
+    struct sockaddr_in server;
+    String hostHeader;
+    HttpListener* listener;
+    std::deque<Request> queue;
+    bool inFlight;
+    uint64_t lastUsedUs;
+
+    void enqueue(const char* method, const String& path, const String& body, int tag);
+    void sendNext();
+    void finish(int code, const String& body);
+};
+
+class WsListener {
+public:
+    virtual ~WsListener() {}
+    virtual void onWsOpen() = 0;
+    // Whole message; payload is writable and NUL-terminated like the library's
+    virtual void onWsMessage(bool binary, uint8_t* payload, size_t length) = 0;
+    virtual void onWsClosed() = 0;
+};
+
+// RFC 6455 client side: upgrade, masked frames out, unmasked frames in,
+// fragments reassembled, pings answered.
+class WsConnection : public TcpConnection {
+public:
+    WsConnection(EventLoop& loop, Metrics& metrics, const struct sockaddr_in& server, const String& hostHeader, const String& path, WsListener* listener);
+
+    bool open();
+    bool isOpenWs() const { return upgraded && isConnected(); }
+    bool sendText(const char* data, size_t length);
+    bool sendBinary(const uint8_t* data, size_t length);
+
+protected:
+    void onConnected() override;
+    void onData() override;
+    void onClosed() override;
+
+private:
+    struct sockaddr_in server;
+    String hostHeader;
+    String path;
+    WsListener* listener;
+    bool upgraded;
+    uint8_t messageOpcode;
+    std::string message;        // Fragments of the message being reassembled
+    uint32_t maskState;
+
+    bool sendFrame(uint8_t opcode, const uint8_t* data, size_t length);
+    bool parseFrame();          // false = need more bytes (or the connection closed)
+};
+
+#endif
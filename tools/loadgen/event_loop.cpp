@@ -0,0 +1,86 @@
+#include "event_loop.h"
+#include <errno.h>
+#include <sys/epoll.h>
+#include <time.h>
+#include <unistd.h>
+
+static const int MAX_EVENTS = 256;
+static const uint64_t MAX_WAIT_US = 100000;    // Come back for stop() at least this often
+
+EventLoop::EventLoop() {
+    this->epollFd = epoll_create1(EPOLL_CLOEXEC);
+    this->stopped = false;
+    this->timerOrder = 0;
+}
+
+EventLoop::~EventLoop() {
+    if (epollFd >= 0) close(epollFd);
+}
+
+uint64_t EventLoop::nowUs() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000ULL + (uint64_t)ts.tv_nsec / 1000ULL;
+}
+
+bool EventLoop::add(int fd, uint32_t events, Handler* handler) {
+    struct epoll_event ev;
+    ev.events = events;
+    ev.data.ptr = handler;
+    return epoll_ctl(epollFd, EPOLL_CTL_ADD, fd, &ev) == 0;
+}
+
+bool EventLoop::modify(int fd, uint32_t events, Handler* handler) {
+    struct epoll_event ev;
+    ev.events = events;
+    ev.data.ptr = handler;
+    return epoll_ctl(epollFd, EPOLL_CTL_MOD, fd, &ev) == 0;
+}
+
+void EventLoop::remove(int fd) {
+    epoll_ctl(epollFd, EPOLL_CTL_DEL, fd, nullptr);
+}
+
+void EventLoop::schedule(uint64_t dueUs, TimerTarget* target, int kind) {
+    Timer timer = {dueUs, timerOrder++, target, kind};
+    timers.push(timer);
+}
+
+void EventLoop::runTimers(uint64_t now) {
+    // Timers scheduled from a callback for "now" run on the next pass, so a
+    // device that reschedules itself immediately can't starve the sockets
+    uint64_t last = timerOrder;
+    while (!timers.empty() && timers.top().dueUs <= now && timers.top().order < last) {
+        Timer timer = timers.top();
+        timers.pop();
+        timer.target->onTimer(timer.kind, now);
+    }
+}
+
+void EventLoop::run(uint64_t endUs) {
+    struct epoll_event events[MAX_EVENTS];
+    stopped = false;
+
+    while (!stopped) {
+        uint64_t now = nowUs();
+        if (now >= endUs) break;
+        runTimers(now);
+
+        uint64_t wait = endUs - now;
+        if (wait > MAX_WAIT_US) wait = MAX_WAIT_US;
+        if (!timers.empty()) {
+            uint64_t due = timers.top().dueUs;
+            wait = due <= now ? 0 : (due - now < wait ? due - now : wait);
+        }
+
+        // Round up so a timer 300us away doesn't turn into a busy spin
+        int n = epoll_wait(epollFd, events, MAX_EVENTS, (int)((wait + 999) / 1000));
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            break;
+        }
+        for (int i = 0; i < n; i++) {
+            ((Handler*)events[i].data.ptr)->onReady(events[i].events);
+        }
+    }
+}
@@ -0,0 +1,62 @@
+#ifndef LOADGEN_EVENT_LOOP_H
+#define LOADGEN_EVENT_LOOP_H
+
+#include <stdint.h>
+#include <queue>
+#include <vector>
+
+// Single-threaded epoll loop plus a timer heap. Every socket and every
+// virtual device lives on this one thread, so nothing here is locked.
+class EventLoop {
+public:
+    class Handler {
+    public:
+        virtual ~Handler() {}
+        virtual void onReady(uint32_t events) = 0;   // EPOLLIN / EPOLLOUT / EPOLLERR / EPOLLHUP
+    };
+
+    class TimerTarget {
+    public:
+        virtual ~TimerTarget() {}
+        virtual void onTimer(int kind, uint64_t nowUs) = 0;
+    };
+
+    EventLoop();
+    ~EventLoop();
+
+    bool ok() const { return epollFd >= 0; }
+
+    bool add(int fd, uint32_t events, Handler* handler);
+    bool modify(int fd, uint32_t events, Handler* handler);
+    void remove(int fd);
+
+    // target->onTimer(kind) once nowUs() >= dueUs. There is no cancel:
+    // targets ignore timers that no longer match their state.
+    void schedule(uint64_t dueUs, TimerTarget* target, int kind);
+
+    // Dispatches sockets and timers until endUs or stop()
+    void run(uint64_t endUs);
+    void stop() { stopped = true; }
+
+    static uint64_t nowUs();    // CLOCK_MONOTONIC
+
+private:
+    struct Timer {
+        uint64_t dueUs;
+        uint64_t order;         // FIFO among timers due at the same microsecond
+        TimerTarget* target;
+        int kind;
+        bool operator>(const Timer& other) const {
+            return dueUs != other.dueUs ? dueUs > other.dueUs : order > other.order;
+        }
+    };
+
+    int epollFd;
+    bool stopped;
+    uint64_t timerOrder;
+    std::priority_queue<Timer, std::vector<Timer>, std::greater<Timer> > timers;
+
+    void runTimers(uint64_t now);
+};
+
+#endif
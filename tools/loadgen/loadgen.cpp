@@ -0,0 +1,254 @@
+// Virtual-device load generator for the FastAPI server.
+//
+// Runs N simulated handsets in one process on one epoll loop. Each one logs
+// in over REST, opens the WebSocket with the firmware's init handshake,
+// befriends its pair, then chats and plays caro until the run ends. The
+// requests, socket frames and parsers are the firmware's own (ApiProtocol,
+// SocketProtocol, SocketFramer), so the server sees real device traffic.
+//
+//   pio run -e loadgen
+//   .pio/build/loadgen/program --devices 2000 --duration 60 --ramp 10 --csv run.csv
+//
+// Prints a progress line per second and a report with connection rate,
+// frame/message throughput and latency percentiles at the end.
+#include <Arduino.h>
+#include <arpa/inet.h>
+#include <netdb.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/resource.h>
+#include <time.h>
+#include <vector>
+#include "event_loop.h"
+#include "metrics.h"
+#include "virtual_device.h"
+
+struct Options {
+    String host;
+    uint16_t port;
+    int devices;
+    double durationSeconds;
+    double rampSeconds;
+    const char* csvPath;
+    LoadConfig load;
+};
+
+static EventLoop* runningLoop = nullptr;
+
+static void onSignal(int) {
+    if (runningLoop != nullptr) runningLoop->stop();
+}
+
+static void usage(const char* program) {
+    fprintf(stderr,
+            "Usage: %s [options]\n"
+            "  --host HOST            server (default 127.0.0.1)\n"
+            "  --port PORT            (default 8080)\n"
+            "  --path PATH            WebSocket path (default /ws)\n"
+            "  --devices N            virtual devices, rounded up to pairs (default 100)\n"
+            "  --duration S           seconds after the ramp starts (default 60)\n"
+            "  --ramp S               spread logins over S seconds (default 10)\n"
+            "  --prefix NAME          username prefix (default lg<unix time>)\n"
+            "  --pin PIN              (default 1234)\n"
+            "  --no-register          accounts already exist, only log in\n"
+            "  --chat-interval MS     between chat bursts per device (default 2000)\n"
+            "  --chat-burst N         messages per burst, 1-16 (default 5)\n"
+            "  --chat-bytes N         characters per message, up to 500 (default 32)\n"
+            "  --moves N              moves per game before the host leaves (default 20)\n"
+            "  --think MS             delay before each move (default 250)\n"
+            "  --game-pause MS        between games (default 2000)\n"
+            "  --csv FILE             per-second metrics\n",
+            program);
+}
+
+static bool parseOptions(int argc, char** argv, Options& options) {
+    options.host = "127.0.0.1";
+    options.port = 8080;
+    options.devices = 100;
+    options.durationSeconds = 60;
+    options.rampSeconds = 10;
+    options.csvPath = nullptr;
+    options.load.wsPath = "/ws";
+    options.load.prefix = "lg" + String((unsigned long)time(nullptr));
+    options.load.pin = "1234";
+    options.load.registerAccounts = true;
+    options.load.chatIntervalMs = 2000;
+    options.load.chatBurst = 5;
+    options.load.chatBytes = 32;
+    options.load.movesPerGame = 20;
+    options.load.thinkMs = 250;
+    options.load.gamePauseMs = 2000;
+    options.load.reconnectMs = 1000;
+
+    for (int i = 1; i < argc; i++) {
+        const char* arg = argv[i];
+        const char* value = i + 1 < argc ? argv[i + 1] : nullptr;
+        if (strcmp(arg, "--no-register") == 0) {
+            options.load.registerAccounts = false;
+            continue;
+        }
+        if (strcmp(arg, "--help") == 0 || value == nullptr) {
+            return false;
+        }
+        i++;
+        if (strcmp(arg, "--host") == 0) options.host = value;
+        else if (strcmp(arg, "--port") == 0) options.port = (uint16_t)atoi(value);
+        else if (strcmp(arg, "--path") == 0) options.load.wsPath = value;
+        else if (strcmp(arg, "--devices") == 0) options.devices = atoi(value);
+        else if (strcmp(arg, "--duration") == 0) options.durationSeconds = atof(value);
+        else if (strcmp(arg, "--ramp") == 0) options.rampSeconds = atof(value);
+        else if (strcmp(arg, "--prefix") == 0) options.load.prefix = value;
+        else if (strcmp(arg, "--pin") == 0) options.load.pin = value;
+        else if (strcmp(arg, "--chat-interval") == 0) options.load.chatIntervalMs = (uint32_t)atoi(value);
+        else if (strcmp(arg, "--chat-burst") == 0) options.load.chatBurst = (uint32_t)atoi(value);
+        else if (strcmp(arg, "--chat-bytes") == 0) options.load.chatBytes = (uint32_t)atoi(value);
+        else if (strcmp(arg, "--moves") == 0) options.load.movesPerGame = (uint32_t)atoi(value);
+        else if (strcmp(arg, "--think") == 0) options.load.thinkMs = (uint32_t)atoi(value);
+        else if (strcmp(arg, "--game-pause") == 0) options.load.gamePauseMs = (uint32_t)atoi(value);
+        else if (strcmp(arg, "--csv") == 0) options.csvPath = value;
+        else return false;
+    }
+
+    if (options.devices < 2 || options.durationSeconds <= 0 || options.rampSeconds < 0) return false;
+    options.devices += options.devices % 2;
+    if (options.load.chatBurst > 16) options.load.chatBurst = 16;
+    if (options.load.movesPerGame > 15 * 20) options.load.movesPerGame = 15 * 20;
+    if (options.load.chatIntervalMs == 0) options.load.chatIntervalMs = 1;
+    return true;
+}
+
+static bool resolve(const String& host, uint16_t port, struct sockaddr_in& address) {
+    struct addrinfo hints;
+    memset(&hints, 0, sizeof(hints));
+    hints.ai_family = AF_INET;
+    hints.ai_socktype = SOCK_STREAM;
+    struct addrinfo* result = nullptr;
+    if (getaddrinfo(host.c_str(), nullptr, &hints, &result) != 0 || result == nullptr) return false;
+    address = *(struct sockaddr_in*)result->ai_addr;
+    address.sin_port = htons(port);
+    freeaddrinfo(result);
+    return true;
+}
+
+// Two sockets per device plus slack; the default soft limit (1024) stops
+// at about 500 devices
+static void raiseFileLimit(int devices) {
+    struct rlimit limit;
+    if (getrlimit(RLIMIT_NOFILE, &limit) != 0) return;
+    rlim_t wanted = (rlim_t)devices * 2 + 64;
+    if (limit.rlim_cur >= wanted) return;
+    limit.rlim_cur = wanted < limit.rlim_max ? wanted : limit.rlim_max;
+    setrlimit(RLIMIT_NOFILE, &limit);
+    if (limit.rlim_cur < wanted) {
+        fprintf(stderr, "loadgen: only %lu file descriptors allowed, %d devices need %lu\n",
+                (unsigned long)limit.rlim_cur, devices, (unsigned long)wanted);
+    }
+}
+
+// Prints the per-second line and the CSV row, then re-arms itself
+class Reporter : public EventLoop::TimerTarget {
+public:
+    Reporter(EventLoop& loop, const Metrics& metrics, uint64_t startUs, FILE* csv)
+        : loop(loop), metrics(metrics) {
+        this->startUs = startUs;
+        this->lastUs = startUs;
+        this->csv = csv;
+    }
+
+    void onTimer(int kind, uint64_t nowUs) override {
+        (void)kind;
+        double elapsed = (nowUs - startUs) / 1e6;
+        metrics.printProgress(stdout, elapsed, previous, (nowUs - lastUs) / 1e6);
+        if (csv != nullptr) metrics.printCsvRow(csv, elapsed);
+        previous = metrics;
+        lastUs = nowUs;
+        loop.schedule(nowUs + 1000000, this, 0);
+    }
+
+private:
+    EventLoop& loop;
+    const Metrics& metrics;
+    Metrics previous;
+    uint64_t startUs;
+    uint64_t lastUs;
+    FILE* csv;
+};
+
+int main(int argc, char** argv) {
+    Options options;
+    if (!parseOptions(argc, argv, options)) {
+        usage(argv[0]);
+        return 2;
+    }
+    if (!resolve(options.host, options.port, options.load.server)) {
+        fprintf(stderr, "loadgen: cannot resolve %s\n", options.host.c_str());
+        return 1;
+    }
+    options.load.hostHeader = options.host + ":" + String((unsigned int)options.port);
+    raiseFileLimit(options.devices);
+
+    FILE* csv = nullptr;
+    if (options.csvPath != nullptr) {
+        csv = fopen(options.csvPath, "w");
+        if (csv == nullptr) {
+            perror(options.csvPath);
+            return 1;
+        }
+        Metrics::printCsvHeader(csv);
+    }
+
+    EventLoop loop;
+    if (!loop.ok()) {
+        perror("epoll_create1");
+        return 1;
+    }
+    Metrics metrics;
+
+    std::vector<VirtualDevice*> devices;
+    devices.reserve(options.devices);
+    for (int i = 0; i < options.devices; i++) {
+        devices.push_back(new VirtualDevice(i, options.load, loop, metrics));
+    }
+    for (int i = 0; i < options.devices; i += 2) {
+        devices[i]->pairWith(devices[i + 1]);
+        devices[i + 1]->pairWith(devices[i]);
+    }
+
+    printf("loadgen: %d devices (%s_0..%d) -> %s, ramp %.0f s, run %.0f s\n",
+           options.devices, options.load.prefix.c_str(), options.devices - 1,
+           options.load.hostHeader.c_str(), options.rampSeconds, options.durationSeconds);
+
+    // Pairs log in together so the friend request finds both sockets up
+    uint64_t startUs = EventLoop::nowUs();
+    int pairs = options.devices / 2;
+    for (int p = 0; p < pairs; p++) {
+        uint64_t at = startUs + (uint64_t)(options.rampSeconds * 1e6 * p / pairs);
+        devices[2 * p]->start(at);
+        devices[2 * p + 1]->start(at);
+    }
+
+    Reporter reporter(loop, metrics, startUs, csv);
+    loop.schedule(startUs + 1000000, &reporter, 0);
+
+    runningLoop = &loop;
+    signal(SIGINT, onSignal);
+    signal(SIGTERM, onSignal);
+    loop.run(startUs + (uint64_t)(options.durationSeconds * 1e6));
+    runningLoop = nullptr;
+
+    double seconds = (EventLoop::nowUs() - startUs) / 1e6;
+    for (size_t i = 0; i < devices.size(); i++) {
+        devices[i]->stop();
+    }
+    metrics.printReport(stdout, seconds);
+    if (csv != nullptr) {
+        metrics.printCsvRow(csv, seconds);
+        fclose(csv);
+    }
+    for (size_t i = 0; i < devices.size(); i++) {
+        delete devices[i];
+    }
+    return 0;
+}
@@ -0,0 +1,161 @@
+#include "metrics.h"
+#include <string.h>
+
+Histogram::Histogram() {
+    memset(buckets, 0, sizeof(buckets));
+    this->total = 0;
+    this->sum = 0;
+    this->lowest = UINT64_MAX;
+    this->highest = 0;
+}
+
+// Values below 8 get a bucket each; above that, 8 buckets per power of two
+int Histogram::bucketOf(uint64_t us) {
+    if (us < (1u << SUB_BITS)) return (int)us;
+    int msb = 63 - __builtin_clzll(us);
+    int exponent = msb - SUB_BITS + 1;
+    int sub = (int)((us >> (msb - SUB_BITS)) & ((1u << SUB_BITS) - 1));
+    return (exponent << SUB_BITS) + sub;
+}
+
+uint64_t Histogram::upperEdge(int bucket) {
+    if (bucket < (1 << SUB_BITS)) return (uint64_t)bucket;
+    int exponent = bucket >> SUB_BITS;
+    int sub = bucket & ((1 << SUB_BITS) - 1);
+    int shift = exponent - 1;
+    uint64_t lower = (uint64_t)((1 << SUB_BITS) + sub) << shift;
+    return lower + ((uint64_t)1 << shift) - 1;
+}
+
+void Histogram::record(uint64_t us) {
+    buckets[bucketOf(us)]++;
+    total++;
+    sum += us;
+    if (us < lowest) lowest = us;
+    if (us > highest) highest = us;
+}
+
+uint64_t Histogram::percentile(double p) const {
+    if (total == 0) return 0;
+    uint64_t rank = (uint64_t)(p / 100.0 * (double)total + 0.5);
+    if (rank < 1) rank = 1;
+    if (rank > total) rank = total;
+    uint64_t seen = 0;
+    for (int i = 0; i < BUCKETS; i++) {
+        seen += buckets[i];
+        if (seen >= rank) {
+            uint64_t edge = upperEdge(i);
+            return edge < highest ? edge : highest;
+        }
+    }
+    return highest;
+}
+
+void Histogram::printRow(FILE* out, const char* name) const {
+    fprintf(out, "  %-12s %9llu %9.2f %9.2f %9.2f %9.2f %9.2f %9.2f\n", name,
+            (unsigned long long)total,
+            mean() / 1000.0,
+            percentile(50) / 1000.0,
+            percentile(90) / 1000.0,
+            percentile(99) / 1000.0,
+            percentile(99.9) / 1000.0,
+            max() / 1000.0);
+}
+
+Metrics::Metrics() {
+    this->tcpConnects = 0;
+    this->tcpConnectErrors = 0;
+    this->wsOpened = 0;
+    this->wsDropped = 0;
+    this->bytesIn = 0;
+    this->bytesOut = 0;
+    this->framesIn = 0;
+    this->framesOut = 0;
+    this->httpRequests = 0;
+    this->httpErrors = 0;
+    this->devicesOnline = 0;
+    this->friendships = 0;
+    this->chatSent = 0;
+    this->chatDelivered = 0;
+    this->chatErrors = 0;
+    this->chatReceived = 0;
+    this->gamesStarted = 0;
+    this->gamesFinished = 0;
+    this->movesSent = 0;
+    this->movesAcked = 0;
+    this->movesRejected = 0;
+    this->unknownFrames = 0;
+}
+
+static double rate(uint64_t now, uint64_t before, double seconds) {
+    return seconds > 0 ? (double)(now - before) / seconds : 0;
+}
+
+void Metrics::printProgress(FILE* out, double elapsedSeconds, const Metrics& previous, double intervalSeconds) const {
+    fprintf(out, "[%6.1fs] online %5llu | conn/s %7.1f | frames/s out %8.1f in %8.1f | "
+                 "chat/s %7.1f | moves/s %6.1f | http/s %6.1f | chat p99 %7.2f ms | move p99 %7.2f ms | errors %llu\n",
+            elapsedSeconds,
+            (unsigned long long)devicesOnline,
+            rate(wsOpened, previous.wsOpened, intervalSeconds),
+            rate(framesOut, previous.framesOut, intervalSeconds),
+            rate(framesIn, previous.framesIn, intervalSeconds),
+            rate(chatDelivered, previous.chatDelivered, intervalSeconds),
+            rate(movesAcked, previous.movesAcked, intervalSeconds),
+            rate(httpRequests, previous.httpRequests, intervalSeconds),
+            chat.percentile(99) / 1000.0,
+            moveAck.percentile(99) / 1000.0,
+            (unsigned long long)(tcpConnectErrors + wsDropped + httpErrors + chatErrors + movesRejected));
+    fflush(out);
+}
+
+void Metrics::printCsvHeader(FILE* out) {
+    fprintf(out, "elapsed_s,online,ws_opened,ws_dropped,tcp_connect_errors,frames_out,frames_in,bytes_out,bytes_in,"
+                 "http_requests,http_errors,chat_sent,chat_delivered,chat_errors,moves_sent,moves_acked,moves_rejected,"
+                 "games_started,games_finished,chat_p50_us,chat_p99_us,move_ack_p50_us,move_ack_p99_us,http_p50_us,http_p99_us\n");
+}
+
+void Metrics::printCsvRow(FILE* out, double elapsedSeconds) const {
+    fprintf(out, "%.1f,%llu,%llu,%llu,%llu,%llu,%llu,%llu,%llu,%llu,%llu,%llu,%llu,%llu,%llu,%llu,%llu,%llu,%llu,"
+                 "%llu,%llu,%llu,%llu,%llu,%llu\n",
+            elapsedSeconds,
+            (unsigned long long)devicesOnline, (unsigned long long)wsOpened, (unsigned long long)wsDropped,
+            (unsigned long long)tcpConnectErrors,
+            (unsigned long long)framesOut, (unsigned long long)framesIn,
+            (unsigned long long)bytesOut, (unsigned long long)bytesIn,
+            (unsigned long long)httpRequests, (unsigned long long)httpErrors,
+            (unsigned long long)chatSent, (unsigned long long)chatDelivered, (unsigned long long)chatErrors,
+            (unsigned long long)movesSent, (unsigned long long)movesAcked, (unsigned long long)movesRejected,
+            (unsigned long long)gamesStarted, (unsigned long long)gamesFinished,
+            (unsigned long long)chat.percentile(50), (unsigned long long)chat.percentile(99),
+            (unsigned long long)moveAck.percentile(50), (unsigned long long)moveAck.percentile(99),
+            (unsigned long long)http.percentile(50), (unsigned long long)http.percentile(99));
+    fflush(out);
+}
+
+void Metrics::printReport(FILE* out, double seconds) const {
+    fprintf(out, "\n=== Load generator report (%.1f s) ===\n", seconds);
+    fprintf(out, "Connections: %llu TCP connects (%llu failed), %llu sockets initialized (%.1f/s), %llu dropped\n",
+            (unsigned long long)tcpConnects, (unsigned long long)tcpConnectErrors,
+            (unsigned long long)wsOpened, rate(wsOpened, 0, seconds), (unsigned long long)wsDropped);
+    fprintf(out, "Frames:      out %llu (%.1f/s, %.1f KB/s), in %llu (%.1f/s, %.1f KB/s)\n",
+            (unsigned long long)framesOut, rate(framesOut, 0, seconds), rate(bytesOut, 0, seconds) / 1024.0,
+            (unsigned long long)framesIn, rate(framesIn, 0, seconds), rate(bytesIn, 0, seconds) / 1024.0);
+    fprintf(out, "REST:        %llu requests (%.1f/s), %llu errors\n",
+            (unsigned long long)httpRequests, rate(httpRequests, 0, seconds), (unsigned long long)httpErrors);
+    fprintf(out, "Chat:        %llu sent, %llu delivered (%.1f/s), %llu received, %llu chat_error\n",
+            (unsigned long long)chatSent, (unsigned long long)chatDelivered, rate(chatDelivered, 0, seconds),
+            (unsigned long long)chatReceived, (unsigned long long)chatErrors);
+    fprintf(out, "Games:       %llu friendships, %llu games started, %llu finished, %llu moves sent, %llu acked (%.1f/s), %llu rejected\n",
+            (unsigned long long)friendships, (unsigned long long)gamesStarted, (unsigned long long)gamesFinished,
+            (unsigned long long)movesSent, (unsigned long long)movesAcked, rate(movesAcked, 0, seconds),
+            (unsigned long long)movesRejected);
+    if (unknownFrames > 0) {
+        fprintf(out, "Frames the protocol code didn't decode: %llu\n", (unsigned long long)unknownFrames);
+    }
+    fprintf(out, "\nLatency (ms)     count      mean       p50       p90       p99     p99.9       max\n");
+    http.printRow(out, "http");
+    connect.printRow(out, "connect");
+    chat.printRow(out, "chat");
+    moveAck.printRow(out, "move_ack");
+    moveRelay.printRow(out, "move_relay");
+}
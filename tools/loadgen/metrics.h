@@ -0,0 +1,83 @@
+#ifndef LOADGEN_METRICS_H
+#define LOADGEN_METRICS_H
+
+#include <stdint.h>
+#include <stdio.h>
+
+// Latency histogram with log-linear buckets: 8 per power of two, so any
+// percentile is within 12.5% of the true value, from 1 us to hours, in a
+// fixed 4 KB with no allocation on record().
+class Histogram {
+public:
+    Histogram();
+
+    void record(uint64_t us);
+    uint64_t count() const { return total; }
+    uint64_t min() const { return total ? lowest : 0; }
+    uint64_t max() const { return highest; }
+    uint64_t mean() const { return total ? sum / total : 0; }
+    uint64_t percentile(double p) const;     // p in [0, 100]; upper edge of the bucket
+
+    // "name  count  mean  p50  p90  p99  p99.9  max" in milliseconds
+    void printRow(FILE* out, const char* name) const;
+
+private:
+    static const int SUB_BITS = 3;
+    static const int BUCKETS = 64 << SUB_BITS;
+
+    uint64_t buckets[BUCKETS];
+    uint64_t total;
+    uint64_t sum;
+    uint64_t lowest;
+    uint64_t highest;
+
+    static int bucketOf(uint64_t us);
+    static uint64_t upperEdge(int bucket);
+};
+
+// Everything the run counts. One instance, touched only from the loop thread.
+struct Metrics {
+    // Connections
+    uint64_t tcpConnects;
+    uint64_t tcpConnectErrors;
+    uint64_t wsOpened;          // init_ack received
+    uint64_t wsDropped;         // Closed by the server or the network
+    uint64_t bytesIn;
+    uint64_t bytesOut;
+    uint64_t framesIn;
+    uint64_t framesOut;
+
+    // REST
+    uint64_t httpRequests;
+    uint64_t httpErrors;        // Transport error, 4xx/5xx or "success": false
+
+    // Scenario
+    uint64_t devicesOnline;     // Gauge
+    uint64_t friendships;
+    uint64_t chatSent;
+    uint64_t chatDelivered;
+    uint64_t chatErrors;        // chat_error from the server
+    uint64_t chatReceived;
+    uint64_t gamesStarted;
+    uint64_t gamesFinished;
+    uint64_t movesSent;
+    uint64_t movesAcked;
+    uint64_t movesRejected;     // Ack with success: false
+    uint64_t unknownFrames;
+
+    Histogram http;             // Request queued -> response parsed
+    Histogram connect;          // TCP connect started -> init_ack
+    Histogram chat;             // chat_message queued -> message_delivered
+    Histogram moveAck;          // game_move queued -> game_move_ack
+    Histogram moveRelay;        // game_move queued -> opponent's game_event "move"
+
+    Metrics();
+
+    // Per-second progress line against the previous snapshot
+    void printProgress(FILE* out, double elapsedSeconds, const Metrics& previous, double intervalSeconds) const;
+    static void printCsvHeader(FILE* out);
+    void printCsvRow(FILE* out, double elapsedSeconds) const;
+    void printReport(FILE* out, double seconds) const;
+};
+
+#endif
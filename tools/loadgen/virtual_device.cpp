@@ -0,0 +1,446 @@
+#include "virtual_device.h"
+#include "metrics.h"
+#include <string.h>
+
+VirtualDevice::VirtualDevice(int index, const LoadConfig& config, EventLoop& loop, Metrics& metrics)
+    : config(config), loop(loop), metrics(metrics),
+      http(loop, metrics, config.server, config.hostHeader, this),
+      ws(loop, metrics, config.server, config.hostHeader, config.wsPath, this) {
+    this->index = index;
+    this->partner = nullptr;
+    this->initiator = (index % 2) == 0;
+    this->username = config.prefix + "_" + String(index);
+    this->userId = -1;
+    this->stage = STAGE_IDLE;
+    this->online = false;
+    this->friends = false;
+    this->connectStartUs = 0;
+    this->binaryWire = false;
+    this->batchFrames = false;
+    this->chatSeq = 0;
+    this->game = GAME_NONE;
+    this->sessionId = -1;
+    this->moveCount = 0;
+    this->moveInFlight = false;
+    this->moveSentUs = 0;
+    this->rng = 2463534242u ^ ((uint32_t)index * 2654435761u);
+
+    // Printable filler; the chat screen caps messages at 500 characters
+    for (uint32_t i = 0; i < config.chatBytes && i < 500; i++) {
+        chatText += (char)('a' + (i % 26));
+    }
+    memset(board, 0, sizeof(board));
+}
+
+void VirtualDevice::pairWith(VirtualDevice* partner) {
+    this->partner = partner;
+}
+
+uint32_t VirtualDevice::nextRandom() {
+    rng ^= rng << 13;
+    rng ^= rng >> 17;
+    rng ^= rng << 5;
+    return rng;
+}
+
+void VirtualDevice::start(uint64_t atUs) {
+    loop.schedule(atUs, this, TIMER_START);
+}
+
+void VirtualDevice::stop() {
+    if (online) metrics.devicesOnline--;
+    online = false;
+    stage = STAGE_STOPPED;
+    ws.close();
+    http.close();
+}
+
+void VirtualDevice::onTimer(int kind, uint64_t nowUs) {
+    (void)nowUs;
+    if (stage == STAGE_STOPPED || stage == STAGE_FAILED) return;
+
+    switch (kind) {
+        case TIMER_START:
+            stage = STAGE_LOGIN;
+            if (config.registerAccounts) {
+                http.post("/api/register", ApiProtocol::registerPayload(username, config.pin, username), REQ_REGISTER);
+            } else {
+                login();
+            }
+            break;
+        case TIMER_RECONNECT:
+            if (!ws.isOpen()) connectSocket();
+            break;
+        case TIMER_CHAT:
+            if (stage != STAGE_ACTIVE) break;
+            if (online) sendChatBurst();
+            loop.schedule(EventLoop::nowUs() + (uint64_t)config.chatIntervalMs * 1000, this, TIMER_CHAT);
+            break;
+        case TIMER_GAME:
+            if (stage == STAGE_ACTIVE && game == GAME_NONE) createGame();
+            break;
+        case TIMER_MOVE:
+            if (game == GAME_PLAYING && !moveInFlight) sendMove();
+            break;
+    }
+}
+
+// ---------------------------------------------------------------- REST
+
+void VirtualDevice::login() {
+    http.post("/api/login", ApiProtocol::loginPayload(username, config.pin), REQ_LOGIN);
+}
+
+void VirtualDevice::onHttpResponse(int tag, int code, const String& body, uint64_t latencyUs) {
+    if (stage == STAGE_STOPPED) return;
+    metrics.http.record(latencyUs);
+
+    switch (tag) {
+        case REQ_REGISTER:
+            // Already registered by an earlier run with the same prefix is fine: log in either way
+            if (code == 200 && !ApiProtocol::parseRegisterResponse(body)) metrics.httpErrors++;
+            login();
+            break;
+
+        case REQ_LOGIN: {
+            ApiProtocol::LoginResult result;
+            ApiProtocol::parseLoginResponse(body, result);
+            if (code != 200 || !result.success || result.user_id <= 0) {
+                if (code == 200) metrics.httpErrors++;
+                fprintf(stderr, "loadgen: %s login failed (HTTP %d): %s\n", username.c_str(), code, result.message.c_str());
+                stage = STAGE_FAILED;
+                break;
+            }
+            userId = result.user_id;
+            connectSocket();
+            break;
+        }
+
+        case REQ_FRIEND_REQUEST: {
+            ApiProtocol::FriendRequestResult result;
+            ApiProtocol::parseFriendRequestResponse(body, result);
+            if (result.success) break;      // Partner accepts when the notification arrives
+            if (result.message.indexOf("lready") >= 0) {
+                // "Already friends" from an earlier run with the same prefix
+                becomeFriends();
+                partner->becomeFriends();
+                break;
+            }
+            if (code == 200) metrics.httpErrors++;
+            fprintf(stderr, "loadgen: %s friend request failed (HTTP %d): %s\n", username.c_str(), code, result.message.c_str());
+            break;
+        }
+
+        case REQ_ACCEPT_FRIEND: {
+            ApiProtocol::FriendRequestResult result;
+            ApiProtocol::parseFriendRequestResponse(body, result);
+            if (code != 200 || !result.success) {
+                if (code == 200) metrics.httpErrors++;
+                break;
+            }
+            // The initiator would learn this from a friend_request_accepted
+            // notification; telling it directly keeps the pair in step
+            metrics.friendships++;
+            becomeFriends();
+            partner->becomeFriends();
+            break;
+        }
+
+        case REQ_CREATE_GAME: {
+            ApiProtocol::GameSessionResult result;
+            ApiProtocol::parseGameSessionResponse(body, result);
+            if (code != 200 || !result.success || result.sessionId <= 0) {
+                if (code == 200) metrics.httpErrors++;
+                game = GAME_NONE;
+                loop.schedule(EventLoop::nowUs() + (uint64_t)config.gamePauseMs * 1000, this, TIMER_GAME);
+                break;
+            }
+            // The guest's "respond" may already have started the game
+            if (game == GAME_CREATING) {
+                sessionId = result.sessionId;
+                game = GAME_WAITING;
+            }
+            break;
+        }
+
+        case REQ_RESPOND_INVITE: {
+            ApiProtocol::GameSessionResult result;
+            ApiProtocol::parseGameSessionResponse(body, result);
+            if (code != 200 || !result.success) {
+                if (code == 200) metrics.httpErrors++;
+                game = GAME_NONE;
+                break;
+            }
+            if (result.status == "in_progress" && game == GAME_WAITING) startGame();
+            break;
+        }
+
+        case REQ_LEAVE_GAME:
+            if (code == 200) {
+                ApiProtocol::GameSessionResult result;
+                ApiProtocol::parseGameSessionResponse(body, result);
+                if (!result.success) metrics.httpErrors++;
+            }
+            loop.schedule(EventLoop::nowUs() + (uint64_t)config.gamePauseMs * 1000, this, TIMER_GAME);
+            break;
+    }
+}
+
+// ---------------------------------------------------------------- WebSocket
+
+void VirtualDevice::connectSocket() {
+    stage = stage == STAGE_ACTIVE ? STAGE_ACTIVE : STAGE_CONNECTING;
+    connectStartUs = EventLoop::nowUs();
+    if (!ws.open()) {
+        loop.schedule(EventLoop::nowUs() + (uint64_t)config.reconnectMs * 1000, this, TIMER_RECONNECT);
+    }
+}
+
+void VirtualDevice::onWsOpen() {
+    // Same as SocketManager on WStype_CONNECTED: JSON until init_ack says otherwise
+    binaryWire = false;
+    batchFrames = false;
+    String init = SocketProtocol::initMessage(userId);
+    ws.sendText(init.c_str(), init.length());
+}
+
+void VirtualDevice::onWsClosed() {
+    if (online) {
+        online = false;
+        metrics.devicesOnline--;
+    }
+    if (stage == STAGE_STOPPED) return;
+    metrics.wsDropped++;
+    moveInFlight = false;
+    loop.schedule(EventLoop::nowUs() + (uint64_t)config.reconnectMs * 1000, this, TIMER_RECONNECT);
+}
+
+void VirtualDevice::onWsMessage(bool binary, uint8_t* payload, size_t length) {
+    bool parsed = binary ? WireCodec::decode(payload, length, rxJson, rxScratch, sizeof(rxScratch))
+                         : rxJson.parse(payload, length);
+    if (!parsed) {
+        metrics.unknownFrames++;
+        return;
+    }
+
+    switch (rxJson.getTypeHash()) {
+        case JsonTokenizer::hashOf("init_ack"):
+            SocketProtocol::readInitAck(rxJson, binaryWire, batchFrames);
+            becomeOnline();
+            return;
+        case JsonTokenizer::hashOf("pong"):
+            return;
+        case JsonTokenizer::hashOf("chat_error"):
+            handleChatError();
+            return;
+    }
+
+    SocketEvent event;
+    if (!SocketProtocol::decodeEvent(rxJson, event, rxDecoded)) {
+        metrics.unknownFrames++;
+        return;
+    }
+    handleEvent(event, rxDecoded);
+}
+
+void VirtualDevice::becomeOnline() {
+    if (!online) {
+        online = true;
+        metrics.devicesOnline++;
+    }
+    metrics.wsOpened++;
+    metrics.connect.record(EventLoop::nowUs() - connectStartUs);
+
+    if (stage == STAGE_CONNECTING) {
+        stage = STAGE_FRIENDING;
+        maybeSendFriendRequest();
+        if (partner != nullptr) partner->maybeSendFriendRequest();
+    }
+}
+
+// The notification only reaches a partner that's online, so the initiator
+// waits for both sockets
+void VirtualDevice::maybeSendFriendRequest() {
+    if (!initiator || partner == nullptr || friends) return;
+    if (stage != STAGE_FRIENDING || partner->stage != STAGE_FRIENDING) return;
+    if (!online || !partner->online) return;
+    http.post("/api/friend-requests/send", ApiProtocol::friendRequestPayload(userId, partner->username), REQ_FRIEND_REQUEST);
+}
+
+void VirtualDevice::becomeFriends() {
+    if (friends) return;
+    friends = true;
+    stage = STAGE_ACTIVE;
+    // Spread the bursts so the pair doesn't send in lockstep
+    uint64_t now = EventLoop::nowUs();
+    uint64_t jitter = (uint64_t)(nextRandom() % (config.chatIntervalMs + 1)) * 1000;
+    loop.schedule(now + jitter, this, TIMER_CHAT);
+    if (initiator) {
+        loop.schedule(now + (uint64_t)config.gamePauseMs * 1000, this, TIMER_GAME);
+    }
+}
+
+void VirtualDevice::handleEvent(const SocketEvent& event, const String* texts) {
+    const int32_t* v = event.values;
+    uint64_t now = EventLoop::nowUs();
+
+    switch (event.kind) {
+        case SocketEvent::NOTIFICATION:
+            if (!initiator && texts[0] == "friend_request" && !friends) {
+                http.post("/api/friend-requests/accept", ApiProtocol::notificationPayload(userId, v[0]), REQ_ACCEPT_FRIEND);
+            }
+            break;
+
+        case SocketEvent::CHAT_MESSAGE:
+            metrics.chatReceived++;
+            break;
+
+        case SocketEvent::DELIVERED: {
+            std::unordered_map<std::string, uint64_t>::iterator it = chatPending.find(std::string(texts[0].c_str()));
+            if (it == chatPending.end()) break;    // Duplicate ack
+            metrics.chatDelivered++;
+            metrics.chat.record(now - it->second);
+            chatPending.erase(it);
+            break;
+        }
+
+        case SocketEvent::GAME_EVENT:
+            if (texts[0] == "invite" && !initiator) {
+                sessionId = v[0];
+                game = GAME_WAITING;
+                http.post(ApiProtocol::gamePath(sessionId, "respond"), ApiProtocol::respondInvitePayload(userId, true), REQ_RESPOND_INVITE);
+            } else if (texts[0] == "respond" && initiator && texts[2] == "in_progress"
+                       && (game == GAME_CREATING || game == GAME_WAITING)) {
+                sessionId = v[0];
+                startGame();
+            } else if (texts[0] == "cancelled" && v[0] == sessionId && !initiator) {
+                game = GAME_NONE;
+            }
+            break;
+
+        case SocketEvent::GAME_MOVE: {
+            if (v[0] != sessionId || game != GAME_PLAYING) break;
+            int row = v[2];
+            int col = v[3];
+            if (row >= 0 && row < BOARD_ROWS && col >= 0 && col < BOARD_COLS) board[row][col] = 1;
+            moveCount++;
+            if (partner != nullptr && v[1] == partner->userId && partner->moveSentUs > 0) {
+                metrics.moveRelay.record(now - partner->moveSentUs);
+            }
+            if (texts[0].length() > 0 && texts[0] != "in_progress") {
+                endGame(false);      // completed or draw
+                break;
+            }
+            if (v[5] == userId) {
+                if (initiator && moveCount >= config.movesPerGame) {
+                    endGame(true);
+                } else {
+                    loop.schedule(now + (uint64_t)config.thinkMs * 1000, this, TIMER_MOVE);
+                }
+            }
+            break;
+        }
+
+        case SocketEvent::GAME_MOVE_ACK:
+            // One move in flight at a time; a successful ack carries the server's seq
+            if (!moveInFlight) break;
+            moveInFlight = false;
+            metrics.movesAcked++;
+            metrics.moveAck.record(now - moveSentUs);
+            if (!v[2]) {
+                metrics.movesRejected++;
+                // Lost a race for the cell (or the turn): pick again
+                if (game == GAME_PLAYING) loop.schedule(now + (uint64_t)config.thinkMs * 1000, this, TIMER_MOVE);
+            }
+            break;
+
+        default:
+            break;
+    }
+}
+
+void VirtualDevice::handleChatError() {
+    metrics.chatErrors++;
+    String messageId = rxJson.getString("message_id", 0);
+    chatPending.erase(std::string(messageId.c_str()));
+}
+
+// ---------------------------------------------------------------- Chat and games
+
+void VirtualDevice::sendChatBurst() {
+    OutboundMessage burst[16];
+    int count = (int)(config.chatBurst < 16 ? config.chatBurst : 16);
+    uint64_t now = EventLoop::nowUs();
+    for (int i = 0; i < count; i++) {
+        burst[i] = OutboundMessage(WireCodec::TYPE_CHAT_MESSAGE, partner->userId);
+        burst[i].id = "lg" + String(index) + "_" + String(++chatSeq);
+        burst[i].text = chatText;
+        chatPending[std::string(burst[i].id.c_str())] = now;
+    }
+    metrics.chatSent += count;
+    send(burst, count);
+}
+
+void VirtualDevice::createGame() {
+    game = GAME_CREATING;
+    sessionId = -1;
+    int guest = partner->userId;
+    http.post("/api/games/create", ApiProtocol::createGamePayload(userId, "caro", 2, &guest, 1), REQ_CREATE_GAME);
+}
+
+void VirtualDevice::startGame() {
+    game = GAME_PLAYING;
+    memset(board, 0, sizeof(board));
+    moveCount = 0;
+    moveInFlight = false;
+    moveSentUs = 0;
+    if (initiator) {
+        metrics.gamesStarted++;
+        // Host moves first
+        loop.schedule(EventLoop::nowUs() + (uint64_t)config.thinkMs * 1000, this, TIMER_MOVE);
+    }
+}
+
+void VirtualDevice::sendMove() {
+    // Random free cell: boards stay far from five in a row for short games
+    uint32_t cell = nextRandom() % (BOARD_ROWS * BOARD_COLS);
+    while (board[cell / BOARD_COLS][cell % BOARD_COLS]) {
+        cell = (cell + 1) % (BOARD_ROWS * BOARD_COLS);
+    }
+    OutboundMessage move(WireCodec::TYPE_GAME_MOVE, sessionId);
+    move.a = (int32_t)(cell / BOARD_COLS);
+    move.b = (int32_t)(cell % BOARD_COLS);
+    move.c = (int32_t)moveCount + 1;    // Next seq, as CaroGameScreen sends lastSeq + 1
+    moveInFlight = true;
+    moveSentUs = EventLoop::nowUs();
+    metrics.movesSent++;
+    send(&move, 1);
+}
+
+void VirtualDevice::endGame(bool leave) {
+    game = GAME_NONE;
+    if (!initiator) return;
+    metrics.gamesFinished++;
+    if (leave) {
+        http.post(ApiProtocol::gamePath(sessionId, "leave"), ApiProtocol::leavePayload(userId), REQ_LEAVE_GAME);
+    } else {
+        loop.schedule(EventLoop::nowUs() + (uint64_t)config.gamePauseMs * 1000, this, TIMER_GAME);
+    }
+}
+
+// ---------------------------------------------------------------- Framing
+
+void VirtualDevice::send(const OutboundMessage* messages, int count) {
+    unsigned long nowMs = (unsigned long)(EventLoop::nowUs() / 1000);
+    framer.write(messages, count, binaryWire, batchFrames, nowMs, *this);
+}
+
+bool VirtualDevice::writeFrame(const uint8_t* data, size_t length, int messages) {
+    (void)messages;
+    return ws.sendBinary(data, length);
+}
+
+bool VirtualDevice::writeFrame(String& text, int messages) {
+    (void)messages;
+    return ws.sendText(text.c_str(), text.length());
+}
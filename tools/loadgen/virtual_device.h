@@ -0,0 +1,116 @@
+#ifndef LOADGEN_VIRTUAL_DEVICE_H
+#define LOADGEN_VIRTUAL_DEVICE_H
+
+#include <Arduino.h>
+#include <unordered_map>
+#include <string>
+#include "connection.h"
+#include "json_tokenizer.h"
+#include "socket_protocol.h"
+#include "api_protocol.h"
+
+struct Metrics;
+
+struct LoadConfig {
+    struct sockaddr_in server;
+    String hostHeader;              // "host:port"
+    String wsPath;
+    String prefix;                  // Usernames are <prefix>_<index>
+    String pin;
+    bool registerAccounts;
+    uint32_t chatIntervalMs;        // Per device, between bursts
+    uint32_t chatBurst;             // Messages queued in one tick (one frame when batching)
+    uint32_t chatBytes;
+    uint32_t movesPerGame;          // Both players together; the host leaves after this many
+    uint32_t thinkMs;               // Delay before answering a move
+    uint32_t gamePauseMs;           // Between a game ending and the next invite
+    uint32_t reconnectMs;
+};
+
+// One simulated handset. Devices come in pairs: the even one (initiator)
+// sends the friend request and hosts the caro games, the odd one accepts.
+//
+// Flow per device: register (optional) -> login -> WebSocket + init ->
+// friend request / accept -> chat bursts both ways and games back to back
+// until the run ends. Everything on the wire goes through ApiProtocol and
+// SocketProtocol/SocketFramer, the code the firmware itself runs.
+class VirtualDevice : public HttpListener, public WsListener, public EventLoop::TimerTarget, private SocketFrameSink {
+public:
+    VirtualDevice(int index, const LoadConfig& config, EventLoop& loop, Metrics& metrics);
+
+    void pairWith(VirtualDevice* partner);
+    void start(uint64_t atUs);
+    void stop();
+
+    bool isOnline() const { return online; }
+
+    void onHttpResponse(int tag, int code, const String& body, uint64_t latencyUs) override;
+    void onWsOpen() override;
+    void onWsMessage(bool binary, uint8_t* payload, size_t length) override;
+    void onWsClosed() override;
+    void onTimer(int kind, uint64_t nowUs) override;
+
+private:
+    enum RequestTag { REQ_REGISTER, REQ_LOGIN, REQ_FRIEND_REQUEST, REQ_ACCEPT_FRIEND, REQ_CREATE_GAME, REQ_RESPOND_INVITE, REQ_LEAVE_GAME };
+    enum TimerKind { TIMER_START, TIMER_RECONNECT, TIMER_CHAT, TIMER_GAME, TIMER_MOVE };
+    enum Stage { STAGE_IDLE, STAGE_LOGIN, STAGE_CONNECTING, STAGE_FRIENDING, STAGE_ACTIVE, STAGE_FAILED, STAGE_STOPPED };
+    enum GameState { GAME_NONE, GAME_CREATING, GAME_WAITING, GAME_PLAYING };
+
+    static const int BOARD_ROWS = 15;
+    static const int BOARD_COLS = 20;
+
+    int index;
+    const LoadConfig& config;
+    EventLoop& loop;
+    Metrics& metrics;
+    VirtualDevice* partner;
+    bool initiator;
+
+    String username;
+    int userId;
+    Stage stage;
+    bool online;                    // init_ack received on the current socket
+    bool friends;
+
+    HttpConnection http;
+    WsConnection ws;
+    uint64_t connectStartUs;
+    bool binaryWire;
+    bool batchFrames;
+    JsonTokenizer rxJson;
+    char rxScratch[WireCodec::SCRATCH_SIZE];
+    String rxDecoded[SocketEvent::MAX_TEXTS];
+    SocketFramer framer;
+
+    uint32_t chatSeq;
+    String chatText;
+    std::unordered_map<std::string, uint64_t> chatPending;     // message_id -> queued at
+
+    GameState game;
+    int sessionId;
+    uint8_t board[BOARD_ROWS][BOARD_COLS];
+    uint32_t moveCount;
+    bool moveInFlight;
+    uint64_t moveSentUs;
+    uint32_t rng;                   // xorshift32 state for move cells
+
+    void login();
+    void connectSocket();
+    void becomeOnline();
+    void maybeSendFriendRequest();
+    void becomeFriends();
+    void sendChatBurst();
+    void createGame();
+    void startGame();
+    void sendMove();
+    void endGame(bool leave);
+    void handleEvent(const SocketEvent& event, const String* texts);
+    void handleChatError();
+    void send(const OutboundMessage* messages, int count);
+    uint32_t nextRandom();
+
+    bool writeFrame(const uint8_t* data, size_t length, int messages) override;
+    bool writeFrame(String& text, int messages) override;
+};
+
+#endif
@@ -0,0 +1,446 @@
+// Two BilliardLockstep clients playing each other through the real socket
+// protocol, with the server relay simulated in between.
+//
+// Each client renders at its own jittery frame rate and calls advance() with
+// whatever time passed, like BilliardGame::update(). Every message takes the
+// same path as on the device:
+//   OutboundMessage -> SocketProtocol::encodeWire / appendJson   (client -> server)
+//   -> what websocket.py + relay_billiard send on: a game_event frame, tlv1 or
+//      json.dumps() style JSON                                     (server -> opponent)
+//   -> WireCodec::decode / JsonTokenizer::parse -> SocketProtocol::decodeEvent
+// with 30-150 ms of latency per leg (in order, like a TCP stream).
+//
+// The shooter aims with BilliardShotPredictor::findBestShot plus some random
+// shots (to get scratches and re-racks). After every shot both clients log
+// the hash of their settled table; the run fails if any seq has two different
+// hashes or a desync was flagged. --inject N nudges one ball on one client by
+// 1/65536 px every N shots to exercise detection and the snapshot resync.
+//
+//   pio run -e lockstep
+//   .pio/build/lockstep/program --shots 1000 --json
+//
+// Add -DSIM_FIXED_POINT to build_flags (see [env:lockstep]) for the
+// fixed-point physics the devices should run.
+
+#include <Arduino.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <deque>
+#include <map>
+#include <vector>
+#include "billiard_physics.h"
+#include "billiard_predictor.h"
+#include "billiard_lockstep.h"
+#include "socket_protocol.h"
+
+static const int SESSION_ID = 42;
+static const int USER_IDS[2] = { 101, 202 };
+static const int SEARCH_STEPS = 72;
+static const int RANDOM_SHOT_PERCENT = 20;
+static const uint64_t MAX_SIM_MS = 24ull * 3600 * 1000;  // Give up after a simulated day
+static const int STREAM_BYTES_PER_TICK = 2 + BALL_COUNT * 4;  // Frame header + int16 x/y per ball
+
+struct Options {
+    int shots;
+    int inject;
+    bool json;
+    unsigned long seed;
+};
+
+static uint32_t rngState = 1;
+
+static uint32_t nextRandom() {
+    rngState ^= rngState << 13;
+    rngState ^= rngState >> 17;
+    rngState ^= rngState << 5;
+    return rngState;
+}
+
+static int randomInt(int lo, int hi) {
+    return lo + (int)(nextRandom() % (uint32_t)(hi - lo + 1));
+}
+
+static float randomRange(float lo, float hi) {
+    return lo + (hi - lo) * (nextRandom() >> 8) * (1.0f / 16777216.0f);
+}
+
+struct Frame {
+    uint64_t deliverAt;
+    bool binary;
+    std::vector<uint8_t> bytes;
+};
+
+struct Traffic {
+    uint32_t messages;
+    uint64_t wireUp, wireDown;  // tlv1 payload bytes
+    uint64_t jsonUp, jsonDown;  // JSON text bytes
+};
+
+struct Client {
+    int player;
+    BilliardPhysics physics;
+    BilliardLockstep lockstep;
+    std::deque<Frame> inbox;
+    uint64_t lastInboxAt;
+    uint64_t nextFrameAt;
+    uint64_t lastFrameAt;
+    uint64_t shootAt;          // Think time: shoot once canShoot() and this has passed
+    uint16_t loggedSeq;
+    int minFrameMs, maxFrameMs;
+    JsonTokenizer rxJson;
+    char rxScratch[WireCodec::SCRATCH_SIZE];
+    String rxTexts[SocketEvent::MAX_TEXTS];
+
+    explicit Client(int player) : player(player), lockstep(physics) {}
+};
+
+static Options options;
+static uint64_t nowMs = 0;
+static Traffic shotTraffic = {0, 0, 0, 0, 0};
+static Traffic syncTraffic = {0, 0, 0, 0, 0};
+static std::map<uint16_t, uint32_t> settledHash[2];
+static int injected = 0;
+
+static int latencyMs() {
+    return randomInt(30, 150);
+}
+
+// What relay_billiard() hands to send_game_event(): the client's fields, then
+// session_id and user_id. json.dumps() puts ", " and ": " between them.
+static void relayJson(const JsonTokenizer& in, int fromUser, String& out) {
+    static const char* const INT_KEYS[] = { "seq", "tick", "angle", "power", "hash" };
+    out = "{\"type\": \"game_event\", \"event\": {\"event_type\": \"";
+    out += in.getString("type", 0);
+    out += "\"";
+    for (size_t k = 0; k < sizeof(INT_KEYS) / sizeof(INT_KEYS[0]); k++) {
+        if (!in.has(INT_KEYS[k], 0)) continue;
+        out += ", \"";
+        out += INT_KEYS[k];
+        out += "\": ";
+        out += String(in.getInt(INT_KEYS[k], 0, 0));
+    }
+    if (in.has("snapshot", 0)) {
+        out += ", \"snapshot\": \"";
+        out += in.getString("snapshot", 0);
+        out += "\"";
+    }
+    out += ", \"session_id\": ";
+    out += String(in.getInt("session_id", 0, 0));
+    out += ", \"user_id\": ";
+    out += String(fromUser);
+    out += "}}";
+}
+
+static size_t relayWire(const JsonTokenizer& in, int fromUser, uint8_t* buffer, size_t capacity) {
+    static const char* const INT_KEYS[] = { "seq", "tick", "angle", "power", "hash" };
+    static const uint8_t INT_TAGS[] = {
+        WireCodec::KEY_SEQ, WireCodec::KEY_TICK, WireCodec::KEY_ANGLE, WireCodec::KEY_POWER, WireCodec::KEY_HASH
+    };
+    WireWriter out(buffer, capacity, WireCodec::TYPE_GAME_EVENT);
+    out.putString(WireCodec::KEY_EVENT_TYPE, in.getString("type", 0));
+    for (size_t k = 0; k < sizeof(INT_KEYS) / sizeof(INT_KEYS[0]); k++) {
+        if (in.has(INT_KEYS[k], 0)) out.putInt(INT_TAGS[k], in.getInt(INT_KEYS[k], 0, 0));
+    }
+    if (in.has("snapshot", 0)) out.putString(WireCodec::KEY_SNAPSHOT, in.getString("snapshot", 0));
+    out.putInt(WireCodec::KEY_SESSION_ID, in.getInt("session_id", 0, 0));
+    out.putInt(WireCodec::KEY_USER_ID, fromUser);
+    return out.ok() ? out.length() : 0;
+}
+
+// Client -> server -> opponent. Both encodings are built for the byte count;
+// the one selected with --json travels.
+static bool send(Client& from, Client& to, const OutboundMessage& message) {
+    uint8_t up[SOCKET_TX_FRAME_SIZE];
+    WireWriter upWire(up, sizeof(up), message.type);
+    if (!SocketProtocol::encodeWire(message, (unsigned long)nowMs, upWire)) {
+        return false;
+    }
+    String upJson;
+    SocketProtocol::appendJson(message, (unsigned long)nowMs, upJson);
+
+    // Server side: decode what arrived, relay it as a game_event
+    JsonTokenizer serverJson;
+    char serverScratch[WireCodec::SCRATCH_SIZE];
+    bool parsed = options.json ? serverJson.parse((const uint8_t*)upJson.c_str(), upJson.length())
+                               : WireCodec::decode(upWire.data(), upWire.length(), serverJson, serverScratch, sizeof(serverScratch));
+    if (!parsed) {
+        return false;
+    }
+    uint8_t down[SOCKET_TX_FRAME_SIZE];
+    size_t downLength = relayWire(serverJson, USER_IDS[from.player], down, sizeof(down));
+    String downJson;
+    relayJson(serverJson, USER_IDS[from.player], downJson);
+    if (downLength == 0) {
+        return false;
+    }
+
+    Traffic& traffic = message.type == WireCodec::TYPE_BILLIARD_SHOT ? shotTraffic : syncTraffic;
+    traffic.messages++;
+    traffic.wireUp += upWire.length();
+    traffic.wireDown += downLength;
+    traffic.jsonUp += upJson.length();
+    traffic.jsonDown += downJson.length();
+
+    Frame frame;
+    frame.deliverAt = nowMs + latencyMs() + latencyMs();
+    if (frame.deliverAt < to.lastInboxAt) {
+        frame.deliverAt = to.lastInboxAt;  // One TCP stream per leg: no overtaking
+    }
+    to.lastInboxAt = frame.deliverAt;
+    frame.binary = !options.json;
+    if (options.json) {
+        frame.bytes.assign(downJson.c_str(), downJson.c_str() + downJson.length());
+    } else {
+        frame.bytes.assign(down, down + downLength);
+    }
+    to.inbox.push_back(frame);
+    return true;
+}
+
+// Same as BilliardGame::onBilliardShotReceived / onBilliardSyncReceived
+static void receive(Client& client, const Frame& frame) {
+    bool parsed = frame.binary
+        ? WireCodec::decode(frame.bytes.data(), frame.bytes.size(), client.rxJson, client.rxScratch, sizeof(client.rxScratch))
+        : client.rxJson.parse(frame.bytes.data(), frame.bytes.size());
+    SocketEvent event;
+    if (!parsed || !SocketProtocol::decodeEvent(client.rxJson, event, client.rxTexts)) {
+        fprintf(stderr, "player %d: frame did not decode\n", client.player);
+        exit(1);
+    }
+    if (event.kind == SocketEvent::BILLIARD_SHOT) {
+        BilliardLockstep::Shot shot;
+        shot.seq = (uint16_t)event.values[2];
+        shot.tick = (uint32_t)event.values[3];
+        shot.angle = event.values[4];
+        shot.power = (uint16_t)event.values[5];
+        shot.hash = (uint32_t)event.values[6];
+        client.lockstep.receive(shot);
+    } else if (event.kind == SocketEvent::BILLIARD_SYNC) {
+        if (client.rxTexts[0].length() == 0) {
+            client.lockstep.requestSnapshot();
+        } else {
+            client.lockstep.readSnapshotText(client.rxTexts[0]);
+        }
+    } else {
+        fprintf(stderr, "player %d: unexpected event kind %d\n", client.player, event.kind);
+        exit(1);
+    }
+}
+
+static void chooseShot(Client& client, float& angle, float& power) {
+    power = randomRange(25.0f, 100.0f);
+    if (randomInt(1, 100) <= RANDOM_SHOT_PERCENT) {
+        angle = randomRange(0.0f, 6.28318531f);
+        return;
+    }
+    BilliardShotPredictor::Prediction best;
+    BilliardShotPredictor::findBestShot(client.physics.getBalls(), 0, power, SEARCH_STEPS, best);
+    angle = best.angle;
+}
+
+// Flip the lowest bit of one ball's x: the smallest desync there is
+static void injectDesync(Client& client) {
+    Ball* balls = client.physics.getBalls();
+    for (int i = BALL_COUNT - 1; i >= 0; i--) {
+        if (balls[i].x < 0) continue;
+#ifdef SIM_FIXED_POINT
+        balls[i].x = Fixed16::fromRaw(balls[i].x.getRaw() ^ 1);
+#else
+        balls[i].x = nextafterf(balls[i].x, 1e9f);
+#endif
+        injected++;
+        return;
+    }
+}
+
+static void runFrame(Client& self, Client& other, int& shotsTaken) {
+    while (!self.inbox.empty() && self.inbox.front().deliverAt <= nowMs) {
+        Frame next = self.inbox.front();
+        self.inbox.pop_front();
+        receive(self, next);
+    }
+
+    self.lockstep.advance((uint32_t)(nowMs - self.lastFrameAt));
+    self.lastFrameAt = nowMs;
+
+    switch (self.lockstep.pollOutgoing()) {
+        case BilliardLockstep::OUTGOING_SYNC_REQUEST: {
+            OutboundMessage request(WireCodec::TYPE_BILLIARD_SYNC, SESSION_ID);
+            request.a = self.lockstep.getSeq();
+            send(self, other, request);
+            break;
+        }
+        case BilliardLockstep::OUTGOING_SNAPSHOT: {
+            OutboundMessage snapshot(WireCodec::TYPE_BILLIARD_SYNC, SESSION_ID);
+            snapshot.a = self.lockstep.getSeq();
+            snapshot.text = self.lockstep.writeSnapshotText();
+            send(self, other, snapshot);
+            break;
+        }
+        default:
+            break;
+    }
+
+    if (self.lockstep.isSettled() && self.lockstep.getSeq() != self.loggedSeq) {
+        self.loggedSeq = self.lockstep.getSeq();
+        settledHash[self.player][self.loggedSeq] = self.lockstep.stateHash();
+        if (options.inject > 0 && self.loggedSeq % options.inject == 0 && (self.loggedSeq / options.inject) % 2 == (uint16_t)self.player) {
+            injectDesync(self);  // Alternate between the host and the guest
+        }
+    }
+
+    if (shotsTaken < options.shots && self.lockstep.canShoot()) {
+        if (self.shootAt == 0) {
+            self.shootAt = nowMs + randomInt(200, 1500);
+        } else if (nowMs >= self.shootAt) {
+            float angle, power;
+            chooseShot(self, angle, power);
+            BilliardLockstep::Shot shot;
+            if (self.lockstep.shoot(angle, power, shot)) {
+                OutboundMessage message(WireCodec::TYPE_BILLIARD_SHOT, SESSION_ID);
+                message.a = shot.seq;
+                message.b = (int32_t)shot.tick;
+                message.c = shot.angle;
+                message.d = shot.power;
+                message.e = (int32_t)shot.hash;
+                send(self, other, message);
+                shotsTaken++;
+            }
+            self.shootAt = 0;
+        }
+    }
+
+    self.nextFrameAt = nowMs + randomInt(self.minFrameMs, self.maxFrameMs);
+}
+
+static void usage(const char* program) {
+    fprintf(stderr,
+            "Usage: %s [options]\n"
+            "  --shots N     shots to play (default 1000)\n"
+            "  --inject N    corrupt one client's table every N shots (default 0 = never)\n"
+            "  --json        deliver JSON frames instead of tlv1 (bytes are counted for both)\n"
+            "  --seed N      (default 1)\n",
+            program);
+}
+
+static bool parseOptions(int argc, char** argv) {
+    options.shots = 1000;
+    options.inject = 0;
+    options.json = false;
+    options.seed = 1;
+    for (int i = 1; i < argc; i++) {
+        const char* arg = argv[i];
+        if (strcmp(arg, "--json") == 0) {
+            options.json = true;
+            continue;
+        }
+        const char* value = i + 1 < argc ? argv[i + 1] : nullptr;
+        if (strcmp(arg, "--help") == 0 || value == nullptr) {
+            return false;
+        }
+        i++;
+        if (strcmp(arg, "--shots") == 0) options.shots = atoi(value);
+        else if (strcmp(arg, "--inject") == 0) options.inject = atoi(value);
+        else if (strcmp(arg, "--seed") == 0) options.seed = strtoul(value, nullptr, 10);
+        else return false;
+    }
+    return options.shots > 0 && options.inject >= 0;
+}
+
+int main(int argc, char** argv) {
+    if (!parseOptions(argc, argv)) {
+        usage(argv[0]);
+        return 2;
+    }
+    rngState = options.seed != 0 ? (uint32_t)options.seed : 1;
+
+    Client host(0);
+    Client guest(1);
+    host.lockstep.start(0);
+    guest.lockstep.start(1);
+    Client* clients[2] = { &host, &guest };
+    // Different, jittery frame rates: ~40 fps vs ~20 fps
+    host.minFrameMs = 15;
+    host.maxFrameMs = 35;
+    guest.minFrameMs = 30;
+    guest.maxFrameMs = 70;
+    for (int p = 0; p < 2; p++) {
+        clients[p]->lastInboxAt = 0;
+        clients[p]->lastFrameAt = 0;
+        clients[p]->nextFrameAt = (uint64_t)p * 7;
+        clients[p]->shootAt = 0;
+        clients[p]->loggedSeq = 0;
+    }
+
+    struct timespec start;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    int shotsTaken = 0;
+    while (nowMs < MAX_SIM_MS) {
+        bool done = shotsTaken >= options.shots;
+        for (int p = 0; p < 2 && done; p++) {
+            Client& c = *clients[p];
+            done = c.inbox.empty() && c.lockstep.isSettled() && !c.lockstep.isWaitingForSync() &&
+                   c.lockstep.getSeq() == host.lockstep.getSeq();
+        }
+        if (done) break;
+
+        nowMs = host.nextFrameAt < guest.nextFrameAt ? host.nextFrameAt : guest.nextFrameAt;
+        if (host.nextFrameAt == nowMs) runFrame(host, guest, shotsTaken);
+        if (guest.nextFrameAt == nowMs) runFrame(guest, host, shotsTaken);
+    }
+    struct timespec end;
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    double wallSeconds = (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) * 1e-9;
+
+    // Every seq both clients settled on must have produced the same table
+    int compared = 0;
+    int divergent = 0;
+    for (std::map<uint16_t, uint32_t>::const_iterator it = settledHash[0].begin(); it != settledHash[0].end(); ++it) {
+        std::map<uint16_t, uint32_t>::const_iterator other = settledHash[1].find(it->first);
+        if (other == settledHash[1].end()) continue;
+        compared++;
+        if (other->second != it->second) divergent++;
+    }
+    bool finalMatch = host.lockstep.stateHash() == guest.lockstep.stateHash();
+    uint32_t flagged = host.lockstep.getDesyncCount() + guest.lockstep.getDesyncCount();
+
+#ifdef SIM_FIXED_POINT
+    const char* numbers = "fixed point";
+#else
+    const char* numbers = "float";
+#endif
+    double ticksPerShot = (double)host.lockstep.getTick() / shotsTaken;
+    printf("%d shots (%s, %s frames), %.0f s of play in %.2f s, %u ticks (%.1f per shot)\n",
+           shotsTaken, numbers, options.json ? "json" : "tlv1", nowMs / 1000.0, wallSeconds,
+           (unsigned)host.lockstep.getTick(), ticksPerShot);
+    printf("settled tables: %d seqs compared, %d diverged, final hash %s (%08x)\n",
+           compared, divergent, finalMatch ? "match" : "MISMATCH", (unsigned)host.lockstep.stateHash());
+    printf("desyncs: %d injected, %u flagged, %u snapshots adopted\n",
+           injected, (unsigned)flagged, (unsigned)guest.lockstep.getSnapshotsAdopted());
+
+    uint32_t n = shotTraffic.messages > 0 ? shotTraffic.messages : 1;
+    printf("\nbytes per shot (payload, before WebSocket framing):\n");
+    printf("  tlv1   %5.1f up + %5.1f relayed = %5.1f\n",
+           (double)shotTraffic.wireUp / n, (double)shotTraffic.wireDown / n,
+           (double)(shotTraffic.wireUp + shotTraffic.wireDown) / n);
+    printf("  json   %5.1f up + %5.1f relayed = %5.1f\n",
+           (double)shotTraffic.jsonUp / n, (double)shotTraffic.jsonDown / n,
+           (double)(shotTraffic.jsonUp + shotTraffic.jsonDown) / n);
+    if (syncTraffic.messages > 0) {
+        printf("  sync   %u messages, %.1f bytes each (tlv1 up + relayed), %.1f json\n",
+               (unsigned)syncTraffic.messages,
+               (double)(syncTraffic.wireUp + syncTraffic.wireDown) / syncTraffic.messages,
+               (double)(syncTraffic.jsonUp + syncTraffic.jsonDown) / syncTraffic.messages);
+    }
+    double streamPerShot = ticksPerShot * STREAM_BYTES_PER_TICK * 2;
+    printf("  streaming int16 positions every tick instead: %.0f bytes per shot (%d per tick, %d B/s while balls move)\n",
+           streamPerShot, STREAM_BYTES_PER_TICK * 2, STREAM_BYTES_PER_TICK * 2 * 1000 / (int)BilliardPhysics::TICK_MS);
+
+    bool ok = shotsTaken == options.shots && finalMatch &&
+              (options.inject > 0 || (divergent == 0 && flagged == 0));
+    printf("\n%s\n", ok ? "OK" : "FAILED");
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,800 @@
+// Caro move-to-render latency and bytes per move: moves over the WebSocket
+// (game_move / game_move_ack, CaroGameScreen since the push rework) vs the
+// HTTP path it replaced, against an in-process stand-in of the server.
+//
+// The stand-in speaks what server/app/api does for one caro session:
+//   POST /api/games/<id>/move    apply_move(), answer + game_event push
+//   GET  /api/games/<id>/state   the 15x20 board as JSON, like uvicorn sends it
+//   /ws  init -> init_ack (tlv1 unless --json), game_move -> game_move_ack to
+//        the mover + game_event "move" to both players
+// with --server-ms of work per move or state read (the database).
+//
+// Two devices (host and guest, one thread each) play --moves moves, each
+// thinking --think ms (+-50%) before its move. The firmware code does the talking:
+// ApiClient + the pooled HTTPClient for HTTP, SocketProtocol/SocketFramer
+// over the host WebSocketsClient for the socket.
+//   socket      move over the socket, rendered on the ack; the opponent
+//               renders on the push
+//   http+push   blocking POST, rendered on the answer; the opponent renders
+//               on the push; both poll the state every 3 s (before the rework)
+//   http poll   socket down: POST + the 3 s state poll only (the fallback)
+//
+// Per mode it prints mover and opponent move-to-render times (submit ->
+// applied, p50/p99/max) and the bytes per move the server saw: HTTP with
+// headers, WebSocket frames with their headers. TCP/IP and WiFi overhead
+// are not counted.
+//
+// Checks that every mode delivers every move to both players exactly once.
+// Exits non-zero if a check fails.
+//
+//   pio run -e movebench
+//   .pio/build/movebench/program [--moves 20] [--think 500] [--server-ms 5] [--json]
+#include <Arduino.h>
+#include <WiFi.h>
+#include <WebSocketsClient.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <time.h>
+#include <unistd.h>
+#include <algorithm>
+#include <atomic>
+#include <map>
+#include <mutex>
+#include <string>
+#include <vector>
+#include "api_client.h"
+#include "socket_protocol.h"
+#include "hal_native.h"
+
+// ---- What hal_native.cpp provides to the app (real clock) ----
+
+unsigned long micros() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (unsigned long)(ts.tv_sec * 1000000ULL + ts.tv_nsec / 1000);
+}
+
+unsigned long millis() {
+    return micros() / 1000;
+}
+
+void delay(uint32_t ms) {
+    usleep(ms * 1000);
+}
+
+long random(long howbig) {
+    return howbig > 0 ? rand() % howbig : 0;
+}
+
+EspClass ESP;
+
+uint32_t EspClass::getFreeHeap() {
+    return 200 * 1024;
+}
+
+static HalNative::Network hostNet = {"HostNet", "", -50};
+
+namespace HalNative {
+int networkCount() { return 1; }
+const Network& network(int index) { (void)index; return hostNet; }
+String resolveHost(const String& host) { return host; }
+}
+
+// ---- Stand-in server ----
+
+static const int SESSION_ID = 3;
+static const int HOST_ID = 7;
+static const int GUEST_ID = 9;
+static const int MAX_MOVES = 300;
+
+enum Traffic { TRAFFIC_MOVE_HTTP, TRAFFIC_POLL_HTTP, TRAFFIC_SOCKET, TRAFFIC_COUNT };
+
+struct Server {
+    std::mutex lock;
+    int board[15][20];
+    int moveCount;
+    int currentTurn;
+    int rejected;
+    int serverMs;
+    bool acceptWire;
+    std::map<int, int> sockets;     // userId -> fd
+    std::mutex sendLock;
+    std::atomic<bool> counting;
+    std::atomic<uint64_t> bytes[TRAFFIC_COUNT];
+    std::atomic<uint32_t> messages[TRAFFIC_COUNT];
+
+    void reset() {
+        std::lock_guard<std::mutex> guard(lock);
+        memset(board, 0, sizeof(board));
+        moveCount = 0;
+        currentTurn = HOST_ID;
+        rejected = 0;
+        for (int i = 0; i < TRAFFIC_COUNT; i++) {
+            bytes[i] = 0;
+            messages[i] = 0;
+        }
+    }
+
+    void count(Traffic traffic, size_t length, bool message) {
+        if (!counting) return;
+        bytes[traffic] += length;
+        if (message) messages[traffic]++;
+    }
+};
+
+static Server server;
+
+static bool sendAll(int fd, const void* data, size_t length) {
+    const uint8_t* p = (const uint8_t*)data;
+    while (length > 0) {
+        ssize_t n = send(fd, p, length, MSG_NOSIGNAL);
+        if (n <= 0) return false;
+        p += n;
+        length -= n;
+    }
+    return true;
+}
+
+// Unmasked server frame, text or binary
+static void sendWsFrame(int fd, bool binary, const uint8_t* payload, size_t length) {
+    uint8_t header[4];
+    size_t headerLength = 2;
+    header[0] = 0x80 | (binary ? 0x2 : 0x1);
+    if (length < 126) {
+        header[1] = (uint8_t)length;
+    } else {
+        header[1] = 126;
+        header[2] = (uint8_t)(length >> 8);
+        header[3] = (uint8_t)length;
+        headerLength = 4;
+    }
+    std::string frame((const char*)header, headerLength);
+    frame.append((const char*)payload, length);
+    std::lock_guard<std::mutex> guard(server.sendLock);
+    server.count(TRAFFIC_SOCKET, frame.size(), true);
+    sendAll(fd, frame.data(), frame.size());
+}
+
+// One move result in the form the server sends it
+struct MoveOutcome {
+    bool success;
+    String message;
+    int seq;
+    int currentTurn;
+};
+
+static void sendMoveEvent(int userId, int row, int col, const MoveOutcome& outcome) {
+    uint8_t wireFrame[96];
+    WireWriter wire(wireFrame, sizeof(wireFrame), WireCodec::TYPE_GAME_EVENT);
+    wire.putString(WireCodec::KEY_EVENT_TYPE, "move", 4);
+    wire.putInt(WireCodec::KEY_SESSION_ID, SESSION_ID);
+    wire.putInt(WireCodec::KEY_SEQ, outcome.seq);
+    wire.putInt(WireCodec::KEY_USER_ID, userId);
+    wire.putInt(WireCodec::KEY_ROW, row);
+    wire.putInt(WireCodec::KEY_COL, col);
+    wire.putString(WireCodec::KEY_GAME_STATUS, "playing", 7);
+    wire.putInt(WireCodec::KEY_CURRENT_TURN, outcome.currentTurn);
+    // json.dumps(), default separators
+    char json[256];
+    int jsonLength = snprintf(json, sizeof(json),
+                              "{\"type\": \"game_event\", \"event\": {\"event_type\": \"move\", \"session_id\": %d, "
+                              "\"seq\": %d, \"user_id\": %d, \"row\": %d, \"col\": %d, \"game_status\": \"playing\", "
+                              "\"winner_id\": null, \"current_turn\": %d}}",
+                              SESSION_ID, outcome.seq, userId, row, col, outcome.currentTurn);
+
+    std::map<int, int> sockets;
+    {
+        std::lock_guard<std::mutex> guard(server.lock);
+        sockets = server.sockets;
+    }
+    for (std::map<int, int>::iterator it = sockets.begin(); it != sockets.end(); ++it) {
+        if (server.acceptWire) {
+            sendWsFrame(it->second, true, wire.data(), wire.length());
+        } else {
+            sendWsFrame(it->second, false, (const uint8_t*)json, jsonLength);
+        }
+    }
+}
+
+// games.apply_move(): validate, store, push to both players
+static MoveOutcome applyMove(int userId, int row, int col) {
+    usleep(server.serverMs * 1000);
+    MoveOutcome outcome;
+    {
+        std::lock_guard<std::mutex> guard(server.lock);
+        outcome.seq = server.moveCount + 1;
+        outcome.currentTurn = server.currentTurn;
+        if (row < 0 || row >= 15 || col < 0 || col >= 20 || server.board[row][col] != 0) {
+            outcome.success = false;
+            outcome.message = "Cell already occupied";
+        } else if (userId != server.currentTurn) {
+            outcome.success = false;
+            outcome.message = "Not your turn";
+        } else {
+            server.board[row][col] = userId;
+            server.moveCount++;
+            server.currentTurn = userId == HOST_ID ? GUEST_ID : HOST_ID;
+            outcome.success = true;
+            outcome.message = "Move submitted successfully";
+            outcome.currentTurn = server.currentTurn;
+        }
+        if (!outcome.success) server.rejected++;
+    }
+    if (outcome.success) sendMoveEvent(userId, row, col, outcome);
+    return outcome;
+}
+
+static std::string stateJson() {
+    usleep(server.serverMs * 1000);
+    std::lock_guard<std::mutex> guard(server.lock);
+    // Starlette's JSONResponse: compact separators
+    std::string body = "{\"success\":true,\"session_id\":" + std::to_string(SESSION_ID) +
+                       ",\"game_type\":\"caro\",\"status\":\"playing\",\"board\":[";
+    for (int r = 0; r < 15; r++) {
+        body += r > 0 ? ",[" : "[";
+        for (int c = 0; c < 20; c++) {
+            if (c > 0) body += ",";
+            body += server.board[r][c] != 0 ? std::to_string(server.board[r][c]) : "null";
+        }
+        body += "]";
+    }
+    body += "],\"current_turn\":" + std::to_string(server.currentTurn) +
+            ",\"move_count\":" + std::to_string(server.moveCount) +
+            ",\"players\":{\"host\":{\"user_id\":7,\"name\":\"Host\"},\"guest\":{\"user_id\":9,\"name\":\"Guest\"}}}";
+    return body;
+}
+
+static void sendHttp(int fd, Traffic traffic, const std::string& body) {
+    std::string response = "HTTP/1.1 200 OK\r\ndate: Sat, 17 Oct 2026 01:00:00 GMT\r\nserver: uvicorn\r\n"
+                           "content-length: " + std::to_string(body.size()) +
+                           "\r\ncontent-type: application/json\r\n\r\n" + body;
+    server.count(traffic, response.size(), false);
+    sendAll(fd, response.data(), response.size());
+}
+
+static void dropSocket(int userId, int fd) {
+    {
+        std::lock_guard<std::mutex> guard(server.lock);
+        std::map<int, int>::iterator it = server.sockets.find(userId);
+        if (it != server.sockets.end() && it->second == fd) server.sockets.erase(it);
+    }
+    close(fd);
+}
+
+static void serveWebSocket(int fd, std::string buffer) {
+    static const char* const ACCEPT =
+        "HTTP/1.1 101 Switching Protocols\r\nUpgrade: websocket\r\nConnection: Upgrade\r\n"
+        "Sec-WebSocket-Accept: s3pPLMBiTxaQ9kYGzzhZRbK+xOo=\r\n\r\n";
+    sendAll(fd, ACCEPT, strlen(ACCEPT));
+    int userId = -1;
+    JsonTokenizer json;
+    char scratch[WireCodec::SCRATCH_SIZE];
+    char chunk[2048];
+    while (true) {
+        // One client frame (always masked)
+        while (true) {
+            if (buffer.size() >= 2) {
+                const uint8_t* p = (const uint8_t*)buffer.data();
+                size_t length = p[1] & 0x7F;
+                size_t header = 2;
+                if (length == 126 && buffer.size() >= 4) {
+                    length = ((size_t)p[2] << 8) | p[3];
+                    header = 4;
+                }
+                if (length != 127 && buffer.size() >= header + 4 + length) break;
+            }
+            ssize_t n = recv(fd, chunk, sizeof(chunk), 0);
+            if (n <= 0) {
+                dropSocket(userId, fd);
+                return;
+            }
+            buffer.append(chunk, n);
+        }
+        const uint8_t* p = (const uint8_t*)buffer.data();
+        uint8_t opcode = p[0] & 0x0F;
+        size_t length = p[1] & 0x7F;
+        size_t header = 2;
+        if (length == 126) {
+            length = ((size_t)p[2] << 8) | p[3];
+            header = 4;
+        }
+        std::string payload = buffer.substr(header + 4, length);
+        for (size_t i = 0; i < payload.size(); i++) payload[i] ^= buffer[header + (i & 3)];
+        server.count(TRAFFIC_SOCKET, header + 4 + length, opcode == 0x1 || opcode == 0x2);
+        buffer.erase(0, header + 4 + length);
+        if (opcode == 0x8) {
+            dropSocket(userId, fd);
+            return;
+        }
+
+        bool parsed = opcode == 0x2 ? WireCodec::decode((const uint8_t*)payload.data(), payload.size(), json, scratch,
+                                                        sizeof(scratch))
+                                    : json.parse((const uint8_t*)payload.data(), payload.size());
+        if (!parsed) continue;
+        if (json.getTypeHash() == JsonTokenizer::hashOf("init")) {
+            userId = json.getInt("user_id", -1, 0);
+            {
+                std::lock_guard<std::mutex> guard(server.lock);
+                server.sockets[userId] = fd;
+            }
+            std::string ack = "{\"type\": \"init_ack\", \"status\": \"success\", \"message\": "
+                              "\"Socket initialized successfully\", \"timestamp\": \"2026-10-17T01:00:00.000000\"";
+            ack += server.acceptWire ? ", \"wire\": \"tlv1\"}" : "}";
+            sendWsFrame(fd, false, (const uint8_t*)ack.data(), ack.size());
+        } else if (json.getTypeHash() == JsonTokenizer::hashOf("game_move")) {
+            int seq = json.getInt("seq", -1, 0);
+            int row = json.getInt("row", -1, 0);
+            int col = json.getInt("col", -1, 0);
+            MoveOutcome outcome = applyMove(userId, row, col);
+            // The ack echoes the client's seq
+            if (server.acceptWire) {
+                uint8_t frame[96];
+                WireWriter wire(frame, sizeof(frame), WireCodec::TYPE_GAME_MOVE_ACK);
+                wire.putInt(WireCodec::KEY_SESSION_ID, SESSION_ID);
+                wire.putInt(WireCodec::KEY_SEQ, seq);
+                wire.putBool(WireCodec::KEY_SUCCESS, outcome.success);
+                wire.putString(WireCodec::KEY_MESSAGE, outcome.message);
+                wire.putString(WireCodec::KEY_GAME_STATUS, "playing", 7);
+                wire.putInt(WireCodec::KEY_CURRENT_TURN, outcome.currentTurn);
+                sendWsFrame(fd, true, wire.data(), wire.length());
+            } else {
+                char ack[256];
+                int ackLength = snprintf(ack, sizeof(ack),
+                                         "{\"type\": \"game_move_ack\", \"session_id\": %d, \"seq\": %d, "
+                                         "\"success\": %s, \"message\": \"%s\", \"game_status\": \"playing\", "
+                                         "\"winner_id\": null, \"current_turn\": %d}",
+                                         SESSION_ID, seq, outcome.success ? "true" : "false",
+                                         outcome.message.c_str(), outcome.currentTurn);
+                sendWsFrame(fd, false, (const uint8_t*)ack, ackLength);
+            }
+        }
+    }
+}
+
+// Keep-alive HTTP, or a WebSocket once the first request asks to upgrade
+static void* connectionThread(void* parameter) {
+    int fd = (int)(intptr_t)parameter;
+    int one = 1;
+    setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));   // uvicorn does too
+    std::string buffer;
+    char chunk[2048];
+    while (true) {
+        size_t headerEnd;
+        while ((headerEnd = buffer.find("\r\n\r\n")) == std::string::npos) {
+            ssize_t n = recv(fd, chunk, sizeof(chunk), 0);
+            if (n <= 0) {
+                close(fd);
+                return nullptr;
+            }
+            buffer.append(chunk, n);
+        }
+        std::string head = buffer.substr(0, headerEnd);
+        if (head.find("Upgrade: websocket") != std::string::npos) {
+            serveWebSocket(fd, buffer.substr(headerEnd + 4));
+            return nullptr;
+        }
+        size_t bodyLength = 0;
+        size_t lengthAt = head.find("Content-Length:");
+        if (lengthAt != std::string::npos) bodyLength = strtoul(head.c_str() + lengthAt + 15, nullptr, 10);
+        while (buffer.size() < headerEnd + 4 + bodyLength) {
+            ssize_t n = recv(fd, chunk, sizeof(chunk), 0);
+            if (n <= 0) {
+                close(fd);
+                return nullptr;
+            }
+            buffer.append(chunk, n);
+        }
+        std::string body = buffer.substr(headerEnd + 4, bodyLength);
+        size_t requestLength = headerEnd + 4 + bodyLength;
+        buffer.erase(0, requestLength);
+
+        if (head.compare(0, 5, "POST ") == 0 && head.find("/move ") != std::string::npos) {
+            server.count(TRAFFIC_MOVE_HTTP, requestLength, true);
+            JsonTokenizer json;
+            json.parse((const uint8_t*)body.data(), body.size());
+            MoveOutcome outcome = applyMove(json.getInt("user_id", -1, 0), json.getInt("row", -1, 0),
+                                            json.getInt("col", -1, 0));
+            char answer[256];
+            snprintf(answer, sizeof(answer),
+                     "{\"success\":%s,\"message\":\"%s\",\"move_id\":%d,\"game_status\":\"playing\","
+                     "\"winner_id\":null,\"current_turn\":%d,\"seq\":%d}",
+                     outcome.success ? "true" : "false", outcome.message.c_str(), outcome.seq + 100,
+                     outcome.currentTurn, outcome.seq);
+            sendHttp(fd, TRAFFIC_MOVE_HTTP, answer);
+        } else {
+            server.count(TRAFFIC_POLL_HTTP, requestLength, true);
+            sendHttp(fd, TRAFFIC_POLL_HTTP, stateJson());
+        }
+    }
+}
+
+static void* acceptThread(void* parameter) {
+    int listener = (int)(intptr_t)parameter;
+    while (true) {
+        int fd = accept(listener, nullptr, nullptr);
+        if (fd < 0) continue;
+        pthread_t thread;
+        if (pthread_create(&thread, nullptr, connectionThread, (void*)(intptr_t)fd) == 0) {
+            pthread_detach(thread);
+        } else {
+            close(fd);
+        }
+    }
+    return nullptr;
+}
+
+// Port of the listening socket, 0 on failure
+static uint16_t startServer() {
+    int listener = socket(AF_INET, SOCK_STREAM, 0);
+    if (listener < 0) return 0;
+    struct sockaddr_in address;
+    memset(&address, 0, sizeof(address));
+    address.sin_family = AF_INET;
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    address.sin_port = 0;
+    socklen_t length = sizeof(address);
+    if (bind(listener, (struct sockaddr*)&address, sizeof(address)) != 0 || listen(listener, 16) != 0 ||
+        getsockname(listener, (struct sockaddr*)&address, &length) != 0) {
+        close(listener);
+        return 0;
+    }
+    pthread_t thread;
+    if (pthread_create(&thread, nullptr, acceptThread, (void*)(intptr_t)listener) != 0) {
+        close(listener);
+        return 0;
+    }
+    pthread_detach(thread);
+    return ntohs(address.sin_port);
+}
+
+// ---- Devices ----
+
+enum Mode { MODE_SOCKET, MODE_HTTP_PUSH, MODE_HTTP_POLL };
+static const char* MODE_NAMES[] = {"socket", "http+push", "http poll"};
+
+static const char* SERVER_HOST = "127.0.0.1";
+static const unsigned long POLL_INTERVAL_MS = 3000;   // CaroGameScreen's old syncGameState period
+
+static uint16_t serverPort = 0;
+static Mode mode = MODE_SOCKET;
+static int totalMoves = 20;
+static unsigned long thinkMs = 500;
+static uint8_t cells[MAX_MOVES + 1][2];   // Cell of move seq, distinct
+
+// Per move seq, micros(): submitted, shown on the mover's board, on the opponent's
+static std::atomic<unsigned long> submittedAt[MAX_MOVES + 1];
+static std::atomic<unsigned long> moverAt[MAX_MOVES + 1];
+static std::atomic<unsigned long> opponentAt[MAX_MOVES + 1];
+static std::atomic<int> duplicates(0);
+
+struct Device;
+static Device* devices[2];
+
+struct Device : public SocketFrameSink {
+    int userId;
+    WebSocketsClient ws;
+    JsonTokenizer json;
+    char scratch[WireCodec::SCRATCH_SIZE];
+    String texts[SocketEvent::MAX_TEXTS];
+    SocketFramer framer;
+    bool online;
+    bool binaryWire;
+    bool batchFrames;
+
+    int lastSeq;
+    bool myTurn;
+    bool inFlight;
+    unsigned long thinkUntil;
+    unsigned long nextPoll;
+    uint32_t rngState;
+
+    // --think +-50%, so the polls don't fall into step with the moves
+    unsigned long thinkTime() {
+        rngState ^= rngState << 13;
+        rngState ^= rngState >> 17;
+        rngState ^= rngState << 5;
+        return thinkMs / 2 + (thinkMs > 0 ? rngState % thinkMs : 0);
+    }
+
+    void reset(unsigned long pollPhase) {
+        lastSeq = 0;
+        myTurn = userId == HOST_ID;
+        inFlight = false;
+        thinkUntil = millis() + thinkTime();
+        nextPoll = millis() + pollPhase;
+    }
+
+    bool writeFrame(const uint8_t* data, size_t length, int messages) override {
+        (void)messages;
+        return ws.sendBIN(data, length);
+    }
+
+    bool writeFrame(String& text, int messages) override {
+        (void)messages;
+        return ws.sendTXT(text);
+    }
+
+    // A move shows up on this device's board
+    void applied(int seq, bool own) {
+        std::atomic<unsigned long>& at = own ? moverAt[seq] : opponentAt[seq];
+        unsigned long expected = 0;
+        if (!at.compare_exchange_strong(expected, micros())) duplicates++;
+    }
+
+    void onMessage(bool binary, uint8_t* payload, size_t length) {
+        bool parsed = binary ? WireCodec::decode(payload, length, json, scratch, sizeof(scratch))
+                             : json.parse(payload, length);
+        if (!parsed) return;
+        if (json.getTypeHash() == JsonTokenizer::hashOf("init_ack")) {
+            SocketProtocol::readInitAck(json, binaryWire, batchFrames);
+            online = true;
+            return;
+        }
+        SocketEvent event;
+        if (!SocketProtocol::decodeEvent(json, event, texts)) return;
+        const int32_t* v = event.values;
+        if (event.kind == SocketEvent::GAME_MOVE) {
+            int seq = v[6];
+            // Own moves render on the ack / the HTTP answer
+            if (v[1] != userId && seq > lastSeq) {
+                applied(seq, false);
+                lastSeq = seq;
+                myTurn = v[5] == userId;
+                thinkUntil = millis() + thinkTime();
+            }
+        } else if (event.kind == SocketEvent::GAME_MOVE_ACK && inFlight) {
+            inFlight = false;
+            if (v[2]) {
+                applied(v[1], true);
+                lastSeq = v[1];
+                myTurn = v[4] == userId;
+            }
+        }
+    }
+
+    void move() {
+        int seq = lastSeq + 1;
+        int row = cells[seq][0];
+        int col = cells[seq][1];
+        submittedAt[seq] = micros();
+        if (mode == MODE_SOCKET) {
+            OutboundMessage message(WireCodec::TYPE_GAME_MOVE, SESSION_ID);
+            message.a = row;
+            message.b = col;
+            message.c = seq;
+            inFlight = true;
+            framer.write(&message, 1, binaryWire, batchFrames, millis(), *this);
+            return;
+        }
+        ApiClient::GameMoveResult result = ApiClient::submitGameMove(SESSION_ID, userId, row, col, SERVER_HOST, serverPort);
+        if (result.success) {
+            applied(seq, true);
+            lastSeq = seq;
+            myTurn = false;
+        }
+    }
+
+    void poll() {
+        ApiClient::GameStateResult state = ApiClient::getGameState(SESSION_ID, SERVER_HOST, serverPort);
+        if (!state.success || state.moveCount <= lastSeq) return;
+        for (int seq = lastSeq + 1; seq <= state.moveCount; seq++) {
+            // Odd moves are the host's
+            bool own = (seq % 2 == 1) == (userId == HOST_ID);
+            if (!own) applied(seq, false);
+        }
+        lastSeq = state.moveCount;
+        myTurn = state.currentTurn == userId;
+        thinkUntil = millis() + thinkTime();
+    }
+
+    void run() {
+        unsigned long deadline = millis() + (unsigned long)totalMoves * (thinkMs + POLL_INTERVAL_MS) + 10000;
+        while (lastSeq < totalMoves && millis() < deadline) {
+            if (mode != MODE_HTTP_POLL) ws.loop();
+            unsigned long now = millis();
+            if (myTurn && !inFlight && now >= thinkUntil && lastSeq < totalMoves) {
+                move();
+            }
+            if (mode != MODE_SOCKET && (long)(now - nextPoll) >= 0) {
+                poll();
+                nextPoll = now + POLL_INTERVAL_MS;
+            }
+            usleep(500);
+        }
+    }
+};
+
+static Device host;
+static Device guest;
+
+static void onHostEvent(WStype_t type, uint8_t* payload, size_t length) {
+    if (type == WStype_CONNECTED) {
+        String init = SocketProtocol::initMessage(HOST_ID);
+        host.ws.sendTXT(init);
+    } else if (type == WStype_TEXT || type == WStype_BIN) {
+        host.onMessage(type == WStype_BIN, payload, length);
+    }
+}
+
+static void onGuestEvent(WStype_t type, uint8_t* payload, size_t length) {
+    if (type == WStype_CONNECTED) {
+        String init = SocketProtocol::initMessage(GUEST_ID);
+        guest.ws.sendTXT(init);
+    } else if (type == WStype_TEXT || type == WStype_BIN) {
+        guest.onMessage(type == WStype_BIN, payload, length);
+    }
+}
+
+static void* deviceThread(void* parameter) {
+    ((Device*)parameter)->run();
+    return nullptr;
+}
+
+// ---- Report ----
+
+static int mutedStdout = -1;
+
+// ApiClient logs every request; keep it off the report
+static void muteSerial(bool mute) {
+    fflush(stdout);
+    if (mute && mutedStdout < 0) {
+        mutedStdout = dup(STDOUT_FILENO);
+        FILE* devNull = fopen("/dev/null", "w");
+        if (devNull != nullptr) {
+            dup2(fileno(devNull), STDOUT_FILENO);
+            fclose(devNull);
+        }
+    } else if (!mute && mutedStdout >= 0) {
+        dup2(mutedStdout, STDOUT_FILENO);
+        close(mutedStdout);
+        mutedStdout = -1;
+    }
+}
+
+static double percentileMs(std::vector<unsigned long> values, int p) {
+    if (values.empty()) return 0;
+    std::sort(values.begin(), values.end());
+    size_t index = (values.size() * p) / 100;
+    return values[index < values.size() ? index : values.size() - 1] / 1000.0;
+}
+
+static bool check(bool condition, const char* what) {
+    printf("  %-60s %s\n", what, condition ? "ok" : "FAILED");
+    return condition;
+}
+
+// Plays one game; false if a move went missing
+static bool runMode(Mode runAs) {
+    mode = runAs;
+    for (int seq = 0; seq <= MAX_MOVES; seq++) {
+        submittedAt[seq] = 0;
+        moverAt[seq] = 0;
+        opponentAt[seq] = 0;
+    }
+    duplicates = 0;
+
+    muteSerial(true);
+    // Sockets up (or down) before the clock starts
+    for (int i = 0; i < 2; i++) {
+        Device& d = *devices[i];
+        if (mode == MODE_HTTP_POLL) {
+            d.ws.disconnect();
+            d.online = false;
+            delay(50);   // Close frames are not game traffic
+            continue;
+        }
+        unsigned long start = millis();
+        while (!(d.online && d.ws.isConnected()) && millis() - start < 5000) {
+            d.ws.loop();
+            delay(1);
+        }
+    }
+    server.reset();
+    server.counting = true;
+    host.reset(0);
+    guest.reset(POLL_INTERVAL_MS / 2);   // Devices don't poll in step
+
+    pthread_t threads[2];
+    for (int i = 0; i < 2; i++) pthread_create(&threads[i], nullptr, deviceThread, devices[i]);
+    for (int i = 0; i < 2; i++) pthread_join(threads[i], nullptr);
+    server.counting = false;
+    muteSerial(false);
+
+    std::vector<unsigned long> mover, opponent;
+    int missing = 0;
+    for (int seq = 1; seq <= totalMoves; seq++) {
+        if (moverAt[seq] == 0 || opponentAt[seq] == 0) {
+            missing++;
+            continue;
+        }
+        mover.push_back(moverAt[seq] - submittedAt[seq]);
+        opponent.push_back(opponentAt[seq] - submittedAt[seq]);
+    }
+    uint64_t moveBytes = server.bytes[TRAFFIC_MOVE_HTTP];
+    uint64_t pollBytes = server.bytes[TRAFFIC_POLL_HTTP];
+    uint64_t socketBytes = server.bytes[TRAFFIC_SOCKET];
+    printf("%-9s  mover p50 %7.1f  p99 %7.1f  max %7.1f ms   opponent p50 %7.1f  p99 %7.1f  max %7.1f ms   "
+           "%6.0f B/move (POST %4.0f, %2u polls %5.0f, socket %3.0f in %.1f frames)\n",
+           MODE_NAMES[mode], percentileMs(mover, 50), percentileMs(mover, 99), percentileMs(mover, 100),
+           percentileMs(opponent, 50), percentileMs(opponent, 99), percentileMs(opponent, 100),
+           (double)(moveBytes + pollBytes + socketBytes) / totalMoves, (double)moveBytes / totalMoves,
+           (unsigned)server.messages[TRAFFIC_POLL_HTTP].load(), (double)pollBytes / totalMoves,
+           (double)socketBytes / totalMoves, (double)server.messages[TRAFFIC_SOCKET].load() / totalMoves);
+
+    char label[96];
+    snprintf(label, sizeof(label), "%s: %d moves on the server, on both boards, no repeats", MODE_NAMES[mode],
+             totalMoves);
+    return check(missing == 0 && duplicates == 0 && server.moveCount == totalMoves && server.rejected == 0, label);
+}
+
+int main(int argc, char** argv) {
+    server.serverMs = 5;
+    server.acceptWire = true;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--moves") == 0 && i + 1 < argc) {
+            totalMoves = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--think") == 0 && i + 1 < argc) {
+            thinkMs = strtoul(argv[++i], nullptr, 10);
+        } else if (strcmp(argv[i], "--server-ms") == 0 && i + 1 < argc) {
+            server.serverMs = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--json") == 0) {
+            server.acceptWire = false;
+        } else {
+            printf("Usage: %s [--moves N] [--think MS] [--server-ms MS] [--json]\n", argv[0]);
+            return 2;
+        }
+    }
+    if (totalMoves < 2) totalMoves = 2;
+    if (totalMoves > MAX_MOVES) totalMoves = MAX_MOVES;
+
+    // Distinct cells, shuffled
+    uint8_t order[300][2];
+    for (int i = 0; i < 300; i++) {
+        order[i][0] = (uint8_t)(i / 20);
+        order[i][1] = (uint8_t)(i % 20);
+    }
+    srand(1);
+    for (int i = 299; i > 0; i--) {
+        int j = rand() % (i + 1);
+        std::swap(order[i][0], order[j][0]);
+        std::swap(order[i][1], order[j][1]);
+    }
+    for (int seq = 1; seq <= totalMoves; seq++) {
+        cells[seq][0] = order[seq - 1][0];
+        cells[seq][1] = order[seq - 1][1];
+    }
+
+    serverPort = startServer();
+    if (serverPort == 0) {
+        perror("stand-in server");
+        return 1;
+    }
+    WiFi.begin("HostNet");
+    while (WiFi.status() != WL_CONNECTED) delay(10);
+
+    host.userId = HOST_ID;
+    guest.userId = GUEST_ID;
+    host.rngState = 1;
+    guest.rngState = 2;
+    devices[0] = &host;
+    devices[1] = &guest;
+    host.ws.onEvent(onHostEvent);
+    guest.ws.onEvent(onGuestEvent);
+    host.ws.begin(SERVER_HOST, serverPort, "/ws");
+    guest.ws.begin(SERVER_HOST, serverPort, "/ws");
+
+    printf("Stand-in server on %s:%u (%s), %d moves, %lu ms think, %d ms server work per request\n\n", SERVER_HOST,
+           serverPort, server.acceptWire ? "tlv1" : "JSON", totalMoves, thinkMs, server.serverMs);
+    printf("Checks:\n");
+    bool ok = true;
+    ok &= runMode(MODE_SOCKET);
+    ok &= runMode(MODE_HTTP_PUSH);
+    ok &= runMode(MODE_HTTP_POLL);
+    return ok ? 0 : 1;
+}
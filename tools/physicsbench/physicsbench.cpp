@@ -0,0 +1,300 @@
+// Break-shot benchmark and invariant check for BilliardPhysics.
+//
+// Racks the table (BilliardPhysics::rack) and breaks from the cue spot
+// toward the apex ball with a random aim error and power, then steps until
+// the table is still. Reports fixed ticks per second, ticks per break and
+// the substep load, and checks on every tick:
+//   - energy: total speed^2 never grows over a tick unless a ball is in a
+//     pocket's pull (the only force that adds speed)
+//   - position: every ball is finite and either on the cloth or parked off
+//     the table, a parked ball never comes back, balls at rest do not overlap
+//   - every break settles within MAX_SHOT_TICKS
+//   - determinism: the same break replays to the same bits, also when fed
+//     through advance() with random frame intervals instead of step()
+// Exits non-zero if a check fails.
+//
+//   pio run -e physicsbench
+//   .pio/build/physicsbench/program --shots 5000
+//
+// Build with -DSIM_FIXED_POINT (see [env:physicsbench]) to check the
+// fixed-point physics.
+#include <Arduino.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "billiard_physics.h"
+
+static const int CUE_INDEX = 0;
+static const int APEX_INDEX = 1;
+static const int MAX_SHOT_TICKS = 3000;  // 60 s of table time
+static const int REPLAYS = 500;          // Breaks replayed for the determinism checks
+static const float ENERGY_TOLERANCE = 1e-3f;
+
+static uint32_t rngState = 1;
+
+static uint32_t nextRandom() {
+    rngState ^= rngState << 13;
+    rngState ^= rngState >> 17;
+    rngState ^= rngState << 5;
+    return rngState;
+}
+
+static float randomRange(float lo, float hi) {
+    return lo + (hi - lo) * (nextRandom() >> 8) * (1.0f / 16777216.0f);
+}
+
+static double nowSeconds() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static bool check(bool condition, const char* what) {
+    printf("  %-60s %s\n", what, condition ? "ok" : "FAILED");
+    return condition;
+}
+
+struct Shot {
+    float angle;
+    float power;
+};
+
+// Rack and launch exactly like BilliardGame::handleChargeRelease
+static void setUpBreak(BilliardPhysics& physics, const Shot& shot) {
+    physics.rack();
+    Ball* balls = physics.getBalls();
+    sim_t speed = BilliardPhysics::shotSpeed(shot.power);
+    balls[CUE_INDEX].vx = simCos(sim_t(shot.angle)) * speed;
+    balls[CUE_INDEX].vy = simSin(sim_t(shot.angle)) * speed;
+    balls[CUE_INDEX].isActive = true;
+}
+
+static float energy(const Ball* balls) {
+    float sum = 0.0f;
+    for (int i = 0; i < BALL_COUNT; i++) {
+        if (balls[i].x < sim_t(0)) continue;
+        float vx = (float)balls[i].vx;
+        float vy = (float)balls[i].vy;
+        sum += vx * vx + vy * vy;
+    }
+    return sum;
+}
+
+static bool anyInPocketPull(const Ball* balls) {
+    for (int i = 0; i < BALL_COUNT; i++) {
+        if (BilliardPhysics::isInAttractionZone(balls[i].x, balls[i].y)) return true;
+    }
+    return false;
+}
+
+struct Invariants {
+    long energyGains;      // Ticks that gained speed^2 outside any pocket pull
+    float worstGain;       // Largest such gain, relative to the break energy
+    long offCloth;         // Ball centers outside the table (or NaN)
+    long resurrected;      // Parked balls that came back
+    long overlapsAtRest;   // Pairs closer than 2 radii - 1 px once still
+    long unsettled;
+    long pocketed;
+    float minRestGap;      // Closest pair of resting balls (center distance)
+};
+
+// Play one break with step() and check every tick. Returns the tick count.
+static int playBreak(const Shot& shot, Invariants& inv, BilliardPhysics& physics) {
+    setUpBreak(physics, shot);
+    Ball* balls = physics.getBalls();
+    float breakEnergy = energy(balls);
+    bool parked[BALL_COUNT] = {false};
+
+    int tick = 0;
+    while (tick < MAX_SHOT_TICKS) {
+        float before = energy(balls);
+        bool pulledBefore = anyInPocketPull(balls);
+        physics.step();
+        tick++;
+        float after = energy(balls);
+        bool pulled = pulledBefore || anyInPocketPull(balls) || physics.getPocketEventCount() > 0;
+        if (!pulled && after > before + ENERGY_TOLERANCE * breakEnergy) {
+            inv.energyGains++;
+            if ((after - before) / breakEnergy > inv.worstGain) inv.worstGain = (after - before) / breakEnergy;
+        }
+        // step() does not clear events (advance() does): count new ones per tick
+        inv.pocketed += physics.getPocketEventCount();
+        physics.clearEvents();
+
+        for (int i = 0; i < BALL_COUNT; i++) {
+            float x = (float)balls[i].x;
+            float y = (float)balls[i].y;
+            if (x < 0.0f) {
+                parked[i] = true;
+                continue;
+            }
+            if (parked[i]) inv.resurrected++;
+            if (!(x >= TABLE_X && x <= TABLE_X + TABLE_WIDTH && y >= TABLE_Y && y <= TABLE_Y + TABLE_HEIGHT)) {
+                inv.offCloth++;
+            }
+        }
+        if (!physics.isMoving()) break;
+    }
+
+    if (physics.isMoving()) {
+        inv.unsettled++;
+        return tick;
+    }
+    for (int i = 0; i < BALL_COUNT; i++) {
+        if (balls[i].x < sim_t(0)) continue;
+        for (int j = i + 1; j < BALL_COUNT; j++) {
+            if (balls[j].x < sim_t(0)) continue;
+            float dx = (float)(balls[j].x - balls[i].x);
+            float dy = (float)(balls[j].y - balls[i].y);
+            float gap = sqrtf(dx * dx + dy * dy);
+            if (gap < inv.minRestGap) inv.minRestGap = gap;
+            if (gap < BALL_RADIUS * 2.0f - 1.0f) inv.overlapsAtRest++;
+        }
+    }
+    return tick;
+}
+
+// The same break through advance() with frame intervals of 1-60 ms, never
+// more than MAX_TICKS_PER_ADVANCE ticks per call so no time is dropped. The
+// last call may run a few ticks past the stop - a still table stays still.
+static int playBreakFramed(const Shot& shot, BilliardPhysics& physics) {
+    setUpBreak(physics, shot);
+    int ticks = 0;
+    while (ticks < MAX_SHOT_TICKS && physics.isMoving()) {
+        ticks += physics.advance(1 + nextRandom() % 60);
+    }
+    return ticks;
+}
+
+static bool sameBalls(const BilliardPhysics& a, const BilliardPhysics& b) {
+    for (int i = 0; i < BALL_COUNT; i++) {
+        const Ball& p = a.getBalls()[i];
+        const Ball& q = b.getBalls()[i];
+        if (p.x != q.x || p.y != q.y || p.vx != q.vx || p.vy != q.vy || p.isActive != q.isActive) return false;
+    }
+    return true;
+}
+
+int main(int argc, char** argv) {
+    int shotCount = 5000;
+    unsigned long seed = 1;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--shots") == 0 && i + 1 < argc) {
+            shotCount = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--seed") == 0 && i + 1 < argc) {
+            seed = strtoul(argv[++i], nullptr, 10);
+        } else {
+            printf("Usage: %s [--shots N] [--seed N]\n", argv[0]);
+            return 2;
+        }
+    }
+    if (shotCount < 1) shotCount = 1;
+    rngState = seed != 0 ? (uint32_t)seed : 1;
+
+#ifdef SIM_FIXED_POINT
+    printf("sim_t = Fixed16 (Q16.16)\n");
+#else
+    printf("sim_t = float\n");
+#endif
+
+    // Aim at the apex ball, up to +-3 degrees off, power 40-100
+    BilliardPhysics rackOnly;
+    rackOnly.rack();
+    const Ball* rack = rackOnly.getBalls();
+    float apexAngle = atan2f((float)(rack[APEX_INDEX].y - rack[CUE_INDEX].y),
+                             (float)(rack[APEX_INDEX].x - rack[CUE_INDEX].x));
+    Shot* shots = new Shot[shotCount];
+    for (int i = 0; i < shotCount; i++) {
+        shots[i].angle = apexAngle + randomRange(-0.052f, 0.052f);
+        shots[i].power = randomRange(40.0f, 100.0f);
+    }
+
+    // ---- Speed, raw step() loop ----
+    BilliardPhysics physics;
+    long totalTicks = 0;
+    int maxTicks = 0;
+    double start = nowSeconds();
+    for (int i = 0; i < shotCount; i++) {
+        setUpBreak(physics, shots[i]);
+        int tick = 0;
+        while (tick < MAX_SHOT_TICKS && physics.isMoving()) {
+            physics.step();
+            tick++;
+        }
+        totalTicks += tick;
+        if (tick > maxTicks) maxTicks = tick;
+    }
+    double elapsed = nowSeconds() - start;
+
+    // Substeps the first ticks of a break need (the fast part)
+    long substeps = 0;
+    int measuredTicks = 0;
+    for (int i = 0; i < shotCount && i < 200; i++) {
+        setUpBreak(physics, shots[i]);
+        for (int tick = 0; tick < 50 && physics.isMoving(); tick++) {
+            sim_t maxSpeedSq = sim_t(0);
+            const Ball* balls = physics.getBalls();
+            for (int b = 0; b < BALL_COUNT; b++) {
+                if (balls[b].x < sim_t(0) || !balls[b].isActive) continue;
+                sim_t speedSq = balls[b].vx * balls[b].vx + balls[b].vy * balls[b].vy;
+                if (speedSq > maxSpeedSq) maxSpeedSq = speedSq;
+            }
+            substeps += BilliardPhysics::substepsFor(maxSpeedSq);
+            measuredTicks++;
+            physics.step();
+        }
+    }
+
+    printf("%d breaks: %ld ticks in %.3f s = %.0f ticks/s (%.2f us/tick), %.0f breaks/s\n",
+           shotCount, totalTicks, elapsed, totalTicks / elapsed, elapsed * 1e6 / totalTicks, shotCount / elapsed);
+    printf("ticks per break: mean %.0f, max %d (%.1f s of table time at %u ms/tick)\n",
+           (double)totalTicks / shotCount, maxTicks, maxTicks * BilliardPhysics::TICK_MS / 1000.0,
+           (unsigned)BilliardPhysics::TICK_MS);
+    printf("substeps over the first 50 ticks: mean %.1f (%d..%d)\n",
+           measuredTicks ? (double)substeps / measuredTicks : 0.0, BilliardPhysics::MIN_SUBSTEPS,
+           BilliardPhysics::MAX_SUBSTEPS);
+
+    // ---- Invariants ----
+    Invariants inv;
+    memset(&inv, 0, sizeof(inv));
+    inv.minRestGap = 1e9f;
+    for (int i = 0; i < shotCount; i++) {
+        playBreak(shots[i], inv, physics);
+    }
+    printf("pocketed %.2f balls per break, closest resting pair %.2f px apart (contact %d)\n",
+           (double)inv.pocketed / shotCount, inv.minRestGap, BALL_RADIUS * 2);
+
+    int replays = shotCount < REPLAYS ? shotCount : REPLAYS;
+    int replayMismatch = 0;
+    int framedMismatch = 0;
+    BilliardPhysics first;
+    BilliardPhysics second;
+    for (int i = 0; i < replays; i++) {
+        Invariants ignored;
+        memset(&ignored, 0, sizeof(ignored));
+        int ticks = playBreak(shots[i], ignored, first);
+        playBreak(shots[i], ignored, second);
+        if (!sameBalls(first, second)) replayMismatch++;
+        int framedTicks = playBreakFramed(shots[i], second);
+        if (framedTicks < ticks || !sameBalls(first, second)) framedMismatch++;
+    }
+
+    printf("\nChecks:\n");
+    bool ok = true;
+    char label[96];
+    snprintf(label, sizeof(label), "energy never grows outside a pocket pull (%ld ticks, worst %.4f)",
+             inv.energyGains, inv.worstGain);
+    ok &= check(inv.energyGains == 0, label);
+    ok &= check(inv.offCloth == 0, "every ball stays on the cloth or parked");
+    ok &= check(inv.resurrected == 0, "pocketed balls stay pocketed");
+    ok &= check(inv.overlapsAtRest == 0, "no overlapping balls once the table is still");
+    snprintf(label, sizeof(label), "every break settles within %d ticks", MAX_SHOT_TICKS);
+    ok &= check(inv.unsettled == 0, label);
+    ok &= check(replayMismatch == 0, "a break replays to the same bits");
+    ok &= check(framedMismatch == 0, "advance() with random frame times = step() per tick");
+
+    delete[] shots;
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,553 @@
+// Redraw cost per screen: direct drawing vs TftCompositor, counted by the
+// host panel (hal/native Adafruit_ST7789 counts every pixel written and
+// every setAddrWindow, i.e. what would cross the SPI bus).
+//
+// Each screen runs the same scripted session twice - once with the
+// compositor in pass-through (how every screen drew before it) and once
+// compositing - on a fresh object, and the two panel deltas are compared:
+//   Keyboard            full draw + 40 cursor moves (each redraws the keyboard)
+//   ConfirmationDialog  shown over the keyboard, 20 button toggles, hidden
+//   CaroGame            board draw + 60 cursor moves and 20 placed marks
+//   BilliardGame        table draw, 30 aim steps, charge, break, 180 frames
+//   SocialScreen        12 friends, 24 list moves, 10 presence changes,
+//                       4 unread chats, notifications and games tabs
+//   ChatScreen          20 incoming messages, keyboard open, 12 keys typed
+//                       and sent, 10 scroll steps, 8 status changes
+//   GameLobbyScreen     6 friends, 10 list moves, focus to start and back,
+//                       4 rounds of guest join / ready / unready / leave
+// The social, chat and lobby screens run on canned data: the ApiClient,
+// ApiRequestQueue and SocketManager calls they make are stubbed below, and
+// SPIFFS is a temporary directory, emptied before every session.
+//
+// Also checks the compositor's heap guard with a simulated free heap
+// (--heap-kb budget minus what the process allocated since start): shadow
+// and strips are only taken with MIN_FREE_HEAP to spare, and nothing is
+// allocated when they don't fit. Exits non-zero if a check fails.
+//
+//   pio run -e redrawbench
+//   .pio/build/redrawbench/program
+#include <Arduino.h>
+#include <malloc.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <string>
+#include <SPIFFS.h>
+#include "tft_compositor.h"
+#include "keyboard.h"
+#include "keyboard_skins_wrapper.h"
+#include "confirmation_dialog.h"
+#include "caro_game.h"
+#include "billiard_game.h"
+#include "social_screen.h"
+#include "chat_screen.h"
+#include "game_lobby_screen.h"
+#include "api_client.h"
+#include "api_request_queue.h"
+#include "socket_manager.h"
+#include "hal_native.h"
+
+// ---- What hal_native.cpp provides to the app ----
+
+static unsigned long fakeMillis = 0;
+
+// Simulated clock for game timing; micros() is real for the flush timers
+unsigned long millis() {
+    return fakeMillis;
+}
+
+void delay(uint32_t ms) {
+    fakeMillis += ms;
+}
+
+unsigned long micros() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (unsigned long)(ts.tv_sec * 1000000ULL + ts.tv_nsec / 1000);
+}
+
+// Free heap = budget minus what the process allocated since the budget was set
+static uint32_t heapBudget = 320 * 1024;
+static size_t heapBaseline = 0;
+
+static void setHeapBudget(uint32_t bytes) {
+    heapBudget = bytes;
+    heapBaseline = mallinfo2().uordblks;
+}
+
+EspClass ESP;
+
+uint32_t EspClass::getFreeHeap() {
+    size_t used = mallinfo2().uordblks;
+    size_t grown = used > heapBaseline ? used - heapBaseline : 0;
+    return grown < heapBudget ? heapBudget - (uint32_t)grown : 0;
+}
+
+static std::string spiffsDir;
+
+namespace HalNative {
+double spiMegahertz() { return 0; }
+void registerPanel(Adafruit_ST7789* panel) { (void)panel; }
+const char* spiffsRoot() { return spiffsDir.c_str(); }
+}
+
+// BilliardGame only talks to the socket when started online
+bool SocketManager::sendBilliardShot(int sessionId, int seq, uint32_t tick, int32_t angle, int power, uint32_t hash) {
+    (void)sessionId; (void)seq; (void)tick; (void)angle; (void)power; (void)hash;
+    return false;
+}
+
+bool SocketManager::sendBilliardSync(int sessionId, int seq, const String& snapshot) {
+    (void)sessionId; (void)seq; (void)snapshot;
+    return false;
+}
+
+// ChatScreen and the Caro screen send through the socket; nothing is connected
+void SocketManager::sendChatMessage(int toUserId, const String& message, const String& messageId) {
+    (void)toUserId; (void)message; (void)messageId;
+}
+
+void SocketManager::sendTypingStart(int toUserId) {
+    (void)toUserId;
+}
+
+void SocketManager::sendTypingStop(int toUserId) {
+    (void)toUserId;
+}
+
+bool SocketManager::sendGameMove(int sessionId, int row, int col, int seq) {
+    (void)sessionId; (void)row; (void)col; (void)seq;
+    return false;
+}
+
+bool SocketManager::requestGameResync(int sessionId, int sinceSeq) {
+    (void)sessionId; (void)sinceSeq;
+    return false;
+}
+
+// SocialScreen's server: the friends list and notifications answer at once
+// with canned data, everything else fails like an unreachable server
+static const int FRIEND_COUNT = 12;
+static const char* FRIENDS_LIST = "Lan,11,1|Minh,12,0|Hoa,13,1|Tuan,14,0|Mai,15,1|Khoa,16,0|"
+                                  "Linh,17,1|Nam,18,0|Thu,19,0|Duc,20,1|Vy,21,0|Bao,22,1";
+static const int NOTIFICATION_COUNT = 6;
+
+void ApiRequestQueue::getFriendsList(int userId, const String& serverHost, uint16_t port,
+                                     OnFriendsListCallback callback, void* context) {
+    (void)userId; (void)serverHost; (void)port;
+    callback(true, String(FRIENDS_LIST), context);
+}
+
+void ApiRequestQueue::getGameState(int sessionId, const String& serverHost, uint16_t port,
+                                   OnGameStateCallback callback, void* context) {
+    (void)sessionId; (void)serverHost; (void)port;
+    ApiClient::GameStateResult result = {};
+    callback(result, context);
+}
+
+void ApiRequestQueue::submitGameMove(int sessionId, int userId, int row, int col, const String& serverHost,
+                                     uint16_t port, OnGameMoveCallback callback, void* context) {
+    (void)sessionId; (void)userId; (void)row; (void)col; (void)serverHost; (void)port;
+    ApiClient::GameMoveResult result = {};
+    callback(result, context);
+}
+
+void ApiRequestQueue::cancel(void* context) {
+    (void)context;
+}
+
+ApiClient::NotificationsResult ApiClient::getNotifications(int userId, const String& serverHost, uint16_t port) {
+    (void)userId; (void)serverHost; (void)port;
+    NotificationsResult result;
+    result.success = true;
+    result.count = NOTIFICATION_COUNT;
+    result.notifications = new NotificationEntry[NOTIFICATION_COUNT];
+    for (int i = 0; i < NOTIFICATION_COUNT; i++) {
+        NotificationEntry& entry = result.notifications[i];
+        entry.id = 100 + i;
+        entry.type = i % 2 == 0 ? "friend_request" : "game_invite";
+        entry.message = i % 2 == 0 ? "Khoa wants to be your friend" : "Lan invited you to Caro";
+        entry.timestamp = "2026-01-01 12:00:00";
+        entry.read = false;
+        entry.relatedId = 200 + i;
+    }
+    return result;
+}
+
+ApiClient::FriendRequestResult ApiClient::sendFriendRequest(int fromUserId, const String& toNickname,
+                                                            const String& serverHost, uint16_t port) {
+    (void)fromUserId; (void)toNickname; (void)serverHost; (void)port;
+    return FriendRequestResult();
+}
+
+ApiClient::FriendRequestResult ApiClient::acceptFriendRequest(int userId, int notificationId,
+                                                              const String& serverHost, uint16_t port) {
+    (void)userId; (void)notificationId; (void)serverHost; (void)port;
+    return FriendRequestResult();
+}
+
+ApiClient::FriendRequestResult ApiClient::rejectFriendRequest(int userId, int notificationId,
+                                                              const String& serverHost, uint16_t port) {
+    (void)userId; (void)notificationId; (void)serverHost; (void)port;
+    return FriendRequestResult();
+}
+
+ApiClient::GameSessionResult ApiClient::createGameSession(int hostUserId, const String& gameType, int maxPlayers,
+                                                          const int* participantIds, int participantCount,
+                                                          const String& serverHost, uint16_t port) {
+    (void)hostUserId; (void)gameType; (void)maxPlayers; (void)participantIds; (void)participantCount;
+    (void)serverHost; (void)port;
+    return GameSessionResult();
+}
+
+ApiClient::GameSessionResult ApiClient::inviteToSession(int sessionId, int hostUserId, const int* participantIds,
+                                                        int participantCount, const String& serverHost,
+                                                        uint16_t port) {
+    (void)sessionId; (void)hostUserId; (void)participantIds; (void)participantCount; (void)serverHost; (void)port;
+    return GameSessionResult();
+}
+
+ApiClient::GameSessionResult ApiClient::respondGameInvite(int sessionId, int userId, bool accept,
+                                                          const String& serverHost, uint16_t port) {
+    (void)sessionId; (void)userId; (void)accept; (void)serverHost; (void)port;
+    return GameSessionResult();
+}
+
+// ---- Sessions ----
+
+static TftCompositor tft(&SPI, -1, -1, -1);
+static uint32_t rngState = 1;
+
+static uint32_t nextRandom() {
+    rngState ^= rngState << 13;
+    rngState ^= rngState >> 17;
+    rngState ^= rngState << 5;
+    return rngState;
+}
+
+// Returns the number of steps (redraw requests) the session made
+static int keyboardSession() {
+    Keyboard keyboard(&tft);
+    keyboard.setSkin(KeyboardSkins::getFeminineLilac());
+    keyboard.draw();
+    for (int i = 0; i < 40; i++) {
+        keyboard.moveCursorTo(nextRandom() % 4, nextRandom() % 10);
+    }
+    return 41;
+}
+
+static int dialogSession() {
+    Keyboard keyboard(&tft);
+    keyboard.setSkin(KeyboardSkins::getFeminineLilac());
+    keyboard.draw();
+    ConfirmationDialog dialog(&tft);
+    dialog.show("Unfriend this player?");
+    for (int i = 0; i < 20; i++) {
+        if (i % 2 == 0) dialog.handleLeft(); else dialog.handleRight();
+    }
+    dialog.hide();
+    keyboard.draw();
+    return 24;
+}
+
+static int caroSession() {
+    CaroGame game(&tft);
+    game.init();
+    game.draw();
+    int steps = 1;
+    for (int i = 0; i < 60; i++) {
+        switch (nextRandom() % 4) {
+            case 0: game.handleUp(); break;
+            case 1: game.handleDown(); break;
+            case 2: game.handleLeft(); break;
+            default: game.handleRight(); break;
+        }
+        steps++;
+        if (i % 3 == 2) {
+            game.handleSelect();
+            steps++;
+        }
+    }
+    return steps;
+}
+
+static int billiardSession() {
+    BilliardGame game(&tft);
+    game.init();
+    game.draw();
+    int steps = 1;
+    for (int i = 0; i < 30; i++) {
+        game.handleAimRotate(0.05f);
+        steps++;
+    }
+    game.handleChargeStart();
+    for (int i = 0; i < 20; i++) {
+        fakeMillis += 16;
+        game.update();
+        steps++;
+    }
+    game.handleChargeRelease();
+    for (int i = 0; i < 180; i++) {
+        fakeMillis += 16;
+        game.update();
+        steps++;
+    }
+    return steps;
+}
+
+static const int OWNER_ID = 7;
+static const int CHAT_FRIEND_ID = 11;
+
+static void startSocial(SocialScreen& social) {
+    social.setUserId(OWNER_ID);
+    social.setOwnerNickname("bench");
+    social.setServerInfo("bench.local", 8080);
+    social.loadFriends();
+    social.loadNotifications();
+    social.setActive(true);
+    social.navigateToFriends();
+}
+
+static int socialSession() {
+    Keyboard keyboard(&tft);
+    SocialScreen social(&tft, &keyboard);
+    startSocial(social);
+    social.draw();
+    social.handleSelect();  // Focus the list
+    int steps = 2;
+    for (int i = 0; i < 24; i++) {
+        if (nextRandom() % 3 == 0) social.handleUp(); else social.handleDown();
+        steps++;
+    }
+    for (int i = 0; i < 10; i++) {
+        social.updateFriendStatus(11 + nextRandom() % FRIEND_COUNT, nextRandom() % 2 == 0);
+        steps++;
+    }
+    // Incoming chats: unread badge + move to the top, drawn by update()
+    for (int i = 0; i < 4; i++) {
+        int friendId = 11 + nextRandom() % FRIEND_COUNT;
+        social.addUnreadChatForFriend(friendId);
+        social.bumpFriendToTop(friendId);
+        fakeMillis += 200;
+        social.update();
+        steps++;
+    }
+    social.navigateToNotifications();
+    steps++;
+    for (int i = 0; i < 5; i++) {
+        social.handleDown();
+        steps++;
+    }
+    social.navigateToGames();
+    social.navigateToFriends();
+    return steps + 2;
+}
+
+static int chatSession() {
+    Keyboard keyboard(&tft);
+    keyboard.setSkin(KeyboardSkins::getFeminineLilac());
+    ChatScreen chat(&tft, &keyboard);
+    chat.setOwnerUserId(OWNER_ID);
+    chat.setOwnerNickname("bench");
+    chat.setFriendUserId(CHAT_FRIEND_ID);
+    chat.setFriendNickname("Lan");
+    chat.setFriendStatus(1);
+    chat.setActive(true);
+    chat.loadMessagesFromFile();
+    chat.forceRedraw();
+    int steps = 1;
+    // Incoming, the way SocketManager::handleChatMessage shows them
+    static const char* LINES[] = {"hi", "are you there?", "want to play caro after dinner?",
+                                  "ok", "I will be online at 8", "see you :)"};
+    for (int i = 0; i < 20; i++) {
+        chat.addMessage(LINES[nextRandom() % 6], false, false);
+        chat.redrawMessages();
+        steps++;
+    }
+    chat.handleKeyPress("select");
+    steps++;
+    static const char* KEYS[] = {"o", "k", " ", "s", "e", "e", " ", "y", "o", "u", "!", "|e"};
+    for (const char* key : KEYS) {
+        chat.handleKeyPress(key);
+        steps++;
+    }
+    for (int i = 0; i < 10; i++) {
+        if (i < 5) chat.handleUp(); else chat.handleDown();
+        steps++;
+    }
+    for (int i = 0; i < 8; i++) {
+        chat.setFriendStatus(i % 3);
+        steps++;
+    }
+    return steps;
+}
+
+static int lobbySession() {
+    Keyboard keyboard(&tft);
+    SocialScreen social(&tft, &keyboard);
+    startSocial(social);
+    GameLobbyScreen* lobby = social.getGameLobby();
+    GameLobbyScreen::MiniFriend friends[6] = {
+        {"Lan", true, 11}, {"Minh", false, 12}, {"Hoa", true, 13},
+        {"Tuan", false, 14}, {"Mai", true, 15}, {"Khoa", false, 16},
+    };
+    lobby->setup("Caro", "bench");
+    lobby->setFriends(friends, 6);
+    lobby->setActive(true);
+    lobby->draw();
+    int steps = 1;
+    for (int i = 0; i < 10; i++) {
+        if (i < 5) lobby->handleDown(); else lobby->handleUp();
+        steps++;
+    }
+    lobby->handleRight();
+    lobby->handleLeft();
+    steps += 2;
+    // What SocialScreen::onGameEvent does for join / ready / leave
+    for (int i = 0; i < 4; i++) {
+        lobby->setGuest("Lan");
+        lobby->draw();
+        lobby->setGuestReady(true);
+        lobby->draw();
+        lobby->setGuestReady(false);
+        lobby->draw();
+        lobby->clearGuest();
+        lobby->draw();
+        steps += 4;
+    }
+    lobby->setActive(false);
+    return steps;
+}
+
+struct Traffic {
+    uint64_t pixels;
+    uint32_t windows;
+};
+
+static Traffic panelTraffic() {
+    Traffic t;
+    t.pixels = tft.getPixelsWritten();
+    t.windows = tft.getWindows();
+    return t;
+}
+
+// The social and chat screens log every step over Serial (stdout here):
+// muted while a session runs, the table follows
+static int mutedStdout = -1;
+
+static void muteSerial(bool mute) {
+    fflush(stdout);
+    if (mute && mutedStdout < 0) {
+        mutedStdout = dup(STDOUT_FILENO);
+        FILE* devNull = fopen("/dev/null", "w");
+        if (devNull != nullptr) {
+            dup2(fileno(devNull), STDOUT_FILENO);
+            fclose(devNull);
+        }
+    } else if (!mute && mutedStdout >= 0) {
+        dup2(mutedStdout, STDOUT_FILENO);
+        close(mutedStdout);
+        mutedStdout = -1;
+    }
+}
+
+static Traffic runSession(int (*session)(), bool compositing, int& steps) {
+    rngState = 1;
+    fakeMillis = 0;
+    SPIFFS.format();
+    muteSerial(true);
+    if (compositing) {
+        tft.beginCompositing();
+    }
+    tft.fillScreen(0x0000);
+    Traffic before = panelTraffic();
+    steps = session();
+    Traffic after = panelTraffic();
+    tft.endCompositing();
+    muteSerial(false);
+    Traffic delta;
+    delta.pixels = after.pixels - before.pixels;
+    delta.windows = after.windows - before.windows;
+    return delta;
+}
+
+static bool check(bool condition, const char* what) {
+    printf("  %-64s %s\n", what, condition ? "ok" : "FAILED");
+    return condition;
+}
+
+int main(int argc, char** argv) {
+    uint32_t heapKb = 400;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--heap-kb") == 0 && i + 1 < argc) {
+            heapKb = (uint32_t)atoi(argv[++i]);
+        } else {
+            printf("Usage: %s [--heap-kb N]\n", argv[0]);
+            return 2;
+        }
+    }
+
+    char dir[] = "/tmp/redrawbench.XXXXXX";
+    if (mkdtemp(dir) == nullptr) {
+        perror("mkdtemp");
+        return 1;
+    }
+    spiffsDir = dir;
+
+    tft.init(240, 320);
+    tft.setRotation(3);
+    setHeapBudget(heapKb * 1024);
+
+    struct Screen {
+        const char* name;
+        int (*session)();
+    };
+    static const Screen SCREENS[] = {
+        {"Keyboard", keyboardSession},
+        {"ConfirmationDialog", dialogSession},
+        {"CaroGame", caroSession},
+        {"BilliardGame", billiardSession},
+        {"SocialScreen", socialSession},
+        {"ChatScreen", chatSession},
+        {"GameLobbyScreen", lobbySession},
+    };
+
+    printf("%-20s %6s  %12s %8s  %12s %8s  %7s\n", "screen", "steps", "direct px/st", "win/st",
+           "compos px/st", "win/st", "saved");
+    for (const Screen& screen : SCREENS) {
+        int steps;
+        Traffic direct = runSession(screen.session, false, steps);
+        Traffic composited = runSession(screen.session, true, steps);
+        printf("%-20s %6d  %12.0f %8.1f  %12.0f %8.1f  %6.1f%%\n", screen.name, steps,
+               (double)direct.pixels / steps, (double)direct.windows / steps,
+               (double)composited.pixels / steps, (double)composited.windows / steps,
+               direct.pixels > 0 ? 100.0 * (1.0 - (double)composited.pixels / direct.pixels) : 0.0);
+    }
+
+    // ---- Heap guard ----
+    printf("\nChecks:\n");
+    bool ok = true;
+    const uint32_t shadowBytes = 320 * 240 * 2;
+    const uint32_t stripBytes = TftCompositor::STRIP_COUNT * TftCompositor::STRIP_PIXELS * 2;
+
+    setHeapBudget(shadowBytes + TftCompositor::MIN_FREE_HEAP + 8 * 1024);
+    bool started = tft.beginCompositing(true);
+    uint32_t freeAfter = ESP.getFreeHeap();
+    ok &= check(!started && !tft.isCompositing() && freeAfter > shadowBytes,
+                "shadow + strips over the reserve: pass-through, nothing taken");
+    started = tft.beginCompositing(false);
+    ok &= check(started && ESP.getFreeHeap() >= TftCompositor::MIN_FREE_HEAP,
+                "shadow alone fits: compositing, MIN_FREE_HEAP left");
+    tft.endCompositing();
+
+    setHeapBudget(shadowBytes + stripBytes + TftCompositor::MIN_FREE_HEAP + 8 * 1024);
+    started = tft.beginCompositing(true);
+    ok &= check(started && tft.isPipelined() && ESP.getFreeHeap() >= TftCompositor::MIN_FREE_HEAP,
+                "shadow + strips fit: compositing + pipelined, MIN_FREE_HEAP left");
+
+    SPIFFS.format();
+    rmdir(dir);
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,389 @@
+// Shot predictor benchmark and accuracy check against the full simulation.
+//
+// Drops the cue ball and the 8 object balls at random on the table (not
+// touching, outside the pocket mouths) and, for each layout:
+//   - times BilliardShotPredictor::predict and a full findBestShot search,
+//   - plays one random shot through BilliardPhysics::step() until the table
+//     is still and compares it with the prediction: first ball hit, object
+//     ball direction, pot / scratch, rest positions.
+//
+//   pio run -e shotbench
+//   .pio/build/shotbench/program --layouts 2000 --searches 200 --steps 360
+//
+// Build with -DSIM_FIXED_POINT (see [env:shotbench]) to check against the
+// fixed-point physics.
+#include <Arduino.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <algorithm>
+#include <vector>
+#include "billiard_physics.h"
+#include "billiard_predictor.h"
+
+static const int CUE_INDEX = 0;
+static const int MAX_SHOT_TICKS = 3000;  // 60 s of table time
+static const int PREDICTIONS_PER_LAYOUT = 64;
+
+struct Options {
+    int layouts;
+    int searches;
+    int steps;
+    unsigned long seed;
+};
+
+// Outcome of one shot played through BilliardPhysics
+struct SimResult {
+    int firstBall;        // First object ball set moving, -1 if none
+    float firstAngle;     // Its direction at the end of that tick
+    bool firstNearRail;   // Could reach a rail within that tick - direction may be post-rail
+    int movedBalls;       // Object balls that moved at all (>1 = chain)
+    bool recontact;       // Cue and first ball met again after parting (also a chain)
+    int pocketOf[BALL_COUNT];  // Pocket index per ball, -1 if still on the table
+    float restX[BALL_COUNT];
+    float restY[BALL_COUNT];
+    bool settled;
+};
+
+static double nowSeconds() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static uint32_t rngState = 1;
+
+static uint32_t nextRandom() {
+    // xorshift32 - same layouts for the same --seed on any host
+    rngState ^= rngState << 13;
+    rngState ^= rngState >> 17;
+    rngState ^= rngState << 5;
+    return rngState;
+}
+
+static float randomRange(float lo, float hi) {
+    return lo + (hi - lo) * (nextRandom() >> 8) * (1.0f / 16777216.0f);
+}
+
+static void randomLayout(Ball* balls) {
+    sim_t minX, minY, maxX, maxY;
+    BilliardPhysics::getCushionBounds(minX, minY, maxX, maxY);
+    const float gap = BALL_RADIUS * 2.0f + 1.0f;
+    for (int i = 0; i < BALL_COUNT; i++) {
+        float x, y;
+        bool ok;
+        do {
+            x = randomRange((float)minX, (float)maxX);
+            y = randomRange((float)minY, (float)maxY);
+            ok = !BilliardPhysics::isInAttractionZone(sim_t(x), sim_t(y));
+            for (int j = 0; ok && j < i; j++) {
+                float dx = x - (float)balls[j].x;
+                float dy = y - (float)balls[j].y;
+                ok = dx * dx + dy * dy >= gap * gap;
+            }
+        } while (!ok);
+        balls[i].x = sim_t(x);
+        balls[i].y = sim_t(y);
+        balls[i].vx = sim_t(0);
+        balls[i].vy = sim_t(0);
+        balls[i].color = 0;
+        balls[i].isActive = false;
+    }
+}
+
+static int nearestPocket(float x, float y) {
+    int nearest = 0;
+    float nearestSq = 1e30f;
+    for (int p = 0; p < BilliardPhysics::POCKET_COUNT; p++) {
+        sim_t px, py;
+        BilliardPhysics::getPocketPosition(p, px, py);
+        float dx = (float)px - x;
+        float dy = (float)py - y;
+        if (dx * dx + dy * dy < nearestSq) {
+            nearestSq = dx * dx + dy * dy;
+            nearest = p;
+        }
+    }
+    return nearest;
+}
+
+// Launch exactly like BilliardGame::handleChargeRelease and step until still
+static void playShot(const Ball* layout, float angle, float power, SimResult& result) {
+    BilliardPhysics physics;
+    Ball* balls = physics.getBalls();
+    memcpy(balls, layout, sizeof(Ball) * BALL_COUNT);
+    sim_t speed = BilliardPhysics::shotSpeed(power);
+    balls[CUE_INDEX].vx = simCos(sim_t(angle)) * speed;
+    balls[CUE_INDEX].vy = simSin(sim_t(angle)) * speed;
+    balls[CUE_INDEX].isActive = true;
+
+    sim_t minX, minY, maxX, maxY;
+    BilliardPhysics::getCushionBounds(minX, minY, maxX, maxY);
+    // Tick-end distances: a contact in mid-tick is already pushed apart again
+    const float apart = (BALL_RADIUS * 2.0f + 2.0f) * (BALL_RADIUS * 2.0f + 2.0f);
+    const float touching = (BALL_RADIUS * 2.0f + 1.0f) * (BALL_RADIUS * 2.0f + 1.0f);
+    bool parted = false;
+    bool moved[BALL_COUNT] = {false};
+    result.firstBall = -1;
+    result.firstAngle = 0.0f;
+    result.firstNearRail = false;
+    result.movedBalls = 0;
+    result.recontact = false;
+    result.settled = false;
+    for (int tick = 0; tick < MAX_SHOT_TICKS; tick++) {
+        physics.step();
+        int firstThisTick = -1;
+        float firstDistSq = 1e30f;
+        for (int i = 0; i < BALL_COUNT; i++) {
+            if (i == CUE_INDEX || moved[i]) continue;
+            bool moving = balls[i].x < sim_t(0) || balls[i].vx != sim_t(0) || balls[i].vy != sim_t(0);
+            if (!moving) continue;
+            moved[i] = true;
+            result.movedBalls++;
+            // Several balls starting in one tick: the one next to the cue ball was hit first
+            float dx = (float)(balls[i].x - balls[CUE_INDEX].x);
+            float dy = (float)(balls[i].y - balls[CUE_INDEX].y);
+            if (result.firstBall < 0 && dx * dx + dy * dy < firstDistSq) {
+                firstDistSq = dx * dx + dy * dy;
+                firstThisTick = i;
+            }
+        }
+        if (firstThisTick >= 0) {
+            const Ball& first = balls[firstThisTick];
+            result.firstBall = firstThisTick;
+            result.firstAngle = atan2f((float)first.vy, (float)first.vx);
+            float reach = (float)simSqrt(first.vx * first.vx + first.vy * first.vy) + 1.0f;
+            result.firstNearRail = (float)(first.x - minX) < reach || (float)(maxX - first.x) < reach ||
+                                   (float)(first.y - minY) < reach || (float)(maxY - first.y) < reach;
+        } else if (result.firstBall >= 0 && balls[result.firstBall].x >= sim_t(0) && balls[CUE_INDEX].x >= sim_t(0)) {
+            float dx = (float)(balls[result.firstBall].x - balls[CUE_INDEX].x);
+            float dy = (float)(balls[result.firstBall].y - balls[CUE_INDEX].y);
+            float distSq = dx * dx + dy * dy;
+            if (distSq > apart) parted = true;
+            else if (parted && distSq < touching) result.recontact = true;
+        }
+        if (!physics.isMoving()) {
+            result.settled = true;
+            break;
+        }
+    }
+
+    for (int i = 0; i < BALL_COUNT; i++) {
+        result.pocketOf[i] = -1;
+        result.restX[i] = (float)balls[i].x;
+        result.restY[i] = (float)balls[i].y;
+    }
+    for (int e = 0; e < physics.getPocketEventCount(); e++) {
+        const BilliardPhysics::PocketEvent& event = physics.getPocketEvent(e);
+        result.pocketOf[event.ball] = nearestPocket((float)event.x, (float)event.y);
+    }
+}
+
+static float angleError(float a, float b) {
+    float d = fabsf(a - b);
+    while (d > 3.14159265f) d = fabsf(d - 6.28318531f);
+    return d;
+}
+
+static float mean(const std::vector<float>& values) {
+    if (values.empty()) return 0.0f;
+    double sum = 0;
+    for (size_t i = 0; i < values.size(); i++) sum += values[i];
+    return (float)(sum / values.size());
+}
+
+static float percentile(std::vector<float>& values, float p) {
+    if (values.empty()) return 0.0f;
+    std::sort(values.begin(), values.end());
+    size_t i = (size_t)(p * (values.size() - 1) + 0.5f);
+    return values[i];
+}
+
+static float restError(const BilliardShotPredictor::Path& path, const SimResult& sim, int ball) {
+    float dx = path.x[path.count - 1] - sim.restX[ball];
+    float dy = path.y[path.count - 1] - sim.restY[ball];
+    return sqrtf(dx * dx + dy * dy);
+}
+
+static void usage(const char* program) {
+    fprintf(stderr,
+            "Usage: %s [options]\n"
+            "  --layouts N     random tables for speed + accuracy (default 2000)\n"
+            "  --searches N    tables for the findBestShot search (default 200)\n"
+            "  --steps N       angles per search, up to %d (default 360)\n"
+            "  --seed N        (default 1)\n",
+            program, BilliardShotPredictor::MAX_SEARCH_STEPS);
+}
+
+static bool parseOptions(int argc, char** argv, Options& options) {
+    options.layouts = 2000;
+    options.searches = 200;
+    options.steps = 360;
+    options.seed = 1;
+    for (int i = 1; i < argc; i++) {
+        const char* arg = argv[i];
+        const char* value = i + 1 < argc ? argv[i + 1] : nullptr;
+        if (strcmp(arg, "--help") == 0 || value == nullptr) {
+            return false;
+        }
+        i++;
+        if (strcmp(arg, "--layouts") == 0) options.layouts = atoi(value);
+        else if (strcmp(arg, "--searches") == 0) options.searches = atoi(value);
+        else if (strcmp(arg, "--steps") == 0) options.steps = atoi(value);
+        else if (strcmp(arg, "--seed") == 0) options.seed = strtoul(value, nullptr, 10);
+        else return false;
+    }
+    return options.layouts > 0 && options.searches >= 0 && options.steps > 0;
+}
+
+int main(int argc, char** argv) {
+    Options options;
+    if (!parseOptions(argc, argv, options)) {
+        usage(argv[0]);
+        return 2;
+    }
+    rngState = options.seed != 0 ? (uint32_t)options.seed : 1;
+
+    std::vector<Ball> layouts((size_t)options.layouts * BALL_COUNT);
+    std::vector<float> angles(options.layouts);
+    std::vector<float> powers(options.layouts);
+    for (int l = 0; l < options.layouts; l++) {
+        randomLayout(&layouts[(size_t)l * BALL_COUNT]);
+        angles[l] = randomRange(0.0f, 6.28318531f);
+        powers[l] = randomRange(10.0f, 100.0f);
+    }
+
+    // Speed: predict() alone, then the full physics for comparison
+    BilliardShotPredictor::Prediction prediction;
+    long checksum = 0;
+    double start = nowSeconds();
+    for (int l = 0; l < options.layouts; l++) {
+        const Ball* balls = &layouts[(size_t)l * BALL_COUNT];
+        for (int k = 0; k < PREDICTIONS_PER_LAYOUT; k++) {
+            float angle = angles[l] + k * (6.28318531f / PREDICTIONS_PER_LAYOUT);
+            BilliardShotPredictor::predict(balls, CUE_INDEX, angle, powers[l], prediction);
+            checksum += prediction.objectBall + prediction.cue.count;
+        }
+    }
+    double predictSeconds = nowSeconds() - start;
+    long predictions = (long)options.layouts * PREDICTIONS_PER_LAYOUT;
+
+    std::vector<SimResult> sims(options.layouts);
+    start = nowSeconds();
+    for (int l = 0; l < options.layouts; l++) {
+        playShot(&layouts[(size_t)l * BALL_COUNT], angles[l], powers[l], sims[l]);
+    }
+    double simSeconds = nowSeconds() - start;
+
+    printf("predict:      %ld predictions in %.3f s = %.0f /s (%.2f us each, checksum %ld)\n",
+           predictions, predictSeconds, predictions / predictSeconds, predictSeconds * 1e6 / predictions, checksum);
+    printf("full physics: %d shots in %.3f s = %.1f us per shot played out\n",
+           options.layouts, simSeconds, simSeconds * 1e6 / options.layouts);
+
+    // Accuracy: the same shots through predict()
+    int contactAgree = 0, contactHits = 0, railFirstTick = 0, unsettled = 0;
+    int clean = 0, objectPotAgree = 0, objectPocketAgree = 0, scratchAgree = 0;
+    int potCallAgree = 0, predictedPots = 0, simPots = 0;
+    std::vector<float> directionErrors;
+    std::vector<float> cueRestErrors;
+    std::vector<float> objectRestErrors;
+    for (int l = 0; l < options.layouts; l++) {
+        const SimResult& sim = sims[l];
+        if (!sim.settled) unsettled++;
+        BilliardShotPredictor::predict(&layouts[(size_t)l * BALL_COUNT], CUE_INDEX, angles[l], powers[l], prediction);
+
+        bool simPot = sim.firstBall >= 0 && sim.pocketOf[sim.firstBall] >= 0 && sim.pocketOf[CUE_INDEX] < 0;
+        if (simPot) simPots++;
+        if (prediction.isPot()) predictedPots++;
+        if (simPot == prediction.isPot()) potCallAgree++;
+
+        if (prediction.objectBall != sim.firstBall) continue;
+        contactAgree++;
+        if (sim.firstBall < 0) {
+            // Nothing hit: only the cue ball's own path to check
+            if ((prediction.cue.outcome == BilliardShotPredictor::OUTCOME_POCKETED) == (sim.pocketOf[CUE_INDEX] >= 0)) {
+                scratchAgree++;
+            }
+            if (prediction.cue.outcome == BilliardShotPredictor::OUTCOME_STOPPED && sim.pocketOf[CUE_INDEX] < 0) {
+                cueRestErrors.push_back(restError(prediction.cue, sim, CUE_INDEX));
+            }
+            clean++;
+            objectPotAgree++;
+            objectPocketAgree++;
+            continue;
+        }
+        contactHits++;
+        if (sim.firstNearRail) {
+            railFirstTick++;
+        } else {
+            directionErrors.push_back(angleError(prediction.objectAngle, sim.firstAngle) * (float)RAD_TO_DEG);
+        }
+
+        // Pot / scratch / rest only mean something without chain collisions
+        if (sim.movedBalls > 1 || sim.recontact ||
+            prediction.cue.outcome == BilliardShotPredictor::OUTCOME_HIT_BALL ||
+            prediction.object.outcome == BilliardShotPredictor::OUTCOME_HIT_BALL) {
+            continue;
+        }
+        clean++;
+        int j = sim.firstBall;
+        bool predictedIn = prediction.object.outcome == BilliardShotPredictor::OUTCOME_POCKETED;
+        if (predictedIn == (sim.pocketOf[j] >= 0)) {
+            objectPotAgree++;
+            if (!predictedIn || prediction.object.pocket == sim.pocketOf[j]) objectPocketAgree++;
+        }
+        if (prediction.isScratch() == (sim.pocketOf[CUE_INDEX] >= 0)) scratchAgree++;
+        if (!predictedIn && sim.pocketOf[j] < 0) objectRestErrors.push_back(restError(prediction.object, sim, j));
+        if (!prediction.isScratch() && sim.pocketOf[CUE_INDEX] < 0) cueRestErrors.push_back(restError(prediction.cue, sim, CUE_INDEX));
+    }
+
+    printf("\naccuracy vs BilliardPhysics (%d shots, %d did not settle in %d ticks):\n",
+           options.layouts, unsettled, MAX_SHOT_TICKS);
+    printf("  first ball hit     %5.1f%% agree (%d shots touch a ball)\n",
+           100.0 * contactAgree / options.layouts, contactHits);
+    printf("  object direction   mean %.2f  p95 %.2f  max %.2f deg (%d next to a rail left out)\n",
+           mean(directionErrors),
+           percentile(directionErrors, 0.95f), percentile(directionErrors, 1.0f), railFirstTick);
+    printf("  no-chain shots     %d: object in/out %.1f%%, same pocket %.1f%%, scratch %.1f%%\n",
+           clean, clean ? 100.0 * objectPotAgree / clean : 0.0, clean ? 100.0 * objectPocketAgree / clean : 0.0,
+           clean ? 100.0 * scratchAgree / clean : 0.0);
+    printf("  rest position      cue p50 %.1f p95 %.1f px, object p50 %.1f p95 %.1f px\n",
+           percentile(cueRestErrors, 0.5f), percentile(cueRestErrors, 0.95f),
+           percentile(objectRestErrors, 0.5f), percentile(objectRestErrors, 0.95f));
+    printf("  isPot() call       %.1f%% agree (predicted %d pots, physics %d)\n",
+           100.0 * potCallAgree / options.layouts, predictedPots, simPots);
+
+    if (options.searches == 0) return 0;
+
+    // Best-shot search, and whether the chosen shot really pots
+    int searches = std::min(options.searches, options.layouts);
+    int found = 0, confirmed = 0;
+    const float power = 60.0f;
+    start = nowSeconds();
+    std::vector<float> bestAngles(searches);
+    std::vector<char> bestPots(searches);
+    for (int l = 0; l < searches; l++) {
+        bestPots[l] = BilliardShotPredictor::findBestShot(&layouts[(size_t)l * BALL_COUNT], CUE_INDEX, power,
+                                                          options.steps, prediction);
+        bestAngles[l] = prediction.angle;
+    }
+    double searchSeconds = nowSeconds() - start;
+    for (int l = 0; l < searches; l++) {
+        if (!bestPots[l]) continue;
+        found++;
+        SimResult sim;
+        playShot(&layouts[(size_t)l * BALL_COUNT], bestAngles[l], power, sim);
+        bool pot = sim.pocketOf[CUE_INDEX] < 0;
+        bool any = false;
+        for (int i = 0; i < BALL_COUNT; i++) {
+            if (i != CUE_INDEX && sim.pocketOf[i] >= 0) any = true;
+        }
+        if (pot && any) confirmed++;
+    }
+    printf("\nfindBestShot: %d searches x %d angles, %.2f ms each; pot found on %d tables, %d (%.1f%%) pot in the physics\n",
+           searches, options.steps, searchSeconds * 1e3 / searches, found, confirmed,
+           found ? 100.0 * confirmed / found : 0.0);
+    return 0;
+}
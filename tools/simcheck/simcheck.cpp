@@ -0,0 +1,582 @@
+// Float vs fixed-point cross-check for BilliardPhysics and GunnyGame.
+//
+// sim_t is picked at compile time (sim_math.h), so the two modes are two
+// builds of this program: [env:simcheck] (float) and [env:simcheck_fixed]
+// (-DSIM_FIXED_POINT). Both play the same seeded shots - random layouts with
+// a random shot, plus breaks from the rack - step by step until the table is
+// still and time the ticks. One build writes a trace (every ball's position
+// after every tick), the other replays the shots and compares:
+//   - per-step cost of both modes
+//   - divergence: largest position difference per shot, and the tick at
+//     which two runs first drift more than 1 px apart
+//   - outcome: same balls pocketed, rest positions
+// Then the real GunnyGame (on the host panel) fires every angle it can aim,
+// 30..90 in 2 degree steps, at every power from 50 to 1000 in steps of 50,
+// and the trace keeps the projectile after every step and where it landed:
+//   - divergence: largest in-flight difference, first step
+//   - impact point: distance between the two landings, same column or not,
+//     flight steps
+//
+//   pio run -e simcheck -e simcheck_fixed
+//   .pio/build/simcheck/program --write /tmp/float.trace
+//   .pio/build/simcheck_fixed/program --compare /tmp/float.trace
+//
+// The first tick of every billiard shot (launch, trig, first contact) and
+// the first step of every gunny shot must agree to a small fraction of a
+// pixel; exits non-zero if one does not.
+#include <Arduino.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <algorithm>
+#include <vector>
+#include "billiard_physics.h"
+#include "gunny_game.h"
+#include "tft_compositor.h"
+#include "hal_native.h"
+
+static const int CUE_INDEX = 0;
+static const int MAX_SHOT_TICKS = 3000;  // 60 s of table time
+static const float DRIFT_PX = 1.0f;
+static const float FIRST_TICK_TOLERANCE_PX = 0.05f;
+static const char TRACE_MAGIC[8] = {'S', 'I', 'M', 'T', 'R', 'C', '0', '2'};
+static const int GUNNY_ANGLE_STEP = 2;     // One handleAngleUp/Down
+static const int GUNNY_POWER_STEP = 50;
+static const int GUNNY_MAX_STEPS = 2000;
+
+#ifdef SIM_FIXED_POINT
+static const char* MODE_NAME = "fixed";
+#else
+static const char* MODE_NAME = "float";
+#endif
+
+struct Shot {
+    Ball layout[BALL_COUNT];
+    float angle;
+    float power;
+};
+
+// One played shot: positions after every tick, plus what went in
+struct Run {
+    std::vector<float> positions;  // ticks * BALL_COUNT * 2
+    int ticks;
+    uint16_t pocketed;             // Bit per ball
+};
+
+// One gunny shot: projectile after every step, and where it came down
+struct GunnyRun {
+    std::vector<float> path;       // steps * 2
+    int steps;
+    float impactX;
+    float impactY;
+};
+
+// ---- What hal_native.cpp provides to the app ----
+
+static unsigned long fakeMillis = 0;
+
+// GunnyGame delays after every step and on impact: game time only
+unsigned long millis() {
+    return fakeMillis;
+}
+
+void delay(uint32_t ms) {
+    fakeMillis += ms;
+}
+
+unsigned long micros() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (unsigned long)(ts.tv_sec * 1000000ULL + ts.tv_nsec / 1000);
+}
+
+EspClass ESP;
+
+uint32_t EspClass::getFreeHeap() {
+    return 400 * 1024;
+}
+
+namespace HalNative {
+double spiMegahertz() { return 0; }
+void registerPanel(Adafruit_ST7789* panel) { (void)panel; }
+}
+
+static TftCompositor tft(&SPI, -1, -1, -1);
+
+static uint32_t rngState = 1;
+
+static uint32_t nextRandom() {
+    rngState ^= rngState << 13;
+    rngState ^= rngState >> 17;
+    rngState ^= rngState << 5;
+    return rngState;
+}
+
+static float randomRange(float lo, float hi) {
+    return lo + (hi - lo) * (nextRandom() >> 8) * (1.0f / 16777216.0f);
+}
+
+static double nowSeconds() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+// Float copy of isInAttractionZone: a fixed-point test could accept a
+// different layout near the edge and shift the random sequence
+static bool nearPocket(float x, float y) {
+    float radius = (float)BilliardPhysics::getAttractionRadius();
+    for (int p = 0; p < BilliardPhysics::POCKET_COUNT; p++) {
+        sim_t px, py;
+        BilliardPhysics::getPocketPosition(p, px, py);
+        float dx = x - (float)px;
+        float dy = y - (float)py;
+        if (dx * dx + dy * dy <= radius * radius + 1.0f) return true;
+    }
+    return false;
+}
+
+// Layouts are drawn in float and only converted to sim_t when played, so
+// both builds start every shot from the same numbers
+static void randomLayout(Ball* balls) {
+    sim_t minX, minY, maxX, maxY;
+    BilliardPhysics::getCushionBounds(minX, minY, maxX, maxY);
+    const float gap = BALL_RADIUS * 2.0f + 1.0f;
+    float xs[BALL_COUNT];
+    float ys[BALL_COUNT];
+    for (int i = 0; i < BALL_COUNT; i++) {
+        bool ok;
+        do {
+            xs[i] = randomRange((float)minX, (float)maxX);
+            ys[i] = randomRange((float)minY, (float)maxY);
+            ok = !nearPocket(xs[i], ys[i]);
+            for (int j = 0; ok && j < i; j++) {
+                float dx = xs[i] - xs[j];
+                float dy = ys[i] - ys[j];
+                ok = dx * dx + dy * dy >= gap * gap;
+            }
+        } while (!ok);
+        balls[i].x = sim_t(xs[i]);
+        balls[i].y = sim_t(ys[i]);
+        balls[i].vx = sim_t(0);
+        balls[i].vy = sim_t(0);
+        balls[i].color = 0;
+        balls[i].isActive = false;
+    }
+}
+
+static void makeShots(std::vector<Shot>& shots, int layouts, int breaks) {
+    BilliardPhysics rack;
+    rack.rack();
+    const Ball* racked = rack.getBalls();
+    float apexAngle = atan2f((float)(racked[1].y - racked[CUE_INDEX].y), (float)(racked[1].x - racked[CUE_INDEX].x));
+    shots.resize(layouts + breaks);
+    for (int i = 0; i < layouts + breaks; i++) {
+        Shot& shot = shots[i];
+        if (i < layouts) {
+            randomLayout(shot.layout);
+            shot.angle = randomRange(0.0f, 6.28318531f);
+            shot.power = randomRange(10.0f, 100.0f);
+        } else {
+            memcpy(shot.layout, racked, sizeof(shot.layout));
+            shot.angle = apexAngle + randomRange(-0.052f, 0.052f);
+            shot.power = randomRange(40.0f, 100.0f);
+        }
+    }
+}
+
+// Launch exactly like BilliardGame::handleChargeRelease
+static void launch(BilliardPhysics& physics, const Shot& shot) {
+    Ball* balls = physics.getBalls();
+    for (int i = 0; i < BALL_COUNT; i++) {
+        physics.placeBall(i, shot.layout[i].x, shot.layout[i].y);
+    }
+    sim_t speed = BilliardPhysics::shotSpeed(shot.power);
+    balls[CUE_INDEX].vx = simCos(sim_t(shot.angle)) * speed;
+    balls[CUE_INDEX].vy = simSin(sim_t(shot.angle)) * speed;
+    balls[CUE_INDEX].isActive = true;
+}
+
+static void play(const Shot& shot, Run& run) {
+    BilliardPhysics physics;
+    launch(physics, shot);
+    const Ball* balls = physics.getBalls();
+    run.positions.clear();
+    run.ticks = 0;
+    run.pocketed = 0;
+    while (run.ticks < MAX_SHOT_TICKS && physics.isMoving()) {
+        physics.step();
+        run.ticks++;
+        for (int i = 0; i < BALL_COUNT; i++) {
+            run.positions.push_back((float)balls[i].x);
+            run.positions.push_back((float)balls[i].y);
+        }
+    }
+    for (int e = 0; e < physics.getPocketEventCount(); e++) {
+        run.pocketed |= (uint16_t)(1 << physics.getPocketEvent(e).ball);
+    }
+}
+
+// Pure stepping cost, nothing recorded
+static double timeTicks(const std::vector<Shot>& shots, long& ticks) {
+    BilliardPhysics physics;
+    ticks = 0;
+    double start = nowSeconds();
+    for (size_t s = 0; s < shots.size(); s++) {
+        launch(physics, shots[s]);
+        for (int t = 0; t < MAX_SHOT_TICKS && physics.isMoving(); t++) {
+            physics.step();
+            ticks++;
+        }
+    }
+    return nowSeconds() - start;
+}
+
+// GunnyGame logs every shot over Serial (stdout here): muted while they fly
+static int mutedStdout = -1;
+
+static void muteSerial(bool mute) {
+    fflush(stdout);
+    if (mute && mutedStdout < 0) {
+        mutedStdout = dup(STDOUT_FILENO);
+        FILE* devNull = fopen("/dev/null", "w");
+        if (devNull != nullptr) {
+            dup2(fileno(devNull), STDOUT_FILENO);
+            fclose(devNull);
+        }
+    } else if (!mute && mutedStdout >= 0) {
+        dup2(mutedStdout, STDOUT_FILENO);
+        close(mutedStdout);
+        mutedStdout = -1;
+    }
+}
+
+// Aim with the buttons (the game starts at 60 degrees), charge with update()
+// until power reaches the target, release and step until the shot ends
+static void playGunny(int angle, int power, GunnyRun& run) {
+    fakeMillis = 0;
+    GunnyGame game(&tft);
+    game.init();
+    for (int a = 60; a < angle; a += GUNNY_ANGLE_STEP) game.handleAngleUp();
+    for (int a = 60; a > angle; a -= GUNNY_ANGLE_STEP) game.handleAngleDown();
+    game.handleFirePress();
+    for (int p = 0; p < power; p += CHARGE_RATE) game.update();
+    game.handleFireRelease();
+
+    run.path.clear();
+    run.steps = 0;
+    while (game.getIsFiring() && run.steps < GUNNY_MAX_STEPS) {
+        game.update();
+        run.steps++;
+        if (game.getIsFiring()) {
+            run.path.push_back(game.getProjectileX());
+            run.path.push_back(game.getProjectileY());
+        }
+    }
+    game.getLastImpact(run.impactX, run.impactY);
+}
+
+static void playGunnyShots(std::vector<GunnyRun>& runs) {
+    muteSerial(true);
+    for (int angle = MIN_ANGLE; angle <= MAX_ANGLE; angle += GUNNY_ANGLE_STEP) {
+        for (int power = GUNNY_POWER_STEP; power <= MAX_POWER; power += GUNNY_POWER_STEP) {
+            runs.push_back(GunnyRun());
+            playGunny(angle, power, runs.back());
+        }
+    }
+    muteSerial(false);
+}
+
+// Trace: magic, shot count, us/tick, then per shot ticks, pocketed, positions;
+// then gunny shot count and per shot steps, impact, path
+static bool writeTrace(const char* path, const std::vector<Run>& runs, double usPerTick,
+                       const std::vector<GunnyRun>& gunny) {
+    FILE* f = fopen(path, "wb");
+    if (f == nullptr) {
+        perror(path);
+        return false;
+    }
+    uint32_t count = (uint32_t)runs.size();
+    fwrite(TRACE_MAGIC, 1, sizeof(TRACE_MAGIC), f);
+    fwrite(&count, sizeof(count), 1, f);
+    fwrite(&usPerTick, sizeof(usPerTick), 1, f);
+    for (const Run& run : runs) {
+        int32_t ticks = run.ticks;
+        fwrite(&ticks, sizeof(ticks), 1, f);
+        fwrite(&run.pocketed, sizeof(run.pocketed), 1, f);
+        fwrite(run.positions.data(), sizeof(float), run.positions.size(), f);
+    }
+    count = (uint32_t)gunny.size();
+    fwrite(&count, sizeof(count), 1, f);
+    for (const GunnyRun& run : gunny) {
+        int32_t steps = run.steps;
+        uint32_t points = (uint32_t)run.path.size() / 2;
+        fwrite(&steps, sizeof(steps), 1, f);
+        fwrite(&run.impactX, sizeof(float), 1, f);
+        fwrite(&run.impactY, sizeof(float), 1, f);
+        fwrite(&points, sizeof(points), 1, f);
+        fwrite(run.path.data(), sizeof(float), run.path.size(), f);
+    }
+    return fclose(f) == 0;
+}
+
+static bool readTrace(const char* path, std::vector<Run>& runs, double& usPerTick, std::vector<GunnyRun>& gunny) {
+    FILE* f = fopen(path, "rb");
+    if (f == nullptr) {
+        perror(path);
+        return false;
+    }
+    char magic[sizeof(TRACE_MAGIC)];
+    uint32_t count = 0;
+    bool ok = fread(magic, 1, sizeof(magic), f) == sizeof(magic) && memcmp(magic, TRACE_MAGIC, sizeof(magic)) == 0 &&
+              fread(&count, sizeof(count), 1, f) == 1 && fread(&usPerTick, sizeof(usPerTick), 1, f) == 1;
+    runs.resize(ok ? count : 0);
+    for (uint32_t s = 0; ok && s < count; s++) {
+        Run& run = runs[s];
+        int32_t ticks = 0;
+        ok = fread(&ticks, sizeof(ticks), 1, f) == 1 && fread(&run.pocketed, sizeof(run.pocketed), 1, f) == 1 &&
+             ticks >= 0 && ticks <= MAX_SHOT_TICKS;
+        if (!ok) break;
+        run.ticks = ticks;
+        run.positions.resize((size_t)ticks * BALL_COUNT * 2);
+        ok = fread(run.positions.data(), sizeof(float), run.positions.size(), f) == run.positions.size();
+    }
+    ok = ok && fread(&count, sizeof(count), 1, f) == 1;
+    gunny.resize(ok ? count : 0);
+    for (uint32_t s = 0; ok && s < count; s++) {
+        GunnyRun& run = gunny[s];
+        int32_t steps = 0;
+        uint32_t points = 0;
+        ok = fread(&steps, sizeof(steps), 1, f) == 1 && fread(&run.impactX, sizeof(float), 1, f) == 1 &&
+             fread(&run.impactY, sizeof(float), 1, f) == 1 && fread(&points, sizeof(points), 1, f) == 1 &&
+             steps >= 0 && steps <= GUNNY_MAX_STEPS && points <= (uint32_t)steps;
+        if (!ok) break;
+        run.steps = steps;
+        run.path.resize((size_t)points * 2);
+        ok = fread(run.path.data(), sizeof(float), run.path.size(), f) == run.path.size();
+    }
+    fclose(f);
+    if (!ok) {
+        fprintf(stderr, "%s: not a simcheck trace\n", path);
+    }
+    return ok;
+}
+
+// Position of ball i after tick t; past the end the ball stays where it stopped
+static void positionAt(const Run& run, int t, int i, float& x, float& y) {
+    if (run.ticks == 0) {
+        x = y = 0.0f;
+        return;
+    }
+    if (t >= run.ticks) t = run.ticks - 1;
+    x = run.positions[((size_t)t * BALL_COUNT + i) * 2];
+    y = run.positions[((size_t)t * BALL_COUNT + i) * 2 + 1];
+}
+
+// A pocketed ball sits at (-100, -100): distance to it counts as the table size
+// Projectile after step t; past the end it stays where it was last seen
+static void gunnyAt(const GunnyRun& run, int t, float& x, float& y) {
+    size_t points = run.path.size() / 2;
+    if (points == 0) {
+        x = y = 0.0f;
+        return;
+    }
+    if ((size_t)t >= points) t = (int)points - 1;
+    x = run.path[(size_t)t * 2];
+    y = run.path[(size_t)t * 2 + 1];
+}
+
+static float ballDistance(float ax, float ay, float bx, float by) {
+    if ((ax < 0.0f) != (bx < 0.0f)) return (float)TABLE_WIDTH;
+    if (ax < 0.0f) return 0.0f;
+    return sqrtf((ax - bx) * (ax - bx) + (ay - by) * (ay - by));
+}
+
+static float percentile(std::vector<float> values, float p) {
+    if (values.empty()) return 0.0f;
+    std::sort(values.begin(), values.end());
+    return values[(size_t)(p * (values.size() - 1) + 0.5f)];
+}
+
+static bool check(bool condition, const char* what) {
+    printf("  %-60s %s\n", what, condition ? "ok" : "FAILED");
+    return condition;
+}
+
+int main(int argc, char** argv) {
+    int layouts = 2000;
+    int breaks = 500;
+    const char* writePath = nullptr;
+    const char* comparePath = nullptr;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--layouts") == 0 && i + 1 < argc) {
+            layouts = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--breaks") == 0 && i + 1 < argc) {
+            breaks = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--write") == 0 && i + 1 < argc) {
+            writePath = argv[++i];
+        } else if (strcmp(argv[i], "--compare") == 0 && i + 1 < argc) {
+            comparePath = argv[++i];
+        } else {
+            printf("Usage: %s [--layouts N] [--breaks N] [--write TRACE | --compare TRACE]\n", argv[0]);
+            return 2;
+        }
+    }
+    if (layouts < 0) layouts = 0;
+    if (breaks < 0) breaks = 0;
+
+    std::vector<Shot> shots;
+    makeShots(shots, layouts, breaks);
+    if (shots.empty()) return 0;
+
+    // Best of 3 for the cost, the host is not idle
+    long ticks = 0;
+    double best = 1e30;
+    for (int r = 0; r < 3; r++) {
+        best = std::min(best, timeTicks(shots, ticks));
+    }
+    double usPerTick = best * 1e6 / ticks;
+    printf("%s: %d layouts + %d breaks, %ld ticks, %.3f us/tick (%.0f ticks/s)\n", MODE_NAME, layouts, breaks,
+           ticks, usPerTick, 1e6 / usPerTick);
+
+    std::vector<Run> runs(shots.size());
+    for (size_t s = 0; s < shots.size(); s++) {
+        play(shots[s], runs[s]);
+    }
+    tft.init(240, 320);
+    tft.setRotation(1);
+    std::vector<GunnyRun> gunny;
+    playGunnyShots(gunny);
+    printf("%s: %u gunny shots, angles %d..%d step %d, powers %d..%d step %d\n", MODE_NAME, (unsigned)gunny.size(),
+           MIN_ANGLE, MAX_ANGLE, GUNNY_ANGLE_STEP, GUNNY_POWER_STEP, MAX_POWER, GUNNY_POWER_STEP);
+    if (writePath != nullptr) {
+        return writeTrace(writePath, runs, usPerTick, gunny) ? 0 : 1;
+    }
+    if (comparePath == nullptr) {
+        return 0;
+    }
+
+    std::vector<Run> other;
+    std::vector<GunnyRun> otherGunny;
+    double otherUsPerTick = 0;
+    if (!readTrace(comparePath, other, otherUsPerTick, otherGunny)) {
+        return 1;
+    }
+    if (other.size() != runs.size() || otherGunny.size() != gunny.size()) {
+        fprintf(stderr, "%s has %u shots, expected %u (same --layouts/--breaks?)\n", comparePath,
+                (unsigned)other.size(), (unsigned)runs.size());
+        return 1;
+    }
+
+    std::vector<float> firstTick;
+    std::vector<float> maxDivergence;
+    std::vector<float> driftTicks;
+    std::vector<float> restErrors;
+    std::vector<float> tickDelta;
+    int drifted = 0;
+    int samePockets = 0;
+    int samePocketsBreaks = 0;
+    for (size_t s = 0; s < runs.size(); s++) {
+        const Run& a = runs[s];
+        const Run& b = other[s];
+        int span = std::max(a.ticks, b.ticks);
+        float worst = 0.0f;
+        int drift = -1;
+        for (int t = 0; t < span; t++) {
+            float tickWorst = 0.0f;
+            for (int i = 0; i < BALL_COUNT; i++) {
+                float ax, ay, bx, by;
+                positionAt(a, t, i, ax, ay);
+                positionAt(b, t, i, bx, by);
+                tickWorst = std::max(tickWorst, ballDistance(ax, ay, bx, by));
+            }
+            if (t == 0) firstTick.push_back(tickWorst);
+            if (drift < 0 && tickWorst > DRIFT_PX) drift = t;
+            worst = std::max(worst, tickWorst);
+        }
+        maxDivergence.push_back(worst);
+        if (drift >= 0) {
+            drifted++;
+            driftTicks.push_back((float)drift);
+        }
+        if (a.pocketed == b.pocketed) {
+            samePockets++;
+            if ((int)s >= layouts) samePocketsBreaks++;
+            for (int i = 0; i < BALL_COUNT; i++) {
+                float ax, ay, bx, by;
+                positionAt(a, span, i, ax, ay);
+                positionAt(b, span, i, bx, by);
+                if (ax >= 0.0f) restErrors.push_back(ballDistance(ax, ay, bx, by));
+            }
+        }
+        tickDelta.push_back((float)abs(a.ticks - b.ticks));
+    }
+
+    std::vector<float> gunnyFirstStep;
+    std::vector<float> gunnyDivergence;
+    std::vector<float> impactErrors;
+    std::vector<float> stepDelta;
+    int sameColumn = 0;
+    for (size_t s = 0; s < gunny.size(); s++) {
+        const GunnyRun& a = gunny[s];
+        const GunnyRun& b = otherGunny[s];
+        int span = (int)std::max(a.path.size(), b.path.size()) / 2;
+        float worst = 0.0f;
+        for (int t = 0; t < span; t++) {
+            float ax, ay, bx, by;
+            gunnyAt(a, t, ax, ay);
+            gunnyAt(b, t, bx, by);
+            float d = sqrtf((ax - bx) * (ax - bx) + (ay - by) * (ay - by));
+            if (t == 0) gunnyFirstStep.push_back(d);
+            worst = std::max(worst, d);
+        }
+        gunnyDivergence.push_back(worst);
+        float dx = a.impactX - b.impactX;
+        float dy = a.impactY - b.impactY;
+        impactErrors.push_back(sqrtf(dx * dx + dy * dy));
+        if ((int)a.impactX == (int)b.impactX) sameColumn++;
+        stepDelta.push_back((float)abs(a.steps - b.steps));
+    }
+
+    int total = (int)runs.size();
+    printf("\ncost per tick: %s %.3f us, trace %.3f us (%+.1f%%)\n", MODE_NAME, usPerTick, otherUsPerTick,
+           100.0 * (usPerTick - otherUsPerTick) / otherUsPerTick);
+    printf("divergence vs %s:\n", comparePath);
+    printf("  after tick 1        p50 %.4f  max %.4f px\n", percentile(firstTick, 0.5f), percentile(firstTick, 1.0f));
+    printf("  over the shot       p50 %.2f  p95 %.2f  max %.2f px\n", percentile(maxDivergence, 0.5f),
+           percentile(maxDivergence, 0.95f), percentile(maxDivergence, 1.0f));
+    printf("  drift > %.0f px       %d of %d shots (%.1f%%), first at tick p50 %.0f  p5 %.0f\n", DRIFT_PX, drifted,
+           total, 100.0 * drifted / total, percentile(driftTicks, 0.5f), percentile(driftTicks, 0.05f));
+    printf("  same balls pocketed %d of %d shots (%.1f%%; breaks %d of %d)\n", samePockets, total,
+           100.0 * samePockets / total, samePocketsBreaks, breaks);
+    printf("  rest position       p50 %.2f  p95 %.2f px (shots with the same pockets)\n",
+           percentile(restErrors, 0.5f), percentile(restErrors, 0.95f));
+    printf("  ticks to settle     differ by p50 %.0f  max %.0f\n", percentile(tickDelta, 0.5f),
+           percentile(tickDelta, 1.0f));
+
+    int gunnyTotal = (int)gunny.size();
+    printf("gunny vs %s (%d shots):\n", comparePath, gunnyTotal);
+    printf("  after step 1        p50 %.4f  max %.4f px\n", percentile(gunnyFirstStep, 0.5f),
+           percentile(gunnyFirstStep, 1.0f));
+    printf("  over the flight     p50 %.3f  p95 %.3f  max %.3f px\n", percentile(gunnyDivergence, 0.5f),
+           percentile(gunnyDivergence, 0.95f), percentile(gunnyDivergence, 1.0f));
+    printf("  impact point        p50 %.3f  p95 %.3f  max %.3f px\n", percentile(impactErrors, 0.5f),
+           percentile(impactErrors, 0.95f), percentile(impactErrors, 1.0f));
+    printf("  same impact column  %d of %d shots (%.1f%%)\n", sameColumn, gunnyTotal,
+           100.0 * sameColumn / gunnyTotal);
+    printf("  flight steps        differ by p50 %.0f  max %.0f\n", percentile(stepDelta, 0.5f),
+           percentile(stepDelta, 1.0f));
+
+    printf("\nChecks:\n");
+    char label[96];
+    bool ok = true;
+    snprintf(label, sizeof(label), "every shot agrees within %.2f px after the first tick", FIRST_TICK_TOLERANCE_PX);
+    ok &= check(percentile(firstTick, 1.0f) <= FIRST_TICK_TOLERANCE_PX, label);
+    snprintf(label, sizeof(label), "every gunny shot agrees within %.2f px after the first step",
+             FIRST_TICK_TOLERANCE_PX);
+    ok &= check(percentile(gunnyFirstStep, 1.0f) <= FIRST_TICK_TOLERANCE_PX, label);
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,329 @@
+// Break shot cost of the billiard renderer: per-pixel erase + fillCircle
+// (-DBILLIARD_SPRITES=0) vs sprite tiles over the cached table (the
+// default), each drawn directly and through TftCompositor, on the host panel
+// (hal/native Adafruit_ST7789 counts every setAddrWindow; with a bus speed
+// set, every command and pixel byte costs the time that bus takes).
+//
+// The renderer is picked at compile time, so the two are two builds:
+// [env:spritebench] and [env:spritebench_legacy]. Both play the same break:
+// aimAtNearestBall, 60 frames of charge, release, then update() + draw()
+// every 16 ms of game time until the balls stop (at most 600 frames). Each
+// break runs on a free bus and on a --spi-mhz bus; per frame it prints SPI
+// windows and the time update() + draw() took (avg / max).
+//
+//   pio run -e spritebench -e spritebench_legacy
+//   .pio/build/spritebench_legacy/program --write /tmp/per-pixel.txt
+//   .pio/build/spritebench/program --compare /tmp/per-pixel.txt
+//
+// --write saves this build's rows, --compare prints a saved build's rows
+// above this one's. Checks: the break ends, direct and compositor leave the
+// same balls (and, for sprites, identical panels); with --compare, the same
+// balls as the other build and, for sprites, fewer windows per frame than
+// per-pixel on both paths. Exits non-zero if one fails.
+#include <Arduino.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <string>
+#include <vector>
+#include "tft_compositor.h"
+#include "billiard_game.h"
+#include "socket_manager.h"
+#include "hal_native.h"
+
+// ---- What hal_native.cpp provides to the app ----
+
+static unsigned long fakeMillis = 0;
+static double spiMhz = 0;
+
+// Simulated clock for game timing; micros() is real for the frame timers
+unsigned long millis() {
+    return fakeMillis;
+}
+
+void delay(uint32_t ms) {
+    fakeMillis += ms;
+}
+
+unsigned long micros() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (unsigned long)(ts.tv_sec * 1000000ULL + ts.tv_nsec / 1000);
+}
+
+EspClass ESP;
+
+uint32_t EspClass::getFreeHeap() {
+    return 400 * 1024;  // Room for the shadow: the compositor always starts
+}
+
+namespace HalNative {
+double spiMegahertz() { return spiMhz; }
+void registerPanel(Adafruit_ST7789* panel) { (void)panel; }
+}
+
+// BilliardGame only talks to the socket when started online
+bool SocketManager::sendBilliardShot(int sessionId, int seq, uint32_t tick, int32_t angle, int power, uint32_t hash) {
+    (void)sessionId; (void)seq; (void)tick; (void)angle; (void)power; (void)hash;
+    return false;
+}
+
+bool SocketManager::sendBilliardSync(int sessionId, int seq, const String& snapshot) {
+    (void)sessionId; (void)seq; (void)snapshot;
+    return false;
+}
+
+// ---- Break shot ----
+
+#if BILLIARD_SPRITES
+static const char* RENDERER = "sprites";
+#else
+static const char* RENDERER = "per-pixel";
+#endif
+
+static const int CHARGE_FRAMES = 60;
+static const int MAX_FRAMES = 600;
+static const unsigned long FRAME_MS = 16;
+
+static TftCompositor tft(&SPI, -1, -1, -1);
+
+struct Row {
+    std::string renderer;
+    std::string path;           // "direct" or "compositor"
+    int frames;                 // After the release
+    double windowsAvg;
+    uint32_t windowsMax;
+    double freeAvg;             // us per frame, free bus
+    unsigned long freeMax;
+    double busAvg;              // us per frame, --spi-mhz bus
+    unsigned long busMax;
+    int ballsLeft;
+};
+
+struct Break {
+    int frames;
+    uint64_t windows;
+    uint32_t windowsMax;
+    uint64_t micros;
+    unsigned long microsMax;
+    int ballsLeft;
+    bool stopped;
+};
+
+static Break playBreak(bool compositing, const char* ppmPath) {
+    fakeMillis = 0;
+    if (compositing) {
+        tft.beginCompositing();
+    }
+    tft.fillScreen(0x0000);
+
+    Break result = {0, 0, 0, 0, 0, 0, false};
+    BilliardGame game(&tft);
+    game.init();
+    game.aimAtNearestBall();
+    game.draw();
+    game.handleChargeStart();
+    for (int i = 0; i < CHARGE_FRAMES; i++) {
+        fakeMillis += FRAME_MS;
+        game.update();
+        game.draw();
+    }
+    game.handleChargeRelease();
+
+    while (result.frames < MAX_FRAMES && !result.stopped) {
+        fakeMillis += FRAME_MS;
+        uint32_t windowsBefore = tft.getWindows();
+        unsigned long start = micros();
+        game.update();
+        game.draw();
+        unsigned long elapsed = micros() - start;
+        uint32_t windows = tft.getWindows() - windowsBefore;
+        result.frames++;
+        result.windows += windows;
+        result.micros += elapsed;
+        if (windows > result.windowsMax) result.windowsMax = windows;
+        if (elapsed > result.microsMax) result.microsMax = elapsed;
+        result.stopped = game.getIsAiming();
+    }
+    result.ballsLeft = game.countActiveBalls();
+
+    if (ppmPath != nullptr) {
+        tft.writePpm(ppmPath);
+    }
+    tft.endCompositing();
+    return result;
+}
+
+static Row measure(bool compositing, double busMhz, const char* ppmPath, bool& stopped, bool& sameBalls) {
+    spiMhz = 0;
+    Break free = playBreak(compositing, ppmPath);
+    spiMhz = busMhz;
+    Break bus = playBreak(compositing, nullptr);
+    spiMhz = 0;
+
+    stopped = free.stopped && bus.stopped;
+    sameBalls = free.ballsLeft == bus.ballsLeft && free.frames == bus.frames;
+    Row row;
+    row.renderer = RENDERER;
+    row.path = compositing ? "compositor" : "direct";
+    row.frames = free.frames;
+    row.windowsAvg = (double)free.windows / free.frames;
+    row.windowsMax = free.windowsMax;
+    row.freeAvg = (double)free.micros / free.frames;
+    row.freeMax = free.microsMax;
+    row.busAvg = (double)bus.micros / bus.frames;
+    row.busMax = bus.microsMax;
+    row.ballsLeft = free.ballsLeft;
+    return row;
+}
+
+static void printRow(const Row& row) {
+    std::string name = row.renderer + ", " + row.path;
+    printf("%-22s %6d  %7.1f / %-5u  %6.0f / %-6lu  %7.0f / %-6lu  %5d\n", name.c_str(), row.frames,
+           row.windowsAvg, row.windowsMax, row.freeAvg, row.freeMax, row.busAvg, row.busMax, row.ballsLeft);
+}
+
+static bool writeRows(const char* path, const Row* rows, int count) {
+    FILE* out = fopen(path, "w");
+    if (out == nullptr) {
+        return false;
+    }
+    for (int i = 0; i < count; i++) {
+        const Row& r = rows[i];
+        fprintf(out, "%s %s %d %.3f %u %.3f %lu %.3f %lu %d\n", r.renderer.c_str(), r.path.c_str(), r.frames,
+                r.windowsAvg, r.windowsMax, r.freeAvg, r.freeMax, r.busAvg, r.busMax, r.ballsLeft);
+    }
+    fclose(out);
+    return true;
+}
+
+static bool readRows(const char* path, std::vector<Row>& rows) {
+    FILE* in = fopen(path, "r");
+    if (in == nullptr) {
+        return false;
+    }
+    char renderer[32];
+    char rowPath[32];
+    Row r;
+    while (fscanf(in, "%31s %31s %d %lf %u %lf %lu %lf %lu %d", renderer, rowPath, &r.frames, &r.windowsAvg,
+                  &r.windowsMax, &r.freeAvg, &r.freeMax, &r.busAvg, &r.busMax, &r.ballsLeft) == 10) {
+        r.renderer = renderer;
+        r.path = rowPath;
+        rows.push_back(r);
+    }
+    fclose(in);
+    return !rows.empty();
+}
+
+#if BILLIARD_SPRITES
+static bool sameFile(const char* a, const char* b) {
+    FILE* fa = fopen(a, "rb");
+    FILE* fb = fopen(b, "rb");
+    bool same = fa != nullptr && fb != nullptr;
+    while (same) {
+        int ca = fgetc(fa);
+        int cb = fgetc(fb);
+        same = (ca == cb);
+        if (ca == EOF || cb == EOF) break;
+    }
+    if (fa) fclose(fa);
+    if (fb) fclose(fb);
+    return same;
+}
+#endif
+
+static bool check(bool condition, const char* what) {
+    printf("  %-64s %s\n", what, condition ? "ok" : "FAILED");
+    return condition;
+}
+
+int main(int argc, char** argv) {
+    double busMhz = 27;
+    const char* writePath = nullptr;
+    const char* comparePath = nullptr;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--spi-mhz") == 0 && i + 1 < argc) {
+            busMhz = atof(argv[++i]);
+        } else if (strcmp(argv[i], "--write") == 0 && i + 1 < argc) {
+            writePath = argv[++i];
+        } else if (strcmp(argv[i], "--compare") == 0 && i + 1 < argc) {
+            comparePath = argv[++i];
+        } else {
+            printf("Usage: %s [--spi-mhz 27] [--write FILE] [--compare FILE]\n", argv[0]);
+            return 2;
+        }
+    }
+    if (busMhz <= 0) {
+        printf("Usage: %s [--spi-mhz 27] [--write FILE] [--compare FILE]\n", argv[0]);
+        return 2;
+    }
+    std::vector<Row> other;
+    if (comparePath != nullptr && !readRows(comparePath, other)) {
+        printf("Can't read %s\n", comparePath);
+        return 2;
+    }
+
+    tft.init(240, 320);
+    tft.setRotation(1);
+
+    char dir[] = "/tmp/spritebench.XXXXXX";
+    if (mkdtemp(dir) == nullptr) {
+        perror("mkdtemp");
+        return 1;
+    }
+    std::string directPpm = std::string(dir) + "/direct.ppm";
+    std::string compositorPpm = std::string(dir) + "/compositor.ppm";
+
+    bool directStopped;
+    bool directSame;
+    bool compositorStopped;
+    bool compositorSame;
+    Row rows[2];
+    rows[0] = measure(false, busMhz, directPpm.c_str(), directStopped, directSame);
+    rows[1] = measure(true, busMhz, compositorPpm.c_str(), compositorStopped, compositorSame);
+
+    printf("Break shot, per frame after the release (avg / max); bus = %.0f MHz SPI sink\n\n", busMhz);
+    printf("%-22s %6s  %15s  %15s  %16s  %5s\n", "renderer, path", "frames", "SPI windows", "us, free bus",
+           "us, bus", "balls");
+    for (const Row& row : other) {
+        printRow(row);
+    }
+    for (const Row& row : rows) {
+        printRow(row);
+    }
+
+    printf("\nChecks:\n");
+    bool ok = true;
+    ok &= check(directStopped && compositorStopped, "the break ends within 600 frames");
+    ok &= check(directSame && compositorSame && rows[0].ballsLeft == rows[1].ballsLeft,
+                "same balls left direct, compositor, free bus and slow bus");
+#if BILLIARD_SPRITES
+    ok &= check(sameFile(directPpm.c_str(), compositorPpm.c_str()), "sprites: direct and compositor panels identical");
+#endif
+    if (!other.empty()) {
+        bool sameBalls = true;
+        for (const Row& row : other) {
+            sameBalls &= row.ballsLeft == rows[0].ballsLeft;
+        }
+        ok &= check(sameBalls, "same balls left as the other build");
+#if BILLIARD_SPRITES
+        // other holds the per-pixel rows, direct then compositor
+        bool fewer = other.size() == 2;
+        for (size_t i = 0; i < other.size() && i < 2; i++) {
+            fewer &= other[i].renderer == "per-pixel" && rows[i].windowsAvg < other[i].windowsAvg;
+        }
+        ok &= check(fewer, "sprites: fewer SPI windows per frame than per-pixel, both paths");
+#endif
+    }
+
+    if (writePath != nullptr && !writeRows(writePath, rows, 2)) {
+        printf("Can't write %s\n", writePath);
+        ok = false;
+    }
+    remove(directPpm.c_str());
+    remove(compositorPpm.c_str());
+    rmdir(dir);
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,360 @@
+// Two-thread stress test for SpscRing and SocketEventQueue: one producer
+// thread pushes --events numbered events while the main thread drains
+// them, both as fast as they can.
+//
+//   ring         - SpscRing<uint32_t, 32> alone, producer retries when full
+//   queue retry  - SocketEventQueue, chat-like events with 0-3 strings of
+//                  0-96 bytes (the text ring wraps constantly), producer
+//                  retries when full
+//   queue drop   - the same, but a full queue drops the event like the
+//                  socket task does for typing and presence, the producer
+//                  yields after every --burst events (one batch frame's
+//                  worth) so the consumer gets a turn even on one core, and
+//                  the consumer stalls 2 ms every --stall-every events (a
+//                  slow redraw)
+//   queue hold   - the same bursts and stalls through pushOrHold(), as the
+//                  socket task sends chat: a full queue holds the event,
+//                  retryHeld() runs after each burst (one socket tick);
+//                  only a full hold drops
+//
+// Every event carries its number (and, in the queue modes, strings and
+// values derived from it), so the consumer can count lost, duplicated,
+// out-of-order and corrupt events. A dropped event is only lost if push()
+// didn't report it. Prints events/s per mode; exits non-zero if any event
+// is lost, duplicated, reordered or corrupt. A last single-thread case
+// stalls the consumer for exactly a full queue plus HOLD_CAPACITY: only the
+// event after that may be refused, and the rest must come out in order.
+//
+// On one core the threads take turns at preemption, so the ring is mostly
+// full or empty; several cores exercise the real races. Add
+// -fsanitize=thread to build_flags (and a smaller --events) to check the
+// memory ordering.
+//
+//   pio run -e spscstress
+//   .pio/build/spscstress/program [--events 5000000] [--burst 8] [--stall-every 50000]
+#include <Arduino.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <vector>
+#include "socket_event_queue.h"
+#include "spsc_ring.h"
+
+// ---- What hal_native.cpp provides to the app ----
+
+unsigned long millis() {
+    return (unsigned long)std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+void delay(uint32_t ms) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(ms));
+}
+
+// ---- Events ----
+
+static const int MAX_BODY = 96;
+
+static double nowSeconds() {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+static bool check(bool condition, const char* what) {
+    printf("  %-60s %s\n", what, condition ? "ok" : "FAILED");
+    return condition;
+}
+
+// Strings of event n: count, lengths and bytes all follow from n
+static int textCountOf(uint32_t n) {
+    return (int)(n % 4);
+}
+
+static void makeText(uint32_t n, int i, String& out) {
+    int length = (int)((n * 7 + i * 31) % (MAX_BODY + 1));
+    char body[MAX_BODY + 1];
+    for (int c = 0; c < length; c++) {
+        body[c] = (char)('a' + (n + i + c) % 26);
+    }
+    body[length] = '\0';
+    out = body;
+}
+
+static void makeEvent(uint32_t n, SocketEvent& event) {
+    event = SocketEvent(SocketEvent::CHAT_MESSAGE);
+    event.textCount = (uint8_t)textCountOf(n);
+    for (int v = 0; v < SocketEvent::MAX_VALUES; v++) {
+        event.values[v] = (int32_t)(n ^ (0x9E3779B9u * (uint32_t)(v + 1)));
+    }
+}
+
+static bool intact(const SocketEvent& event, const String* texts, uint32_t n) {
+    if (event.kind != SocketEvent::CHAT_MESSAGE || event.textCount != textCountOf(n)) {
+        return false;
+    }
+    for (int v = 0; v < SocketEvent::MAX_VALUES; v++) {
+        if (event.values[v] != (int32_t)(n ^ (0x9E3779B9u * (uint32_t)(v + 1)))) {
+            return false;
+        }
+    }
+    String want;
+    for (int i = 0; i < event.textCount; i++) {
+        makeText(n, i, want);
+        if (texts[i] != want) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// ---- Runs ----
+
+struct Tally {
+    std::vector<uint8_t> seen;       // Times each event number came out
+    std::vector<uint8_t> dropped;    // push() said no (drop mode)
+    long reordered;
+    long corrupt;
+    double seconds;
+
+    explicit Tally(uint32_t events) : seen(events, 0), dropped(events, 0), reordered(0), corrupt(0), seconds(0) {}
+
+    void take(uint32_t n, uint32_t& last, bool first) {
+        if (n >= seen.size()) {
+            corrupt++;
+            return;
+        }
+        if (!first && n <= last) {
+            reordered++;
+        }
+        last = n;
+        if (seen[n] < 255) seen[n]++;
+    }
+};
+
+static void runRing(Tally& tally, uint32_t events) {
+    SpscRing<uint32_t, 32> ring;
+    std::atomic<bool> done(false);
+    double start = nowSeconds();
+
+    std::thread producer([&]() {
+        for (uint32_t n = 0; n < events; n++) {
+            while (!ring.push(n)) {
+                std::this_thread::yield();
+            }
+        }
+        done.store(true, std::memory_order_release);
+    });
+
+    uint32_t last = 0;
+    bool first = true;
+    uint32_t n;
+    for (;;) {
+        if (ring.pop(n)) {
+            tally.take(n, last, first);
+            first = false;
+        } else if (done.load(std::memory_order_acquire) && ring.empty()) {
+            break;
+        } else {
+            std::this_thread::yield();
+        }
+    }
+    producer.join();
+    tally.seconds = nowSeconds() - start;
+}
+
+enum QueueMode { QUEUE_RETRY, QUEUE_DROP, QUEUE_HOLD };
+
+static void runQueue(Tally& tally, uint32_t events, QueueMode mode, uint32_t burst, uint32_t stallEvery,
+                     SocketEventQueue::Stats& stats) {
+    SocketEventQueue queue;
+    std::atomic<bool> done(false);
+    double start = nowSeconds();
+
+    std::thread producer([&]() {
+        SocketEvent event;
+        String texts[SocketEvent::MAX_TEXTS];
+        const String* pointers[SocketEvent::MAX_TEXTS];
+        for (int i = 0; i < SocketEvent::MAX_TEXTS; i++) {
+            pointers[i] = &texts[i];
+        }
+        for (uint32_t n = 0; n < events; n++) {
+            for (int i = 0; i < textCountOf(n); i++) {
+                makeText(n, i, texts[i]);
+            }
+            for (;;) {
+                makeEvent(n, event);
+                if (mode == QUEUE_HOLD ? queue.pushOrHold(event, pointers) : queue.push(event, pointers)) {
+                    break;
+                }
+                if (mode != QUEUE_RETRY) {
+                    tally.dropped[n] = 1;
+                    break;
+                }
+                std::this_thread::yield();
+            }
+            if (burst > 0 && n % burst == burst - 1) {
+                if (mode == QUEUE_HOLD) {
+                    queue.retryHeld();
+                }
+                std::this_thread::yield();
+            }
+        }
+        while (queue.heldCount() > 0) {
+            queue.retryHeld();
+            std::this_thread::yield();
+        }
+        done.store(true, std::memory_order_release);
+    });
+
+    SocketEvent event;
+    String texts[SocketEvent::MAX_TEXTS];
+    uint32_t last = 0;
+    bool first = true;
+    uint32_t popped = 0;
+    for (;;) {
+        if (queue.pop(event, texts)) {
+            uint32_t n = (uint32_t)event.values[0] ^ 0x9E3779B9u;
+            if (n < events && !intact(event, texts, n)) {
+                tally.corrupt++;
+            }
+            tally.take(n, last, first);
+            first = false;
+            if (stallEvery > 0 && ++popped % stallEvery == 0) {
+                std::this_thread::sleep_for(std::chrono::milliseconds(2));
+            }
+        } else if (done.load(std::memory_order_acquire) && queue.size() == 0) {
+            break;
+        } else {
+            std::this_thread::yield();
+        }
+    }
+    producer.join();
+    tally.seconds = nowSeconds() - start;
+    stats = queue.getStats();
+}
+
+static bool holdScript() {
+    SocketEventQueue queue;
+    SocketEvent event;
+    String texts[SocketEvent::MAX_TEXTS];
+    const String* pointers[SocketEvent::MAX_TEXTS];
+    for (int i = 0; i < SocketEvent::MAX_TEXTS; i++) {
+        pointers[i] = &texts[i];
+    }
+
+    // Consumer stalled: fill the queue (events or text), then the hold
+    uint32_t sent = 0;
+    bool refusedEarly = false;
+    for (;;) {
+        for (int i = 0; i < textCountOf(sent); i++) {
+            makeText(sent, i, texts[i]);
+        }
+        makeEvent(sent, event);
+        bool accepted = queue.pushOrHold(event, pointers);
+        if (!accepted) {
+            refusedEarly = queue.heldCount() < SocketEventQueue::HOLD_CAPACITY;
+            break;
+        }
+        sent++;
+    }
+
+    // Main loop catches up, the socket task ticks
+    uint32_t received = 0;
+    bool inOrder = true;
+    for (int round = 0; round < 4; round++) {
+        while (queue.pop(event, texts)) {
+            uint32_t n = (uint32_t)event.values[0] ^ 0x9E3779B9u;
+            inOrder &= n == received && intact(event, texts, n);
+            received++;
+        }
+        queue.retryHeld();
+    }
+    return !refusedEarly && received == sent && inOrder && queue.heldCount() == 0 &&
+           queue.getStats().held == SocketEventQueue::HOLD_CAPACITY;
+}
+
+static bool report(const char* name, const Tally& tally, uint32_t events, bool drops) {
+    long lost = 0;
+    long duplicated = 0;
+    long droppedCount = 0;
+    long droppedButSeen = 0;
+    for (uint32_t n = 0; n < events; n++) {
+        if (tally.dropped[n]) {
+            droppedCount++;
+            if (tally.seen[n]) droppedButSeen++;
+        } else if (tally.seen[n] == 0) {
+            lost++;
+        }
+        if (tally.seen[n] > 1) {
+            duplicated += tally.seen[n] - 1;
+        }
+    }
+    printf("%-12s %9u events in %6.2f s  %6.2f M events/s  dropped %ld (%.2f%%)\n", name, events, tally.seconds,
+           events / tally.seconds / 1e6, droppedCount, 100.0 * droppedCount / events);
+    if (lost + duplicated + tally.reordered + tally.corrupt + droppedButSeen > 0) {
+        printf("    lost %ld, duplicated %ld, out of order %ld, corrupt %ld, dropped yet delivered %ld\n", lost,
+               duplicated, tally.reordered, tally.corrupt, droppedButSeen);
+    }
+    bool ok = lost == 0 && duplicated == 0 && tally.reordered == 0 && tally.corrupt == 0 && droppedButSeen == 0;
+    return drops ? ok : ok && droppedCount == 0;
+}
+
+int main(int argc, char** argv) {
+    long events = 5000000;
+    int burst = 8;
+    long stallEvery = 50000;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--events") == 0 && i + 1 < argc) {
+            events = atol(argv[++i]);
+        } else if (strcmp(argv[i], "--burst") == 0 && i + 1 < argc) {
+            burst = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--stall-every") == 0 && i + 1 < argc) {
+            stallEvery = atol(argv[++i]);
+        } else {
+            printf("Usage: %s [--events N] [--burst N] [--stall-every N]\n", argv[0]);
+            return 2;
+        }
+    }
+    if (events <= 0 || events > 0x7FFFFFFF || burst < 0 || stallEvery < 0 || stallEvery > 0x7FFFFFFF) {
+        printf("Usage: %s [--events N] [--burst N] [--stall-every N]\n", argv[0]);
+        return 2;
+    }
+    uint32_t count = (uint32_t)events;
+
+    printf("%u events per mode, %u hardware threads\n\n", count, std::thread::hardware_concurrency());
+    bool ok = true;
+    bool results[4];
+
+    Tally ring(count);
+    runRing(ring, count);
+    results[0] = report("ring", ring, count, false);
+
+    SocketEventQueue::Stats retryStats;
+    Tally retry(count);
+    runQueue(retry, count, QUEUE_RETRY, 0, 0, retryStats);
+    results[1] = report("queue retry", retry, count, false);
+
+    SocketEventQueue::Stats dropStats;
+    Tally drop(count);
+    runQueue(drop, count, QUEUE_DROP, (uint32_t)burst, (uint32_t)stallEvery, dropStats);
+    results[2] = report("queue drop", drop, count, true);
+
+    SocketEventQueue::Stats holdStats;
+    Tally hold(count);
+    runQueue(hold, count, QUEUE_HOLD, (uint32_t)burst, (uint32_t)stallEvery, holdStats);
+    results[3] = report("queue hold", hold, count, true);
+    printf("%-12s %9u held\n", "", holdStats.held);
+
+    printf("\nChecks:\n");
+    ok &= check(results[0], "ring: nothing lost, duplicated or reordered");
+    ok &= check(results[1] && retryStats.popped == count, "queue retry: every event once, in order, intact");
+    ok &= check(results[2], "queue drop: only reported drops missing, rest intact");
+    ok &= check(dropStats.pushed + dropStats.dropped == count && dropStats.popped == dropStats.pushed,
+                "queue drop: pushed + dropped = sent, popped = pushed");
+    ok &= check(results[3] && holdStats.pushed + holdStats.dropped == count && holdStats.popped == holdStats.pushed,
+                "queue hold: only reported drops missing, in order, intact");
+    ok &= check(holdScript(), "queue hold: a full queue plus hold arrives whole, in order");
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,404 @@
+// Main-loop stall with blocking ApiClient calls vs ApiRequestQueue, against
+// a stand-in HTTP/1.1 server on loopback that answers every request after
+// --latency ms (keep-alive, like uvicorn).
+//
+// A 60 Hz loop plays what an online Caro screen does: the friends list
+// once, a game-state sync every 500 ms and a move every 2 s. In blocking
+// mode loop() makes the ApiClient call itself; in async mode it enqueues
+// and calls ApiRequestQueue::poll() every iteration. Per mode and latency
+// it prints the time loop() spent in network code per iteration (mean, p99,
+// max), the frames that overran the 16 ms budget and the request latency
+// as the callback saw it.
+//
+// Checks that every async request calls back exactly once with the server's
+// answer and that no async iteration stalls past the frame budget. Exits
+// non-zero if a check fails. The server is a local socket, so WiFi airtime
+// and TLS are not in these numbers; the stall the blocking path shows is a
+// lower bound for the device.
+//
+//   pio run -e stallbench
+//   .pio/build/stallbench/program [--latency 20,100,300] [--seconds 4]
+#include <Arduino.h>
+#include <WiFi.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <time.h>
+#include <unistd.h>
+#include <algorithm>
+#include <atomic>
+#include <string>
+#include <vector>
+#include "api_client.h"
+#include "api_request_queue.h"
+#include "hal_native.h"
+
+// ---- What hal_native.cpp provides to the app (real clock: HTTPClient
+// times out on millis()) ----
+
+unsigned long micros() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (unsigned long)(ts.tv_sec * 1000000ULL + ts.tv_nsec / 1000);
+}
+
+unsigned long millis() {
+    return micros() / 1000;
+}
+
+void delay(uint32_t ms) {
+    usleep(ms * 1000);
+}
+
+EspClass ESP;
+
+uint32_t EspClass::getFreeHeap() {
+    return 200 * 1024;
+}
+
+static HalNative::Network hostNet = {"HostNet", "", -50};
+
+namespace HalNative {
+int networkCount() { return 1; }
+const Network& network(int index) { (void)index; return hostNet; }
+String resolveHost(const String& host) { return host; }
+}
+
+// ---- Stand-in server ----
+
+static std::atomic<int> serverLatencyMs(100);
+static std::atomic<uint32_t> serverRequests(0);
+
+static bool sendAll(int fd, const std::string& data) {
+    size_t sent = 0;
+    while (sent < data.size()) {
+        ssize_t n = send(fd, data.data() + sent, data.size() - sent, MSG_NOSIGNAL);
+        if (n <= 0) return false;
+        sent += n;
+    }
+    return true;
+}
+
+static std::string answerFor(const std::string& path) {
+    if (path.find("/state") != std::string::npos) {
+        return "{\"success\":true,\"status\":\"playing\",\"current_turn\":7,\"move_count\":12,"
+               "\"host_name\":\"alice\",\"guest_name\":\"bob\",\"host_id\":7,\"guest_id\":9}";
+    }
+    if (path.find("/move") != std::string::npos) {
+        return "{\"success\":true,\"message\":\"ok\",\"move_id\":42,\"game_status\":\"playing\",\"winner_id\":null}";
+    }
+    return "9,bob,1|11,carol,0";
+}
+
+// One keep-alive connection: read a request, wait the latency, answer
+static void* connectionThread(void* parameter) {
+    int fd = (int)(intptr_t)parameter;
+    std::string buffer;
+    char chunk[2048];
+    while (true) {
+        size_t headerEnd;
+        while ((headerEnd = buffer.find("\r\n\r\n")) == std::string::npos) {
+            ssize_t n = recv(fd, chunk, sizeof(chunk), 0);
+            if (n <= 0) {
+                close(fd);
+                return nullptr;
+            }
+            buffer.append(chunk, n);
+        }
+        std::string head = buffer.substr(0, headerEnd);
+        size_t bodyLength = 0;
+        size_t lengthAt = head.find("Content-Length:");
+        if (lengthAt != std::string::npos) bodyLength = strtoul(head.c_str() + lengthAt + 15, nullptr, 10);
+        while (buffer.size() < headerEnd + 4 + bodyLength) {
+            ssize_t n = recv(fd, chunk, sizeof(chunk), 0);
+            if (n <= 0) {
+                close(fd);
+                return nullptr;
+            }
+            buffer.append(chunk, n);
+        }
+        size_t pathStart = head.find(' ') + 1;
+        std::string path = head.substr(pathStart, head.find(' ', pathStart) - pathStart);
+        buffer.erase(0, headerEnd + 4 + bodyLength);
+
+        usleep(serverLatencyMs.load() * 1000);
+        std::string body = answerFor(path);
+        char header[160];
+        snprintf(header, sizeof(header),
+                 "HTTP/1.1 200 OK\r\nContent-Type: application/json\r\nContent-Length: %u\r\n\r\n",
+                 (unsigned)body.size());
+        serverRequests++;
+        if (!sendAll(fd, std::string(header) + body)) {
+            close(fd);
+            return nullptr;
+        }
+    }
+}
+
+static void* acceptThread(void* parameter) {
+    int listener = (int)(intptr_t)parameter;
+    while (true) {
+        int fd = accept(listener, nullptr, nullptr);
+        if (fd < 0) continue;
+        pthread_t thread;
+        if (pthread_create(&thread, nullptr, connectionThread, (void*)(intptr_t)fd) == 0) {
+            pthread_detach(thread);
+        } else {
+            close(fd);
+        }
+    }
+    return nullptr;
+}
+
+// Port of the listening socket, 0 on failure
+static uint16_t startServer() {
+    int listener = socket(AF_INET, SOCK_STREAM, 0);
+    if (listener < 0) return 0;
+    struct sockaddr_in address;
+    memset(&address, 0, sizeof(address));
+    address.sin_family = AF_INET;
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    address.sin_port = 0;
+    socklen_t length = sizeof(address);
+    if (bind(listener, (struct sockaddr*)&address, sizeof(address)) != 0 || listen(listener, 16) != 0 ||
+        getsockname(listener, (struct sockaddr*)&address, &length) != 0) {
+        close(listener);
+        return 0;
+    }
+    pthread_t thread;
+    if (pthread_create(&thread, nullptr, acceptThread, (void*)(intptr_t)listener) != 0) {
+        close(listener);
+        return 0;
+    }
+    pthread_detach(thread);
+    return ntohs(address.sin_port);
+}
+
+// ---- Main loop ----
+
+static const char* SERVER_HOST = "127.0.0.1";
+static uint16_t serverPort = 0;
+
+static const unsigned long FRAME_MICROS = 16667;
+static const unsigned long SYNC_INTERVAL_MS = 500;
+static const unsigned long MOVE_INTERVAL_MS = 2000;
+
+struct Outcome {
+    int issued;
+    int callbacks;
+    int answered;           // Callbacks carrying the server's answer
+    bool syncPending;
+    std::vector<unsigned long> latencyMs;
+};
+
+static Outcome outcome;
+static std::vector<unsigned long> stallMicros;
+
+// Callbacks get the request's issue time as context
+static void onGameState(const ApiClient::GameStateResult& result, void* context) {
+    outcome.callbacks++;
+    if (result.success && result.currentTurn == 7) outcome.answered++;
+    outcome.latencyMs.push_back(millis() - (unsigned long)(uintptr_t)context);
+    outcome.syncPending = false;
+}
+
+static void onGameMove(const ApiClient::GameMoveResult& result, void* context) {
+    outcome.callbacks++;
+    if (result.success && result.moveId == 42) outcome.answered++;
+    outcome.latencyMs.push_back(millis() - (unsigned long)(uintptr_t)context);
+}
+
+static void onFriendsList(bool success, const String& friendsList, void* context) {
+    outcome.callbacks++;
+    if (success && friendsList.indexOf("carol") >= 0) outcome.answered++;
+    outcome.latencyMs.push_back(millis() - (unsigned long)(uintptr_t)context);
+}
+
+static void requestFriends(bool async) {
+    outcome.issued++;
+    void* context = (void*)(uintptr_t)millis();
+    if (async) {
+        ApiRequestQueue::getFriendsList(7, SERVER_HOST, serverPort, onFriendsList, context);
+    } else {
+        onFriendsList(true, ApiClient::getFriendsList(7, SERVER_HOST, serverPort), context);
+    }
+}
+
+static void requestSync(bool async) {
+    outcome.issued++;
+    outcome.syncPending = true;
+    void* context = (void*)(uintptr_t)millis();
+    if (async) {
+        ApiRequestQueue::getGameState(3, SERVER_HOST, serverPort, onGameState, context);
+    } else {
+        onGameState(ApiClient::getGameState(3, SERVER_HOST, serverPort), context);
+    }
+}
+
+static void requestMove(bool async, int move) {
+    outcome.issued++;
+    void* context = (void*)(uintptr_t)millis();
+    if (async) {
+        ApiRequestQueue::submitGameMove(3, 7, move % 15, move % 20, SERVER_HOST, serverPort, onGameMove, context);
+    } else {
+        onGameMove(ApiClient::submitGameMove(3, 7, move % 15, move % 20, SERVER_HOST, serverPort), context);
+    }
+}
+
+static int mutedStdout = -1;
+
+// ApiClient logs every request; keep it off the report
+static void muteSerial(bool mute) {
+    fflush(stdout);
+    if (mute && mutedStdout < 0) {
+        mutedStdout = dup(STDOUT_FILENO);
+        FILE* devNull = fopen("/dev/null", "w");
+        if (devNull != nullptr) {
+            dup2(fileno(devNull), STDOUT_FILENO);
+            fclose(devNull);
+        }
+    } else if (!mute && mutedStdout >= 0) {
+        dup2(mutedStdout, STDOUT_FILENO);
+        close(mutedStdout);
+        mutedStdout = -1;
+    }
+}
+
+static unsigned long percentile(std::vector<unsigned long> values, int p) {
+    if (values.empty()) return 0;
+    std::sort(values.begin(), values.end());
+    size_t index = (values.size() * p) / 100;
+    return values[index < values.size() ? index : values.size() - 1];
+}
+
+// Returns the worst single-iteration stall
+static unsigned long runLoop(bool async, int latencyMs, double seconds) {
+    serverLatencyMs = latencyMs;
+    outcome = Outcome();
+    stallMicros.clear();
+
+    muteSerial(true);
+    unsigned long start = millis();
+    unsigned long nextSync = start;
+    unsigned long nextMove = start + MOVE_INTERVAL_MS;
+    unsigned long nextFrame = micros();
+    int moves = 0;
+    bool friendsAsked = false;
+    int overruns = 0;
+    while (millis() - start < (unsigned long)(seconds * 1000)) {
+        unsigned long frameStart = micros();
+        unsigned long now = millis();
+        if (async) ApiRequestQueue::poll();
+        if (!friendsAsked) {
+            requestFriends(async);
+            friendsAsked = true;
+        }
+        if ((long)(now - nextSync) >= 0 && !outcome.syncPending) {
+            requestSync(async);
+            nextSync = now + SYNC_INTERVAL_MS;
+        }
+        if ((long)(now - nextMove) >= 0) {
+            requestMove(async, moves++);
+            nextMove = now + MOVE_INTERVAL_MS;
+        }
+        unsigned long stall = micros() - frameStart;
+        stallMicros.push_back(stall);
+        if (stall > FRAME_MICROS) overruns++;
+
+        // Drawing etc. is left out: sleep to the next 60 Hz tick
+        nextFrame += FRAME_MICROS;
+        long wait = (long)(nextFrame - micros());
+        if (wait > 0) {
+            usleep(wait);
+        } else {
+            nextFrame = micros();
+        }
+    }
+    // Let the last requests land
+    unsigned long drainStart = millis();
+    while (async && ApiRequestQueue::getPendingCount() > 0 && millis() - drainStart < 10000) {
+        ApiRequestQueue::poll();
+        delay(5);
+    }
+    muteSerial(false);
+
+    double sum = 0;
+    for (unsigned long us : stallMicros) sum += us;
+    printf("%-9s %4d ms  %4d req  stall/loop: mean %8.0f us  p99 %8lu us  max %8lu us  "
+           "%4d/%4d frames over 16 ms  latency p50 %4lu ms  max %4lu ms\n",
+           async ? "async" : "blocking", latencyMs, outcome.issued, sum / stallMicros.size(),
+           percentile(stallMicros, 99), percentile(stallMicros, 100), overruns, (int)stallMicros.size(),
+           percentile(outcome.latencyMs, 50), percentile(outcome.latencyMs, 100));
+    return percentile(stallMicros, 100);
+}
+
+static bool check(bool condition, const char* what) {
+    printf("  %-60s %s\n", what, condition ? "ok" : "FAILED");
+    return condition;
+}
+
+int main(int argc, char** argv) {
+    std::vector<int> latencies;
+    double seconds = 4;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--latency") == 0 && i + 1 < argc) {
+            for (char* item = strtok(argv[++i], ","); item != nullptr; item = strtok(nullptr, ",")) {
+                latencies.push_back(atoi(item));
+            }
+        } else if (strcmp(argv[i], "--seconds") == 0 && i + 1 < argc) {
+            seconds = atof(argv[++i]);
+        } else {
+            printf("Usage: %s [--latency MS[,MS...]] [--seconds N]\n", argv[0]);
+            return 2;
+        }
+    }
+    if (latencies.empty()) {
+        latencies.push_back(20);
+        latencies.push_back(100);
+        latencies.push_back(300);
+    }
+
+    serverPort = startServer();
+    if (serverPort == 0) {
+        perror("stand-in server");
+        return 1;
+    }
+    WiFi.begin("HostNet");
+    while (WiFi.status() != WL_CONNECTED) delay(10);
+    printf("Stand-in server on %s:%u, %.0f s per run, 60 Hz loop\n\n", SERVER_HOST, serverPort, seconds);
+
+    std::vector<unsigned long> blockingMax;
+    for (size_t i = 0; i < latencies.size(); i++) {
+        blockingMax.push_back(runLoop(false, latencies[i], seconds));
+    }
+
+    // The workers stay up from here on, as on the device
+    muteSerial(true);
+    bool started = ApiRequestQueue::begin();
+    muteSerial(false);
+
+    printf("\nChecks:\n");
+    bool ok = check(started, "ApiRequestQueue worker started");
+    char label[96];
+    for (size_t i = 0; i < latencies.size() && started; i++) {
+        unsigned long asyncMax = runLoop(true, latencies[i], seconds);
+        snprintf(label, sizeof(label), "%d ms: %d requests, %d callbacks, %d with the answer", latencies[i],
+                 outcome.issued, outcome.callbacks, outcome.answered);
+        ok &= check(outcome.callbacks == outcome.issued && outcome.answered == outcome.issued, label);
+        snprintf(label, sizeof(label), "%d ms: async max stall %lu us < 16 ms (blocking %lu us)", latencies[i],
+                 asyncMax, blockingMax[i]);
+        ok &= check(asyncMax < FRAME_MICROS, label);
+    }
+
+    const ApiRequestQueue::Stats& stats = ApiRequestQueue::getStats();
+    snprintf(label, sizeof(label), "queue: %u enqueued, %u completed, %u rejected, %u inline",
+             (unsigned)stats.enqueued, (unsigned)stats.completed, (unsigned)stats.rejected,
+             (unsigned)stats.inlineCalls);
+    ok &= check(stats.enqueued == stats.completed && stats.rejected == 0 && stats.inlineCalls == 0, label);
+    printf("Server answered %u requests\n", (unsigned)serverRequests.load());
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,304 @@
+// JsonTokenizer benchmark over captured server frames.
+//
+// Frames are what server/app/api/websocket.py sends (json.dumps: ", " / ": "
+// separators, non-ASCII as \uXXXX): chat_message, notification, game_event
+// and user_status_update. For each frame type it times and counts heap
+// allocations for:
+//   legacy   - the pre-tokenizer path: copy the frame into a String, find the
+//              type with indexOf (with and without the space), then one
+//              indexOf + substring per field (condensed from the old
+//              SocketManager::parse* helpers)
+//   tokenize - JsonTokenizer::parse + the type-hash switch (the socket task)
+//   decode   - tokenize + SocketProtocol::decodeEvent into reused Strings
+//              (what reaches the event queue / callbacks)
+//
+// Allocations are counted by wrapping malloc/calloc/realloc. The host String
+// is std::string with a 15-byte small-string buffer; Arduino's String
+// allocates every non-empty value, so the legacy counts are a lower bound
+// for the device.
+//
+// Also checks the tokenizer's edge cases (field-table overflow, \u0000) and
+// exits non-zero if one fails.
+//
+//   pio run -e tokenbench
+//   .pio/build/tokenbench/program --iterations 200000
+#include <Arduino.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "json_tokenizer.h"
+#include "socket_protocol.h"
+
+extern "C" void* __libc_malloc(size_t size);
+extern "C" void* __libc_calloc(size_t count, size_t size);
+extern "C" void* __libc_realloc(void* ptr, size_t size);
+extern "C" void __libc_free(void* ptr);
+
+static bool countingAllocations = false;
+static unsigned long allocationCount = 0;
+static unsigned long allocatedBytes = 0;
+
+extern "C" void* malloc(size_t size) {
+    if (countingAllocations) {
+        allocationCount++;
+        allocatedBytes += size;
+    }
+    return __libc_malloc(size);
+}
+
+extern "C" void* calloc(size_t count, size_t size) {
+    if (countingAllocations) {
+        allocationCount++;
+        allocatedBytes += count * size;
+    }
+    return __libc_calloc(count, size);
+}
+
+extern "C" void* realloc(void* ptr, size_t size) {
+    if (countingAllocations) {
+        allocationCount++;
+        allocatedBytes += size;
+    }
+    return __libc_realloc(ptr, size);
+}
+
+extern "C" void free(void* ptr) {
+    __libc_free(ptr);
+}
+
+struct Frame {
+    const char* name;
+    const char* json;
+};
+
+static const Frame FRAMES[] = {
+    {"chat_message",
+     "{\"type\": \"chat_message\", \"from_user_id\": 7, \"message\": \"Ch\\u00e0o b\\u1ea1n, t\\u1ed1i nay "
+     "ch\\u01a1i caro kh\\u00f4ng? \\ud83d\\ude00\", \"message_id\": \"84213_5172\", "
+     "\"timestamp\": \"2024-05-18T21:04:11.532118\", \"from_nickname\": \"Tester\"}"},
+    {"notification",
+     "{\"type\": \"notification\", \"notification\": {\"id\": 1284, \"user_id\": 3, \"type\": "
+     "\"friend_request\", \"message\": \"Minh \\u0111\\u00e3 g\\u1eedi l\\u1eddi m\\u1eddi k\\u1ebft "
+     "b\\u1ea1n\", \"related_user_id\": 9, \"read\": false, \"timestamp\": \"2024-05-18T21:04:11.532118\"}}"},
+    {"game_event",
+     "{\"type\": \"game_event\", \"event\": {\"event_type\": \"move\", \"session_id\": 412, \"user_id\": 7, "
+     "\"row\": 7, \"col\": 11, \"seq\": 23, \"game_status\": \"in_progress\", \"winner_id\": null, "
+     "\"current_turn\": 3}}"},
+    {"user_status_update",
+     "{\"type\": \"user_status_update\", \"user_id\": 7, \"status\": \"online\", \"timestamp\": "
+     "\"2024-05-18T21:04:11.532118\"}"},
+};
+static const int FRAME_COUNT = sizeof(FRAMES) / sizeof(FRAMES[0]);
+
+static double nowSeconds() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+// ---- Legacy path -----------------------------------------------------------
+
+static int legacyFind(const String& message, const char* compact, const char* spaced, int from = 0) {
+    int pos = message.indexOf(compact, from);
+    if (pos >= 0) return pos + strlen(compact);
+    pos = message.indexOf(spaced, from);
+    return pos >= 0 ? pos + (int)strlen(spaced) : -1;
+}
+
+static String legacyString(const String& message, const char* key, int from = 0) {
+    String compact = String("\"") + key + "\":\"";
+    String spaced = String("\"") + key + "\": \"";
+    int start = legacyFind(message, compact.c_str(), spaced.c_str(), from);
+    if (start < 0) return String();
+    int end = message.indexOf('"', start);
+    while (end > start && message.charAt(end - 1) == '\\') {
+        end = message.indexOf('"', end + 1);
+    }
+    if (end < 0) return String();
+    String value = message.substring(start, end);
+    value.replace("\\\"", "\"");
+    value.replace("\\n", "\n");
+    value.replace("\\\\", "\\");
+    return value;
+}
+
+static int legacyInt(const String& message, const char* key, int from = 0) {
+    String compact = String("\"") + key + "\":";
+    String spaced = String("\"") + key + "\": ";
+    int start = legacyFind(message, compact.c_str(), spaced.c_str(), from);
+    if (start < 0) return 0;
+    int end = message.indexOf(',', start);
+    if (end < 0) end = message.indexOf('}', start);
+    if (end < 0) return 0;
+    return message.substring(start, end).toInt();
+}
+
+static bool legacyIsType(const String& message, const char* type) {
+    String compact = String("\"type\":\"") + type + "\"";
+    String spaced = String("\"type\": \"") + type + "\"";
+    return message.indexOf(compact) >= 0 || message.indexOf(spaced) >= 0;
+}
+
+static long legacyParse(const uint8_t* payload) {
+    String message = String((const char*)payload);
+    long sink = 0;
+    // Same probe order as the old onWebSocketEvent
+    static const char* PROBES[] = {"pong", "notification", "chat_message", "typing_start", "typing_stop",
+                                   "message_delivered", "message_read", "user_status_update", "game_event"};
+    int type = -1;
+    for (int i = 0; i < 9 && type < 0; i++) {
+        if (legacyIsType(message, PROBES[i])) type = i;
+    }
+    switch (type) {
+        case 1: {
+            int start = legacyFind(message, "\"notification\":{", "\"notification\": {");
+            sink += legacyInt(message, "id", start);
+            sink += legacyString(message, "type", start).length();
+            sink += legacyString(message, "message", start).length();
+            sink += legacyString(message, "timestamp", start).length();
+            sink += legacyInt(message, "read", start);
+            break;
+        }
+        case 2:
+            sink += legacyInt(message, "from_user_id");
+            sink += legacyString(message, "from_nickname").length();
+            sink += legacyString(message, "message").length();
+            sink += legacyString(message, "message_id").length();
+            sink += legacyString(message, "timestamp").length();
+            break;
+        case 7:
+            sink += legacyInt(message, "user_id");
+            sink += legacyString(message, "status").length();
+            break;
+        case 8:
+            sink += legacyString(message, "event_type").length();
+            sink += legacyInt(message, "session_id");
+            sink += legacyInt(message, "user_id");
+            sink += legacyInt(message, "row");
+            sink += legacyInt(message, "col");
+            sink += legacyInt(message, "seq");
+            sink += legacyString(message, "game_status").length();
+            sink += legacyInt(message, "winner_id");
+            sink += legacyInt(message, "current_turn");
+            break;
+        default:
+            break;
+    }
+    return sink;
+}
+
+// ---- Runs ------------------------------------------------------------------
+
+enum Mode { MODE_LEGACY = 0, MODE_TOKENIZE, MODE_DECODE, MODE_COUNT };
+static const char* MODE_NAMES[MODE_COUNT] = {"legacy", "tokenize", "decode"};
+
+static JsonTokenizer json;
+static SocketEvent event;
+static String texts[SocketEvent::MAX_TEXTS];
+
+static long runOnce(Mode mode, const Frame& frame, size_t length) {
+    const uint8_t* payload = (const uint8_t*)frame.json;
+    if (mode == MODE_LEGACY) {
+        return legacyParse(payload);
+    }
+    if (!json.parse(payload, length)) {
+        return -1;
+    }
+    if (mode == MODE_TOKENIZE) {
+        switch (json.getTypeHash()) {
+            case JsonTokenizer::hashOf("chat_message"):
+            case JsonTokenizer::hashOf("notification"):
+            case JsonTokenizer::hashOf("game_event"):
+            case JsonTokenizer::hashOf("user_status_update"):
+                return json.getFieldCount();
+            default:
+                return -1;
+        }
+    }
+    return SocketProtocol::decodeEvent(json, event, texts) ? event.kind : -1;
+}
+
+static bool check(bool condition, const char* what) {
+    printf("  %-52s %s\n", what, condition ? "ok" : "FAILED");
+    return condition;
+}
+
+static bool selfCheck() {
+    printf("Checks:\n");
+    bool ok = true;
+    JsonTokenizer t;
+
+    // 40 top-level keys: more than MAX_FIELDS, must not come back as a partial frame
+    String wide = "{\"type\": \"chat_message\"";
+    for (int i = 0; i < 40; i++) {
+        wide += ", \"k" + String(i) + "\": " + String(i);
+    }
+    wide += "}";
+    bool parsed = t.parse((const uint8_t*)wide.c_str(), wide.length());
+    ok &= check(!parsed && t.isOverflowed() && t.getFieldCount() == 0, "frame over MAX_FIELDS is rejected");
+    const char* bad = "{\"type\": \"chat_message\", \"message\": }";
+    parsed = t.parse((const uint8_t*)bad, strlen(bad));
+    ok &= check(!parsed && !t.isOverflowed(), "malformed frame is not reported as overflow");
+
+    const char* nul = "{\"type\": \"chat_message\", \"message\": \"ab\\u0000cd\"}";
+    t.parse((const uint8_t*)nul, strlen(nul));
+    String text = t.getString("message", 0);
+    ok &= check(text == "ab\xEF\xBF\xBD" "cd", "\\u0000 becomes U+FFFD in getString()");
+    char buf[16];
+    size_t n = t.copyString("message", buf, sizeof(buf), 0);
+    ok &= check(n == 7 && memcmp(buf, "ab\xEF\xBF\xBD" "cd", 7) == 0, "\\u0000 becomes U+FFFD in copyString()");
+
+    const char* emoji = "{\"message\": \"\\ud83d\\ude00 \\ud83d\"}";
+    t.parse((const uint8_t*)emoji, strlen(emoji));
+    ok &= check(t.getString("message") == "\xF0\x9F\x98\x80 \xEF\xBF\xBD", "surrogate pair decoded, lone surrogate replaced");
+
+    for (int i = 0; i < FRAME_COUNT; i++) {
+        size_t length = strlen(FRAMES[i].json);
+        String label = String("captured ") + FRAMES[i].name + " decodes";
+        ok &= check(runOnce(MODE_DECODE, FRAMES[i], length) > 0, label.c_str());
+    }
+    printf("\n");
+    return ok;
+}
+
+int main(int argc, char** argv) {
+    long iterations = 200000;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--iterations") == 0 && i + 1 < argc) {
+            iterations = atol(argv[++i]);
+        } else {
+            printf("Usage: %s [--iterations N]\n", argv[0]);
+            return 2;
+        }
+    }
+
+    bool ok = selfCheck();
+
+    printf("%-19s %5s  %-8s %9s %12s %12s\n", "frame", "bytes", "path", "ns/msg", "allocs/msg", "bytes/msg");
+    for (int f = 0; f < FRAME_COUNT; f++) {
+        const Frame& frame = FRAMES[f];
+        size_t length = strlen(frame.json);
+        for (int m = 0; m < MODE_COUNT; m++) {
+            Mode mode = (Mode)m;
+            long sink = 0;
+            // Warm up (first decode sizes the reused Strings), then count one pass
+            for (int i = 0; i < 1000; i++) sink += runOnce(mode, frame, length);
+            allocationCount = 0;
+            allocatedBytes = 0;
+            countingAllocations = true;
+            sink += runOnce(mode, frame, length);
+            countingAllocations = false;
+            unsigned long allocs = allocationCount;
+            unsigned long bytes = allocatedBytes;
+
+            double start = nowSeconds();
+            for (long i = 0; i < iterations; i++) sink += runOnce(mode, frame, length);
+            double elapsed = nowSeconds() - start;
+
+            printf("%-19s %5u  %-8s %9.0f %12lu %12lu%s\n", frame.name, (unsigned)length, MODE_NAMES[m],
+                   elapsed * 1e9 / iterations, allocs, bytes, sink == 0 ? " (no fields)" : "");
+        }
+    }
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,409 @@
+// Typing sessions through the socket task's outbound path: frames per second
+// and radio-on time for the typing indicator, on a simulated clock.
+//
+// A scripted user types chat messages (--sessions of them): keystrokes
+// 150-450 ms apart with the odd 1-6 s pause, to one of three friends, now and
+// then switching friend half-way. 85 % end with send (typing_stop + chat),
+// the rest are abandoned and left to the auto stop. Each keystroke calls what
+// ChatScreen calls (sendTypingStart), the socket task ticks every 10 ms:
+//
+//   per-keystroke  - the original SocketManager: sendTXT from the caller,
+//                    one typing_start frame per keystroke
+//   outbox         - SocketOutbox + SocketTyping + SocketFramer, JSON
+//   outbox tlv1    - the same with the binary wire format and batching
+//
+// Radio-on time is a model: every frame keeps the radio up for its airtime
+// (payload + WebSocket/TCP/IP/802.11 headers at --mbps) plus --tail-ms before
+// modem sleep; overlapping frames share the window.
+//
+// Checks what the friend's screen sees in the outbox modes: typing shown
+// without a gap while keys keep coming (the server expires it 5 s after the
+// last typing_start), hidden within TYPING_AUTO_STOP_INTERVAL of the last key
+// and before the chat arrives, no typing_stop without a typing_start, and a
+// friend switch stops the first friend. Exits non-zero on a failure.
+//
+//   pio run -e typingsim
+//   .pio/build/typingsim/program [--sessions 500] [--tail-ms 50] [--mbps 6] [--seed 1]
+#include <Arduino.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+#include <map>
+#include <vector>
+#include "socket_protocol.h"
+
+// ---- What hal_native.cpp provides to the app ----
+
+static unsigned long fakeMillis = 0;
+
+unsigned long millis() {
+    return fakeMillis;
+}
+
+void delay(uint32_t ms) {
+    fakeMillis += ms;
+}
+
+unsigned long micros() {
+    return fakeMillis * 1000UL;
+}
+
+// ---- Script ----
+
+static const unsigned long TICK_MS = 10;          // Socket task period
+static const unsigned long SERVER_EXPIRY_MS = 5000;
+
+struct Action {
+    enum Kind { KEY, SEND, LEAVE };
+    unsigned long at;
+    Kind kind;
+    int friendId;
+};
+
+static uint32_t rngState = 1;
+
+static uint32_t nextRandom() {
+    rngState ^= rngState << 13;
+    rngState ^= rngState >> 17;
+    rngState ^= rngState << 5;
+    return rngState;
+}
+
+static unsigned long between(unsigned long low, unsigned long high) {
+    return low + nextRandom() % (high - low + 1);
+}
+
+static std::vector<Action> makeScript(int sessions, unsigned long& endAt) {
+    std::vector<Action> script;
+    unsigned long t = 1000;
+    for (int s = 0; s < sessions; s++) {
+        int friendId = 11 + (int)(nextRandom() % 3);
+        int keys = (int)between(3, 80);
+        int switchAt = nextRandom() % 10 == 0 ? keys / 2 : -1;
+        for (int k = 0; k < keys; k++) {
+            if (k == switchAt) {
+                friendId = friendId == 13 ? 11 : friendId + 1;  // Back out, open another chat
+                t += between(1500, 4000);
+            }
+            Action key = {t, Action::KEY, friendId};
+            script.push_back(key);
+            t += nextRandom() % 100 < 8 ? between(1000, 6000) : between(150, 450);
+        }
+        Action end = {t, nextRandom() % 100 < 85 ? Action::SEND : Action::LEAVE, friendId};
+        script.push_back(end);
+        t += between(2000, 20000);
+    }
+    endAt = t + 5000;
+    return script;
+}
+
+// ---- Frames and the radio ----
+
+struct SentMessage {
+    unsigned long at;
+    uint8_t type;
+    int target;
+};
+
+struct Radio {
+    double tailMs;
+    double mbps;
+    double onMs;
+    double windowEnd;
+    long frames;
+    long bytes;
+
+    void frame(unsigned long at, size_t payload) {
+        // 2+4 WebSocket (masked), 20 TCP + 20 IP, ~34 802.11 MAC/LLC
+        double airMs = (payload + 6 + 40 + 34) * 8.0 / (mbps * 1000.0);
+        double start = (double)at;
+        double end = start + airMs + tailMs;
+        if (start < windowEnd) {
+            start = windowEnd;
+        }
+        if (end > start) {
+            onMs += end - start;
+            windowEnd = end;
+        }
+        frames++;
+        bytes += (long)payload;
+    }
+};
+
+struct RadioSink : public SocketFrameSink {
+    Radio* radio;
+    bool writeFrame(const uint8_t* data, size_t length, int messages) override {
+        (void)data; (void)messages;
+        radio->frame(fakeMillis, length);
+        return true;
+    }
+    bool writeFrame(String& text, int messages) override {
+        (void)messages;
+        radio->frame(fakeMillis, text.length());
+        return true;
+    }
+};
+
+static OutboundMessage chatTo(int friendId, int n) {
+    OutboundMessage chat(WireCodec::TYPE_CHAT_MESSAGE, friendId);
+    chat.id = "3f2a9c41-" + String(100000 + n);
+    chat.text = "ok, mai gap nhe";
+    return chat;
+}
+
+// The original SocketManager: every call writes its own JSON frame
+static void runPerKeystroke(const std::vector<Action>& script, unsigned long endAt, Radio& radio) {
+    int typingTo = -1;
+    unsigned long lastKey = 0;
+    size_t next = 0;
+    int chats = 0;
+    String text;
+    for (fakeMillis = 0; fakeMillis < endAt; fakeMillis += TICK_MS) {
+        for (; next < script.size() && script[next].at <= fakeMillis; next++) {
+            const Action& a = script[next];
+            OutboundMessage m;
+            if (a.kind == Action::KEY) {
+                if (typingTo != -1 && typingTo != a.friendId) {
+                    text = "";
+                    SocketProtocol::appendJson(OutboundMessage(WireCodec::TYPE_TYPING_STOP, typingTo), fakeMillis, text);
+                    radio.frame(fakeMillis, text.length());
+                }
+                typingTo = a.friendId;
+                lastKey = fakeMillis;
+                m = OutboundMessage(WireCodec::TYPE_TYPING_START, a.friendId);
+            } else if (a.kind == Action::SEND) {
+                text = "";
+                SocketProtocol::appendJson(OutboundMessage(WireCodec::TYPE_TYPING_STOP, a.friendId), fakeMillis, text);
+                radio.frame(fakeMillis, text.length());
+                if (typingTo == a.friendId) typingTo = -1;
+                m = chatTo(a.friendId, chats++);
+            } else {
+                continue;
+            }
+            text = "";
+            SocketProtocol::appendJson(m, fakeMillis, text);
+            radio.frame(fakeMillis, text.length());
+        }
+        // Socket task: auto stop
+        if (typingTo != -1 && fakeMillis - lastKey >= TYPING_AUTO_STOP_INTERVAL) {
+            text = "";
+            SocketProtocol::appendJson(OutboundMessage(WireCodec::TYPE_TYPING_STOP, typingTo), fakeMillis, text);
+            radio.frame(fakeMillis, text.length());
+            typingTo = -1;
+        }
+    }
+}
+
+// SocketManager now: the main loop only pushes, the socket task does the rest
+static void runOutbox(const std::vector<Action>& script, unsigned long endAt, bool binaryWire, Radio& radio,
+                      std::vector<SentMessage>& sent) {
+    SocketOutbox outbox;
+    SocketTyping typing;
+    SocketFramer* framer = new SocketFramer();
+    RadioSink sink;
+    sink.radio = &radio;
+    OutboundMessage batch[SocketOutbox::CAPACITY];
+    size_t next = 0;
+    int chats = 0;
+    for (fakeMillis = 0; fakeMillis < endAt; fakeMillis += TICK_MS) {
+        // Main loop (sendTypingStart / sendTypingStop + sendChatMessage)
+        for (; next < script.size() && script[next].at <= fakeMillis; next++) {
+            const Action& a = script[next];
+            if (a.kind == Action::KEY) {
+                outbox.push(OutboundMessage(WireCodec::TYPE_TYPING_START, a.friendId));
+            } else if (a.kind == Action::SEND) {
+                outbox.push(OutboundMessage(WireCodec::TYPE_TYPING_STOP, a.friendId));
+                outbox.push(chatTo(a.friendId, chats++));
+            }
+        }
+
+        // Socket task tick (runSocketTask: flushOutbox, then the auto stop)
+        int count = outbox.drain(batch, SocketOutbox::CAPACITY);
+        int live = 0;
+        for (int i = 0; i < count; i++) {
+            int replaced;
+            bool needed = typing.admit(batch[i], fakeMillis, replaced);
+            if (replaced != -1) {
+                outbox.push(OutboundMessage(WireCodec::TYPE_TYPING_STOP, replaced));
+            }
+            if (!needed) {
+                continue;
+            }
+            if (live != i) {
+                batch[live] = batch[i];
+            }
+            SentMessage m = {fakeMillis, batch[live].type, batch[live].target};
+            sent.push_back(m);
+            live++;
+        }
+        framer->write(batch, live, binaryWire, true, fakeMillis, sink);
+        OutboundMessage stop;
+        if (typing.autoStop(fakeMillis, stop)) {
+            outbox.push(stop);
+        }
+    }
+    delete framer;
+}
+
+// ---- What the friend sees ----
+
+static bool check(bool condition, const char* what) {
+    printf("  %-60s %s\n", what, condition ? "ok" : "FAILED");
+    return condition;
+}
+
+// Typing shown to friendId at time t, from the frames the server got
+static bool shownAt(const std::vector<SentMessage>& sent, int friendId, unsigned long t) {
+    long start = -1;
+    for (const SentMessage& m : sent) {
+        if (m.at > t) break;
+        if (m.target != friendId) continue;
+        if (m.type == WireCodec::TYPE_TYPING_START) start = (long)m.at;
+        else if (m.type == WireCodec::TYPE_TYPING_STOP) start = -1;
+    }
+    return start >= 0 && t - (unsigned long)start < SERVER_EXPIRY_MS;
+}
+
+static bool checkView(const std::vector<Action>& script, const std::vector<SentMessage>& sent) {
+    bool ok = true;
+    char label[96];
+
+    // Sampled at every keystroke + one tick, and just before the next one
+    long gaps = 0, keys = 0;
+    for (size_t i = 0; i < script.size(); i++) {
+        const Action& a = script[i];
+        if (a.kind != Action::KEY) continue;
+        keys++;
+        if (!shownAt(sent, a.friendId, a.at + TICK_MS)) gaps++;
+        if (i + 1 < script.size() && script[i + 1].friendId == a.friendId &&
+            script[i + 1].at - a.at < TYPING_AUTO_STOP_INTERVAL &&
+            !shownAt(sent, a.friendId, script[i + 1].at - 1)) {
+            gaps++;
+        }
+    }
+    if (gaps > 0) printf("    %ld gaps while typing\n", gaps);
+    snprintf(label, sizeof(label), "typing shown throughout (%ld keystrokes)", keys);
+    ok &= check(gaps == 0, label);
+
+    // Hidden within the auto stop after a pause, an abandon or a friend switch
+    long late = 0, pauses = 0;
+    for (size_t i = 0; i < script.size(); i++) {
+        const Action& a = script[i];
+        if (a.kind != Action::KEY) continue;
+        bool last = i + 1 >= script.size() || script[i + 1].kind != Action::KEY ||
+                    script[i + 1].friendId != a.friendId || script[i + 1].at - a.at > TYPING_AUTO_STOP_INTERVAL + 2 * TICK_MS;
+        if (!last || (i + 1 < script.size() && script[i + 1].kind == Action::SEND)) continue;
+        pauses++;
+        unsigned long deadline = a.at + TYPING_AUTO_STOP_INTERVAL + 2 * TICK_MS;
+        if (i + 1 < script.size() && script[i + 1].friendId != a.friendId) {
+            deadline = std::min(deadline, script[i + 1].at + 2 * TICK_MS);  // Switched: stop next tick
+        }
+        bool typedAgain = false;  // Next session to the same friend started before the deadline
+        for (size_t j = i + 1; j < script.size() && script[j].at <= deadline; j++) {
+            if (script[j].kind == Action::KEY && script[j].friendId == a.friendId) typedAgain = true;
+        }
+        if (typedAgain) continue;
+        if (shownAt(sent, a.friendId, deadline)) late++;
+    }
+    if (late > 0) printf("    %ld still shown after the auto stop\n", late);
+    snprintf(label, sizeof(label), "hidden within %d ms of the last key (%ld pauses/leaves)",
+             TYPING_AUTO_STOP_INTERVAL, pauses);
+    ok &= check(late == 0, label);
+
+    // The chat never arrives while typing is still shown
+    long shownWithChat = 0, chats = 0;
+    for (const SentMessage& m : sent) {
+        if (m.type != WireCodec::TYPE_CHAT_MESSAGE) continue;
+        chats++;
+        if (shownAt(sent, m.target, m.at)) shownWithChat++;
+    }
+    snprintf(label, sizeof(label), "typing hidden when the chat arrives (%ld chats)", chats);
+    ok &= check(shownWithChat == 0 && chats > 0, label);
+
+    std::map<int, bool> on;
+    long orphanStops = 0;
+    for (const SentMessage& m : sent) {
+        if (m.type == WireCodec::TYPE_TYPING_START) on[m.target] = true;
+        if (m.type == WireCodec::TYPE_TYPING_STOP) {
+            if (!on[m.target]) orphanStops++;
+            on[m.target] = false;
+        }
+    }
+    ok &= check(orphanStops == 0, "no typing_stop without a typing_start");
+    return ok;
+}
+
+int main(int argc, char** argv) {
+    int sessions = 500;
+    double tailMs = 50;
+    double mbps = 6;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--sessions") == 0 && i + 1 < argc) {
+            sessions = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--tail-ms") == 0 && i + 1 < argc) {
+            tailMs = atof(argv[++i]);
+        } else if (strcmp(argv[i], "--mbps") == 0 && i + 1 < argc) {
+            mbps = atof(argv[++i]);
+        } else if (strcmp(argv[i], "--seed") == 0 && i + 1 < argc) {
+            rngState = (uint32_t)atoi(argv[++i]);
+            if (rngState == 0) rngState = 1;
+        } else {
+            printf("Usage: %s [--sessions N] [--tail-ms MS] [--mbps RATE] [--seed N]\n", argv[0]);
+            return 2;
+        }
+    }
+    if (sessions < 1) sessions = 1;
+
+    unsigned long endAt = 0;
+    std::vector<Action> script = makeScript(sessions, endAt);
+    long keys = 0, sends = 0;
+    double typingSeconds = 0;
+    for (size_t i = 0; i < script.size(); i++) {
+        if (script[i].kind == Action::KEY) keys++;
+        if (script[i].kind == Action::SEND) sends++;
+        if (i > 0 && script[i].kind != Action::KEY) {
+            size_t first = i;
+            while (first > 0 && script[first - 1].kind == Action::KEY) first--;
+            typingSeconds += (script[i].at - script[first].at) / 1000.0;
+        }
+    }
+    printf("%d sessions, %ld keystrokes, %ld sent, %.0f s typing of %.0f s simulated\n", sessions, keys, sends,
+           typingSeconds, endAt / 1000.0);
+    printf("Radio model: %.0f ms tail after each frame, %.0f Mbit/s\n\n", tailMs, mbps);
+
+    const char* names[3] = {"per-keystroke", "outbox", "outbox tlv1"};
+    Radio radios[3];
+    std::vector<SentMessage> sent[3];
+    for (int mode = 0; mode < 3; mode++) {
+        Radio r = {tailMs, mbps, 0, 0, 0, 0};
+        radios[mode] = r;
+    }
+    runPerKeystroke(script, endAt, radios[0]);
+    runOutbox(script, endAt, false, radios[1], sent[1]);
+    runOutbox(script, endAt, true, radios[2], sent[2]);
+
+    printf("%-16s %8s %14s %10s %16s %14s\n", "", "frames", "frames/s typing", "bytes", "radio-on/min typing",
+           "radio-on");
+    for (int mode = 0; mode < 3; mode++) {
+        const Radio& r = radios[mode];
+        printf("%-16s %8ld %14.2f %10ld %15.0f ms %12.1f s\n", names[mode], r.frames, r.frames / typingSeconds,
+               r.bytes, r.onMs / (typingSeconds / 60.0), r.onMs / 1000.0);
+    }
+
+    bool ok = true;
+    for (int mode = 1; mode < 3; mode++) {
+        printf("\nChecks (%s):\n", names[mode]);
+        ok &= checkView(script, sent[mode]);
+    }
+
+    // Friend switch with nothing in between: the first friend is stopped
+    SocketTyping typing;
+    int replaced = -1;
+    typing.admit(OutboundMessage(WireCodec::TYPE_TYPING_START, 11), 1000, replaced);
+    bool firstClean = replaced == -1;
+    typing.admit(OutboundMessage(WireCodec::TYPE_TYPING_START, 12), 1100, replaced);
+    printf("\n");
+    ok &= check(firstClean && replaced == 11, "typing_start to another friend stops the first");
+    return ok ? 0 : 1;
+}
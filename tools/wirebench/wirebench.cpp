@@ -0,0 +1,733 @@
+// tlv1 vs JSON socket frames: round-trip checks, bytes and encode/decode
+// time per message type.
+//
+// Round trips (exit non-zero on any mismatch):
+//   - device -> server: every OutboundMessage type, encoded both ways
+//     (SocketProtocol::appendJson / encodeWire), read back with
+//     JsonTokenizer::parse / WireCodec::decode; both must carry the same
+//     fields and values as the message
+//   - server -> device: every frame type the server may send binary, built
+//     as JSON (json.dumps style: ", " separators, non-ASCII as \uXXXX) and
+//     as tlv1; SocketProtocol::decodeEvent must give the same event
+//   - malformed frames: every truncation, bad magic, unknown type/key, batch,
+//     too many fields, varints over 5 bytes or 32 bits are rejected without
+//     reading past the end
+// Values include negatives, INT32_MIN/MAX, empty strings, quotes,
+// backslashes, control characters, Vietnamese and emoji text and a 500-char
+// chat.
+//
+// Cross-check with server/app/api/wire.py (see server/scripts/wire_check.py):
+//   --dump FILE           write the device frames, "<label> <hex> <json>" lines
+//   --server-frames FILE  decode frames wire_check.py --emit wrote, compare
+//                         the tlv1 and JSON events
+//
+//   pio run -e wirebench
+//   .pio/build/wirebench/program [--iterations 200000] [--dump FILE] [--server-frames FILE]
+#include <Arduino.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <string>
+#include <vector>
+#include "socket_protocol.h"
+
+static double nowSeconds() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static bool check(bool condition, const char* what) {
+    printf("  %-60s %s\n", what, condition ? "ok" : "FAILED");
+    return condition;
+}
+
+static std::string toHex(const uint8_t* data, size_t length) {
+    static const char digits[] = "0123456789abcdef";
+    std::string out;
+    for (size_t i = 0; i < length; i++) {
+        out += digits[data[i] >> 4];
+        out += digits[data[i] & 15];
+    }
+    return out;
+}
+
+static std::vector<uint8_t> fromHex(const std::string& hex) {
+    std::vector<uint8_t> out;
+    for (size_t i = 0; i + 1 < hex.size(); i += 2) {
+        out.push_back((uint8_t)strtoul(hex.substr(i, 2).c_str(), nullptr, 16));
+    }
+    return out;
+}
+
+// ---- Device -> server ----
+
+struct DeviceCase {
+    const char* label;
+    OutboundMessage message;
+};
+
+static const char* VIETNAMESE = "Xin ch\xc3\xa0o, b\xe1\xba\xa1n kh\xe1\xbb\x8f" "e kh\xc3\xb4ng? \xf0\x9f\x91\x8b";
+
+static std::vector<DeviceCase> deviceCases() {
+    std::vector<DeviceCase> cases;
+    DeviceCase c;
+
+    c.label = "chat_message";
+    c.message = OutboundMessage(WireCodec::TYPE_CHAT_MESSAGE, 12);
+    c.message.id = "3f2a9c41-000017";
+    c.message.text = "hey, ban co ranh khong?";
+    cases.push_back(c);
+
+    c.label = "chat_message utf8";
+    c.message.text = VIETNAMESE;
+    cases.push_back(c);
+
+    c.label = "chat_message escapes";
+    c.message.text = "say \"hi\" \\ path\nline 2\ttab\rcr \x01";
+    cases.push_back(c);
+
+    c.label = "chat_message empty";
+    c.message.text = "";
+    cases.push_back(c);
+
+    c.label = "chat_message 500 chars";
+    c.message.text = "";
+    for (int i = 0; i < 500; i++) c.message.text += (char)('a' + i % 26);
+    cases.push_back(c);
+
+    c.label = "typing_start";
+    c.message = OutboundMessage(WireCodec::TYPE_TYPING_START, 12);
+    cases.push_back(c);
+
+    c.label = "typing_stop";
+    c.message = OutboundMessage(WireCodec::TYPE_TYPING_STOP, 12);
+    cases.push_back(c);
+
+    c.label = "read_receipt";
+    c.message = OutboundMessage(WireCodec::TYPE_READ_RECEIPT, 12);
+    c.message.id = "3f2a9c41-000017";
+    cases.push_back(c);
+
+    c.label = "game_move";
+    c.message = OutboundMessage(WireCodec::TYPE_GAME_MOVE, 431);
+    c.message.a = 7;
+    c.message.b = 13;
+    c.message.c = 24;
+    cases.push_back(c);
+
+    c.label = "game_resync";
+    c.message = OutboundMessage(WireCodec::TYPE_GAME_RESYNC, 431);
+    c.message.a = 23;
+    cases.push_back(c);
+
+    c.label = "billiard_shot";
+    c.message = OutboundMessage(WireCodec::TYPE_BILLIARD_SHOT, 431);
+    c.message.a = 5;
+    c.message.b = 1250;
+    c.message.c = -31415;
+    c.message.d = 87;
+    c.message.e = (int32_t)0x9e3779b9;
+    cases.push_back(c);
+
+    c.label = "billiard_shot int limits";
+    c.message.a = 0;
+    c.message.b = 2147483647;
+    c.message.c = -2147483647 - 1;
+    c.message.d = -1;
+    c.message.e = 1;
+    cases.push_back(c);
+
+    c.label = "billiard_sync";
+    c.message = OutboundMessage(WireCodec::TYPE_BILLIARD_SYNC, 431);
+    c.message.a = 6;
+    c.message.text = "0a1b2c3d4e5f60718293a4b5c6d7e8f90a1b2c3d4e5f60718293a4b5c6d7e8f9";
+    cases.push_back(c);
+
+    c.label = "billiard_sync request";
+    c.message.text = "";
+    cases.push_back(c);
+    return cases;
+}
+
+static const unsigned long TIMESTAMP = 1760662800UL;
+
+// Same key set and values in the JSON and the tlv1 reading, and what the message holds
+static bool sameFields(const JsonTokenizer& json, const JsonTokenizer& wire, const OutboundMessage& message,
+                       std::string& why) {
+    if (json.getFieldCount() != wire.getFieldCount()) {
+        why = "field count " + std::to_string(json.getFieldCount()) + " vs " + std::to_string(wire.getFieldCount());
+        return false;
+    }
+    if (json.getTypeHash() != wire.getTypeHash()) {
+        why = "type";
+        return false;
+    }
+    for (int i = 0; i < json.getFieldCount(); i++) {
+        const JsonField& f = json.getField(i);
+        std::string key(f.key, f.keyLength);
+        const JsonField* w = wire.find(key.c_str(), f.depth);
+        if (w == nullptr || w->type != f.type) {
+            why = "missing or retyped " + key;
+            return false;
+        }
+        String a = json.getString(key.c_str(), f.depth);
+        String b = wire.getString(key.c_str(), f.depth);
+        if (f.type == JSON_NUMBER) {
+            a = String(json.getInt(key.c_str(), 0, f.depth));
+            b = String(wire.getInt(key.c_str(), 0, f.depth));
+        }
+        if (a != b) {
+            why = key + ": '" + a.c_str() + "' vs '" + b.c_str() + "'";
+            return false;
+        }
+    }
+    // Against the source message
+    int32_t ints[] = {message.a, message.b, message.c, message.d, message.e};
+    const char* intKeys[5] = {nullptr, nullptr, nullptr, nullptr, nullptr};
+    switch (message.type) {
+        case WireCodec::TYPE_GAME_MOVE: intKeys[0] = "row"; intKeys[1] = "col"; intKeys[2] = "seq"; break;
+        case WireCodec::TYPE_GAME_RESYNC: intKeys[0] = "since_seq"; break;
+        case WireCodec::TYPE_BILLIARD_SHOT:
+            intKeys[0] = "seq"; intKeys[1] = "tick"; intKeys[2] = "angle"; intKeys[3] = "power"; intKeys[4] = "hash";
+            break;
+        case WireCodec::TYPE_BILLIARD_SYNC: intKeys[0] = "seq"; break;
+    }
+    for (int i = 0; i < 5; i++) {
+        if (intKeys[i] != nullptr && wire.getInt(intKeys[i], 0, 0) != ints[i]) {
+            why = std::string(intKeys[i]) + " differs from the message";
+            return false;
+        }
+    }
+    if (message.text.length() > 0) {
+        const char* textKey = message.type == WireCodec::TYPE_BILLIARD_SYNC ? "snapshot" : "message";
+        if (wire.getString(textKey, 0) != message.text) {
+            why = std::string(textKey) + " differs from the message";
+            return false;
+        }
+    }
+    return true;
+}
+
+// ---- Server -> device ----
+
+struct Value {
+    const char* key;
+    char kind;          // 'i' int, 's' string, 'b' bool, 'n' null
+    int32_t number;
+    const char* text;
+};
+
+struct ServerCase {
+    const char* label;
+    uint8_t type;
+    std::vector<Value> values;
+};
+
+static Value intValue(const char* key, int32_t number) { Value v = {key, 'i', number, nullptr}; return v; }
+static Value textValue(const char* key, const char* text) { Value v = {key, 's', 0, text}; return v; }
+static Value boolValue(const char* key, bool on) { Value v = {key, 'b', on ? 1 : 0, nullptr}; return v; }
+static Value nullValue(const char* key) { Value v = {key, 'n', 0, nullptr}; return v; }
+
+static std::vector<ServerCase> serverCases() {
+    std::vector<ServerCase> cases;
+    ServerCase c;
+
+    c.label = "chat_message";
+    c.type = WireCodec::TYPE_CHAT_MESSAGE;
+    c.values = {intValue("from_user_id", 12), textValue("message", "hey, ban co ranh khong?"),
+                textValue("from_nickname", "Minh"), textValue("message_id", "3f2a9c41-000017"),
+                textValue("timestamp", "2026-10-17T01:00:00.123456")};
+    cases.push_back(c);
+
+    c.label = "chat_message utf8 + escapes";
+    c.values = {intValue("from_user_id", 12), textValue("message", VIETNAMESE),
+                textValue("from_nickname", "Ng\xc3\xb4 \"Q\" \\ \t"), textValue("message_id", "a"),
+                textValue("timestamp", "")};
+    cases.push_back(c);
+
+    c.label = "typing_start";
+    c.type = WireCodec::TYPE_TYPING_START;
+    c.values = {intValue("from_user_id", 12), textValue("from_nickname", "Minh")};
+    cases.push_back(c);
+
+    c.label = "typing_stop";
+    c.type = WireCodec::TYPE_TYPING_STOP;
+    cases.push_back(c);
+
+    c.label = "message_delivered";
+    c.type = WireCodec::TYPE_MESSAGE_DELIVERED;
+    c.values = {textValue("message_id", "3f2a9c41-000017"), textValue("status", "delivered"),
+                textValue("timestamp", "2026-10-17T01:00:00.123456")};
+    cases.push_back(c);
+
+    c.label = "message_read";
+    c.type = WireCodec::TYPE_MESSAGE_READ;
+    c.values = {textValue("message_id", "3f2a9c41-000017"), textValue("timestamp", "2026-10-17T01:00:00.123456")};
+    cases.push_back(c);
+
+    c.label = "user_status_update";
+    c.type = WireCodec::TYPE_USER_STATUS_UPDATE;
+    c.values = {intValue("user_id", 12), textValue("status", "online")};
+    cases.push_back(c);
+
+    c.label = "game_event move";
+    c.type = WireCodec::TYPE_GAME_EVENT;
+    c.values = {textValue("event_type", "move"), intValue("session_id", 431), intValue("seq", 24),
+                intValue("user_id", 12), intValue("row", 7), intValue("col", 13), textValue("game_status", "playing"),
+                nullValue("winner_id"), intValue("current_turn", 9)};
+    cases.push_back(c);
+
+    c.label = "game_event invite";
+    c.values = {textValue("event_type", "invite"), intValue("session_id", 431), intValue("user_id", 12),
+                textValue("game_type", "caro"), textValue("status", "waiting"), textValue("host_nickname", "Minh"),
+                textValue("user_nickname", "Lan"), boolValue("accepted", false), boolValue("ready", true),
+                intValue("max_players", 2)};
+    cases.push_back(c);
+
+    c.label = "game_event billiard_shot";
+    c.values = {textValue("event_type", "billiard_shot"), intValue("session_id", 431), intValue("user_id", 12),
+                intValue("seq", 5), intValue("tick", 1250), intValue("angle", -31415), intValue("power", 87),
+                intValue("hash", -1640531527)};
+    cases.push_back(c);
+
+    c.label = "game_move_ack";
+    c.type = WireCodec::TYPE_GAME_MOVE_ACK;
+    c.values = {intValue("session_id", 431), intValue("seq", 24), boolValue("success", true),
+                textValue("message", "Move submitted successfully"), textValue("game_status", "completed"),
+                intValue("winner_id", 12), intValue("current_turn", 9)};
+    cases.push_back(c);
+
+    c.label = "game_move_ack rejected";
+    c.values = {intValue("session_id", 431), intValue("seq", 25), boolValue("success", false),
+                textValue("message", "Not your turn"), intValue("winner_id", -2147483647 - 1)};
+    cases.push_back(c);
+    return cases;
+}
+
+// json.dumps(): ensure_ascii, so non-ASCII goes out as \uXXXX (surrogate pairs above U+FFFF)
+static void appendJsonString(std::string& out, const char* text) {
+    out += '"';
+    const uint8_t* p = (const uint8_t*)text;
+    while (*p) {
+        uint32_t c = *p;
+        int extra = 0;
+        if (c >= 0xF0) { c &= 0x07; extra = 3; }
+        else if (c >= 0xE0) { c &= 0x0F; extra = 2; }
+        else if (c >= 0xC0) { c &= 0x1F; extra = 1; }
+        p++;
+        for (int i = 0; i < extra && *p; i++) c = (c << 6) | (*p++ & 0x3F);
+        char buffer[16];
+        if (c == '"' || c == '\\') {
+            out += '\\';
+            out += (char)c;
+        } else if (c == '\n') {
+            out += "\\n";
+        } else if (c == '\t') {
+            out += "\\t";
+        } else if (c == '\r') {
+            out += "\\r";
+        } else if (c < 0x20 || (c >= 0x7F && c < 0x10000)) {
+            snprintf(buffer, sizeof(buffer), "\\u%04x", (unsigned)c);
+            out += buffer;
+        } else if (c >= 0x10000) {
+            c -= 0x10000;
+            snprintf(buffer, sizeof(buffer), "\\u%04x\\u%04x", (unsigned)(0xD800 + (c >> 10)), (unsigned)(0xDC00 + (c & 0x3FF)));
+            out += buffer;
+        } else {
+            out += (char)c;
+        }
+    }
+    out += '"';
+}
+
+static uint8_t keyCode(const char* key) {
+    for (uint8_t k = 1; k < WireCodec::KEY_COUNT; k++) {
+        if (strcmp(WireCodec::keyName(k), key) == 0) return k;
+    }
+    return 0;
+}
+
+static std::string serverJson(const ServerCase& c) {
+    bool nested = c.type == WireCodec::TYPE_GAME_EVENT;
+    std::string out = "{\"type\": \"";
+    out += WireCodec::typeName(c.type);
+    out += nested ? "\", \"event\": {" : "\"";
+    for (size_t i = 0; i < c.values.size(); i++) {
+        const Value& v = c.values[i];
+        if (i > 0 || !nested) out += ", ";
+        out += "\"";
+        out += v.key;
+        out += "\": ";
+        if (v.kind == 'i') out += std::to_string(v.number);
+        else if (v.kind == 's') appendJsonString(out, v.text);
+        else if (v.kind == 'b') out += v.number ? "true" : "false";
+        else out += "null";
+    }
+    out += nested ? "}}" : "}";
+    return out;
+}
+
+static size_t serverWire(const ServerCase& c, uint8_t* buffer, size_t capacity) {
+    WireWriter wire(buffer, capacity, c.type);
+    for (size_t i = 0; i < c.values.size(); i++) {
+        const Value& v = c.values[i];
+        uint8_t key = keyCode(v.key);
+        if (v.kind == 'i') wire.putInt(key, v.number);
+        else if (v.kind == 's') wire.putString(key, v.text, strlen(v.text));
+        else if (v.kind == 'b') wire.putBool(key, v.number != 0);
+        // null: left out
+    }
+    return wire.ok() ? wire.length() : 0;
+}
+
+static bool sameEvent(const SocketEvent& a, const String* textsA, const SocketEvent& b, const String* textsB,
+                      std::string& why) {
+    if (a.kind != b.kind || a.textCount != b.textCount) {
+        why = "kind/text count";
+        return false;
+    }
+    for (int i = 0; i < SocketEvent::MAX_VALUES; i++) {
+        if (a.values[i] != b.values[i]) {
+            why = "values[" + std::to_string(i) + "] " + std::to_string(a.values[i]) + " vs " + std::to_string(b.values[i]);
+            return false;
+        }
+    }
+    for (int i = 0; i < a.textCount; i++) {
+        if (textsA[i] != textsB[i]) {
+            why = "texts[" + std::to_string(i) + "] '" + textsA[i].c_str() + "' vs '" + textsB[i].c_str() + "'";
+            return false;
+        }
+    }
+    return true;
+}
+
+// Decode one server frame both ways and compare the events
+static bool compareServerFrame(const std::string& json, const uint8_t* wire, size_t wireLength, std::string& why) {
+    JsonTokenizer fromJson, fromWire;
+    char scratch[WireCodec::SCRATCH_SIZE];
+    SocketEvent a, b;
+    String textsA[SocketEvent::MAX_TEXTS], textsB[SocketEvent::MAX_TEXTS];
+    if (!fromJson.parse((const uint8_t*)json.data(), json.size())) {
+        why = "JSON does not parse";
+        return false;
+    }
+    if (!WireCodec::decode(wire, wireLength, fromWire, scratch, sizeof(scratch))) {
+        why = "tlv1 does not decode";
+        return false;
+    }
+    bool okA = SocketProtocol::decodeEvent(fromJson, a, textsA);
+    bool okB = SocketProtocol::decodeEvent(fromWire, b, textsB);
+    if (!okA || !okB) {
+        why = okA ? "tlv1 is not an event" : "JSON is not an event";
+        return false;
+    }
+    return sameEvent(a, textsA, b, textsB, why);
+}
+
+// ---- Malformed frames ----
+
+static uint32_t rngState = 1;
+
+static uint32_t nextRandom() {
+    rngState ^= rngState << 13;
+    rngState ^= rngState >> 17;
+    rngState ^= rngState << 5;
+    return rngState;
+}
+
+// Decodes a heap copy of exactly length bytes, so ASan sees any overread
+static bool decodeExact(const uint8_t* data, size_t length, JsonTokenizer& out) {
+    std::vector<uint8_t> copy(data, data + length);
+    char scratch[WireCodec::SCRATCH_SIZE];
+    return WireCodec::decode(copy.empty() ? nullptr : &copy[0], length, out, scratch, sizeof(scratch));
+}
+
+static bool malformedChecks() {
+    bool ok = true;
+    JsonTokenizer out;
+    char label[96];
+
+    // Every prefix of every frame: either rejected, or a frame with fewer fields
+    int prefixes = 0, wrong = 0;
+    std::vector<ServerCase> cases = serverCases();
+    for (const ServerCase& c : cases) {
+        uint8_t frame[700];
+        size_t length = serverWire(c, frame, sizeof(frame));
+        JsonTokenizer full;
+        decodeExact(frame, length, full);
+        for (size_t cut = 0; cut < length; cut++) {
+            prefixes++;
+            if (decodeExact(frame, cut, out) && out.getFieldCount() >= full.getFieldCount()) wrong++;
+        }
+    }
+    snprintf(label, sizeof(label), "%d truncated frames rejected or shorter", prefixes);
+    ok &= check(wrong == 0, label);
+
+    uint8_t badMagic[] = {0xB2, WireCodec::TYPE_GAME_MOVE, 0x11, 0x02};
+    uint8_t unknownType[] = {WireCodec::MAGIC, WireCodec::TYPE_COUNT, 0x11, 0x02};
+    uint8_t zeroType[] = {WireCodec::MAGIC, 0, 0x11, 0x02};
+    uint8_t unknownKey[] = {WireCodec::MAGIC, WireCodec::TYPE_GAME_MOVE, WireCodec::KEY_COUNT, 0x02};
+    uint8_t batch[] = {WireCodec::MAGIC, WireCodec::TYPE_BATCH, 0x02, WireCodec::MAGIC, WireCodec::TYPE_TYPING_START};
+    uint8_t longVarint[] = {WireCodec::MAGIC, WireCodec::TYPE_GAME_MOVE, WireCodec::KEY_ROW, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0x01};
+    uint8_t wideVarint[] = {WireCodec::MAGIC, WireCodec::TYPE_GAME_MOVE, WireCodec::KEY_ROW, 0xFF, 0xFF, 0xFF, 0xFF, 0x1F};
+    uint8_t longString[] = {WireCodec::MAGIC, WireCodec::TYPE_CHAT_MESSAGE, 0x40 | WireCodec::KEY_MESSAGE, 0x05, 'a', 'b'};
+    ok &= check(!decodeExact(badMagic, sizeof(badMagic), out), "bad magic rejected");
+    ok &= check(!decodeExact(unknownType, sizeof(unknownType), out) && !decodeExact(zeroType, sizeof(zeroType), out),
+                "unknown type rejected");
+    ok &= check(!decodeExact(unknownKey, sizeof(unknownKey), out), "unknown key rejected");
+    ok &= check(!decodeExact(batch, sizeof(batch), out), "batch frame rejected (server -> device never batches)");
+    ok &= check(!decodeExact(longVarint, sizeof(longVarint), out), "varint over 5 bytes rejected");
+    ok &= check(!decodeExact(wideVarint, sizeof(wideVarint), out), "varint above 32 bits rejected");
+    ok &= check(!decodeExact(longString, sizeof(longString), out), "string longer than the frame rejected");
+
+    uint8_t many[2 + 2 * (JsonTokenizer::MAX_FIELDS + 1)];
+    size_t n = 0;
+    many[n++] = WireCodec::MAGIC;
+    many[n++] = WireCodec::TYPE_GAME_MOVE;
+    for (int i = 0; i < JsonTokenizer::MAX_FIELDS; i++) {
+        many[n++] = WireCodec::KEY_ROW;
+        many[n++] = 0x02;
+    }
+    ok &= check(!decodeExact(many, n, out) && out.isOverflowed() && out.getFieldCount() == 0,
+                "more fields than JsonTokenizer holds: rejected, none kept");
+
+    // Random bytes after a valid header: never crash, never more fields than bytes
+    int garbage = 0;
+    for (int i = 0; i < 200000; i++) {
+        uint8_t frame[24];
+        size_t length = 2 + nextRandom() % (sizeof(frame) - 2);
+        frame[0] = WireCodec::MAGIC;
+        frame[1] = 1 + nextRandom() % (WireCodec::TYPE_COUNT - 1);
+        for (size_t j = 2; j < length; j++) frame[j] = (uint8_t)nextRandom();
+        if (decodeExact(frame, length, out) && out.getFieldCount() > (int)length) garbage++;
+    }
+    ok &= check(garbage == 0, "200000 random frames decoded without overrun");
+    return ok;
+}
+
+// ---- Cross-check files ----
+
+static bool dumpDeviceFrames(const char* path) {
+    FILE* file = fopen(path, "w");
+    if (file == nullptr) {
+        perror(path);
+        return false;
+    }
+    std::vector<DeviceCase> cases = deviceCases();
+    for (const DeviceCase& c : cases) {
+        uint8_t frame[700];
+        WireWriter wire(frame, sizeof(frame), c.message.type);
+        SocketProtocol::encodeWire(c.message, TIMESTAMP, wire);
+        String json;
+        SocketProtocol::appendJson(c.message, TIMESTAMP, json);
+        std::string label = c.label;
+        for (char& ch : label) if (ch == ' ') ch = '_';
+        fprintf(file, "%s %s %s\n", label.c_str(), toHex(wire.data(), wire.length()).c_str(), json.c_str());
+    }
+    fclose(file);
+    printf("Wrote %d device frames to %s\n", (int)cases.size(), path);
+    return true;
+}
+
+static bool checkServerFrames(const char* path) {
+    FILE* file = fopen(path, "r");
+    if (file == nullptr) {
+        perror(path);
+        return false;
+    }
+    int frames = 0, bad = 0;
+    char line[8192];
+    while (fgets(line, sizeof(line), file) != nullptr) {
+        std::string text(line);
+        while (!text.empty() && (text.back() == '\n' || text.back() == '\r')) text.pop_back();
+        size_t first = text.find(' ');
+        size_t second = first == std::string::npos ? first : text.find(' ', first + 1);
+        if (second == std::string::npos) continue;
+        std::vector<uint8_t> wire = fromHex(text.substr(first + 1, second - first - 1));
+        std::string why;
+        frames++;
+        if (!compareServerFrame(text.substr(second + 1), &wire[0], wire.size(), why)) {
+            printf("    %s: %s\n", text.substr(0, first).c_str(), why.c_str());
+            bad++;
+        }
+    }
+    fclose(file);
+    char label[96];
+    snprintf(label, sizeof(label), "%d frames from wire.py: tlv1 and JSON events agree", frames);
+    return check(frames > 0 && bad == 0, label);
+}
+
+// ---- Benchmark ----
+
+// Collects what SocketFramer would send
+struct NullSink : public SocketFrameSink {
+    size_t bytes;
+    bool writeFrame(const uint8_t* data, size_t length, int messages) override {
+        (void)data; (void)messages;
+        bytes += length;
+        return true;
+    }
+    bool writeFrame(String& text, int messages) override {
+        (void)messages;
+        bytes += text.length();
+        return true;
+    }
+};
+
+int main(int argc, char** argv) {
+    long iterations = 200000;
+    const char* dumpPath = nullptr;
+    const char* serverFramesPath = nullptr;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--iterations") == 0 && i + 1 < argc) {
+            iterations = atol(argv[++i]);
+        } else if (strcmp(argv[i], "--dump") == 0 && i + 1 < argc) {
+            dumpPath = argv[++i];
+        } else if (strcmp(argv[i], "--server-frames") == 0 && i + 1 < argc) {
+            serverFramesPath = argv[++i];
+        } else {
+            printf("Usage: %s [--iterations N] [--dump FILE] [--server-frames FILE]\n", argv[0]);
+            return 2;
+        }
+    }
+    if (iterations < 1) iterations = 1;
+
+    bool ok = true;
+    char label[128];
+    std::vector<DeviceCase> devices = deviceCases();
+    std::vector<ServerCase> servers = serverCases();
+    volatile size_t sink = 0;
+
+    // ---- Device -> server: bytes, encode time, read-back ----
+    printf("Device -> server (%ld iterations; bytes = payload, + 6 B WebSocket header/mask on the wire)\n", iterations);
+    printf("%-26s %6s %6s %6s   %9s %9s   %9s %9s\n", "", "JSON", "tlv1", "ratio", "enc JSON", "enc tlv1",
+           "dec JSON", "dec tlv1");
+    long jsonTotal = 0, wireTotal = 0;
+    for (const DeviceCase& c : devices) {
+        String json;
+        json.reserve(700);
+        uint8_t frame[700];
+        double t0 = nowSeconds();
+        for (long i = 0; i < iterations; i++) {
+            json = "";
+            SocketProtocol::appendJson(c.message, TIMESTAMP, json);
+            sink += json.length();
+        }
+        double t1 = nowSeconds();
+        size_t wireLength = 0;
+        for (long i = 0; i < iterations; i++) {
+            WireWriter wire(frame, sizeof(frame), c.message.type);
+            SocketProtocol::encodeWire(c.message, TIMESTAMP, wire);
+            wireLength = wire.length();
+            sink += wireLength;
+        }
+        double t2 = nowSeconds();
+
+        JsonTokenizer fromJson, fromWire;
+        char scratch[WireCodec::SCRATCH_SIZE];
+        for (long i = 0; i < iterations; i++) sink += fromJson.parse((const uint8_t*)json.c_str(), json.length());
+        double t3 = nowSeconds();
+        for (long i = 0; i < iterations; i++) sink += WireCodec::decode(frame, wireLength, fromWire, scratch, sizeof(scratch));
+        double t4 = nowSeconds();
+
+        printf("%-26s %6u %6u %5.1fx   %6.0f ns %6.0f ns   %6.0f ns %6.0f ns\n", c.label, json.length(),
+               (unsigned)wireLength, (double)json.length() / wireLength, (t1 - t0) * 1e9 / iterations,
+               (t2 - t1) * 1e9 / iterations, (t3 - t2) * 1e9 / iterations, (t4 - t3) * 1e9 / iterations);
+        jsonTotal += json.length();
+        wireTotal += wireLength;
+    }
+    printf("%-26s %6ld %6ld %5.1fx\n", "all of the above", jsonTotal, wireTotal, (double)jsonTotal / wireTotal);
+
+    // A burst SocketFramer batches (five chats + typing stop)
+    OutboundMessage burst[6];
+    for (int i = 0; i < 5; i++) {
+        burst[i] = OutboundMessage(WireCodec::TYPE_CHAT_MESSAGE, 12);
+        burst[i].id = "3f2a9c41-00001" + String(i);
+        burst[i].text = "ok";
+    }
+    burst[5] = OutboundMessage(WireCodec::TYPE_TYPING_STOP, 12);
+    SocketFramer framer;
+    NullSink jsonSink, wireSink;
+    jsonSink.bytes = 0;
+    wireSink.bytes = 0;
+    framer.write(burst, 6, false, true, TIMESTAMP, jsonSink);
+    framer.write(burst, 6, true, true, TIMESTAMP, wireSink);
+    printf("%-26s %6u %6u %5.1fx\n", "batch: 5 chats + typing", (unsigned)jsonSink.bytes, (unsigned)wireSink.bytes,
+           (double)jsonSink.bytes / wireSink.bytes);
+
+    // ---- Server -> device: bytes, decode + decodeEvent time ----
+    printf("\nServer -> device (bytes = payload, + 2 B WebSocket header on the wire)\n");
+    printf("%-28s %6s %6s %6s   %9s %9s\n", "", "JSON", "tlv1", "ratio", "dec JSON", "dec tlv1");
+    for (const ServerCase& c : servers) {
+        std::string json = serverJson(c);
+        uint8_t frame[700];
+        size_t wireLength = serverWire(c, frame, sizeof(frame));
+        JsonTokenizer tokens;
+        char scratch[WireCodec::SCRATCH_SIZE];
+        SocketEvent event;
+        String texts[SocketEvent::MAX_TEXTS];
+        double t0 = nowSeconds();
+        for (long i = 0; i < iterations; i++) {
+            tokens.parse((const uint8_t*)json.data(), json.size());
+            sink += SocketProtocol::decodeEvent(tokens, event, texts);
+        }
+        double t1 = nowSeconds();
+        for (long i = 0; i < iterations; i++) {
+            WireCodec::decode(frame, wireLength, tokens, scratch, sizeof(scratch));
+            sink += SocketProtocol::decodeEvent(tokens, event, texts);
+        }
+        double t2 = nowSeconds();
+        printf("%-28s %6u %6u %5.1fx   %6.0f ns %6.0f ns\n", c.label, (unsigned)json.size(), (unsigned)wireLength,
+               (double)json.size() / wireLength, (t1 - t0) * 1e9 / iterations, (t2 - t1) * 1e9 / iterations);
+    }
+    printf("(decode = tokenize + SocketProtocol::decodeEvent; sink %lu)\n", (unsigned long)sink);
+
+    // ---- Round trips ----
+    printf("\nChecks:\n");
+    int bad = 0;
+    for (const DeviceCase& c : devices) {
+        String json;
+        SocketProtocol::appendJson(c.message, TIMESTAMP, json);
+        uint8_t frame[700];
+        WireWriter wire(frame, sizeof(frame), c.message.type);
+        bool encoded = SocketProtocol::encodeWire(c.message, TIMESTAMP, wire);
+        JsonTokenizer fromJson, fromWire;
+        char scratch[WireCodec::SCRATCH_SIZE];
+        std::string why;
+        if (!encoded) {
+            why = "encodeWire failed";
+        } else if (!fromJson.parse((const uint8_t*)json.c_str(), json.length())) {
+            why = "JSON does not parse: " + std::string(json.c_str());
+        } else if (!WireCodec::decode(wire.data(), wire.length(), fromWire, scratch, sizeof(scratch))) {
+            why = "tlv1 does not decode";
+        } else if (sameFields(fromJson, fromWire, c.message, why)) {
+            continue;
+        }
+        printf("    %s: %s\n", c.label, why.c_str());
+        bad++;
+    }
+    snprintf(label, sizeof(label), "device -> server: %d messages, JSON and tlv1 read back equal", (int)devices.size());
+    ok &= check(bad == 0, label);
+
+    bad = 0;
+    for (const ServerCase& c : servers) {
+        std::string json = serverJson(c);
+        uint8_t frame[700];
+        size_t wireLength = serverWire(c, frame, sizeof(frame));
+        std::string why;
+        if (!compareServerFrame(json, frame, wireLength, why)) {
+            printf("    %s: %s\n", c.label, why.c_str());
+            bad++;
+        }
+    }
+    snprintf(label, sizeof(label), "server -> device: %d frames, same event from JSON and tlv1", (int)servers.size());
+    ok &= check(bad == 0, label);
+
+    ok &= malformedChecks();
+
+    if (serverFramesPath != nullptr) ok &= checkServerFrames(serverFramesPath);
+    if (dumpPath != nullptr) ok &= dumpDeviceFrames(dumpPath);
+    return ok ? 0 : 1;
+}